@@ -0,0 +1,296 @@
+/*
+ * archivestatus.c - count of WAL files awaiting archiving on the primary
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * "repmgr node check --archive-ready" needs the number of ".ready" files
+ * in "archive_status"; when archiving falls behind this directory can hold
+ * many thousands of entries, and scanning it on every check becomes
+ * expensive. Instead, repmgrd on the primary scans it once, then follows
+ * the files being created and renamed via inotify and adjusts the count
+ * accordingly. The count is published in shared memory via
+ * "repmgr.set_archive_ready_files()", from which the client reads it.
+ *
+ * The directory is scanned again if the inotify queue overflows, if the
+ * watch is lost, and at regular intervals in case any events were missed;
+ * without inotify it's scanned on each monitoring cycle.
+ */
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "dirutil.h"
+#include "archivestatus.h"
+
+/* seconds between unconditional rescans of the directory */
+#define ARCHIVE_STATUS_RESCAN_INTERVAL	300
+
+/* seconds after which the count is reported even if unchanged */
+#define ARCHIVE_STATUS_REPORT_INTERVAL	30
+
+typedef struct
+{
+	bool		checked;
+	bool		available;
+	char		archive_status_dir[MAXUXPATH];
+	int			ready_files;
+	int			reported_ready_files;
+	instr_time	last_scan;
+	instr_time	last_report;
+#ifdef __linux__
+	int			watch_fd;
+	int			watch_wd;
+#endif
+} t_archive_status;
+
+static t_archive_status archive_status = {
+	false, false, "", -1, -1
+#ifdef __linux__
+	,{0}, {0}, -1, -1
+#endif
+};
+
+static bool _archive_status_scan(void);
+static bool _archive_status_process_events(void);
+static void _archive_status_watch(void);
+
+
+/*
+ * Discard the current count and watch, e.g. because repmgrd has started
+ * monitoring the node anew; the directory will be scanned again on the
+ * next call to archive_status_update().
+ */
+void
+archive_status_reset(void)
+{
+#ifdef __linux__
+	if (archive_status.watch_fd != -1)
+		close(archive_status.watch_fd);
+
+	archive_status.watch_fd = -1;
+	archive_status.watch_wd = -1;
+#endif
+
+	archive_status.checked = false;
+	archive_status.available = false;
+	archive_status.archive_status_dir[0] = '\0';
+	archive_status.ready_files = -1;
+	archive_status.reported_ready_files = -1;
+}
+
+
+/*
+ * Bring the count up to date and report it to the local node's shared
+ * memory if it has changed, or not been reported for a while.
+ */
+void
+archive_status_update(UXconn *conn)
+{
+	bool		rescan = false;
+
+	if (archive_status.checked == false)
+	{
+		t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+		/* "repmgr.set_archive_ready_files()" was added in extension version 5.5 */
+		archive_status.available = get_repmgr_extension_status(conn, &extversions) == REPMGR_INSTALLED
+			&& extversions.installed_version_num >= 50500;
+		archive_status.checked = true;
+
+		if (archive_status.available == false)
+		{
+			log_verbose(LOG_DEBUG, "\"repmgr.set_archive_ready_files()\" not available");
+			return;
+		}
+
+		snprintf(archive_status.archive_status_dir, MAXUXPATH,
+				 "%s/%s/archive_status",
+				 config_file_options.data_directory,
+				 UXSQLserverVersion(conn) >= 100000 ? "ux_wal" : "ux_xlog");
+
+		_archive_status_watch();
+		rescan = true;
+	}
+
+	if (archive_status.available == false)
+		return;
+
+	if (rescan == false)
+	{
+		if (_archive_status_process_events() == false)
+			rescan = true;
+		else if (calculate_elapsed(archive_status.last_scan) >= ARCHIVE_STATUS_RESCAN_INTERVAL)
+			rescan = true;
+	}
+
+	if (rescan == true && _archive_status_scan() == false)
+		return;
+
+	if (archive_status.ready_files == archive_status.reported_ready_files
+		&& calculate_elapsed(archive_status.last_report) < ARCHIVE_STATUS_REPORT_INTERVAL)
+		return;
+
+	if (repmgrd_set_archive_ready_files(conn, archive_status.ready_files) == true)
+	{
+		archive_status.reported_ready_files = archive_status.ready_files;
+		INSTR_TIME_SET_CURRENT(archive_status.last_report);
+	}
+}
+
+
+static bool
+_archive_status_scan(void)
+{
+	int			ready_files = count_ready_archive_files(archive_status.archive_status_dir);
+
+	INSTR_TIME_SET_CURRENT(archive_status.last_scan);
+
+	if (ready_files < 0)
+	{
+		log_warning(_("unable to read archive_status directory \"%s\""),
+					archive_status.archive_status_dir);
+		log_detail("%s", strerror(errno));
+
+		archive_status.ready_files = -1;
+		return false;
+	}
+
+	log_verbose(LOG_DEBUG, "_archive_status_scan(): %i files ready for archiving", ready_files);
+
+	archive_status.ready_files = ready_files;
+
+	return true;
+}
+
+
+/*
+ * Apply any pending inotify events to the count.
+ *
+ * Returns false if the count can't be maintained from the events alone,
+ * i.e. the directory must be scanned.
+ */
+static bool
+_archive_status_process_events(void)
+{
+#ifdef __linux__
+	char		buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool		valid = true;
+
+	if (archive_status.watch_fd == -1)
+		return false;
+
+	if (archive_status.watch_wd == -1)
+	{
+		/* directory may have been recreated, e.g. by a restore */
+		_archive_status_watch();
+		return false;
+	}
+
+	for (;;)
+	{
+		ssize_t		len = read(archive_status.watch_fd, buf, sizeof(buf));
+		char	   *ptr;
+
+		if (len <= 0)
+		{
+			/* EAGAIN means the queue has been drained; anything else is unexpected */
+			if (len == -1 && errno != EAGAIN)
+			{
+				log_debug("_archive_status_process_events(): %s", strerror(errno));
+				valid = false;
+			}
+			break;
+		}
+
+		for (ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *) ptr)->len)
+		{
+			const struct inotify_event *event = (const struct inotify_event *) ptr;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				log_debug("_archive_status_process_events(): inotify queue overflowed");
+				valid = false;
+				continue;
+			}
+
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+			{
+				archive_status.watch_wd = -1;
+				valid = false;
+				continue;
+			}
+
+			if (event->len == 0 || event->mask & IN_ISDIR)
+				continue;
+
+			if (is_archive_ready_file(event->name) == false)
+				continue;
+
+			if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				archive_status.ready_files++;
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				archive_status.ready_files--;
+		}
+	}
+
+	if (archive_status.ready_files < 0)
+		valid = false;
+
+	return valid;
+#else
+	return false;
+#endif
+}
+
+
+/*
+ * Set up the inotify watch; the watch must be in place before the
+ * directory is scanned, so no file created in between is missed.
+ */
+static void
+_archive_status_watch(void)
+{
+#ifdef __linux__
+	if (archive_status.watch_fd == -1)
+	{
+		archive_status.watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (archive_status.watch_fd == -1)
+		{
+			log_debug("_archive_status_watch(): unable to initialise inotify: %s",
+					  strerror(errno));
+			return;
+		}
+	}
+
+	archive_status.watch_wd = inotify_add_watch(archive_status.watch_fd,
+												archive_status.archive_status_dir,
+												IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+												IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+	if (archive_status.watch_wd == -1)
+	{
+		log_debug("_archive_status_watch(): unable to watch \"%s\": %s",
+				  archive_status.archive_status_dir, strerror(errno));
+	}
+#endif
+}
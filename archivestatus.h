@@ -0,0 +1,26 @@
+/*
+ * archivestatus.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ARCHIVESTATUS_H_
+#define _ARCHIVESTATUS_H_
+
+extern void archive_status_reset(void);
+extern void archive_status_update(UXconn *conn);
+
+#endif							/* _ARCHIVESTATUS_H_ */
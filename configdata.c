@@ -168,6 +168,36 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* log_format */
+	{
+		"log_format",
+		CONFIG_STRING,
+		{ .strptr = config_file_options.log_format },
+		{ .strdefault = DEFAULT_LOG_FORMAT },
+		{},
+		{ .strmaxlen = sizeof(config_file_options.log_format) },
+		{}
+	},
+	/* log_async */
+	{
+		"log_async",
+		CONFIG_BOOL,
+		{ .boolptr = &config_file_options.log_async },
+		{ .booldefault = DEFAULT_LOG_ASYNC },
+		{},
+		{},
+		{}
+	},
+	/* log_async_queue_size */
+	{
+		"log_async_queue_size",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.log_async_queue_size },
+		{ .intdefault = DEFAULT_LOG_ASYNC_QUEUE_SIZE },
+		{ .intminval = MIN_LOG_ASYNC_QUEUE_SIZE },
+		{},
+		{}
+	},
 	/* repmgr_log_filename */
 	{
 		"repmgr_log_filename",
@@ -564,10 +594,10 @@ struct ConfigFileSetting config_file_settings[] =
 	/* monitor_interval_secs */
 	{
 		"monitor_interval_secs",
-		CONFIG_INT,
-		{ .intptr = &config_file_options.monitor_interval_secs },
-		{ .intdefault = DEFAULT_MONITORING_INTERVAL },
-		{ .intminval = 1 },
+		CONFIG_INTERVAL_MS,
+		{ .intptr = &config_file_options.monitor_interval_ms },
+		{ .intdefault = DEFAULT_MONITORING_INTERVAL * 1000 },
+		{ .intminval = MIN_MONITORING_INTERVAL_MS },
 		{},
 		{}
 	},
@@ -584,9 +614,29 @@ struct ConfigFileSetting config_file_settings[] =
 	/* reconnect_interval */
 	{
 		"reconnect_interval",
+		CONFIG_INTERVAL_MS,
+		{ .intptr = &config_file_options.reconnect_interval_ms },
+		{ .intdefault = DEFAULT_RECONNECTION_INTERVAL * 1000 },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
+	/* reconnect_backoff */
+	{
+		"reconnect_backoff",
+		CONFIG_BOOL,
+		{ .boolptr = &config_file_options.reconnect_backoff },
+		{ .booldefault = DEFAULT_RECONNECT_BACKOFF },
+		{},
+		{},
+		{}
+	},
+	/* reconnect_jitter */
+	{
+		"reconnect_jitter",
 		CONFIG_INT,
-		{ .intptr = &config_file_options.reconnect_interval },
-		{ .intdefault = DEFAULT_RECONNECTION_INTERVAL },
+		{ .intptr = &config_file_options.reconnect_jitter },
+		{ .intdefault = DEFAULT_RECONNECT_JITTER },
 		{ .intminval = 0 },
 		{},
 		{}
@@ -602,6 +652,26 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* monitoring_history_batch_size */
+	{
+		"monitoring_history_batch_size",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.monitoring_history_batch_size },
+		{ .intdefault = DEFAULT_MONITORING_HISTORY_BATCH_SIZE },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* monitoring_history_batch_interval */
+	{
+		"monitoring_history_batch_interval",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.monitoring_history_batch_interval },
+		{ .intdefault = DEFAULT_MONITORING_HISTORY_BATCH_INTERVAL },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
 	/* degraded_monitoring_timeout */
 	{
 		"degraded_monitoring_timeout",
@@ -622,12 +692,22 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* local_command_timeout */
+	{
+		"local_command_timeout",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.local_command_timeout },
+		{ .intdefault = DEFAULT_LOCAL_COMMAND_TIMEOUT },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
 	/* primary_notification_timeout */
 	{
 		"primary_notification_timeout",
-		CONFIG_INT,
-		{ .intptr = &config_file_options.primary_notification_timeout },
-		{ .intdefault = DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT },
+		CONFIG_INTERVAL_MS,
+		{ .intptr = &config_file_options.primary_notification_timeout_ms },
+		{ .intdefault = DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT * 1000 },
 		{ .intminval = 0 },
 		{},
 		{}
@@ -702,6 +782,16 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* election_ranking */
+	{
+		"election_ranking",
+		CONFIG_ELECTION_RANKING,
+		{ .rankingptr = &config_file_options.election_ranking },
+		{ .rankingdefault = DEFAULT_ELECTION_RANKING },
+		{},
+		{},
+		{}
+	},
 	/* always_promote */
 	{
 		"always_promote",
@@ -725,10 +815,10 @@ struct ConfigFileSetting config_file_settings[] =
 	/* election_rerun_interval */
 	{
 		"election_rerun_interval",
-		CONFIG_INT,
-		{ .intptr = &config_file_options.election_rerun_interval },
-		{ .intdefault = DEFAULT_ELECTION_RERUN_INTERVAL },
-		{ .intminval = 1 },
+		CONFIG_INTERVAL_MS,
+		{ .intptr = &config_file_options.election_rerun_interval_ms },
+		{ .intdefault = DEFAULT_ELECTION_RERUN_INTERVAL * 1000 },
+		{ .intminval = MIN_ELECTION_RERUN_INTERVAL_MS },
 		{},
 		{}
 	},
@@ -792,6 +882,26 @@ struct ConfigFileSetting config_file_settings[] =
 		{ .strmaxlen = sizeof(config_file_options.child_nodes_disconnect_command) },
 		{}
 	},
+	/* metrics_port */
+	{
+		"metrics_port",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.metrics_port },
+		{ .intdefault = DEFAULT_METRICS_PORT },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
+	/* metrics_listen_address */
+	{
+		"metrics_listen_address",
+		CONFIG_STRING,
+		{ .strptr = config_file_options.metrics_listen_address },
+		{ .strdefault = DEFAULT_METRICS_LISTEN_ADDRESS },
+		{},
+		{ .strmaxlen = sizeof(config_file_options.metrics_listen_address) },
+		{}
+	},
 	/* ================
 	 * service settings
 	 * ================
@@ -904,6 +1014,46 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* event_notification_queue_size */
+	{
+		"event_notification_queue_size",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.event_notification_queue_size },
+		{ .intdefault = DEFAULT_EVENT_NOTIFICATION_QUEUE_SIZE },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* event_notification_max_parallel */
+	{
+		"event_notification_max_parallel",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.event_notification_max_parallel },
+		{ .intdefault = DEFAULT_EVENT_NOTIFICATION_MAX_PARALLEL },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* event_notification_timeout */
+	{
+		"event_notification_timeout",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.event_notification_timeout },
+		{ .intdefault = DEFAULT_EVENT_NOTIFICATION_TIMEOUT },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
+	/* event_retention_days */
+	{
+		"event_retention_days",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.event_retention_days },
+		{ .intdefault = DEFAULT_EVENT_RETENTION_DAYS },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
 	/* ===============
 	 * barman settings
 	 * ===============
@@ -952,6 +1102,26 @@ struct ConfigFileSetting config_file_settings[] =
 		{ .strmaxlen = sizeof(config_file_options.rsync_options) },
 		{}
 	},
+	/* clone_parallel_workers */
+	{
+		"clone_parallel_workers",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.clone_parallel_workers },
+		{ .intdefault = DEFAULT_CLONE_PARALLEL_WORKERS },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* clone_fast_network */
+	{
+		"clone_fast_network",
+		CONFIG_BOOL,
+		{ .boolptr = &config_file_options.clone_fast_network },
+		{ .booldefault = DEFAULT_CLONE_FAST_NETWORK },
+		{},
+		{},
+		{}
+	},
 	/* ssh_options */
 	{
 		"ssh_options",
@@ -962,6 +1132,56 @@ struct ConfigFileSetting config_file_settings[] =
 		{ .strmaxlen = sizeof(config_file_options.ssh_options) },
 		{}
 	},
+	/* ssh_multiplex */
+	{
+		"ssh_multiplex",
+		CONFIG_BOOL,
+		{ .boolptr = &config_file_options.ssh_multiplex },
+		{ .booldefault = DEFAULT_SSH_MULTIPLEX },
+		{},
+		{},
+		{}
+	},
+	/* cluster_probe_parallel */
+	{
+		"cluster_probe_parallel",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.cluster_probe_parallel },
+		{ .intdefault = DEFAULT_CLUSTER_PROBE_PARALLEL },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* cluster_probe_timeout */
+	{
+		"cluster_probe_timeout",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.cluster_probe_timeout },
+		{ .intdefault = DEFAULT_CLUSTER_PROBE_TIMEOUT },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* sibling_follow_parallel */
+	{
+		"sibling_follow_parallel",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.sibling_follow_parallel },
+		{ .intdefault = DEFAULT_SIBLING_FOLLOW_PARALLEL },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
+	/* sibling_follow_timeout */
+	{
+		"sibling_follow_timeout",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.sibling_follow_timeout },
+		{ .intdefault = DEFAULT_SIBLING_FOLLOW_TIMEOUT },
+		{ .intminval = 1 },
+		{},
+		{}
+	},
 	/* uxdb: virtual ip settings */
 	{
 		"virtual_ip",
@@ -1039,6 +1259,16 @@ struct ConfigFileSetting config_file_settings[] =
 		{},
 		{}
 	},
+	/* async -> sync: time the standbys must be caught up before switching back */
+	{
+		"synchronous_recovery_delay",
+		CONFIG_INT,
+		{ .intptr = &config_file_options.synchronous_recovery_delay },
+		{ .intdefault = DEFAULT_SYNCHRONOUS_RECOVERY_DELAY },
+		{ .intminval = 0 },
+		{},
+		{}
+	},
 	{
 		"wal_encparms_path",
 		CONFIG_STRING,
@@ -33,7 +33,13 @@ static bool config_file_provided = false;
 bool		config_file_found = false;
 FILE		*old_fd = NULL;
 
+/* fingerprint of the configuration file as last successfully parsed */
+static uint64 config_file_fingerprint = 0;
+static bool config_file_fingerprint_valid = false;
+
 static void parse_config(bool terse);
+static bool get_config_file_fingerprint(uint64 *fingerprint);
+static int	interval_ms_to_secs(int interval_ms);
 static void _parse_config(ItemList *error_list, ItemList *warning_list);
 
 static void _parse_line(char *buf, char *name, char *value);
@@ -270,6 +276,8 @@ parse_config(bool terse)
 	static ItemList config_errors = {NULL, NULL};
 	static ItemList config_warnings = {NULL, NULL};
 
+	config_file_fingerprint_valid = get_config_file_fingerprint(&config_file_fingerprint);
+
 	_parse_config(&config_errors, &config_warnings);
 
 	/* errors found - exit after printing details, and any warnings */
@@ -314,6 +322,7 @@ _parse_config(ItemList *error_list, ItemList *warning_list)
 		switch (setting->type)
 		{
 			case CONFIG_INT:
+			case CONFIG_INTERVAL_MS:
 				*setting->val.intptr = setting->defval.intdefault;
 				break;
 			case CONFIG_BOOL:
@@ -332,6 +341,9 @@ _parse_config(ItemList *error_list, ItemList *warning_list)
 			case CONFIG_CONNECTION_CHECK_TYPE:
 				*setting->val.checktypeptr = setting->defval.checktypedefault;
 				break;
+			case CONFIG_ELECTION_RANKING:
+				*setting->val.rankingptr = setting->defval.rankingdefault;
+				break;
 			case CONFIG_REPLICATION_TYPE:
 				*setting->val.replicationtypeptr = setting->defval.replicationtypedefault;
 				break;
@@ -444,6 +456,16 @@ _parse_config(ItemList *error_list, ItemList *warning_list)
 
 		/* set values for parameters which default to other parameters */
 
+		/*
+		 * Intervals which can be specified with millisecond resolution are
+		 * also made available in whole seconds (rounded up), for code which
+		 * doesn't need finer resolution.
+		 */
+		config_file_options.monitor_interval_secs = interval_ms_to_secs(config_file_options.monitor_interval_ms);
+		config_file_options.reconnect_interval = interval_ms_to_secs(config_file_options.reconnect_interval_ms);
+		config_file_options.primary_notification_timeout = interval_ms_to_secs(config_file_options.primary_notification_timeout_ms);
+		config_file_options.election_rerun_interval = interval_ms_to_secs(config_file_options.election_rerun_interval_ms);
+
 		/*
 		 * From 4.1, "repmgrd_standby_startup_timeout" replaces "standby_reconnect_timeout"
 		 * in repmgrd; fall back to "standby_reconnect_timeout" if no value explicitly provided
@@ -482,6 +504,26 @@ _parse_config(ItemList *error_list, ItemList *warning_list)
 			item_list_append(error_list,
 							 _("\"standby_reconnect_timeout\" must be equal to or greater than \"node_rejoin_timeout\""));
 		}
+
+		if (config_file_options.reconnect_jitter > MAX_RECONNECT_JITTER)
+		{
+			item_list_append_format(error_list,
+									_("\"reconnect_jitter\" must be between 0 and %i"),
+									MAX_RECONNECT_JITTER);
+		}
+
+		if (config_file_options.metrics_port > 65535)
+		{
+			item_list_append(error_list,
+							 _("\"metrics_port\" must be between 0 and 65535"));
+		}
+
+		if (strcmp(config_file_options.log_format, "text") != 0 && strcmp(config_file_options.log_format, "json") != 0)
+		{
+			item_list_append_format(error_list,
+									_("invalid value \"%s\" for \"log_format\" (must be \"text\" or \"json\")"),
+									config_file_options.log_format);
+		}
 	}
 }
 
@@ -510,6 +552,11 @@ parse_configuration_item(ItemList *error_list, ItemList *warning_list, const cha
 						*(int *)setting->val.intptr = repmgr_atoi(value, name, error_list, setting->minval.intminval);
 					break;
 				}
+				case CONFIG_INTERVAL_MS:
+				{
+					*(int *)setting->val.intptr = repmgr_parse_interval_ms(value, name, error_list, setting->minval.intminval);
+					break;
+				}
 				case CONFIG_STRING:
 				{
 					if (strlen(value) > setting->maxval.strmaxlen)
@@ -597,6 +644,24 @@ parse_configuration_item(ItemList *error_list, ItemList *warning_list, const cha
 					}
 					break;
 				}
+				case CONFIG_ELECTION_RANKING:
+				{
+					if (strcasecmp(value, "lsn") == 0)
+					{
+						*(ElectionRanking *)setting->val.rankingptr = ELECTION_RANKING_LSN;
+					}
+					else if (strcasecmp(value, "catchup") == 0)
+					{
+						*(ElectionRanking *)setting->val.rankingptr = ELECTION_RANKING_CATCHUP;
+					}
+					else
+					{
+						item_list_append_format(error_list,
+												_("value for \"%s\" must be \"lsn\" or \"catchup\"\n"),
+												name);
+					}
+					break;
+				}
 				case CONFIG_REPLICATION_TYPE:
 				{
 					if (strcasecmp(value, "physical") == 0)
@@ -896,11 +961,13 @@ parse_time_unit_parameter(const char *name, const char *value, char *dest, ItemL
  * - connection_check_type
  * - conninfo
  * - degraded_monitoring_timeout
+ * - election_ranking
  * - event_notification_command
  * - event_notifications
  * - failover
  * - failover_validation_command
  * - follow_command
+ * - local_command_timeout
  * - log_facility
  * - log_level
  * - log_status_interval
@@ -908,12 +975,16 @@ parse_time_unit_parameter(const char *name, const char *value, char *dest, ItemL
  * - repmgr_log_directory
  * - monitor_interval_secs
  * - monitoring_history
+ * - monitoring_history_batch_interval
+ * - monitoring_history_batch_size
  * - primary_notification_timeout
  * - primary_visibility_consensus
  * - always_promote
  * - promote_command
  * - reconnect_attempts
  * - reconnect_interval
+ * - reconnect_backoff
+ * - reconnect_jitter
  * - repmgrd_standby_startup_timeout
  * - retry_promote_interval_secs
  * - sibling_nodes_disconnect_timeout
@@ -936,13 +1007,20 @@ parse_time_unit_parameter(const char *name, const char *value, char *dest, ItemL
  * extract with something like:
  *	 grep config_file_options\\. repmgrd*.c | perl -n -e '/config_file_options\.([\w_]+)/ && print qq|$1\n|;' | sort | uniq
  *
- * Returns "true" if the configuration was successfully changed, otherwise "false".
+ * If the configuration file's contents are unchanged since it was last
+ * successfully parsed, it is not parsed again.
+ *
+ * Returns "true" if the configuration was successfully changed, otherwise "false";
+ * "changes" is set to a combination of the CONFIG_CHANGE_* flags describing
+ * what changed, so the caller need only reinitialise what is affected.
  */
 bool
-reload_config(t_server_type server_type)
+reload_config(t_server_type server_type, int *changes)
 {
 	bool		log_config_changed = false;
 	bool result = false;
+	uint64		fingerprint = 0;
+	bool		fingerprint_valid = false;
 
 	ItemList config_errors = {NULL, NULL};
 	ItemList config_warnings = {NULL, NULL};
@@ -950,6 +1028,17 @@ reload_config(t_server_type server_type)
 
 	t_configuration_options orig_config_file_options;
 
+	*changes = 0;
+
+	fingerprint_valid = get_config_file_fingerprint(&fingerprint);
+
+	if (fingerprint_valid == true && config_file_fingerprint_valid == true &&
+		fingerprint == config_file_fingerprint)
+	{
+		log_info(_("configuration file \"%s\" has not changed"), config_file_path);
+		return false;
+	}
+
 	copy_config_file_options(&config_file_options, &orig_config_file_options);
 
 	log_info(_("reloading configuration file"));
@@ -1020,6 +1109,7 @@ reload_config(t_server_type server_type)
 									_("\"conninfo\" changed from \"%s\" to \"%s\""),
 									orig_config_file_options.conninfo,
 									config_file_options.conninfo);
+			*changes |= CONFIG_CHANGE_CONNINFO;
 		}
 
 		UXSQLfinish(conn);
@@ -1058,9 +1148,18 @@ reload_config(t_server_type server_type)
 		item_list_free(&config_warnings);
 		item_list_free(&config_changes);
 
+		*changes = 0;
+
 		return false;
 	}
 
+	/* when converted to a parameter string, these affect all node connections */
+	if (strncmp(config_file_options.passfile, orig_config_file_options.passfile, sizeof(config_file_options.passfile)) != 0 ||
+		strncmp(config_file_options.replication_user, orig_config_file_options.replication_user, sizeof(config_file_options.replication_user)) != 0)
+	{
+		*changes |= CONFIG_CHANGE_CONNECTION;
+	}
+
 
 	/*
 	 * No configuration problems detected - log any changed values.
@@ -1079,6 +1178,15 @@ reload_config(t_server_type server_type)
 								config_file_options.async_query_timeout);
 	}
 
+	/* local_command_timeout */
+	if (config_file_options.local_command_timeout != orig_config_file_options.local_command_timeout)
+	{
+		item_list_append_format(&config_changes,
+								_("\"local_command_timeout\" changed from \"%i\" to \"%i\""),
+								orig_config_file_options.local_command_timeout,
+								config_file_options.local_command_timeout);
+	}
+
 	/* child_nodes_check_interval */
 	if (config_file_options.child_nodes_check_interval != orig_config_file_options.child_nodes_check_interval)
 	{
@@ -1180,12 +1288,12 @@ reload_config(t_server_type server_type)
 	}
 
 	/* monitor_interval_secs */
-	if (config_file_options.monitor_interval_secs != orig_config_file_options.monitor_interval_secs)
+	if (config_file_options.monitor_interval_ms != orig_config_file_options.monitor_interval_ms)
 	{
 		item_list_append_format(&config_changes,
-								_("\"monitor_interval_secs\" changed from \"%i\" to \"%i\""),
-								orig_config_file_options.monitor_interval_secs,
-								config_file_options.monitor_interval_secs);
+								_("\"monitor_interval_secs\" changed from \"%ims\" to \"%ims\""),
+								orig_config_file_options.monitor_interval_ms,
+								config_file_options.monitor_interval_ms);
 	}
 
 	/* monitoring_history */
@@ -1197,13 +1305,31 @@ reload_config(t_server_type server_type)
 								format_bool(config_file_options.monitoring_history));
 	}
 
+	/* monitoring_history_batch_size */
+	if (config_file_options.monitoring_history_batch_size != orig_config_file_options.monitoring_history_batch_size)
+	{
+		item_list_append_format(&config_changes,
+								_("\"monitoring_history_batch_size\" changed from \"%i\" to \"%i\""),
+								orig_config_file_options.monitoring_history_batch_size,
+								config_file_options.monitoring_history_batch_size);
+	}
+
+	/* monitoring_history_batch_interval */
+	if (config_file_options.monitoring_history_batch_interval != orig_config_file_options.monitoring_history_batch_interval)
+	{
+		item_list_append_format(&config_changes,
+								_("\"monitoring_history_batch_interval\" changed from \"%i\" to \"%i\""),
+								orig_config_file_options.monitoring_history_batch_interval,
+								config_file_options.monitoring_history_batch_interval);
+	}
+
 	/* primary_notification_timeout */
-	if (config_file_options.primary_notification_timeout != orig_config_file_options.primary_notification_timeout)
+	if (config_file_options.primary_notification_timeout_ms != orig_config_file_options.primary_notification_timeout_ms)
 	{
 		item_list_append_format(&config_changes,
-								_("\"primary_notification_timeout\" changed from \"%i\" to \"%i\""),
-								orig_config_file_options.primary_notification_timeout,
-								config_file_options.primary_notification_timeout);
+								_("\"primary_notification_timeout\" changed from \"%ims\" to \"%ims\""),
+								orig_config_file_options.primary_notification_timeout_ms,
+								config_file_options.primary_notification_timeout_ms);
 	}
 
 	/* promote_command */
@@ -1234,12 +1360,30 @@ reload_config(t_server_type server_type)
 	}
 
 	/* reconnect_interval */
-	if (config_file_options.reconnect_interval != orig_config_file_options.reconnect_interval)
+	if (config_file_options.reconnect_interval_ms != orig_config_file_options.reconnect_interval_ms)
+	{
+		item_list_append_format(&config_changes,
+								_("\"reconnect_interval\" changed from \"%ims\" to \"%ims\""),
+								orig_config_file_options.reconnect_interval_ms,
+								config_file_options.reconnect_interval_ms);
+	}
+
+	/* reconnect_backoff */
+	if (config_file_options.reconnect_backoff != orig_config_file_options.reconnect_backoff)
+	{
+		item_list_append_format(&config_changes,
+								_("\"reconnect_backoff\" changed from \"%s\" to \"%s\""),
+								format_bool(orig_config_file_options.reconnect_backoff),
+								format_bool(config_file_options.reconnect_backoff));
+	}
+
+	/* reconnect_jitter */
+	if (config_file_options.reconnect_jitter != orig_config_file_options.reconnect_jitter)
 	{
 		item_list_append_format(&config_changes,
-								_("\"reconnect_interval\" changed from \"%i\" to \"%i\""),
-								orig_config_file_options.reconnect_interval,
-								config_file_options.reconnect_interval);
+								_("\"reconnect_jitter\" changed from \"%i\" to \"%i\""),
+								orig_config_file_options.reconnect_jitter,
+								config_file_options.reconnect_jitter);
 	}
 
 	/* repmgrd_standby_startup_timeout */
@@ -1287,6 +1431,15 @@ reload_config(t_server_type server_type)
 								format_bool(config_file_options.primary_visibility_consensus));
 	}
 
+	/* election_ranking */
+	if (config_file_options.election_ranking != orig_config_file_options.election_ranking)
+	{
+		item_list_append_format(&config_changes,
+								_("\"election_ranking\" changed from \"%s\" to \"%s\""),
+								print_election_ranking(orig_config_file_options.election_ranking),
+								print_election_ranking(config_file_options.election_ranking));
+	}
+
 	/* always_promote */
 	if (config_file_options.always_promote != orig_config_file_options.always_promote)
 	{
@@ -1345,6 +1498,26 @@ reload_config(t_server_type server_type)
 								config_file_options.log_status_interval);
 	}
 
+	/* log_format */
+	if (strncmp(config_file_options.log_format, orig_config_file_options.log_format, sizeof(config_file_options.log_format)) != 0)
+	{
+		item_list_append_format(&config_changes,
+								_("\"log_format\" changed from \"%s\" to \"%s\""),
+								orig_config_file_options.log_format,
+								config_file_options.log_format);
+		log_config_changed = true;
+	}
+
+	/* log_async */
+	if (config_file_options.log_async != orig_config_file_options.log_async)
+	{
+		item_list_append_format(&config_changes,
+								_("\"log_async\" changed from \"%s\" to \"%s\""),
+								format_bool(orig_config_file_options.log_async),
+								format_bool(config_file_options.log_async));
+		log_config_changed = true;
+	}
+
 	/* repmgr_log_filename */
 	if (strncmp(config_file_options.repmgr_log_filename, orig_config_file_options.repmgr_log_filename, sizeof(config_file_options.repmgr_log_filename)) != 0)
 	{
@@ -1372,6 +1545,15 @@ reload_config(t_server_type server_type)
 								config_file_options.try_synchronous_connection_timeout);
 	}
 
+	/* synchronous_recovery_delay */
+	if (config_file_options.synchronous_recovery_delay != orig_config_file_options.synchronous_recovery_delay)
+	{
+		item_list_append_format(&config_changes,
+								_("\"synchronous_recovery_delay\" changed from \"%i\" to \"%i\""),
+								orig_config_file_options.synchronous_recovery_delay,
+								config_file_options.synchronous_recovery_delay);
+	}
+
 	/* root_password */
 	if (strncmp(config_file_options.root_password, orig_config_file_options.root_password, sizeof(config_file_options.root_password)) != 0)
 	{
@@ -1392,6 +1574,8 @@ reload_config(t_server_type server_type)
 
 	if (log_config_changed == true)
 	{
+		*changes |= CONFIG_CHANGE_LOGGING;
+
 		log_notice(_("restarting logging with changed parameters"));
 		logger_shutdown();
 		logger_init(&config_file_options, progname());
@@ -1451,6 +1635,13 @@ reload_config(t_server_type server_type)
 	}
 
 	result = config_changes.head == NULL ? false : true;
+
+	if (result == true)
+		*changes |= CONFIG_CHANGE_OTHER;
+
+	config_file_fingerprint = fingerprint;
+	config_file_fingerprint_valid = fingerprint_valid;
+
 	item_list_free(&config_errors);
 	item_list_free(&config_changes);
 	item_list_free(&config_warnings);
@@ -1458,6 +1649,61 @@ reload_config(t_server_type server_type)
 	return result;
 }
 
+/*
+ * Compute a 64-bit FNV-1a hash of the configuration file's contents, so a
+ * reload can be skipped if nothing has changed.
+ *
+ * Returns false if the file can't be read, or contains "include" or
+ * "include_dir" directives, as changes to the included files would not be
+ * detected.
+ */
+static bool
+get_config_file_fingerprint(uint64 *fingerprint)
+{
+	FILE	   *fp = NULL;
+	char		buf[MAXLEN];
+	uint64		hash = UINT64CONST(14695981039346656037);
+	bool		valid = true;
+
+	if (config_file_path[0] == '\0')
+		return false;
+
+	fp = fopen(config_file_path, "r");
+
+	if (fp == NULL)
+		return false;
+
+	while (fgets(buf, sizeof(buf), fp) != NULL)
+	{
+		char	   *ptr = buf;
+
+		while (*ptr == ' ' || *ptr == '\t')
+			ptr++;
+
+		if (strncasecmp(ptr, "include", 7) == 0)
+		{
+			valid = false;
+			break;
+		}
+
+		for (ptr = buf; *ptr; ptr++)
+		{
+			hash ^= (unsigned char) *ptr;
+			hash *= UINT64CONST(1099511628211);
+		}
+	}
+
+	if (ferror(fp))
+		valid = false;
+
+	fclose(fp);
+
+	*fingerprint = hash;
+
+	return valid;
+}
+
+
 /*
  * Dump the parsed configuration
  */
@@ -1476,6 +1722,9 @@ dump_config(void)
 			case CONFIG_INT:
 				printf("%i", *setting->val.intptr);
 				break;
+			case CONFIG_INTERVAL_MS:
+				printf("%ims", *setting->val.intptr);
+				break;
 			case CONFIG_BOOL:
 				printf("%s", format_bool(*setting->val.boolptr));
 				break;
@@ -1488,6 +1737,9 @@ dump_config(void)
 			case CONFIG_CONNECTION_CHECK_TYPE:
 				printf("%s", print_connection_check_type(*setting->val.checktypeptr));
 				break;
+			case CONFIG_ELECTION_RANKING:
+				printf("%s", print_election_ranking(*setting->val.rankingptr));
+				break;
 			case CONFIG_REPLICATION_TYPE:
 				printf("%s", print_replication_type(*setting->val.replicationtypeptr));
 				break;
@@ -1646,6 +1898,112 @@ repmgr_atoi(const char *value, const char *config_item, ItemList *error_list, in
 }
 
 
+/*
+ * Convert a time interval with an optional unit suffix ("ms", "s" or
+ * "min") to milliseconds; values without a unit are treated as seconds,
+ * for compatibility with parameters which previously accepted only
+ * seconds.
+ *
+ * Error handling is as for repmgr_atoi(); "minval" is in milliseconds.
+ */
+int
+repmgr_parse_interval_ms(const char *value, const char *config_item, ItemList *error_list, int minval)
+{
+	char	   *endptr = NULL;
+	long		longval = 0;
+	long		multiplier = 1000;
+	long		msval = 0;
+	UXSQLExpBufferData errors;
+
+	initUXSQLExpBuffer(&errors);
+
+	if (*value == '\0')
+	{
+		/* don't log here - empty values will be caught later */
+		return 0;
+	}
+
+	errno = 0;
+	longval = strtol(value, &endptr, 10);
+
+	if (value == endptr || errno)
+	{
+		appendUXSQLExpBuffer(&errors,
+						  _("\"%s\": invalid value (provided: \"%s\")"),
+						  config_item, value);
+	}
+	else
+	{
+		while (isspace((unsigned char) *endptr))
+			endptr++;
+
+		if (*endptr == '\0' || strcasecmp(endptr, "s") == 0)
+			multiplier = 1000;
+		else if (strcasecmp(endptr, "ms") == 0)
+			multiplier = 1;
+		else if (strcasecmp(endptr, "min") == 0)
+			multiplier = 60 * 1000;
+		else
+		{
+			appendUXSQLExpBuffer(&errors,
+							  _("\"%s\": invalid unit; valid units are \"ms\", \"s\" and \"min\" (provided: \"%s\")"),
+							  config_item, value);
+		}
+
+		if (errors.data[0] == '\0')
+		{
+			msval = longval * multiplier;
+
+			if (longval > 2147483647L / multiplier)
+			{
+				appendUXSQLExpBuffer(&errors,
+								  _("\"%s\": must be 2147483647 milliseconds or less (provided: \"%s\")"),
+								  config_item,
+								  value);
+			}
+			else if (msval < minval)
+			{
+				appendUXSQLExpBuffer(&errors,
+								  _("\"%s\": must be %i milliseconds or greater (provided: \"%s\")"),
+								  config_item,
+								  minval,
+								  value);
+			}
+		}
+	}
+
+	/* Error message buffer is set */
+	if (errors.data[0] != '\0')
+	{
+		if (error_list == NULL)
+		{
+			log_error("%s", errors.data);
+			termUXSQLExpBuffer(&errors);
+			exit(ERR_BAD_CONFIG);
+		}
+
+		item_list_append(error_list, errors.data);
+		msval = 0;
+	}
+
+	termUXSQLExpBuffer(&errors);
+	return (int) msval;
+}
+
+
+/*
+ * Round a millisecond interval up to whole seconds.
+ */
+static int
+interval_ms_to_secs(int interval_ms)
+{
+	if (interval_ms <= 0)
+		return 0;
+
+	return (int) (((long) interval_ms + 999) / 1000);
+}
+
+
 /* repmgr_rotation_time */
 int
 parse_time_interval(const char *value, const char *config_item)
@@ -2443,6 +2801,22 @@ print_connection_check_type(ConnectionCheckType type)
 }
 
 
+const char *
+print_election_ranking(ElectionRanking ranking)
+{
+	switch (ranking)
+	{
+		case ELECTION_RANKING_LSN:
+			return "lsn";
+		case ELECTION_RANKING_CATCHUP:
+			return "catchup";
+	}
+
+	/* should never reach here */
+	return "UNKNOWN";
+}
+
+
 
 char *
 print_event_notification_list(EventNotificationList *list)
@@ -56,6 +56,12 @@ typedef enum
 	CHECK_CONNECTION
 } ConnectionCheckType;
 
+typedef enum
+{
+	ELECTION_RANKING_LSN,
+	ELECTION_RANKING_CATCHUP
+} ElectionRanking;
+
 typedef enum
 {
 	REPLICATION_TYPE_PHYSICAL
@@ -96,9 +102,11 @@ typedef enum
 	CONFIG_STRING,
 	CONFIG_FAILOVER_MODE,
 	CONFIG_CONNECTION_CHECK_TYPE,
+	CONFIG_ELECTION_RANKING,
 	CONFIG_EVENT_NOTIFICATION_LIST,
 	CONFIG_TABLESPACE_MAPPING,
-	CONFIG_REPLICATION_TYPE
+	CONFIG_REPLICATION_TYPE,
+	CONFIG_INTERVAL_MS
 } ConfigItemType;
 
 
@@ -113,6 +121,7 @@ typedef struct ConfigFileSetting
 		bool	   *boolptr;
 		failover_mode_opt *failovermodeptr;
 		ConnectionCheckType *checktypeptr;
+		ElectionRanking *rankingptr;
 		EventNotificationList *notificationlistptr;
 		TablespaceList *tablespacemappingptr;
 		ReplicationType *replicationtypeptr;
@@ -123,6 +132,7 @@ typedef struct ConfigFileSetting
 		bool		booldefault;
 		failover_mode_opt failovermodedefault;
 		ConnectionCheckType checktypedefault;
+		ElectionRanking rankingdefault;
 		ReplicationType replicationtypedefault;
 	} defval;
 	union {
@@ -160,6 +170,9 @@ typedef struct
 	char		log_facility[MAXLEN];
 	char		log_file[MAXUXPATH];
 	int			log_status_interval;
+	char		log_format[MAXLEN];
+	bool		log_async;
+	int			log_async_queue_size;
 
 	char		repmgr_log_filename[MAXUXPATH]; /* repmgr日志文件 */
 	char		repmgr_log_directory[MAXUXPATH]; /* repmgr日志文件目录 */
@@ -215,12 +228,20 @@ typedef struct
 	char		promote_command[MAXLEN];
 	char		follow_command[MAXLEN];
 	int			monitor_interval_secs;
+	int			monitor_interval_ms;
 	int			reconnect_attempts;
 	int			reconnect_interval;
+	int			reconnect_interval_ms;
+	bool		reconnect_backoff;
+	int			reconnect_jitter;
 	bool		monitoring_history;
+	int			monitoring_history_batch_size;
+	int			monitoring_history_batch_interval;
 	int			degraded_monitoring_timeout;
 	int			async_query_timeout;
+	int			local_command_timeout;
 	int			primary_notification_timeout;
+	int			primary_notification_timeout_ms;
 	int			repmgrd_standby_startup_timeout;
 	char		repmgrd_pid_file[MAXUXPATH];
 	bool		repmgrd_exit_on_inactive_node;
@@ -228,15 +249,19 @@ typedef struct
 	int			sibling_nodes_disconnect_timeout;
 	ConnectionCheckType connection_check_type;
 	bool		primary_visibility_consensus;
+	ElectionRanking election_ranking;
 	bool		always_promote;
 	char		failover_validation_command[MAXUXPATH];
 	int			election_rerun_interval;
+	int			election_rerun_interval_ms;
 	int			child_nodes_check_interval;
 	int			child_nodes_disconnect_min_count;
 	int			child_nodes_connected_min_count;
 	bool		child_nodes_connected_include_witness;
 	int			child_nodes_disconnect_timeout;
 	char		child_nodes_disconnect_command[MAXUXPATH];
+	int			metrics_port;
+	char		metrics_listen_address[MAXLEN];
 
 	/* service settings */
 	char		ux_ctl_options[MAXLEN];
@@ -254,6 +279,10 @@ typedef struct
 	char		event_notification_command[MAXUXPATH];
 	char		event_notifications_orig[MAXLEN];
 	EventNotificationList event_notifications;
+	int			event_notification_queue_size;
+	int			event_notification_max_parallel;
+	int			event_notification_timeout;
+	int			event_retention_days;
 
 	/* barman settings */
 	char		barman_host[MAXLEN];
@@ -262,7 +291,14 @@ typedef struct
 
 	/* rsync/ssh settings */
 	char		rsync_options[MAXLEN];
+	int			clone_parallel_workers;
+	bool		clone_fast_network;
 	char		ssh_options[MAXLEN];
+	bool		ssh_multiplex;
+	int			cluster_probe_parallel;
+	int			cluster_probe_timeout;
+	int			sibling_follow_parallel;
+	int			sibling_follow_timeout;
 
 	/* uxdb: Virtual IP control settings */
 	char        virtual_ip[MAXLEN];
@@ -280,6 +316,7 @@ typedef struct
 
 	/* sync <-> async: try synchronous connection timeout. see check_sync_async */
 	int         try_synchronous_connection_timeout;
+	int         synchronous_recovery_delay;
 
 	/* Added by duankun for #178610 at 2023/3/10, reviewer: huyn */
 	/* 安全模式ux_rewind工具-k参数适配，增加解析wal加密参数路径配置 */
@@ -373,8 +410,14 @@ typedef struct
 void		set_progname(const char *argv0);
 const char *progname(void);
 
+/* the kinds of change reported by reload_config() */
+#define CONFIG_CHANGE_CONNINFO		(1 << 0)	/* local node's "conninfo" */
+#define CONFIG_CHANGE_CONNECTION	(1 << 1)	/* anything else affecting node connections */
+#define CONFIG_CHANGE_LOGGING		(1 << 2)
+#define CONFIG_CHANGE_OTHER			(1 << 3)
+
 void		load_config(const char *config_file, bool verbose, bool terse, char *argv0);
-bool		reload_config(t_server_type server_type);
+bool		reload_config(t_server_type server_type, int *changes);
 void		dump_config(void);
 
 void        parse_configuration_item(ItemList *error_list, ItemList *warning_list, const char *name, const char *value);
@@ -390,6 +433,11 @@ int repmgr_atoi(const char *s,
 			ItemList *error_list,
 			int minval);
 
+int repmgr_parse_interval_ms(const char *s,
+			const char *config_item,
+			ItemList *error_list,
+			int minval);
+
 void parse_time_unit_parameter(const char *name, const char *value, char *dest, ItemList *errors);
 void repmgr_canonicalize_path(const char *name, const char *value, char *config_item, ItemList *errors);
 
@@ -408,6 +456,7 @@ void		exit_with_cli_errors(ItemList *error_list, const char *repmgr_command);
 void		print_item_list(ItemList *item_list);
 const char *print_replication_type(ReplicationType type);
 const char *print_connection_check_type(ConnectionCheckType type);
+const char *print_election_ranking(ElectionRanking ranking);
 char 	   *print_event_notification_list(EventNotificationList *list);
 char 	   *print_tablespace_mapping(TablespaceList *tablespacemappingptr);
 
@@ -0,0 +1,595 @@
+#!/bin/bash
+#
+# failover-bench.sh - measure repmgrd failover performance
+#
+# Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+# Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# For each round, a primary and N standbys are created on the local host
+# and repmgrd is started on every node; a fault is then injected on the
+# primary and the time taken by each stage of the resulting failover is
+# read from the event records ("repmgrd_failover_trace" and friends)
+# written by repmgrd. Results are appended to a CSV file, and optionally
+# compared against a baseline produced by an earlier run.
+#
+# See README.md in this directory for details.
+
+BENCH_DIR=/tmp/repmgr-failover-bench
+UX_BINDIR=
+REPMGR_BINDIR=
+STANDBYS=2
+ROUNDS=3
+FAULTS=kill
+BASE_PORT=55400
+RESULTS=
+BASELINE=
+THRESHOLD=20
+TIMEOUT=300
+RECONNECT_ATTEMPTS=3
+RECONNECT_INTERVAL=2
+VIRTUAL_IP=
+KEEP=0
+
+# address range used for the per-node dummy interfaces ("partition" and "nic" faults)
+NODE_NET=10.249.0
+NODE_IF_PREFIX=uxbench
+
+CSV_HEADER="round,fault,standbys,new_primary_id,detection_s,failover_s,election_ms,promote_ms,vip_bind_ms,vip_reachable_s,notify_ms,follow_ms,catchup_s"
+
+usage()
+{
+	cat <<EOF
+Usage: $0 [OPTIONS]
+
+Options:
+  -b DIR       working directory for the test cluster (default: $BENCH_DIR)
+  -B DIR       UXsinoDB binary directory (default: output of "ux_config --bindir")
+  -R DIR       directory containing repmgr and repmgrd (default: same as -B)
+  -n N         number of standbys (default: $STANDBYS)
+  -r N         number of rounds per fault (default: $ROUNDS)
+  -f FAULTS    comma-separated list of faults to inject: kill, partition, nic
+               (default: $FAULTS; "partition" and "nic" require passwordless sudo)
+  -p PORT      port of the first node (default: $BASE_PORT)
+  -o FILE      CSV file to append results to (default: BENCH_DIR/results.csv)
+  -c FILE      baseline CSV file to compare the results against
+  -t PERCENT   permitted regression against the baseline (default: $THRESHOLD)
+  -T SECONDS   time to wait for the failover to complete (default: $TIMEOUT)
+  -a N         "reconnect_attempts" (default: $RECONNECT_ATTEMPTS)
+  -i SECONDS   "reconnect_interval" (default: $RECONNECT_INTERVAL)
+  -v ADDRESS   virtual IP to configure, in $NODE_NET.0/24 (requires "partition" or "nic")
+  -k           keep the cluster from the last round running
+  -h           show this help
+EOF
+}
+
+log()
+{
+	echo "[$(date '+%Y-%m-%d %H:%M:%S')] $*"
+}
+
+die()
+{
+	log "ERROR: $*" >&2
+	teardown_cluster
+	exit 1
+}
+
+# run "ip" or "iptables"; the database and repmgr commands refuse to run
+# as root, so the script runs as an ordinary user and uses sudo for these
+priv()
+{
+	sudo -n "$@"
+}
+
+now()
+{
+	date +%s.%N
+}
+
+node_port()
+{
+	echo $((BASE_PORT + $1))
+}
+
+node_host()
+{
+	if [ "$USE_NODE_IFS" = "1" ]; then
+		echo "$NODE_NET.$1"
+	else
+		echo "127.0.0.1"
+	fi
+}
+
+node_dir()
+{
+	echo "$BENCH_DIR/node$1"
+}
+
+node_conf()
+{
+	echo "$BENCH_DIR/node$1.conf"
+}
+
+# execute a query against node $1, printing the unaligned result
+node_query()
+{
+	local node_id=$1
+	shift
+
+	"$UX_BINDIR/uxsql" -X -q -A -t \
+		-h "$(node_host "$node_id")" -p "$(node_port "$node_id")" \
+		-U repmgr -d repmgr \
+		-c "$*" 2>/dev/null
+}
+
+# wait until the predicate query $2 returns "t" on node $1, or the timeout expires
+wait_for()
+{
+	local node_id=$1
+	local query=$2
+	local deadline=$(($(date +%s) + TIMEOUT))
+
+	while [ "$(date +%s)" -lt "$deadline" ]; do
+		if [ "$(node_query "$node_id" "$query")" = "t" ]; then
+			return 0
+		fi
+		sleep 0.2
+	done
+
+	return 1
+}
+
+setup_node_interfaces()
+{
+	local i
+
+	[ "$USE_NODE_IFS" = "1" ] || return 0
+
+	for i in $(seq 1 $((STANDBYS + 1))); do
+		priv ip link add "$NODE_IF_PREFIX$i" type dummy 2>/dev/null
+		priv ip addr add "$NODE_NET.$i/32" dev "$NODE_IF_PREFIX$i" 2>/dev/null
+		priv ip link set "$NODE_IF_PREFIX$i" up || die "unable to configure interface $NODE_IF_PREFIX$i"
+	done
+}
+
+remove_node_interfaces()
+{
+	local i
+
+	[ "$USE_NODE_IFS" = "1" ] || return 0
+
+	for i in $(seq 1 $((STANDBYS + 1))); do
+		priv iptables -D INPUT -d "$NODE_NET.$i" -j DROP 2>/dev/null
+		priv iptables -D INPUT -s "$NODE_NET.$i" -j DROP 2>/dev/null
+		priv ip link del "$NODE_IF_PREFIX$i" 2>/dev/null
+	done
+
+	if [ -n "$VIRTUAL_IP" ]; then
+		for i in $(seq 1 $((STANDBYS + 1))); do
+			priv ip addr del "$VIRTUAL_IP/32" dev "$NODE_IF_PREFIX$i" 2>/dev/null
+		done
+	fi
+}
+
+write_repmgr_conf()
+{
+	local node_id=$1
+	local conf=$(node_conf "$node_id")
+	local dir=$(node_dir "$node_id")
+
+	cat > "$conf" <<EOF
+node_id=$node_id
+node_name='node$node_id'
+conninfo='host=$(node_host "$node_id") port=$(node_port "$node_id") user=repmgr dbname=repmgr connect_timeout=2'
+data_directory='$dir'
+ux_bindir='$UX_BINDIR'
+repmgr_bindir='$REPMGR_BINDIR'
+log_file='$BENCH_DIR/node$node_id-repmgrd.log'
+log_level=INFO
+repmgrd_pid_file='$BENCH_DIR/node$node_id-repmgrd.pid'
+failover=automatic
+priority=$((200 - node_id))
+connection_check_type=ping
+monitor_interval_secs=1
+monitoring_history=yes
+reconnect_attempts=$RECONNECT_ATTEMPTS
+reconnect_interval=$RECONNECT_INTERVAL
+promote_command='$REPMGR_BINDIR/repmgr standby promote -f $conf --log-to-file'
+follow_command='$REPMGR_BINDIR/repmgr standby follow -f $conf --log-to-file --upstream-node-id=%n'
+service_start_command='$UX_BINDIR/ux_ctl -D $dir -l $BENCH_DIR/node$node_id.log -w start'
+service_stop_command='$UX_BINDIR/ux_ctl -D $dir -m fast -w stop'
+service_restart_command='$UX_BINDIR/ux_ctl -D $dir -l $BENCH_DIR/node$node_id.log -m fast -w restart'
+service_reload_command='$UX_BINDIR/ux_ctl -D $dir reload'
+EOF
+
+	if [ -n "$VIRTUAL_IP" ]; then
+		cat >> "$conf" <<EOF
+virtual_ip='$VIRTUAL_IP'
+network_card='$NODE_IF_PREFIX$node_id'
+EOF
+	fi
+}
+
+setup_primary()
+{
+	local dir=$(node_dir 1)
+
+	"$UX_BINDIR/initdb" -D "$dir" -A trust > "$BENCH_DIR/node1-initdb.log" 2>&1 \
+		|| die "initdb failed, see $BENCH_DIR/node1-initdb.log"
+
+	cat >> "$dir/uxsinodb.conf" <<EOF
+listen_addresses = '*'
+port = $(node_port 1)
+wal_level = 'hot_standby'
+hot_standby = on
+wal_log_hints = on
+max_wal_senders = $((STANDBYS + 10))
+max_replication_slots = $((STANDBYS + 10))
+shared_preload_libraries = 'repmgr'
+EOF
+
+	cat >> "$dir/ux_hba.conf" <<EOF
+host    replication   repmgr      $NODE_NET.0/24          trust
+host    repmgr        repmgr      $NODE_NET.0/24          trust
+EOF
+
+	"$UX_BINDIR/ux_ctl" -D "$dir" -l "$BENCH_DIR/node1.log" -w start > /dev/null \
+		|| die "unable to start primary"
+
+	"$UX_BINDIR/uxsql" -X -q -h 127.0.0.1 -p "$(node_port 1)" -d template1 \
+		-c "CREATE USER repmgr SUPERUSER" \
+		-c "CREATE DATABASE repmgr OWNER repmgr" \
+		-c "ALTER USER repmgr SET search_path TO repmgr, \"\$user\", public" > /dev/null \
+		|| die "unable to create repmgr user and database"
+
+	write_repmgr_conf 1
+	"$REPMGR_BINDIR/repmgr" -f "$(node_conf 1)" primary register > "$BENCH_DIR/node1-register.log" 2>&1 \
+		|| die "unable to register primary, see $BENCH_DIR/node1-register.log"
+}
+
+setup_standby()
+{
+	local node_id=$1
+	local dir=$(node_dir "$node_id")
+
+	write_repmgr_conf "$node_id"
+
+	"$REPMGR_BINDIR/repmgr" -f "$(node_conf "$node_id")" \
+		-h "$(node_host 1)" -p "$(node_port 1)" -U repmgr -d repmgr \
+		standby clone > "$BENCH_DIR/node$node_id-clone.log" 2>&1 \
+		|| die "unable to clone node $node_id, see $BENCH_DIR/node$node_id-clone.log"
+
+	echo "port = $(node_port "$node_id")" >> "$dir/uxsinodb.conf"
+
+	"$UX_BINDIR/ux_ctl" -D "$dir" -l "$BENCH_DIR/node$node_id.log" -w start > /dev/null \
+		|| die "unable to start node $node_id"
+
+	"$REPMGR_BINDIR/repmgr" -f "$(node_conf "$node_id")" standby register --wait-sync=$TIMEOUT \
+		> "$BENCH_DIR/node$node_id-register.log" 2>&1 \
+		|| die "unable to register node $node_id, see $BENCH_DIR/node$node_id-register.log"
+}
+
+setup_cluster()
+{
+	local i
+
+	rm -rf "$BENCH_DIR"/node*
+	mkdir -p "$BENCH_DIR"
+
+	setup_node_interfaces
+	setup_primary
+
+	for i in $(seq 2 $((STANDBYS + 1))); do
+		setup_standby "$i"
+	done
+
+	if [ -n "$VIRTUAL_IP" ]; then
+		priv ip addr add "$VIRTUAL_IP/32" dev "${NODE_IF_PREFIX}1" \
+			|| die "unable to bind virtual IP $VIRTUAL_IP"
+	fi
+
+	for i in $(seq 1 $((STANDBYS + 1))); do
+		"$REPMGR_BINDIR/repmgrd" -f "$(node_conf "$i")" -d > /dev/null 2>&1 \
+			|| die "unable to start repmgrd on node $i"
+	done
+
+	# wait for every standby's repmgrd to be monitoring the primary
+	for i in $(seq 2 $((STANDBYS + 1))); do
+		wait_for "$i" "SELECT repmgr.get_upstream_last_seen() BETWEEN 0 AND 2" \
+			|| die "repmgrd on node $i is not monitoring the primary"
+	done
+}
+
+teardown_cluster()
+{
+	local i
+
+	[ -d "$BENCH_DIR" ] || return 0
+
+	for i in $(seq 1 $((STANDBYS + 1))); do
+		if [ -f "$BENCH_DIR/node$i-repmgrd.pid" ]; then
+			kill "$(cat "$BENCH_DIR/node$i-repmgrd.pid")" 2>/dev/null
+		fi
+		if [ -d "$(node_dir "$i")" ]; then
+			"$UX_BINDIR/ux_ctl" -D "$(node_dir "$i")" -m immediate -w stop > /dev/null 2>&1
+		fi
+	done
+
+	remove_node_interfaces
+}
+
+inject_fault()
+{
+	case "$1" in
+		kill)
+			"$UX_BINDIR/ux_ctl" -D "$(node_dir 1)" -m immediate stop > /dev/null 2>&1
+			;;
+		partition)
+			priv iptables -I INPUT -d "$(node_host 1)" -j DROP
+			priv iptables -I INPUT -s "$(node_host 1)" -j DROP
+			;;
+		nic)
+			priv ip link set "${NODE_IF_PREFIX}1" down
+			;;
+	esac
+}
+
+# print the new primary's node ID once one of the standbys has been promoted
+wait_for_promotion()
+{
+	local deadline=$(($(date +%s) + TIMEOUT))
+	local i
+
+	while [ "$(date +%s)" -lt "$deadline" ]; do
+		for i in $(seq 2 $((STANDBYS + 1))); do
+			if [ "$(node_query "$i" "SELECT NOT ux_catalog.ux_is_in_recovery()")" = "t" ]; then
+				echo "$i"
+				return 0
+			fi
+		done
+		sleep 0.1
+	done
+
+	return 1
+}
+
+# print the time from $2 until the virtual IP accepts connections to node $1
+wait_for_vip()
+{
+	local new_primary_id=$1
+	local fault_time=$2
+	local deadline=$(($(date +%s) + TIMEOUT))
+
+	while [ "$(date +%s)" -lt "$deadline" ]; do
+		if "$UX_BINDIR/uxsql" -X -q -A -t -h "$VIRTUAL_IP" -p "$(node_port "$new_primary_id")" \
+			-U repmgr -d repmgr -c "SELECT 1" > /dev/null 2>&1; then
+			echo "$(now) - $fault_time" | bc
+			return 0
+		fi
+		sleep 0.1
+	done
+
+	echo ""
+}
+
+run_round()
+{
+	local round=$1
+	local fault=$2
+	local fault_time new_primary_id promotion_lsn catchup_s vip_reachable_s
+	local trace_filter row
+
+	log "round $round: fault \"$fault\", $STANDBYS standbys"
+
+	setup_cluster
+
+	# generate some WAL so the standbys have something to catch up with
+	node_query 1 "CREATE TABLE failover_bench AS SELECT i FROM generate_series(1, 100000) i" > /dev/null
+
+	fault_time=$(now)
+	inject_fault "$fault"
+
+	new_primary_id=$(wait_for_promotion) || die "no standby was promoted within $TIMEOUT seconds"
+	promotion_lsn=$(node_query "$new_primary_id" "SELECT ux_catalog.ux_current_wal_lsn()")
+	log "node $new_primary_id promoted"
+
+	vip_reachable_s=
+	if [ -n "$VIRTUAL_IP" ]; then
+		vip_reachable_s=$(wait_for_vip "$new_primary_id" "$fault_time")
+	fi
+
+	# followers have caught up once all are streaming from the new primary past the promotion point
+	if [ "$STANDBYS" -gt 1 ]; then
+		wait_for "$new_primary_id" \
+			"SELECT count(*) = $((STANDBYS - 1)) FROM ux_catalog.ux_stat_replication WHERE replay_lsn >= '$promotion_lsn'" \
+			|| log "WARNING: followers did not catch up within $TIMEOUT seconds"
+	fi
+	catchup_s=$(echo "$(now) - $fault_time" | bc)
+
+	# repmgrd writes event records asynchronously; wait for each standby's trace
+	trace_filter="event = 'repmgrd_failover_trace' AND event_timestamp >= to_timestamp($fault_time)"
+	wait_for "$new_primary_id" "SELECT count(*) >= $STANDBYS FROM repmgr.events WHERE $trace_filter" \
+		|| log "WARNING: not all failover traces were recorded"
+
+	row=$(node_query "$new_primary_id" "
+  WITH traces AS (
+    SELECT node_id, details::json AS trace
+      FROM repmgr.events
+     WHERE $trace_filter
+  ),
+  winner AS (
+    SELECT trace->'phases' AS phases
+      FROM traces
+     WHERE node_id = $new_primary_id
+  )
+  SELECT concat_ws(',',
+         $round, '$fault', $STANDBYS, $new_primary_id,
+         (SELECT round(min((trace->>'detected_at')::numeric) - $fault_time, 3) FROM traces),
+         (SELECT round(extract(epoch FROM min(event_timestamp)) - $fault_time, 3)
+            FROM repmgr.events
+           WHERE event = 'repmgrd_failover_promote'
+             AND event_timestamp >= to_timestamp($fault_time)),
+         coalesce((SELECT phases->'election'->>'duration_ms' FROM winner), ''),
+         coalesce((SELECT phases->'promote'->>'duration_ms' FROM winner), ''),
+         coalesce((SELECT phases->'vip_bind'->>'duration_ms' FROM winner), ''),
+         '$vip_reachable_s',
+         coalesce((SELECT phases->'notify_followers'->>'duration_ms' FROM winner), ''),
+         coalesce((SELECT max((trace->'phases'->'follow'->>'duration_ms')::numeric)::text
+                     FROM traces WHERE node_id != $new_primary_id), ''),
+         round($catchup_s, 3))")
+
+	[ -n "$row" ] || die "unable to read event records from node $new_primary_id"
+
+	echo "$row" >> "$RESULTS"
+	log "$row"
+
+	if [ "$KEEP" != "1" ] || [ "$round" != "$ROUNDS" ]; then
+		teardown_cluster
+	fi
+}
+
+# print the mean of each numeric column of $1, per fault type
+summarise()
+{
+	awk -F, '
+		NR == 1 { for (i = 5; i <= NF; i++) name[i] = $i; next }
+		{
+			faults[$2] = 1
+			for (i = 5; i <= NF; i++)
+				if ($i != "") { sum[$2, i] += $i; n[$2, i]++ }
+			ncol = NF
+		}
+		END {
+			for (f in faults)
+				for (i = 5; i <= ncol; i++)
+					if (n[f, i] > 0)
+						printf "%s,%s,%.3f\n", f, name[i], sum[f, i] / n[f, i]
+		}' "$1" | sort
+}
+
+# compare the means of $RESULTS against those of $BASELINE; return 1 on regression
+compare_baseline()
+{
+	local regressions
+
+	regressions=$(join -t, -j1 \
+		<(summarise "$BASELINE" | awk -F, '{ print $1 ":" $2 "," $3 }' | sort -t, -k1,1) \
+		<(summarise "$RESULTS" | awk -F, '{ print $1 ":" $2 "," $3 }' | sort -t, -k1,1) |
+		awk -F, -v threshold="$THRESHOLD" '
+			{
+				change = ($2 > 0) ? ($3 - $2) * 100 / $2 : 0
+				flag = (change > threshold) ? "REGRESSION" : "ok"
+				printf "  %-32s baseline %10.3f  current %10.3f  %+7.1f%%  %s\n", $1, $2, $3, change, flag
+			}')
+
+	echo "$regressions"
+
+	if echo "$regressions" | grep -q REGRESSION; then
+		return 1
+	fi
+
+	return 0
+}
+
+while getopts "b:B:R:n:r:f:p:o:c:t:T:a:i:v:kh" opt; do
+	case "$opt" in
+		b) BENCH_DIR=$OPTARG ;;
+		B) UX_BINDIR=$OPTARG ;;
+		R) REPMGR_BINDIR=$OPTARG ;;
+		n) STANDBYS=$OPTARG ;;
+		r) ROUNDS=$OPTARG ;;
+		f) FAULTS=$OPTARG ;;
+		p) BASE_PORT=$OPTARG ;;
+		o) RESULTS=$OPTARG ;;
+		c) BASELINE=$OPTARG ;;
+		t) THRESHOLD=$OPTARG ;;
+		T) TIMEOUT=$OPTARG ;;
+		a) RECONNECT_ATTEMPTS=$OPTARG ;;
+		i) RECONNECT_INTERVAL=$OPTARG ;;
+		v) VIRTUAL_IP=$OPTARG ;;
+		k) KEEP=1 ;;
+		h) usage; exit 0 ;;
+		*) usage; exit 1 ;;
+	esac
+done
+
+if [ -z "$UX_BINDIR" ]; then
+	UX_BINDIR=$(ux_config --bindir 2>/dev/null) || { echo "unable to determine UXsinoDB binary directory, use -B" >&2; exit 1; }
+fi
+
+[ -n "$REPMGR_BINDIR" ] || REPMGR_BINDIR=$UX_BINDIR
+[ -n "$RESULTS" ] || RESULTS=$BENCH_DIR/results.csv
+
+for binary in "$UX_BINDIR/initdb" "$UX_BINDIR/ux_ctl" "$UX_BINDIR/uxsql" "$REPMGR_BINDIR/repmgr" "$REPMGR_BINDIR/repmgrd"; do
+	[ -x "$binary" ] || { echo "\"$binary\" not found" >&2; exit 1; }
+done
+
+command -v bc > /dev/null || { echo "\"bc\" is required" >&2; exit 1; }
+
+if [ "$STANDBYS" -lt 1 ]; then
+	echo "at least one standby is required" >&2
+	exit 1
+fi
+
+USE_NODE_IFS=0
+for fault in ${FAULTS//,/ }; do
+	case "$fault" in
+		kill) ;;
+		partition|nic) USE_NODE_IFS=1 ;;
+		*) echo "unknown fault \"$fault\"" >&2; exit 1 ;;
+	esac
+done
+
+if [ "$(id -u)" = "0" ]; then
+	echo "run this script as an unprivileged user; \"partition\" and \"nic\" use sudo where needed" >&2
+	exit 1
+fi
+
+if [ "$USE_NODE_IFS" = "1" ] && ! sudo -n true 2>/dev/null; then
+	echo "faults \"partition\" and \"nic\" require passwordless sudo" >&2
+	exit 1
+fi
+
+if [ -n "$VIRTUAL_IP" ]; then
+	if [ "$USE_NODE_IFS" != "1" ]; then
+		echo "-v requires fault \"partition\" or \"nic\"" >&2
+		exit 1
+	fi
+
+	# ux_hba.conf only admits $NODE_NET.0/24, and the node addresses are taken
+	vip_host=${VIRTUAL_IP##*.}
+	if [ "${VIRTUAL_IP%.*}" != "$NODE_NET" ] \
+		|| ! [[ "$vip_host" =~ ^[0-9]+$ ]] \
+		|| [ "$vip_host" -le $((STANDBYS + 1)) ] || [ "$vip_host" -ge 255 ]; then
+		echo "virtual IP must be in $NODE_NET.$((STANDBYS + 2))-$NODE_NET.254" >&2
+		exit 1
+	fi
+fi
+
+trap 'teardown_cluster; exit 1' INT TERM
+
+mkdir -p "$BENCH_DIR"
+[ -s "$RESULTS" ] || echo "$CSV_HEADER" > "$RESULTS"
+
+for fault in ${FAULTS//,/ }; do
+	for round in $(seq 1 "$ROUNDS"); do
+		run_round "$round" "$fault"
+	done
+done
+
+echo
+echo "Mean values (results in $RESULTS):"
+summarise "$RESULTS" | awk -F, '{ printf "  %-10s %-16s %10.3f\n", $1, $2, $3 }'
+
+if [ -n "$BASELINE" ]; then
+	echo
+	echo "Comparison against baseline $BASELINE (threshold ${THRESHOLD}%):"
+	compare_baseline || exit 2
+fi
+
+exit 0
@@ -26,14 +26,41 @@
 
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 #include "uxdb_fe.h"
+#include "port/ux_crc32c.h"
 
 #include "repmgr.h"
 #include "controldata.h"
 
-static ControlFileInfo *get_controlfile(const char *DataDir);
+/* number of times to re-read a control file whose CRC does not match */
+#define CONTROLFILE_READ_RETRIES	3
+
+/*
+ * Snapshot of the most recently read control file. It's considered current
+ * until the watch on the data directory's "global" subdirectory reports
+ * any change; without inotify, it's never considered current.
+ */
+static ControlFileInfo controlfile_snapshot;
+static char controlfile_snapshot_datadir[MAXUXPATH] = "";
+static bool controlfile_snapshot_valid = false;
+static bool controlfile_crc_warning_emitted = false;
+
+#ifdef __linux__
+static int	controlfile_watch_fd = -1;
+static int	controlfile_watch_wd = -1;
+#endif
+
+static bool controlfile_snapshot_is_current(const char *DataDir);
+static void watch_controlfile(const char *DataDir);
+static bool load_controlfile(const char *DataDir, ControlFileInfo *control_file_info);
 
 int
 get_ux_version(const char *data_directory, char *version_string)
@@ -85,69 +112,48 @@ get_ux_version(const char *data_directory, char *version_string)
 uint64
 get_system_identifier(const char *data_directory)
 {
-	ControlFileInfo *control_file_info = NULL;
-	uint64		system_identifier = UNKNOWN_SYSTEM_IDENTIFIER;
-
-	control_file_info = get_controlfile(data_directory);
+	const ControlFileInfo *control_file_info = get_controlfile_snapshot(data_directory);
 
-	if (control_file_info->control_file_processed == true)
-		system_identifier = control_file_info->system_identifier;
-
-	pfree(control_file_info);
+	if (control_file_info->control_file_processed == false)
+		return UNKNOWN_SYSTEM_IDENTIFIER;
 
-	return system_identifier;
+	return control_file_info->system_identifier;
 }
 
 
 bool
 get_db_state(const char *data_directory, DBState *state)
 {
-	ControlFileInfo *control_file_info = NULL;
-	bool control_file_processed;
+	const ControlFileInfo *control_file_info = get_controlfile_snapshot(data_directory);
 
-	control_file_info = get_controlfile(data_directory);
-	control_file_processed = control_file_info->control_file_processed;
-
-	if (control_file_processed == true)
+	if (control_file_info->control_file_processed == true)
 		*state = control_file_info->state;
 
-	pfree(control_file_info);
-
-	return control_file_processed;
+	return control_file_info->control_file_processed;
 }
 
 
 XLogRecPtr
 get_latest_checkpoint_location(const char *data_directory)
 {
-	ControlFileInfo *control_file_info = NULL;
-	XLogRecPtr	checkPoint = InvalidXLogRecPtr;
-
-	control_file_info = get_controlfile(data_directory);
-
-	if (control_file_info->control_file_processed == true)
-		checkPoint = control_file_info->checkPoint;
+	const ControlFileInfo *control_file_info = get_controlfile_snapshot(data_directory);
 
-	pfree(control_file_info);
+	if (control_file_info->control_file_processed == false)
+		return InvalidXLogRecPtr;
 
-	return checkPoint;
+	return control_file_info->checkPoint;
 }
 
 
 int
 get_data_checksum_version(const char *data_directory)
 {
-	ControlFileInfo *control_file_info = NULL;
-	int			data_checksum_version = UNKNOWN_DATA_CHECKSUM_VERSION;
-
-	control_file_info = get_controlfile(data_directory);
-
-	if (control_file_info->control_file_processed == true)
-		data_checksum_version = (int) control_file_info->data_checksum_version;
+	const ControlFileInfo *control_file_info = get_controlfile_snapshot(data_directory);
 
-	pfree(control_file_info);
+	if (control_file_info->control_file_processed == false)
+		return UNKNOWN_DATA_CHECKSUM_VERSION;
 
-	return data_checksum_version;
+	return (int) control_file_info->data_checksum_version;
 }
 
 
@@ -179,66 +185,206 @@ describe_db_state(DBState state)
 TimeLineID
 get_timeline(const char *data_directory)
 {
-	ControlFileInfo *control_file_info = NULL;
-	TimeLineID		 timeline = -1;
+	return get_controlfile_snapshot(data_directory)->timeline;
+}
 
-	control_file_info = get_controlfile(data_directory);
 
-	timeline = (int) control_file_info->timeline;
+TimeLineID
+get_min_recovery_end_timeline(const char *data_directory)
+{
+	return get_controlfile_snapshot(data_directory)->minRecoveryPointTLI;
+}
 
-	pfree(control_file_info);
 
-	return timeline;
+XLogRecPtr
+get_min_recovery_location(const char *data_directory)
+{
+	return get_controlfile_snapshot(data_directory)->minRecoveryPoint;
 }
 
 
-TimeLineID
-get_min_recovery_end_timeline(const char *data_directory)
+/*
+ * Return a snapshot of the control file in the specified data directory.
+ *
+ * Callers needing several fields should use this rather than the individual
+ * accessors, so all values come from the same read of the file.
+ *
+ * The returned struct is owned by this module and is only valid until the
+ * next call to this function or any of the accessors above.
+ * "control_file_processed" is false if the file could not be read, in
+ * which case all other fields contain the default values set by
+ * load_controlfile().
+ */
+const ControlFileInfo *
+get_controlfile_snapshot(const char *data_directory)
 {
-	ControlFileInfo *control_file_info = NULL;
-	TimeLineID		 timeline = -1;
+	if (controlfile_snapshot_is_current(data_directory) == true)
+		return &controlfile_snapshot;
+
+	/* set up the watch first, so changes made while we read aren't missed */
+	watch_controlfile(data_directory);
+
+	controlfile_snapshot_valid = load_controlfile(data_directory, &controlfile_snapshot);
+	strncpy(controlfile_snapshot_datadir, data_directory, MAXUXPATH - 1);
+
+	return &controlfile_snapshot;
+}
 
-	control_file_info = get_controlfile(data_directory);
 
-	timeline = (int) control_file_info->minRecoveryPointTLI;
+/*
+ * Wait up to "timeout_ms" milliseconds for the control file in the specified
+ * data directory to change, returning early as soon as the watch set up by
+ * get_controlfile_snapshot() reports an event. Pending events are left for
+ * controlfile_snapshot_is_current() to consume, so the next snapshot will
+ * be read afresh.
+ *
+ * Returns true if a change was detected; without a watch on the directory
+ * this simply sleeps for the full interval and returns false.
+ */
+bool
+wait_for_controlfile_change(const char *data_directory, int timeout_ms)
+{
+#ifdef __linux__
+	if (controlfile_watch_wd != -1 &&
+		strncmp(controlfile_snapshot_datadir, data_directory, MAXUXPATH) == 0)
+	{
+		struct pollfd pfd;
+		int			ret;
 
-	pfree(control_file_info);
+		pfd.fd = controlfile_watch_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
 
-	return timeline;
+		ret = poll(&pfd, 1, timeout_ms);
+
+		if (ret > 0)
+			return true;
+
+		if (ret == 0 || errno == EINTR)
+			return false;
+
+		log_debug("wait_for_controlfile_change(): %s", strerror(errno));
+	}
+#endif
+
+	usleep(timeout_ms * 1000);
+
+	return false;
 }
 
 
-XLogRecPtr
-get_min_recovery_location(const char *data_directory)
+/*
+ * Determine whether the cached snapshot still reflects the control file
+ * in the specified data directory; any pending inotify event for the
+ * directory containing it means it may have changed.
+ */
+static bool
+controlfile_snapshot_is_current(const char *DataDir)
+{
+#ifdef __linux__
+	char		buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool		changed = false;
+
+	if (controlfile_snapshot_valid == false || controlfile_watch_wd == -1)
+		return false;
+
+	if (strncmp(controlfile_snapshot_datadir, DataDir, MAXUXPATH) != 0)
+		return false;
+
+	for (;;)
+	{
+		ssize_t		len = read(controlfile_watch_fd, buf, sizeof(buf));
+
+		if (len > 0)
+		{
+			changed = true;
+			continue;
+		}
+
+		/* EAGAIN means the queue has been drained; anything else is unexpected */
+		if (len == -1 && errno != EAGAIN)
+		{
+			log_debug("controlfile_snapshot_is_current(): %s", strerror(errno));
+			changed = true;
+		}
+
+		break;
+	}
+
+	return !changed;
+#else
+	return false;
+#endif
+}
+
+
+/*
+ * Watch the "global" subdirectory of the specified data directory, rather
+ * than ux_control itself, so we also notice if the file is replaced or
+ * the whole data directory is removed.
+ */
+static void
+watch_controlfile(const char *DataDir)
 {
-	ControlFileInfo *control_file_info = NULL;
-	XLogRecPtr	minRecoveryPoint  = InvalidXLogRecPtr;
+#ifdef __linux__
+	char		global_dir[MAXUXPATH] = "";
 
-	control_file_info = get_controlfile(data_directory);
+	if (controlfile_watch_fd == -1)
+	{
+		controlfile_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (controlfile_watch_fd == -1)
+		{
+			log_debug("watch_controlfile(): unable to initialise inotify: %s",
+					  strerror(errno));
+			return;
+		}
+	}
 
-	minRecoveryPoint = control_file_info->minRecoveryPoint;
+	/* may fail harmlessly if the watch was already dropped by the kernel */
+	if (controlfile_watch_wd != -1)
+		(void) inotify_rm_watch(controlfile_watch_fd, controlfile_watch_wd);
 
-	pfree(control_file_info);
+	snprintf(global_dir, MAXUXPATH, "%s/global", DataDir);
 
-	return minRecoveryPoint;
+	controlfile_watch_wd = inotify_add_watch(controlfile_watch_fd, global_dir,
+											 IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+											 IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+											 IN_DELETE_SELF | IN_MOVE_SELF);
+
+	if (controlfile_watch_wd == -1)
+	{
+		log_debug("watch_controlfile(): unable to watch \"%s\": %s",
+				  global_dir, strerror(errno));
+	}
+#endif
 }
 
 
 /*
  * We maintain our own version of get_controlfile() as we need cross-version
  * compatibility, and also don't care if the file isn't readable.
+ *
+ * The file is mapped rather than read; its contents are copied out
+ * immediately, as a mapping left in place would fault if the file were
+ * later truncated or replaced.
+ *
+ * Returns true if the file was read and (where the layout allows) the CRC
+ * verified, i.e. the contents can be cached.
  */
-static ControlFileInfo *
-get_controlfile(const char *DataDir)
+static bool
+load_controlfile(const char *DataDir, ControlFileInfo *control_file_info)
 {
 	char		file_version_string[MAX_VERSION_STRING] = "";
-	ControlFileInfo *control_file_info;
 	int			fd, version_num;
 	char		ControlFilePath[MAXUXPATH] = "";
 	void	   *ControlFileDataPtr = NULL;
+	void	   *mapped = NULL;
 	int			expected_size = 0;
+	struct stat statbuf;
+	bool		crc_ok = true;
 
-	control_file_info = palloc0(sizeof(ControlFileInfo));
+	memset(control_file_info, 0, sizeof(ControlFileInfo));
 
 	/* set default values */
 	control_file_info->control_file_processed = false;
@@ -260,7 +406,7 @@ get_controlfile(const char *DataDir)
 	if (version_num == UNKNOWN_SERVER_VERSION_NUM)
 	{
 		log_warning(_("unable to determine server version number from UX_VERSION"));
-		return control_file_info;
+		return false;
 	}
 
 	if (version_num < MIN_SUPPORTED_VERSION_NUM)
@@ -269,7 +415,7 @@ get_controlfile(const char *DataDir)
 					file_version_string);
 		log_detail(_("minimum supported UXsinoDB version is %s"),
 				   MIN_SUPPORTED_VERSION);
-		return control_file_info;
+		return false;
 	}
 
 	snprintf(ControlFilePath, MAXUXPATH, "%s/global/ux_control", DataDir);
@@ -279,43 +425,88 @@ get_controlfile(const char *DataDir)
 		log_warning(_("could not open file \"%s\" for reading"),
 					ControlFilePath);
 		log_detail("%s", strerror(errno));
-		return control_file_info;
+		return false;
 	}
 
 	if (version_num >= 120000)
-	{
 		expected_size = sizeof(ControlFileData12);
-		ControlFileDataPtr = palloc0(expected_size);
-	}
 	else if (version_num >= 110000)
-	{
 		expected_size = sizeof(ControlFileData11);
-		ControlFileDataPtr = palloc0(expected_size);
-	}
 	else if (version_num >= 90500)
-	{
 		expected_size = sizeof(ControlFileData95);
-		ControlFileDataPtr = palloc0(expected_size);
-	}
-	else if (version_num >= 90400)
-	{
+	else
 		expected_size = sizeof(ControlFileData94);
-		ControlFileDataPtr = palloc0(expected_size);
-	}
 
-	if (read(fd, ControlFileDataPtr, expected_size) != expected_size)
+	if (fstat(fd, &statbuf) == -1 || statbuf.st_size < expected_size)
 	{
 		log_warning(_("could not read file \"%s\""),
 					ControlFilePath);
-		log_detail("%s", strerror(errno));
+		log_detail(_("file is smaller than the expected %i bytes"), expected_size);
 
 		close(fd);
 
-		return control_file_info;
+		return false;
 	}
 
+	mapped = mmap(NULL, expected_size, PROT_READ, MAP_SHARED, fd, 0);
+
 	close(fd);
 
+	if (mapped == MAP_FAILED)
+	{
+		log_warning(_("could not map file \"%s\""),
+					ControlFilePath);
+		log_detail("%s", strerror(errno));
+
+		return false;
+	}
+
+	ControlFileDataPtr = palloc0(expected_size);
+	memcpy(ControlFileDataPtr, mapped, expected_size);
+
+	/*
+	 * We can only check the CRC for the ControlFileData12 layout, which is
+	 * the only one which includes it. As we copy the file while the server
+	 * may be writing it, a mismatch may just mean a torn read, so try again
+	 * a few times before giving up.
+	 */
+	if (version_num >= 120000)
+	{
+		int			i;
+
+		for (i = 0; i < CONTROLFILE_READ_RETRIES; i++)
+		{
+			ControlFileData12 *ptr = (struct ControlFileData12 *)ControlFileDataPtr;
+			ux_crc32c	crc;
+
+			INIT_CRC32C(crc);
+			COMP_CRC32C(crc, (char *) ptr, offsetof(ControlFileData12, crc));
+			FIN_CRC32C(crc);
+
+			crc_ok = EQ_CRC32C(crc, ptr->crc);
+
+			if (crc_ok == true)
+				break;
+
+			memcpy(ControlFileDataPtr, mapped, expected_size);
+		}
+	}
+
+	munmap(mapped, expected_size);
+
+	/*
+	 * A persistent mismatch may be due to the file coming from a different
+	 * UXsinoDB version to the one repmgr was compiled against, so use the
+	 * contents as before, but don't cache them.
+	 */
+	if (crc_ok == false && controlfile_crc_warning_emitted == false)
+	{
+		log_warning(_("calculated CRC checksum does not match value stored in file \"%s\""),
+					ControlFilePath);
+		log_detail(_("control file contents will be reread on each access"));
+		controlfile_crc_warning_emitted = true;
+	}
+
 	control_file_info->control_file_processed = true;
 
 	if (version_num >= 120000)
@@ -365,11 +556,5 @@ get_controlfile(const char *DataDir)
 
 	pfree(ControlFileDataPtr);
 
-	/*
-	 * We don't check the CRC here as we're potentially checking a ux_control
-	 * file from a different UXsinoDB version to the one repmgr was compiled
-	 * against.
-	 */
-
-	return control_file_info;
+	return crc_ok;
 }
@@ -412,6 +412,8 @@ typedef struct ControlFileData12
 } ControlFileData12;
 
 extern int get_ux_version(const char *data_directory, char *version_string);
+extern const ControlFileInfo *get_controlfile_snapshot(const char *data_directory);
+extern bool wait_for_controlfile_change(const char *data_directory, int timeout_ms);
 extern bool get_db_state(const char *data_directory, DBState *state);
 extern const char *describe_db_state(DBState state);
 extern int	get_data_checksum_version(const char *data_directory);
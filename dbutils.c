@@ -26,20 +26,120 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <arpa/inet.h>
+#include <poll.h>
 
 #include "repmgr.h"
 #include "repmgrd.h"
 #include "dbutils.h"
 #include "controldata.h"
 #include "dirutil.h"
+#include "eventqueue.h"
+#include "vip.h"
 
 #define NODE_RECORD_PARAM_COUNT 13
 
+/* state of an individual connection attempt in establish_node_connections_quiet() */
+typedef struct
+{
+	t_node_info *node_info;
+	UXSQLPollingStatusType poll_status;
+	bool		is_replication_connection;
+	bool		already_connected;
+	int			timeout_ms;
+	instr_time	start_time;
+} t_async_connection;
+
+/*
+ * Queries executed on every monitoring cycle are registered as server-side
+ * prepared statements the first time they're used on a connection, which
+ * saves the server parsing and planning them again each time.
+ *
+ * Which statements have been prepared on which connection is tracked here,
+ * together with the backend PID so that a connection which has been reset
+ * (and has therefore lost its prepared statements) can be detected.
+ */
+typedef enum
+{
+	PREPARED_RECOVERY_TYPE = 0,
+	PREPARED_PING,
+	PREPARED_PRIMARY_CURRENT_LSN,
+	PREPARED_LAST_WAL_RECEIVE_LSN,
+	PREPARED_NODE_CURRENT_LSN,
+	PREPARED_REPLICATION_INFO,
+	PREPARED_REPLICATION_INFO_WITNESS,
+	PREPARED_REPLICATION_SNAPSHOT,
+	PREPARED_STANDBY_STATUS,
+	PREPARED_PRIMARY_STATUS,
+	PREPARED_STATEMENT_COUNT
+} PreparedStatement;
+
+static const char *prepared_statement_names[PREPARED_STATEMENT_COUNT] = {
+	"repmgr_recovery_type",
+	"repmgr_ping",
+	"repmgr_primary_current_lsn",
+	"repmgr_last_wal_receive_lsn",
+	"repmgr_node_current_lsn",
+	"repmgr_replication_info",
+	"repmgr_replication_info_witness",
+	"repmgr_replication_snapshot",
+	"repmgr_standby_status",
+	"repmgr_primary_status"
+};
+
+#define PREPARED_STATEMENT_MAX_CONNS 32
+
+typedef struct
+{
+	UXconn	   *conn;
+	int			backend_pid;
+	uint32		prepared;
+} t_prepared_statement_conn;
+
+static t_prepared_statement_conn prepared_statement_conns[PREPARED_STATEMENT_MAX_CONNS];
+static int	prepared_statement_conns_next = 0;
+
+/*
+ * A timeline history file never changes once the timeline has been
+ * created, so the switchpoints read from them are kept for the lifetime
+ * of the process. Each file also lists the switchpoints of all preceding
+ * timelines on its path, so one TIMELINE_HISTORY command populates the
+ * entries for all of those timelines' history files too.
+ *
+ * Entries are keyed by system identifier and the timeline whose history
+ * file they were (or would be) read from.
+ */
+#define TIMELINE_HISTORY_CACHE_SIZE 64
+
+/* period over which _build_catchup_info_query() measures the replay rate */
+#define CATCHUP_REPLAY_RATE_WINDOW_SECS 60
+
+typedef struct
+{
+	uint64		system_identifier;
+	TimeLineID	tli;
+	TimeLineID	parent_tli;
+	XLogRecPtr	switchpoint;
+} t_timeline_history_cache_entry;
+
+static t_timeline_history_cache_entry timeline_history_cache[TIMELINE_HISTORY_CACHE_SIZE];
+static int	timeline_history_cache_entries = 0;
+static int	timeline_history_cache_next = 0;
+
 static void log_db_error(UXconn *conn, const char *query_text, const char *fmt,...)
 __attribute__((format(UX_PRINTF_ATTRIBUTE, 3, 4)));
 
 static bool _is_server_available(const char *conninfo, bool quiet);
 
+static char *_prepare_connection_string(const char *conninfo, t_conninfo_param_list *conninfo_params, bool *is_replication_connection, int *connect_timeout);
+
+static int	_establish_node_connections(NodeInfoList *node_list, int timeout_ms);
+
+static void _build_replication_info_query(UXconn *conn, t_server_type node_type, UXSQLExpBufferData *query);
+static void _build_node_current_lsn_query(UXconn *conn, UXSQLExpBufferData *query);
+static void _parse_replication_info(UXresult *res, ReplInfo *replication_info);
+static void _build_catchup_info_query(UXSQLExpBufferData *query);
+static void _parse_catchup_info(UXresult *res, t_catchup_info *catchup_info);
+
 static UXconn *_establish_db_connection(const char *conninfo,
 						 const bool exit_on_error,
 						 const bool log_notice,
@@ -49,24 +149,46 @@ static UXconn * _establish_replication_connection_from_params(UXconn *conn, cons
 
 static UXconn *_get_primary_connection(UXconn *standby_conn, int *primary_id, char *primary_conninfo_out, bool quiet);
 
+static t_prepared_statement_conn *_get_prepared_statement_conn(UXconn *conn);
+static void _forget_prepared_statements(UXconn *conn);
+static void _build_prepared_statement_query(UXconn *conn, PreparedStatement statement, UXSQLExpBufferData *query);
+static UXresult *_prepare_statement(UXconn *conn, PreparedStatement statement, int nParams);
+static UXresult *_exec_prepared_statement(UXconn *conn, PreparedStatement statement, int nParams, const char *const *paramValues, int resultFormat);
+static bool _send_prepared_statement(UXconn *conn, PreparedStatement statement, int nParams, const char *const *paramValues, int resultFormat);
+static UXresult *_get_prepared_statement_result(UXconn *conn, PreparedStatement statement);
+static void _check_prepared_statement_result(UXconn *conn, PreparedStatement statement, UXresult *res);
+static int	_lsn_result_format(UXconn *conn);
+static XLogRecPtr _parse_lsn_result(UXconn *conn, UXresult *res, int row, int column);
+
+static t_timeline_history_cache_entry *_get_cached_timeline_history(uint64 system_identifier, TimeLineID tli);
+static void _cache_timeline_history(uint64 system_identifier, TimeLineID tli, TimeLineID parent_tli, XLogRecPtr switchpoint);
+
 static bool _set_config(UXconn *conn, const char *config_param, const char *sqlquery);
-static bool _get_ux_setting(UXconn *conn, const char *setting, char *str_output, bool *bool_output, int *int_output);
+static bool _get_ux_setting(UXconn *conn, const char *setting, char *str_output, UXSQLExpBufferData *buf_output, bool *bool_output, int *int_output);
 
 static RecordStatus _get_node_record(UXconn *conn, char *sqlquery, t_node_info *node_info, bool init_defaults);
 static void _populate_node_record(UXresult *res, t_node_info *node_info, int row, bool init_defaults);
 
 static void _populate_node_records(UXresult *res, NodeInfoList *node_list);
+static bool _witness_sync_node_records(UXconn *primary_conn, UXconn *witness_conn);
+static bool _witness_copy_all_node_records(UXconn *primary_conn, UXconn *witness_conn);
 
 static bool _create_update_node_record(UXconn *conn, char *action, t_node_info *node_info);
 
-static ReplSlotStatus _verify_replication_slot(UXconn *conn, char *slot_name, UXSQLExpBufferData *error_msg);
+static ReplSlotStatus _verify_replication_slot(UXconn *conn, const char *slot_name, UXSQLExpBufferData *error_msg);
 
 static bool _create_event(UXconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details, t_event_info *event_info, bool send_notification);
 
 static NodeAttached _is_downstream_node_attached(UXconn *conn, char *node_name, char **node_state, bool quiet);
+static unsigned int replication_stat_hash(const char *application_name);
 
-static bool is_exist_bind_virtual_ip(const char *vip, const char *network_card);
-static void arping_virtual_ip(void);
+static bool is_exist_bind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
+static void arping_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
+static bool _virtual_ip_command(const char *action, const char *vip, const char *network_card, const char *uxdb_passwd);
+static bool _bind_single_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
+static bool _unbind_single_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
+static bool _for_each_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd,
+								 bool (*func) (const char *vip, const char *network_card, const char *uxdb_passwd));
 
 /*
  * This provides a standardized way of logging database errors. Note
@@ -130,40 +252,59 @@ parse_lsn(const char *str)
  *	 establish_db_connection_by_params()
  */
 
-static UXconn *
-_establish_db_connection(const char *conninfo, const bool exit_on_error, const bool log_notice, const bool verbose_only)
+/*
+ * Parse the provided conninfo string and add the default parameters
+ * repmgr expects to be set; returns a palloc'd connection string,
+ * or NULL if the conninfo string could not be parsed.
+ */
+static char *
+_prepare_connection_string(const char *conninfo, t_conninfo_param_list *conninfo_params, bool *is_replication_connection, int *connect_timeout)
 {
-	UXconn	   *conn = NULL;
-	char	   *connection_string = NULL;
 	char	   *errmsg = NULL;
+	char	   *connect_timeout_str = NULL;
 
-	t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
-	bool		is_replication_connection = false;
-	bool		parse_success = false;
-
-	initialize_conninfo_params(&conninfo_params, false);
-
-	parse_success = parse_conninfo_string(conninfo, &conninfo_params, &errmsg, false);
+	initialize_conninfo_params(conninfo_params, false);
 
-	if (parse_success == false)
+	if (parse_conninfo_string(conninfo, conninfo_params, &errmsg, false) == false)
 	{
 		log_error(_("unable to parse provided conninfo string \"%s\""), conninfo);
 		log_detail("%s", errmsg);
-		free_conninfo_params(&conninfo_params);
+		free_conninfo_params(conninfo_params);
 		return NULL;
 	}
 
 	/* set some default values if not explicitly provided */
-	param_set_ine(&conninfo_params, "connect_timeout", "2");
-	param_set_ine(&conninfo_params, "fallback_application_name", "repmgr");
+	param_set_ine(conninfo_params, "connect_timeout", "2");
+	param_set_ine(conninfo_params, "fallback_application_name", "repmgr");
+
+	*is_replication_connection = (param_get(conninfo_params, "replication") != NULL);
 
-	if (param_get(&conninfo_params, "replication") != NULL)
-		is_replication_connection = true;
+	if (connect_timeout != NULL)
+	{
+		connect_timeout_str = param_get(conninfo_params, "connect_timeout");
+		*connect_timeout = (connect_timeout_str != NULL) ? atoi(connect_timeout_str) : 0;
+	}
 
 	/* use a secure search_path */
-	param_set(&conninfo_params, "options", "-csearch_path=");
+	param_set(conninfo_params, "options", "-csearch_path=");
+
+	return param_list_to_string(conninfo_params);
+}
+
+
+static UXconn *
+_establish_db_connection(const char *conninfo, const bool exit_on_error, const bool log_notice, const bool verbose_only)
+{
+	UXconn	   *conn = NULL;
+	char	   *connection_string = NULL;
+
+	t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
+	bool		is_replication_connection = false;
 
-	connection_string = param_list_to_string(&conninfo_params);
+	connection_string = _prepare_connection_string(conninfo, &conninfo_params, &is_replication_connection, NULL);
+
+	if (connection_string == NULL)
+		return NULL;
 
 	log_debug(_("connecting to: \"%s\""), connection_string);
 
@@ -246,6 +387,240 @@ establish_db_connection_quiet(const char *conninfo)
 }
 
 
+/*
+ * Attempt to connect to all nodes in the provided list concurrently,
+ * storing each connection handle in the node's "conn" field.
+ *
+ * See _establish_node_connections() for details.
+ */
+int
+establish_node_connections_quiet(NodeInfoList *node_list)
+{
+	return _establish_node_connections(node_list, -1);
+}
+
+
+/*
+ * As establish_node_connections_quiet(), but no connection attempt will
+ * take longer than "timeout_ms" milliseconds, regardless of the value of
+ * "connect_timeout" in the node's conninfo string.
+ */
+int
+establish_node_connections_timeout(NodeInfoList *node_list, int timeout_ms)
+{
+	return _establish_node_connections(node_list, timeout_ms);
+}
+
+
+/*
+ * Attempt to connect to all nodes in the provided list concurrently,
+ * storing each connection handle in the node's "conn" field.
+ *
+ * All connection attempts are started at once with UXSQLconnectStart()
+ * and advanced with UXSQLconnectPoll() as their sockets become ready, so
+ * the total time taken is that of the slowest node rather than the sum
+ * of all nodes; this matters when one or more nodes are unreachable and
+ * each attempt would otherwise wait for the full "connect_timeout".
+ *
+ * As with establish_db_connection_quiet(), errors are only logged if
+ * --verbose is in use; the caller must check each connection's status
+ * with UXSQLstatus() and close it with UXSQLfinish(). A connection which
+ * did not complete within its "connect_timeout" is left in a non-OK
+ * state with an empty error message.
+ *
+ * If "timeout_ms" is greater than zero, it is used as an upper limit
+ * for each attempt's "connect_timeout".
+ *
+ * Nodes which already have an open connection are left untouched, and
+ * counted as successful connections.
+ *
+ * Returns the number of successful connections.
+ */
+static int
+_establish_node_connections(NodeInfoList *node_list, int timeout_ms)
+{
+	NodeInfoListCell *cell = NULL;
+	t_async_connection *attempts = NULL;
+	struct pollfd *pollfds = NULL;
+	int		   *pollfd_ix = NULL;
+	int			attempt_count = 0;
+	int			pending = 0;
+	int			connected = 0;
+	int			i;
+
+	if (node_list->node_count <= 0)
+		return 0;
+
+	attempts = palloc0(sizeof(t_async_connection) * node_list->node_count);
+	pollfds = palloc0(sizeof(struct pollfd) * node_list->node_count);
+	pollfd_ix = palloc0(sizeof(int) * node_list->node_count);
+
+	/* start all connection attempts */
+	for (cell = node_list->head; cell; cell = cell->next)
+	{
+		t_async_connection *attempt = &attempts[attempt_count++];
+		t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
+		char	   *connection_string = NULL;
+		int			connect_timeout = 0;
+
+		attempt->node_info = cell->node_info;
+		attempt->poll_status = UXRES_POLLING_FAILED;
+
+		if (cell->node_info->conn != NULL && UXSQLstatus(cell->node_info->conn) == CONNECTION_OK)
+		{
+			attempt->already_connected = true;
+			continue;
+		}
+
+		connection_string = _prepare_connection_string(cell->node_info->conninfo,
+													   &conninfo_params,
+													   &attempt->is_replication_connection,
+													   &connect_timeout);
+
+		if (connection_string == NULL)
+		{
+			cell->node_info->conn = NULL;
+			continue;
+		}
+
+		log_debug(_("connecting (asynchronously) to: \"%s\""), connection_string);
+
+		cell->node_info->conn = UXSQLconnectStart(connection_string);
+
+		pfree(connection_string);
+		free_conninfo_params(&conninfo_params);
+
+		if (cell->node_info->conn == NULL || UXSQLstatus(cell->node_info->conn) == CONNECTION_BAD)
+			continue;
+
+		INSTR_TIME_SET_CURRENT(attempt->start_time);
+		attempt->timeout_ms = connect_timeout > 0 ? connect_timeout * 1000 : -1;
+
+		if (timeout_ms > 0 && (attempt->timeout_ms == -1 || attempt->timeout_ms > timeout_ms))
+			attempt->timeout_ms = timeout_ms;
+
+		/* as per libpq documentation, behave as if the last poll returned "writing" */
+		attempt->poll_status = UXRES_POLLING_WRITING;
+		pending++;
+	}
+
+	while (pending > 0)
+	{
+		int			nfds = 0;
+		int			poll_timeout = -1;
+		int			ret;
+
+		for (i = 0; i < attempt_count; i++)
+		{
+			t_async_connection *attempt = &attempts[i];
+
+			if (attempt->poll_status != UXRES_POLLING_READING &&
+				attempt->poll_status != UXRES_POLLING_WRITING)
+				continue;
+
+			if (attempt->timeout_ms > 0)
+			{
+				instr_time	elapsed;
+				int			remaining_ms;
+
+				INSTR_TIME_SET_CURRENT(elapsed);
+				INSTR_TIME_SUBTRACT(elapsed, attempt->start_time);
+				remaining_ms = attempt->timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+				if (remaining_ms <= 0)
+				{
+					log_verbose(LOG_DEBUG, "connection attempt to node \"%s\" (ID: %i) timed out",
+								attempt->node_info->node_name,
+								attempt->node_info->node_id);
+					attempt->poll_status = UXRES_POLLING_FAILED;
+					pending--;
+					continue;
+				}
+
+				if (poll_timeout == -1 || remaining_ms < poll_timeout)
+					poll_timeout = remaining_ms;
+			}
+
+			pollfds[nfds].fd = UXSQLsocket(attempt->node_info->conn);
+			pollfds[nfds].events = (attempt->poll_status == UXRES_POLLING_READING) ? POLLIN : POLLOUT;
+			pollfds[nfds].revents = 0;
+			pollfd_ix[nfds] = i;
+			nfds++;
+		}
+
+		if (nfds == 0)
+			break;
+
+		ret = poll(pollfds, nfds, poll_timeout);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_error(_("unable to poll database connections"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_async_connection *attempt = &attempts[pollfd_ix[i]];
+
+			if (pollfds[i].revents == 0)
+				continue;
+
+			attempt->poll_status = UXSQLconnectPoll(attempt->node_info->conn);
+
+			if (attempt->poll_status == UXRES_POLLING_OK ||
+				attempt->poll_status == UXRES_POLLING_FAILED)
+				pending--;
+		}
+	}
+
+	/*
+	 * Finalise successful connections in the same way as
+	 * _establish_db_connection().
+	 */
+	for (i = 0; i < attempt_count; i++)
+	{
+		t_async_connection *attempt = &attempts[i];
+		UXconn	   *conn = attempt->node_info->conn;
+
+		if (conn == NULL)
+			continue;
+
+		if (attempt->already_connected == true)
+		{
+			connected++;
+			continue;
+		}
+
+		if (UXSQLstatus(conn) != CONNECTION_OK)
+		{
+			if (verbose_logging == true && UXSQLerrorMessage(conn)[0] != '\0')
+			{
+				log_error(_("connection to database failed"));
+				log_detail("\n%s", UXSQLerrorMessage(conn));
+			}
+			continue;
+		}
+
+		if (attempt->is_replication_connection == false &&
+			set_config(conn, "synchronous_commit", "local") == false)
+			continue;
+
+		connected++;
+	}
+
+	pfree(attempts);
+	pfree(pollfds);
+	pfree(pollfd_ix);
+
+	return connected;
+}
+
+
 UXconn *
 establish_db_connection_with_replacement_param(const char *conninfo,
 											   const char *param,
@@ -361,6 +736,113 @@ establish_db_connection_by_params(t_conninfo_param_list *param_list,
 }
 
 
+/*
+ * As establish_db_connection_by_params(), but only start the connection
+ * attempt, which must then be completed with poll_db_connection(). This
+ * enables the caller to abandon an attempt to an unresponsive server
+ * without waiting for "connect_timeout" to expire.
+ *
+ * "*connect_timeout_ms" is set to the value of "connect_timeout" in
+ * milliseconds, or -1 if none is set; libpq does not enforce this for
+ * non-blocking connections, so the caller must.
+ */
+UXconn *
+start_db_connection_by_params(t_conninfo_param_list *param_list, int *connect_timeout_ms)
+{
+	UXconn	   *conn = NULL;
+	int			i;
+
+	param_set_ine(param_list, "connect_timeout", "2");
+	param_set_ine(param_list, "fallback_application_name", "repmgr");
+	param_set(param_list, "options", "-csearch_path=");
+
+	*connect_timeout_ms = -1;
+
+	for (i = 0; param_list->keywords[i]; i++)
+	{
+		if (strcmp(param_list->keywords[i], "connect_timeout") == 0)
+		{
+			int			connect_timeout = atoi(param_list->values[i]);
+
+			if (connect_timeout > 0)
+				*connect_timeout_ms = connect_timeout * 1000;
+		}
+	}
+
+	conn = UXSQLconnectStartParams((const char **) param_list->keywords, (const char **) param_list->values, true);
+
+	if (conn == NULL)
+		return NULL;
+
+	if (UXSQLstatus(conn) == CONNECTION_BAD)
+	{
+		log_verbose(LOG_DEBUG, "start_db_connection_by_params(): %s", UXSQLerrorMessage(conn));
+		UXSQLfinish(conn);
+		return NULL;
+	}
+
+	return conn;
+}
+
+
+/*
+ * Advance a connection attempt started with start_db_connection_by_params(),
+ * waiting up to "timeout_ms" for its socket to become ready. "*poll_status"
+ * must initially be UXRES_POLLING_WRITING, and is updated with the result
+ * of the last UXSQLconnectPoll() call.
+ *
+ * Returns CONNECTION_OK once the connection is established (and configured
+ * as in establish_db_connection_by_params()), CONNECTION_BAD if it failed,
+ * or CONNECTION_STARTED if it is still in progress.
+ */
+ConnStatusType
+poll_db_connection(UXconn *conn, UXSQLPollingStatusType *poll_status, int timeout_ms)
+{
+	struct pollfd pollfd;
+	int			ret;
+
+	if (*poll_status == UXRES_POLLING_READING || *poll_status == UXRES_POLLING_WRITING)
+	{
+		pollfd.fd = UXSQLsocket(conn);
+		pollfd.events = (*poll_status == UXRES_POLLING_READING) ? POLLIN : POLLOUT;
+		pollfd.revents = 0;
+
+		ret = poll(&pollfd, 1, timeout_ms);
+
+		if (ret < 0 && errno != EINTR)
+		{
+			log_error(_("unable to poll database connection"));
+			log_detail("%s", strerror(errno));
+			*poll_status = UXRES_POLLING_FAILED;
+		}
+		else if (ret > 0)
+		{
+			*poll_status = UXSQLconnectPoll(conn);
+		}
+	}
+
+	if (*poll_status == UXRES_POLLING_FAILED)
+	{
+		log_verbose(LOG_DEBUG, "poll_db_connection(): %s", UXSQLerrorMessage(conn));
+		return CONNECTION_BAD;
+	}
+
+	if (*poll_status != UXRES_POLLING_OK)
+		return CONNECTION_STARTED;
+
+	if (UXSQLstatus(conn) != CONNECTION_OK)
+		return CONNECTION_BAD;
+
+	if (set_config(conn, "synchronous_commit", "local") == false)
+	{
+		*poll_status = UXRES_POLLING_FAILED;
+		return CONNECTION_BAD;
+	}
+
+	return CONNECTION_OK;
+}
+
+
 /*
  * Given an existing active connection and the name of a replication
  * user, extract the connection parameters from that connection and
@@ -449,45 +931,372 @@ close_connection(UXconn **conn)
 	if (*conn == NULL)
 		return;
 
+	_forget_prepared_statements(*conn);
+
 	UXSQLfinish(*conn);
 
 	*conn = NULL;
 }
 
 
-/* =============================== */
-/* conninfo manipulation functions */
-/* =============================== */
-
-
-/*
- * get_conninfo_value()
- *
- * Extract the value represented by 'keyword' in 'conninfo' and copy
- * it to the 'output' buffer.
- *
- * Returns true on success, or false on failure (conninfo string could
- * not be parsed, or provided keyword not found).
- */
+/* =================== */
+/* prepared statements */
+/* =================== */
 
-bool
-get_conninfo_value(const char *conninfo, const char *keyword, char *output)
+static t_prepared_statement_conn *
+_get_prepared_statement_conn(UXconn *conn)
 {
-	UXSQLconninfoOption *conninfo_options = NULL;
-	UXSQLconninfoOption *conninfo_option = NULL;
+	t_prepared_statement_conn *entry = NULL;
+	int			backend_pid = UXSQLbackendPID(conn);
+	int			i;
 
-	conninfo_options = UXSQLconninfoParse(conninfo, NULL);
+	for (i = 0; i < PREPARED_STATEMENT_MAX_CONNS; i++)
+	{
+		if (prepared_statement_conns[i].conn == conn)
+		{
+			entry = &prepared_statement_conns[i];
+			break;
+		}
 
-	if (conninfo_options == NULL)
+		if (entry == NULL && prepared_statement_conns[i].conn == NULL)
+			entry = &prepared_statement_conns[i];
+	}
+
+	/*
+	 * No free entry - reuse the oldest one. If that connection is still in
+	 * use, its statements will be "prepared" again, which is harmless.
+	 */
+	if (entry == NULL)
 	{
-		log_error(_("unable to parse provided conninfo string \"%s\""), conninfo);
-		return false;
+		entry = &prepared_statement_conns[prepared_statement_conns_next];
+		prepared_statement_conns_next = (prepared_statement_conns_next + 1) % PREPARED_STATEMENT_MAX_CONNS;
 	}
 
-	for (conninfo_option = conninfo_options; conninfo_option->keyword != NULL; conninfo_option++)
+	if (entry->conn != conn || entry->backend_pid != backend_pid)
 	{
-		if (strcmp(conninfo_option->keyword, keyword) == 0)
-		{
+		entry->conn = conn;
+		entry->backend_pid = backend_pid;
+		entry->prepared = 0;
+	}
+
+	return entry;
+}
+
+
+static void
+_forget_prepared_statements(UXconn *conn)
+{
+	int			i;
+
+	for (i = 0; i < PREPARED_STATEMENT_MAX_CONNS; i++)
+	{
+		if (prepared_statement_conns[i].conn == conn)
+		{
+			memset(&prepared_statement_conns[i], 0, sizeof(t_prepared_statement_conn));
+			return;
+		}
+	}
+}
+
+
+static void
+_build_prepared_statement_query(UXconn *conn, PreparedStatement statement, UXSQLExpBufferData *query)
+{
+	switch (statement)
+	{
+		case PREPARED_RECOVERY_TYPE:
+			appendUXSQLExpBufferStr(query,
+									"SELECT ux_catalog.ux_is_in_recovery()");
+			break;
+
+		case PREPARED_PING:
+			appendUXSQLExpBufferStr(query,
+									"SELECT TRUE");
+			break;
+
+		case PREPARED_PRIMARY_CURRENT_LSN:
+			if (UXSQLserverVersion(conn) >= 100000)
+				appendUXSQLExpBufferStr(query,
+										"SELECT ux_catalog.ux_current_wal_lsn()");
+			else
+				appendUXSQLExpBufferStr(query,
+										"SELECT ux_catalog.ux_current_xlog_location()");
+			break;
+
+		case PREPARED_LAST_WAL_RECEIVE_LSN:
+			if (UXSQLserverVersion(conn) >= 100000)
+				appendUXSQLExpBufferStr(query,
+										"SELECT ux_catalog.ux_last_wal_receive_lsn()");
+			else
+				appendUXSQLExpBufferStr(query,
+										"SELECT ux_catalog.ux_last_xlog_receive_location()");
+			break;
+
+		case PREPARED_NODE_CURRENT_LSN:
+			_build_node_current_lsn_query(conn, query);
+			break;
+
+		case PREPARED_REPLICATION_INFO:
+			_build_replication_info_query(conn, STANDBY, query);
+			break;
+
+		case PREPARED_REPLICATION_INFO_WITNESS:
+			_build_replication_info_query(conn, WITNESS, query);
+			break;
+
+		case PREPARED_REPLICATION_SNAPSHOT:
+			appendUXSQLExpBuffer(query,
+								 " SELECT application_name, pid, state, sync_state, %s "
+								 "   FROM ux_catalog.ux_stat_replication "
+								 "  WHERE $1::TEXT IS NULL "
+								 "     OR application_name = $1 ",
+								 UXSQLserverVersion(conn) >= 100000 ? "flush_lsn" : "flush_location");
+			break;
+
+		case PREPARED_STANDBY_STATUS:
+			appendUXSQLExpBufferStr(query,
+									"SELECT * FROM repmgr.standby_status()");
+			break;
+
+		case PREPARED_PRIMARY_STATUS:
+			appendUXSQLExpBuffer(query,
+								 " SELECT ux_catalog.ux_is_in_recovery(), "
+								 "        CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
+								 "          THEN ux_catalog.%s() "
+								 "          ELSE NULL "
+								 "        END ",
+								 UXSQLserverVersion(conn) >= 100000 ? "ux_current_wal_lsn" : "ux_current_xlog_location");
+			break;
+
+		case PREPARED_STATEMENT_COUNT:
+			break;
+	}
+}
+
+
+/*
+ * Prepare "statement" on "conn", if that has not yet been done on this
+ * connection.
+ *
+ * Returns NULL if the statement is ready to be executed, otherwise the
+ * result of the failed prepare, which the caller can handle as it would
+ * any other failed query.
+ */
+static UXresult *
+_prepare_statement(UXconn *conn, PreparedStatement statement, int nParams)
+{
+	t_prepared_statement_conn *entry = _get_prepared_statement_conn(conn);
+	const char *statement_name = prepared_statement_names[statement];
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+
+	if (entry->prepared & (1 << statement))
+		return NULL;
+
+	initUXSQLExpBuffer(&query);
+	_build_prepared_statement_query(conn, statement, &query);
+
+	log_verbose(LOG_DEBUG, "_prepare_statement(): preparing \"%s\":\n%s",
+				statement_name, query.data);
+
+	res = UXSQLprepare(conn, statement_name, query.data, nParams, NULL);
+
+	termUXSQLExpBuffer(&query);
+
+	if (UXSQLresultStatus(res) != UXRES_COMMAND_OK)
+	{
+		/* "duplicate_prepared_statement" - the registry entry was reused */
+		const char *sqlstate = UXSQLresultErrorField(res, UX_DIAG_SQLSTATE);
+
+		if (sqlstate == NULL || strcmp(sqlstate, "42P05") != 0)
+			return res;
+	}
+
+	UXSQLclear(res);
+
+	entry->prepared |= (1 << statement);
+
+	return NULL;
+}
+
+
+/*
+ * Execute "statement" on "conn", preparing it first if necessary.
+ */
+static UXresult *
+_exec_prepared_statement(UXconn *conn, PreparedStatement statement, int nParams, const char *const *paramValues, int resultFormat)
+{
+	UXresult   *res = _prepare_statement(conn, statement, nParams);
+
+	if (res != NULL)
+		return res;
+
+	res = UXSQLexecPrepared(conn,
+							prepared_statement_names[statement],
+							nParams,
+							paramValues,
+							NULL,
+							NULL,
+							resultFormat);
+
+	_check_prepared_statement_result(conn, statement, res);
+
+	return res;
+}
+
+
+/*
+ * Dispatch "statement" on "conn" without waiting for the result, which
+ * must be collected with _get_prepared_statement_result(). This allows the
+ * same or different statements to be executed on several connections at
+ * once.
+ *
+ * Returns false if the statement could not be prepared or sent; the error
+ * has already been logged.
+ */
+static bool
+_send_prepared_statement(UXconn *conn, PreparedStatement statement, int nParams, const char *const *paramValues, int resultFormat)
+{
+	UXresult   *res = _prepare_statement(conn, statement, nParams);
+
+	if (res != NULL)
+	{
+		log_db_error(conn, NULL, _("unable to prepare statement \"%s\""),
+					 prepared_statement_names[statement]);
+		UXSQLclear(res);
+		return false;
+	}
+
+	if (UXSQLsendQueryPrepared(conn,
+							   prepared_statement_names[statement],
+							   nParams,
+							   paramValues,
+							   NULL,
+							   NULL,
+							   resultFormat) == 0)
+	{
+		log_db_error(conn, NULL, _("unable to send statement \"%s\""),
+					 prepared_statement_names[statement]);
+		return false;
+	}
+
+	return true;
+}
+
+
+static UXresult *
+_get_prepared_statement_result(UXconn *conn, PreparedStatement statement)
+{
+	UXresult   *res = NULL;
+	UXresult   *next = NULL;
+
+	/* consume all results so the connection is ready for the next query */
+	while ((next = UXSQLgetResult(conn)) != NULL)
+	{
+		if (res == NULL)
+			res = next;
+		else
+			UXSQLclear(next);
+	}
+
+	_check_prepared_statement_result(conn, statement, res);
+
+	return res;
+}
+
+
+/*
+ * If the statement has gone away, e.g. after DISCARD ALL
+ * ("invalid_sql_statement_name"), prepare it again next time.
+ */
+static void
+_check_prepared_statement_result(UXconn *conn, PreparedStatement statement, UXresult *res)
+{
+	const char *sqlstate = NULL;
+
+	if (UXSQLresultStatus(res) != UXRES_FATAL_ERROR)
+		return;
+
+	sqlstate = UXSQLresultErrorField(res, UX_DIAG_SQLSTATE);
+
+	if (sqlstate != NULL && strcmp(sqlstate, "26000") == 0)
+	{
+		t_prepared_statement_conn *entry = _get_prepared_statement_conn(conn);
+
+		entry->prepared &= ~(1 << statement);
+	}
+}
+
+
+/*
+ * Result format in which to request an LSN: binary where the server has
+ * the "ux_lsn" type, otherwise text, as before UXsinoDB 10 the LSN
+ * functions return "text", whose binary output is just the string.
+ */
+static int
+_lsn_result_format(UXconn *conn)
+{
+	return UXSQLserverVersion(conn) >= 100000 ? 1 : 0;
+}
+
+
+/*
+ * Decode an LSN requested in the format given by _lsn_result_format();
+ * in binary format, this is a 64-bit integer in network byte order.
+ */
+static XLogRecPtr
+_parse_lsn_result(UXconn *conn, UXresult *res, int row, int column)
+{
+	const unsigned char *value = (const unsigned char *) UXSQLgetvalue(res, row, column);
+	XLogRecPtr	ptr = InvalidXLogRecPtr;
+	int			i;
+
+	if (_lsn_result_format(conn) == 0)
+		return parse_lsn((const char *) value);
+
+	if (UXSQLgetlength(res, row, column) != sizeof(XLogRecPtr))
+		return InvalidXLogRecPtr;
+
+	for (i = 0; i < sizeof(XLogRecPtr); i++)
+		ptr = (ptr << 8) | (XLogRecPtr) value[i];
+
+	return ptr;
+}
+
+
+/* =============================== */
+/* conninfo manipulation functions */
+/* =============================== */
+
+
+/*
+ * get_conninfo_value()
+ *
+ * Extract the value represented by 'keyword' in 'conninfo' and copy
+ * it to the 'output' buffer.
+ *
+ * Returns true on success, or false on failure (conninfo string could
+ * not be parsed, or provided keyword not found).
+ */
+
+bool
+get_conninfo_value(const char *conninfo, const char *keyword, char *output)
+{
+	UXSQLconninfoOption *conninfo_options = NULL;
+	UXSQLconninfoOption *conninfo_option = NULL;
+
+	conninfo_options = UXSQLconninfoParse(conninfo, NULL);
+
+	if (conninfo_options == NULL)
+	{
+		log_error(_("unable to parse provided conninfo string \"%s\""), conninfo);
+		return false;
+	}
+
+	for (conninfo_option = conninfo_options; conninfo_option->keyword != NULL; conninfo_option++)
+	{
+		if (strcmp(conninfo_option->keyword, keyword) == 0)
+		{
 			if (conninfo_option->val != NULL && conninfo_option->val[0] != '\0')
 			{
 				strncpy(output, conninfo_option->val, MAXLEN);
@@ -1123,7 +1932,7 @@ guc_set(UXconn *conn, const char *parameter, const char *op,
 bool
 get_ux_setting(UXconn *conn, const char *setting, char *output)
 {
-	bool success = _get_ux_setting(conn, setting, output, NULL, NULL);
+	bool success = _get_ux_setting(conn, setting, output, NULL, NULL, NULL);
 
 	if (success == true)
 	{
@@ -1133,10 +1942,27 @@ get_ux_setting(UXconn *conn, const char *setting, char *output)
 	return success;
 }
 
+/*
+ * As get_ux_setting(), but for settings whose value may exceed MAXLEN,
+ * which is appended to "output" in full.
+ */
+bool
+get_ux_setting_buffer(UXconn *conn, const char *setting, UXSQLExpBufferData *output)
+{
+	bool success = _get_ux_setting(conn, setting, NULL, output, NULL, NULL);
+
+	if (success == true)
+	{
+		log_verbose(LOG_DEBUG, _("get_ux_setting_buffer(): returned value is \"%s\""), output->data);
+	}
+
+	return success;
+}
+
 bool
 get_ux_setting_bool(UXconn *conn, const char *setting, bool *output)
 {
-	bool success = _get_ux_setting(conn, setting, NULL, output, NULL);
+	bool success = _get_ux_setting(conn, setting, NULL, NULL, output, NULL);
 
 	if (success == true)
 	{
@@ -1150,7 +1976,7 @@ get_ux_setting_bool(UXconn *conn, const char *setting, bool *output)
 bool
 get_ux_setting_int(UXconn *conn, const char *setting, int *output)
 {
-	bool success = _get_ux_setting(conn, setting, NULL, NULL, output);
+	bool success = _get_ux_setting(conn, setting, NULL, NULL, NULL, output);
 
 	if (success == true)
 	{
@@ -1162,7 +1988,7 @@ get_ux_setting_int(UXconn *conn, const char *setting, int *output)
 
 
 bool
-_get_ux_setting(UXconn *conn, const char *setting, char *str_output, bool *bool_output, int *int_output)
+_get_ux_setting(UXconn *conn, const char *setting, char *str_output, UXSQLExpBufferData *buf_output, bool *bool_output, int *int_output)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -1207,6 +2033,10 @@ _get_ux_setting(UXconn *conn, const char *setting, char *str_output, bool *bool_
 			{
 				snprintf(str_output, MAXLEN, "%s", UXSQLgetvalue(res, i, 1));
 			}
+			else if (buf_output != NULL)
+			{
+				appendUXSQLExpBufferStr(buf_output, UXSQLgetvalue(res, i, 1));
+			}
 			else if (bool_output != NULL)
 			{
 				/*
@@ -1416,16 +2246,12 @@ get_recovery_type(UXconn *conn)
 	UXresult   *res = NULL;
 	RecoveryType recovery_type = RECTYPE_UNKNOWN;
 
-	const char	   *sqlquery = "SELECT ux_catalog.ux_is_in_recovery()";
-
-	log_verbose(LOG_DEBUG, "get_recovery_type(): %s", sqlquery);
-
-	res = UXSQLexec(conn, sqlquery);
+	res = _exec_prepared_statement(conn, PREPARED_RECOVERY_TYPE, 0, NULL, 0);
 
 	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
 	{
 		log_db_error(conn,
-					 sqlquery,
+					 NULL,
 					 _("unable to determine if server is in recovery"));
 
 		recovery_type = RECTYPE_UNKNOWN;
@@ -1630,16 +2456,28 @@ get_primary_node_id(UXconn *conn)
 
 
 
+/*
+ * Return the number of WAL files awaiting archiving.
+ *
+ * If repmgrd is running on the node, it maintains this count itself and
+ * we can avoid scanning "archive_status", which with a large backlog may
+ * contain many thousands of files.
+ */
 int
 get_ready_archive_files(UXconn *conn, const char *data_directory)
 {
 	char		archive_status_dir[MAXUXPATH] = "";
 	struct stat statbuf;
-	struct dirent *arcdir_ent;
-	DIR		   *arcdir;
-
 	int			ready_count = 0;
 
+	ready_count = repmgrd_get_archive_ready_files(conn);
+
+	if (ready_count >= 0)
+	{
+		log_verbose(LOG_DEBUG, "get_ready_archive_files(): %i files reported by repmgrd", ready_count);
+		return ready_count;
+	}
+
 	if (UXSQLserverVersion(conn) >= 100000)
 	{
 		snprintf(archive_status_dir, MAXUXPATH,
@@ -1663,9 +2501,9 @@ get_ready_archive_files(UXconn *conn, const char *data_directory)
 		return ARCHIVE_STATUS_DIR_ERROR;
 	}
 
-	arcdir = opendir(archive_status_dir);
+	ready_count = count_ready_archive_files(archive_status_dir);
 
-	if (arcdir == NULL)
+	if (ready_count < 0)
 	{
 		log_error(_("unable to open archive directory \"%s\""),
 				  archive_status_dir);
@@ -1674,35 +2512,6 @@ get_ready_archive_files(UXconn *conn, const char *data_directory)
 		return ARCHIVE_STATUS_DIR_ERROR;
 	}
 
-	while ((arcdir_ent = readdir(arcdir)) != NULL)
-	{
-		struct stat statbuf;
-		char		file_path[MAXUXPATH + sizeof(arcdir_ent->d_name)];
-		int			basenamelen = 0;
-
-		snprintf(file_path, sizeof(file_path),
-				 "%s/%s",
-				 archive_status_dir,
-				 arcdir_ent->d_name);
-
-		/* skip non-files */
-		if (stat(file_path, &statbuf) == 0 && !S_ISREG(statbuf.st_mode))
-		{
-			continue;
-		}
-
-		basenamelen = (int) strlen(arcdir_ent->d_name) - 6;
-
-		/*
-		 * count anything ending in ".ready"; for a more precise
-		 * implementation see: src/backend/uxmaster/uxarch.c
-		 */
-		if (strcmp(arcdir_ent->d_name + basenamelen, ".ready") == 0)
-			ready_count++;
-	}
-
-	closedir(arcdir);
-
 	return ready_count;
 }
 
@@ -1778,8 +2587,17 @@ system_identifier(UXconn *conn)
 }
 
 
+/*
+ * Return the point at which the timeline preceding "tli" ended, as recorded
+ * in the history file of timeline "tli".
+ *
+ * If "system_identifier" is known, the result is served from the
+ * per-process cache where possible; "repl_conn" may be NULL if only the
+ * cache is to be consulted, in which case NULL is returned quietly if
+ * there is no entry.
+ */
 TimeLineHistoryEntry *
-get_timeline_history(UXconn *repl_conn, TimeLineID tli)
+get_timeline_history(UXconn *repl_conn, uint64 system_identifier, TimeLineID tli)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -1788,9 +2606,30 @@ get_timeline_history(UXconn *repl_conn, TimeLineID tli)
 	char		*resptr;
 
 	TimeLineHistoryEntry *history;
+	t_timeline_history_cache_entry *cache_entry = NULL;
 	TimeLineID	file_tli = UNKNOWN_TIMELINE_ID;
-	uint32		switchpoint_hi;
-	uint32		switchpoint_lo;
+	TimeLineID	prev_file_tli = UNKNOWN_TIMELINE_ID;
+	XLogRecPtr	prev_switchpoint = InvalidXLogRecPtr;
+	XLogRecPtr	switchpoint = InvalidXLogRecPtr;
+	bool		found = false;
+
+	if (system_identifier != UNKNOWN_SYSTEM_IDENTIFIER)
+		cache_entry = _get_cached_timeline_history(system_identifier, tli);
+
+	if (cache_entry != NULL && cache_entry->parent_tli == tli - 1)
+	{
+		log_verbose(LOG_DEBUG, "get_timeline_history(): history of timeline %i found in cache", tli);
+
+		history = (TimeLineHistoryEntry *) palloc(sizeof(TimeLineHistoryEntry));
+		history->tli = cache_entry->parent_tli;
+		history->begin = InvalidXLogRecPtr; /* we don't care about this */
+		history->end = cache_entry->switchpoint;
+
+		return history;
+	}
+
+	if (repl_conn == NULL)
+		return NULL;
 
 	initUXSQLExpBuffer(&query);
 
@@ -1826,6 +2665,11 @@ get_timeline_history(UXconn *repl_conn, TimeLineID tli)
 
 	resptr = result.data;
 
+	/*
+	 * Each line records where a timeline on the path to "tli" ended; the
+	 * line for a timeline is also the last line of the history file of the
+	 * timeline which followed it, which is cached as such.
+	 */
 	while (*resptr)
 	{
 		char	buf[MAXLEN];
@@ -1837,7 +2681,7 @@ get_timeline_history(UXconn *repl_conn, TimeLineID tli)
 
 			memset(buf, 0, MAXLEN);
 
-			while (*resptr && *resptr != '\n' && len < MAXLEN)
+			while (*resptr && *resptr != '\n' && len < MAXLEN - 1)
 			{
 				*bufptr++ = *resptr++;
 				len++;
@@ -1845,11 +2689,27 @@ get_timeline_history(UXconn *repl_conn, TimeLineID tli)
 
 			if (buf[0])
 			{
+				uint32		switchpoint_hi;
+				uint32		switchpoint_lo;
 				int nfields = sscanf(buf,
 									 "%u\t%X/%X",
 									 &file_tli, &switchpoint_hi, &switchpoint_lo);
-				if (nfields == 3 && file_tli == tli - 1)
-					break;
+				if (nfields == 3)
+				{
+					switchpoint = ((uint64) (switchpoint_hi)) << 32 | (uint64) switchpoint_lo;
+
+					if (prev_file_tli != UNKNOWN_TIMELINE_ID && system_identifier != UNKNOWN_SYSTEM_IDENTIFIER)
+						_cache_timeline_history(system_identifier, file_tli, prev_file_tli, prev_switchpoint);
+
+					if (file_tli == tli - 1)
+					{
+						found = true;
+						break;
+					}
+
+					prev_file_tli = file_tli;
+					prev_switchpoint = switchpoint;
+				}
 			}
 		}
 
@@ -1857,38 +2717,80 @@ get_timeline_history(UXconn *repl_conn, TimeLineID tli)
 			resptr++;
 	}
 
-	termUXSQLExpBuffer(&result);
-
-	if (file_tli == UNKNOWN_TIMELINE_ID || file_tli != tli - 1)
+	if (found == false)
 	{
 		log_error(_("timeline %i not found in timeline history file content"), tli);
 		log_detail(_("content is: \"%s\""), result.data);
+		termUXSQLExpBuffer(&result);
 		return NULL;
 	}
 
+	termUXSQLExpBuffer(&result);
+
+	if (system_identifier != UNKNOWN_SYSTEM_IDENTIFIER)
+		_cache_timeline_history(system_identifier, tli, file_tli, switchpoint);
+
 	history = (TimeLineHistoryEntry *) palloc(sizeof(TimeLineHistoryEntry));
 	history->tli = file_tli;
 	history->begin = InvalidXLogRecPtr; /* we don't care about this */
-	history->end = ((uint64) (switchpoint_hi)) << 32 | (uint64) switchpoint_lo;
+	history->end = switchpoint;
 
 	return history;
 }
 
 
-pid_t
-get_wal_receiver_pid(UXconn *conn)
+static t_timeline_history_cache_entry *
+_get_cached_timeline_history(uint64 system_identifier, TimeLineID tli)
 {
-	UXresult   *res = NULL;
-	pid_t		wal_receiver_pid = UNKNOWN_PID;
-
-	res = UXSQLexec(conn, "SELECT repmgr.get_wal_receiver_pid()");
+	int			i;
 
-	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	for (i = 0; i < timeline_history_cache_entries; i++)
 	{
-		log_error(_("unable to execute \"SELECT repmgr.get_wal_receiver_pid()\""));
-		log_detail("%s", UXSQLerrorMessage(conn));
+		if (timeline_history_cache[i].system_identifier == system_identifier
+			&& timeline_history_cache[i].tli == tli)
+			return &timeline_history_cache[i];
 	}
-	else if (!UXSQLgetisnull(res, 0, 0))
+
+	return NULL;
+}
+
+
+static void
+_cache_timeline_history(uint64 system_identifier, TimeLineID tli, TimeLineID parent_tli, XLogRecPtr switchpoint)
+{
+	t_timeline_history_cache_entry *cache_entry = _get_cached_timeline_history(system_identifier, tli);
+
+	if (cache_entry == NULL)
+	{
+		/* once full, overwrite the oldest entry */
+		cache_entry = &timeline_history_cache[timeline_history_cache_next];
+		timeline_history_cache_next = (timeline_history_cache_next + 1) % TIMELINE_HISTORY_CACHE_SIZE;
+
+		if (timeline_history_cache_entries < TIMELINE_HISTORY_CACHE_SIZE)
+			timeline_history_cache_entries++;
+	}
+
+	cache_entry->system_identifier = system_identifier;
+	cache_entry->tli = tli;
+	cache_entry->parent_tli = parent_tli;
+	cache_entry->switchpoint = switchpoint;
+}
+
+
+pid_t
+get_wal_receiver_pid(UXconn *conn)
+{
+	UXresult   *res = NULL;
+	pid_t		wal_receiver_pid = UNKNOWN_PID;
+
+	res = UXSQLexec(conn, "SELECT repmgr.get_wal_receiver_pid()");
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_error(_("unable to execute \"SELECT repmgr.get_wal_receiver_pid()\""));
+		log_detail("%s", UXSQLerrorMessage(conn));
+	}
+	else if (!UXSQLgetisnull(res, 0, 0))
 	{
 		wal_receiver_pid = atoi(UXSQLgetvalue(res, 0, 0));
 	}
@@ -2347,6 +3249,71 @@ repmgrd_is_paused(UXconn *conn)
 }
 
 
+/*
+ * Retrieve repmgrd's pid, running and paused status, and the number of
+ * seconds since the upstream was last seen (-1 on a primary), with a
+ * single call to repmgr.get_repmgrd_state().
+ *
+ * If the installed extension predates that function, the individual
+ * functions are called instead.
+ */
+bool
+get_repmgrd_state(UXconn *conn, t_server_type node_type, t_repmgrd_state *state)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+
+	state->pid = UNKNOWN_PID;
+	state->running = false;
+	state->paused = false;
+	state->upstream_last_seen = -1;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+					  " SELECT repmgrd_pid, repmgrd_running, repmgrd_paused, "
+					  "        %s "
+					  "   FROM repmgr.get_repmgrd_state() ",
+					  node_type == WITNESS
+					  ? "upstream_last_seen"
+					  : "CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE THEN -1 ELSE upstream_last_seen END");
+
+	log_verbose(LOG_DEBUG, "get_repmgrd_state():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+	termUXSQLExpBuffer(&query);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_verbose(LOG_DEBUG, "get_repmgrd_state(): falling back to individual functions");
+		log_detail("%s", UXSQLerrorMessage(conn));
+		UXSQLclear(res);
+
+		state->pid = repmgrd_get_pid(conn);
+		state->running = repmgrd_is_running(conn);
+		state->paused = repmgrd_is_paused(conn);
+		state->upstream_last_seen = get_upstream_last_seen(conn, node_type);
+
+		return true;
+	}
+
+	/* no row is returned if the repmgr shared library is not loaded */
+	if (UXSQLntuples(res) == 1)
+	{
+		if (!UXSQLgetisnull(res, 0, 0))
+			state->pid = atoi(UXSQLgetvalue(res, 0, 0));
+
+		state->running = atobool(UXSQLgetvalue(res, 0, 1));
+		state->paused = atobool(UXSQLgetvalue(res, 0, 2));
+		state->upstream_last_seen = atoi(UXSQLgetvalue(res, 0, 3));
+	}
+
+	UXSQLclear(res);
+
+	return true;
+}
+
+
 bool
 repmgrd_pause(UXconn *conn, bool pause)
 {
@@ -2430,6 +3397,230 @@ repmgrd_set_upstream_node_id(UXconn *conn, int node_id)
 	return success;
 }
 
+
+/*
+ * Return the number of WAL files awaiting archiving as last reported by
+ * repmgrd, or -1 if repmgrd isn't running or the installed extension
+ * doesn't provide this.
+ */
+int
+repmgrd_get_archive_ready_files(UXconn *conn)
+{
+	UXresult   *res = NULL;
+	int			archive_ready_files = -1;
+	t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+	const char *sqlquery = "SELECT repmgr.get_archive_ready_files()";
+
+	/* "repmgr.get_archive_ready_files()" was added in extension version 5.5 */
+	if (get_repmgr_extension_status(conn, &extversions) != REPMGR_INSTALLED
+		|| extversions.installed_version_num < 50500)
+		return -1;
+
+	res = UXSQLexec(conn, sqlquery);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, sqlquery, _("repmgrd_get_archive_ready_files(): unable to execute query"));
+	}
+	else if (!UXSQLgetisnull(res, 0, 0))
+	{
+		archive_ready_files = atoi(UXSQLgetvalue(res, 0, 0));
+	}
+
+	UXSQLclear(res);
+
+	return archive_ready_files;
+}
+
+
+bool
+repmgrd_set_archive_ready_files(UXconn *conn, int archive_ready_files)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	bool		success = true;
+
+	initUXSQLExpBuffer(&query);
+	appendUXSQLExpBuffer(&query,
+					  " SELECT repmgr.set_archive_ready_files(%i) ",
+					  archive_ready_files);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data,
+					 _("repmgrd_set_archive_ready_files(): unable to set archive ready file count"));
+		success = false;
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return success;
+}
+
+
+/*
+ * Record the state of each node collected by the witness with
+ * get_node_replication_info_parallel() in the local node's shared memory,
+ * using a single query.
+ */
+bool
+repmgrd_set_cluster_view(UXconn *conn, t_node_replication_info *nodes, int node_count)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	bool		success = true;
+	int			i;
+
+	if (node_count <= 0)
+		return true;
+
+	initUXSQLExpBuffer(&query);
+	appendUXSQLExpBufferStr(&query,
+							" SELECT repmgr.set_cluster_node_state(v.node_id, v.reachable, v.repmgrd_running, "
+							"          v.in_recovery, v.last_wal_receive_lsn, v.upstream_node_id, v.upstream_last_seen) "
+							"   FROM (VALUES ");
+
+	for (i = 0; i < node_count; i++)
+	{
+		t_node_replication_info *node = &nodes[i];
+		bool		reachable = node->replied == true;
+
+		appendUXSQLExpBuffer(&query,
+							 "%s(%i, %s, %s, ",
+							 i > 0 ? ", " : "",
+							 node->node_info->node_id,
+							 reachable == true ? "TRUE" : "FALSE",
+							 reachable == true && node->repmgrd_pid != UNKNOWN_PID ? "TRUE" : "FALSE");
+
+		if (node->replication_info_valid == true)
+		{
+			ReplInfo   *replication_info = &node->replication_info;
+
+			appendUXSQLExpBuffer(&query,
+								 "%s, ",
+								 replication_info->in_recovery == true ? "TRUE" : "FALSE");
+
+			if (replication_info->last_wal_receive_lsn == InvalidXLogRecPtr)
+				appendUXSQLExpBufferStr(&query, "NULL::UX_LSN, ");
+			else
+				appendUXSQLExpBuffer(&query,
+									 "'%X/%X'::UX_LSN, ",
+									 format_lsn(replication_info->last_wal_receive_lsn));
+
+			appendUXSQLExpBuffer(&query,
+								 "%i, %i)",
+								 replication_info->upstream_node_id,
+								 replication_info->upstream_last_seen);
+		}
+		else
+		{
+			appendUXSQLExpBufferStr(&query, "NULL::BOOL, NULL::UX_LSN, NULL::INT, NULL::INT)");
+		}
+	}
+
+	appendUXSQLExpBufferStr(&query,
+							" ) AS v(node_id, reachable, repmgrd_running, in_recovery, "
+							"        last_wal_receive_lsn, upstream_node_id, upstream_last_seen) ");
+
+	log_verbose(LOG_DEBUG, "repmgrd_set_cluster_view():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data,
+					 _("repmgrd_set_cluster_view(): unable to record cluster view"));
+		success = false;
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return success;
+}
+
+
+/*
+ * Retrieve the cluster view recorded by the repmgrd on a witness, in a
+ * single query; entries not updated within "max_age_ms" milliseconds are
+ * ignored. "*states" is allocated with palloc() and must be freed by the
+ * caller if any entries are returned.
+ *
+ * Returns the number of entries, or -1 if the view is not available.
+ */
+int
+repmgrd_get_cluster_view(UXconn *conn, int max_age_ms, t_cluster_node_state **states)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	int			state_count = -1;
+	t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+	*states = NULL;
+
+	/* "repmgr.cluster_view()" was added in extension version 5.5 */
+	if (get_repmgr_extension_status(conn, &extversions) != REPMGR_INSTALLED
+		|| extversions.installed_version_num < 50500)
+		return -1;
+
+	initUXSQLExpBuffer(&query);
+	appendUXSQLExpBuffer(&query,
+						 " SELECT node_id, reachable, repmgrd_running, in_recovery, "
+						 "        last_wal_receive_lsn, upstream_node_id, upstream_last_seen, last_seen "
+						 "   FROM repmgr.cluster_view() "
+						 "  WHERE updated > ux_catalog.now() - '%i milliseconds'::INTERVAL ",
+						 max_age_ms);
+
+	log_verbose(LOG_DEBUG, "repmgrd_get_cluster_view():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("repmgrd_get_cluster_view(): unable to execute query"));
+	}
+	else
+	{
+		int			i;
+
+		state_count = UXSQLntuples(res);
+
+		if (state_count > 0)
+			*states = palloc0(sizeof(t_cluster_node_state) * state_count);
+
+		for (i = 0; i < state_count; i++)
+		{
+			t_cluster_node_state *state = &(*states)[i];
+
+			state->node_id = atoi(UXSQLgetvalue(res, i, 0));
+			state->reachable = atobool(UXSQLgetvalue(res, i, 1));
+			state->repmgrd_running = atobool(UXSQLgetvalue(res, i, 2));
+			state->in_recovery = atobool(UXSQLgetvalue(res, i, 3));
+			state->last_wal_receive_lsn = UXSQLgetisnull(res, i, 4)
+				? InvalidXLogRecPtr
+				: parse_lsn(UXSQLgetvalue(res, i, 4));
+			state->upstream_node_id = UXSQLgetisnull(res, i, 5)
+				? UNKNOWN_NODE_ID
+				: atoi(UXSQLgetvalue(res, i, 5));
+			state->upstream_last_seen = UXSQLgetisnull(res, i, 6)
+				? -1
+				: atoi(UXSQLgetvalue(res, i, 6));
+			state->last_seen = UXSQLgetisnull(res, i, 7)
+				? -1
+				: atoi(UXSQLgetvalue(res, i, 7));
+		}
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return state_count;
+}
+
 /* ================ */
 /* result functions */
 /* ================ */
@@ -2716,13 +3907,13 @@ _populate_node_record(UXresult *res, t_node_info *node_info, int row, bool init_
 	}
 
 	snprintf(node_info->node_name, sizeof(node_info->node_name), "%s", UXSQLgetvalue(res, row, 3));
-	snprintf(node_info->conninfo, sizeof(node_info->conninfo), "%s", UXSQLgetvalue(res, row, 4));
+	node_info->conninfo = intern_string(UXSQLgetvalue(res, row, 4));
 	snprintf(node_info->repluser, sizeof(node_info->repluser), "%s", UXSQLgetvalue(res, row, 5));
-	snprintf(node_info->slot_name, sizeof(node_info->slot_name), "%s", UXSQLgetvalue(res, row, 6));
-	snprintf(node_info->location, sizeof(node_info->location), "%s", UXSQLgetvalue(res, row, 7));
+	node_info->slot_name = intern_string(UXSQLgetvalue(res, row, 6));
+	node_info->location = intern_string(UXSQLgetvalue(res, row, 7));
 	node_info->priority = atoi(UXSQLgetvalue(res, row, 8));
 	node_info->active = atobool(UXSQLgetvalue(res, row, 9));
-	snprintf(node_info->config_file, sizeof(node_info->config_file), "%s", UXSQLgetvalue(res, row, 10));
+	node_info->config_file = intern_string(UXSQLgetvalue(res, row, 10));
 
 	/* These are only set by certain queries */
 	snprintf(node_info->upstream_node_name, sizeof(node_info->upstream_node_name), "%s", UXSQLgetvalue(res, row, 11));
@@ -2740,6 +3931,11 @@ _populate_node_record(UXresult *res, t_node_info *node_info, int row, bool init_
 
 	if (init_defaults == true)
 	{
+		node_info->virtual_ip = "";
+		node_info->network_card = "";
+		node_info->root_passwd = "";
+		node_info->uxdb_passwd = "";
+		node_info->details = "";
 		node_info->node_status = NODE_STATUS_UNKNOWN;
 		node_info->recovery_type = RECTYPE_UNKNOWN;
 		node_info->last_wal_receive_lsn = InvalidXLogRecPtr;
@@ -2967,6 +4163,7 @@ void
 _populate_node_records(UXresult *res, NodeInfoList *node_list)
 {
 	int			i;
+	int			ntuples;
 
 	clear_node_info_list(node_list);
 
@@ -2975,13 +4172,19 @@ _populate_node_records(UXresult *res, NodeInfoList *node_list)
 		return;
 	}
 
-	for (i = 0; i < UXSQLntuples(res); i++)
-	{
-		NodeInfoListCell *cell;
+	ntuples = UXSQLntuples(res);
+
+	if (ntuples == 0)
+		return;
+
+	node_list->cells = (NodeInfoListCell *) ux_malloc0(sizeof(NodeInfoListCell) * ntuples);
+	node_list->node_records = (t_node_info *) ux_malloc0(sizeof(t_node_info) * ntuples);
 
-		cell = (NodeInfoListCell *) ux_malloc0(sizeof(NodeInfoListCell));
+	for (i = 0; i < ntuples; i++)
+	{
+		NodeInfoListCell *cell = &node_list->cells[i];
 
-		cell->node_info = ux_malloc0(sizeof(t_node_info));
+		cell->node_info = &node_list->node_records[i];
 
 		_populate_node_record(res, cell->node_info, i, true);
 
@@ -3066,54 +4269,166 @@ ux_get_all_node_records(UXconn *conn, NodeInfoList *node_list)
 	return;
 }
 
+/*
+ * Retrieve the records of the nodes whose IDs are in "node_ids"; IDs for
+ * which no record exists are silently omitted from the returned list.
+ */
 bool
-get_all_nodes_count(UXconn *conn, int *count)
+get_node_records_by_id(UXconn *conn, const int *node_ids, int node_id_count, NodeInfoList *node_list)
 {
 	UXSQLExpBufferData query;
+	UXSQLExpBufferData node_id_array;
+	const char *param_values[1];
 	UXresult   *res = NULL;
-	bool success = true;
+	bool		success = true;
+	int			i;
+
+	initUXSQLExpBuffer(&node_id_array);
+	appendUXSQLExpBufferChar(&node_id_array, '{');
+
+	for (i = 0; i < node_id_count; i++)
+	{
+		appendUXSQLExpBuffer(&node_id_array, "%s%i",
+							 i > 0 ? "," : "",
+							 node_ids[i]);
+	}
+
+	appendUXSQLExpBufferChar(&node_id_array, '}');
+
+	param_values[0] = node_id_array.data;
+
 	initUXSQLExpBuffer(&query);
 
 	appendUXSQLExpBufferStr(&query,
-						 "  SELECT count(*) "
-						 "    FROM repmgr.nodes n ");
+						 "  SELECT " REPMGR_NODES_COLUMNS
+						 "    FROM repmgr.nodes n "
+						 "   WHERE n.node_id = ANY($1::INT[]) "
+						 "ORDER BY n.node_id ");
 
-	log_verbose(LOG_DEBUG, "get_all_nodes_count():\n%s", query.data);
+	log_verbose(LOG_DEBUG, "get_node_records_by_id():\n%s\n  $1: %s", query.data, node_id_array.data);
 
-	res = UXSQLexec(conn, query.data);
+	res = UXSQLexecParams(conn,
+					   query.data,
+					   1,
+					   NULL,
+					   param_values,
+					   NULL,
+					   NULL,
+					   0);
+
+	/* this will return an empty list if there was an error executing the query */
+	_populate_node_records(res, node_list);
 
 	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
 	{
-		log_db_error(conn, query.data, _("get_all_nodes_count(): unable to execute query"));
+		log_db_error(conn, query.data, _("get_node_records_by_id(): unable to execute query"));
 		success = false;
 	}
-	else
-	{
-		*count = atoi(UXSQLgetvalue(res, 0, 0));
-	}
 
 	UXSQLclear(res);
 	termUXSQLExpBuffer(&query);
+	termUXSQLExpBuffer(&node_id_array);
 
 	return success;
 }
 
-void
-get_downstream_node_records(UXconn *conn, int node_id, NodeInfoList *node_list)
+
+/*
+ * Subscribe "conn" to the notifications sent by the extension whenever
+ * "repmgr.nodes" is modified.
+ *
+ * This is only possible on a node which is not in recovery, and which has
+ * an extension version installed which sends the notifications (5.5 or
+ * later); returns false otherwise.
+ */
+bool
+listen_node_record_changes(UXconn *conn)
 {
-	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
+	bool		available = false;
 
-	initUXSQLExpBuffer(&query);
-
-	appendUXSQLExpBuffer(&query,
-					  "  SELECT " REPMGR_NODES_COLUMNS
-					  "    FROM repmgr.nodes n "
-					  "   WHERE n.upstream_node_id = %i "
-					  "ORDER BY n.node_id ",
-					  node_id);
-
-	log_verbose(LOG_DEBUG, "get_downstream_node_records():\n%s", query.data);
+	res = UXSQLexec(conn,
+					" SELECT ux_catalog.ux_is_in_recovery() IS FALSE "
+					"        AND EXISTS (SELECT 1 FROM ux_catalog.ux_trigger "
+					"                     WHERE tgrelid = 'repmgr.nodes'::regclass "
+					"                       AND tgname = 'nodes_notify_change') ");
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, NULL, _("listen_node_record_changes(): unable to execute query"));
+	}
+	else
+	{
+		available = atobool(UXSQLgetvalue(res, 0, 0));
+	}
+
+	UXSQLclear(res);
+
+	if (available == false)
+		return false;
+
+	res = UXSQLexec(conn, "LISTEN " REPMGR_NODES_CHANNEL);
+
+	if (UXSQLresultStatus(res) != UXRES_COMMAND_OK)
+	{
+		log_db_error(conn, NULL, _("listen_node_record_changes(): unable to execute LISTEN"));
+		available = false;
+	}
+
+	UXSQLclear(res);
+
+	return available;
+}
+
+
+bool
+get_all_nodes_count(UXconn *conn, int *count)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	bool success = true;
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBufferStr(&query,
+						 "  SELECT count(*) "
+						 "    FROM repmgr.nodes n ");
+
+	log_verbose(LOG_DEBUG, "get_all_nodes_count():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("get_all_nodes_count(): unable to execute query"));
+		success = false;
+	}
+	else
+	{
+		*count = atoi(UXSQLgetvalue(res, 0, 0));
+	}
+
+	UXSQLclear(res);
+	termUXSQLExpBuffer(&query);
+
+	return success;
+}
+
+void
+get_downstream_node_records(UXconn *conn, int node_id, NodeInfoList *node_list)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+					  "  SELECT " REPMGR_NODES_COLUMNS
+					  "    FROM repmgr.nodes n "
+					  "   WHERE n.upstream_node_id = %i "
+					  "ORDER BY n.node_id ",
+					  node_id);
+
+	log_verbose(LOG_DEBUG, "get_downstream_node_records():\n%s", query.data);
 
 	res = UXSQLexec(conn, query.data);
 
@@ -3133,6 +4448,45 @@ get_downstream_node_records(UXconn *conn, int node_id, NodeInfoList *node_list)
 }
 
 
+/*
+ * Get the records of all registered nodes other than "node_id", e.g. for
+ * the witness to monitor.
+ */
+void
+get_other_node_records(UXconn *conn, int node_id, NodeInfoList *node_list)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+					  "  SELECT " REPMGR_NODES_COLUMNS
+					  "    FROM repmgr.nodes n "
+					  "   WHERE n.node_id != %i "
+					  "ORDER BY n.node_id ",
+					  node_id);
+
+	log_verbose(LOG_DEBUG, "get_other_node_records():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("get_other_node_records(): unable to execute query"));
+	}
+
+	termUXSQLExpBuffer(&query);
+
+	/* this will return an empty list if there was an error executing the query */
+	_populate_node_records(res, node_list);
+
+	UXSQLclear(res);
+
+	return;
+}
+
+
 void
 get_active_sibling_node_records(UXconn *conn, int node_id, int upstream_node_id, NodeInfoList *node_list)
 {
@@ -3355,7 +4709,7 @@ _create_update_node_record(UXconn *conn, char *action, t_node_info *node_info)
 	char		upstream_node_id[MAXLEN] = "";
 	char	   *upstream_node_id_ptr = NULL;
 
-	char	   *slot_name_ptr = NULL;
+	const char *slot_name_ptr = NULL;
 
 	int			param_count = NODE_RECORD_PARAM_COUNT;
 	const char *param_values[NODE_RECORD_PARAM_COUNT];
@@ -3727,10 +5081,269 @@ update_node_record_conn_priority(UXconn *conn, t_configuration_options *options)
  *
  * This is used when initially registering a witness server, and
  * by repmgrd to update the node records when required.
+ *
+ * Usually only a few records, if any, will have changed since the
+ * previous copy, so only those are copied; if that fails, e.g. because
+ * the witness has a different extension version with an incompatible
+ * table definition, all records are copied individually instead.
  */
 
 bool
 witness_copy_node_records(UXconn *primary_conn, UXconn *witness_conn)
+{
+	if (_witness_sync_node_records(primary_conn, witness_conn) == true)
+		return true;
+
+	log_verbose(LOG_DEBUG, "witness_copy_node_records(): copying all node records");
+
+	return _witness_copy_all_node_records(primary_conn, witness_conn);
+}
+
+
+/*
+ * Compare the node records on the primary and witness by a hash of each
+ * row, then replace only those which differ, in a single transaction,
+ * with one statement to remove the outdated records and another to insert
+ * the current versions. If all records match, nothing is written.
+ *
+ * The rows are transferred in their text representation, so the copy on
+ * the witness is identical to the primary's.
+ */
+static bool
+_witness_sync_node_records(UXconn *primary_conn, UXconn *witness_conn)
+{
+	const char *hash_query =
+		"  SELECT n.node_id, ux_catalog.md5(n::TEXT) "
+		"    FROM repmgr.nodes n "
+		"ORDER BY n.node_id ";
+
+	UXresult   *primary_res = NULL;
+	UXresult   *witness_res = NULL;
+	UXresult   *res = NULL;
+	UXSQLExpBufferData stale_ids;
+	UXSQLExpBufferData fetch_ids;
+	UXSQLExpBufferData query;
+	const char *param_values[1];
+	const char **row_values = NULL;
+	int			primary_count = 0;
+	int			witness_count = 0;
+	int			stale_count = 0;
+	int			fetch_count = 0;
+	int			p = 0,
+				w = 0,
+				i;
+	bool		success = false;
+
+	primary_res = UXSQLexec(primary_conn, hash_query);
+
+	if (UXSQLresultStatus(primary_res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(primary_conn, hash_query, _("_witness_sync_node_records(): unable to retrieve node records from primary"));
+		UXSQLclear(primary_res);
+		return false;
+	}
+
+	witness_res = UXSQLexec(witness_conn, hash_query);
+
+	if (UXSQLresultStatus(witness_res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(witness_conn, hash_query, _("_witness_sync_node_records(): unable to retrieve node records from witness"));
+		UXSQLclear(primary_res);
+		UXSQLclear(witness_res);
+		return false;
+	}
+
+	primary_count = UXSQLntuples(primary_res);
+	witness_count = UXSQLntuples(witness_res);
+
+	initUXSQLExpBuffer(&stale_ids);
+	initUXSQLExpBuffer(&fetch_ids);
+
+	/*
+	 * Both results are ordered by node ID; records only on the witness are
+	 * stale, records only on the primary must be fetched, and records on
+	 * both with different hashes are both.
+	 */
+	while (p < primary_count || w < witness_count)
+	{
+		int			primary_node_id = p < primary_count ? atoi(UXSQLgetvalue(primary_res, p, 0)) : UNKNOWN_NODE_ID;
+		int			witness_node_id = w < witness_count ? atoi(UXSQLgetvalue(witness_res, w, 0)) : UNKNOWN_NODE_ID;
+
+		if (p == primary_count || (w < witness_count && witness_node_id < primary_node_id))
+		{
+			appendUXSQLExpBuffer(&stale_ids, "%s%i", stale_count++ > 0 ? "," : "", witness_node_id);
+			w++;
+		}
+		else if (w == witness_count || primary_node_id < witness_node_id)
+		{
+			appendUXSQLExpBuffer(&fetch_ids, "%s%i", fetch_count++ > 0 ? "," : "", primary_node_id);
+			p++;
+		}
+		else
+		{
+			if (strcmp(UXSQLgetvalue(primary_res, p, 1), UXSQLgetvalue(witness_res, w, 1)) != 0)
+			{
+				appendUXSQLExpBuffer(&stale_ids, "%s%i", stale_count++ > 0 ? "," : "", witness_node_id);
+				appendUXSQLExpBuffer(&fetch_ids, "%s%i", fetch_count++ > 0 ? "," : "", primary_node_id);
+			}
+			p++;
+			w++;
+		}
+	}
+
+	UXSQLclear(primary_res);
+	UXSQLclear(witness_res);
+
+	if (stale_count == 0 && fetch_count == 0)
+	{
+		log_verbose(LOG_DEBUG, "_witness_sync_node_records(): witness node records are up-to-date");
+		termUXSQLExpBuffer(&stale_ids);
+		termUXSQLExpBuffer(&fetch_ids);
+		return true;
+	}
+
+	log_verbose(LOG_DEBUG, "_witness_sync_node_records(): records to remove: {%s}; records to copy: {%s}",
+				stale_ids.data, fetch_ids.data);
+
+	initUXSQLExpBuffer(&query);
+
+	/* retrieve the current versions of the new and changed records */
+	if (fetch_count > 0)
+	{
+		UXSQLExpBufferData node_id_array;
+
+		initUXSQLExpBuffer(&node_id_array);
+		appendUXSQLExpBuffer(&node_id_array, "{%s}", fetch_ids.data);
+		param_values[0] = node_id_array.data;
+
+		res = UXSQLexecParams(primary_conn,
+							  "SELECT n::TEXT FROM repmgr.nodes n WHERE n.node_id = ANY($1::INT[])",
+							  1,
+							  NULL,
+							  param_values,
+							  NULL,
+							  NULL,
+							  0);
+
+		termUXSQLExpBuffer(&node_id_array);
+
+		if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+		{
+			log_db_error(primary_conn, NULL, _("_witness_sync_node_records(): unable to retrieve node records from primary"));
+			goto cleanup;
+		}
+
+		/* a record may have been deleted in the meantime */
+		fetch_count = UXSQLntuples(res);
+	}
+
+	if (begin_transaction(witness_conn) == false)
+		goto cleanup;
+
+	/* Defer constraints, as records may reference each other */
+	{
+		UXresult   *defer_res = UXSQLexec(witness_conn, "SET CONSTRAINTS ALL DEFERRED");
+
+		if (UXSQLresultStatus(defer_res) != UXRES_COMMAND_OK)
+		{
+			log_db_error(witness_conn, NULL, _("_witness_sync_node_records(): unable to defer constraints"));
+			UXSQLclear(defer_res);
+			goto rollback;
+		}
+
+		UXSQLclear(defer_res);
+	}
+
+	if (stale_count > 0)
+	{
+		UXresult   *delete_res = NULL;
+		UXSQLExpBufferData node_id_array;
+
+		initUXSQLExpBuffer(&node_id_array);
+		appendUXSQLExpBuffer(&node_id_array, "{%s}", stale_ids.data);
+		param_values[0] = node_id_array.data;
+
+		delete_res = UXSQLexecParams(witness_conn,
+									 "DELETE FROM repmgr.nodes WHERE node_id = ANY($1::INT[])",
+									 1,
+									 NULL,
+									 param_values,
+									 NULL,
+									 NULL,
+									 0);
+
+		termUXSQLExpBuffer(&node_id_array);
+
+		if (UXSQLresultStatus(delete_res) != UXRES_COMMAND_OK)
+		{
+			log_db_error(witness_conn, NULL, _("_witness_sync_node_records(): unable to remove outdated node records"));
+			UXSQLclear(delete_res);
+			goto rollback;
+		}
+
+		UXSQLclear(delete_res);
+	}
+
+	if (fetch_count > 0)
+	{
+		UXresult   *insert_res = NULL;
+
+		row_values = ux_malloc0(sizeof(char *) * fetch_count);
+
+		appendUXSQLExpBufferStr(&query,
+								"INSERT INTO repmgr.nodes "
+								"     SELECT (v.r::repmgr.nodes).* "
+								"       FROM (VALUES ");
+
+		for (i = 0; i < fetch_count; i++)
+		{
+			row_values[i] = UXSQLgetvalue(res, i, 0);
+			appendUXSQLExpBuffer(&query, "%s($%i::TEXT)", i > 0 ? ", " : "", i + 1);
+		}
+
+		appendUXSQLExpBufferStr(&query, ") AS v(r)");
+
+		insert_res = UXSQLexecParams(witness_conn,
+									 query.data,
+									 fetch_count,
+									 NULL,
+									 row_values,
+									 NULL,
+									 NULL,
+									 0);
+
+		if (UXSQLresultStatus(insert_res) != UXRES_COMMAND_OK)
+		{
+			log_db_error(witness_conn, query.data, _("_witness_sync_node_records(): unable to copy node records"));
+			UXSQLclear(insert_res);
+			goto rollback;
+		}
+
+		UXSQLclear(insert_res);
+	}
+
+	success = commit_transaction(witness_conn);
+
+	goto cleanup;
+
+rollback:
+	rollback_transaction(witness_conn);
+
+cleanup:
+	if (row_values != NULL)
+		pfree((void *) row_values);
+
+	UXSQLclear(res);
+	termUXSQLExpBuffer(&query);
+	termUXSQLExpBuffer(&stale_ids);
+	termUXSQLExpBuffer(&fetch_ids);
+
+	return success;
+}
+
+
+static bool
+_witness_copy_all_node_records(UXconn *primary_conn, UXconn *witness_conn)
 {
 	UXresult   *res = NULL;
 	NodeInfoList nodes = T_NODE_INFO_LIST_INITIALIZER;
@@ -3842,7 +5455,7 @@ truncate_node_records(UXconn *conn)
 
 
 bool
-update_node_record_slot_name(UXconn *primary_conn, int node_id, char *slot_name)
+update_node_record_slot_name(UXconn *primary_conn, int node_id, const char *slot_name)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -3879,40 +5492,37 @@ void
 clear_node_info_list(NodeInfoList *nodes)
 {
 	NodeInfoListCell *cell = NULL;
-	NodeInfoListCell *next_cell = NULL;
 
 	log_verbose(LOG_DEBUG, "clear_node_info_list() - closing open connections");
 
-	/* close any open connections */
+	/*
+	 * close any open connections; handles of failed connections must also
+	 * be freed
+	 */
 	for (cell = nodes->head; cell; cell = cell->next)
 	{
+		close_connection(&cell->node_info->conn);
 
-		if (UXSQLstatus(cell->node_info->conn) == CONNECTION_OK)
+		if (cell->node_info->replication_info != NULL)
 		{
-			UXSQLfinish(cell->node_info->conn);
-			cell->node_info->conn = NULL;
+			pfree(cell->node_info->replication_info);
+			cell->node_info->replication_info = NULL;
 		}
 	}
 
-	log_verbose(LOG_DEBUG, "clear_node_info_list() - unlinking");
-
-	cell = nodes->head;
-
-	while (cell != NULL)
-	{
-		next_cell = cell->next;
+	log_verbose(LOG_DEBUG, "clear_node_info_list() - freeing");
 
-		if (cell->node_info->replication_info != NULL)
-			pfree(cell->node_info->replication_info);
+	if (nodes->cells != NULL)
+		pfree(nodes->cells);
 
-		pfree(cell->node_info);
-		pfree(cell);
-		cell = next_cell;
-	}
+	if (nodes->node_records != NULL)
+		pfree(nodes->node_records);
 
 	nodes->head = NULL;
 	nodes->tail = NULL;
 	nodes->node_count = 0;
+	nodes->cells = NULL;
+	nodes->node_records = NULL;
 }
 
 
@@ -4195,14 +5805,18 @@ _create_event(UXconn *conn, t_configuration_options *options, int node_id, char
 	UXresult   *res = NULL;
 	char		event_timestamp[MAXLEN] = "";
 	bool		success = true;
+	bool		queue_events = event_queue_active();
 
 	log_verbose(LOG_DEBUG, "_create_event(): event is \"%s\" for node %i", event, node_id);
 
 	/*
 	 * Only attempt to write a record if a connection handle was provided,
 	 * and the connection handle points to a node which is not in recovery.
+	 *
+	 * If the event queue is active (repmgrd), the record is instead queued
+	 * below and written to the primary by process_event_queue().
 	 */
-	if (conn != NULL && UXSQLstatus(conn) == CONNECTION_OK && get_recovery_type(conn) == RECTYPE_PRIMARY)
+	if (queue_events == false && conn != NULL && UXSQLstatus(conn) == CONNECTION_OK && get_recovery_type(conn) == RECTYPE_PRIMARY)
 	{
 		int			n_node_id = htonl(node_id);
 		char	   *t_successful = successful ? "TRUE" : "FALSE";
@@ -4280,6 +5894,13 @@ _create_event(UXconn *conn, t_configuration_options *options, int node_id, char
 
 	log_verbose(LOG_DEBUG, "_create_event(): Event timestamp is \"%s\"", event_timestamp);
 
+	/*
+	 * The queued record carries the timestamp generated above, so it agrees
+	 * with the one passed to the notification command.
+	 */
+	if (queue_events == true && conn != NULL && UXSQLstatus(conn) == CONNECTION_OK)
+		queue_event_record(node_id, event, successful, details, event_timestamp);
+
 	/* an event notification command was provided - parse and execute it */
 	if (send_notification == true && strlen(options->event_notification_command))
 	{
@@ -4431,6 +6052,12 @@ _create_event(UXconn *conn, t_configuration_options *options, int node_id, char
 
 		*dst_ptr = '\0';
 
+		if (queue_events == true)
+		{
+			queue_event_notification(event, parsed_command);
+			return success;
+		}
+
 		log_info(_("executing notification command for event \"%s\""),
 				 event);
 
@@ -4448,36 +6075,234 @@ _create_event(UXconn *conn, t_configuration_options *options, int node_id, char
 }
 
 
-UXresult *
-get_event_records(UXconn *conn, int node_id, const char *node_name, const char *event, bool all, int limit)
+/*
+ * Write a batch of event records queued by repmgrd with a single INSERT.
+ */
+bool
+insert_event_records(UXconn *conn, t_event_record *records, int record_count)
 {
-	UXresult   *res;
-
 	UXSQLExpBufferData query;
-	UXSQLExpBufferData where_clause;
+	UXresult   *res = NULL;
+	const char **values = NULL;
+	char	  (*node_ids)[MAXLEN] = NULL;
+	bool		success = true;
+	int			i;
 
+	if (record_count <= 0)
+		return true;
 
-	initUXSQLExpBuffer(&query);
-	initUXSQLExpBuffer(&where_clause);
+	values = ux_malloc0(sizeof(char *) * record_count * 5);
+	node_ids = ux_malloc0(sizeof(*node_ids) * record_count);
 
-	/* LEFT JOIN used here as a node record may have been removed */
+	initUXSQLExpBuffer(&query);
 	appendUXSQLExpBufferStr(&query,
-						 "   SELECT e.node_id, n.node_name, e.event, e.successful, "
-						 "          ux_catalog.to_char(e.event_timestamp, 'YYYY-MM-DD HH24:MI:SS') AS timestamp, "
-						 "          e.details "
-						 "     FROM repmgr.events e "
-						 "LEFT JOIN repmgr.nodes n ON e.node_id = n.node_id ");
+						 " INSERT INTO repmgr.events ( "
+						 "             node_id, "
+						 "             event, "
+						 "             successful, "
+						 "             details, "
+						 "             event_timestamp "
+						 "            ) "
+						 "      VALUES ");
 
-	if (node_id != UNKNOWN_NODE_ID)
-	{
-		append_where_clause(&where_clause,
-							"n.node_id=%i", node_id);
-	}
-	else if (node_name[0] != '\0')
+	for (i = 0; i < record_count; i++)
 	{
-		char	   *escaped = escape_string(conn, node_name);
+		int			p = i * 5;
 
-		if (escaped == NULL)
+		snprintf(node_ids[i], MAXLEN, "%i", records[i].node_id);
+
+		values[p] = node_ids[i];
+		values[p + 1] = records[i].event;
+		values[p + 2] = records[i].successful ? "TRUE" : "FALSE";
+		values[p + 3] = records[i].details;
+		values[p + 4] = records[i].event_timestamp;
+
+		appendUXSQLExpBuffer(&query,
+						  "%s($%i, $%i, $%i, $%i, $%i::TIMESTAMP WITH TIME ZONE)",
+						  i > 0 ? ", " : "",
+						  p + 1, p + 2, p + 3, p + 4, p + 5);
+	}
+
+	log_verbose(LOG_DEBUG, "insert_event_records(): writing %i event record(s)", record_count);
+
+	res = UXSQLexecParams(conn,
+						  query.data,
+						  record_count * 5,
+						  NULL,
+						  values,
+						  NULL,
+						  NULL,
+						  0);
+
+	if (UXSQLresultStatus(res) != UXRES_COMMAND_OK)
+	{
+		/* we don't treat this as a fatal error */
+		log_warning(_("unable to create event records"));
+		log_detail("%s", UXSQLerrorMessage(conn));
+
+		success = false;
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+	pfree(values);
+	pfree(node_ids);
+
+	return success;
+}
+
+
+/*
+ * Parse an event list boundary as provided to "cluster event --after" or
+ * "--before": a timestamp, optionally followed by the node ID and event
+ * of the record at that timestamp, separated by commas. "node_id" is set
+ * to UNKNOWN_NODE_ID if only a timestamp is provided.
+ */
+bool
+parse_event_boundary(const char *value, char *timestamp, int *node_id, char *event)
+{
+	const char *node_id_start = strchr(value, ',');
+	const char *event_start = NULL;
+	char	   *endptr = NULL;
+	long		id;
+
+	*node_id = UNKNOWN_NODE_ID;
+	event[0] = '\0';
+
+	if (node_id_start == NULL)
+	{
+		snprintf(timestamp, MAXLEN, "%s", value);
+		return timestamp[0] != '\0';
+	}
+
+	if (node_id_start == value || node_id_start - value >= MAXLEN)
+		return false;
+
+	snprintf(timestamp, MAXLEN, "%.*s", (int) (node_id_start - value), value);
+
+	event_start = strchr(node_id_start + 1, ',');
+
+	if (event_start == NULL || event_start[1] == '\0')
+		return false;
+
+	errno = 0;
+	id = strtol(node_id_start + 1, &endptr, 10);
+
+	if (errno != 0 || endptr != event_start || (int32) id < id || id < 1)
+		return false;
+
+	*node_id = (int) id;
+	snprintf(event, MAXLEN, "%s", event_start + 1);
+
+	return true;
+}
+
+
+/*
+ * Restrict the event list to records before or after the provided
+ * boundary. With a node ID and event, the record's position is compared
+ * as a whole, so records sharing the boundary's timestamp are neither
+ * skipped nor repeated when paging.
+ */
+static void
+_append_event_boundary(UXconn *conn, UXSQLExpBufferData *where_clause, const char *boundary, const char *op, const char *option)
+{
+	char		timestamp[MAXLEN] = "";
+	char		event[MAXLEN] = "";
+	int			node_id = UNKNOWN_NODE_ID;
+	char	   *escaped_timestamp = NULL;
+	char	   *escaped_event = NULL;
+
+	if (parse_event_boundary(boundary, timestamp, &node_id, event) == false)
+	{
+		log_error(_("invalid value provided for %s"), option);
+		log_detail(_("value is: \"%s\""), boundary);
+		return;
+	}
+
+	escaped_timestamp = escape_string(conn, timestamp);
+
+	if (escaped_timestamp == NULL)
+	{
+		log_error(_("unable to escape value provided for %s"), option);
+		log_detail(_("value is: \"%s\""), boundary);
+		return;
+	}
+
+	if (node_id == UNKNOWN_NODE_ID)
+	{
+		append_where_clause(where_clause,
+							"e.event_timestamp %s '%s'::TIMESTAMPTZ",
+							op, escaped_timestamp);
+		pfree(escaped_timestamp);
+		return;
+	}
+
+	escaped_event = escape_string(conn, event);
+
+	if (escaped_event == NULL)
+	{
+		log_error(_("unable to escape value provided for %s"), option);
+		log_detail(_("value is: \"%s\""), boundary);
+	}
+	else
+	{
+		append_where_clause(where_clause,
+							"(e.event_timestamp, e.node_id, e.event) %s ('%s'::TIMESTAMPTZ, %i, '%s')",
+							op, escaped_timestamp, node_id, escaped_event);
+		pfree(escaped_event);
+	}
+
+	pfree(escaped_timestamp);
+}
+
+
+/*
+ * Retrieve event records, most recent first, optionally filtered by node
+ * and/or event type.
+ *
+ * "after" and "before", if not empty, are boundaries as accepted by
+ * parse_event_boundary(); only events strictly later than "after" and/or
+ * strictly earlier than "before" are returned, which allows the event list
+ * to be paged through without rescanning it from the start. Events are
+ * ordered by timestamp, node ID and event, so the last record of a page
+ * identifies the next page's boundary exactly. If only "after" is
+ * provided, the events immediately following it are returned, in
+ * chronological order. In either case the timestamps are output with
+ * microseconds.
+ */
+UXresult *
+get_event_records(UXconn *conn, int node_id, const char *node_name, const char *event, const char *after, const char *before, bool all, int limit)
+{
+	UXresult   *res;
+
+	UXSQLExpBufferData query;
+	UXSQLExpBufferData where_clause;
+
+	bool		keyset = (after[0] != '\0' || before[0] != '\0');
+
+	initUXSQLExpBuffer(&query);
+	initUXSQLExpBuffer(&where_clause);
+
+	/* LEFT JOIN used here as a node record may have been removed */
+	appendUXSQLExpBuffer(&query,
+						 "   SELECT e.node_id, n.node_name, e.event, e.successful, "
+						 "          ux_catalog.to_char(e.event_timestamp, '%s') AS timestamp, "
+						 "          e.details "
+						 "     FROM repmgr.events e "
+						 "LEFT JOIN repmgr.nodes n ON e.node_id = n.node_id ",
+						 keyset == true ? "YYYY-MM-DD HH24:MI:SS.US" : "YYYY-MM-DD HH24:MI:SS");
+
+	if (node_id != UNKNOWN_NODE_ID)
+	{
+		append_where_clause(&where_clause,
+							"n.node_id=%i", node_id);
+	}
+	else if (node_name[0] != '\0')
+	{
+		char	   *escaped = escape_string(conn, node_name);
+
+		if (escaped == NULL)
 		{
 			log_error(_("unable to escape value provided for node name"));
 			log_detail(_("node name is: \"%s\""), node_name);
@@ -4509,11 +6334,22 @@ get_event_records(UXconn *conn, int node_id, const char *node_name, const char *
 		}
 	}
 
+	if (after[0] != '\0')
+		_append_event_boundary(conn, &where_clause, after, ">", "--after");
+
+	if (before[0] != '\0')
+		_append_event_boundary(conn, &where_clause, before, "<", "--before");
+
 	appendUXSQLExpBuffer(&query, "\n%s\n",
 					  where_clause.data);
 
-	appendUXSQLExpBufferStr(&query,
-						 " ORDER BY e.event_timestamp DESC");
+	/* node ID and event break ties between events with the same timestamp */
+	if (after[0] != '\0' && before[0] == '\0')
+		appendUXSQLExpBufferStr(&query,
+							 " ORDER BY e.event_timestamp ASC, e.node_id ASC, e.event ASC");
+	else
+		appendUXSQLExpBufferStr(&query,
+							 " ORDER BY e.event_timestamp DESC, e.node_id DESC, e.event DESC");
 
 	if (all == false && limit > 0)
 	{
@@ -4531,20 +6367,72 @@ get_event_records(UXconn *conn, int node_id, const char *node_name, const char *
 }
 
 
+/*
+ * Delete event records older than "retention_days" days, optionally only
+ * those for the specified node.
+ *
+ * Returns the number of records deleted, or -1 on error.
+ */
+int
+delete_expired_event_records(UXconn *primary_conn, int retention_days, int node_id)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	int			records_deleted = 0;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+						 "DELETE FROM repmgr.events "
+						 " WHERE event_timestamp < ux_catalog.now() - '%d days'::INTERVAL ",
+						 retention_days);
+
+	if (node_id != UNKNOWN_NODE_ID)
+	{
+		appendUXSQLExpBuffer(&query,
+							 "  AND node_id = %i", node_id);
+	}
+
+	log_verbose(LOG_DEBUG, "delete_expired_event_records():\n  %s", query.data);
+
+	res = UXSQLexec(primary_conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_COMMAND_OK)
+	{
+		log_db_error(primary_conn, query.data,
+					 _("delete_expired_event_records(): unable to delete event records"));
+		records_deleted = -1;
+	}
+	else
+	{
+		records_deleted = atoi(UXSQLcmdTuples(res));
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return records_deleted;
+}
+
+
 /* ========================== */
 /* replication slot functions */
 /* ========================== */
 
 
-void
-create_slot_name(char *slot_name, int node_id)
+const char *
+create_slot_name(int node_id)
 {
+	char		slot_name[MAXLEN] = "";
+
 	maxlen_snprintf(slot_name, "repmgr_slot_%i", node_id);
+
+	return intern_string(slot_name);
 }
 
 
 static ReplSlotStatus
-_verify_replication_slot(UXconn *conn, char *slot_name, UXSQLExpBufferData *error_msg)
+_verify_replication_slot(UXconn *conn, const char *slot_name, UXSQLExpBufferData *error_msg)
 {
 	RecordStatus record_status = RECORD_NOT_FOUND;
 	t_replication_slot slot_info = T_REPLICATION_SLOT_INITIALIZER;
@@ -4587,7 +6475,7 @@ _verify_replication_slot(UXconn *conn, char *slot_name, UXSQLExpBufferData *erro
 
 
 bool
-create_replication_slot_replprot(UXconn *conn, UXconn *repl_conn, char *slot_name, UXSQLExpBufferData *error_msg)
+create_replication_slot_replprot(UXconn *conn, UXconn *repl_conn, const char *slot_name, UXSQLExpBufferData *error_msg)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -4636,7 +6524,7 @@ create_replication_slot_replprot(UXconn *conn, UXconn *repl_conn, char *slot_nam
 
 
 bool
-create_replication_slot_sql(UXconn *conn, char *slot_name, UXSQLExpBufferData *error_msg)
+create_replication_slot_sql(UXconn *conn, const char *slot_name, UXSQLExpBufferData *error_msg)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -4689,7 +6577,7 @@ create_replication_slot_sql(UXconn *conn, char *slot_name, UXSQLExpBufferData *e
 
 
 bool
-drop_replication_slot_sql(UXconn *conn, char *slot_name)
+drop_replication_slot_sql(UXconn *conn, const char *slot_name)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -4727,7 +6615,7 @@ drop_replication_slot_sql(UXconn *conn, char *slot_name)
 
 
 bool
-drop_replication_slot_replprot(UXconn *repl_conn, char *slot_name)
+drop_replication_slot_replprot(UXconn *repl_conn, const char *slot_name)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -4765,7 +6653,7 @@ drop_replication_slot_replprot(UXconn *repl_conn, char *slot_name)
 
 
 RecordStatus
-get_slot_record(UXconn *conn, char *slot_name, t_replication_slot *record)
+get_slot_record(UXconn *conn, const char *slot_name, t_replication_slot *record)
 {
 	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
@@ -4947,6 +6835,140 @@ get_tablespace_name_by_location(UXconn *conn, const char *location, char *name)
 	return success;
 }
 
+
+/*
+ * Populate "list" with the OID and location of each user-defined tablespace.
+ */
+bool
+get_tablespace_locations(UXconn *conn, KeyValueList *list)
+{
+	const char *query =
+		"SELECT oid, ux_catalog.ux_tablespace_location(oid) "
+		"  FROM ux_catalog.ux_tablespace "
+		" WHERE spcname NOT IN ('ux_default', 'ux_global') "
+		" ORDER BY oid";
+	UXresult   *res = NULL;
+	int			i;
+
+	log_verbose(LOG_DEBUG, "get_tablespace_locations():\n%s", query);
+
+	res = UXSQLexec(conn, query);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query,
+					 _("get_tablespace_locations(): unable to execute tablespace query"));
+		UXSQLclear(res);
+		return false;
+	}
+
+	for (i = 0; i < UXSQLntuples(res); i++)
+	{
+		key_value_list_set(list,
+						   UXSQLgetvalue(res, i, 0),
+						   UXSQLgetvalue(res, i, 1));
+	}
+
+	UXSQLclear(res);
+
+	return true;
+}
+
+
+/* ================ */
+/* backup functions */
+/* ================ */
+
+/*
+ * Start a non-exclusive backup; the backup is bound to "conn", which must
+ * be kept open until stop_nonexclusive_backup() is called.
+ *
+ * Returns the backup's starting LSN, or InvalidXLogRecPtr on error.
+ */
+XLogRecPtr
+start_nonexclusive_backup(UXconn *conn, const char *label, bool fast_checkpoint)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	char	   *escaped_label = escape_string(conn, label);
+	XLogRecPtr	start_lsn = InvalidXLogRecPtr;
+
+	initUXSQLExpBuffer(&query);
+
+	if (UXSQLserverVersion(conn) >= 150000)
+	{
+		appendUXSQLExpBuffer(&query,
+							 "SELECT ux_catalog.ux_backup_start('%s', %s)",
+							 escaped_label,
+							 fast_checkpoint ? "TRUE" : "FALSE");
+	}
+	else
+	{
+		appendUXSQLExpBuffer(&query,
+							 "SELECT ux_catalog.ux_start_backup('%s', %s, FALSE)",
+							 escaped_label,
+							 fast_checkpoint ? "TRUE" : "FALSE");
+	}
+
+	pfree(escaped_label);
+
+	log_verbose(LOG_DEBUG, "start_nonexclusive_backup():\n  %s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("start_nonexclusive_backup(): unable to start backup"));
+	}
+	else
+	{
+		start_lsn = parse_lsn(UXSQLgetvalue(res, 0, 0));
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return start_lsn;
+}
+
+
+/*
+ * Stop a backup started with start_nonexclusive_backup() on the same
+ * connection, returning the contents of the "backup_label" and
+ * "tablespace_map" files which must be written to the backup.
+ */
+bool
+stop_nonexclusive_backup(UXconn *conn, UXSQLExpBufferData *label_file, UXSQLExpBufferData *tablespace_map)
+{
+	const char *query = NULL;
+	UXresult   *res = NULL;
+
+	if (UXSQLserverVersion(conn) >= 150000)
+		query = "SELECT labelfile, spcmapfile FROM ux_catalog.ux_backup_stop(TRUE)";
+	else
+		query = "SELECT labelfile, spcmapfile FROM ux_catalog.ux_stop_backup(FALSE, TRUE)";
+
+	log_verbose(LOG_DEBUG, "stop_nonexclusive_backup():\n  %s", query);
+
+	res = UXSQLexec(conn, query);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || UXSQLntuples(res) != 1)
+	{
+		log_db_error(conn, query, _("stop_nonexclusive_backup(): unable to stop backup"));
+		UXSQLclear(res);
+		return false;
+	}
+
+	appendUXSQLExpBufferStr(label_file, UXSQLgetvalue(res, 0, 0));
+
+	if (UXSQLgetisnull(res, 0, 1) == false)
+		appendUXSQLExpBufferStr(tablespace_map, UXSQLgetvalue(res, 0, 1));
+
+	UXSQLclear(res);
+
+	return true;
+}
+
 /* ============================ */
 /* asynchronous query functions */
 /* ============================ */
@@ -5055,21 +7077,64 @@ wait_connection_availability(UXconn *conn, int timeout)
 }
 
 
-/* =========================== */
-/* node availability functions */
-/* =========================== */
-
-bool
-is_server_available(const char *conninfo)
+/*
+ * Check, without blocking, whether the query previously sent on "conn"
+ * with UXSQLsendQuery() has completed, consuming its results if so.
+ *
+ * If the results have already been consumed, e.g. because a synchronous
+ * query has since been executed on the connection, the query is assumed
+ * to have succeeded.
+ *
+ * Returns 1 for success; 0 if any error occurred; -1 if still in progress.
+ */
+int
+check_async_query_result(UXconn *conn)
 {
-	return _is_server_available(conninfo, false);
-}
+	UXresult   *res = NULL;
+	int			result = 1;
 
+	if (UXSQLconsumeInput(conn) == 0)
+	{
+		log_warning(_("check_async_query_result(): unable to receive data from connection"));
+		log_detail("%s", UXSQLerrorMessage(conn));
+		return 0;
+	}
 
-bool
-is_server_available_quiet(const char *conninfo)
-{
-	return _is_server_available(conninfo, true);
+	if (UXSQLisBusy(conn) == 1)
+		return -1;
+
+	while ((res = UXSQLgetResult(conn)) != NULL)
+	{
+		if (UXSQLresultStatus(res) != UXRES_COMMAND_OK &&
+			UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+		{
+			log_warning(_("check_async_query_result(): query failed"));
+			log_detail("%s", UXSQLresultErrorMessage(res));
+			result = 0;
+		}
+
+		UXSQLclear(res);
+	}
+
+	return result;
+}
+
+
+/* =========================== */
+/* node availability functions */
+/* =========================== */
+
+bool
+is_server_available(const char *conninfo)
+{
+	return _is_server_available(conninfo, false);
+}
+
+
+bool
+is_server_available_quiet(const char *conninfo)
+{
+	return _is_server_available(conninfo, true);
 }
 
 
@@ -5128,7 +7193,7 @@ is_server_available_params(t_conninfo_param_list *param_list)
 ExecStatusType
 connection_ping(UXconn *conn)
 {
-	UXresult   *res = UXSQLexec(conn, "SELECT TRUE");
+	UXresult   *res = _exec_prepared_statement(conn, PREPARED_PING, 0, NULL, 0);
 	ExecStatusType ping_result;
 
 	log_verbose(LOG_DEBUG, "connection_ping(): result is %s", UXSQLresStatus(UXSQLresultStatus(res)));
@@ -5164,72 +7229,95 @@ connection_ping_reconnect(UXconn *conn)
 /* monitoring functions */
 /* ==================== */
 
-void
-add_monitoring_record(UXconn *primary_conn,
-					  UXconn *local_conn,
-					  int primary_node_id,
-					  int local_node_id,
-					  char *monitor_standby_timestamp,
-					  XLogRecPtr primary_last_wal_location,
-					  XLogRecPtr last_wal_receive_lsn,
-					  char *last_xact_replay_timestamp,
-					  long long unsigned int replication_lag_bytes,
-					  long long unsigned int apply_lag_bytes
-)
+/*
+ * Send "record_count" monitoring records, starting at index "first" of
+ * the ring buffer "records" of "buffer_size" entries, to the primary as a
+ * single multi-row INSERT.
+ *
+ * The query is executed asynchronously; the caller should use
+ * check_async_query_result() to determine whether it succeeded.
+ *
+ * Returns false if the query could not be sent.
+ */
+bool
+send_monitoring_records(UXconn *primary_conn, t_monitoring_record *records, int buffer_size, int first, int record_count)
 {
 	UXSQLExpBufferData query;
+	bool		success = true;
+	int			i;
+
+	if (record_count <= 0)
+		return true;
 
 	initUXSQLExpBuffer(&query);
 
-	appendUXSQLExpBuffer(&query,
-					  "INSERT INTO repmgr.monitoring_history "
-					  "           (primary_node_id, "
-					  "            standby_node_id, "
-					  "            last_monitor_time, "
-					  "            last_apply_time, "
-					  "            last_wal_primary_location, "
-					  "            last_wal_standby_location, "
-					  "            replication_lag, "
-					  "            apply_lag ) "
-					  "     VALUES(%i, "
-					  "            %i, "
-					  "            '%s'::TIMESTAMP WITH TIME ZONE, "
-					  "            '%s'::TIMESTAMP WITH TIME ZONE, "
-					  "            '%X/%X', "
-					  "            '%X/%X', "
-					  "            %llu, "
-					  "            %llu) ",
-					  primary_node_id,
-					  local_node_id,
-					  monitor_standby_timestamp,
-					  last_xact_replay_timestamp,
-					  format_lsn(primary_last_wal_location),
-					  format_lsn(last_wal_receive_lsn),
-					  replication_lag_bytes,
-					  apply_lag_bytes);
-
-	log_verbose(LOG_DEBUG, "standby_monitor:()\n%s", query.data);
+	appendUXSQLExpBufferStr(&query,
+						 "INSERT INTO repmgr.monitoring_history "
+						 "           (primary_node_id, "
+						 "            standby_node_id, "
+						 "            last_monitor_time, "
+						 "            last_apply_time, "
+						 "            last_wal_primary_location, "
+						 "            last_wal_standby_location, "
+						 "            replication_lag, "
+						 "            apply_lag ) "
+						 "     VALUES ");
+
+	for (i = 0; i < record_count; i++)
+	{
+		t_monitoring_record *record = &records[(first + i) % buffer_size];
+
+		if (i > 0)
+			appendUXSQLExpBufferStr(&query, ", ");
+
+		appendUXSQLExpBuffer(&query,
+						  "(%i, "
+						  " %i, "
+						  " '%s'::TIMESTAMP WITH TIME ZONE, "
+						  " '%s'::TIMESTAMP WITH TIME ZONE, "
+						  " '%X/%X', "
+						  " '%X/%X', "
+						  " %llu, "
+						  " %llu)",
+						  record->primary_node_id,
+						  record->standby_node_id,
+						  record->monitor_standby_timestamp,
+						  record->last_xact_replay_timestamp,
+						  format_lsn(record->primary_last_wal_location),
+						  format_lsn(record->last_wal_receive_lsn),
+						  record->replication_lag_bytes,
+						  record->apply_lag_bytes);
+	}
+
+	log_verbose(LOG_DEBUG, "send_monitoring_records():\n%s", query.data);
 
 	if (UXSQLsendQuery(primary_conn, query.data) == 0)
 	{
 		log_warning(_("query could not be sent to primary:\n  %s"),
 					UXSQLerrorMessage(primary_conn));
+		success = false;
 	}
-	else
-	{
-		UXresult   *res = UXSQLexec(local_conn, "SELECT repmgr.standby_set_last_updated()");
 
-		/* not critical if the above query fails */
-		if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
-			log_warning(_("add_monitoring_record(): unable to set last_updated:\n  %s"),
-						UXSQLerrorMessage(local_conn));
+	termUXSQLExpBuffer(&query);
 
-		UXSQLclear(res);
-	}
+	return success;
+}
 
-	termUXSQLExpBuffer(&query);
 
-	return;
+/*
+ * Record that repmgrd has updated the monitoring data for this standby.
+ */
+void
+set_standby_last_updated(UXconn *local_conn)
+{
+	UXresult   *res = UXSQLexec(local_conn, "SELECT repmgr.standby_set_last_updated()");
+
+	/* not critical if the above query fails */
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+		log_warning(_("set_standby_last_updated(): unable to set last_updated:\n  %s"),
+					UXSQLerrorMessage(local_conn));
+
+	UXSQLclear(res);
 }
 
 
@@ -5245,7 +7333,7 @@ get_number_of_monitoring_records_to_delete(UXconn *primary_conn, int keep_histor
 	appendUXSQLExpBuffer(&query,
 					  "SELECT ux_catalog.count(*) "
 					  "  FROM repmgr.monitoring_history "
-					  " WHERE ux_catalog.age(ux_catalog.now(), last_monitor_time) >= '%d days'::interval",
+					  " WHERE last_monitor_time <= ux_catalog.now() - '%d days'::INTERVAL ",
 					  keep_history);
 
 	if (node_id != UNKNOWN_NODE_ID)
@@ -5288,7 +7376,7 @@ delete_monitoring_records(UXconn *primary_conn, int keep_history, int node_id)
 	{
 		appendUXSQLExpBuffer(&query,
 						  "DELETE FROM repmgr.monitoring_history "
-						  " WHERE ux_catalog.age(ux_catalog.now(), last_monitor_time) >= '%d days'::INTERVAL ",
+						  " WHERE last_monitor_time <= ux_catalog.now() - '%d days'::INTERVAL ",
 						  keep_history);
 
 		if (node_id != UNKNOWN_NODE_ID)
@@ -5318,6 +7406,116 @@ delete_monitoring_records(UXconn *primary_conn, int keep_history, int node_id)
 	return success;
 }
 
+
+/*
+ * Determine whether "repmgr.monitoring_history" is partitioned, i.e. the
+ * repmgr extension is version 5.5 or later.
+ */
+bool
+is_monitoring_history_partitioned(UXconn *primary_conn)
+{
+	UXresult   *res = NULL;
+	bool		partitioned = false;
+	const char *query =
+		"SELECT ux_catalog.to_regprocedure('repmgr.drop_monitoring_history_partitions(integer)') IS NOT NULL";
+
+	res = UXSQLexec(primary_conn, query);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(primary_conn, query,
+					 _("is_monitoring_history_partitioned(): unable to query repmgr extension"));
+	}
+	else
+	{
+		partitioned = atobool(UXSQLgetvalue(res, 0, 0));
+	}
+
+	UXSQLclear(res);
+
+	return partitioned;
+}
+
+
+/*
+ * Create "repmgr.monitoring_history" partitions for the current day and the
+ * following "days_ahead" days, if not already present.
+ *
+ * Returns the number of partitions created, or -1 on error.
+ */
+int
+create_monitoring_history_partitions(UXconn *primary_conn, int days_ahead)
+{
+	UXSQLExpBufferData query;
+	int			partitions_created = -1;
+	UXresult   *res = NULL;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+					  "SELECT repmgr.create_monitoring_history_partitions(%i)",
+					  days_ahead);
+
+	log_verbose(LOG_DEBUG, "create_monitoring_history_partitions():\n  %s", query.data);
+
+	res = UXSQLexec(primary_conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(primary_conn, query.data,
+					 _("create_monitoring_history_partitions(): unable to create monitoring history partitions"));
+	}
+	else
+	{
+		partitions_created = atoi(UXSQLgetvalue(res, 0, 0));
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return partitions_created;
+}
+
+
+/*
+ * Drop "repmgr.monitoring_history" partitions containing only records
+ * older than "keep_history" days.
+ *
+ * Returns the number of partitions dropped, or -1 on error.
+ */
+int
+drop_monitoring_history_partitions(UXconn *primary_conn, int keep_history)
+{
+	UXSQLExpBufferData query;
+	int			partitions_dropped = -1;
+	UXresult   *res = NULL;
+
+	initUXSQLExpBuffer(&query);
+
+	appendUXSQLExpBuffer(&query,
+					  "SELECT repmgr.drop_monitoring_history_partitions(%i)",
+					  keep_history);
+
+	log_verbose(LOG_DEBUG, "drop_monitoring_history_partitions():\n  %s", query.data);
+
+	res = UXSQLexec(primary_conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(primary_conn, query.data,
+					 _("drop_monitoring_history_partitions(): unable to drop monitoring history partitions"));
+	}
+	else
+	{
+		partitions_dropped = atoi(UXSQLgetvalue(res, 0, 0));
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return partitions_dropped;
+}
+
 /*
  * node voting functions
  *
@@ -5567,18 +7765,11 @@ get_primary_current_lsn(UXconn *conn)
 	UXresult   *res = NULL;
 	XLogRecPtr	ptr = InvalidXLogRecPtr;
 
-	if (UXSQLserverVersion(conn) >= 100000)
-	{
-		res = UXSQLexec(conn, "SELECT ux_catalog.ux_current_wal_lsn()");
-	}
-	else
-	{
-		res = UXSQLexec(conn, "SELECT ux_catalog.ux_current_xlog_location()");
-	}
+	res = _exec_prepared_statement(conn, PREPARED_PRIMARY_CURRENT_LSN, 0, NULL, _lsn_result_format(conn));
 
 	if (UXSQLresultStatus(res) == UXRES_TUPLES_OK)
 	{
-		ptr = parse_lsn(UXSQLgetvalue(res, 0, 0));
+		ptr = _parse_lsn_result(conn, res, 0, 0);
 	}
 	else
 	{
@@ -5598,18 +7789,11 @@ get_last_wal_receive_location(UXconn *conn)
 	UXresult   *res = NULL;
 	XLogRecPtr	ptr = InvalidXLogRecPtr;
 
-	if (UXSQLserverVersion(conn) >= 100000)
-	{
-		res = UXSQLexec(conn, "SELECT ux_catalog.ux_last_wal_receive_lsn()");
-	}
-	else
-	{
-		res = UXSQLexec(conn, "SELECT ux_catalog.ux_last_xlog_receive_location()");
-	}
+	res = _exec_prepared_statement(conn, PREPARED_LAST_WAL_RECEIVE_LSN, 0, NULL, _lsn_result_format(conn));
 
-	if (UXSQLresultStatus(res) == UXRES_TUPLES_OK)
+	if (UXSQLresultStatus(res) == UXRES_TUPLES_OK && !UXSQLgetisnull(res, 0, 0))
 	{
-		ptr = parse_lsn(UXSQLgetvalue(res, 0, 0));
+		ptr = _parse_lsn_result(conn, res, 0, 0);
 	}
 	else
 	{
@@ -5627,15 +7811,32 @@ get_last_wal_receive_location(UXconn *conn)
 XLogRecPtr
 get_node_current_lsn(UXconn *conn)
 {
-	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
 	XLogRecPtr	ptr = InvalidXLogRecPtr;
 
-	initUXSQLExpBuffer(&query);
+	res = _exec_prepared_statement(conn, PREPARED_NODE_CURRENT_LSN, 0, NULL, _lsn_result_format(conn));
 
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, NULL, _("unable to execute get_node_current_lsn()"));
+	}
+	else if (!UXSQLgetisnull(res, 0, 0))
+	{
+		ptr = _parse_lsn_result(conn, res, 0, 0);
+	}
+
+	UXSQLclear(res);
+
+	return ptr;
+}
+
+
+static void
+_build_node_current_lsn_query(UXconn *conn, UXSQLExpBufferData *query)
+{
 	if (UXSQLserverVersion(conn) >= 100000)
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 " WITH lsn_states AS ( "
 							 "  SELECT "
 							 "    CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
@@ -5657,7 +7858,7 @@ get_node_current_lsn(UXconn *conn)
 	}
 	else
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 " WITH lsn_states AS ( "
 							 "  SELECT "
 							 "    CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
@@ -5678,7 +7879,7 @@ get_node_current_lsn(UXconn *conn)
 							 " ) ");
 	}
 
-	appendUXSQLExpBufferStr(&query,
+	appendUXSQLExpBufferStr(query,
 						 " SELECT "
 						 "   CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
 						 "     THEN current_wal_lsn "
@@ -5694,22 +7895,6 @@ get_node_current_lsn(UXconn *conn)
 						 "   END "
 						 "     AS current_lsn "
 						 "   FROM lsn_states ");
-
-	res = UXSQLexec(conn, query.data);
-
-	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
-	{
-		log_db_error(conn, query.data, _("unable to execute get_node_current_lsn()"));
-	}
-	else if (!UXSQLgetisnull(res, 0, 0))
-	{
-		ptr = parse_lsn(UXSQLgetvalue(res, 0, 0));
-	}
-
-	termUXSQLExpBuffer(&query);
-	UXSQLclear(res);
-
-	return ptr;
 }
 
 
@@ -5733,12 +7918,135 @@ init_replication_info(ReplInfo *replication_info)
 bool
 get_replication_info(UXconn *conn, t_server_type node_type, ReplInfo *replication_info)
 {
-	UXSQLExpBufferData query;
 	UXresult   *res = NULL;
 	bool		success = true;
 
-	initUXSQLExpBuffer(&query);
-	appendUXSQLExpBufferStr(&query,
+	res = _exec_prepared_statement(conn,
+								   node_type == WITNESS ? PREPARED_REPLICATION_INFO_WITNESS : PREPARED_REPLICATION_INFO,
+								   0, NULL, 0);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || !UXSQLntuples(res))
+	{
+		log_db_error(conn, NULL, _("get_replication_info(): unable to execute query"));
+
+		success = false;
+	}
+	else
+	{
+		_parse_replication_info(res, replication_info);
+	}
+
+	UXSQLclear(res);
+
+	return success;
+}
+
+
+void
+init_standby_status(t_standby_status *standby_status)
+{
+	standby_status->local_valid = false;
+	init_replication_info(&standby_status->replication_info);
+	standby_status->local_node_id = UNKNOWN_NODE_ID;
+	standby_status->repmgrd_paused = false;
+	standby_status->primary_valid = false;
+	standby_status->primary_in_recovery = false;
+	standby_status->primary_current_lsn = InvalidXLogRecPtr;
+}
+
+
+/*
+ * Retrieve everything the standby monitoring loop needs from the local
+ * node with a single call to "repmgr.standby_status()", and the primary's
+ * recovery state and current LSN from "primary_conn" (if not NULL).
+ *
+ * Both queries are dispatched before either result is read, so the time
+ * taken is that of the slower of the two nodes rather than their sum.
+ *
+ * "local_valid" and "primary_valid" in "standby_status" show which parts
+ * were retrieved; returns true if both were (or just the local part if
+ * "primary_conn" is NULL).
+ */
+bool
+get_standby_status(UXconn *local_conn, UXconn *primary_conn, t_standby_status *standby_status)
+{
+	bool		local_sent = false;
+	bool		primary_sent = false;
+	UXresult   *res = NULL;
+
+	init_standby_status(standby_status);
+
+	local_sent = _send_prepared_statement(local_conn, PREPARED_STANDBY_STATUS, 0, NULL, 0);
+
+	if (primary_conn != NULL)
+		primary_sent = _send_prepared_statement(primary_conn, PREPARED_PRIMARY_STATUS, 0, NULL, 0);
+
+	if (local_sent == true)
+	{
+		res = _get_prepared_statement_result(local_conn, PREPARED_STANDBY_STATUS);
+
+		if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || UXSQLntuples(res) != 1)
+		{
+			log_db_error(local_conn, NULL, _("get_standby_status(): unable to retrieve local node status"));
+		}
+		else
+		{
+			ReplInfo   *replication_info = &standby_status->replication_info;
+
+			_parse_replication_info(res, replication_info);
+
+			if (!UXSQLgetisnull(res, 0, 10))
+			{
+				replication_info->timeline_id = atoi(UXSQLgetvalue(res, 0, 10));
+				snprintf(replication_info->timeline_id_str,
+						 sizeof(replication_info->timeline_id_str),
+						 "%i", replication_info->timeline_id);
+			}
+
+			if (!UXSQLgetisnull(res, 0, 11))
+				standby_status->local_node_id = atoi(UXSQLgetvalue(res, 0, 11));
+
+			if (!UXSQLgetisnull(res, 0, 12))
+				standby_status->repmgrd_paused = atobool(UXSQLgetvalue(res, 0, 12));
+
+			standby_status->local_valid = true;
+		}
+
+		UXSQLclear(res);
+	}
+
+	if (primary_sent == true)
+	{
+		res = _get_prepared_statement_result(primary_conn, PREPARED_PRIMARY_STATUS);
+
+		if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || UXSQLntuples(res) != 1)
+		{
+			log_db_error(primary_conn, NULL, _("get_standby_status(): unable to retrieve primary node status"));
+		}
+		else
+		{
+			standby_status->primary_in_recovery = atobool(UXSQLgetvalue(res, 0, 0));
+
+			if (!UXSQLgetisnull(res, 0, 1))
+				standby_status->primary_current_lsn = parse_lsn(UXSQLgetvalue(res, 0, 1));
+
+			standby_status->primary_valid = true;
+		}
+
+		UXSQLclear(res);
+	}
+
+	if (primary_conn == NULL)
+		return standby_status->local_valid;
+
+	return standby_status->local_valid && standby_status->primary_valid;
+}
+
+
+static void
+_build_replication_info_query(UXconn *conn, t_server_type node_type, UXSQLExpBufferData *query)
+{
+	appendUXSQLExpBufferStr(query,
 						 " SELECT ts, "
 						 "        in_recovery, "
 						 "        last_wal_receive_lsn, "
@@ -5765,7 +8073,7 @@ get_replication_info(UXconn *conn, t_server_type node_type, ReplInfo *replicatio
 
 	if (UXSQLserverVersion(conn) >= 100000)
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 "        COALESCE(ux_catalog.ux_last_wal_receive_lsn(), '0/0'::UX_LSN) AS last_wal_receive_lsn, "
 							 "        COALESCE(ux_catalog.ux_last_wal_replay_lsn(),  '0/0'::UX_LSN) AS last_wal_replay_lsn, "
 							 "        CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
@@ -5775,7 +8083,7 @@ get_replication_info(UXconn *conn, t_server_type node_type, ReplInfo *replicatio
 	}
 	else
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 "        COALESCE(ux_catalog.ux_last_xlog_receive_location(), '0/0'::UX_LSN) AS last_wal_receive_lsn, "
 							 "        COALESCE(ux_catalog.ux_last_xlog_replay_location(),  '0/0'::UX_LSN) AS last_wal_replay_lsn, "
 							 "        CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
@@ -5787,59 +8095,338 @@ get_replication_info(UXconn *conn, t_server_type node_type, ReplInfo *replicatio
 	/* Add information about upstream node from shared memory */
 	if (node_type == WITNESS)
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 "        repmgr.get_upstream_last_seen() AS upstream_last_seen, "
 							 "        repmgr.get_upstream_node_id() AS upstream_node_id ");
 	}
 	else
 	{
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 "        CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
 							 "          THEN -1 "
 							 "          ELSE repmgr.get_upstream_last_seen() "
 							 "        END AS upstream_last_seen, ");
-		appendUXSQLExpBufferStr(&query,
+		appendUXSQLExpBufferStr(query,
 							 "        CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE "
 							 "          THEN -1 "
 							 "          ELSE repmgr.get_upstream_node_id() "
 							 "        END AS upstream_node_id ");
 	}
 
-	appendUXSQLExpBufferStr(&query,
+	appendUXSQLExpBufferStr(query,
 						 "          ) q ");
+}
 
-	log_verbose(LOG_DEBUG, "get_replication_info():\n%s", query.data);
 
-	res = UXSQLexec(conn, query.data);
+static void
+_parse_replication_info(UXresult *res, ReplInfo *replication_info)
+{
+	snprintf(replication_info->current_timestamp,
+			 sizeof(replication_info->current_timestamp),
+			 "%s", UXSQLgetvalue(res, 0, 0));
+	replication_info->in_recovery = atobool(UXSQLgetvalue(res, 0, 1));
+	replication_info->last_wal_receive_lsn = parse_lsn(UXSQLgetvalue(res, 0, 2));
+	replication_info->last_wal_replay_lsn = parse_lsn(UXSQLgetvalue(res, 0, 3));
+	snprintf(replication_info->last_xact_replay_timestamp,
+			 sizeof(replication_info->last_xact_replay_timestamp),
+			 "%s", UXSQLgetvalue(res, 0, 4));
+	replication_info->replication_lag_time = atoi(UXSQLgetvalue(res, 0, 5));
+	replication_info->receiving_streamed_wal = atobool(UXSQLgetvalue(res, 0, 6));
+	replication_info->wal_replay_paused = atobool(UXSQLgetvalue(res, 0, 7));
+	replication_info->upstream_last_seen = atoi(UXSQLgetvalue(res, 0, 8));
+	replication_info->upstream_node_id = atoi(UXSQLgetvalue(res, 0, 9));
+}
 
-	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || !UXSQLntuples(res))
+
+/*
+ * Build a query returning the node's WAL replay LSN and replay rate as of
+ * the last lag sample taken before it lost its upstream, so that every node
+ * querying it during an election obtains the same values however long the
+ * election has been running. That sample is the last one for which
+ * "upstream_last_seen" did not increase from the previous sample, i.e. the
+ * upstream was seen in between; once the upstream has gone, it
+ * increases with every sample.
+ *
+ * The rate is measured over the CATCHUP_REPLAY_RATE_WINDOW_SECS seconds
+ * before that sample. No row is returned if there are not enough samples.
+ */
+static void
+_build_catchup_info_query(UXSQLExpBufferData *query)
+{
+	appendUXSQLExpBuffer(query,
+						 "  WITH samples AS ( "
+						 "    SELECT sample_time, last_wal_replay_lsn, upstream_last_seen, "
+						 "           LAG(upstream_last_seen) OVER (ORDER BY sample_time) AS prev_upstream_last_seen "
+						 "      FROM repmgr.lag_history() "
+						 "     WHERE last_wal_replay_lsn IS NOT NULL "
+						 "  ), "
+						 "  frozen AS ( "
+						 "    SELECT sample_time, last_wal_replay_lsn "
+						 "      FROM samples "
+						 "     WHERE upstream_last_seen >= 0 "
+						 "       AND upstream_last_seen <= prev_upstream_last_seen "
+						 "  ORDER BY sample_time DESC "
+						 "     LIMIT 1 "
+						 "  ) "
+						 "SELECT f.last_wal_replay_lsn, w.last_wal_replay_lsn, "
+						 "       EXTRACT(epoch FROM f.sample_time - w.sample_time) "
+						 "  FROM frozen f, "
+						 "       LATERAL (SELECT s.sample_time, s.last_wal_replay_lsn "
+						 "                  FROM samples s "
+						 "                 WHERE s.sample_time >= f.sample_time - '%i seconds'::INTERVAL "
+						 "              ORDER BY s.sample_time ASC "
+						 "                 LIMIT 1) w "
+						 " WHERE f.sample_time > w.sample_time ",
+						 CATCHUP_REPLAY_RATE_WINDOW_SECS);
+}
+
+
+static void
+_parse_catchup_info(UXresult *res, t_catchup_info *catchup_info)
+{
+	XLogRecPtr	first_lsn;
+	double		interval_secs;
+
+	catchup_info->valid = false;
+
+	if (UXSQLntuples(res) != 1)
+		return;
+
+	catchup_info->replay_lsn = parse_lsn(UXSQLgetvalue(res, 0, 0));
+	first_lsn = parse_lsn(UXSQLgetvalue(res, 0, 1));
+	interval_secs = atof(UXSQLgetvalue(res, 0, 2));
+
+	if (interval_secs <= 0 || catchup_info->replay_lsn < first_lsn)
+		return;
+
+	catchup_info->replay_rate = (double) (catchup_info->replay_lsn - first_lsn) / interval_secs;
+	catchup_info->valid = true;
+}
+
+
+/*
+ * Retrieve the repmgrd PID and replication information from each node in
+ * "nodes" which has an open connection, querying all nodes concurrently.
+ *
+ * The queries are sent at once with UXSQLsendQuery() and the results
+ * collected as they arrive, so the total time taken is that of the slowest
+ * responding node. Nodes which have not replied within "timeout_ms"
+ * milliseconds are marked as not having replied, and their connections
+ * closed, as they cannot be used for any further queries.
+ *
+ * Returns the number of nodes which replied.
+ */
+int
+get_node_replication_info_parallel(t_node_replication_info *nodes, int node_count, int timeout_ms)
+{
+	struct pollfd *pollfds = NULL;
+	int		   *pollfd_ix = NULL;
+	int		   *results_received = NULL;
+	instr_time	start_time;
+	int			pending = 0;
+	int			replied = 0;
+	int			i;
+
+	if (node_count <= 0)
+		return 0;
+
+	pollfds = palloc0(sizeof(struct pollfd) * node_count);
+	pollfd_ix = palloc0(sizeof(int) * node_count);
+	results_received = palloc0(sizeof(int) * node_count);
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (i = 0; i < node_count; i++)
 	{
-		log_db_error(conn, query.data, _("get_replication_info(): unable to execute query"));
+		t_node_replication_info *node = &nodes[i];
+		UXSQLExpBufferData query;
 
-		success = false;
+		node->query_sent = false;
+		node->replied = false;
+		node->repmgrd_pid = UNKNOWN_PID;
+		node->replication_info_valid = false;
+		node->catchup_info.valid = false;
+		node->response_time_ms = -1;
+
+		if (node->node_info->conn == NULL || UXSQLstatus(node->node_info->conn) != CONNECTION_OK)
+			continue;
+
+		initUXSQLExpBuffer(&query);
+		appendUXSQLExpBufferStr(&query,
+								"SELECT repmgr.get_repmgrd_pid(); ");
+		_build_replication_info_query(node->node_info->conn, node->node_info->type, &query);
+
+		if (node->request_catchup_info == true)
+		{
+			appendUXSQLExpBufferStr(&query, "; ");
+			_build_catchup_info_query(&query);
+		}
+
+		log_verbose(LOG_DEBUG, "get_node_replication_info_parallel(): node %i\n%s",
+					node->node_info->node_id, query.data);
+
+		if (UXSQLsendQuery(node->node_info->conn, query.data) == 0)
+		{
+			log_warning(_("unable to send query to node \"%s\" (ID: %i)"),
+						node->node_info->node_name,
+						node->node_info->node_id);
+			log_detail("%s", UXSQLerrorMessage(node->node_info->conn));
+		}
+		else
+		{
+			node->query_sent = true;
+			pending++;
+		}
+
+		termUXSQLExpBuffer(&query);
 	}
-	else
+
+	while (pending > 0)
 	{
-		snprintf(replication_info->current_timestamp,
-				 sizeof(replication_info->current_timestamp),
-				 "%s", UXSQLgetvalue(res, 0, 0));
-		replication_info->in_recovery = atobool(UXSQLgetvalue(res, 0, 1));
-		replication_info->last_wal_receive_lsn = parse_lsn(UXSQLgetvalue(res, 0, 2));
-		replication_info->last_wal_replay_lsn = parse_lsn(UXSQLgetvalue(res, 0, 3));
-		snprintf(replication_info->last_xact_replay_timestamp,
-				 sizeof(replication_info->last_xact_replay_timestamp),
-				 "%s", UXSQLgetvalue(res, 0, 4));
-		replication_info->replication_lag_time = atoi(UXSQLgetvalue(res, 0, 5));
-		replication_info->receiving_streamed_wal = atobool(UXSQLgetvalue(res, 0, 6));
-		replication_info->wal_replay_paused = atobool(UXSQLgetvalue(res, 0, 7));
-		replication_info->upstream_last_seen = atoi(UXSQLgetvalue(res, 0, 8));
-		replication_info->upstream_node_id = atoi(UXSQLgetvalue(res, 0, 9));
+		instr_time	elapsed;
+		int			remaining_ms = -1;
+		int			nfds = 0;
+		int			ret;
+
+		if (timeout_ms > 0)
+		{
+			INSTR_TIME_SET_CURRENT(elapsed);
+			INSTR_TIME_SUBTRACT(elapsed, start_time);
+			remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+			if (remaining_ms <= 0)
+				break;
+		}
+
+		for (i = 0; i < node_count; i++)
+		{
+			if (nodes[i].query_sent == false || nodes[i].replied == true)
+				continue;
+
+			pollfds[nfds].fd = UXSQLsocket(nodes[i].node_info->conn);
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			pollfd_ix[nfds] = i;
+			nfds++;
+		}
+
+		ret = poll(pollfds, nfds, remaining_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_error(_("unable to poll database connections"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_node_replication_info *node = &nodes[pollfd_ix[i]];
+			UXconn	   *conn = node->node_info->conn;
+			UXresult   *res = NULL;
+			bool		finished = false;
+
+			if (pollfds[i].revents == 0)
+				continue;
+
+			if (UXSQLconsumeInput(conn) == 0)
+			{
+				log_warning(_("unable to receive data from node \"%s\" (ID: %i)"),
+							node->node_info->node_name,
+							node->node_info->node_id);
+				log_detail("%s", UXSQLerrorMessage(conn));
+
+				/* treat as replied, but with no usable results */
+				node->replied = true;
+				pending--;
+				continue;
+			}
+
+			while (UXSQLisBusy(conn) == 0)
+			{
+				res = UXSQLgetResult(conn);
+
+				if (res == NULL)
+				{
+					finished = true;
+					break;
+				}
+
+				if (results_received[pollfd_ix[i]] == 2)
+				{
+					/*
+					 * Catch-up information; not available from older extension
+					 * versions, or if too few lag samples have been recorded.
+					 */
+					if (UXSQLresultStatus(res) == UXRES_TUPLES_OK)
+					{
+						_parse_catchup_info(res, &node->catchup_info);
+					}
+					else
+					{
+						log_verbose(LOG_DEBUG, "get_node_replication_info_parallel(): no catch-up information for node %i:\n%s",
+									node->node_info->node_id,
+									UXSQLresultErrorMessage(res));
+					}
+				}
+				else if (UXSQLresultStatus(res) != UXRES_TUPLES_OK || !UXSQLntuples(res))
+				{
+					log_warning(_("unable to retrieve replication information for node \"%s\" (ID: %i)"),
+								node->node_info->node_name,
+								node->node_info->node_id);
+					log_detail("%s", UXSQLresultErrorMessage(res));
+				}
+				else if (results_received[pollfd_ix[i]] == 0)
+				{
+					if (!UXSQLgetisnull(res, 0, 0))
+						node->repmgrd_pid = atoi(UXSQLgetvalue(res, 0, 0));
+				}
+				else
+				{
+					_parse_replication_info(res, &node->replication_info);
+					node->replication_info_valid = true;
+				}
+
+				results_received[pollfd_ix[i]]++;
+				UXSQLclear(res);
+			}
+
+			if (finished == true)
+			{
+				instr_time	response_time;
+
+				INSTR_TIME_SET_CURRENT(response_time);
+				INSTR_TIME_SUBTRACT(response_time, start_time);
+
+				node->response_time_ms = (int) INSTR_TIME_GET_MILLISEC(response_time);
+				node->replied = true;
+				replied++;
+				pending--;
+			}
+		}
 	}
 
-	termUXSQLExpBuffer(&query);
-	UXSQLclear(res);
+	/* connections with queries still in progress cannot be reused */
+	for (i = 0; i < node_count; i++)
+	{
+		if (nodes[i].query_sent == true && nodes[i].replied == false)
+		{
+			log_warning(_("node \"%s\" (ID: %i) did not respond within %i milliseconds"),
+						nodes[i].node_info->node_name,
+						nodes[i].node_info->node_id,
+						timeout_ms);
+			close_connection(&nodes[i].node_info->conn);
+		}
+	}
 
-	return success;
+	pfree(pollfds);
+	pfree(pollfd_ix);
+	pfree(results_received);
+
+	return replied;
 }
 
 
@@ -6005,39 +8592,196 @@ is_downstream_node_attached_quiet(UXconn *conn, char *node_name, char **node_sta
 NodeAttached
 _is_downstream_node_attached(UXconn *conn, char *node_name, char **node_state, bool quiet)
 {
-	UXSQLExpBufferData query;
+	t_replication_snapshot snapshot = T_REPLICATION_SNAPSHOT_INITIALIZER;
+	NodeAttached attached;
+
+	if (get_replication_snapshot(conn, node_name, &snapshot) == false)
+		return NODE_ATTACHED_UNKNOWN;
+
+	attached = get_snapshot_node_attached(&snapshot, node_name, node_state, quiet);
+
+	clear_replication_snapshot(&snapshot);
+
+	return attached;
+}
+
+
+/*
+ * Fetch the contents of "ux_stat_replication" (restricted to rows whose
+ * "application_name" matches, if provided) into "snapshot", so repmgrd
+ * can check any number of downstream nodes with a single query.
+ *
+ * The caller must free the snapshot with clear_replication_snapshot().
+ */
+bool
+get_replication_snapshot(UXconn *conn, const char *application_name, t_replication_snapshot *snapshot)
+{
+	const char *param_values[1];
 	UXresult   *res = NULL;
+	int			i;
 
-	initUXSQLExpBuffer(&query);
+	clear_replication_snapshot(snapshot);
 
-	appendUXSQLExpBuffer(&query,
-					  " SELECT pid, state "
-					  "   FROM ux_catalog.ux_stat_replication "
-					  "  WHERE application_name = '%s'",
-					  node_name);
+	param_values[0] = application_name;
 
-	res = UXSQLexec(conn, query.data);
+	res = _exec_prepared_statement(conn, PREPARED_REPLICATION_SNAPSHOT, 1, param_values, 0);
 
 	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
 	{
 		log_verbose(LOG_WARNING, _("unable to query ux_stat_replication"));
 		log_detail("%s", UXSQLerrorMessage(conn));
-		log_detail("%s", query.data);
 
-		termUXSQLExpBuffer(&query);
 		UXSQLclear(res);
 
+		return false;
+	}
+
+	/*
+	 * If the connection is not a superuser or member of pg_read_all_stats, we
+	 * won't be able to retrieve the "state" column.
+	 */
+	snapshot->state_visible = connection_has_ux_monitor_role(conn, "ux_read_all_stats");
+
+	snapshot->entry_count = UXSQLntuples(res);
+
+	/* keep the table at most half full */
+	snapshot->bucket_count = 16;
+	while (snapshot->bucket_count < snapshot->entry_count * 2)
+		snapshot->bucket_count *= 2;
+
+	snapshot->buckets = ux_malloc0(sizeof(int) * snapshot->bucket_count);
+
+	if (snapshot->entry_count > 0)
+		snapshot->entries = ux_malloc0(sizeof(t_replication_stat) * snapshot->entry_count);
+
+	for (i = 0; i < snapshot->entry_count; i++)
+	{
+		t_replication_stat *entry = &snapshot->entries[i];
+		t_replication_stat *existing = NULL;
+
+		snprintf(entry->application_name, sizeof(entry->application_name),
+				 "%s", UXSQLgetvalue(res, i, 0));
+		entry->pid = atoi(UXSQLgetvalue(res, i, 1));
+		snprintf(entry->state, sizeof(entry->state), "%s", UXSQLgetvalue(res, i, 2));
+		snprintf(entry->sync_state, sizeof(entry->sync_state), "%s", UXSQLgetvalue(res, i, 3));
+
+		if (UXSQLgetisnull(res, i, 4))
+			entry->flush_lsn = InvalidXLogRecPtr;
+		else
+			entry->flush_lsn = parse_lsn(UXSQLgetvalue(res, i, 4));
+
+		/* the first entry with a given name is the one in the hash table */
+		existing = find_replication_stat(snapshot, entry->application_name);
+
+		if (existing != NULL)
+		{
+			existing->duplicate = true;
+			entry->duplicate = true;
+		}
+		else
+		{
+			unsigned int bucket = replication_stat_hash(entry->application_name) & (snapshot->bucket_count - 1);
+
+			while (snapshot->buckets[bucket] != 0)
+				bucket = (bucket + 1) & (snapshot->bucket_count - 1);
+
+			snapshot->buckets[bucket] = i + 1;
+		}
+	}
+
+	UXSQLclear(res);
+
+	snapshot->valid = true;
+
+	return true;
+}
+
+
+/* FNV-1a */
+static unsigned int
+replication_stat_hash(const char *application_name)
+{
+	unsigned int hash = 2166136261u;
+	const unsigned char *c;
+
+	for (c = (const unsigned char *) application_name; *c != '\0'; c++)
+	{
+		hash ^= *c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+void
+clear_replication_snapshot(t_replication_snapshot *snapshot)
+{
+	if (snapshot->entries != NULL)
+		pfree(snapshot->entries);
+
+	if (snapshot->buckets != NULL)
+		pfree(snapshot->buckets);
+
+	snapshot->valid = false;
+	snapshot->state_visible = false;
+	snapshot->entry_count = 0;
+	snapshot->entries = NULL;
+	snapshot->bucket_count = 0;
+	snapshot->buckets = NULL;
+}
+
+
+/*
+ * Return the "ux_stat_replication" row for "application_name", or NULL if
+ * there is none. If there is more than one, the one returned will have
+ * "duplicate" set.
+ */
+t_replication_stat *
+find_replication_stat(t_replication_snapshot *snapshot, const char *application_name)
+{
+	unsigned int bucket;
+
+	if (snapshot->bucket_count == 0)
+		return NULL;
+
+	bucket = replication_stat_hash(application_name) & (snapshot->bucket_count - 1);
+
+	while (snapshot->buckets[bucket] != 0)
+	{
+		t_replication_stat *entry = &snapshot->entries[snapshot->buckets[bucket] - 1];
+
+		if (strcmp(entry->application_name, application_name) == 0)
+			return entry;
+
+		bucket = (bucket + 1) & (snapshot->bucket_count - 1);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Determine from the snapshot whether the named node is attached; this
+ * applies the same rules, and emits the same messages, as
+ * is_downstream_node_attached().
+ */
+NodeAttached
+get_snapshot_node_attached(t_replication_snapshot *snapshot, const char *node_name, char **node_state, bool quiet)
+{
+	t_replication_stat *entry = NULL;
+
+	if (snapshot->valid == false)
 		return NODE_ATTACHED_UNKNOWN;
-	}
 
-	termUXSQLExpBuffer(&query);
+	entry = find_replication_stat(snapshot, node_name);
 
 	/*
 	 * If there's more than one entry in ux_stat_application, there's no
 	 * way we can reliably determine which one belongs to the node we're
 	 * checking, so there's nothing more we can do.
 	 */
-	if (UXSQLntuples(res) > 1)
+	if (entry != NULL && entry->duplicate == true)
 	{
 		if (quiet == false)
 		{
@@ -6046,46 +8790,36 @@ _is_downstream_node_attached(UXconn *conn, char *node_name, char **node_state, b
 			log_hint(_("verify that a unique node name is configured for each node"));
 		}
 
-		UXSQLclear(res);
-
 		return NODE_ATTACHED_UNKNOWN;
 	}
 
-	if (UXSQLntuples(res) == 0)
+	if (entry == NULL)
 	{
 		if (quiet == false)
 			log_warning(_("node \"%s\" not found in \"ux_stat_replication\""), node_name);
 
-		UXSQLclear(res);
-
 		return NODE_DETACHED;
 	}
 
 	/*
-	 * If the connection is not a superuser or member of pg_read_all_stats, we
-	 * won't be able to retrieve the "state" column, so we'll assume
-	 * the node is attached.
+	 * Without permission to read the "state" column, we'll assume the node
+	 * is attached.
 	 */
-
-	if (connection_has_ux_monitor_role(conn, "ux_read_all_stats"))
+	if (snapshot->state_visible == true)
 	{
-		const char *state = UXSQLgetvalue(res, 0, 1);
-
 		if (node_state != NULL)
 		{
-			int		state_len = strlen(state);
+			int		state_len = strlen(entry->state);
 			*node_state = palloc0(state_len + 1);
-			strncpy(*node_state, state, state_len);
+			strncpy(*node_state, entry->state, state_len);
 		}
 
-		if (strcmp(state, "streaming") != 0)
+		if (strcmp(entry->state, "streaming") != 0)
 		{
 			if (quiet == false)
 				log_warning(_("node \"%s\" attached in state \"%s\""),
 							node_name,
-							state);
-
-			UXSQLclear(res);
+							entry->state);
 
 			return NODE_NOT_ATTACHED;
 		}
@@ -6096,12 +8830,33 @@ _is_downstream_node_attached(UXconn *conn, char *node_name, char **node_state, b
 		*node_state[0] = '\0';
 	}
 
-	UXSQLclear(res);
-
 	return NODE_ATTACHED;
 }
 
 
+/*
+ * Count the rows in the snapshot with the given "sync_state", or all rows
+ * if NULL.
+ */
+int
+count_replication_stats(t_replication_snapshot *snapshot, const char *sync_state)
+{
+	int			count = 0;
+	int			i;
+
+	if (sync_state == NULL)
+		return snapshot->entry_count;
+
+	for (i = 0; i < snapshot->entry_count; i++)
+	{
+		if (strcmp(snapshot->entries[i].sync_state, sync_state) == 0)
+			count++;
+	}
+
+	return count;
+}
+
+
 void
 set_upstream_last_seen(UXconn *conn, int upstream_node_id)
 {
@@ -6126,6 +8881,68 @@ set_upstream_last_seen(UXconn *conn, int upstream_node_id)
 }
 
 
+/*
+ * Add a sample to the local node's lag history ring, as returned by
+ * repmgr.lag_history(). Older extension versions don't provide this, so
+ * failure is not reported other than in verbose mode.
+ */
+void
+record_lag_sample(UXconn *conn)
+{
+	UXresult   *res = NULL;
+
+	res = UXSQLexec(conn, "SELECT repmgr.record_lag_sample()");
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_verbose(LOG_WARNING, _("unable to execute repmgr.record_lag_sample()"));
+		log_verbose(LOG_WARNING, "%s", UXSQLerrorMessage(conn));
+	}
+
+	UXSQLclear(res);
+}
+
+
+/*
+ * Retrieve the replay progress of the local node as recorded in its lag
+ * history; see _build_catchup_info_query().
+ */
+bool
+get_catchup_info(UXconn *conn, t_catchup_info *catchup_info)
+{
+	UXSQLExpBufferData query;
+	UXresult   *res = NULL;
+	t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+	catchup_info->valid = false;
+
+	if (get_repmgr_extension_status(conn, &extversions) != REPMGR_INSTALLED
+		|| extversions.installed_version_num < 50500)
+		return false;
+
+	initUXSQLExpBuffer(&query);
+	_build_catchup_info_query(&query);
+
+	log_verbose(LOG_DEBUG, "get_catchup_info():\n%s", query.data);
+
+	res = UXSQLexec(conn, query.data);
+
+	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+	{
+		log_db_error(conn, query.data, _("get_catchup_info(): unable to query lag history"));
+	}
+	else
+	{
+		_parse_catchup_info(res, catchup_info);
+	}
+
+	termUXSQLExpBuffer(&query);
+	UXSQLclear(res);
+
+	return catchup_info->valid;
+}
+
+
 int
 get_upstream_last_seen(UXconn *conn, t_server_type node_type)
 {
@@ -6231,36 +9048,14 @@ is_wal_replay_paused(UXconn *conn, bool check_pending_wal)
 CheckStatus
 get_repmgrd_status(UXconn *conn)
 {
-	UXSQLExpBufferData query;
-	UXresult   *res = NULL;
-	CheckStatus	repmgrd_status = CHECK_STATUS_CRITICAL;
-
-	initUXSQLExpBuffer(&query);
+	t_repmgrd_state state = T_REPMGRD_STATE_INITIALIZER;
 
-	appendUXSQLExpBufferStr(&query,
-						 " SELECT "
-						 " CASE "
-						 "   WHEN repmgr.repmgrd_is_running() "
-						 "   THEN "
-						 "     CASE "
-						 "       WHEN repmgr.repmgrd_is_paused() THEN 1 ELSE 0 "
-						 "     END "
-						 "   ELSE 2 "
-						 " END AS repmgrd_status");
-	res = UXSQLexec(conn, query.data);
+	(void) get_repmgrd_state(conn, UNKNOWN, &state);
 
-	if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
-	{
-		log_db_error(conn, query.data, _("unable to execute repmgrd status query"));
-	}
-	else
-	{
-		repmgrd_status = atoi(UXSQLgetvalue(res, 0, 0));
-	}
+	if (state.running == false)
+		return CHECK_STATUS_CRITICAL;
 
-	termUXSQLExpBuffer(&query);
-	UXSQLclear(res);
-	return repmgrd_status;
+	return state.paused == true ? CHECK_STATUS_WARNING : CHECK_STATUS_OK;
 }
 
 
@@ -6345,201 +9140,191 @@ parse_multi_networkcard(const char *pSrc, char **pArray)
 }
 
 /*
- * uxdb: Bind virutal IP to locale node network card
- * tianbing
+ * Fallback used when the in-process netlink path is not available (e.g.
+ * repmgrd runs as a non-root user without CAP_NET_ADMIN): execute
+ * "ip addr <action>" directly as root, otherwise via sudo.
  */
-bool
-bind_virtual_ip(const char *vip, const char *network_card)
+static bool
+_virtual_ip_command(const char *action, const char *vip, const char *network_card, const char *uxdb_passwd)
 {
-	char        bind_vip[MAXLEN];
-	int     r;
-	int uid = getuid();
+	char		command[MAXLEN];
+	int			r;
 
-	/* if local node already has vip, don't need to execute bind command */
-	if (is_exist_bind_virtual_ip(vip, network_card))
+	if (getuid() == 0)
 	{
-		log_notice(_("locale node already bind virtual_ip info"));
-		return true;
+		snprintf(command, MAXLEN, "ip addr %s %s dev %s", action, vip, network_card);
+	}
+	/* modify by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
+	else if (uxdb_passwd == NULL || !strlen(uxdb_passwd))
+	{
+		snprintf(command, MAXLEN, "sudo ip addr %s %s dev %s", action, vip, network_card);
 	}
-
-	/*bind vip to network card*/
-	if(uid == 0) //root user
-		sprintf(bind_vip, "ip addr add %s dev %s", vip, network_card);
 	else
 	{
-		/* modify by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
-		if(!strlen(uxdb_passwd))
-		{
-			/* if local node already has vip, don't need to execute bind command */
-			if (is_exist_bind_virtual_ip(pvipsArray[i], pNetworkcardsArray[i], uxdb_passwd))
-			{
-				log_notice(_("locale node already bind virtual_ip info %s dev %s"), pvipsArray[i], pNetworkcardsArray[i]);
-				continue;
-			}
+		snprintf(command, MAXLEN, "echo '%s' | sudo -S ip addr %s %s dev %s", uxdb_passwd, action, vip, network_card);
+	}
 
-			/*bind vip to network card*/
-			if(uid == 0) //root user
-				sprintf(bind_vip, "ip addr add %s dev %s", pvipsArray[i], pNetworkcardsArray[i]);
-			else
-			{
-				/* modify by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
-				if(!strlen(uxdb_passwd))
-				{
-					sprintf(bind_vip, "sudo ip addr add %s dev %s", pvipsArray[i], pNetworkcardsArray[i]);
-				}
-				else
-				{
-					sprintf(bind_vip, "echo '%s' | sudo -S ip addr add %s dev %s", uxdb_passwd, pvipsArray[i], pNetworkcardsArray[i]);
-				}
-			}
-			r = ux_system(bind_vip);
+	r = ux_system(command);
 
-			if (r != 0)
-			{
-				log_warning(_("unable to bind the virtual ip"));
-				/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
-				for (i = 0; i < iVipCount; i++)
-				{
-					ux_free(pvipsArray[i]);
-					ux_free(pNetworkcardsArray[i]);
-					pvipsArray[i] = NULL;
-					pNetworkcardsArray[i] = NULL;
-				}
-				/* END Added by chen_jingwen for #207866 at 2025/01/14 */
-				return false;
-			}
+	return r == 0;
+}
 
-			arping_virtual_ip();
-		}
-		else
-		{
-			sprintf(bind_vip, "echo '%s' | sudo -S ip addr add %s dev %s", uxdb_passwd, vip, network_card);
-			/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
-			pvipsArray[i] = NULL;
-			pNetworkcardsArray[i] = NULL;
-			/* END Added by chen_jingwen for #207866 at 2025/01/14 */
-		}
+
+static bool
+_bind_single_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
+{
+	VipStatus	status = vip_address_add(vip, network_card);
+
+	if (status == VIP_EXISTS)
+	{
+		log_notice(_("locale node already bind virtual_ip info %s dev %s"), vip, network_card);
+		return true;
 	}
-	r = ux_system(bind_vip);
 
-	if (r != 0)
+	if (status == VIP_NO_PERMISSION || status == VIP_UNSUPPORTED)
 	{
-		log_warning(_("unable to bind the virtual ip"));
-		/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
-		for (i = 0; i < iVipCount; i++)
-		{
-			ux_free(pvipsArray[i]);
-			pvipsArray[i] = NULL;
-		}
-		for (i = 0; i < iNetworkcardCount; i++)
+		log_debug("netlink bind of virtual ip not possible (%s), falling back to \"ip addr add\"",
+				  vip_status_str(status));
+
+		/* if local node already has vip, don't need to execute bind command */
+		if (is_exist_bind_virtual_ip(vip, network_card, uxdb_passwd))
 		{
-			ux_free(pNetworkcardsArray[i]);
-			pNetworkcardsArray[i] = NULL;
+			log_notice(_("locale node already bind virtual_ip info %s dev %s"), vip, network_card);
+			return true;
 		}
-		/* END Added by chen_jingwen for #207866 at 2025/01/14 */
+
+		if (_virtual_ip_command("add", vip, network_card, uxdb_passwd) == false)
+			status = VIP_ERROR;
+		else
+			status = VIP_OK;
+	}
+
+	if (status != VIP_OK)
+	{
+		log_warning(_("unable to bind the virtual ip %s dev %s"), vip, network_card);
 		return false;
 	}
 
-	arping_virtual_ip();
+	arping_virtual_ip(vip, network_card, uxdb_passwd);
 
 	return true;
 }
 
-/*
- * uxdb: Unbind virutal IP to locale node network card
- * tianbing
- */
-bool
-unbind_virtual_ip(const char *vip, const char *network_card)
+
+static bool
+_unbind_single_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
 {
-	char        unbind_vip[MAXLEN];
-	int     r;
-	int uid = getuid();
+	VipStatus	status = vip_address_del(vip, network_card);
 
-	/* if local node has not vip, don't need to execute unbind command */
-	if (!is_exist_bind_virtual_ip(vip, network_card))
+	if (status == VIP_NOT_FOUND)
 	{
-		log_notice(_("locale node not get virtual_ip info"));
+		log_notice(_("locale node not get virtual_ip info %s dev %s"), vip, network_card);
 		return true;
 	}
 
-	if(uid == 0) //root user
-		sprintf(unbind_vip, "ip addr del %s dev %s", vip, network_card);
-	else
+	if (status == VIP_NO_PERMISSION || status == VIP_UNSUPPORTED)
 	{
-		/* modify by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
-		if(!strlen(uxdb_passwd))
-		{
-			/* if local node has not vip, don't need to execute unbind command */
-			if (!is_exist_bind_virtual_ip(pvipsArray[i], pNetworkcardsArray[i], uxdb_passwd))
-			{
-				log_notice(_("locale node not get virtual_ip info %s dev %s"), pvipsArray[i], pNetworkcardsArray[i]);
-				continue;
-			}
-
-			if(uid == 0) //root user
-				sprintf(unbind_vip, "ip addr del %s dev %s", pvipsArray[i], pNetworkcardsArray[i]);
-			else
-			{
-				/* modify by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
-				if(!strlen(uxdb_passwd))
-				{
-					sprintf(unbind_vip, "sudo ip addr del %s dev %s", pvipsArray[i], pNetworkcardsArray[i]);
-				}
-				else
-				{
-					sprintf(unbind_vip, "echo '%s' | sudo -S ip addr del %s dev %s", uxdb_passwd, pvipsArray[i], pNetworkcardsArray[i]);
-				}
-			}
+		log_debug("netlink unbind of virtual ip not possible (%s), falling back to \"ip addr del\"",
+				  vip_status_str(status));
 
-			r = ux_system(unbind_vip);
-
-			if (r != 0)
-			{
-				log_warning(_("unable to unbind the virtual ip"));
-				/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
-				for (i = 0; i < iVipCount; i++)
-				{
-					ux_free(pvipsArray[i]);
-					ux_free(pNetworkcardsArray[i]);
-					pvipsArray[i] = NULL;
-					pNetworkcardsArray[i] = NULL;
-				}
-				/* END Added by chen_jingwen for #207866 at 2025/01/14 */
-				return false;
-			}
-		}
-		else
+		/* if local node has not vip, don't need to execute unbind command */
+		if (!is_exist_bind_virtual_ip(vip, network_card, uxdb_passwd))
 		{
-			sprintf(unbind_vip, "echo '%s' | sudo -S ip addr del %s dev %s", uxdb_passwd, vip, network_card);
-			/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
-			pvipsArray[i] = NULL;
-			pNetworkcardsArray[i] = NULL;
-			/* END Added by chen_jingwen for #207866 at 2025/01/14 */
+			log_notice(_("locale node not get virtual_ip info %s dev %s"), vip, network_card);
+			return true;
 		}
+
+		if (_virtual_ip_command("del", vip, network_card, uxdb_passwd) == false)
+			status = VIP_ERROR;
+		else
+			status = VIP_OK;
+	}
+
+	if (status != VIP_OK)
+	{
+		log_warning(_("unable to unbind the virtual ip %s dev %s"), vip, network_card);
+		return false;
 	}
 
-	r = ux_system(unbind_vip);
+	return true;
+}
+
+
+/*
+ * Apply "func" to each virtual IP in the comma-separated "vip" list,
+ * paired with the corresponding entry in "network_card"; a single
+ * network card applies to all virtual IPs.
+ */
+static bool
+_for_each_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd,
+					 bool (*func) (const char *vip, const char *network_card, const char *uxdb_passwd))
+{
+	char	   *pvipsArray[MAX_AMOUNT] = {NULL};
+	char	   *pNetworkcardsArray[MAX_AMOUNT] = {NULL};
+	int			iVipCount = 0;
+	int			iNetworkcardCount = 0;
+	int			i;
+	bool		success = true;
+
+	iVipCount = parse_multi_networkcard(vip, pvipsArray);
+	iNetworkcardCount = parse_multi_networkcard(network_card, pNetworkcardsArray);
 
-	if (r != 0)
+	if (iVipCount <= 0 || iNetworkcardCount <= 0 ||
+		(iNetworkcardCount != 1 && iNetworkcardCount != iVipCount))
+	{
+		log_warning(_("number of virtual ips (%i) does not match number of network cards (%i)"),
+					iVipCount, iNetworkcardCount);
+		success = false;
+	}
+	else
 	{
-		log_warning(_("unable to unbind the virtual ip"));
-		/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
 		for (i = 0; i < iVipCount; i++)
 		{
-			ux_free(pvipsArray[i]);
-			pvipsArray[i] = NULL;
-		}
-		for (i = 0; i < iNetworkcardCount; i++)
-		{
-			ux_free(pNetworkcardsArray[i]);
-			pNetworkcardsArray[i] = NULL;
+			const char *card = pNetworkcardsArray[iNetworkcardCount == 1 ? 0 : i];
+
+			if (func(pvipsArray[i], card, uxdb_passwd) == false)
+				success = false;
 		}
-		/* END Added by chen_jingwen for #207866 at 2025/01/14 */
-		return false;
 	}
 
-	return true;
+	/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
+	for (i = 0; i < iVipCount; i++)
+	{
+		ux_free(pvipsArray[i]);
+		pvipsArray[i] = NULL;
+	}
+	for (i = 0; i < iNetworkcardCount; i++)
+	{
+		ux_free(pNetworkcardsArray[i]);
+		pNetworkcardsArray[i] = NULL;
+	}
+	/* END Added by chen_jingwen for #207866 at 2025/01/14 */
+
+	return success;
+}
+
+
+/*
+ * uxdb: Bind virutal IP to locale node network card
+ * tianbing
+ *
+ * The address is added in-process via rtnetlink; the "ip addr" command
+ * is only used if repmgr lacks the privileges to do so.
+ */
+bool
+bind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
+{
+	return _for_each_virtual_ip(vip, network_card, uxdb_passwd, _bind_single_virtual_ip);
+}
+
+/*
+ * uxdb: Unbind virutal IP to locale node network card
+ * tianbing
+ */
+bool
+unbind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
+{
+	return _for_each_virtual_ip(vip, network_card, uxdb_passwd, _unbind_single_virtual_ip);
 }
 
 /*
@@ -6568,50 +9353,61 @@ check_vip_conf(const char *vip, const char *network_card)
  * check whether  a virtual_ip has been bound to the local node
  */
 static bool
-is_exist_bind_virtual_ip(const char *vip, const char *network_card)
+is_exist_bind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
 {
 	UXSQLExpBufferData command;
 	UXSQLExpBufferData command_output;
-	char command_str[MAXLEN] = {0};
-	int uid = 0;
+	VipStatus	status;
+	bool		exists = false;
+
+	status = vip_address_exists(vip, network_card);
+
+	if (status == VIP_OK)
+		return true;
+
+	if (status == VIP_NOT_FOUND)
+		return false;
+
+	log_debug("netlink query of virtual ip not possible (%s), falling back to \"ip addr show\"",
+			  vip_status_str(status));
 
 	initUXSQLExpBuffer(&command);
-	uid = getuid();
-	if (uid == 0) 
+
+	if (getuid() == 0)
 	{
 		/* root user */
-		snprintf(command_str, MAXLEN,
-					 " ip addr show dev %s|grep \"%s\" ", network_card , vip);
+		appendUXSQLExpBuffer(&command,
+							 " ip addr show dev %s|grep \"%s\" ", network_card, vip);
+	}
+	else if (uxdb_passwd == NULL || !strlen(uxdb_passwd))
+	{
+		appendUXSQLExpBuffer(&command,
+							 " sudo ip addr show dev %s|grep \"%s\" ", network_card, vip);
 	}
 	else
 	{
-		snprintf(command_str, MAXLEN,
-					 " sudo ip addr show dev %s|grep \"%s\" ", network_card , vip);
+		appendUXSQLExpBuffer(&command,
+							 " echo '%s' | sudo -S ip addr show dev %s|grep \"%s\" ",
+							 uxdb_passwd, network_card, vip);
 	}
-	log_notice(_("get vip command %s"), command_str);
-	appendUXSQLExpBufferStr(&command,command_str);
 
 	initUXSQLExpBuffer(&command_output);
 	(void) local_command_simple(command.data,
 								&command_output);
-	if (command_output.len == 0)
-	{
-		/* BEGIN Added by chen_jingwen for #207866 at 2024/10/8 */
-		/* 分配的空间需要释放，下同 */
-		termUXSQLExpBuffer(&command);
-		termUXSQLExpBuffer(&command_output);
-		/* END Added by chen_jingwen for #207866 at 2024/10/8 */
-		return false;
-	}
-	else
+
+	if (command_output.len > 0)
 	{
 		log_notice(_("bind virtual_ip info is %s"), command_output.data);
-		/* BEGIN Added by chen_jingwen for #207866 at 2024/10/8 */
-		termUXSQLExpBuffer(&command);
-		termUXSQLExpBuffer(&command_output);
-		/* END Added by chen_jingwen for #207866 at 2024/10/8 */
-		return true;
+		exists = true;
 	}
+
+	/* BEGIN Added by chen_jingwen for #207866 at 2024/10/8 */
+	/* 分配的空间需要释放，下同 */
+	termUXSQLExpBuffer(&command);
+	termUXSQLExpBuffer(&command_output);
+	/* END Added by chen_jingwen for #207866 at 2024/10/8 */
+
+	return exists;
 }
 /* END:  Added by huyn for #160873, 2022/9/20  reviewer:songjz */
 
@@ -6731,44 +9527,71 @@ get_ux_size_pretty(UXconn *conn, long long unsigned int lag_bytes, char *lag_str
 /* 提升为主节点之后，要在主节点上执行一次checkpoint，
  *将新的时间线更新到control中
  */
-void
-new_primary_execute_checkpoint(UXconn *conn)
+UXconn *
+new_primary_request_checkpoint(const char *conninfo)
 {
-	UXSQLExpBufferData query;
-	UXresult   *res = NULL;
+	UXconn	   *conn = NULL;
+	const char *query = "CHECKPOINT";
 
-	initUXSQLExpBuffer(&query);
-	appendUXSQLExpBuffer(&query, "checkpoint;");
+	/*
+	 * A checkpoint can take a long time on a busy node, so it's run on a
+	 * dedicated connection and not waited for; the caller can check its
+	 * progress with check_async_query_result().
+	 */
+	conn = establish_db_connection(conninfo, false);
 
-	log_notice(_("promotion primary node laster , execute:\n%s"), query.data);
+	if (UXSQLstatus(conn) != CONNECTION_OK)
+	{
+		log_warning(_("new_primary_request_checkpoint(): unable to connect to the new primary"));
+		log_detail("\n%s", UXSQLerrorMessage(conn));
+		close_connection(&conn);
+		return NULL;
+	}
 
-	res = UXSQLexec(conn, query.data);
+	log_notice(_("requesting checkpoint on the new primary"));
 
-	if (UXSQLresultStatus(res) != UXRES_COMMAND_OK)
+	if (UXSQLsendQuery(conn, query) == 0)
 	{
-		log_db_error(conn, query.data, _("new_primary_execute_checkpoint(): unable to execute query"));
+		log_db_error(conn, query, _("new_primary_request_checkpoint(): unable to send query"));
+		close_connection(&conn);
+		return NULL;
 	}
 
-	termUXSQLExpBuffer(&query);
-	UXSQLclear(res);
-	return;
+	return conn;
 }
 /* END:  Added by huyn for #177313, 2023/2/17  reviewer:wangyh,zhangwj */
 
+/*
+ * Announce a newly bound virtual IP. Gratuitous ARP is sent in-process;
+ * "arping_command" is only executed if that is not possible (no
+ * CAP_NET_RAW, IPv6 address, non-Ethernet device).
+ */
 static void
-arping_virtual_ip(void)
+arping_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd)
 {
 	UXSQLExpBufferData arping_command_str;
+	VipStatus	status;
 	int ret = -1;
 
+	status = vip_send_gratuitous_arp(vip, network_card, VIP_GARP_COUNT);
+
+	if (status == VIP_OK)
+	{
+		log_debug("sent %i gratuitous ARP requests for virtual ip %s dev %s",
+				  VIP_GARP_COUNT, vip, network_card);
+		return;
+	}
+
+	log_debug("unable to send gratuitous ARP in-process (%s)", vip_status_str(status));
+
 	if (strlen(config_file_options.arping_command) > 0)
 	{
 		log_notice("arping virtual ip...");
 		initUXSQLExpBuffer(&arping_command_str);
 
-		if(strlen(config_file_options.uxdb_password) > 0)
+		if (getuid() != 0 && uxdb_passwd != NULL && strlen(uxdb_passwd) > 0)
 			appendUXSQLExpBuffer(&arping_command_str, "echo '%s' | sudo -S ",
-				config_file_options.uxdb_password);
+								 uxdb_passwd);
 		appendUXSQLExpBuffer(&arping_command_str, "%s",
 							 config_file_options.arping_command);
 
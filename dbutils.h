@@ -66,6 +66,9 @@
 	"NULL AS attached "
 
 
+/* notification channel used by the "repmgr.nodes" change trigger */
+#define REPMGR_NODES_CHANNEL "repmgr_nodes_changed"
+
 #define ERRBUFF_SIZE 512
 
 typedef enum
@@ -135,6 +138,38 @@ typedef enum
 	NODE_DETACHED
 } NodeAttached;
 
+/*
+ * A single "ux_stat_replication" row, as stored in a t_replication_snapshot.
+ * "state" and "sync_state" are empty if the connection lacks permission to
+ * read them.
+ */
+typedef struct
+{
+	char		application_name[NAMEDATALEN];
+	int			pid;
+	char		state[NAMEDATALEN];
+	char		sync_state[NAMEDATALEN];
+	XLogRecPtr	flush_lsn;
+	/* another row has the same application_name */
+	bool		duplicate;
+} t_replication_stat;
+
+/*
+ * Contents of "ux_stat_replication" at one point in time, with a hash
+ * table on "application_name" for lookups.
+ */
+typedef struct
+{
+	bool		valid;
+	bool		state_visible;
+	int			entry_count;
+	t_replication_stat *entries;
+	int			bucket_count;
+	int		   *buckets;		/* entry index + 1; 0 means empty */
+} t_replication_snapshot;
+
+#define T_REPLICATION_SNAPSHOT_INITIALIZER { false, false, 0, NULL, 0, NULL }
+
 typedef enum
 {
 	SLOT_UNKNOWN = -1,
@@ -153,6 +188,19 @@ typedef enum
 
 
 
+/*
+ * repmgrd state as reported by repmgr.get_repmgrd_state()
+ */
+typedef struct s_repmgrd_state
+{
+	pid_t		pid;
+	bool		running;
+	bool		paused;
+	int			upstream_last_seen;
+} t_repmgrd_state;
+
+#define T_REPMGRD_STATE_INITIALIZER { UNKNOWN_PID, false, false, -1 }
+
 /*
  * Struct to store extension version information
  */
@@ -188,12 +236,51 @@ typedef struct
 	int			upstream_node_id;
 } ReplInfo;
 
+
+/*
+ * Status of a standby and its primary as retrieved once per monitoring
+ * cycle by get_standby_status()
+ */
+typedef struct
+{
+	bool		local_valid;
+	ReplInfo	replication_info;
+	int			local_node_id;
+	bool		repmgrd_paused;
+	bool		primary_valid;
+	bool		primary_in_recovery;
+	XLogRecPtr	primary_current_lsn;
+} t_standby_status;
+
+
+#define MONITORING_TIMESTAMP_LEN 64
+
+/*
+ * Struct to store a single "repmgr.monitoring_history" row; repmgrd
+ * buffers these locally and writes them to the primary in batches.
+ */
+typedef struct
+{
+	int			primary_node_id;
+	int			standby_node_id;
+	char		monitor_standby_timestamp[MONITORING_TIMESTAMP_LEN];
+	XLogRecPtr	primary_last_wal_location;
+	XLogRecPtr	last_wal_receive_lsn;
+	char		last_xact_replay_timestamp[MONITORING_TIMESTAMP_LEN];
+	long long unsigned int replication_lag_bytes;
+	long long unsigned int apply_lag_bytes;
+} t_monitoring_record;
+
 /*
  * Struct to store node information.
  *
  * The first section represents the contents of the "repmgr.nodes"
  * table; subsequent section contain information collated in
  * various contexts.
+ *
+ * Strings which may be up to MAXLEN or MAXUXPATH long are interned with
+ * intern_string() rather than stored in the record, so records are
+ * compact and can be copied freely; they must be replaced, not modified.
  */
 typedef struct s_node_info
 {
@@ -203,18 +290,18 @@ typedef struct s_node_info
 	t_server_type type;
 	char		node_name[NAMEDATALEN];
 	char		upstream_node_name[NAMEDATALEN];
-	char		conninfo[MAXLEN];
+	const char *conninfo;
 	char		repluser[NAMEDATALEN];
-	char		location[MAXLEN];
+	const char *location;
 	int			priority;
 	bool		active;
-	char		slot_name[MAXLEN];
-	char		config_file[MAXUXPATH];
-	char        virtual_ip[MAXUXPATH];   //uxdb
-	char        network_card[MAXUXPATH]; //uxdb
+	const char *slot_name;
+	const char *config_file;
+	const char *virtual_ip;   //uxdb
+	const char *network_card; //uxdb
 	/* user passwd */
-	char        root_passwd[MAXUXPATH];
-	char        uxdb_passwd[MAXUXPATH];
+	const char *root_passwd;
+	const char *uxdb_passwd;
 	/* used during failover to track node status */
 	XLogRecPtr	last_wal_receive_lsn;
 	NodeStatus	node_status;
@@ -222,7 +309,7 @@ typedef struct s_node_info
 	MonitoringState monitoring_state;
 	UXconn	   *conn;
 	/* for ad-hoc use e.g. when working with a list of nodes */
-	char		details[MAXLEN];
+	const char *details;
 	bool		reachable;
 	NodeAttached attached;
 	/* various statistics */
@@ -272,12 +359,18 @@ typedef struct s_node_info
 }
 
 
-/* structs to store a list of repmgr node records */
+/*
+ * structs to store a list of repmgr node records
+ *
+ * The cells and node records are each allocated as a single contiguous
+ * array when the list is populated, so iterating via "next" walks memory
+ * sequentially and clearing the list requires only two frees; the linked
+ * "next" pointers are retained so lists can be traversed as before.
+ */
 typedef struct NodeInfoListCell
 {
 	struct NodeInfoListCell *next;
 	t_node_info *node_info;
-	ReplInfo  replinfo; //uxdb
 } NodeInfoListCell;
 
 typedef struct NodeInfoList
@@ -285,18 +378,69 @@ typedef struct NodeInfoList
 	NodeInfoListCell *head;
 	NodeInfoListCell *tail;
 	int			node_count;
+	/* backing storage for the cells and node records */
+	NodeInfoListCell *cells;
+	t_node_info *node_records;
 } NodeInfoList;
 
 #define T_NODE_INFO_LIST_INITIALIZER { \
 	NULL, \
 	NULL, \
-	0 \
+	0, \
+	NULL, \
+	NULL \
 }
 
+/*
+ * WAL replay position and rate of a standby as of the time it lost its
+ * upstream; see get_catchup_info().
+ */
+typedef struct
+{
+	bool		valid;
+	XLogRecPtr	replay_lsn;
+	double		replay_rate;	/* bytes per second */
+} t_catchup_info;
+
+/*
+ * Struct to collect the state of a node queried by
+ * get_node_replication_info_parallel(); set "request_catchup_info" to
+ * also retrieve "catchup_info".
+ */
+typedef struct
+{
+	t_node_info *node_info;
+	bool		query_sent;
+	bool		replied;
+	pid_t		repmgrd_pid;
+	bool		replication_info_valid;
+	ReplInfo	replication_info;
+	bool		request_catchup_info;
+	t_catchup_info catchup_info;
+	int			response_time_ms;
+} t_node_replication_info;
+
+/*
+ * State of a node as seen by the repmgrd on a witness, as returned by
+ * "repmgr.cluster_view()"; "last_seen" is the number of seconds since the
+ * witness last reached the node, or -1 if it never has.
+ */
+typedef struct
+{
+	int			node_id;
+	bool		reachable;
+	bool		repmgrd_running;
+	bool		in_recovery;
+	XLogRecPtr	last_wal_receive_lsn;
+	int			upstream_node_id;
+	int			upstream_last_seen;
+	int			last_seen;
+} t_cluster_node_state;
+
 typedef struct s_event_info
 {
 	char	   *node_name;
-	char	   *conninfo_str;
+	const char *conninfo_str;
 	int			node_id;
 } t_event_info;
 
@@ -306,6 +450,19 @@ typedef struct s_event_info
 	UNKNOWN_NODE_ID \
 }
 
+/*
+ * Struct to store a single "repmgr.events" row queued by repmgrd for
+ * writing to the primary.
+ */
+typedef struct
+{
+	int			node_id;
+	char	   *event;
+	bool		successful;
+	char	   *details;
+	char		event_timestamp[MONITORING_TIMESTAMP_LEN];
+} t_event_record;
+
 
 /*
  * Struct to store list of conninfo keywords and values
@@ -410,8 +567,12 @@ bool		atobool(const char *value);
 UXconn	   *establish_db_connection(const char *conninfo,
 						const bool exit_on_error);
 UXconn	   *establish_db_connection_quiet(const char *conninfo);
+int			establish_node_connections_quiet(NodeInfoList *node_list);
+int			establish_node_connections_timeout(NodeInfoList *node_list, int timeout_ms);
 UXconn	   *establish_db_connection_by_params(t_conninfo_param_list *param_list,
 								  const bool exit_on_error);
+UXconn	   *start_db_connection_by_params(t_conninfo_param_list *param_list, int *connect_timeout_ms);
+ConnStatusType poll_db_connection(UXconn *conn, UXSQLPollingStatusType *poll_status, int timeout_ms);
 UXconn	   *establish_db_connection_with_replacement_param(const char *conninfo,
 														   const char *param,
 														   const char *value,
@@ -454,6 +615,7 @@ bool		set_config(UXconn *conn, const char *config_param, const char *config_valu
 bool		set_config_bool(UXconn *conn, const char *config_param, bool state);
 int		    guc_set(UXconn *conn, const char *parameter, const char *op, const char *value);
 bool		get_ux_setting(UXconn *conn, const char *setting, char *output);
+bool		get_ux_setting_buffer(UXconn *conn, const char *setting, UXSQLExpBufferData *output);
 bool		get_ux_setting_bool(UXconn *conn, const char *setting, bool *output);
 bool		get_ux_setting_int(UXconn *conn, const char *setting, int *output);
 bool		alter_system_int(UXconn *conn, const char *name, int value);
@@ -469,7 +631,7 @@ int			get_primary_node_id(UXconn *conn);
 int			get_ready_archive_files(UXconn *conn, const char *data_directory);
 bool		identify_system(UXconn *repl_conn, t_system_identification *identification);
 uint64		system_identifier(UXconn *conn);
-TimeLineHistoryEntry *get_timeline_history(UXconn *repl_conn, TimeLineID tli);
+TimeLineHistoryEntry *get_timeline_history(UXconn *repl_conn, uint64 system_identifier, TimeLineID tli);
 pid_t		get_wal_receiver_pid(UXconn *conn);
 
 /* user/role information functions */
@@ -488,9 +650,14 @@ void		repmgrd_set_pid(UXconn *conn, pid_t repmgrd_pid, const char *pidfile);
 pid_t		repmgrd_get_pid(UXconn *conn);
 bool		repmgrd_is_running(UXconn *conn);
 bool		repmgrd_is_paused(UXconn *conn);
+bool		get_repmgrd_state(UXconn *conn, t_server_type node_type, t_repmgrd_state *state);
 bool		repmgrd_pause(UXconn *conn, bool pause);
 int			repmgrd_get_upstream_node_id(UXconn *conn);
 bool		repmgrd_set_upstream_node_id(UXconn *conn, int node_id);
+int			repmgrd_get_archive_ready_files(UXconn *conn);
+bool		repmgrd_set_archive_ready_files(UXconn *conn, int archive_ready_files);
+bool		repmgrd_set_cluster_view(UXconn *conn, t_node_replication_info *nodes, int node_count);
+int			repmgrd_get_cluster_view(UXconn *conn, int max_age_ms, t_cluster_node_state **states);
 
 /* extension functions */
 ExtensionStatus get_repmgr_extension_status(UXconn *conn, t_extension_versions *extversions);
@@ -518,8 +685,11 @@ bool		get_primary_node_record(UXconn *conn, t_node_info *node_info);
 
 void        ux_get_all_node_records(UXconn *conn, NodeInfoList *node_list); //uxdb added
 bool		get_all_node_records(UXconn *conn, NodeInfoList *node_list);
+bool		get_node_records_by_id(UXconn *conn, const int *node_ids, int node_id_count, NodeInfoList *node_list);
+bool		listen_node_record_changes(UXconn *conn);
 bool		get_all_nodes_count(UXconn *conn, int *count);
 void		get_downstream_node_records(UXconn *conn, int node_id, NodeInfoList *nodes);
+void		get_other_node_records(UXconn *conn, int node_id, NodeInfoList *node_list);
 void		get_active_sibling_node_records(UXconn *conn, int node_id, int upstream_node_id, NodeInfoList *node_list);
 bool		get_child_nodes(UXconn *conn, int node_id, NodeInfoList *node_list);
 void		get_node_records_by_priority(UXconn *conn, NodeInfoList *node_list);
@@ -537,7 +707,7 @@ bool		update_node_record_set_active_standby(UXconn *conn, int this_node_id);
 bool		update_node_record_set_upstream(UXconn *conn, int this_node_id, int new_upstream_node_id);
 bool		update_node_record_status(UXconn *conn, int this_node_id, char *type, int upstream_node_id, bool active);
 bool		update_node_record_conn_priority(UXconn *conn, t_configuration_options *options);
-bool		update_node_record_slot_name(UXconn *primary_conn, int node_id, char *slot_name);
+bool		update_node_record_slot_name(UXconn *primary_conn, int node_id, const char *slot_name);
 
 bool		witness_copy_node_records(UXconn *primary_conn, UXconn *witness_conn);
 
@@ -553,26 +723,35 @@ void		config_file_list_add(t_configfile_list *list, const char *file, const char
 bool		create_event_record(UXconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details);
 bool		create_event_notification(UXconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details);
 bool		create_event_notification_extended(UXconn *conn, t_configuration_options *options, int node_id, char *event, bool successful, char *details, t_event_info *event_info);
-UXresult   *get_event_records(UXconn *conn, int node_id, const char *node_name, const char *event, bool all, int limit);
+bool		insert_event_records(UXconn *conn, t_event_record *records, int record_count);
+bool		parse_event_boundary(const char *value, char *timestamp, int *node_id, char *event);
+UXresult   *get_event_records(UXconn *conn, int node_id, const char *node_name, const char *event, const char *after, const char *before, bool all, int limit);
+int			delete_expired_event_records(UXconn *primary_conn, int retention_days, int node_id);
 
 /* replication slot functions */
-void		create_slot_name(char *slot_name, int node_id);
+const char *create_slot_name(int node_id);
 
-bool		create_replication_slot_sql(UXconn *conn, char *slot_name, UXSQLExpBufferData *error_msg);
-bool		create_replication_slot_replprot(UXconn *conn, UXconn *repl_conn, char *slot_name, UXSQLExpBufferData *error_msg);
-bool		drop_replication_slot_sql(UXconn *conn, char *slot_name);
-bool		drop_replication_slot_replprot(UXconn *repl_conn, char *slot_name);
+bool		create_replication_slot_sql(UXconn *conn, const char *slot_name, UXSQLExpBufferData *error_msg);
+bool		create_replication_slot_replprot(UXconn *conn, UXconn *repl_conn, const char *slot_name, UXSQLExpBufferData *error_msg);
+bool		drop_replication_slot_sql(UXconn *conn, const char *slot_name);
+bool		drop_replication_slot_replprot(UXconn *repl_conn, const char *slot_name);
 
-RecordStatus get_slot_record(UXconn *conn, char *slot_name, t_replication_slot *record);
+RecordStatus get_slot_record(UXconn *conn, const char *slot_name, t_replication_slot *record);
 int			get_free_replication_slot_count(UXconn *conn, int *max_replication_slots);
 int			get_inactive_replication_slots(UXconn *conn, KeyValueList *list);
 
 /* tablespace functions */
 bool		get_tablespace_name_by_location(UXconn *conn, const char *location, char *name);
+bool		get_tablespace_locations(UXconn *conn, KeyValueList *list);
+
+/* backup functions */
+XLogRecPtr	start_nonexclusive_backup(UXconn *conn, const char *label, bool fast_checkpoint);
+bool		stop_nonexclusive_backup(UXconn *conn, UXSQLExpBufferData *label_file, UXSQLExpBufferData *tablespace_map);
 
 /* asynchronous query functions */
 bool		cancel_query(UXconn *conn, int timeout);
 int			wait_connection_availability(UXconn *conn, int timeout);
+int			check_async_query_result(UXconn *conn);
 
 /* node availability functions */
 bool		is_server_available(const char *conninfo);
@@ -582,21 +761,14 @@ ExecStatusType	connection_ping(UXconn *conn);
 ExecStatusType	connection_ping_reconnect(UXconn *conn);
 
 /* monitoring functions  */
-void
-add_monitoring_record(UXconn *primary_conn,
-					  UXconn *local_conn,
-					  int primary_node_id,
-					  int local_node_id,
-					  char *monitor_standby_timestamp,
-					  XLogRecPtr primary_last_wal_location,
-					  XLogRecPtr last_wal_receive_lsn,
-					  char *last_xact_replay_timestamp,
-					  long long unsigned int replication_lag_bytes,
-					  long long unsigned int apply_lag_bytes
-);
+bool		send_monitoring_records(UXconn *primary_conn, t_monitoring_record *records, int buffer_size, int first, int record_count);
+void		set_standby_last_updated(UXconn *local_conn);
 
 int			get_number_of_monitoring_records_to_delete(UXconn *primary_conn, int keep_history, int node_id);
 bool		delete_monitoring_records(UXconn *primary_conn, int keep_history, int node_id);
+bool		is_monitoring_history_partitioned(UXconn *primary_conn);
+int			create_monitoring_history_partitions(UXconn *primary_conn, int days_ahead);
+int			drop_monitoring_history_partitions(UXconn *primary_conn, int keep_history);
 
 
 
@@ -617,12 +789,22 @@ XLogRecPtr	get_node_current_lsn(UXconn *conn);
 XLogRecPtr	get_last_wal_receive_location(UXconn *conn);
 void		init_replication_info(ReplInfo *replication_info);
 bool		get_replication_info(UXconn *conn, t_server_type node_type, ReplInfo *replication_info);
+void		init_standby_status(t_standby_status *standby_status);
+bool		get_standby_status(UXconn *local_conn, UXconn *primary_conn, t_standby_status *standby_status);
+int			get_node_replication_info_parallel(t_node_replication_info *nodes, int node_count, int timeout_ms);
 int			get_replication_lag_seconds(UXconn *conn);
 TimeLineID	get_node_timeline(UXconn *conn, char *timeline_id_str);
 void		get_node_replication_stats(UXconn *conn, t_node_info *node_info);
 NodeAttached is_downstream_node_attached(UXconn *conn, char *node_name, char **node_state);
 NodeAttached is_downstream_node_attached_quiet(UXconn *conn, char *node_name, char **node_state);
+bool		get_replication_snapshot(UXconn *conn, const char *application_name, t_replication_snapshot *snapshot);
+void		clear_replication_snapshot(t_replication_snapshot *snapshot);
+t_replication_stat *find_replication_stat(t_replication_snapshot *snapshot, const char *application_name);
+NodeAttached get_snapshot_node_attached(t_replication_snapshot *snapshot, const char *node_name, char **node_state, bool quiet);
+int			count_replication_stats(t_replication_snapshot *snapshot, const char *sync_state);
 void		set_upstream_last_seen(UXconn *conn, int upstream_node_id);
+void		record_lag_sample(UXconn *conn);
+bool		get_catchup_info(UXconn *conn, t_catchup_info *catchup_info);
 int			get_upstream_last_seen(UXconn *conn, t_server_type node_type);
 
 bool		is_wal_replay_paused(UXconn *conn, bool check_pending_wal);
@@ -637,11 +819,16 @@ const char *print_uxsqlping_status(UXPing ping_status);
 /*uxdb:*/
 void get_ux_size_pretty(UXconn *conn, long long unsigned int lag_bytes, char *lag_str);
 /* uxdb: VIP manager functions */
-bool bind_virtual_ip(const char *vip, const char *network_card);
-bool unbind_virtual_ip(const char *vip, const char *network_card);
+/* maximum number, and length, of comma-separated virtual ips / network cards */
+#define MAX_AMOUNT		16
+#define MAX_LENGTH		64
+
+int parse_multi_networkcard(const char *pSrc, char **pArray);
+bool bind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
+bool unbind_virtual_ip(const char *vip, const char *network_card, const char *uxdb_passwd);
 bool check_vip_conf(const char *vip, const char *network_card);
 bool get_virtual_ip(UXconn *conn, int primary_id, char *virtual_ip);
 bool get_network_card(UXconn *conn, int primary_id, char *network_card);
-void new_primary_execute_checkpoint(UXconn *conn);
+UXconn *new_primary_request_checkpoint(const char *conninfo);
 
 #endif							/* _REPMGR_DBUTILS_H_ */
@@ -439,6 +439,84 @@ create_ux_dir(const char *path, bool force)
 
 
 
+/*
+ * Determine whether a file in "archive_status" marks a WAL file awaiting
+ * archiving; anything ending in ".ready" is counted. For a more precise
+ * implementation see: src/backend/uxmaster/uxarch.c
+ */
+bool
+is_archive_ready_file(const char *name)
+{
+	int			namelen = (int) strlen(name);
+
+	if (namelen < 6)
+		return false;
+
+	return strcmp(name + namelen - 6, ".ready") == 0;
+}
+
+
+/*
+ * Count the ".ready" files in the provided "archive_status" directory.
+ *
+ * The entry type reported by readdir() is used where the filesystem
+ * provides it, so with a large backlog we don't need to stat() every file;
+ * only entries whose type is unknown, or which are symlinks, are checked.
+ *
+ * Returns -1 if the directory can't be read, with errno set.
+ */
+int
+count_ready_archive_files(const char *archive_status_dir)
+{
+	struct dirent *arcdir_ent;
+	DIR		   *arcdir;
+	int			ready_count = 0;
+
+	arcdir = opendir(archive_status_dir);
+
+	if (arcdir == NULL)
+		return -1;
+
+	while ((arcdir_ent = readdir(arcdir)) != NULL)
+	{
+		if (is_archive_ready_file(arcdir_ent->d_name) == false)
+			continue;
+
+#ifdef DT_REG
+		if (arcdir_ent->d_type == DT_REG)
+		{
+			ready_count++;
+			continue;
+		}
+
+		if (arcdir_ent->d_type != DT_UNKNOWN && arcdir_ent->d_type != DT_LNK)
+			continue;
+#endif
+
+		/* skip non-files */
+		{
+			struct stat statbuf;
+			char		file_path[MAXUXPATH + sizeof(arcdir_ent->d_name)];
+
+			snprintf(file_path, sizeof(file_path),
+					 "%s/%s",
+					 archive_status_dir,
+					 arcdir_ent->d_name);
+
+			if (stat(file_path, &statbuf) == 0 && !S_ISREG(statbuf.st_mode))
+				continue;
+		}
+
+		ready_count++;
+	}
+
+	closedir(arcdir);
+
+	return ready_count;
+}
+
+
+
 int
 rmdir_recursive(const char *path)
 {
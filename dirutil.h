@@ -45,4 +45,7 @@ extern UxDirState is_ux_running(const char *path);
 extern bool create_ux_dir(const char *path, bool force);
 extern int rmdir_recursive(const char *path);
 
+extern bool is_archive_ready_file(const char *name);
+extern int	count_ready_archive_files(const char *archive_status_dir);
+
 #endif
@@ -0,0 +1,413 @@
+/*
+ * eventqueue.c - deferred writing of event records and execution of
+ *                event notification commands
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Once event_queue_init() has been called (which repmgrd does at startup),
+ * create_event_notification() and friends no longer write to the events
+ * table or run "event_notification_command" themselves, but hand both over
+ * to the queues here. Notification commands are started straight away as
+ * long as fewer than "event_notification_max_parallel" are running, and
+ * are reaped (or terminated after "event_notification_timeout" seconds)
+ * by process_event_queue(), which the monitoring loops call once per
+ * iteration; event records are written to the primary there in batches.
+ * This means e.g. a failover is never held up by a slow notification
+ * script or by an unresponsive primary.
+ */
+
+#include <poll.h>
+
+#include "repmgr.h"
+#include "eventqueue.h"
+
+typedef struct
+{
+	char	   *event;
+	t_parallel_command cmd;
+} t_queued_notification;
+
+static bool event_queue_initialised = false;
+static int	event_queue_size = 0;
+static int	notification_max_parallel = 1;
+static int	notification_timeout = 0;
+
+/* event records not yet written to the primary, oldest first */
+static t_event_record *queued_records = NULL;
+static int	queued_record_count = 0;
+
+/* notifications waiting for a free slot, oldest first */
+static t_queued_notification *pending_notifications = NULL;
+static int	pending_notification_count = 0;
+
+/* notifications currently being executed */
+static t_queued_notification *running_notifications = NULL;
+static int	running_notification_count = 0;
+
+static void start_pending_notifications(void);
+static void reap_running_notifications(void);
+static void finish_notification(t_queued_notification *notification);
+static void flush_event_records(UXconn *primary_conn);
+static void free_event_record(t_event_record *record);
+
+
+void
+event_queue_init(int queue_size, int max_parallel, int timeout)
+{
+	if (event_queue_initialised == true)
+		return;
+
+	event_queue_size = queue_size;
+	notification_max_parallel = max_parallel;
+	notification_timeout = timeout;
+
+	queued_records = ux_malloc0(sizeof(t_event_record) * queue_size);
+	pending_notifications = ux_malloc0(sizeof(t_queued_notification) * queue_size);
+	running_notifications = ux_malloc0(sizeof(t_queued_notification) * max_parallel);
+
+	event_queue_initialised = true;
+
+	log_verbose(LOG_DEBUG, "event_queue_init(): queue size %i, max parallel %i, timeout %i",
+				queue_size, max_parallel, timeout);
+}
+
+
+bool
+event_queue_active(void)
+{
+	return event_queue_initialised;
+}
+
+
+/*
+ * Queue an event record for writing to the primary. If the queue is full,
+ * the oldest record is discarded.
+ */
+void
+queue_event_record(int node_id, const char *event, bool successful, const char *details, const char *event_timestamp)
+{
+	t_event_record *record = NULL;
+
+	if (queued_record_count == event_queue_size)
+	{
+		log_warning(_("event queue full, discarding oldest event record (\"%s\" for node %i)"),
+					queued_records[0].event,
+					queued_records[0].node_id);
+
+		free_event_record(&queued_records[0]);
+
+		memmove(&queued_records[0],
+				&queued_records[1],
+				sizeof(t_event_record) * (event_queue_size - 1));
+
+		queued_record_count--;
+	}
+
+	record = &queued_records[queued_record_count++];
+
+	record->node_id = node_id;
+	record->successful = successful;
+
+	record->event = ux_malloc0(strlen(event) + 1);
+	strncpy(record->event, event, strlen(event));
+
+	record->details = NULL;
+	if (details != NULL)
+	{
+		record->details = ux_malloc0(strlen(details) + 1);
+		strncpy(record->details, details, strlen(details));
+	}
+
+	snprintf(record->event_timestamp, sizeof(record->event_timestamp), "%s", event_timestamp);
+}
+
+
+/*
+ * Queue an already-parsed notification command, starting it immediately
+ * if the concurrency limit allows. If the queue is full, the oldest
+ * command not yet started is discarded.
+ */
+void
+queue_event_notification(const char *event, const char *command)
+{
+	t_queued_notification *notification = NULL;
+
+	reap_running_notifications();
+
+	if (pending_notification_count == event_queue_size)
+	{
+		log_warning(_("event queue full, discarding notification command for event \"%s\""),
+					pending_notifications[0].event);
+		log_detail("%s", pending_notifications[0].cmd.command);
+
+		pfree(pending_notifications[0].event);
+		pfree(pending_notifications[0].cmd.command);
+
+		memmove(&pending_notifications[0],
+				&pending_notifications[1],
+				sizeof(t_queued_notification) * (event_queue_size - 1));
+
+		pending_notification_count--;
+	}
+
+	notification = &pending_notifications[pending_notification_count++];
+
+	memset(notification, 0, sizeof(t_queued_notification));
+
+	notification->event = ux_malloc0(strlen(event) + 1);
+	strncpy(notification->event, event, strlen(event));
+
+	notification->cmd.node_id = UNKNOWN_NODE_ID;
+	notification->cmd.command = ux_malloc0(strlen(command) + 1);
+	strncpy(notification->cmd.command, command, strlen(command));
+
+	start_pending_notifications();
+}
+
+
+/*
+ * Housekeeping to be called regularly: reap completed notification
+ * commands, start pending ones, and write queued event records if
+ * "primary_conn" is usable.
+ *
+ * This never waits for a notification command.
+ */
+void
+process_event_queue(UXconn *primary_conn)
+{
+	if (event_queue_initialised == false)
+		return;
+
+	reap_running_notifications();
+	start_pending_notifications();
+
+	flush_event_records(primary_conn);
+}
+
+
+/*
+ * Called on shutdown: write any queued event records, then wait for
+ * pending notification commands to complete. If "event_notification_timeout"
+ * is set, commands still outstanding after that many seconds are
+ * terminated or discarded.
+ */
+void
+drain_event_queue(UXconn *primary_conn)
+{
+	instr_time	start_time;
+
+	if (event_queue_initialised == false)
+		return;
+
+	flush_event_records(primary_conn);
+
+	if (queued_record_count > 0)
+	{
+		log_warning(_("%i event record(s) could not be written to the primary"),
+					queued_record_count);
+	}
+
+	if (running_notification_count == 0 && pending_notification_count == 0)
+		return;
+
+	log_info(_("waiting for %i event notification command(s) to complete"),
+			 running_notification_count + pending_notification_count);
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (running_notification_count > 0 || pending_notification_count > 0)
+	{
+		instr_time	elapsed;
+
+		reap_running_notifications();
+		start_pending_notifications();
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+
+		if (notification_timeout > 0 && INSTR_TIME_GET_DOUBLE(elapsed) >= notification_timeout)
+		{
+			int			i;
+
+			for (i = 0; i < pending_notification_count; i++)
+			{
+				log_warning(_("notification command for event \"%s\" not executed"),
+							pending_notifications[i].event);
+				log_detail("%s", pending_notifications[i].cmd.command);
+				pfree(pending_notifications[i].event);
+				pfree(pending_notifications[i].cmd.command);
+			}
+
+			pending_notification_count = 0;
+
+			for (i = 0; i < running_notification_count; i++)
+			{
+				terminate_parallel_command(&running_notifications[i].cmd);
+				finish_notification(&running_notifications[i]);
+			}
+
+			running_notification_count = 0;
+			break;
+		}
+
+		(void) poll(NULL, 0, 100);
+	}
+}
+
+
+static void
+start_pending_notifications(void)
+{
+	while (pending_notification_count > 0 && running_notification_count < notification_max_parallel)
+	{
+		t_queued_notification *notification = &running_notifications[running_notification_count];
+
+		*notification = pending_notifications[0];
+
+		memmove(&pending_notifications[0],
+				&pending_notifications[1],
+				sizeof(t_queued_notification) * (pending_notification_count - 1));
+		pending_notification_count--;
+
+		log_info(_("executing notification command for event \"%s\""),
+				 notification->event);
+		log_detail(_("command is:\n  %s"), notification->cmd.command);
+
+		if (start_parallel_command(&notification->cmd) == false)
+		{
+			finish_notification(notification);
+			continue;
+		}
+
+		running_notification_count++;
+	}
+}
+
+
+static void
+reap_running_notifications(void)
+{
+	int			i = 0;
+
+	while (i < running_notification_count)
+	{
+		t_queued_notification *notification = &running_notifications[i];
+
+		if (poll_parallel_command(&notification->cmd, notification_timeout) == false)
+		{
+			i++;
+			continue;
+		}
+
+		finish_notification(notification);
+
+		running_notification_count--;
+		memmove(&running_notifications[i],
+				&running_notifications[i + 1],
+				sizeof(t_queued_notification) * (running_notification_count - i));
+	}
+}
+
+
+/*
+ * Report the outcome of a notification command which has exited, failed
+ * to start or been terminated, and free it.
+ */
+static void
+finish_notification(t_queued_notification *notification)
+{
+	t_parallel_command *cmd = &notification->cmd;
+
+	if (cmd->status != PCMD_COMPLETED || cmd->return_value != 0)
+	{
+		log_warning(_("unable to execute event notification command"));
+		log_detail(_("parsed event notification command was:\n  %s"), cmd->command);
+	}
+	else
+	{
+		log_verbose(LOG_DEBUG, "notification command for event \"%s\" completed in %i ms",
+					notification->event, cmd->elapsed_ms);
+	}
+
+	if (cmd->output.data != NULL && cmd->output.len > 0)
+		log_verbose(LOG_DEBUG, "notification command output:\n%s", cmd->output.data);
+
+	clear_parallel_commands(cmd, 1);
+	pfree(cmd->command);
+	pfree(notification->event);
+}
+
+
+/*
+ * Write queued event records to the primary, in batches of up to
+ * EVENT_QUEUE_BATCH_SIZE records.
+ *
+ * Nothing is done if the connection is unusable, has a query in progress,
+ * or is not to a primary; the records
+ * are retained for a later call. A batch which fails for any reason other
+ * than the connection being lost is discarded, so one bad record cannot
+ * block the queue.
+ */
+static void
+flush_event_records(UXconn *primary_conn)
+{
+	if (queued_record_count == 0 || primary_conn == NULL)
+		return;
+
+	if (UXSQLstatus(primary_conn) != CONNECTION_OK || UXSQLtransactionStatus(primary_conn) != UXSQLTRANS_IDLE)
+		return;
+
+	if (get_recovery_type(primary_conn) != RECTYPE_PRIMARY)
+		return;
+
+	while (queued_record_count > 0)
+	{
+		int			batch_size = Min(queued_record_count, EVENT_QUEUE_BATCH_SIZE);
+		int			i;
+
+		if (insert_event_records(primary_conn, queued_records, batch_size) == false
+			&& UXSQLstatus(primary_conn) != CONNECTION_OK)
+		{
+			log_verbose(LOG_WARNING, _("%i event record(s) retained for resending"),
+						queued_record_count);
+			return;
+		}
+
+		for (i = 0; i < batch_size; i++)
+			free_event_record(&queued_records[i]);
+
+		queued_record_count -= batch_size;
+
+		memmove(&queued_records[0],
+				&queued_records[batch_size],
+				sizeof(t_event_record) * queued_record_count);
+	}
+}
+
+
+static void
+free_event_record(t_event_record *record)
+{
+	if (record->event != NULL)
+		pfree(record->event);
+
+	if (record->details != NULL)
+		pfree(record->details);
+
+	record->event = NULL;
+	record->details = NULL;
+}
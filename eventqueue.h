@@ -0,0 +1,35 @@
+/*
+ * eventqueue.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+/* maximum number of event records written with a single INSERT */
+#define EVENT_QUEUE_BATCH_SIZE		100
+
+extern void event_queue_init(int queue_size, int max_parallel, int timeout);
+extern bool event_queue_active(void);
+
+extern void queue_event_record(int node_id, const char *event, bool successful, const char *details, const char *event_timestamp);
+extern void queue_event_notification(const char *event, const char *command);
+
+extern void process_event_queue(UXconn *primary_conn);
+extern void drain_event_queue(UXconn *primary_conn);
+
+#endif							/* _EVENTQUEUE_H_ */
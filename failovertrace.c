@@ -0,0 +1,257 @@
+/*
+ * failovertrace.c - timing of the individual phases of a failover
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * A trace is begun when a standby determines its primary is unreachable
+ * and finished once the failover has reached an outcome, at which point
+ * the time spent in each phase is written as a single JSON object to the
+ * log and as the details of a "repmgrd_failover_trace" event.
+ *
+ * Phases may be nested, e.g. "failover_delay" is started from within the
+ * election; time spent in the inner phase is not counted towards the
+ * enclosing one, so the phase durations add up to the total. Calls made
+ * while no trace is active are ignored, which means the instrumented
+ * functions need not care whether they are part of a failover.
+ */
+
+#include <sys/time.h>
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "failovertrace.h"
+
+typedef struct
+{
+	bool		active;
+	int			failed_node_id;
+	struct timeval detected_at;
+	instr_time	origin;
+	instr_time	phase_start[FAILOVER_PHASE_COUNT];
+	double		start_ms[FAILOVER_PHASE_COUNT];
+	double		duration_ms[FAILOVER_PHASE_COUNT];
+	int			count[FAILOVER_PHASE_COUNT];
+	FailoverPhase stack[FAILOVER_PHASE_COUNT];
+	int			depth;
+} t_failover_trace;
+
+static t_failover_trace failover_trace;
+
+static const char *failover_phase_names[FAILOVER_PHASE_COUNT] = {
+	"detection",
+	"reconnect",
+	"failover_delay",
+	"election",
+	"promote",
+	"vip_bind",
+	"notify_followers",
+	"wait_notification",
+	"follow"
+};
+
+static double _elapsed_ms(instr_time *start, instr_time *end);
+
+
+/*
+ * Begin a new trace, discarding any previous one which was not finished.
+ *
+ * "upstream_last_seen" is the time the failed node was last known to be
+ * available; the interval between it and "detected" is recorded as the
+ * detection phase. If it's not set, the trace starts at "detected".
+ */
+void
+failover_trace_begin(int failed_node_id, instr_time *upstream_last_seen, instr_time *detected)
+{
+	memset(&failover_trace, 0, sizeof(t_failover_trace));
+
+	failover_trace.active = true;
+	failover_trace.failed_node_id = failed_node_id;
+	gettimeofday(&failover_trace.detected_at, NULL);
+
+	if (upstream_last_seen != NULL && !INSTR_TIME_IS_ZERO(*upstream_last_seen))
+	{
+		failover_trace.origin = *upstream_last_seen;
+		failover_trace.count[FAILOVER_PHASE_DETECTION] = 1;
+		failover_trace.duration_ms[FAILOVER_PHASE_DETECTION] = _elapsed_ms(upstream_last_seen, detected);
+	}
+	else
+	{
+		failover_trace.origin = *detected;
+	}
+
+	log_verbose(LOG_DEBUG, "failover_trace_begin(): failed node is %i", failed_node_id);
+}
+
+
+/*
+ * Abandon the current trace without reporting it, e.g. because the
+ * upstream node has reappeared.
+ */
+void
+failover_trace_discard(void)
+{
+	failover_trace.active = false;
+}
+
+
+bool
+failover_trace_active(void)
+{
+	return failover_trace.active;
+}
+
+
+void
+failover_trace_phase_start(FailoverPhase phase)
+{
+	instr_time	now;
+
+	if (failover_trace.active == false)
+		return;
+
+	/* can only happen if a phase is started recursively */
+	if (failover_trace.depth == FAILOVER_PHASE_COUNT)
+		return;
+
+	INSTR_TIME_SET_CURRENT(now);
+
+	/* suspend the enclosing phase, if any */
+	if (failover_trace.depth > 0)
+	{
+		FailoverPhase outer = failover_trace.stack[failover_trace.depth - 1];
+
+		failover_trace.duration_ms[outer] += _elapsed_ms(&failover_trace.phase_start[outer], &now);
+	}
+
+	if (failover_trace.count[phase] == 0)
+		failover_trace.start_ms[phase] = _elapsed_ms(&failover_trace.origin, &now);
+
+	failover_trace.count[phase]++;
+	failover_trace.phase_start[phase] = now;
+	failover_trace.stack[failover_trace.depth++] = phase;
+}
+
+
+void
+failover_trace_phase_end(FailoverPhase phase)
+{
+	instr_time	now;
+
+	if (failover_trace.active == false || failover_trace.depth == 0)
+		return;
+
+	if (failover_trace.stack[failover_trace.depth - 1] != phase)
+	{
+		log_verbose(LOG_DEBUG, "failover_trace_phase_end(): phase \"%s\" is not the current phase \"%s\"",
+					failover_phase_names[phase],
+					failover_phase_names[failover_trace.stack[failover_trace.depth - 1]]);
+		return;
+	}
+
+	INSTR_TIME_SET_CURRENT(now);
+
+	failover_trace.duration_ms[phase] += _elapsed_ms(&failover_trace.phase_start[phase], &now);
+	failover_trace.depth--;
+
+	/* resume the enclosing phase, if any */
+	if (failover_trace.depth > 0)
+		failover_trace.phase_start[failover_trace.stack[failover_trace.depth - 1]] = now;
+}
+
+
+/*
+ * Finish the current trace, closing any phases still open, and report it.
+ *
+ * "outcome" should be one of the fixed strings returned by
+ * format_failover_state() or similar, as it is not escaped.
+ */
+void
+failover_trace_finish(UXconn *conn, int new_primary_id, const char *outcome)
+{
+	UXSQLExpBufferData trace;
+	instr_time	now;
+	bool		first = true;
+	int			i;
+
+	if (failover_trace.active == false)
+		return;
+
+	while (failover_trace.depth > 0)
+		failover_trace_phase_end(failover_trace.stack[failover_trace.depth - 1]);
+
+	INSTR_TIME_SET_CURRENT(now);
+
+	initUXSQLExpBuffer(&trace);
+
+	appendUXSQLExpBuffer(&trace,
+						 "{\"node_id\": %i, \"failed_node_id\": %i, \"detected_at\": %ld.%03ld, \"new_primary_id\": ",
+						 config_file_options.node_id,
+						 failover_trace.failed_node_id,
+						 (long) failover_trace.detected_at.tv_sec,
+						 (long) (failover_trace.detected_at.tv_usec / 1000));
+
+	if (new_primary_id == UNKNOWN_NODE_ID)
+		appendUXSQLExpBufferStr(&trace, "null");
+	else
+		appendUXSQLExpBuffer(&trace, "%i", new_primary_id);
+
+	appendUXSQLExpBuffer(&trace,
+						 ", \"outcome\": \"%s\", \"total_ms\": %.3f, \"phases\": {",
+						 outcome,
+						 _elapsed_ms(&failover_trace.origin, &now));
+
+	for (i = 0; i < FAILOVER_PHASE_COUNT; i++)
+	{
+		if (failover_trace.count[i] == 0)
+			continue;
+
+		appendUXSQLExpBuffer(&trace,
+							 "%s\"%s\": {\"start_ms\": %.3f, \"duration_ms\": %.3f, \"count\": %i}",
+							 first == true ? "" : ", ",
+							 failover_phase_names[i],
+							 failover_trace.start_ms[i],
+							 failover_trace.duration_ms[i],
+							 failover_trace.count[i]);
+		first = false;
+	}
+
+	appendUXSQLExpBufferStr(&trace, "}}");
+
+	log_info(_("failover trace: %s"), trace.data);
+
+	create_event_notification(conn,
+							  &config_file_options,
+							  config_file_options.node_id,
+							  "repmgrd_failover_trace",
+							  true,
+							  trace.data);
+
+	termUXSQLExpBuffer(&trace);
+
+	failover_trace.active = false;
+}
+
+
+static double
+_elapsed_ms(instr_time *start, instr_time *end)
+{
+	instr_time	elapsed = *end;
+
+	INSTR_TIME_SUBTRACT(elapsed, *start);
+
+	return INSTR_TIME_GET_MILLISEC(elapsed);
+}
@@ -0,0 +1,46 @@
+/*
+ * failovertrace.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FAILOVERTRACE_H_
+#define _FAILOVERTRACE_H_
+
+typedef enum
+{
+	FAILOVER_PHASE_DETECTION = 0,
+	FAILOVER_PHASE_RECONNECT,
+	FAILOVER_PHASE_FAILOVER_DELAY,
+	FAILOVER_PHASE_ELECTION,
+	FAILOVER_PHASE_PROMOTE,
+	FAILOVER_PHASE_VIP_BIND,
+	FAILOVER_PHASE_NOTIFY_FOLLOWERS,
+	FAILOVER_PHASE_WAIT_NOTIFICATION,
+	FAILOVER_PHASE_FOLLOW,
+	FAILOVER_PHASE_COUNT
+} FailoverPhase;
+
+extern void failover_trace_begin(int failed_node_id, instr_time *upstream_last_seen, instr_time *detected);
+extern void failover_trace_discard(void);
+extern bool failover_trace_active(void);
+
+extern void failover_trace_phase_start(FailoverPhase phase);
+extern void failover_trace_phase_end(FailoverPhase phase);
+
+extern void failover_trace_finish(UXconn *conn, int new_primary_id, const char *outcome);
+
+#endif							/* _FAILOVERTRACE_H_ */
@@ -0,0 +1,524 @@
+/*
+ * filecopy.c - size-balanced parallel rsync file transfer
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * A single rsync process is bound to one CPU core (checksumming and, if
+ * enabled, compression), which on large clusters is well below what the
+ * network can carry. Here the list of files to copy is split into shards
+ * of roughly equal total size, and each shard is transferred by its own
+ * "rsync --files-from" process, executed concurrently via
+ * run_parallel_commands().
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "repmgr.h"
+#include "filecopy.h"
+
+static int	compare_copy_file_path(const void *a, const void *b);
+static int	compare_copy_file_size_desc(const void *a, const void *b);
+static void format_byte_count(uint64 bytes, char *buf, size_t buflen);
+
+
+void
+copy_file_list_append(t_copy_file_list *list, const char *path, uint64 size)
+{
+	if (list->count == list->capacity)
+	{
+		int			new_capacity = list->capacity == 0 ? 1024 : list->capacity * 2;
+		t_copy_file *new_files = ux_malloc0(sizeof(t_copy_file) * new_capacity);
+
+		if (list->files != NULL)
+		{
+			memcpy(new_files, list->files, sizeof(t_copy_file) * list->count);
+			pfree(list->files);
+		}
+
+		list->files = new_files;
+		list->capacity = new_capacity;
+	}
+
+	list->files[list->count].path = ux_malloc0(strlen(path) + 1);
+	strcpy(list->files[list->count].path, path);
+	list->files[list->count].size = size;
+	list->count++;
+}
+
+
+/*
+ * Load a file list in "rsync --files-from" format (one relative path
+ * per line); sizes are initialised to zero.
+ */
+bool
+copy_file_list_load(t_copy_file_list *list, const char *filename)
+{
+	FILE	   *fp = NULL;
+	char		line[MAXLEN] = "";
+
+	fp = fopen(filename, "r");
+
+	if (fp == NULL)
+	{
+		log_error(_("unable to open file list \"%s\""), filename);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		size_t		len = strlen(line);
+
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		if (len == 0)
+			continue;
+
+		copy_file_list_append(list, line, 0);
+	}
+
+	fclose(fp);
+
+	return true;
+}
+
+
+void
+copy_file_list_free(t_copy_file_list *list)
+{
+	int			i;
+
+	for (i = 0; i < list->count; i++)
+		pfree(list->files[i].path);
+
+	if (list->files != NULL)
+		pfree(list->files);
+
+	list->files = NULL;
+	list->count = 0;
+	list->capacity = 0;
+}
+
+
+/*
+ * Populate the size of each file in "list" from a single remote
+ * "find -printf" invocation below "remote_path" on "host".
+ *
+ * Files not present on the remote host keep a size of zero; they'll
+ * still be passed to rsync, which will report them as appropriate.
+ */
+bool
+get_remote_file_sizes(const char *host, const char *remote_path, t_copy_file_list *list)
+{
+	UXSQLExpBufferData remote_cmd;
+	UXSQLExpBufferData ssh_cmd;
+	t_copy_file_list remote_list = T_COPY_FILE_LIST_INITIALIZER;
+	FILE	   *fp = NULL;
+	char		line[MAXLEN] = "";
+	int			i;
+
+	initUXSQLExpBuffer(&remote_cmd);
+	appendUXSQLExpBuffer(&remote_cmd,
+						 "\"find '%s' -type f -printf '%%s %%P\\n'\"",
+						 remote_path);
+
+	initUXSQLExpBuffer(&ssh_cmd);
+	make_remote_command(host, "", remote_cmd.data, config_file_options.ssh_options, &ssh_cmd);
+	termUXSQLExpBuffer(&remote_cmd);
+
+	log_verbose(LOG_DEBUG, "get_remote_file_sizes():\n  %s", ssh_cmd.data);
+
+	fp = popen(ssh_cmd.data, "r");
+
+	if (fp == NULL)
+	{
+		log_error(_("unable to execute remote command:\n  %s"), ssh_cmd.data);
+		termUXSQLExpBuffer(&ssh_cmd);
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char	   *path = NULL;
+		size_t		len = strlen(line);
+		uint64		size;
+
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		size = strtoull(line, &path, 10);
+
+		if (path == line || *path != ' ')
+			continue;
+
+		copy_file_list_append(&remote_list, path + 1, size);
+	}
+
+	if (pclose(fp) != 0)
+	{
+		log_warning(_("unable to retrieve file sizes from host \"%s\""), host);
+		log_detail(_("command was:\n  %s"), ssh_cmd.data);
+		termUXSQLExpBuffer(&ssh_cmd);
+		copy_file_list_free(&remote_list);
+		return false;
+	}
+
+	termUXSQLExpBuffer(&ssh_cmd);
+
+	if (remote_list.count > 0)
+	{
+		qsort(remote_list.files, remote_list.count, sizeof(t_copy_file), compare_copy_file_path);
+
+		for (i = 0; i < list->count; i++)
+		{
+			t_copy_file *match = bsearch(&list->files[i], remote_list.files, remote_list.count,
+										 sizeof(t_copy_file), compare_copy_file_path);
+
+			if (match != NULL)
+				list->files[i].size = match->size;
+		}
+	}
+
+	copy_file_list_free(&remote_list);
+
+	return true;
+}
+
+
+/*
+ * Retrieve the regular files below "remote_path" on "host" whose names
+ * match "name_pattern", with their sizes, from a single remote "find"
+ * invocation. "subdirs" is a space-separated list of directories below
+ * "remote_path" to search; the paths returned are relative to
+ * "remote_path".
+ */
+bool
+get_remote_file_list(const char *host, const char *remote_path, const char *subdirs,
+					 const char *name_pattern, t_copy_file_list *list)
+{
+	UXSQLExpBufferData remote_cmd;
+	UXSQLExpBufferData ssh_cmd;
+	FILE	   *fp = NULL;
+	char		line[MAXLEN] = "";
+
+	initUXSQLExpBuffer(&remote_cmd);
+	appendUXSQLExpBuffer(&remote_cmd,
+						 "\"cd '%s' && find %s -type f -name '%s' -printf '%%s %%p\\n'\"",
+						 remote_path, subdirs, name_pattern);
+
+	initUXSQLExpBuffer(&ssh_cmd);
+	make_remote_command(host, "", remote_cmd.data, config_file_options.ssh_options, &ssh_cmd);
+	termUXSQLExpBuffer(&remote_cmd);
+
+	log_verbose(LOG_DEBUG, "get_remote_file_list():\n  %s", ssh_cmd.data);
+
+	fp = popen(ssh_cmd.data, "r");
+
+	if (fp == NULL)
+	{
+		log_error(_("unable to execute remote command:\n  %s"), ssh_cmd.data);
+		termUXSQLExpBuffer(&ssh_cmd);
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char	   *path = NULL;
+		size_t		len = strlen(line);
+		uint64		size;
+
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		size = strtoull(line, &path, 10);
+
+		if (path == line || *path != ' ')
+			continue;
+
+		path++;
+
+		if (strncmp(path, "./", 2) == 0)
+			path += 2;
+
+		copy_file_list_append(list, path, size);
+	}
+
+	if (pclose(fp) != 0)
+	{
+		log_error(_("unable to retrieve the file list from host \"%s\""), host);
+		log_detail(_("command was:\n  %s"), ssh_cmd.data);
+		termUXSQLExpBuffer(&ssh_cmd);
+		return false;
+	}
+
+	termUXSQLExpBuffer(&ssh_cmd);
+
+	return true;
+}
+
+
+/*
+ * Copy the files in "list" from "host:remote_path" to "local_path" using
+ * up to "workers" concurrent rsync processes.
+ *
+ * See multi_source_copy_files() for details.
+ */
+bool
+parallel_copy_files(const char *host, const char *remote_path, const char *local_path,
+					t_copy_file_list *list, int workers, const char *rsync_flags,
+					const char *work_directory)
+{
+	t_copy_source source;
+
+	memset(&source, 0, sizeof(t_copy_source));
+	source.node_id = UNKNOWN_NODE_ID;
+	snprintf(source.host, sizeof(source.host), "%s", host);
+	snprintf(source.path, sizeof(source.path), "%s", remote_path);
+
+	return multi_source_copy_files(&source, 1, local_path, list, workers,
+								   rsync_flags, work_directory);
+}
+
+
+/*
+ * Copy the files in "list" to "local_path", spreading them across the
+ * "source_count" sources, each of which must provide an identical copy of
+ * the files below its own path, with up to "workers" concurrent rsync
+ * processes per source.
+ *
+ * Files are assigned to shards largest-first, each going to the shard
+ * with the smallest total so far, which keeps the shards close to equal in
+ * size even with a few very large relation segments; as every source gets
+ * the same number of shards, each also serves about the same amount of
+ * data. One shard list per worker is written to "work_directory" and
+ * removed afterwards.
+ *
+ * "rsync_flags" is passed to each rsync invocation as-is; "--files-from"
+ * and the source/destination are added here.
+ *
+ * Returns false if any worker failed.
+ */
+bool
+multi_source_copy_files(t_copy_source *sources, int source_count, const char *local_path,
+						t_copy_file_list *list, int workers, const char *rsync_flags,
+						const char *work_directory)
+{
+	t_parallel_command *tasks = NULL;
+	uint64	   *shard_bytes = NULL;
+	int		   *shard_files = NULL;
+	FILE	  **shard_fp = NULL;
+	char		shard_filename[MAXUXPATH] = "";
+	char		bytes_str[MAXLEN] = "";
+	uint64		total_bytes = 0;
+	int			total_elapsed_ms = 0;
+	int			successful = 0;
+	int			shards;
+	bool		success = true;
+	int			i;
+
+	if (list->count == 0 || source_count < 1)
+		return true;
+
+	if (workers < 1)
+		workers = 1;
+	if (workers * source_count > MAX_CLONE_PARALLEL_WORKERS)
+		workers = MAX_CLONE_PARALLEL_WORKERS / source_count;
+	if (workers < 1)
+		workers = 1;
+
+	shards = workers * source_count;
+
+	if (shards > list->count)
+		shards = list->count;
+
+	shard_bytes = ux_malloc0(sizeof(uint64) * shards);
+	shard_files = ux_malloc0(sizeof(int) * shards);
+	shard_fp = ux_malloc0(sizeof(FILE *) * shards);
+
+	for (i = 0; i < shards; i++)
+	{
+		snprintf(shard_filename, sizeof(shard_filename), "%s/shard.%i.txt", work_directory, i);
+
+		shard_fp[i] = fopen(shard_filename, "w");
+
+		if (shard_fp[i] == NULL)
+		{
+			log_error(_("unable to create file list \"%s\""), shard_filename);
+			log_detail("%s", strerror(errno));
+
+			while (--i >= 0)
+			{
+				fclose(shard_fp[i]);
+				snprintf(shard_filename, sizeof(shard_filename), "%s/shard.%i.txt", work_directory, i);
+				unlink(shard_filename);
+			}
+
+			pfree(shard_fp);
+			pfree(shard_files);
+			pfree(shard_bytes);
+			return false;
+		}
+	}
+
+	qsort(list->files, list->count, sizeof(t_copy_file), compare_copy_file_size_desc);
+
+	for (i = 0; i < list->count; i++)
+	{
+		int			shard = 0;
+		int			j;
+
+		/* ties (e.g. sizes unknown) go to the shard with the fewest files */
+		for (j = 1; j < shards; j++)
+		{
+			if (shard_bytes[j] < shard_bytes[shard]
+				|| (shard_bytes[j] == shard_bytes[shard] && shard_files[j] < shard_files[shard]))
+				shard = j;
+		}
+
+		fprintf(shard_fp[shard], "%s\n", list->files[i].path);
+		shard_bytes[shard] += list->files[i].size;
+		shard_files[shard]++;
+		total_bytes += list->files[i].size;
+	}
+
+	tasks = ux_malloc0(sizeof(t_parallel_command) * shards);
+
+	for (i = 0; i < shards; i++)
+	{
+		UXSQLExpBufferData command;
+
+		/* consecutive shards go to different sources */
+		t_copy_source *source = &sources[i % source_count];
+
+		fclose(shard_fp[i]);
+
+		initUXSQLExpBuffer(&command);
+		appendUXSQLExpBuffer(&command,
+							 "rsync %s --files-from=%s/shard.%i.txt %s:%s/ %s/",
+							 rsync_flags, work_directory, i,
+							 source->host, source->path, local_path);
+
+		format_byte_count(shard_bytes[i], bytes_str, sizeof(bytes_str));
+		log_verbose(LOG_INFO, _("copy worker %i/%i (host \"%s\"): %i files, %s"),
+					i + 1, shards, source->host, shard_files[i], bytes_str);
+		log_debug("copy worker %i/%i:\n  %s", i + 1, shards, command.data);
+
+		tasks[i].node_id = i + 1;
+		tasks[i].command = command.data;
+	}
+
+	format_byte_count(total_bytes, bytes_str, sizeof(bytes_str));
+
+	if (source_count == 1)
+	{
+		log_notice(_("copying %i files (%s) from \"%s:%s\" with %i parallel workers"),
+				   list->count, bytes_str, sources[0].host, sources[0].path, shards);
+	}
+	else
+	{
+		log_notice(_("copying %i files (%s) from %i sources with %i parallel workers"),
+				   list->count, bytes_str, source_count, shards);
+	}
+
+	(void) run_parallel_commands(tasks, shards, shards, 0, 0);
+
+	for (i = 0; i < shards; i++)
+	{
+		double		seconds = (double) tasks[i].elapsed_ms / 1000.0;
+		double		mb_per_sec = seconds > 0 ? ((double) shard_bytes[i] / (1024.0 * 1024.0)) / seconds : 0;
+
+		format_byte_count(shard_bytes[i], bytes_str, sizeof(bytes_str));
+
+		/* exit code 24 indicates vanished files, which isn't a problem for us */
+		if (tasks[i].status == PCMD_COMPLETED
+			&& (tasks[i].return_value == 0 || tasks[i].return_value == 24))
+		{
+			successful++;
+			log_info(_("copy worker %i/%i completed: %i files, %s in %.1f seconds (%.1f MB/s)"),
+					 i + 1, shards, shard_files[i], bytes_str, seconds, mb_per_sec);
+		}
+		else
+		{
+			success = false;
+			log_error(_("copy worker %i/%i failed (%s, exit code %i)"),
+					  i + 1, shards,
+					  format_parallel_command_status(tasks[i].status),
+					  tasks[i].return_value);
+			log_detail(_("command was:\n  %s"), tasks[i].command);
+		}
+
+		if (tasks[i].elapsed_ms > total_elapsed_ms)
+			total_elapsed_ms = tasks[i].elapsed_ms;
+
+		snprintf(shard_filename, sizeof(shard_filename), "%s/shard.%i.txt", work_directory, i);
+		unlink(shard_filename);
+
+		pfree(tasks[i].command);
+	}
+
+	if (total_elapsed_ms > 0)
+	{
+		format_byte_count(total_bytes, bytes_str, sizeof(bytes_str));
+		log_notice(_("%i of %i copy workers completed; %s in %.1f seconds (%.1f MB/s)"),
+				   successful, shards, bytes_str,
+				   (double) total_elapsed_ms / 1000.0,
+				   ((double) total_bytes / (1024.0 * 1024.0)) / ((double) total_elapsed_ms / 1000.0));
+	}
+
+	clear_parallel_commands(tasks, shards);
+	pfree(tasks);
+	pfree(shard_fp);
+	pfree(shard_files);
+	pfree(shard_bytes);
+
+	return success;
+}
+
+
+static int
+compare_copy_file_path(const void *a, const void *b)
+{
+	return strcmp(((const t_copy_file *) a)->path, ((const t_copy_file *) b)->path);
+}
+
+
+static int
+compare_copy_file_size_desc(const void *a, const void *b)
+{
+	uint64		size_a = ((const t_copy_file *) a)->size;
+	uint64		size_b = ((const t_copy_file *) b)->size;
+
+	if (size_a > size_b)
+		return -1;
+	if (size_a < size_b)
+		return 1;
+	return 0;
+}
+
+
+static void
+format_byte_count(uint64 bytes, char *buf, size_t buflen)
+{
+	if (bytes >= (uint64) 1024 * 1024 * 1024)
+		snprintf(buf, buflen, "%.1f GB", (double) bytes / (1024.0 * 1024.0 * 1024.0));
+	else if (bytes >= (uint64) 1024 * 1024)
+		snprintf(buf, buflen, "%.1f MB", (double) bytes / (1024.0 * 1024.0));
+	else
+		snprintf(buf, buflen, "%.1f kB", (double) bytes / 1024.0);
+}
@@ -0,0 +1,63 @@
+/*
+ * filecopy.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FILECOPY_H_
+#define _FILECOPY_H_
+
+/* upper bound for "clone_parallel_workers" */
+#define MAX_CLONE_PARALLEL_WORKERS	64
+
+typedef struct
+{
+	char	   *path;			/* relative to the copy source directory */
+	uint64		size;
+} t_copy_file;
+
+typedef struct
+{
+	t_copy_file *files;
+	int			count;
+	int			capacity;
+} t_copy_file_list;
+
+#define T_COPY_FILE_LIST_INITIALIZER { NULL, 0, 0 }
+
+/* a host providing a copy of the files to be transferred */
+typedef struct
+{
+	int			node_id;
+	char		host[MAXLEN];	/* "host" or "user@host" */
+	char		path[MAXUXPATH];
+} t_copy_source;
+
+extern void copy_file_list_append(t_copy_file_list *list, const char *path, uint64 size);
+extern bool copy_file_list_load(t_copy_file_list *list, const char *filename);
+extern void copy_file_list_free(t_copy_file_list *list);
+
+extern bool get_remote_file_sizes(const char *host, const char *remote_path, t_copy_file_list *list);
+extern bool get_remote_file_list(const char *host, const char *remote_path, const char *subdirs,
+								 const char *name_pattern, t_copy_file_list *list);
+extern bool parallel_copy_files(const char *host, const char *remote_path, const char *local_path,
+								t_copy_file_list *list, int workers, const char *rsync_flags,
+								const char *work_directory);
+extern bool multi_source_copy_files(t_copy_source *sources, int source_count, const char *local_path,
+									t_copy_file_list *list, int workers, const char *rsync_flags,
+									const char *work_directory);
+
+#endif							/* _FILECOPY_H_ */
@@ -0,0 +1,437 @@
+/*
+ * linkstate.c - network card carrier tracking via rtnetlink
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * repmgrd subscribes once to RTNLGRP_LINK and keeps the up/down state of
+ * every network device in a small in-memory table, so checking a network
+ * card does not need to touch sysfs. The netlink socket is also polled
+ * by wait_for_event(), so a carrier loss wakes the monitoring loop
+ * immediately rather than at the next monitoring interval.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+#include "repmgr.h"
+#include "linkstate.h"
+
+#ifdef __linux__
+
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP	0x10000
+#endif
+
+/* how long to wait at startup for the initial link dump to complete */
+#define LINK_STATE_DUMP_TIMEOUT_MS	1000
+
+typedef struct
+{
+	bool		in_use;
+	int			ifindex;
+	char		ifname[IFNAMSIZ];
+	bool		up;
+} t_link_state_entry;
+
+static int	link_socket = -1;
+static unsigned int link_dump_seq = 0;
+static bool link_dump_pending = false;
+static t_link_state_entry link_states[LINK_STATE_TABLE_SIZE];
+
+static bool _request_link_dump(void);
+static bool _handle_link_message(struct nlmsghdr *h);
+static t_link_state_entry *_find_link_state(int ifindex);
+
+
+/*
+ * Ask the kernel for the current state of all links; the replies are
+ * handled by link_state_monitor_process() like any other notification.
+ */
+static bool
+_request_link_dump(void)
+{
+	struct
+	{
+		struct nlmsghdr nlh;
+		struct ifinfomsg ifi;
+	}			req;
+	struct sockaddr_nl kernel;
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+	req.nlh.nlmsg_type = RTM_GETLINK;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nlh.nlmsg_seq = ++link_dump_seq;
+	req.ifi.ifi_family = AF_UNSPEC;
+
+	memset(&kernel, 0, sizeof(kernel));
+	kernel.nl_family = AF_NETLINK;
+
+	if (sendto(link_socket, &req, req.nlh.nlmsg_len, 0, (struct sockaddr *) &kernel, sizeof(kernel)) < 0)
+	{
+		log_warning(_("unable to request network card states via netlink"));
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	link_dump_pending = true;
+
+	return true;
+}
+
+
+static t_link_state_entry *
+_find_link_state(int ifindex)
+{
+	int			i;
+
+	for (i = 0; i < LINK_STATE_TABLE_SIZE; i++)
+	{
+		if (link_states[i].in_use == true && link_states[i].ifindex == ifindex)
+			return &link_states[i];
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Update the table from an RTM_NEWLINK/RTM_DELLINK message.
+ *
+ * Returns true if a link which was up has gone down.
+ */
+static bool
+_handle_link_message(struct nlmsghdr *h)
+{
+	struct ifinfomsg *ifi = (struct ifinfomsg *) NLMSG_DATA(h);
+	t_link_state_entry *entry = _find_link_state(ifi->ifi_index);
+	struct rtattr *rta = NULL;
+	int			rta_len = IFLA_PAYLOAD(h);
+	const char *ifname = NULL;
+	bool		up;
+	bool		was_up;
+	int			i;
+
+	if (h->nlmsg_type == RTM_DELLINK)
+	{
+		if (entry != NULL)
+		{
+			log_info(_("network card \"%s\" removed"), entry->ifname);
+			entry->in_use = false;
+		}
+
+		return false;
+	}
+
+	for (rta = IFLA_RTA(ifi); RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len))
+	{
+		if (rta->rta_type == IFLA_IFNAME)
+			ifname = (const char *) RTA_DATA(rta);
+	}
+
+	if (entry == NULL)
+	{
+		for (i = 0; i < LINK_STATE_TABLE_SIZE; i++)
+		{
+			if (link_states[i].in_use == false)
+			{
+				entry = &link_states[i];
+				memset(entry, 0, sizeof(t_link_state_entry));
+				break;
+			}
+		}
+
+		/* table full; this device is checked via sysfs instead */
+		if (entry == NULL)
+			return false;
+	}
+
+	/* equivalent to "/sys/class/net/<card>/carrier" reading as "1" */
+	up = (ifi->ifi_flags & IFF_UP) && (ifi->ifi_flags & IFF_LOWER_UP);
+	was_up = entry->up;
+
+	if (ifname != NULL)
+		strncpy(entry->ifname, ifname, sizeof(entry->ifname) - 1);
+
+	if (entry->in_use == true && up != was_up)
+	{
+		log_info(_("network card \"%s\" is now %s"),
+				 entry->ifname, up ? "UP" : "DOWN");
+	}
+
+	entry->ifindex = ifi->ifi_index;
+	entry->up = up;
+
+	if (entry->in_use == false)
+	{
+		entry->in_use = true;
+		return false;
+	}
+
+	return was_up == true && up == false;
+}
+
+
+/*
+ * Open the netlink socket, subscribe to link notifications and populate
+ * the table with the current state of all links.
+ */
+bool
+link_state_monitor_start(void)
+{
+	struct sockaddr_nl local;
+	instr_time	start_time;
+
+	if (link_socket != -1)
+		return true;
+
+	link_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+
+	if (link_socket < 0)
+	{
+		log_warning(_("unable to create netlink socket for network card monitoring"));
+		log_detail("%s", strerror(errno));
+		link_socket = -1;
+		return false;
+	}
+
+	memset(&local, 0, sizeof(local));
+	local.nl_family = AF_NETLINK;
+	local.nl_groups = RTMGRP_LINK;
+
+	if (bind(link_socket, (struct sockaddr *) &local, sizeof(local)) < 0)
+	{
+		log_warning(_("unable to subscribe to network card notifications"));
+		log_detail("%s", strerror(errno));
+		link_state_monitor_stop();
+		return false;
+	}
+
+	memset(link_states, 0, sizeof(link_states));
+
+	if (_request_link_dump() == false)
+	{
+		link_state_monitor_stop();
+		return false;
+	}
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (link_dump_pending == true)
+	{
+		struct pollfd pfd;
+		instr_time	elapsed;
+		int			remaining_ms;
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		remaining_ms = LINK_STATE_DUMP_TIMEOUT_MS - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+		if (remaining_ms <= 0)
+		{
+			/* states not yet received will be read from sysfs for now */
+			log_warning(_("timed out waiting for initial network card states"));
+			break;
+		}
+
+		pfd.fd = link_socket;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, remaining_ms) < 0 && errno != EINTR)
+			break;
+
+		(void) link_state_monitor_process();
+	}
+
+	log_debug("network card monitoring via netlink started");
+
+	return true;
+}
+
+
+void
+link_state_monitor_stop(void)
+{
+	if (link_socket != -1)
+	{
+		close(link_socket);
+		link_socket = -1;
+	}
+
+	link_dump_pending = false;
+	memset(link_states, 0, sizeof(link_states));
+}
+
+
+int
+link_state_monitor_socket(void)
+{
+	return link_socket;
+}
+
+
+/*
+ * Consume all pending link notifications without blocking.
+ *
+ * Returns true if any link went down.
+ */
+bool
+link_state_monitor_process(void)
+{
+	union
+	{
+		struct nlmsghdr nlh;
+		char		buf[16384];
+	}			msg;
+	bool		link_down = false;
+
+	if (link_socket == -1)
+		return false;
+
+	for (;;)
+	{
+		int			len = recv(link_socket, msg.buf, sizeof(msg.buf), 0);
+		struct nlmsghdr *h = NULL;
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			if (errno == ENOBUFS)
+			{
+				/*
+				 * Notifications were dropped, so the table can no longer be
+				 * trusted; fall back to sysfs until it has been refreshed.
+				 */
+				log_debug("netlink link notifications overran, resynchronising");
+				memset(link_states, 0, sizeof(link_states));
+
+				if (link_dump_pending == false)
+					(void) _request_link_dump();
+
+				continue;
+			}
+
+			log_warning(_("unable to read network card notifications"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		if (len == 0)
+			break;
+
+		for (h = &msg.nlh; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			if (h->nlmsg_type == NLMSG_DONE || h->nlmsg_type == NLMSG_ERROR)
+			{
+				if (h->nlmsg_seq == link_dump_seq)
+					link_dump_pending = false;
+
+				continue;
+			}
+
+			if (h->nlmsg_type == RTM_NEWLINK || h->nlmsg_type == RTM_DELLINK)
+			{
+				if (_handle_link_message(h) == true)
+					link_down = true;
+			}
+		}
+	}
+
+	return link_down;
+}
+
+
+/*
+ * Returns the tracked state of "network_card" (an alias suffix such as
+ * "eth0:1" refers to the underlying device), or LINK_STATE_UNKNOWN if
+ * the device is not being tracked.
+ */
+LinkState
+get_link_state(const char *network_card)
+{
+	char		ifname[IFNAMSIZ] = "";
+	char	   *colon = NULL;
+	int			i;
+
+	if (link_socket == -1)
+		return LINK_STATE_UNKNOWN;
+
+	strncpy(ifname, network_card, sizeof(ifname) - 1);
+
+	colon = strchr(ifname, ':');
+	if (colon != NULL)
+		*colon = '\0';
+
+	for (i = 0; i < LINK_STATE_TABLE_SIZE; i++)
+	{
+		if (link_states[i].in_use == true && strcmp(link_states[i].ifname, ifname) == 0)
+			return link_states[i].up ? LINK_STATE_UP : LINK_STATE_DOWN;
+	}
+
+	return LINK_STATE_UNKNOWN;
+}
+
+#else							/* !__linux__ */
+
+bool
+link_state_monitor_start(void)
+{
+	return false;
+}
+
+
+void
+link_state_monitor_stop(void)
+{
+}
+
+
+int
+link_state_monitor_socket(void)
+{
+	return -1;
+}
+
+
+bool
+link_state_monitor_process(void)
+{
+	return false;
+}
+
+
+LinkState
+get_link_state(const char *network_card)
+{
+	return LINK_STATE_UNKNOWN;
+}
+
+#endif							/* __linux__ */
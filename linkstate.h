@@ -0,0 +1,39 @@
+/*
+ * linkstate.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LINKSTATE_H_
+#define _LINKSTATE_H_
+
+/* maximum number of network devices tracked */
+#define LINK_STATE_TABLE_SIZE	64
+
+typedef enum
+{
+	LINK_STATE_UNKNOWN = 0,
+	LINK_STATE_UP,
+	LINK_STATE_DOWN
+} LinkState;
+
+extern bool link_state_monitor_start(void);
+extern void link_state_monitor_stop(void);
+extern int	link_state_monitor_socket(void);
+extern bool link_state_monitor_process(void);
+extern LinkState get_link_state(const char *network_card);
+
+#endif							/* _LINKSTATE_H_ */
@@ -1,5 +1,16 @@
 /*
  * log.c - Logging methods
+ *
+ * In repmgrd, logger_enable_async() switches to an asynchronous pipeline:
+ * messages are formatted by the calling thread into a fixed-size ring
+ * buffer, which a writer thread drains, writing each batch to the log file
+ * with a single call (or passing it on to syslog). Lines too long for a
+ * slot are formatted into a separately allocated buffer, which the slot
+ * refers to and the writer thread frees, so they are neither truncated
+ * nor written out of order. Enqueueing a message
+ * never waits; if the ring is full the message is dropped and counted,
+ * so a stalled disk or syslog daemon cannot hold up monitoring or failover.
+ *
  * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
  * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
  *
@@ -25,8 +36,12 @@
 #include <syslog.h>
 #endif
 
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "log.h"
 
@@ -37,16 +52,64 @@
 
 /* #define REPMGR_DEBUG */
 
+/* length of a line which can be formatted without allocating memory */
+#define LOG_LINE_SIZE				1024
+
+/* space needed for the timestamp, PID, level and JSON punctuation */
+#define LOG_LINE_PREFIX_SIZE		128
+
+/* maximum number of messages written at once by the writer thread */
+#define LOG_ASYNC_BATCH_SIZE		64
+
+/* how long the writer thread sleeps when there is nothing to write */
+#define LOG_ASYNC_IDLE_SLEEP_MS		10
+
+typedef struct
+{
+	uint64		sequence;
+	int			level;
+	bool		syslog;
+	int			len;
+	char	   *long_line;		/* if not NULL, used instead of "line" */
+	char		line[LOG_LINE_SIZE];
+} t_log_slot;
+
 static int	detect_log_facility(const char *facility);
 static void
 _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_list ap)
 __attribute__((format(UX_PRINTF_ATTRIBUTE, 3, 0)));
+static char *_format_log_line(char *buf, int buf_size, int *len, const char *level_name, const char *fmt, va_list ap)
+__attribute__((format(UX_PRINTF_ATTRIBUTE, 5, 0)));
+static void _append_json_string(char *buf, int buf_size, int *len, const char *str);
+static bool _log_async_enqueue(int level, char *line, int len, bool line_allocated);
+static void *_log_async_writer(void *arg);
+static bool _log_async_write_batch(void);
+static void _log_async_atfork_child(void);
+static void _log_async_atexit(void);
+static void _log_rotation(void);
+static bool _logger_start_async(int queue_size);
 
 int			log_type = REPMGR_STDERR;
 int			log_level = LOG_INFO;
 int			last_log_level = LOG_INFO;
 int			verbose_logging = false;
 int			terse_logging = false;
+int			log_async_active = false;
+
+static bool log_format_json = false;
+
+/* asynchronous logging state */
+static bool log_async_requested = false;
+static int	log_async_queue_size = DEFAULT_LOG_ASYNC_QUEUE_SIZE;
+static t_log_slot *log_slots = NULL;
+static uint64 log_slot_mask = 0;
+static uint64 log_enqueue_pos = 0;
+static uint64 log_dequeue_pos = 0;
+static uint64 log_dropped = 0;
+static uint64 log_dropped_reported = 0;
+static bool log_writer_stop = false;
+static bool log_rotation_requested = false;
+static pthread_t log_writer_thread;
 
 /*
  * Global variable to be set by the main application to ensure any log output
@@ -75,31 +138,223 @@ _stderr_log_with_level(const char *level_name, int level, const char *fmt, va_li
 	 */
 	last_log_level = level;
 
-	if (log_level >= level)
+	if (log_level < level)
+		return;
+
+	/*
+	 * In asynchronous mode, the message is formatted here and handed over to
+	 * the writer thread; if the queue is full it's simply dropped.
+	 */
+	if (log_async_active == true)
 	{
+		char		buf[LOG_LINE_SIZE];
+		int			len;
+		char	   *line = _format_log_line(buf, sizeof(buf), &len, level_name, fmt, ap);
+
+		(void) _log_async_enqueue(level, line, len, line != buf);
+		return;
+	}
+
+	if (log_format_json == true)
+	{
+		char		buf[LOG_LINE_SIZE];
+		int			len;
+		char	   *line = _format_log_line(buf, sizeof(buf), &len, level_name, fmt, ap);
+
+		fwrite(line, 1, len, stderr);
+		fflush(stderr);
+
+		if (line != buf)
+			free(line);
+		return;
+	}
+
+	/* Format log line prefix with timestamp if in daemon mode */
+	if (logger_output_mode == OM_DAEMON)
+	{
+		time_t		t;
+		struct tm  *tm;
+
+		time(&t);
+		tm = localtime(&t);
+		strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S]", tm);
+		fprintf(stderr, "%s [%s] ", buf, level_name);
+	}
+	else
+	{
+		fprintf(stderr, "%s: ", level_name);
+	}
+
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	fflush(stderr);
+}
+
 
-		/* Format log line prefix with timestamp if in daemon mode */
+/*
+ * Format a complete log line, including the trailing newline, setting
+ * "len" to its length. The line is formatted into "buf" if it fits;
+ * otherwise into a buffer allocated with malloc(), which is returned and
+ * must be freed by the caller. Only if that allocation fails is the
+ * message truncated to fit into "buf".
+ *
+ * For syslog only the message itself is needed; otherwise the line is
+ * formatted as a JSON object if "log_format" is "json", or with the
+ * usual timestamp and level prefix.
+ */
+static char *
+_format_log_line(char *buf, int buf_size, int *len, const char *level_name, const char *fmt, va_list ap)
+{
+	char		message_buf[LOG_LINE_SIZE];
+	char	   *message = message_buf;
+	char	   *line = buf;
+	int			line_size = buf_size;
+	char		timestamp[100] = "";
+	int			message_len;
+	int			needed;
+	va_list		ap_copy;
+
+	va_copy(ap_copy, ap);
+	message_len = vsnprintf(message_buf, sizeof(message_buf), fmt, ap);
+
+	if (message_len >= (int) sizeof(message_buf))
+	{
+		message = malloc(message_len + 1);
+
+		if (message != NULL)
+		{
+			vsnprintf(message, message_len + 1, fmt, ap_copy);
+		}
+		else
+		{
+			message = message_buf;
+			strcpy(&message_buf[sizeof(message_buf) - 4], "...");
+		}
+	}
+	va_end(ap_copy);
+
+	/* messages which arrive with a trailing newline get it replaced below */
+	message_len = strlen(message);
+	if (message_len > 0 && message[message_len - 1] == '\n')
+		message[--message_len] = '\0';
+
+	/* each character may need up to six bytes when escaped for JSON */
+	needed = LOG_LINE_PREFIX_SIZE + (log_format_json == true ? message_len * 6 : message_len) + 2;
+
+	if (needed > buf_size)
+	{
+		line = malloc(needed);
+
+		if (line != NULL)
+			line_size = needed;
+		else
+			line = buf;
+	}
+
+	if (log_type == REPMGR_SYSLOG)
+	{
+		snprintf(line, line_size, "%s", message);
+		*len = strlen(line);
+	}
+	else
+	{
 		if (logger_output_mode == OM_DAEMON)
 		{
 			time_t		t;
-			struct tm  *tm;
+			struct tm	tm;
 
 			time(&t);
-			tm = localtime(&t);
-			strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S]", tm);
-			fprintf(stderr, "%s [%s] ", buf, level_name);
+			localtime_r(&t, &tm);
+			strftime(timestamp, sizeof(timestamp),
+					 log_format_json == true ? "%Y-%m-%dT%H:%M:%S%z" : "[%Y-%m-%d %H:%M:%S]",
+					 &tm);
+		}
+
+		if (log_format_json == true)
+		{
+			*len = snprintf(line, line_size, "{\"time\": \"%s\", \"pid\": %i, \"level\": \"%s\", \"message\": ",
+							timestamp, (int) getpid(), level_name);
+			if (*len < 0 || *len >= line_size - 16)
+				*len = line_size - 16;
+
+			_append_json_string(line, line_size - 2, len, message);
+			line[(*len)++] = '}';
+		}
+		else if (logger_output_mode == OM_DAEMON)
+		{
+			*len = snprintf(line, line_size - 1, "%s [%s] %s", timestamp, level_name, message);
 		}
 		else
 		{
-			fprintf(stderr, "%s: ", level_name);
+			*len = snprintf(line, line_size - 1, "%s: %s", level_name, message);
 		}
 
-		vfprintf(stderr, fmt, ap);
-		fprintf(stderr, "\n");
-		fflush(stderr);
+		if (*len >= line_size - 1)
+			*len = line_size - 2;
+
+		line[(*len)++] = '\n';
+		line[*len] = '\0';
 	}
+
+	if (message != message_buf)
+		free(message);
+
+	return line;
 }
 
+
+/*
+ * Append "str" to "buf" as a quoted JSON string, truncating it if
+ * necessary to keep within "buf_size".
+ */
+static void
+_append_json_string(char *buf, int buf_size, int *len, const char *str)
+{
+	const char *c;
+	int			pos = *len;
+
+	/* leave room for the closing quote */
+	buf_size--;
+
+	if (pos < buf_size)
+		buf[pos++] = '"';
+
+	for (c = str; *c != '\0' && pos < buf_size - 6; c++)
+	{
+		switch (*c)
+		{
+			case '"':
+			case '\\':
+				buf[pos++] = '\\';
+				buf[pos++] = *c;
+				break;
+			case '\n':
+				buf[pos++] = '\\';
+				buf[pos++] = 'n';
+				break;
+			case '\t':
+				buf[pos++] = '\\';
+				buf[pos++] = 't';
+				break;
+			case '\r':
+				buf[pos++] = '\\';
+				buf[pos++] = 'r';
+				break;
+			default:
+				if ((unsigned char) *c < 0x20)
+					pos += sprintf(&buf[pos], "\\u%04x", (unsigned char) *c);
+				else
+					buf[pos++] = *c;
+		}
+	}
+
+	buf[pos++] = '"';
+	buf[pos] = '\0';
+
+	*len = pos;
+}
+
+
 void
 log_hint(const char *fmt,...)
 {
@@ -212,6 +467,8 @@ logger_init(t_configuration_options *opts, const char *ident)
 	if (logger_output_mode == OM_COMMAND_LINE)
 		return true;
 
+	log_format_json = (strcmp(opts->log_format, "json") == 0);
+
 	if (facility && *facility)
 	{
 
@@ -287,6 +544,10 @@ logger_init(t_configuration_options *opts, const char *ident)
 		}
 	}
 
+	/* (re)start asynchronous logging, e.g. after a configuration reload */
+	if (log_async_requested == true && opts->log_async == true)
+		(void) _logger_start_async(opts->log_async_queue_size);
+
 	return true;
 }
 
@@ -294,6 +555,8 @@ logger_init(t_configuration_options *opts, const char *ident)
 bool
 logger_shutdown(void)
 {
+	logger_stop_async();
+
 #ifdef HAVE_SYSLOG
 	if (log_type == REPMGR_SYSLOG)
 		closelog();
@@ -302,6 +565,307 @@ logger_shutdown(void)
 	return true;
 }
 
+
+/*
+ * Permit asynchronous logging (see the comment at the top of this file),
+ * and start it if "log_async" is set; logger_init() will then start or
+ * stop it as "log_async" changes.
+ *
+ * This must be called after any fork() which is not followed by exec(), as
+ * the writer thread does not survive it; forked children revert to
+ * synchronous logging.
+ */
+bool
+logger_enable_async(t_configuration_options *opts)
+{
+	log_async_requested = true;
+
+	if (opts->log_async == false)
+		return false;
+
+	return _logger_start_async(opts->log_async_queue_size);
+}
+
+
+/*
+ * The queue is allocated on the first call and is not resized by later
+ * calls.
+ */
+static bool
+_logger_start_async(int queue_size)
+{
+	static bool handlers_registered = false;
+	sigset_t	all_signals;
+	sigset_t	orig_signals;
+	uint64		i;
+	int			r;
+
+	if (log_async_active == true)
+		return true;
+
+	if (log_slots == NULL)
+	{
+		uint64		slot_count = 1;
+
+		while (slot_count < (uint64) queue_size)
+			slot_count <<= 1;
+
+		log_slots = calloc(slot_count, sizeof(t_log_slot));
+		if (log_slots == NULL)
+		{
+			log_warning(_("unable to allocate log queue, logging synchronously"));
+			return false;
+		}
+
+		log_slot_mask = slot_count - 1;
+		log_async_queue_size = (int) slot_count;
+	}
+
+	/* the sequence number of a free slot is the position it will be used for */
+	for (i = 0; i <= log_slot_mask; i++)
+	{
+		uint64		pos = log_dequeue_pos + i;
+
+		log_slots[pos & log_slot_mask].sequence = pos;
+	}
+
+	log_enqueue_pos = log_dequeue_pos;
+	log_writer_stop = false;
+
+	if (handlers_registered == false)
+	{
+		pthread_atfork(NULL, NULL, _log_async_atfork_child);
+		atexit(_log_async_atexit);
+		handlers_registered = true;
+	}
+
+	/* signals must continue to be handled by the main thread */
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_SETMASK, &all_signals, &orig_signals);
+	r = pthread_create(&log_writer_thread, NULL, _log_async_writer, NULL);
+	pthread_sigmask(SIG_SETMASK, &orig_signals, NULL);
+
+	if (r != 0)
+	{
+		log_warning(_("unable to start log writer thread, logging synchronously"));
+		log_detail("%s", strerror(r));
+		return false;
+	}
+
+	__atomic_store_n(&log_async_active, true, __ATOMIC_RELEASE);
+
+	log_verbose(LOG_DEBUG, "_logger_start_async(): queue size is %i", log_async_queue_size);
+
+	return true;
+}
+
+
+/*
+ * Write out any queued messages and stop the writer thread; subsequent
+ * messages are written synchronously.
+ */
+void
+logger_stop_async(void)
+{
+	if (log_async_active == false)
+		return;
+
+	__atomic_store_n(&log_writer_stop, true, __ATOMIC_RELEASE);
+	pthread_join(log_writer_thread, NULL);
+
+	log_async_active = false;
+
+	/* report drops which the writer didn't get round to */
+	if (log_dropped != log_dropped_reported)
+	{
+		stderr_log_warning(_("%llu log message(s) dropped as the log queue was full"),
+						   (unsigned long long) (log_dropped - log_dropped_reported));
+		log_dropped_reported = log_dropped;
+	}
+}
+
+
+/*
+ * Number of messages discarded because the log queue was full.
+ */
+uint64
+logger_dropped_messages(void)
+{
+	return __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Add a formatted log line to the queue. Any thread may call this; it never
+ * waits, returning false if the queue is full.
+ *
+ * This is a bounded queue as described by Dmitry Vyukov: each slot's
+ * sequence number tells a producer whether the slot is free for the position
+ * it wants to claim, and the consumer whether it has been filled.
+ */
+static bool
+_log_async_enqueue(int level, char *line, int len, bool line_allocated)
+{
+	t_log_slot *slot = NULL;
+	uint64		pos = __atomic_load_n(&log_enqueue_pos, __ATOMIC_RELAXED);
+
+	for (;;)
+	{
+		uint64		sequence;
+		int64		diff;
+
+		slot = &log_slots[pos & log_slot_mask];
+		sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		diff = (int64) sequence - (int64) pos;
+
+		if (diff == 0)
+		{
+			if (__atomic_compare_exchange_n(&log_enqueue_pos, &pos, pos + 1, true,
+											__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		}
+		else if (diff < 0)
+		{
+			__atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
+			if (line_allocated == true)
+				free(line);
+			return false;
+		}
+		else
+		{
+			pos = __atomic_load_n(&log_enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->level = level;
+	slot->syslog = (log_type == REPMGR_SYSLOG);
+	slot->len = len;
+
+	/* the writer thread takes over an allocated line */
+	if (line_allocated == true)
+	{
+		slot->long_line = line;
+	}
+	else
+	{
+		slot->long_line = NULL;
+		memcpy(slot->line, line, len + 1);
+	}
+
+	__atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+
+static void *
+_log_async_writer(void *arg)
+{
+	for (;;)
+	{
+		bool		stop = __atomic_load_n(&log_writer_stop, __ATOMIC_ACQUIRE);
+
+		if (__atomic_exchange_n(&log_rotation_requested, false, __ATOMIC_ACQ_REL) == true)
+			_log_rotation();
+
+		if (_log_async_write_batch() == true)
+			continue;
+
+		if (stop == true)
+			break;
+
+		(void) poll(NULL, 0, LOG_ASYNC_IDLE_SLEEP_MS);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Remove up to LOG_ASYNC_BATCH_SIZE messages from the queue and write them;
+ * returns false if the queue was empty.
+ */
+static bool
+_log_async_write_batch(void)
+{
+	static char batch[LOG_ASYNC_BATCH_SIZE * LOG_LINE_SIZE];
+	int			batch_len = 0;
+	int			count = 0;
+	uint64		dropped;
+
+	while (count < LOG_ASYNC_BATCH_SIZE)
+	{
+		t_log_slot *slot = &log_slots[log_dequeue_pos & log_slot_mask];
+
+		if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != log_dequeue_pos + 1)
+			break;
+
+#ifdef HAVE_SYSLOG
+		if (slot->syslog == true)
+			syslog(slot->level, "%s", slot->long_line != NULL ? slot->long_line : slot->line);
+		else
+#endif
+		if (slot->long_line != NULL)
+		{
+			/* keep the order of lines by writing out what's batched first */
+			if (batch_len > 0)
+				fwrite(batch, 1, batch_len, stderr);
+			batch_len = 0;
+
+			fwrite(slot->long_line, 1, slot->len, stderr);
+		}
+		else
+		{
+			memcpy(&batch[batch_len], slot->line, slot->len);
+			batch_len += slot->len;
+		}
+
+		if (slot->long_line != NULL)
+		{
+			free(slot->long_line);
+			slot->long_line = NULL;
+		}
+
+		/* mark the slot as free for the producer one lap ahead */
+		__atomic_store_n(&slot->sequence, log_dequeue_pos + log_slot_mask + 1, __ATOMIC_RELEASE);
+		log_dequeue_pos++;
+		count++;
+	}
+
+	if (batch_len > 0)
+	{
+		fwrite(batch, 1, batch_len, stderr);
+		fflush(stderr);
+	}
+
+	dropped = __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+
+	/* once the queue has room again, report any messages dropped meanwhile */
+	if (dropped != log_dropped_reported && count > 0)
+	{
+		stderr_log_warning(_("%llu log message(s) dropped as the log queue was full"),
+						   (unsigned long long) (dropped - log_dropped_reported));
+		log_dropped_reported = dropped;
+	}
+
+	return count > 0;
+}
+
+
+static void
+_log_async_atfork_child(void)
+{
+	log_async_active = false;
+	log_async_requested = false;
+}
+
+
+static void
+_log_async_atexit(void)
+{
+	logger_stop_async();
+}
+
 /*
  * Indicate whether extra-verbose logging is required. This will
  * generate a lot of output, particularly debug logging, and should
@@ -418,7 +982,23 @@ detect_log_facility(const char *facility)
 	return -1;
 }
 
+/*
+ * In asynchronous mode, stderr is redirected by the writer thread, so it
+ * never does so in the middle of writing a batch.
+ */
 void log_rotation(void)
+{
+	if (log_async_active == true)
+	{
+		__atomic_store_n(&log_rotation_requested, true, __ATOMIC_RELEASE);
+		return;
+	}
+
+	_log_rotation();
+}
+
+
+static void _log_rotation(void)
 {
 	FILE *new_fd;
 	char *filename = NULL;	
@@ -29,6 +29,10 @@
 #define OM_DAEMON		2
 
 #define DEFAULT_LOG_STATUS_INTERVAL 300
+#define DEFAULT_LOG_FORMAT			"text"
+#define DEFAULT_LOG_ASYNC			true
+#define DEFAULT_LOG_ASYNC_QUEUE_SIZE 4096	/* messages */
+#define MIN_LOG_ASYNC_QUEUE_SIZE	64
 
 extern void
 stderr_log_with_level(const char *level_name, int level, const char *fmt,...)
@@ -59,50 +63,50 @@ __attribute__((format(UX_PRINTF_ATTRIBUTE, 3, 4)));
 #include <syslog.h>
 
 #define log_debug(...) \
-	if (log_type == REPMGR_SYSLOG) \
+	if (log_type == REPMGR_SYSLOG && log_async_active == false) \
 		syslog(LOG_DEBUG, __VA_ARGS__); \
 	else \
 		stderr_log_debug(__VA_ARGS__);
 
 #define log_info(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_INFO, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_INFO, __VA_ARGS__); \
 		else stderr_log_info(__VA_ARGS__); \
 	}
 
 #define log_notice(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_NOTICE, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_NOTICE, __VA_ARGS__); \
 		else stderr_log_notice(__VA_ARGS__); \
 	}
 
 #define log_warning(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_WARNING, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_WARNING, __VA_ARGS__); \
 		else stderr_log_warning(__VA_ARGS__); \
 	}
 
 #define log_error(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ERROR, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_ERROR, __VA_ARGS__); \
 		else stderr_log_error(__VA_ARGS__); \
 	}
 
 #define log_crit(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_CRIT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_CRIT, __VA_ARGS__); \
 		else stderr_log_crit(__VA_ARGS__); \
 	}
 
 #define log_alert(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ALERT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_ALERT, __VA_ARGS__); \
 		else stderr_log_alert(__VA_ARGS__); \
 	}
 
 #define log_emerg(...) \
 	{ \
-		if (log_type == REPMGR_SYSLOG) syslog(LOG_ALERT, __VA_ARGS__); \
+		if (log_type == REPMGR_SYSLOG && log_async_active == false) syslog(LOG_ALERT, __VA_ARGS__); \
 		else stderr_log_alert(__VA_ARGS__); \
 	}
 #else
@@ -134,6 +138,10 @@ void		logger_set_level(int new_log_level);
 void 		log_rotation(void);
 void		log_check(void);
 
+bool		logger_enable_async(t_configuration_options *opts);
+void		logger_stop_async(void);
+uint64		logger_dropped_messages(void);
+
 void
 log_detail(const char *fmt,...)
 __attribute__((format(UX_PRINTF_ATTRIBUTE, 1, 2)));
@@ -149,5 +157,6 @@ extern int	log_level;
 extern int	verbose_logging;
 extern int	terse_logging;
 extern int	logger_output_mode;
+extern int	log_async_active;
 
 #endif							/* _REPMGR_LOG_H_ */
@@ -0,0 +1,456 @@
+/*
+ * metrics.c - Prometheus/OpenMetrics text endpoint for repmgrd
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * If "metrics_port" is set, repmgrd listens on that port and answers
+ * "GET /metrics" with the state it already holds, in the Prometheus
+ * text exposition format. The listening socket is polled by
+ * wait_for_event(), so requests are served from the monitoring loop
+ * itself and never cause any database activity.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "metrics.h"
+
+/* maximum size of a request we're prepared to read */
+#define METRICS_REQUEST_BUF_SIZE	4096
+
+/* time allowed for a client to send its request, and to read the reply */
+#define METRICS_CLIENT_TIMEOUT_MS	1000
+
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+t_repmgrd_metrics repmgrd_metrics;
+
+static int	metrics_socket = -1;
+
+static void _handle_client(int client_socket);
+static bool _read_request(int client_socket, char *buf, int buf_size);
+static void _send_response(int client_socket, const char *status, const char *content_type, const char *body);
+static void _build_metrics(UXSQLExpBufferData *body);
+static void _append_label_value(UXSQLExpBufferData *buf, const char *value);
+static void _append_metric_header(UXSQLExpBufferData *buf, const char *name, const char *type, const char *help);
+
+
+bool
+metrics_server_start(const char *listen_address, int port)
+{
+	struct addrinfo hints;
+	struct addrinfo *addrs = NULL;
+	struct addrinfo *addr = NULL;
+	char		port_str[MAXLEN];
+	const char *host = NULL;
+	int			ret;
+
+	memset(&repmgrd_metrics, 0, sizeof(repmgrd_metrics));
+	INSTR_TIME_SET_CURRENT(repmgrd_metrics.start_time);
+	repmgrd_metrics.upstream_node_id = UNKNOWN_NODE_ID;
+
+	if (port <= 0)
+		return false;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	/* "*" or an empty string means all interfaces */
+	if (listen_address[0] != '\0' && strcmp(listen_address, "*") != 0)
+		host = listen_address;
+
+	maxlen_snprintf(port_str, "%i", port);
+
+	ret = getaddrinfo(host, port_str, &hints, &addrs);
+
+	if (ret != 0)
+	{
+		log_warning(_("unable to resolve metrics listen address \"%s\""), listen_address);
+		log_detail("%s", gai_strerror(ret));
+		return false;
+	}
+
+	for (addr = addrs; addr != NULL; addr = addr->ai_next)
+	{
+		int			on = 1;
+		int			fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+
+		if (fd < 0)
+			continue;
+
+		(void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+		if (bind(fd, addr->ai_addr, addr->ai_addrlen) == 0
+			&& listen(fd, 8) == 0
+			&& fcntl(fd, F_SETFL, O_NONBLOCK) == 0)
+		{
+			(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+			metrics_socket = fd;
+			break;
+		}
+
+		ret = errno;
+		close(fd);
+		errno = ret;
+	}
+
+	freeaddrinfo(addrs);
+
+	if (metrics_socket == -1)
+	{
+		log_warning(_("unable to listen for metrics requests on \"%s\" port %i"),
+					listen_address, port);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	log_info(_("serving metrics on \"%s\" port %i"), listen_address, port);
+
+	return true;
+}
+
+
+void
+metrics_server_stop(void)
+{
+	if (metrics_socket != -1)
+	{
+		close(metrics_socket);
+		metrics_socket = -1;
+	}
+}
+
+
+int
+metrics_server_socket(void)
+{
+	return metrics_socket;
+}
+
+
+/*
+ * Serve all pending connections; called by wait_for_event() when the
+ * listening socket is readable.
+ */
+void
+metrics_server_process(void)
+{
+	for (;;)
+	{
+		int			client_socket = accept(metrics_socket, NULL, NULL);
+
+		if (client_socket < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				log_verbose(LOG_WARNING, _("unable to accept metrics connection"));
+				log_verbose(LOG_WARNING, "%s", strerror(errno));
+			}
+			return;
+		}
+
+		_handle_client(client_socket);
+
+		close(client_socket);
+	}
+}
+
+
+static void
+_handle_client(int client_socket)
+{
+	char		request[METRICS_REQUEST_BUF_SIZE];
+	struct timeval timeout;
+
+	timeout.tv_sec = METRICS_CLIENT_TIMEOUT_MS / 1000;
+	timeout.tv_usec = (METRICS_CLIENT_TIMEOUT_MS % 1000) * 1000;
+
+	(void) setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	if (_read_request(client_socket, request, sizeof(request)) == false)
+	{
+		_send_response(client_socket, "400 Bad Request", "text/plain", "bad request\n");
+		return;
+	}
+
+	log_verbose(LOG_DEBUG, "metrics request: %.*s", (int) strcspn(request, "\r\n"), request);
+
+	if (strncmp(request, "GET ", 4) != 0)
+	{
+		_send_response(client_socket, "405 Method Not Allowed", "text/plain", "method not allowed\n");
+	}
+	else if (strncmp(request + 4, "/metrics ", 9) == 0 || strncmp(request + 4, "/metrics?", 9) == 0)
+	{
+		UXSQLExpBufferData body;
+
+		initUXSQLExpBuffer(&body);
+		_build_metrics(&body);
+		_send_response(client_socket, "200 OK", METRICS_CONTENT_TYPE, body.data);
+		termUXSQLExpBuffer(&body);
+	}
+	else
+	{
+		_send_response(client_socket, "404 Not Found", "text/plain", "not found\n");
+	}
+}
+
+
+/*
+ * Read the request headers; only the request line is used.
+ */
+static bool
+_read_request(int client_socket, char *buf, int buf_size)
+{
+	int			len = 0;
+	instr_time	start_time;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (len < buf_size - 1)
+	{
+		struct pollfd pfd;
+		instr_time	elapsed;
+		int			remaining_ms;
+		ssize_t		n;
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		remaining_ms = METRICS_CLIENT_TIMEOUT_MS - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+		if (remaining_ms <= 0)
+			return false;
+
+		pfd.fd = client_socket;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, remaining_ms) <= 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		n = recv(client_socket, buf + len, buf_size - 1 - len, 0);
+
+		if (n <= 0)
+			return false;
+
+		len += n;
+		buf[len] = '\0';
+
+		if (strstr(buf, "\r\n\r\n") != NULL || strstr(buf, "\n\n") != NULL)
+			return true;
+	}
+
+	/* headers too long; the request line is all we need anyway */
+	return strchr(buf, '\n') != NULL;
+}
+
+
+static void
+_send_response(int client_socket, const char *status, const char *content_type, const char *body)
+{
+	UXSQLExpBufferData response;
+	size_t		sent = 0;
+	int			flags = 0;
+
+#ifdef MSG_NOSIGNAL
+	flags = MSG_NOSIGNAL;
+#endif
+
+	initUXSQLExpBuffer(&response);
+
+	appendUXSQLExpBuffer(&response,
+					  "HTTP/1.1 %s\r\n"
+					  "Content-Type: %s\r\n"
+					  "Content-Length: %i\r\n"
+					  "Connection: close\r\n"
+					  "\r\n"
+					  "%s",
+					  status,
+					  content_type,
+					  (int) strlen(body),
+					  body);
+
+	while (sent < response.len)
+	{
+		ssize_t		n = send(client_socket, response.data + sent, response.len - sent, flags);
+
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+				continue;
+
+			log_verbose(LOG_WARNING, _("unable to send metrics response"));
+			break;
+		}
+
+		sent += n;
+	}
+
+	termUXSQLExpBuffer(&response);
+}
+
+
+static void
+_append_metric_header(UXSQLExpBufferData *buf, const char *name, const char *type, const char *help)
+{
+	appendUXSQLExpBuffer(buf, "# HELP %s %s\n", name, help);
+	appendUXSQLExpBuffer(buf, "# TYPE %s %s\n", name, type);
+}
+
+
+/*
+ * Label values may contain backslashes, double quotes and newlines, which
+ * must be escaped.
+ */
+static void
+_append_label_value(UXSQLExpBufferData *buf, const char *value)
+{
+	const char *c;
+
+	appendUXSQLExpBufferChar(buf, '"');
+
+	for (c = value; *c != '\0'; c++)
+	{
+		if (*c == '\\' || *c == '"')
+		{
+			appendUXSQLExpBufferChar(buf, '\\');
+			appendUXSQLExpBufferChar(buf, *c);
+		}
+		else if (*c == '\n')
+		{
+			appendUXSQLExpBufferStr(buf, "\\n");
+		}
+		else
+		{
+			appendUXSQLExpBufferChar(buf, *c);
+		}
+	}
+
+	appendUXSQLExpBufferChar(buf, '"');
+}
+
+
+static void
+_build_metrics(UXSQLExpBufferData *body)
+{
+	t_repmgrd_metrics *m = &repmgrd_metrics;
+
+	_append_metric_header(body, "repmgrd_info", "gauge",
+						  "Node monitored by this repmgrd instance");
+	appendUXSQLExpBufferStr(body, "repmgrd_info{node_id=\"");
+	appendUXSQLExpBuffer(body, "%i\",node_name=", local_node_info.node_id);
+	_append_label_value(body, local_node_info.node_name);
+	appendUXSQLExpBufferStr(body, ",node_type=");
+	_append_label_value(body, get_node_type_string(local_node_info.type));
+	appendUXSQLExpBuffer(body, ",version=\"%s\"} 1\n", REPMGR_VERSION);
+
+	_append_metric_header(body, "repmgrd_uptime_seconds", "gauge",
+						  "Seconds since repmgrd started monitoring");
+	appendUXSQLExpBuffer(body, "repmgrd_uptime_seconds %i\n",
+					  calculate_elapsed(m->start_time));
+
+	_append_metric_header(body, "repmgrd_monitoring_state", "gauge",
+						  "Current monitoring state");
+	appendUXSQLExpBuffer(body, "repmgrd_monitoring_state{state=\"normal\"} %i\n",
+					  monitoring_state == MS_NORMAL ? 1 : 0);
+	appendUXSQLExpBuffer(body, "repmgrd_monitoring_state{state=\"degraded\"} %i\n",
+					  monitoring_state == MS_DEGRADED ? 1 : 0);
+
+	if (m->failover_state != NULL)
+	{
+		_append_metric_header(body, "repmgrd_failover_state", "gauge",
+							  "Outcome of the most recent failover handling");
+		appendUXSQLExpBufferStr(body, "repmgrd_failover_state{state=");
+		_append_label_value(body, m->failover_state);
+		appendUXSQLExpBufferStr(body, "} 1\n");
+	}
+
+	_append_metric_header(body, "repmgrd_electoral_term", "gauge",
+						  "Electoral term seen in the most recent election");
+	appendUXSQLExpBuffer(body, "repmgrd_electoral_term %i\n", m->electoral_term);
+
+	_append_metric_header(body, "repmgrd_upstream_node_id", "gauge",
+						  "Node ID of the upstream node (-1 if none)");
+	appendUXSQLExpBuffer(body, "repmgrd_upstream_node_id %i\n", m->upstream_node_id);
+
+	_append_metric_header(body, "repmgrd_upstream_last_seen_seconds", "gauge",
+						  "Seconds since the upstream node was last seen (-1 if never)");
+	appendUXSQLExpBuffer(body, "repmgrd_upstream_last_seen_seconds %i\n",
+					  INSTR_TIME_IS_ZERO(m->upstream_last_seen) ? -1 : calculate_elapsed(m->upstream_last_seen));
+
+	if (m->lag_valid == true)
+	{
+		_append_metric_header(body, "repmgrd_replication_lag_bytes", "gauge",
+							  "Bytes of WAL generated on the primary but not yet received");
+		appendUXSQLExpBuffer(body, "repmgrd_replication_lag_bytes %llu\n", m->replication_lag_bytes);
+
+		_append_metric_header(body, "repmgrd_apply_lag_bytes", "gauge",
+							  "Bytes of WAL received but not yet replayed");
+		appendUXSQLExpBuffer(body, "repmgrd_apply_lag_bytes %llu\n", m->apply_lag_bytes);
+
+		_append_metric_header(body, "repmgrd_last_wal_receive_lsn", "gauge",
+							  "Last WAL location received, as a byte position");
+		appendUXSQLExpBuffer(body, "repmgrd_last_wal_receive_lsn %llu\n",
+						  (long long unsigned int) m->last_wal_receive_lsn);
+
+		_append_metric_header(body, "repmgrd_last_wal_replay_lsn", "gauge",
+							  "Last WAL location replayed, as a byte position");
+		appendUXSQLExpBuffer(body, "repmgrd_last_wal_replay_lsn %llu\n",
+						  (long long unsigned int) m->last_wal_replay_lsn);
+
+		_append_metric_header(body, "repmgrd_lag_sample_age_seconds", "gauge",
+							  "Seconds since the lag metrics were last updated");
+		appendUXSQLExpBuffer(body, "repmgrd_lag_sample_age_seconds %i\n",
+						  calculate_elapsed(m->lag_updated));
+	}
+
+	if (local_node_info.type == PRIMARY)
+	{
+		_append_metric_header(body, "repmgrd_child_nodes", "gauge",
+							  "Registered child nodes by attachment state");
+		appendUXSQLExpBuffer(body, "repmgrd_child_nodes{state=\"attached\"} %i\n", m->child_nodes_attached);
+		appendUXSQLExpBuffer(body, "repmgrd_child_nodes{state=\"detached\"} %i\n", m->child_nodes_detached);
+		appendUXSQLExpBuffer(body, "repmgrd_child_nodes{state=\"unknown\"} %i\n", m->child_nodes_unknown);
+	}
+
+	_append_metric_header(body, "repmgrd_reconnects_total", "counter",
+						  "Successful reconnections after a node became unreachable");
+	appendUXSQLExpBuffer(body, "repmgrd_reconnects_total{target=\"local\"} %llu\n", m->local_reconnects);
+	appendUXSQLExpBuffer(body, "repmgrd_reconnects_total{target=\"upstream\"} %llu\n", m->upstream_reconnects);
+
+	_append_metric_header(body, "repmgrd_monitoring_samples_dropped_total", "counter",
+						  "Monitoring history samples discarded because the buffer was full");
+	appendUXSQLExpBuffer(body, "repmgrd_monitoring_samples_dropped_total %llu\n",
+						 m->monitoring_samples_dropped);
+
+	_append_metric_header(body, "repmgrd_log_messages_dropped_total", "counter",
+						  "Log messages discarded because the log queue was full");
+	appendUXSQLExpBuffer(body, "repmgrd_log_messages_dropped_total %llu\n",
+						 (long long unsigned int) logger_dropped_messages());
+}
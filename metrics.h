@@ -0,0 +1,56 @@
+/*
+ * metrics.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+/*
+ * State published by the metrics endpoint; the monitoring code updates
+ * these fields as it obtains the values in the normal course of events.
+ */
+typedef struct
+{
+	instr_time	start_time;
+	const char *failover_state;
+	int			electoral_term;
+	int			upstream_node_id;
+	instr_time	upstream_last_seen;
+	bool		lag_valid;
+	instr_time	lag_updated;
+	XLogRecPtr	last_wal_receive_lsn;
+	XLogRecPtr	last_wal_replay_lsn;
+	long long unsigned int replication_lag_bytes;
+	long long unsigned int apply_lag_bytes;
+	int			child_nodes_attached;
+	int			child_nodes_detached;
+	int			child_nodes_unknown;
+	long long unsigned int local_reconnects;
+	long long unsigned int upstream_reconnects;
+	long long unsigned int monitoring_samples_dropped;
+} t_repmgrd_metrics;
+
+extern t_repmgrd_metrics repmgrd_metrics;
+
+extern bool metrics_server_start(const char *listen_address, int port);
+extern void metrics_server_stop(void);
+extern int	metrics_server_socket(void);
+extern void metrics_server_process(void);
+
+#endif							/* _METRICS_H_ */
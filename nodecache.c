@@ -0,0 +1,505 @@
+/*
+ * nodecache.c - in-memory copy of "repmgr.nodes" kept up to date via
+ *               notifications
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Rather than re-reading "repmgr.nodes" on every monitoring cycle, repmgrd
+ * can keep a copy of all node records, read once from a connection to the
+ * primary which is LISTENing on REPMGR_NODES_CHANNEL. The extension's
+ * trigger on "repmgr.nodes" sends the ID of each modified node on that
+ * channel (or "*" after a TRUNCATE), so after the initial load only the
+ * records which have actually changed need to be fetched again.
+ *
+ * Notifications can only be received on a node which is not in recovery,
+ * and only if the installed extension provides the trigger; the functions
+ * here therefore fall back to querying the provided connection directly
+ * if the cache can't be used with it. The cache is discarded whenever the
+ * connection it was loaded from changes, as notifications sent while it was
+ * not connected have been lost.
+ */
+
+#include "repmgr.h"
+#include "nodecache.h"
+
+typedef struct
+{
+	UXconn	   *conn;
+	int			backend_pid;
+	bool		listening;
+	bool		reload;
+	/* sorted by node ID */
+	t_node_info *records;
+	int			record_count;
+	int			record_capacity;
+	/* IDs of nodes notified as changed since the last update */
+	int		   *changed;
+	int			changed_count;
+	int			changed_capacity;
+} t_node_cache;
+
+static t_node_cache node_cache;
+
+static bool node_cache_attach(UXconn *conn);
+static bool node_cache_update(UXconn *conn);
+static bool node_cache_failed(void);
+static void node_cache_collect_notifies(UXconn *conn);
+static void node_cache_add_changed(int node_id);
+static int	node_cache_find(int node_id);
+static void node_cache_store(t_node_info *node_info);
+static void node_cache_remove(int node_id);
+static void node_cache_build_list(NodeInfoList *node_list, bool child_nodes_only, int upstream_node_id);
+static void node_cache_set_upstream_node_name(t_node_info *node_info);
+
+
+/*
+ * Returns true if "conn" can be used to provide node records from the
+ * cache, updating the cache with any changes notified since it was last
+ * used.
+ */
+bool
+node_cache_available(UXconn *conn)
+{
+	if (conn == NULL || UXSQLstatus(conn) != CONNECTION_OK)
+		return false;
+
+	if (conn != node_cache.conn || UXSQLbackendPID(conn) != node_cache.backend_pid)
+		return node_cache_attach(conn);
+
+	/* LISTEN was not possible on this connection */
+	if (node_cache.listening == false)
+		return false;
+
+	if (UXSQLconsumeInput(conn) == 0)
+		return node_cache_failed();
+
+	node_cache_collect_notifies(conn);
+
+	return node_cache_update(conn);
+}
+
+
+/*
+ * Process any notifications already received on "conn"; for use by code
+ * which reads from a connection while idle, and would otherwise discard
+ * them.
+ */
+void
+node_cache_process_notifies(UXconn *conn)
+{
+	node_cache_collect_notifies(conn);
+}
+
+
+/*
+ * Discard the cache; it will be reloaded the next time it's used. This
+ * must be called when the node's role may have changed, as LISTEN is only
+ * attempted once per connection.
+ */
+void
+node_cache_reset(void)
+{
+	if (node_cache.records != NULL)
+		pfree(node_cache.records);
+
+	if (node_cache.changed != NULL)
+		pfree(node_cache.changed);
+
+	memset(&node_cache, 0, sizeof(t_node_cache));
+}
+
+
+/*
+ * Equivalent to refresh_node_record(), i.e. only the columns of
+ * "repmgr.nodes" in "node_info" are updated.
+ */
+RecordStatus
+node_cache_refresh_node_record(UXconn *conn, int node_id, t_node_info *node_info)
+{
+	t_node_info *cached = NULL;
+	int			ix;
+
+	if (node_cache_available(conn) == false)
+		return refresh_node_record(conn, node_id, node_info);
+
+	ix = node_cache_find(node_id);
+
+	if (ix < 0)
+		return RECORD_NOT_FOUND;
+
+	cached = &node_cache.records[ix];
+
+	node_info->node_id = cached->node_id;
+	node_info->type = cached->type;
+	node_info->upstream_node_id = cached->upstream_node_id;
+	snprintf(node_info->node_name, sizeof(node_info->node_name), "%s", cached->node_name);
+	node_info->conninfo = cached->conninfo;
+	snprintf(node_info->repluser, sizeof(node_info->repluser), "%s", cached->repluser);
+	node_info->slot_name = cached->slot_name;
+	node_info->location = cached->location;
+	node_info->priority = cached->priority;
+	node_info->active = cached->active;
+	node_info->config_file = cached->config_file;
+	node_cache_set_upstream_node_name(node_info);
+	node_info->attached = cached->attached;
+
+	return RECORD_FOUND;
+}
+
+
+/*
+ * Equivalent to ux_get_all_node_records(), i.e. "node_list" is left
+ * unchanged if the records can't be retrieved.
+ */
+void
+node_cache_get_all_node_records(UXconn *conn, NodeInfoList *node_list)
+{
+	if (node_cache_available(conn) == false)
+	{
+		ux_get_all_node_records(conn, node_list);
+		return;
+	}
+
+	node_cache_build_list(node_list, false, UNKNOWN_NODE_ID);
+}
+
+
+/*
+ * Equivalent to get_child_nodes(), except that when the records come from
+ * the cache, the "attached" status of each node is always
+ * NODE_ATTACHED_UNKNOWN; the caller must determine it separately.
+ */
+bool
+node_cache_get_child_nodes(UXconn *conn, int node_id, NodeInfoList *node_list)
+{
+	if (node_cache_available(conn) == false)
+		return get_child_nodes(conn, node_id, node_list);
+
+	node_cache_build_list(node_list, true, node_id);
+
+	return true;
+}
+
+
+static bool
+node_cache_attach(UXconn *conn)
+{
+	node_cache_reset();
+
+	node_cache.conn = conn;
+	node_cache.backend_pid = UXSQLbackendPID(conn);
+
+	if (listen_node_record_changes(conn) == false)
+	{
+		log_verbose(LOG_DEBUG, "node_cache_attach(): node record notifications not available on this connection");
+		return false;
+	}
+
+	log_verbose(LOG_DEBUG, "node_cache_attach(): listening for node record changes");
+
+	node_cache.listening = true;
+	node_cache.reload = true;
+
+	return node_cache_update(conn);
+}
+
+
+/*
+ * Fetch the records of any nodes notified as changed, or all records if
+ * a reload is required.
+ */
+static bool
+node_cache_update(UXconn *conn)
+{
+	NodeInfoList node_list = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoListCell *cell = NULL;
+	bool		success = true;
+	int			i;
+
+	if (node_cache.reload == true)
+	{
+		success = get_all_node_records(conn, &node_list);
+
+		if (success == true)
+		{
+			node_cache.record_count = 0;
+			node_cache.changed_count = 0;
+			node_cache.reload = false;
+
+			for (cell = node_list.head; cell; cell = cell->next)
+				node_cache_store(cell->node_info);
+
+			log_verbose(LOG_DEBUG, "node_cache_update(): loaded %i node records", node_cache.record_count);
+		}
+	}
+	else if (node_cache.changed_count > 0)
+	{
+		success = get_node_records_by_id(conn, node_cache.changed, node_cache.changed_count, &node_list);
+
+		if (success == true)
+		{
+			for (i = 0; i < node_cache.changed_count; i++)
+			{
+				bool		found = false;
+
+				for (cell = node_list.head; cell; cell = cell->next)
+				{
+					if (cell->node_info->node_id == node_cache.changed[i])
+					{
+						node_cache_store(cell->node_info);
+						found = true;
+						break;
+					}
+				}
+
+				/* deleted */
+				if (found == false)
+					node_cache_remove(node_cache.changed[i]);
+			}
+
+			log_verbose(LOG_DEBUG, "node_cache_update(): refreshed %i node records", node_cache.changed_count);
+
+			node_cache.changed_count = 0;
+		}
+	}
+
+	clear_node_info_list(&node_list);
+
+	if (success == false)
+		return node_cache_failed();
+
+	return true;
+}
+
+
+/*
+ * Once an update has failed, it's unknown which changes have been applied,
+ * so the cache is discarded and will be reloaded when next used.
+ */
+static bool
+node_cache_failed(void)
+{
+	log_verbose(LOG_DEBUG, "node_cache_failed(): discarding node record cache");
+
+	node_cache_reset();
+
+	return false;
+}
+
+
+static void
+node_cache_collect_notifies(UXconn *conn)
+{
+	UXnotify   *notify = NULL;
+
+	while ((notify = UXSQLnotifies(conn)) != NULL)
+	{
+		if (conn == node_cache.conn
+			&& node_cache.listening == true
+			&& strcmp(notify->relname, REPMGR_NODES_CHANNEL) == 0)
+		{
+			char	   *endptr = NULL;
+			long		node_id = strtol(notify->extra, &endptr, 10);
+
+			/* "*" is sent after TRUNCATE */
+			if (notify->extra[0] == '\0' || *endptr != '\0')
+				node_cache.reload = true;
+			else
+				node_cache_add_changed((int) node_id);
+		}
+
+		UXSQLfreemem(notify);
+	}
+}
+
+
+static void
+node_cache_add_changed(int node_id)
+{
+	int			i;
+
+	if (node_cache.reload == true)
+		return;
+
+	for (i = 0; i < node_cache.changed_count; i++)
+	{
+		if (node_cache.changed[i] == node_id)
+			return;
+	}
+
+	if (node_cache.changed_count == node_cache.changed_capacity)
+	{
+		int			new_capacity = node_cache.changed_capacity == 0 ? 16 : node_cache.changed_capacity * 2;
+		int		   *changed = ux_malloc0(sizeof(int) * new_capacity);
+
+		if (node_cache.changed != NULL)
+		{
+			memcpy(changed, node_cache.changed, sizeof(int) * node_cache.changed_count);
+			pfree(node_cache.changed);
+		}
+
+		node_cache.changed = changed;
+		node_cache.changed_capacity = new_capacity;
+	}
+
+	node_cache.changed[node_cache.changed_count++] = node_id;
+}
+
+
+static int
+node_cache_find(int node_id)
+{
+	int			low = 0;
+	int			high = node_cache.record_count - 1;
+
+	while (low <= high)
+	{
+		int			mid = (low + high) / 2;
+
+		if (node_cache.records[mid].node_id == node_id)
+			return mid;
+
+		if (node_cache.records[mid].node_id < node_id)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -1;
+}
+
+
+static void
+node_cache_store(t_node_info *node_info)
+{
+	int			ix = node_cache_find(node_info->node_id);
+
+	if (ix < 0)
+	{
+		if (node_cache.record_count == node_cache.record_capacity)
+		{
+			int			new_capacity = node_cache.record_capacity == 0 ? 16 : node_cache.record_capacity * 2;
+			t_node_info *records = ux_malloc0(sizeof(t_node_info) * new_capacity);
+
+			if (node_cache.records != NULL)
+			{
+				memcpy(records, node_cache.records, sizeof(t_node_info) * node_cache.record_count);
+				pfree(node_cache.records);
+			}
+
+			node_cache.records = records;
+			node_cache.record_capacity = new_capacity;
+		}
+
+		/* insert in node ID order */
+		for (ix = node_cache.record_count; ix > 0 && node_cache.records[ix - 1].node_id > node_info->node_id; ix--)
+			node_cache.records[ix] = node_cache.records[ix - 1];
+
+		node_cache.record_count++;
+	}
+
+	node_cache.records[ix] = *node_info;
+
+	/* not owned by the cache */
+	node_cache.records[ix].conn = NULL;
+	node_cache.records[ix].replication_info = NULL;
+}
+
+
+static void
+node_cache_remove(int node_id)
+{
+	int			ix = node_cache_find(node_id);
+
+	if (ix < 0)
+		return;
+
+	memmove(&node_cache.records[ix],
+			&node_cache.records[ix + 1],
+			sizeof(t_node_info) * (node_cache.record_count - ix - 1));
+
+	node_cache.record_count--;
+}
+
+
+/*
+ * Populate "node_list" from the cache, laid out in the same way as the
+ * lists returned by the functions in dbutils.c so it can be freed with
+ * clear_node_info_list().
+ */
+static void
+node_cache_build_list(NodeInfoList *node_list, bool child_nodes_only, int upstream_node_id)
+{
+	int			count = 0;
+	int			i;
+
+	clear_node_info_list(node_list);
+
+	for (i = 0; i < node_cache.record_count; i++)
+	{
+		if (child_nodes_only == false || node_cache.records[i].upstream_node_id == upstream_node_id)
+			count++;
+	}
+
+	if (count == 0)
+		return;
+
+	node_list->cells = (NodeInfoListCell *) ux_malloc0(sizeof(NodeInfoListCell) * count);
+	node_list->node_records = (t_node_info *) ux_malloc0(sizeof(t_node_info) * count);
+
+	for (i = 0; i < node_cache.record_count; i++)
+	{
+		NodeInfoListCell *cell = NULL;
+
+		if (child_nodes_only == true && node_cache.records[i].upstream_node_id != upstream_node_id)
+			continue;
+
+		cell = &node_list->cells[node_list->node_count];
+		cell->node_info = &node_list->node_records[node_list->node_count];
+		*cell->node_info = node_cache.records[i];
+		node_cache_set_upstream_node_name(cell->node_info);
+
+		if (node_list->tail)
+			node_list->tail->next = cell;
+		else
+			node_list->head = cell;
+
+		node_list->tail = cell;
+		node_list->node_count++;
+	}
+}
+
+
+/*
+ * The upstream node name stored with each record comes from a join, and
+ * would not be updated when only the upstream node's record changes, so
+ * it's taken from the upstream node's cached record instead.
+ */
+static void
+node_cache_set_upstream_node_name(t_node_info *node_info)
+{
+	int			ix = -1;
+
+	if (node_info->upstream_node_id != NO_UPSTREAM_NODE)
+		ix = node_cache_find(node_info->upstream_node_id);
+
+	if (ix < 0)
+		node_info->upstream_node_name[0] = '\0';
+	else
+		snprintf(node_info->upstream_node_name, sizeof(node_info->upstream_node_name),
+				 "%s", node_cache.records[ix].node_name);
+}
@@ -0,0 +1,31 @@
+/*
+ * nodecache.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NODECACHE_H_
+#define _NODECACHE_H_
+
+extern bool node_cache_available(UXconn *conn);
+extern void node_cache_process_notifies(UXconn *conn);
+extern void node_cache_reset(void);
+
+extern RecordStatus node_cache_refresh_node_record(UXconn *conn, int node_id, t_node_info *node_info);
+extern void node_cache_get_all_node_records(UXconn *conn, NodeInfoList *node_list);
+extern bool node_cache_get_child_nodes(UXconn *conn, int node_id, NodeInfoList *node_list);
+
+#endif							/* _NODECACHE_H_ */
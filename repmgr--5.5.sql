@@ -0,0 +1,494 @@
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION repmgr" to load this file. \quit
+
+CREATE TABLE repmgr.nodes (
+  node_id          INTEGER     PRIMARY KEY,
+  upstream_node_id INTEGER     NULL REFERENCES nodes (node_id) DEFERRABLE,
+  active           BOOLEAN     NOT NULL DEFAULT TRUE,
+  node_name        TEXT        NOT NULL,
+  type             TEXT        NOT NULL CHECK (type IN('primary','standby','witness','bdr')),
+  location         TEXT        NOT NULL DEFAULT 'default',
+  priority         INT         NOT NULL DEFAULT 100,
+  conninfo         TEXT        NOT NULL,
+  extra_conninfo   TEXT        NULL,
+  repluser         VARCHAR(63) NOT NULL,
+  slot_name        TEXT        NULL,
+  config_file      TEXT        NOT NULL,
+  virtual_ip       TEXT        NULL,
+  network_card     TEXT        NULL,
+  uxdb_passwd      TEXT        NULL,
+  root_passwd      TEXT        NULL
+);
+
+SELECT ux_catalog.ux_extension_config_dump('repmgr.nodes', ' ');
+
+/*
+ * Notify listeners (i.e. repmgrd) which node records have changed, so
+ * they need not re-read the whole table on each monitoring cycle.
+ */
+CREATE FUNCTION nodes_notify_change()
+  RETURNS TRIGGER
+  AS $repmgr$
+BEGIN
+  IF TG_OP = 'TRUNCATE' THEN
+    PERFORM ux_catalog.ux_notify('repmgr_nodes_changed', '*');
+    RETURN NULL;
+  END IF;
+
+  IF TG_OP IN ('UPDATE', 'DELETE') THEN
+    PERFORM ux_catalog.ux_notify('repmgr_nodes_changed', OLD.node_id::TEXT);
+  END IF;
+
+  IF TG_OP IN ('INSERT', 'UPDATE') THEN
+    PERFORM ux_catalog.ux_notify('repmgr_nodes_changed', NEW.node_id::TEXT);
+  END IF;
+
+  RETURN NULL;
+END;
+$repmgr$
+LANGUAGE plpgsql;
+
+CREATE TRIGGER nodes_notify_change
+  AFTER INSERT OR UPDATE OR DELETE ON repmgr.nodes
+  FOR EACH ROW EXECUTE PROCEDURE repmgr.nodes_notify_change();
+
+CREATE TRIGGER nodes_notify_truncate
+  AFTER TRUNCATE ON repmgr.nodes
+  FOR EACH STATEMENT EXECUTE PROCEDURE repmgr.nodes_notify_change();
+
+CREATE TABLE repmgr.events (
+  node_id          INTEGER NOT NULL,
+  event            TEXT NOT NULL,
+  successful       BOOLEAN NOT NULL DEFAULT TRUE,
+  event_timestamp  TIMESTAMP WITH TIME ZONE NOT NULL DEFAULT CURRENT_TIMESTAMP,
+  details          TEXT NULL
+);
+
+SELECT ux_catalog.ux_extension_config_dump('repmgr.events', ' ');
+
+/*
+ * "repmgr cluster event" lists the most recent events, optionally for a
+ * single node or event type; "repmgr cluster cleanup" removes expired ones.
+ */
+CREATE INDEX idx_events_timestamp
+          ON repmgr.events (event_timestamp, node_id, event);
+
+CREATE INDEX idx_events_node_timestamp
+          ON repmgr.events (node_id, event_timestamp);
+
+CREATE INDEX idx_events_event_timestamp
+          ON repmgr.events (event, event_timestamp);
+
+CREATE TABLE repmgr.monitoring_history (
+  primary_node_id                INTEGER NOT NULL,
+  standby_node_id                INTEGER NOT NULL,
+  last_monitor_time              TIMESTAMP WITH TIME ZONE NOT NULL,
+  last_apply_time                TIMESTAMP WITH TIME ZONE,
+  last_wal_primary_location      UX_LSN NOT NULL,
+  last_wal_standby_location      UX_LSN,
+  replication_lag                BIGINT NOT NULL,
+  apply_lag                      BIGINT NOT NULL
+) PARTITION BY RANGE (last_monitor_time);
+
+/*
+ * Daily partitions are created by "create_monitoring_history_partitions()";
+ * rows for which no partition exists are stored here.
+ *
+ * No daily partitions are created by this script, as a restored dump
+ * would then contain partitions which CREATE EXTENSION has already
+ * created; repmgrd creates them on the primary once it starts monitoring.
+ */
+CREATE TABLE repmgr.monitoring_history_default
+  PARTITION OF repmgr.monitoring_history DEFAULT;
+
+CREATE INDEX idx_monitoring_history_time
+          ON repmgr.monitoring_history (last_monitor_time, standby_node_id);
+
+SELECT ux_catalog.ux_extension_config_dump('repmgr.monitoring_history_default', ' ');
+
+CREATE VIEW repmgr.show_nodes AS
+   SELECT n.node_id,
+          n.node_name,
+          n.active,
+          n.upstream_node_id,
+          un.node_name AS upstream_node_name,
+          n.type,
+          n.priority,
+          n.conninfo
+     FROM repmgr.nodes n
+LEFT JOIN repmgr.nodes un
+       ON un.node_id = n.upstream_node_id;
+
+CREATE TABLE repmgr.voting_term (
+  term INT NOT NULL
+);
+
+CREATE UNIQUE INDEX voting_term_restrict
+ON repmgr.voting_term ((TRUE));
+
+CREATE RULE voting_term_delete AS
+   ON DELETE TO repmgr.voting_term
+   DO INSTEAD NOTHING;
+
+
+/* ================= */
+/* repmgrd functions */
+/* ================= */
+
+/* monitoring functions */
+
+CREATE FUNCTION set_local_node_id(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_set_local_node_id'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_local_node_id()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_local_node_id'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION standby_set_last_updated()
+  RETURNS TIMESTAMP WITH TIME ZONE
+  AS 'MODULE_PATHNAME', 'repmgr_standby_set_last_updated'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION standby_get_last_updated()
+  RETURNS TIMESTAMP WITH TIME ZONE
+  AS 'MODULE_PATHNAME', 'repmgr_standby_get_last_updated'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_upstream_last_seen(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_set_upstream_last_seen'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_upstream_last_seen()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_upstream_last_seen'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_upstream_node_id()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_upstream_node_id'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_upstream_node_id(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_set_upstream_node_id'
+  LANGUAGE C STRICT;
+
+/* failover functions */
+
+CREATE FUNCTION notify_follow_primary(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_notify_follow_primary'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_new_primary()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_new_primary'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION reset_voting_status()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_reset_voting_status'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_repmgrd_pid()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'get_repmgrd_pid'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_repmgrd_pidfile()
+  RETURNS TEXT
+  AS 'MODULE_PATHNAME', 'get_repmgrd_pidfile'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION set_repmgrd_pid(INT, TEXT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'set_repmgrd_pid'
+  LANGUAGE C CALLED ON NULL INPUT;
+
+CREATE FUNCTION repmgrd_is_running()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'repmgrd_is_running'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION repmgrd_pause(BOOL)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgrd_pause'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION repmgrd_is_paused()
+  RETURNS BOOL
+  AS 'MODULE_PATHNAME', 'repmgrd_is_paused'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_wal_receiver_pid()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_wal_receiver_pid'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_repmgrd_state(
+  OUT local_node_id INT,
+  OUT repmgrd_pid INT,
+  OUT repmgrd_pidfile TEXT,
+  OUT repmgrd_running BOOL,
+  OUT repmgrd_paused BOOL,
+  OUT upstream_node_id INT,
+  OUT upstream_last_seen INT,
+  OUT last_updated TIMESTAMP WITH TIME ZONE)
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME', 'get_repmgrd_state'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION record_lag_sample()
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_record_lag_sample'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION lag_history(
+  OUT sample_time TIMESTAMP WITH TIME ZONE,
+  OUT last_wal_receive_lsn UX_LSN,
+  OUT last_wal_replay_lsn UX_LSN,
+  OUT apply_lag BIGINT,
+  OUT last_xact_replay_timestamp TIMESTAMP WITH TIME ZONE,
+  OUT upstream_last_seen INT)
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME', 'repmgr_lag_history'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION standby_status(
+  OUT ts TIMESTAMP WITH TIME ZONE,
+  OUT in_recovery BOOL,
+  OUT last_wal_receive_lsn UX_LSN,
+  OUT last_wal_replay_lsn UX_LSN,
+  OUT last_xact_replay_timestamp TIMESTAMP WITH TIME ZONE,
+  OUT replication_lag_time INT,
+  OUT receiving_streamed_wal BOOL,
+  OUT wal_replay_paused BOOL,
+  OUT upstream_last_seen INT,
+  OUT upstream_node_id INT,
+  OUT timeline_id INT,
+  OUT local_node_id INT,
+  OUT repmgrd_paused BOOL)
+  RETURNS record
+  AS $repmgr$
+  SELECT ts,
+         in_recovery,
+         last_wal_receive_lsn,
+         last_wal_replay_lsn,
+         last_xact_replay_timestamp,
+         CASE WHEN (last_wal_receive_lsn = last_wal_replay_lsn)
+           THEN 0::INT
+         ELSE
+           CASE WHEN last_xact_replay_timestamp IS NULL
+             THEN 0::INT
+           ELSE
+             EXTRACT(epoch FROM (ux_catalog.clock_timestamp() - last_xact_replay_timestamp))::INT
+           END
+         END,
+         last_wal_receive_lsn >= last_wal_replay_lsn,
+         wal_replay_paused,
+         upstream_last_seen,
+         upstream_node_id,
+         timeline_id,
+         local_node_id,
+         repmgrd_paused
+    FROM (
+  SELECT CURRENT_TIMESTAMP AS ts,
+         ux_catalog.ux_is_in_recovery() AS in_recovery,
+         ux_catalog.ux_last_xact_replay_timestamp() AS last_xact_replay_timestamp,
+         COALESCE(ux_catalog.ux_last_wal_receive_lsn(), '0/0'::UX_LSN) AS last_wal_receive_lsn,
+         COALESCE(ux_catalog.ux_last_wal_replay_lsn(),  '0/0'::UX_LSN) AS last_wal_replay_lsn,
+         CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE
+           THEN FALSE
+           ELSE ux_catalog.ux_is_wal_replay_paused()
+         END AS wal_replay_paused,
+         CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE
+           THEN -1
+           ELSE repmgr.get_upstream_last_seen()
+         END AS upstream_last_seen,
+         CASE WHEN ux_catalog.ux_is_in_recovery() IS FALSE
+           THEN -1
+           ELSE repmgr.get_upstream_node_id()
+         END AS upstream_node_id,
+         (SELECT c.timeline_id FROM ux_catalog.ux_control_checkpoint() c)::INT AS timeline_id,
+         repmgr.get_local_node_id() AS local_node_id,
+         repmgr.repmgrd_is_paused() AS repmgrd_paused
+         ) q
+$repmgr$
+LANGUAGE sql;
+
+
+
+
+/* monitoring history partition management */
+
+/*
+ * Partitions cover one UTC day each, regardless of the server's TimeZone
+ * setting, so partition names and bounds are the same for every session.
+ *
+ * Partitions are created at runtime by repmgrd and "repmgr cluster cleanup"
+ * and are not members of the extension; they are dumped and restored as
+ * ordinary partitions of "repmgr.monitoring_history".
+ */
+
+CREATE FUNCTION create_monitoring_history_partition(DATE)
+  RETURNS BOOL
+  AS $repmgr$
+DECLARE
+  partition_date ALIAS FOR $1;
+  partition_name TEXT;
+  range_start    TIMESTAMP WITH TIME ZONE;
+  range_end      TIMESTAMP WITH TIME ZONE;
+BEGIN
+  partition_name := 'monitoring_history_' || ux_catalog.to_char(partition_date, 'YYYYMMDD');
+
+  IF ux_catalog.to_regclass('repmgr.' || partition_name) IS NOT NULL THEN
+    RETURN FALSE;
+  END IF;
+
+  range_start := partition_date::TIMESTAMP AT TIME ZONE 'UTC';
+  range_end := (partition_date + 1)::TIMESTAMP AT TIME ZONE 'UTC';
+
+  /*
+   * Any rows for this day which were written to the default partition
+   * must be moved before the new partition can be attached.
+   */
+  EXECUTE ux_catalog.format(
+    'CREATE TABLE repmgr.%I (LIKE repmgr.monitoring_history)',
+    partition_name);
+
+  EXECUTE ux_catalog.format(
+    'WITH moved AS (DELETE FROM repmgr.monitoring_history_default '
+    '                WHERE last_monitor_time >= %L AND last_monitor_time < %L '
+    '            RETURNING *) '
+    'INSERT INTO repmgr.%I SELECT * FROM moved',
+    range_start,
+    range_end,
+    partition_name);
+
+  EXECUTE ux_catalog.format(
+    'ALTER TABLE repmgr.monitoring_history ATTACH PARTITION repmgr.%I '
+    '  FOR VALUES FROM (%L) TO (%L)',
+    partition_name,
+    range_start,
+    range_end);
+
+  RETURN TRUE;
+END;
+$repmgr$
+LANGUAGE plpgsql STRICT;
+
+CREATE FUNCTION create_monitoring_history_partitions(INT)
+  RETURNS INT
+  AS $repmgr$
+DECLARE
+  days_ahead     ALIAS FOR $1;
+  today          DATE := (ux_catalog.now() AT TIME ZONE 'UTC')::DATE;
+  created        INT := 0;
+BEGIN
+  FOR i IN 0 .. days_ahead LOOP
+    IF repmgr.create_monitoring_history_partition(today + i) THEN
+      created := created + 1;
+    END IF;
+  END LOOP;
+
+  RETURN created;
+END;
+$repmgr$
+LANGUAGE plpgsql STRICT;
+
+CREATE FUNCTION drop_monitoring_history_partitions(INT)
+  RETURNS INT
+  AS $repmgr$
+DECLARE
+  keep_history   ALIAS FOR $1;
+  partition_name TEXT;
+  dropped        INT := 0;
+BEGIN
+  FOR partition_name IN
+    SELECT c.relname
+      FROM ux_catalog.ux_inherits i
+      JOIN ux_catalog.ux_class c ON c.oid = i.inhrelid
+     WHERE i.inhparent = 'repmgr.monitoring_history'::regclass
+       AND c.relname ~ '^monitoring_history_[0-9]{8}$'
+  ORDER BY c.relname
+  LOOP
+    /* drop only partitions whose entire range is older than the retention period */
+    IF ((ux_catalog.to_date(ux_catalog.substr(partition_name, 20), 'YYYYMMDD') + 1)::TIMESTAMP AT TIME ZONE 'UTC')
+         > ux_catalog.now() - (keep_history || ' days')::INTERVAL THEN
+      EXIT;
+    END IF;
+
+    EXECUTE ux_catalog.format('DROP TABLE repmgr.%I', partition_name);
+    dropped := dropped + 1;
+  END LOOP;
+
+  RETURN dropped;
+END;
+$repmgr$
+LANGUAGE plpgsql STRICT;
+
+
+/* views */
+
+CREATE VIEW repmgr.replication_status AS
+  SELECT m.primary_node_id, m.standby_node_id, n.node_name AS standby_name,
+ 	     n.type AS node_type, n.active, last_monitor_time,
+         CASE WHEN n.type='standby' THEN m.last_wal_primary_location ELSE NULL END AS last_wal_primary_location,
+         m.last_wal_standby_location,
+         CASE WHEN n.type='standby' THEN ux_catalog.ux_size_pretty(m.replication_lag) ELSE NULL END AS replication_lag,
+         CASE WHEN n.type='standby' THEN
+           CASE WHEN replication_lag > 0 THEN age(now(), m.last_apply_time) ELSE '0'::INTERVAL END
+           ELSE NULL
+         END AS replication_time_lag,
+         CASE WHEN n.type='standby' THEN ux_catalog.ux_size_pretty(m.apply_lag) ELSE NULL END AS apply_lag,
+         AGE(NOW(), CASE WHEN ux_catalog.ux_is_in_recovery() THEN repmgr.standby_get_last_updated() ELSE m.last_monitor_time END) AS communication_time_lag
+    FROM repmgr.monitoring_history m
+    JOIN repmgr.nodes n ON m.standby_node_id = n.node_id
+   WHERE (m.standby_node_id, m.last_monitor_time) IN (
+	          SELECT m1.standby_node_id, MAX(m1.last_monitor_time)
+			    FROM repmgr.monitoring_history m1 GROUP BY 1
+         );
+
+/* archive status backlog, as counted by repmgrd */
+
+CREATE FUNCTION set_archive_ready_files(INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_set_archive_ready_files'
+  LANGUAGE C STRICT;
+
+CREATE FUNCTION get_archive_ready_files()
+  RETURNS INT
+  AS 'MODULE_PATHNAME', 'repmgr_get_archive_ready_files'
+  LANGUAGE C STRICT;
+
+/* state of the other nodes in the cluster, as seen by the repmgrd on a witness */
+
+CREATE FUNCTION set_cluster_node_state(
+  node_id INT,
+  reachable BOOL,
+  repmgrd_running BOOL,
+  in_recovery BOOL,
+  last_wal_receive_lsn UX_LSN,
+  upstream_node_id INT,
+  upstream_last_seen INT)
+  RETURNS VOID
+  AS 'MODULE_PATHNAME', 'repmgr_set_cluster_node_state'
+  LANGUAGE C;
+
+CREATE FUNCTION cluster_view(
+  OUT node_id INT,
+  OUT reachable BOOL,
+  OUT repmgrd_running BOOL,
+  OUT in_recovery BOOL,
+  OUT last_wal_receive_lsn UX_LSN,
+  OUT upstream_node_id INT,
+  OUT upstream_last_seen INT,
+  OUT last_seen INT,
+  OUT updated TIMESTAMP WITH TIME ZONE)
+  RETURNS SETOF record
+  AS 'MODULE_PATHNAME', 'repmgr_cluster_view'
+  LANGUAGE C STRICT;
@@ -58,9 +58,14 @@ typedef enum
 struct ColHeader headers_show[SHOW_HEADER_COUNT];
 struct ColHeader headers_event[EVENT_HEADER_COUNT];
 
-static int	build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, int *error_code);
-static int	build_cluster_crosscheck(t_node_status_cube ***cube_dest, ItemList *warnings, int *error_code);
-static void cube_set_node_status(t_node_status_cube **cube, int n, int node_id, int matrix_node_id, int connection_node_id, int connection_status);
+static int	build_cluster_matrix(t_node_status_matrix *matrix, ItemList *warnings, int *error_code);
+static int	build_cluster_crosscheck(t_node_status_matrix *cube, ItemList *warnings, int *error_code);
+static void init_node_status_matrix(t_node_status_matrix *matrix, NodeInfoList *nodes, int dimensions);
+static void clear_node_status_matrix(t_node_status_matrix *matrix);
+static int	node_status_matrix_index(t_node_status_matrix *matrix, int node_id);
+static int	compare_node_id_index(const void *a, const void *b);
+static void matrix_set_node_status(t_node_status_matrix *matrix, int node_id, int connection_node_id, int connection_status);
+static void cube_set_node_status(t_node_status_matrix *cube, int node_id, int matrix_node_id, int connection_node_id, int connection_status);
 
 /*
  * CLUSTER SHOW
@@ -166,6 +171,12 @@ do_cluster_show(void)
 	 * unreachable.
 	 */
 
+	/*
+	 * Connect to all nodes concurrently, so that unreachable nodes don't
+	 * each add a full "connect_timeout" to the execution time.
+	 */
+	(void) establish_node_connections_quiet(&nodes);
+
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
 		UXSQLExpBufferData node_status;
@@ -181,8 +192,6 @@ do_cluster_show(void)
 
 		init_replication_info(cell->node_info->replication_info);
 
-		cell->node_info->conn = establish_db_connection_quiet(cell->node_info->conninfo);
-
 		if (UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
 		{
 			connection_error_found = true;
@@ -192,6 +201,11 @@ do_cluster_show(void)
 				char		error[MAXLEN];
 
 				strncpy(error, UXSQLerrorMessage(cell->node_info->conn), MAXLEN);
+
+				/* connection attempt abandoned after "connect_timeout" */
+				if (error[0] == '\0')
+					strncpy(error, _("timeout expired"), MAXLEN);
+
 				item_list_append_format(&warnings,
 										"when attempting to connect to node \"%s\" (ID: %i), following error encountered :\n\"%s\"",
 										cell->node_info->node_name, cell->node_info->node_id, trim(error));
@@ -209,7 +223,7 @@ do_cluster_show(void)
 			cell->node_info->replication_info->timeline_id = get_node_timeline(cell->node_info->conn,
 																			   cell->node_info->replication_info->timeline_id_str);
 			/* uxdb: get replication info. */
-			get_replication_info(cell->node_info->conn, cell->node_info->type,&cell->replinfo);
+			get_replication_info(cell->node_info->conn, cell->node_info->type, cell->node_info->replication_info);
 		}
 
 		initUXSQLExpBuffer(&node_status);
@@ -218,8 +232,7 @@ do_cluster_show(void)
 		if (format_node_status(cell->node_info, &node_status, &upstream, &warnings) == true)
 			error_found = true;
 
-		snprintf(cell->node_info->details, sizeof(cell->node_info->details),
-				 "%s", node_status.data);
+		cell->node_info->details = intern_string(node_status.data);
 		snprintf(cell->node_info->upstream_node_name, sizeof(cell->node_info->upstream_node_name),
 				 "%s", upstream.data);
 
@@ -257,7 +270,7 @@ do_cluster_show(void)
 
 		/* uxdb: replication_lag_bytes -- yangjie */
 		if ((primary_last_wal_location != InvalidXLogRecPtr) && 
-			(primary_last_wal_location >= cell->replinfo.last_wal_receive_lsn)&&(sync_async != NULL))
+			(primary_last_wal_location >= cell->node_info->replication_info->last_wal_receive_lsn)&&(sync_async != NULL))
 		{
 			/*BEGIN: Modified by douwen for bug #179168, 2023/3/16,reviewer:huyn*/
 			if(strcmp(sync_async,"sync")==0)
@@ -266,7 +279,7 @@ do_cluster_show(void)
 			}
 			else
 			{
-				replication_lag_bytes = (long long unsigned int) (primary_last_wal_location - cell->replinfo.last_wal_receive_lsn);
+				replication_lag_bytes = (long long unsigned int) (primary_last_wal_location - cell->node_info->replication_info->last_wal_receive_lsn);
 			}
 			/*End: Modified by douwen for bug #179168, 2023/3/16,reviewer:huyn*/
 		}
@@ -277,7 +290,7 @@ do_cluster_show(void)
 		get_ux_size_pretty(conn, replication_lag_bytes, lag_str);
 
 		headers_show[SHOW_LAG].cur_length = strlen(lag_str);
-		sprintf(repl_str, "%X/%X", format_lsn(cell->replinfo.last_wal_replay_lsn));
+		sprintf(repl_str, "%X/%X", format_lsn(cell->node_info->replication_info->last_wal_replay_lsn));
 		headers_show[SHOW_REPLAYLSN].cur_length = strlen(repl_str);
 
 		for (i = 0; i < SHOW_HEADER_COUNT; i++)
@@ -350,7 +363,7 @@ do_cluster_show(void)
 			if (cell->node_info->type == STANDBY)
 			{
 				/* replication_lag_bytes */
-				if ((primary_last_wal_location != InvalidXLogRecPtr && primary_last_wal_location >= cell->replinfo.last_wal_receive_lsn)&&(sync_async != NULL))
+				if ((primary_last_wal_location != InvalidXLogRecPtr && primary_last_wal_location >= cell->node_info->replication_info->last_wal_receive_lsn)&&(sync_async != NULL))
 				{		
 					/*BEGIN: Modified by douwen for bug #179168, 2023/3/16,reviewer:huyn*/
 					if(strcmp(sync_async,"sync")==0)
@@ -359,7 +372,7 @@ do_cluster_show(void)
 					}
 					else
 					{
-						replication_lag_bytes = (long long unsigned int) (primary_last_wal_location - cell->replinfo.last_wal_receive_lsn);
+						replication_lag_bytes = (long long unsigned int) (primary_last_wal_location - cell->node_info->replication_info->last_wal_receive_lsn);
 					}
 				}
 				else
@@ -375,7 +388,7 @@ do_cluster_show(void)
 				printf("| %-*s ", headers_show[SHOW_LAG].max_length, lag_str);
 
 				if (cell->node_info->active == true)
-					sprintf(repl_str, "%X/%X", format_lsn(cell->replinfo.last_wal_replay_lsn));
+					sprintf(repl_str, "%X/%X", format_lsn(cell->node_info->replication_info->last_wal_replay_lsn));
 				else
 					sprintf(repl_str, "unknown");
 				printf("| %-*s", headers_show[SHOW_REPLAYLSN].max_length, repl_str);
@@ -467,6 +480,8 @@ do_cluster_event(void)
 							runtime_options.node_id,
 							runtime_options.node_name,
 							runtime_options.event,
+							runtime_options.after,
+							runtime_options.before,
 							runtime_options.all,
 							runtime_options.limit);
 
@@ -601,7 +616,7 @@ do_cluster_crosscheck(void)
 	int			i = 0,
 				n = 0;
 
-	t_node_status_cube **cube;
+	t_node_status_matrix cube = T_NODE_STATUS_MATRIX_INITIALIZER;
 
 	bool		connection_error_found = false;
 	int			error_code = SUCCESS;
@@ -621,14 +636,14 @@ do_cluster_crosscheck(void)
 
 				for (node_ix = 0; node_ix < n; node_ix++)
 				{
-					int			node_status = cube[node_ix]->matrix_list_rec[i]->node_status_list[j]->node_status;
+					int			node_status = cube_node_status(&cube, node_ix, i, j);
 
 					if (node_status > max_node_status)
 						max_node_status = node_status;
 				}
 				printf("%i,%i,%i\n",
-					   cube[i]->node_id,
-					   cube[j]->node_id,
+					   matrix_node_id(&cube, i),
+					   matrix_node_id(&cube, j),
 					   max_node_status);
 
 				if (max_node_status == -1)
@@ -655,7 +670,7 @@ do_cluster_crosscheck(void)
 
 		for (i = 0; i < n; i++)
 		{
-			maxlen_snprintf(headers_crosscheck[header_id].title, "%i", cube[i]->node_id);
+			maxlen_snprintf(headers_crosscheck[header_id].title, "%i", matrix_node_id(&cube, i));
 			header_id++;
 		}
 
@@ -675,9 +690,9 @@ do_cluster_crosscheck(void)
 
 		for (i = 0; i < n; i++)
 		{
-			if (strlen(cube[i]->node_name) > headers_crosscheck[0].max_length)
+			if (strlen(matrix_node_name(&cube, i)) > headers_crosscheck[0].max_length)
 			{
-				headers_crosscheck[0].max_length = strlen(cube[i]->node_name);
+				headers_crosscheck[0].max_length = strlen(matrix_node_name(&cube, i));
 			}
 		}
 
@@ -689,9 +704,9 @@ do_cluster_crosscheck(void)
 
 			printf(" %-*s | %-*i ",
 				   headers_crosscheck[0].max_length,
-				   cube[i]->node_name,
+				   matrix_node_name(&cube, i),
 				   headers_crosscheck[1].max_length,
-				   cube[i]->node_id);
+				   matrix_node_id(&cube, i));
 
 			for (column_node_ix = 0; column_node_ix < n; column_node_ix++)
 			{
@@ -716,7 +731,7 @@ do_cluster_crosscheck(void)
 
 				for (node_ix = 0; node_ix < n; node_ix++)
 				{
-					int			node_status = cube[node_ix]->matrix_list_rec[i]->node_status_list[column_node_ix]->node_status;
+					int			node_status = cube_node_status(&cube, node_ix, i, column_node_ix);
 
 					if (node_status > max_node_status)
 						max_node_status = node_status;
@@ -755,29 +770,7 @@ do_cluster_crosscheck(void)
 
 	}
 
-	/* clean up allocated cube array */
-	{
-		int			h,
-					j;
-
-		for (h = 0; h < n; h++)
-		{
-			for (i = 0; i < n; i++)
-			{
-				for (j = 0; j < n; j++)
-				{
-					free(cube[h]->matrix_list_rec[i]->node_status_list[j]);
-				}
-				free(cube[h]->matrix_list_rec[i]->node_status_list);
-				free(cube[h]->matrix_list_rec[i]);
-			}
-
-			free(cube[h]->matrix_list_rec);
-			free(cube[h]);
-		}
-
-		free(cube);
-	}
+	clear_node_status_matrix(&cube);
 
 	/* errors detected by build_cluster_crosscheck() have priority */
 	if (connection_error_found == true)
@@ -803,13 +796,13 @@ do_cluster_matrix()
 				j = 0,
 				n = 0;
 
-	t_node_matrix_rec **matrix_rec_list;
+	t_node_status_matrix matrix = T_NODE_STATUS_MATRIX_INITIALIZER;
 
 	bool		connection_error_found = false;
 	int			error_code = SUCCESS;
 	ItemList	warnings = {NULL, NULL};
 
-	n = build_cluster_matrix(&matrix_rec_list, &warnings, &error_code);
+	n = build_cluster_matrix(&matrix, &warnings, &error_code);
 
 	if (runtime_options.output_mode == OM_CSV)
 	{
@@ -818,12 +811,12 @@ do_cluster_matrix()
 			for (j = 0; j < n; j++)
 			{
 				printf("%d,%d,%d\n",
-					   matrix_rec_list[i]->node_id,
-					   matrix_rec_list[i]->node_status_list[j]->node_id,
-					   matrix_rec_list[i]->node_status_list[j]->node_status);
+					   matrix_node_id(&matrix, i),
+					   matrix_node_id(&matrix, j),
+					   matrix_node_status(&matrix, i, j));
 
-				if (matrix_rec_list[i]->node_status_list[j]->node_status == -2
-					|| matrix_rec_list[i]->node_status_list[j]->node_status == -1)
+				if (matrix_node_status(&matrix, i, j) == -2
+					|| matrix_node_status(&matrix, i, j) == -1)
 				{
 					connection_error_found = true;
 				}
@@ -846,7 +839,7 @@ do_cluster_matrix()
 
 		for (i = 0; i < n; i++)
 		{
-			maxlen_snprintf(headers_matrix[header_id].title, "%i", matrix_rec_list[i]->node_id);
+			maxlen_snprintf(headers_matrix[header_id].title, "%i", matrix_node_id(&matrix, i));
 			header_id++;
 		}
 
@@ -867,9 +860,9 @@ do_cluster_matrix()
 
 		for (i = 0; i < n; i++)
 		{
-			if (strlen(matrix_rec_list[i]->node_name) > headers_matrix[0].max_length)
+			if (strlen(matrix_node_name(&matrix, i)) > headers_matrix[0].max_length)
 			{
-				headers_matrix[0].max_length = strlen(matrix_rec_list[i]->node_name);
+				headers_matrix[0].max_length = strlen(matrix_node_name(&matrix, i));
 			}
 		}
 
@@ -879,14 +872,14 @@ do_cluster_matrix()
 		{
 			printf(" %-*s | %-*i ",
 				   headers_matrix[0].max_length,
-				   matrix_rec_list[i]->node_name,
+				   matrix_node_name(&matrix, i),
 				   headers_matrix[1].max_length,
-				   matrix_rec_list[i]->node_id);
+				   matrix_node_id(&matrix, i));
 			for (j = 0; j < n; j++)
 			{
 				char		c;
 
-				switch (matrix_rec_list[i]->node_status_list[j]->node_status)
+				switch (matrix_node_status(&matrix, i, j))
 				{
 					case -2:
 						c = '?';
@@ -899,7 +892,7 @@ do_cluster_matrix()
 						c = '*';
 						break;
 					default:
-						log_error("unexpected node status value %i", matrix_rec_list[i]->node_status_list[j]->node_status);
+						log_error("unexpected node status value %i", matrix_node_status(&matrix, i, j));
 						exit(ERR_INTERNAL);
 				}
 
@@ -918,17 +911,7 @@ do_cluster_matrix()
 
 	}
 
-	for (i = 0; i < n; i++)
-	{
-		for (j = 0; j < n; j++)
-		{
-			free(matrix_rec_list[i]->node_status_list[j]);
-		}
-		free(matrix_rec_list[i]->node_status_list);
-		free(matrix_rec_list[i]);
-	}
-
-	free(matrix_rec_list);
+	clear_node_status_matrix(&matrix);
 
 	/* actual database connection errors have priority */
 	if (connection_error_found == true)
@@ -940,32 +923,119 @@ do_cluster_matrix()
 }
 
 
+/*
+ * Initialise a status matrix (dimensions == 2) or cube (dimensions == 3)
+ * for the nodes in "nodes", with all entries set to -2 (unknown).
+ *
+ * The status entries, node IDs, node ID index and node names are carved
+ * out of a single allocation, which is freed by clear_node_status_matrix().
+ */
 static void
-matrix_set_node_status(t_node_matrix_rec **matrix_rec_list, int n, int node_id, int connection_node_id, int connection_status)
+init_node_status_matrix(t_node_status_matrix *matrix, NodeInfoList *nodes, int dimensions)
 {
-	int			i,
-				j;
+	NodeInfoListCell *cell = NULL;
+	size_t		status_count = 1;
+	size_t		i;
+	char	   *storage = NULL;
+
+	matrix->node_count = nodes->node_count;
+	matrix->dimensions = dimensions;
+
+	for (i = 0; i < (size_t) dimensions; i++)
+		status_count *= (size_t) nodes->node_count;
+
+	storage = ux_malloc0(sizeof(int) * status_count
+						 + sizeof(int) * nodes->node_count
+						 + sizeof(t_node_id_index) * nodes->node_count
+						 + NAMEDATALEN * nodes->node_count);
 
-	for (i = 0; i < n; i++)
+	matrix->node_status = (int *) storage;
+	matrix->node_ids = matrix->node_status + status_count;
+	matrix->id_index = (t_node_id_index *) (matrix->node_ids + nodes->node_count);
+	matrix->node_names = (char *) (matrix->id_index + nodes->node_count);
+
+	for (i = 0; i < status_count; i++)
+		matrix->node_status[i] = -2;	/* default unknown */
+
+	i = 0;
+	for (cell = nodes->head; cell; cell = cell->next)
 	{
-		if (matrix_rec_list[i]->node_id == node_id)
-		{
-			for (j = 0; j < n; j++)
-			{
-				if (matrix_rec_list[i]->node_status_list[j]->node_id == connection_node_id)
-				{
-					matrix_rec_list[i]->node_status_list[j]->node_status = connection_status;
-					break;
-				}
-			}
-			break;
-		}
+		matrix->node_ids[i] = cell->node_info->node_id;
+		matrix->id_index[i].node_id = cell->node_info->node_id;
+		matrix->id_index[i].node_ix = (int) i;
+		strncpy(matrix_node_name(matrix, i),
+				cell->node_info->node_name,
+				NAMEDATALEN - 1);
+		i++;
 	}
+
+	qsort(matrix->id_index, matrix->node_count, sizeof(t_node_id_index), compare_node_id_index);
+}
+
+
+static void
+clear_node_status_matrix(t_node_status_matrix *matrix)
+{
+	if (matrix->node_status != NULL)
+		free(matrix->node_status);
+
+	matrix->node_count = 0;
+	matrix->node_status = NULL;
+	matrix->node_ids = NULL;
+	matrix->id_index = NULL;
+	matrix->node_names = NULL;
+}
+
+
+static int
+compare_node_id_index(const void *a, const void *b)
+{
+	int			node_id_a = ((const t_node_id_index *) a)->node_id;
+	int			node_id_b = ((const t_node_id_index *) b)->node_id;
+
+	if (node_id_a < node_id_b)
+		return -1;
+	if (node_id_a > node_id_b)
+		return 1;
+	return 0;
+}
+
+
+/*
+ * Return the matrix index of the node with the provided ID, or -1 if
+ * the node is not in the matrix (e.g. a remote node returned a node ID
+ * we don't know about).
+ */
+static int
+node_status_matrix_index(t_node_status_matrix *matrix, int node_id)
+{
+	t_node_id_index key;
+	t_node_id_index *entry = NULL;
+
+	key.node_id = node_id;
+
+	entry = bsearch(&key, matrix->id_index, matrix->node_count,
+					sizeof(t_node_id_index), compare_node_id_index);
+
+	return (entry == NULL) ? -1 : entry->node_ix;
+}
+
+
+static void
+matrix_set_node_status(t_node_status_matrix *matrix, int node_id, int connection_node_id, int connection_status)
+{
+	int			i = node_status_matrix_index(matrix, node_id);
+	int			j = node_status_matrix_index(matrix, connection_node_id);
+
+	if (i == -1 || j == -1)
+		return;
+
+	matrix_node_status(matrix, i, j) = connection_status;
 }
 
 
 static int
-build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, int *error_code)
+build_cluster_matrix(t_node_status_matrix *matrix, ItemList *warnings, int *error_code)
 {
 	UXconn	   *conn = NULL;
 	int			i = 0,
@@ -976,9 +1046,10 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 	NodeInfoListCell *cell = NULL;
 
 	UXSQLExpBufferData command;
-	UXSQLExpBufferData command_output;
+	UXSQLExpBufferData remote_command_str;
 
-	t_node_matrix_rec **matrix_rec_list;
+	t_parallel_command *tasks = NULL;
+	int			task_count = 0;
 
 	/* obtain node list from the database */
 	log_info(_("connecting to database"));
@@ -1011,94 +1082,53 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 	}
 
 	/*
-	 * Allocate an empty matrix record list
+	 * Initialise an empty status matrix
 	 *
 	 * -2 == NULL  ? -1 == Error x 0 == OK
 	 */
+	init_node_status_matrix(matrix, &nodes, 2);
 
-	matrix_rec_list = (t_node_matrix_rec **) ux_malloc0(sizeof(t_node_matrix_rec) * nodes.node_count);
-
-	i = 0;
-
-	/* Initialise matrix structure for each node */
-	for (cell = nodes.head; cell; cell = cell->next)
-	{
-		NodeInfoListCell *cell_j;
-
-		matrix_rec_list[i] = (t_node_matrix_rec *) ux_malloc0(sizeof(t_node_matrix_rec));
-
-		matrix_rec_list[i]->node_id = cell->node_info->node_id;
-		strncpy(matrix_rec_list[i]->node_name,
-				cell->node_info->node_name,
-				sizeof(matrix_rec_list[i]->node_name));
-
-		matrix_rec_list[i]->node_status_list = (t_node_status_rec **) ux_malloc0(sizeof(t_node_status_rec) * nodes.node_count);
-
-		j = 0;
-
-		for (cell_j = nodes.head; cell_j; cell_j = cell_j->next)
-		{
-			matrix_rec_list[i]->node_status_list[j] = (t_node_status_rec *) ux_malloc0(sizeof(t_node_status_rec));
-			matrix_rec_list[i]->node_status_list[j]->node_id = cell_j->node_info->node_id;
-			matrix_rec_list[i]->node_status_list[j]->node_status = -2;	/* default unknown */
-
-			j++;
-		}
-
-		i++;
-	}
+	/*
+	 * Check database connectivity from the local node to each node, and
+	 * queue up a `repmgr cluster show --csv` command for each remote node
+	 * we can reach.
+	 */
+	tasks = (t_parallel_command *) ux_malloc0(sizeof(t_parallel_command) * nodes.node_count);
 
-	/* Fetch `repmgr cluster show --csv` output for each node */
-	i = 0;
+	(void) establish_node_connections_quiet(&nodes);
 
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
 		int			connection_status = 0;
 		t_conninfo_param_list remote_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
-		char	   *host = NULL,
-				   *p = NULL;
+		char	   *host = NULL;
 		int			connection_node_id = cell->node_info->node_id;
-		int			x,
-					y;
-		UXconn	   *node_conn = NULL;
-
-		initialize_conninfo_params(&remote_conninfo, false);
-		parse_conninfo_string(cell->node_info->conninfo,
-							  &remote_conninfo,
-							  NULL,
-							  false);
-
-		host = param_get(&remote_conninfo, "host");
-
-		node_conn = establish_db_connection_quiet(cell->node_info->conninfo);
 
 		connection_status =
-			(UXSQLstatus(node_conn) == CONNECTION_OK) ? 0 : -1;
+			(UXSQLstatus(cell->node_info->conn) == CONNECTION_OK) ? 0 : -1;
 
+		UXSQLfinish(cell->node_info->conn);
+		cell->node_info->conn = NULL;
 
-		matrix_set_node_status(matrix_rec_list,
-							   nodes.node_count,
+		matrix_set_node_status(matrix,
 							   local_node_id,
 							   connection_node_id,
 							   connection_status);
 
-
 		if (connection_status)
-		{
-			free_conninfo_params(&remote_conninfo);
-			UXSQLfinish(node_conn);
-			node_conn = NULL;
 			continue;
-		}
 
 		/* We don't need to issue `cluster show --csv` for the local node */
 		if (connection_node_id == local_node_id)
-		{
-			free_conninfo_params(&remote_conninfo);
-			UXSQLfinish(node_conn);
-			node_conn = NULL;
 			continue;
-		}
+
+		initialize_conninfo_params(&remote_conninfo, false);
+		parse_conninfo_string(cell->node_info->conninfo,
+							  &remote_conninfo,
+							  NULL,
+							  false);
+
+		host = param_get(&remote_conninfo, "host");
 
 		initUXSQLExpBuffer(&command);
 
@@ -1126,22 +1156,56 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 		}
 		appendUXSQLExpBufferChar(&command, '"');
 
-		log_verbose(LOG_DEBUG, "build_cluster_matrix(): executing:\n  %s", command.data);
+		initUXSQLExpBuffer(&remote_command_str);
+		make_remote_command(host,
+							runtime_options.remote_user,
+							command.data,
+							config_file_options.ssh_options,
+							&remote_command_str);
 
-		initUXSQLExpBuffer(&command_output);
+		log_verbose(LOG_DEBUG, "build_cluster_matrix(): queueing:\n  %s", remote_command_str.data);
 
-		(void) remote_command(host,
-							  runtime_options.remote_user,
-							  command.data,
-							  config_file_options.ssh_options,
-							  &command_output);
-
-		p = command_output.data;
+		tasks[task_count].node_id = connection_node_id;
+		tasks[task_count].command = remote_command_str.data;
+		task_count++;
 
 		termUXSQLExpBuffer(&command);
+		free_conninfo_params(&remote_conninfo);
+	}
 
+	/*
+	 * Execute the queued commands concurrently, so the overall runtime is
+	 * bounded by the slowest node rather than the sum of all nodes.
+	 */
+	if (task_count > 0)
+	{
+		log_verbose(LOG_INFO, _("querying %i node(s) via SSH (maximum %i concurrently)"),
+					task_count, config_file_options.cluster_probe_parallel);
+
+		(void) run_parallel_commands(tasks,
+									 task_count,
+									 config_file_options.cluster_probe_parallel,
+									 config_file_options.cluster_probe_timeout,
+									 0);
+	}
+
+	for (i = 0; i < task_count; i++)
+	{
+		int			connection_node_id = tasks[i].node_id;
+		char	   *p = tasks[i].output.data;
+		int			x,
+					y;
+
+		if (tasks[i].status == PCMD_TIMED_OUT)
+		{
+			item_list_append_format(warnings,
+									"node %i did not respond within %i seconds",
+									connection_node_id,
+									config_file_options.cluster_probe_timeout);
+			*error_code = ERR_BAD_SSH;
+		}
 		/* no output returned - probably SSH error */
-		if (p[0] == '\0' || p[0] == '\n')
+		else if (p[0] == '\0' || p[0] == '\n')
 		{
 			item_list_append_format(warnings,
 									"node %i inaccessible via SSH",
@@ -1154,8 +1218,7 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 			{
 				if (sscanf(p, "%d,%d", &x, &y) != 2)
 				{
-					matrix_set_node_status(matrix_rec_list,
-										   nodes.node_count,
+					matrix_set_node_status(matrix,
 										   connection_node_id,
 										   x,
 										   -2);
@@ -1167,8 +1230,7 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 				}
 				else
 				{
-					matrix_set_node_status(matrix_rec_list,
-										   nodes.node_count,
+					matrix_set_node_status(matrix,
 										   connection_node_id,
 										   x,
 										   (y == -1) ? -1 : 0);
@@ -1181,12 +1243,11 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 			}
 		}
 
-		termUXSQLExpBuffer(&command_output);
-		UXSQLfinish(node_conn);
-		free_conninfo_params(&remote_conninfo);
+		pfree(tasks[i].command);
 	}
 
-	*matrix_rec_dest = matrix_rec_list;
+	clear_parallel_commands(tasks, task_count);
+	pfree(tasks);
 
 	node_count = nodes.node_count;
 	clear_node_info_list(&nodes);
@@ -1196,16 +1257,16 @@ build_cluster_matrix(t_node_matrix_rec ***matrix_rec_dest, ItemList *warnings, i
 
 
 static int
-build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, int *error_code)
+build_cluster_crosscheck(t_node_status_matrix *cube, ItemList *warnings, int *error_code)
 {
 	UXconn	   *conn = NULL;
-	int			h,
-				i,
+	int			i,
 				j;
 	NodeInfoList nodes = T_NODE_INFO_LIST_INITIALIZER;
 	NodeInfoListCell *cell = NULL;
 
-	t_node_status_cube **cube;
+	t_parallel_command *tasks = NULL;
+	int			task_count = 0;
 
 	int			node_count = 0;
 
@@ -1234,70 +1295,22 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 	}
 
 	/*
-	 * Allocate an empty cube matrix structure
+	 * Initialise an empty status cube
 	 *
 	 * -2 == NULL -1 == Error 0 == OK
 	 */
-
-	cube = (t_node_status_cube **) ux_malloc(sizeof(t_node_status_cube *) * nodes.node_count);
-
-	h = 0;
-
-	for (cell = nodes.head; cell; cell = cell->next)
-	{
-		NodeInfoListCell *cell_i = NULL;
-
-		cube[h] = (t_node_status_cube *) ux_malloc(sizeof(t_node_status_cube));
-		cube[h]->node_id = cell->node_info->node_id;
-		strncpy(cube[h]->node_name, cell->node_info->node_name, sizeof(cube[h]->node_name));
-
-		cube[h]->matrix_list_rec = (t_node_matrix_rec **) ux_malloc(sizeof(t_node_matrix_rec) * nodes.node_count);
-
-		i = 0;
-		for (cell_i = nodes.head; cell_i; cell_i = cell_i->next)
-		{
-			NodeInfoListCell *cell_j;
-
-			cube[h]->matrix_list_rec[i] = (t_node_matrix_rec *) ux_malloc0(sizeof(t_node_matrix_rec));
-			cube[h]->matrix_list_rec[i]->node_id = cell_i->node_info->node_id;
-
-			/* we don't need the name here */
-			cube[h]->matrix_list_rec[i]->node_name[0] = '\0';
-
-			cube[h]->matrix_list_rec[i]->node_status_list = (t_node_status_rec **) ux_malloc0(sizeof(t_node_status_rec *) * nodes.node_count);
-
-			j = 0;
-
-			for (cell_j = nodes.head; cell_j; cell_j = cell_j->next)
-			{
-				cube[h]->matrix_list_rec[i]->node_status_list[j] = (t_node_status_rec *) ux_malloc0(sizeof(t_node_status_rec));
-				cube[h]->matrix_list_rec[i]->node_status_list[j]->node_id = cell_j->node_info->node_id;
-				cube[h]->matrix_list_rec[i]->node_status_list[j]->node_status = -2; /* default unknown */
-
-				j++;
-			}
-
-			i++;
-		}
-
-		h++;
-	}
-
+	init_node_status_matrix(cube, &nodes, 3);
 
 	/*
-	 * Build the connection cube
+	 * Build the connection cube; first queue up a `repmgr cluster matrix`
+	 * command for each node, then execute them concurrently.
 	 */
-	i = 0;
+	tasks = (t_parallel_command *) ux_malloc0(sizeof(t_parallel_command) * nodes.node_count);
 
 	for (cell = nodes.head; cell; cell = cell->next)
 	{
-		int			remote_node_id = UNKNOWN_NODE_ID;
 		UXSQLExpBufferData command;
-		UXSQLExpBufferData command_output;
-
-		char	   *p = NULL;
-
-		remote_node_id = cell->node_info->node_id;
+		UXSQLExpBufferData task_command;
 
 		initUXSQLExpBuffer(&command);
 
@@ -1317,12 +1330,11 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 								 " -L NOTICE");
 		}
 
-		initUXSQLExpBuffer(&command_output);
+		initUXSQLExpBuffer(&task_command);
 
-		if (cube[i]->node_id == config_file_options.node_id)
+		if (cell->node_info->node_id == config_file_options.node_id)
 		{
-			(void) local_command_simple(command.data,
-										&command_output);
+			appendUXSQLExpBufferStr(&task_command, command.data);
 		}
 		else
 		{
@@ -1344,13 +1356,11 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 
 			host = param_get(&remote_conninfo, "host");
 
-			log_verbose(LOG_DEBUG, "build_cluster_crosscheck(): executing\n  %s", quoted_command.data);
-
-			(void) remote_command(host,
-								  runtime_options.remote_user,
-								  quoted_command.data,
-								  config_file_options.ssh_options,
-								  &command_output);
+			make_remote_command(host,
+								runtime_options.remote_user,
+								quoted_command.data,
+								config_file_options.ssh_options,
+								&task_command);
 
 			free_conninfo_params(&remote_conninfo);
 			termUXSQLExpBuffer(&quoted_command);
@@ -1358,14 +1368,44 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 
 		termUXSQLExpBuffer(&command);
 
-		p = command_output.data;
+		log_verbose(LOG_DEBUG, "build_cluster_crosscheck(): queueing\n  %s", task_command.data);
+
+		tasks[task_count].node_id = cell->node_info->node_id;
+		tasks[task_count].command = task_command.data;
+		task_count++;
+	}
+
+	log_verbose(LOG_INFO, _("querying %i node(s) (maximum %i concurrently)"),
+				task_count, config_file_options.cluster_probe_parallel);
+
+	(void) run_parallel_commands(tasks,
+								 task_count,
+								 config_file_options.cluster_probe_parallel,
+								 config_file_options.cluster_probe_timeout,
+								 0);
+
+	for (i = 0; i < task_count; i++)
+	{
+		int			remote_node_id = tasks[i].node_id;
+		char	   *p = tasks[i].output.data;
+
+		pfree(tasks[i].command);
+
+		if (tasks[i].status == PCMD_TIMED_OUT)
+		{
+			item_list_append_format(warnings,
+									"node %i did not respond within %i seconds",
+									remote_node_id,
+									config_file_options.cluster_probe_timeout);
+			*error_code = ERR_BAD_SSH;
+			continue;
+		}
 
 		if (p[0] == '\0' || p[0] == '\n')
 		{
 			item_list_append_format(warnings,
 									"node %i inaccessible via SSH",
 									remote_node_id);
-			termUXSQLExpBuffer(&command_output);
 			*error_code = ERR_BAD_SSH;
 			continue;
 		}
@@ -1379,7 +1419,6 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 			if (sscanf(p, "%d,%d,%d", &matrix_rec_node_id, &node_status_node_id, &node_status) != 3)
 			{
 				cube_set_node_status(cube,
-									 nodes.node_count,
 									 remote_node_id,
 									 matrix_rec_node_id,
 									 node_status_node_id,
@@ -1389,7 +1428,6 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 			else
 			{
 				cube_set_node_status(cube,
-									 nodes.node_count,
 									 remote_node_id,
 									 matrix_rec_node_id,
 									 node_status_node_id,
@@ -1401,12 +1439,10 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 			if (*p == '\n')
 				p++;
 		}
-		termUXSQLExpBuffer(&command_output);
-
-		i++;
 	}
 
-	*dest_cube = cube;
+	clear_parallel_commands(tasks, task_count);
+	pfree(tasks);
 
 	node_count = nodes.node_count;
 
@@ -1417,34 +1453,16 @@ build_cluster_crosscheck(t_node_status_cube ***dest_cube, ItemList *warnings, in
 
 
 static void
-cube_set_node_status(t_node_status_cube **cube, int n, int execute_node_id, int matrix_node_id, int connection_node_id, int connection_status)
+cube_set_node_status(t_node_status_matrix *cube, int execute_node_id, int matrix_node_id, int connection_node_id, int connection_status)
 {
-	int			h,
-				i,
-				j;
+	int			h = node_status_matrix_index(cube, execute_node_id);
+	int			i = node_status_matrix_index(cube, matrix_node_id);
+	int			j = node_status_matrix_index(cube, connection_node_id);
 
+	if (h == -1 || i == -1 || j == -1)
+		return;
 
-	for (h = 0; h < n; h++)
-	{
-		if (cube[h]->node_id == execute_node_id)
-		{
-			for (i = 0; i < n; i++)
-			{
-				if (cube[h]->matrix_list_rec[i]->node_id == matrix_node_id)
-				{
-					for (j = 0; j < n; j++)
-					{
-						if (cube[h]->matrix_list_rec[i]->node_status_list[j]->node_id == connection_node_id)
-						{
-							cube[h]->matrix_list_rec[i]->node_status_list[j]->node_status = connection_status;
-							break;
-						}
-					}
-					break;
-				}
-			}
-		}
-	}
+	cube_node_status(cube, h, i, j) = connection_status;
 }
 
 
@@ -1454,6 +1472,8 @@ do_cluster_cleanup(void)
 	UXconn	   *conn = NULL;
 	UXconn	   *primary_conn = NULL;
 	int			entries_to_delete = 0;
+	bool		partitioned = false;
+	int			partitions_dropped = 0;
 	UXSQLExpBufferData event_details;
 
 	conn = establish_db_connection(config_file_options.conninfo, true);
@@ -1466,6 +1486,77 @@ do_cluster_cleanup(void)
 
 	log_debug(_("number of days of monitoring history to retain: %i"), runtime_options.keep_history);
 
+	/*
+	 * Remove expired event records first, as they're independent of the
+	 * monitoring history; failure to do so isn't fatal.
+	 */
+	if (config_file_options.event_retention_days > 0)
+	{
+		int			events_deleted = delete_expired_event_records(primary_conn,
+																  config_file_options.event_retention_days,
+																  runtime_options.node_id);
+
+		if (events_deleted < 0)
+		{
+			log_warning(_("unable to delete expired event records"));
+			log_detail("%s", UXSQLerrorMessage(primary_conn));
+		}
+		else
+		{
+			log_info(_("%i event record(s) older than %i day(s) deleted (\"event_retention_days\")"),
+					 events_deleted, config_file_options.event_retention_days);
+		}
+	}
+
+	initUXSQLExpBuffer(&event_details);
+
+	/*
+	 * If "repmgr.monitoring_history" is partitioned, expired records can be
+	 * removed by dropping entire partitions; this isn't possible when
+	 * cleaning up records for an individual node.
+	 */
+	if (runtime_options.keep_history > 0 && runtime_options.node_id == UNKNOWN_NODE_ID)
+		partitioned = is_monitoring_history_partitioned(primary_conn);
+
+	if (partitioned == true)
+	{
+		int			partitions_created = create_monitoring_history_partitions(primary_conn,
+																			  MONITORING_HISTORY_PARTITIONS_AHEAD);
+
+		/* not fatal, records will be written to the default partition */
+		if (partitions_created < 0)
+		{
+			log_warning(_("unable to create monitoring history partitions"));
+		}
+		else
+		{
+			log_verbose(LOG_INFO, _("%i monitoring history partition(s) created"), partitions_created);
+		}
+
+		partitions_dropped = drop_monitoring_history_partitions(primary_conn, runtime_options.keep_history);
+
+		if (partitions_dropped < 0)
+		{
+			appendUXSQLExpBufferStr(&event_details,
+							  _("unable to drop monitoring history partitions"));
+
+			log_error("%s", event_details.data);
+			log_detail("%s", UXSQLerrorMessage(primary_conn));
+
+			create_event_notification(primary_conn,
+									  &config_file_options,
+									  config_file_options.node_id,
+									  "cluster_cleanup",
+									  false,
+									  event_details.data);
+
+			UXSQLfinish(primary_conn);
+			exit(ERR_DB_QUERY);
+		}
+
+		log_info(_("%i expired monitoring history partition(s) dropped"), partitions_dropped);
+	}
+
 	entries_to_delete = get_number_of_monitoring_records_to_delete(primary_conn,
 																   runtime_options.keep_history,
 																   runtime_options.node_id);
@@ -1476,9 +1567,10 @@ do_cluster_cleanup(void)
 		UXSQLfinish(primary_conn);
 		exit(ERR_DB_QUERY);
 	}
-	else if (entries_to_delete == 0)
+	else if (entries_to_delete == 0 && partitions_dropped == 0)
 	{
 		log_info(_("no monitoring records to delete"));
+		termUXSQLExpBuffer(&event_details);
 		UXSQLfinish(primary_conn);
 		return;
 	}
@@ -1486,36 +1578,44 @@ do_cluster_cleanup(void)
 	log_debug("at least %i monitoring records for deletion",
 			  entries_to_delete);
 
-	initUXSQLExpBuffer(&event_details);
-
-	if (delete_monitoring_records(primary_conn, runtime_options.keep_history, runtime_options.node_id) == false)
+	if (entries_to_delete > 0)
 	{
-		appendUXSQLExpBufferStr(&event_details,
-						  _("unable to delete monitoring records"));
+		if (delete_monitoring_records(primary_conn, runtime_options.keep_history, runtime_options.node_id) == false)
+		{
+			appendUXSQLExpBufferStr(&event_details,
+							  _("unable to delete monitoring records"));
 
-		log_error("%s", event_details.data);
-		log_detail("%s", UXSQLerrorMessage(primary_conn));
+			log_error("%s", event_details.data);
+			log_detail("%s", UXSQLerrorMessage(primary_conn));
 
-		create_event_notification(primary_conn,
-								  &config_file_options,
-								  config_file_options.node_id,
-								  "cluster_cleanup",
-								  false,
-								  event_details.data);
+			create_event_notification(primary_conn,
+									  &config_file_options,
+									  config_file_options.node_id,
+									  "cluster_cleanup",
+									  false,
+									  event_details.data);
 
-		UXSQLfinish(primary_conn);
-		exit(ERR_DB_QUERY);
-	}
+			UXSQLfinish(primary_conn);
+			exit(ERR_DB_QUERY);
+		}
 
-	if (vacuum_table(primary_conn, "repmgr.monitoring_history") == false)
-	{
-		/* annoying if this fails, but not fatal */
-		log_warning(_("unable to vacuum table \"repmgr.monitoring_history\""));
-		log_detail("%s", UXSQLerrorMessage(primary_conn));
-	}
-	else
-	{
-		log_info(_("vacuum of table \"repmgr.monitoring_history\" completed"));
+		/*
+		 * Vacuuming a partitioned table would process every partition; leave
+		 * the partitions which had rows deleted to autovacuum.
+		 */
+		if (partitioned == false)
+		{
+			if (vacuum_table(primary_conn, "repmgr.monitoring_history") == false)
+			{
+				/* annoying if this fails, but not fatal */
+				log_warning(_("unable to vacuum table \"repmgr.monitoring_history\""));
+				log_detail("%s", UXSQLerrorMessage(primary_conn));
+			}
+			else
+			{
+				log_info(_("vacuum of table \"repmgr.monitoring_history\" completed"));
+			}
+		}
 	}
 
 	if (runtime_options.keep_history == 0)
@@ -1604,6 +1704,9 @@ do_cluster_help(void)
 	puts("");
 	printf(_("    --limit                   maximum number of events to display (default: %i)\n"), CLUSTER_EVENT_LIMIT);
 	printf(_("    --all                     display all events (overrides --limit)\n"));
+	printf(_("    --after=BOUNDARY          display events after this point, oldest first\n"));
+	printf(_("    --before=BOUNDARY         display events before this point\n"));
+	printf(_("                              (BOUNDARY is TIMESTAMP[,NODE_ID,EVENT])\n"));
 	printf(_("    --event                   filter specific event\n"));
 	printf(_("    --node-id                 restrict entries to node with this ID\n"));
 	printf(_("    --node-name               restrict entries to node with this name\n"));
@@ -1613,7 +1716,8 @@ do_cluster_help(void)
 
 	printf(_("CLUSTER CLEANUP\n"));
 	puts("");
-	printf(_("  \"cluster cleanup\" purges records from the \"repmgr.monitoring_history\" table.\n"));
+	printf(_("  \"cluster cleanup\" purges records from the \"repmgr.monitoring_history\" table, and event\n"));
+	printf(_("  records older than \"event_retention_days\" from the \"repmgr.events\" table.\n"));
 	puts("");
 	printf(_("    -k, --keep-history=VALUE  retain indicated number of days of history (default: 0)\n"));
 	puts("");
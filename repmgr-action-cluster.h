@@ -22,25 +22,49 @@
 
 
 
+/*
+ * Node connection status matrix (as built by "cluster matrix") or cube
+ * (as built by "cluster crosscheck"), stored in a single allocation.
+ *
+ * "node_status" holds node_count^dimensions entries in row-major order:
+ * matrix entry (i, j) is the status of the connection from the node at
+ * index i to the node at index j; cube entry (h, i, j) is matrix entry
+ * (i, j) as reported by the node at index h.
+ *
+ * Status values: -2 == unknown, -1 == error, 0 == OK
+ */
 typedef struct
 {
 	int			node_id;
-	int			node_status;
-} t_node_status_rec;
+	int			node_ix;
+} t_node_id_index;
 
 typedef struct
 {
-	int			node_id;
-	char		node_name[NAMEDATALEN];
-	t_node_status_rec **node_status_list;
-} t_node_matrix_rec;
+	int			node_count;
+	int			dimensions;
+	int		   *node_status;
+	int		   *node_ids;
+	/* node IDs sorted for lookup with bsearch() */
+	t_node_id_index *id_index;
+	char	   *node_names;
+} t_node_status_matrix;
 
-typedef struct
-{
-	int			node_id;
-	char		node_name[NAMEDATALEN];
-	t_node_matrix_rec **matrix_list_rec;
-} t_node_status_cube;
+#define T_NODE_STATUS_MATRIX_INITIALIZER { \
+	0, \
+	0, \
+	NULL, \
+	NULL, \
+	NULL, \
+	NULL \
+}
+
+#define matrix_node_status(m, i, j) \
+	((m)->node_status[(size_t) (i) * (m)->node_count + (j)])
+#define cube_node_status(c, h, i, j) \
+	((c)->node_status[((size_t) (h) * (c)->node_count + (i)) * (c)->node_count + (j)])
+#define matrix_node_id(m, i) ((m)->node_ids[(i)])
+#define matrix_node_name(m, i) (&(m)->node_names[(size_t) (i) * NAMEDATALEN])
 
 
 
@@ -33,6 +33,9 @@
 #include "repmgr-action-node.h"
 #include "repmgr-action-standby.h"
 
+/* maximum interval between checks with "node status --wait-shutdown" */
+#define WAIT_SHUTDOWN_CHECK_INTERVAL_MS 100
+
 static bool copy_file(const char *src_file, const char *dest_file);
 static void format_archive_dir(UXSQLExpBufferData *archive_dir);
 static t_server_action parse_server_action(const char *action);
@@ -42,10 +45,12 @@ static void exit_optformat_error(const char *error, int errcode);
 
 static void _do_node_service_list_actions(t_server_action action);
 static void _do_node_status_is_shutdown_cleanly(void);
+static NodeStatus _get_node_shutdown_status(XLogRecPtr *checkPoint);
 static void _do_node_archive_config(void);
 static void _do_node_restore_config(void);
 
-static void do_node_check_replication_connection(void);
+static void do_node_check_replication_connection(UXconn *conn);
+static void do_node_check_batch(UXconn *conn, t_node_info *node_info);
 static CheckStatus do_node_check_archive_ready(UXconn *conn, OutputMode mode, CheckStatusList *list_output);
 static CheckStatus do_node_check_downstream(UXconn *conn, OutputMode mode, t_node_info *node_info, CheckStatusList *list_output);
 static CheckStatus do_node_check_upstream(UXconn *conn, OutputMode mode, t_node_info *node_info, CheckStatusList *list_output);
@@ -613,17 +618,20 @@ do_node_status(void)
  *
  * --status=(RUNNING|SHUTDOWN|UNCLEAN_SHUTDOWN|UNKNOWN)
  * --last-checkpoint=...
+ *
+ * With --wait-shutdown=N, rather than reporting the current state
+ * immediately, wait up to N seconds for the node to finish shutting down,
+ * so the caller need not repeatedly open a new ssh session to poll it.
+ * The control file is watched for changes, and the state re-checked at
+ * WAIT_SHUTDOWN_CHECK_INTERVAL_MS intervals to catch the postmaster
+ * exiting after it has written the shutdown checkpoint.
  */
 
 static void
 _do_node_status_is_shutdown_cleanly(void)
 {
-	UXPing		ping_status;
 	UXSQLExpBufferData output;
-
-	DBState		db_state;
 	XLogRecPtr	checkPoint = InvalidXLogRecPtr;
-
 	NodeStatus	node_status = NODE_STATUS_UNKNOWN;
 
 	initUXSQLExpBuffer(&output);
@@ -640,6 +648,65 @@ _do_node_status_is_shutdown_cleanly(void)
 		return;
 	}
 
+	node_status = _get_node_shutdown_status(&checkPoint);
+
+	if (runtime_options.wait_shutdown > 0)
+	{
+		time_t		wait_end = time(NULL) + runtime_options.wait_shutdown;
+
+		while (time(NULL) < wait_end)
+		{
+			if (node_status == NODE_STATUS_DOWN)
+				break;
+
+			/*
+			 * The state may briefly appear unclean while the postmaster is
+			 * still running but no longer responding; only report it once
+			 * the postmaster has gone.
+			 */
+			if (node_status == NODE_STATUS_UNCLEAN_SHUTDOWN &&
+				is_ux_running(config_file_options.data_directory) == UX_DIR_NOT_RUNNING)
+				break;
+
+			(void) wait_for_controlfile_change(config_file_options.data_directory,
+											   WAIT_SHUTDOWN_CHECK_INTERVAL_MS);
+
+			node_status = _get_node_shutdown_status(&checkPoint);
+		}
+	}
+
+	appendUXSQLExpBuffer(&output,
+					  "%s", print_node_status(node_status));
+
+	if (node_status == NODE_STATUS_DOWN)
+	{
+		appendUXSQLExpBuffer(&output,
+						  " --last-checkpoint-lsn=%X/%X",
+						  format_lsn(checkPoint));
+	}
+
+	printf("%s\n", output.data);
+	termUXSQLExpBuffer(&output);
+	return;
+}
+
+
+/*
+ * Determine the node's running state from its response to a ping and the
+ * contents of ux_control; if it's cleanly shut down, "checkPoint" is set
+ * to the location of the shutdown checkpoint.
+ */
+static NodeStatus
+_get_node_shutdown_status(XLogRecPtr *checkPoint)
+{
+	UXPing		ping_status;
+	const ControlFileInfo *control_file_info = NULL;
+	DBState		db_state;
+
+	NodeStatus	node_status = NODE_STATUS_UNKNOWN;
+
+	*checkPoint = InvalidXLogRecPtr;
+
 	ping_status = UXSQLping(config_file_options.conninfo);
 
 	switch (ping_status)
@@ -656,17 +723,20 @@ _do_node_status_is_shutdown_cleanly(void)
 			break;
 	}
 
-	/* check what ux_control says */
-	if (get_db_state(config_file_options.data_directory, &db_state) == false)
+	/* check what ux_control says; read it once for all the fields we need */
+	control_file_info = get_controlfile_snapshot(config_file_options.data_directory);
+
+	if (control_file_info->control_file_processed == false)
 	{
 		/*
 		 * Unable to retrieve the database state from ux_control
 		 */
-		node_status = NODE_STATUS_UNKNOWN;
 		log_verbose(LOG_DEBUG, "unable to determine db state");
-		goto return_state;
+		return NODE_STATUS_UNKNOWN;
 	}
 
+	db_state = control_file_info->state;
+
 	log_verbose(LOG_DEBUG, "db state now: %s", describe_db_state(db_state));
 
 	if (db_state != DB_SHUTDOWNED && db_state != DB_SHUTDOWNED_IN_RECOVERY)
@@ -682,9 +752,9 @@ _do_node_status_is_shutdown_cleanly(void)
 		}
 	}
 
-	checkPoint = get_latest_checkpoint_location(config_file_options.data_directory);
+	*checkPoint = control_file_info->checkPoint;
 
-	if (checkPoint == InvalidXLogRecPtr)
+	if (*checkPoint == InvalidXLogRecPtr)
 	{
 		/* unable to read ux_control, don't know what's happening */
 		node_status = NODE_STATUS_UNKNOWN;
@@ -699,25 +769,10 @@ _do_node_status_is_shutdown_cleanly(void)
 		node_status = NODE_STATUS_DOWN;
 	}
 
-
-return_state:
-
 	log_verbose(LOG_DEBUG, "node status determined as: %s",
 				print_node_status(node_status));
 
-	appendUXSQLExpBuffer(&output,
-					  "%s", print_node_status(node_status));
-
-	if (node_status == NODE_STATUS_DOWN)
-	{
-		appendUXSQLExpBuffer(&output,
-						  " --last-checkpoint-lsn=%X/%X",
-						  format_lsn(checkPoint));
-	}
-
-	printf("%s\n", output.data);
-	termUXSQLExpBuffer(&output);
-	return;
+	return node_status;
 }
 
 static void
@@ -769,7 +824,7 @@ do_node_check(void)
 	/* for use by "standby switchover" */
 	if (runtime_options.replication_connection == true)
 	{
-		do_node_check_replication_connection();
+		do_node_check_replication_connection(NULL);
 		exit(SUCCESS);
 	}
 
@@ -868,6 +923,14 @@ do_node_check(void)
 	/* add replication statistics to node record */
 	get_node_replication_stats(conn, &node_info);
 
+	/* for use by "standby switchover": several checks in one invocation */
+	if (runtime_options.batch_checks[0] != '\0')
+	{
+		do_node_check_batch(conn, &node_info);
+		UXSQLfinish(conn);
+		exit(SUCCESS);
+	}
+
 	/*
 	 * handle specific checks ======================
 	 */
@@ -1071,10 +1134,14 @@ do_node_check(void)
 }
 
 
+/*
+ * If "conn" is provided, the remote node record is retrieved via that
+ * connection (used by --batch); otherwise a local connection is opened.
+ */
 static void
-do_node_check_replication_connection(void)
+do_node_check_replication_connection(UXconn *conn)
 {
-	UXconn *local_conn = NULL;
+	UXconn *local_conn = conn;
 	UXconn *repl_conn = NULL;
 	t_node_info node_record = T_NODE_INFO_INITIALIZER;
 	RecordStatus record_status = RECORD_NOT_FOUND;
@@ -1094,18 +1161,23 @@ do_node_check_replication_connection(void)
 	}
 
 	/* retrieve remote node record from local database */
-	local_conn = establish_db_connection(config_file_options.conninfo, false);
+	if (local_conn == NULL)
+		local_conn = establish_db_connection(config_file_options.conninfo, false);
 
 	if (UXSQLstatus(local_conn) != CONNECTION_OK)
 	{
 		appendUXSQLExpBufferStr(&output, "CONNECTION_ERROR");
 		printf("%s\n", output.data);
 		termUXSQLExpBuffer(&output);
+		if (conn == NULL)
+			UXSQLfinish(local_conn);
 		return;
 	}
 
 	record_status = get_node_record(local_conn, runtime_options.remote_node_id, &node_record);
-	UXSQLfinish(local_conn);
+
+	if (conn == NULL)
+		UXSQLfinish(local_conn);
 
 	if (record_status != RECORD_FOUND)
 	{
@@ -1139,6 +1211,67 @@ do_node_check_replication_connection(void)
 
 
 
+/*
+ * Execute a comma-separated list of checks in a single invocation, emitting
+ * each check's --optformat output on its own line, preceded by a line
+ * "--batch-check=<name>" so the caller can separate the output of each
+ * check. Used by "standby switchover" to avoid a separate SSH round trip per
+ * pre-flight check.
+ *
+ * Unknown check names are reported with a warning and otherwise ignored, so
+ * the caller can fall back to executing them individually.
+ */
+static void
+do_node_check_batch(UXconn *conn, t_node_info *node_info)
+{
+	char		checks[MAXLEN] = "";
+	char	   *check_name = NULL;
+	char	   *saveptr = NULL;
+
+	if (runtime_options.output_mode != OM_OPTFORMAT)
+	{
+		log_error(_("--batch option can only be used with --optformat"));
+		UXSQLfinish(conn);
+		exit(ERR_BAD_CONFIG);
+	}
+
+	strncpy(checks, runtime_options.batch_checks, MAXLEN - 1);
+
+	for (check_name = strtok_r(checks, ",", &saveptr);
+		 check_name != NULL;
+		 check_name = strtok_r(NULL, ",", &saveptr))
+	{
+		check_name = trim(check_name);
+
+		if (check_name[0] == '\0')
+			continue;
+
+		if (strcmp(check_name, "archive-ready") != 0 &&
+			strcmp(check_name, "data-directory-config") != 0 &&
+			strcmp(check_name, "replication-config-owner") != 0 &&
+			strcmp(check_name, "repmgrd") != 0 &&
+			strcmp(check_name, "replication-connection") != 0)
+		{
+			log_warning(_("unknown check \"%s\" in --batch list"), check_name);
+			continue;
+		}
+
+		printf("%s%s\n", NODE_CHECK_BATCH_TAG, check_name);
+
+		if (strcmp(check_name, "archive-ready") == 0)
+			(void) do_node_check_archive_ready(conn, OM_OPTFORMAT, NULL);
+		else if (strcmp(check_name, "data-directory-config") == 0)
+			(void) do_node_check_data_directory(conn, OM_OPTFORMAT, node_info, NULL);
+		else if (strcmp(check_name, "replication-config-owner") == 0)
+			(void) do_node_check_replication_config_owner(conn, OM_OPTFORMAT, node_info, NULL);
+		else if (strcmp(check_name, "repmgrd") == 0)
+			(void) do_node_check_repmgrd(conn, OM_OPTFORMAT, node_info, NULL);
+		else if (strcmp(check_name, "replication-connection") == 0)
+			do_node_check_replication_connection(conn);
+	}
+}
+
+
 static CheckStatus
 do_node_check_archive_ready(UXconn *conn, OutputMode mode, CheckStatusList *list_output)
 {
@@ -2748,8 +2881,9 @@ do_node_rejoin(void)
 	 */
 	{
 		bool can_rejoin;
-		TimeLineID tli = get_min_recovery_end_timeline(config_file_options.data_directory);
-		XLogRecPtr min_recovery_location = get_min_recovery_location(config_file_options.data_directory);
+		const ControlFileInfo *control_file_info = get_controlfile_snapshot(config_file_options.data_directory);
+		TimeLineID tli = control_file_info->minRecoveryPointTLI;
+		XLogRecPtr min_recovery_location = control_file_info->minRecoveryPoint;
 
 		/*
 		 * It's possible this was a former primary, so the minRecoveryPoint*
@@ -2757,9 +2891,9 @@ do_node_rejoin(void)
 		 */
 
 		if (min_recovery_location == InvalidXLogRecPtr)
-			min_recovery_location = get_latest_checkpoint_location(config_file_options.data_directory);
+			min_recovery_location = control_file_info->checkPoint;
 		if (tli == 0)
-			tli = get_timeline(config_file_options.data_directory);
+			tli = control_file_info->timeline;
 
 		can_rejoin = check_node_can_attach(tli,
 										   min_recovery_location,
@@ -3872,6 +4006,7 @@ do_node_help(void)
 	printf(_("    --missing-slots           check for missing replication slots\n"));
 	printf(_("    --repmgrd                 check if repmgrd is running\n"));
 	printf(_("    --data-directory-config   check repmgr's data directory configuration\n"));
+	printf(_("    --batch=LIST              execute a comma-separated list of checks (--optformat only)\n"));
 
 	puts("");
 
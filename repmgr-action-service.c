@@ -171,12 +171,16 @@ do_service_status(void)
 		}
 		else
 		{
+			t_repmgrd_state repmgrd_state = T_REPMGRD_STATE_INITIALIZER;
+
 			cell->node_info->node_status = NODE_STATUS_UP;
 			cell->node_info->recovery_type = get_recovery_type(cell->node_info->conn);
 
-			repmgrd_info[i]->pid = repmgrd_get_pid(cell->node_info->conn);
+			(void) get_repmgrd_state(cell->node_info->conn, cell->node_info->type, &repmgrd_state);
+
+			repmgrd_info[i]->pid = repmgrd_state.pid;
 
-			repmgrd_info[i]->running = repmgrd_is_running(cell->node_info->conn);
+			repmgrd_info[i]->running = repmgrd_state.running;
 
 			if (repmgrd_info[i]->running == true)
 			{
@@ -196,7 +200,7 @@ do_service_status(void)
 				maxlen_snprintf(repmgrd_info[i]->pid_text, "%i", repmgrd_info[i]->pid);
 			}
 
-			repmgrd_info[i]->paused = repmgrd_is_paused(cell->node_info->conn);
+			repmgrd_info[i]->paused = repmgrd_state.paused;
 
 			repmgrd_info[i]->recovery_type = get_recovery_type(cell->node_info->conn);
 
@@ -212,7 +216,7 @@ do_service_status(void)
 				}
 			}
 
-			repmgrd_info[i]->upstream_last_seen = get_upstream_last_seen(cell->node_info->conn, cell->node_info->type);
+			repmgrd_info[i]->upstream_last_seen = repmgrd_state.upstream_last_seen;
 			if (repmgrd_info[i]->upstream_last_seen < 0)
 			{
 				maxlen_snprintf(repmgrd_info[i]->upstream_last_seen_text, "%s", _("n/a"));
@@ -234,7 +238,7 @@ do_service_status(void)
 		initUXSQLExpBuffer(&upstream);
 
 		(void)format_node_status(cell->node_info, &node_status, &upstream, &warnings);
-		snprintf(repmgrd_info[i]->ux_running_text, sizeof(cell->node_info->details),
+		snprintf(repmgrd_info[i]->ux_running_text, sizeof(repmgrd_info[i]->ux_running_text),
 				 "%s", node_status.data);
 
 		snprintf(cell->node_info->upstream_node_name, sizeof(cell->node_info->upstream_node_name),
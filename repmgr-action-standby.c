@@ -20,6 +20,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <dirent.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -32,6 +33,7 @@
 #include "repmgr-client-global.h"
 #include "repmgr-action-standby.h"
 #include "uxbackupapi.h"
+#include "filecopy.h"
 
 typedef struct TablespaceDataListCell
 {
@@ -57,9 +59,30 @@ typedef struct
 	int			unreachable_sibling_node_count;
 	int			min_required_wal_senders;
 	int			min_required_free_slots;
+	/* populated by sibling_nodes_follow() */
+	int			followed_sibling_node_count;
+	int			failed_follow_sibling_node_count;
+	int			timed_out_follow_sibling_node_count;
 } SiblingNodeStats;
 
+/* rsync block size used by "standby clone --incremental"; matches the UXsinoDB page size */
+#define INCREMENTAL_CLONE_BLOCK_SIZE 8192
+
+/* seconds to wait for a "standby clone --multi-source" donor to replay past the backup start */
+#define MULTI_SOURCE_CATCHUP_TIMEOUT 60
+
+/* a standby from which "standby clone --multi-source" copies relation files */
+typedef struct
+{
+	UXconn	   *conn;
+	char		node_name[NAMEDATALEN];
+	t_copy_source source;
+} t_clone_donor;
+
 #define T_SIBLING_NODES_STATS_INITIALIZER { \
+	0, \
+	0, \
+	0, \
 	0, \
 	0, \
 	0, \
@@ -114,7 +137,19 @@ static void check_recovery_type(UXconn *conn);
 
 static void initialise_direct_clone(t_node_info *local_node_record, t_node_info *upstream_node_record);
 static int	run_basebackup(t_node_info *node_record);
+static void move_replication_slot_to_upstream(t_node_info *node_record);
+static void check_incremental_clone(void);
+static int	run_incremental_clone(t_node_info *node_record);
+static bool clear_directory_contents(const char *path);
+static bool write_backup_label_files(UXSQLExpBufferData *label_file, UXSQLExpBufferData *tablespace_map);
+static int	run_multi_source_clone(t_node_info *node_record);
+static int	get_clone_donors(uint64 primary_system_identifier, t_clone_donor **donors);
+static bool wait_for_clone_donor_replay(UXconn *conn, const char *node_name, XLogRecPtr backup_start_lsn);
+static bool copy_relation_files(t_clone_donor *donors, int donor_count, const char *source_host,
+								const char *source_path, const char *local_path, const char *subdirs,
+								const char *rsync_flags);
 static int	run_file_backup(t_node_info *node_record);
+static void copy_barman_files(const char *file_list, const char *remote_path, const char *local_path);
 static int	run_ux_backupapi(t_node_info *node_record);
 
 static void copy_configuration_files(bool delete_after_copy);
@@ -142,6 +177,9 @@ static CheckStatus parse_node_check_archiver(const char *node_check_output, int
 static ConnectionStatus parse_remote_node_replication_connection(const char *node_check_output);
 static bool parse_data_directory_config(const char *node_check_output, t_remote_error_type *remote_error);
 static bool parse_replication_config_owner(const char *node_check_output);
+static void run_remote_node_check_batch(const char *remote_host, t_node_info *remote_node_record, int local_node_id, const char *checks, UXSQLExpBufferData *batch_output);
+static bool get_batch_check_output(const char *batch_output, const char *check_name, UXSQLExpBufferData *output);
+static bool remote_node_check(const char *remote_host, t_node_info *remote_node_record, const char *options, const char *batch_output, const char *check_name, UXSQLExpBufferData *command_output);
 static CheckStatus parse_db_connection(const char *db_connection);
 
 /*
@@ -164,6 +202,8 @@ static CheckStatus parse_db_connection(const char *db_connection);
  *  --without-barman
  *  --replication-conf-only (--recovery-conf-only)
  *  --verify-backup (UxsinoDB 13 and later)
+ *  --incremental
+ *  --multi-source
  */
 
 void
@@ -240,6 +280,54 @@ do_standby_clone(void)
 		check_barman_config();
 	}
 
+	if (runtime_options.incremental == true)
+	{
+		if (mode != ux_basebackup)
+		{
+			log_error(_("--incremental can only be used when cloning directly from another node"));
+			exit(ERR_BAD_CONFIG);
+		}
+
+		if (runtime_options.verify_backup == true)
+		{
+			log_error(_("--verify-backup cannot be used together with --incremental"));
+			exit(ERR_BAD_CONFIG);
+		}
+
+		if (runtime_options.no_upstream_connection == true)
+		{
+			log_error(_("--incremental requires a connection to the source node"));
+			exit(ERR_BAD_CONFIG);
+		}
+	}
+
+	if (runtime_options.multi_source == true)
+	{
+		if (mode != ux_basebackup)
+		{
+			log_error(_("--multi-source can only be used when cloning directly from another node"));
+			exit(ERR_BAD_CONFIG);
+		}
+
+		if (runtime_options.incremental == true)
+		{
+			log_error(_("--multi-source cannot be used together with --incremental"));
+			exit(ERR_BAD_CONFIG);
+		}
+
+		if (runtime_options.verify_backup == true)
+		{
+			log_error(_("--verify-backup cannot be used together with --multi-source"));
+			exit(ERR_BAD_CONFIG);
+		}
+
+		if (runtime_options.no_upstream_connection == true)
+		{
+			log_error(_("--multi-source requires a connection to the source node"));
+			exit(ERR_BAD_CONFIG);
+		}
+	}
+
 	init_node_record(&local_node_record);
 	local_node_record.type = STANDBY;
 
@@ -326,6 +414,17 @@ do_standby_clone(void)
 			break;
 	}
 
+	/*
+	 * An incremental clone needs an existing data directory to update;
+	 * if there isn't one, there's nothing to be gained over a normal clone.
+	 */
+	if (runtime_options.incremental == true && is_ux_dir(local_data_directory) == false)
+	{
+		log_notice(_("no existing data directory found in \"%s\", performing a full clone"),
+				   local_data_directory);
+		runtime_options.incremental = false;
+	}
+
 	/*
 	 * By default attempt to connect to the source node. This will fail if no
 	 * connection is possible, unless in Barman mode, in which case we can
@@ -369,6 +468,8 @@ do_standby_clone(void)
 			exit(ERR_BAD_CONFIG);
 		}
 
+		if (runtime_options.incremental == true)
+			check_incremental_clone();
 	}
 	else
 	{
@@ -681,10 +782,16 @@ do_standby_clone(void)
 		if (mode == ux_basebackup)
 		{
 			/*
-			 * In --dry-run mode, this will just output the ux_basebackup command which
-			 * would be executed.
+			 * In --dry-run mode, this will just output the ux_basebackup (or,
+			 * with --incremental or --multi-source, rsync) command which would
+			 * be executed.
 			 */
-			run_basebackup(&local_node_record);
+			if (runtime_options.incremental == true)
+				run_incremental_clone(&local_node_record);
+			else if (runtime_options.multi_source == true)
+				run_multi_source_clone(&local_node_record);
+			else
+				run_basebackup(&local_node_record);
 		}
 
 		UXSQLfinish(source_conn);
@@ -698,7 +805,18 @@ do_standby_clone(void)
 	{
 		case ux_basebackup:
 			initialise_direct_clone(&local_node_record, &upstream_node_record);
-			log_notice(_("starting backup (using ux_basebackup)..."));
+			if (runtime_options.incremental == true)
+			{
+				log_notice(_("starting incremental clone (using rsync)..."));
+			}
+			else if (runtime_options.multi_source == true)
+			{
+				log_notice(_("starting multi-source clone (using rsync)..."));
+			}
+			else
+			{
+				log_notice(_("starting backup (using ux_basebackup)..."));
+			}
 			break;
 		case barman:
 			log_notice(_("retrieving backup from Barman..."));
@@ -713,7 +831,7 @@ do_standby_clone(void)
 
 	if (mode == ux_basebackup)
 	{
-		if (runtime_options.fast_checkpoint == false)
+		if (runtime_options.incremental == false && runtime_options.fast_checkpoint == false)
 		{
 			log_hint(_("this may take some time; consider using the -c/--fast-checkpoint option"));
 		}
@@ -722,7 +840,12 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case ux_basebackup:
-			r = run_basebackup(&local_node_record);
+			if (runtime_options.incremental == true)
+				r = run_incremental_clone(&local_node_record);
+			else if (runtime_options.multi_source == true)
+				r = run_multi_source_clone(&local_node_record);
+			else
+				r = run_basebackup(&local_node_record);
 			break;
 		case barman:
 			r = run_file_backup(&local_node_record);
@@ -847,7 +970,18 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case ux_basebackup:
-			log_notice(_("standby clone (using ux_basebackup) complete"));
+			if (runtime_options.incremental == true)
+			{
+				log_notice(_("standby clone (incremental, using rsync) complete"));
+			}
+			else if (runtime_options.multi_source == true)
+			{
+				log_notice(_("standby clone (multi-source, using rsync) complete"));
+			}
+			else
+			{
+				log_notice(_("standby clone (using ux_basebackup) complete"));
+			}
 			break;
 
 		case barman:
@@ -943,7 +1077,12 @@ do_standby_clone(void)
 	switch (mode)
 	{
 		case ux_basebackup:
-			appendUXSQLExpBufferStr(&event_details, "ux_basebackup");
+			if (runtime_options.incremental == true)
+				appendUXSQLExpBufferStr(&event_details, "incremental rsync");
+			else if (runtime_options.multi_source == true)
+				appendUXSQLExpBufferStr(&event_details, "multi-source rsync");
+			else
+				appendUXSQLExpBufferStr(&event_details, "ux_basebackup");
 			break;
 		case barman:
 			appendUXSQLExpBufferStr(&event_details, "barman");
@@ -1398,7 +1537,7 @@ _do_create_replication_conf(void)
 		{
 			UXconn	   *primary_conn = NULL;
 
-			create_slot_name(local_node_record.slot_name, local_node_record.node_id);
+			local_node_record.slot_name = create_slot_name(local_node_record.node_id);
 
 			/* Check we can connect to the primary so we can update the record */
 
@@ -1955,7 +2094,7 @@ do_standby_register(void)
 			placeholder_upstream_node_record.node_id = runtime_options.upstream_node_id;
 			placeholder_upstream_node_record.type = STANDBY;
 			placeholder_upstream_node_record.upstream_node_id = NO_UPSTREAM_NODE;
-			strncpy(placeholder_upstream_node_record.conninfo, runtime_options.upstream_conninfo, MAXLEN);
+			placeholder_upstream_node_record.conninfo = intern_string(runtime_options.upstream_conninfo);
 			placeholder_upstream_node_record.active = false;
 
 			record_created = create_node_record(primary_conn,
@@ -3438,7 +3577,7 @@ do_standby_follow_internal(UXconn *primary_conn, UXconn *follow_target_conn, t_n
 
 		if (!strlen(local_node_record.slot_name))
 		{
-			create_slot_name(local_node_record.slot_name, config_file_options.node_id);
+			local_node_record.slot_name = create_slot_name(config_file_options.node_id);
 
 			log_notice(_("setting node %i's slot name to \"%s\""),
 					   config_file_options.node_id,
@@ -3761,6 +3900,7 @@ do_standby_switchover(void)
 	RecoveryType recovery_type = RECTYPE_UNKNOWN;
 	UXSQLExpBufferData remote_command_str;
 	UXSQLExpBufferData command_output;
+	UXSQLExpBufferData node_check_batch_output;
 	UXSQLExpBufferData node_rejoin_options;
 	UXSQLExpBufferData logmsg;
 	UXSQLExpBufferData detailmsg;
@@ -3770,6 +3910,7 @@ do_standby_switchover(void)
 				i;
 	bool		command_success = false;
 	bool		shutdown_success = false;
+	bool		remote_wait_shutdown = true;
 	bool		dry_run_success = true;
 
 	/* this flag will use to generate the final message generated */
@@ -4321,26 +4462,45 @@ do_standby_switchover(void)
 	 * directory after the remote (demotion candidate) has shut down.
 	 */
 
-	initUXSQLExpBuffer(&remote_command_str);
-	make_remote_repmgr_path(&remote_command_str, &remote_node_record);
+	/*
+	 * Execute all the "node check" probes needed for the checks below in a
+	 * single remote invocation; if the remote repmgr does not support
+	 * "--batch", each check falls back to its own invocation.
+	 */
+	{
+		UXSQLExpBufferData batch_checks;
+
+		initUXSQLExpBuffer(&batch_checks);
+		appendUXSQLExpBufferStr(&batch_checks, "data-directory-config,replication-connection");
+
+		if (UXSQLserverVersion(local_conn) >= 120000 && remote_repmgr_version >= 50100)
+			appendUXSQLExpBufferStr(&batch_checks, ",replication-config-owner");
+
+		if (guc_set(remote_conn, "archive_mode", "!=", "off"))
+			appendUXSQLExpBufferStr(&batch_checks, ",archive-ready");
+
+		initUXSQLExpBuffer(&node_check_batch_output);
+		run_remote_node_check_batch(remote_host,
+									&remote_node_record,
+									local_node_record.node_id,
+									batch_checks.data,
+									&node_check_batch_output);
+		termUXSQLExpBuffer(&batch_checks);
+	}
 
 	/*
 	 * --data-directory-config is available from repmgr 4.3; it will fail
 	 * if the remote repmgr is an earlier version, but the version should match
 	 * anyway.
 	 */
-	appendUXSQLExpBufferStr(&remote_command_str, "node check --data-directory-config --optformat -LINFO 2>/dev/null");
-
 	termUXSQLExpBuffer(&command_output);
 	initUXSQLExpBuffer(&command_output);
-	command_success = remote_command(remote_host,
-									 runtime_options.remote_user,
-									 remote_command_str.data,
-									 config_file_options.ssh_options,
-									 &command_output,
-									 remote_node_record.uxdb_passwd);
-
-	termUXSQLExpBuffer(&remote_command_str);
+	command_success = remote_node_check(remote_host,
+										&remote_node_record,
+										"--data-directory-config --optformat -LINFO 2>/dev/null",
+										node_check_batch_output.data,
+										"data-directory-config",
+										&command_output);
 
 	if (command_success == false)
 	{
@@ -4530,20 +4690,13 @@ do_standby_switchover(void)
 
 	if (UXSQLserverVersion(local_conn) >= 120000 && remote_repmgr_version >= 50100)
 	{
-		initUXSQLExpBuffer(&remote_command_str);
-		make_remote_repmgr_path(&remote_command_str, &remote_node_record);
-
-		appendUXSQLExpBufferStr(&remote_command_str, "node check --replication-config-owner --optformat -LINFO 2>/dev/null");
-
 		initUXSQLExpBuffer(&command_output);
-		command_success = remote_command(remote_host,
-										 runtime_options.remote_user,
-										 remote_command_str.data,
-										 config_file_options.ssh_options,
-										 &command_output,
-										 remote_node_record.uxdb_passwd);
-
-		termUXSQLExpBuffer(&remote_command_str);
+		command_success = remote_node_check(remote_host,
+											&remote_node_record,
+											"--replication-config-owner --optformat -LINFO 2>/dev/null",
+											node_check_batch_output.data,
+											"replication-config-owner",
+											&command_output);
 
 		if (command_success == false)
 		{
@@ -4625,22 +4778,20 @@ do_standby_switchover(void)
 
 	/* check demotion candidate can make replication connection to promotion candidate */
 	{
-		initUXSQLExpBuffer(&remote_command_str);
-		make_remote_repmgr_path(&remote_command_str, &remote_node_record);
-		appendUXSQLExpBuffer(&remote_command_str,
-						  "node check --remote-node-id=%i --replication-connection",
-						  local_node_record.node_id);
+		char		check_options[MAXLEN] = "";
 
-		initUXSQLExpBuffer(&command_output);
+		snprintf(check_options, sizeof(check_options),
+				 "--remote-node-id=%i --replication-connection",
+				 local_node_record.node_id);
 
-		command_success = remote_command(remote_host,
-										 runtime_options.remote_user,
-										 remote_command_str.data,
-										 config_file_options.ssh_options,
-										 &command_output,
-										 remote_node_record.uxdb_passwd);
+		initUXSQLExpBuffer(&command_output);
 
-		termUXSQLExpBuffer(&remote_command_str);
+		command_success = remote_node_check(remote_host,
+											&remote_node_record,
+											check_options,
+											node_check_batch_output.data,
+											"replication-connection",
+											&command_output);
 
 		if (command_success == true)
 		{
@@ -4683,21 +4834,14 @@ do_standby_switchover(void)
 			int			threshold = 0;
 			t_remote_error_type remote_error = REMOTE_ERROR_NONE;
 
-			initUXSQLExpBuffer(&remote_command_str);
-			make_remote_repmgr_path(&remote_command_str, &remote_node_record);
-			appendUXSQLExpBufferStr(&remote_command_str,
-								 "node check --terse -LERROR --archive-ready --optformat");
-
 			initUXSQLExpBuffer(&command_output);
 
-			command_success = remote_command(remote_host,
-											 runtime_options.remote_user,
-											 remote_command_str.data,
-											 config_file_options.ssh_options,
-											 &command_output,
-											 remote_node_record.uxdb_passwd);
-
-			termUXSQLExpBuffer(&remote_command_str);
+			command_success = remote_node_check(remote_host,
+												&remote_node_record,
+												"--terse -LERROR --archive-ready --optformat",
+												node_check_batch_output.data,
+												"archive-ready",
+												&command_output);
 
 			if (command_success == true)
 			{
@@ -4877,6 +5021,8 @@ do_standby_switchover(void)
 		}
 	}
 
+	termUXSQLExpBuffer(&node_check_batch_output);
+
 	UXSQLfinish(remote_conn);
 	/* Added by chen_jingwen for #207866 at 2024/10/8 */
 	/* ͷſռÿգǷڴ */
@@ -4953,9 +5099,15 @@ do_standby_switchover(void)
 				continue;
 			}
 
-			repmgrd_info[i]->running = repmgrd_is_running(cell->node_info->conn);
-			repmgrd_info[i]->pid = repmgrd_get_pid(cell->node_info->conn);
-			repmgrd_info[i]->paused = repmgrd_is_paused(cell->node_info->conn);
+			{
+				t_repmgrd_state repmgrd_state = T_REPMGRD_STATE_INITIALIZER;
+
+				(void) get_repmgrd_state(cell->node_info->conn, cell->node_info->type, &repmgrd_state);
+
+				repmgrd_info[i]->running = repmgrd_state.running;
+				repmgrd_info[i]->pid = repmgrd_state.pid;
+				repmgrd_info[i]->paused = repmgrd_state.paused;
+			}
 
 			if (repmgrd_info[i]->running == true)
 				repmgrd_running_count++;
@@ -5247,24 +5399,43 @@ do_standby_switchover(void)
 	termUXSQLExpBuffer(&command_output);
 	shutdown_success = false;
 
-	/* loop for timeout waiting for current primary to stop */
+	/*
+	 * Loop for timeout waiting for current primary to stop.
+	 *
+	 * On the first pass we ask the remote repmgr to wait for the shutdown
+	 * itself, which it can detect as soon as it happens, and report back
+	 * over the same ssh session. Older versions reject --wait-shutdown at
+	 * once, in which case we fall back to checking once per second for the
+	 * remainder of the timeout.
+	 */
 
 	for (i = 0; i < config_file_options.shutdown_check_timeout; i++)
 	{
 		/* Check whether primary is available */
-		UXPing		ping_res;
+		UXPing		ping_res = UXSQLPING_NO_RESPONSE;
+		bool		wait_remote = (i == 0 && remote_wait_shutdown == true);
 
-		log_info(_("checking for primary shutdown; %i of %i attempts (\"shutdown_check_timeout\")"),
-				 i + 1, config_file_options.shutdown_check_timeout);
+		if (wait_remote == true)
+		{
+			log_info(_("waiting up to %i seconds for primary shutdown (\"shutdown_check_timeout\")"),
+					 config_file_options.shutdown_check_timeout);
+		}
+		else
+		{
+			log_info(_("checking for primary shutdown; %i of %i attempts (\"shutdown_check_timeout\")"),
+					 i + 1, config_file_options.shutdown_check_timeout);
 
-		ping_res = UXSQLping(remote_conninfo);
+			ping_res = UXSQLping(remote_conninfo);
 
-		log_debug("ping status is: %s", print_uxsqlping_status(ping_res));
+			log_debug("ping status is: %s", print_uxsqlping_status(ping_res));
+		}
 
 		/* database server could not be contacted */
 		if (ping_res == UXSQLPING_NO_RESPONSE || ping_res == UXSQLPING_NO_ATTEMPT)
 		{
 			bool		command_success;
+			time_t		wait_start = time(NULL);
+			int			waited;
 
 			/*
 			 * remote server can't be contacted at protocol level - that
@@ -5278,6 +5449,13 @@ do_standby_switchover(void)
 			appendUXSQLExpBufferStr(&remote_command_str,
 								 "node status --is-shutdown-cleanly");
 
+			if (wait_remote == true)
+			{
+				appendUXSQLExpBuffer(&remote_command_str,
+									 " --wait-shutdown=%i",
+									 config_file_options.shutdown_check_timeout);
+			}
+
 			initUXSQLExpBuffer(&command_output);
 
 			command_success = remote_command(remote_host,
@@ -5289,6 +5467,8 @@ do_standby_switchover(void)
 
 			termUXSQLExpBuffer(&remote_command_str);
 
+			waited = (int) (time(NULL) - wait_start);
+
 			if (command_success == true)
 			{
 				NodeStatus	status = parse_node_status_is_shutdown_cleanly(command_output.data, &remote_last_checkpoint_lsn);
@@ -5345,6 +5525,41 @@ do_standby_switchover(void)
 				{
 					log_info(_("remote node is still shutting down"));
 				}
+
+				if (wait_remote == true)
+				{
+					/*
+					 * If the remote repmgr returned before the timeout
+					 * without a recognisable state, it did not wait; only
+					 * the time actually spent counts against the timeout.
+					 */
+					if (status == NODE_STATUS_UNKNOWN && waited < config_file_options.shutdown_check_timeout)
+					{
+						log_notice(_("unable to wait for shutdown on the current primary, checking once per second instead"));
+						log_detail(_("repmgr on the current primary may not support --wait-shutdown"));
+						remote_wait_shutdown = false;
+						termUXSQLExpBuffer(&command_output);
+
+						i = waited - 1;
+						continue;
+					}
+
+					/* the remote repmgr has already waited for the full timeout */
+					termUXSQLExpBuffer(&command_output);
+					break;
+				}
+			}
+			else if (wait_remote == true)
+			{
+				termUXSQLExpBuffer(&command_output);
+
+				/* as above, the timeout may already have been spent */
+				if (waited >= config_file_options.shutdown_check_timeout)
+					break;
+
+				remote_wait_shutdown = false;
+				i = waited - 1;
+				continue;
 			}
 
 			termUXSQLExpBuffer(&command_output);
@@ -5882,6 +6097,15 @@ do_standby_switchover(void)
 		log_error("%s", logmsg.data);
 	}
 
+	/*
+	 * If --siblings-follow specified, attempt to make them follow the new
+	 * primary; the outcome is recorded in the switchover event.
+	 */
+	if (runtime_options.siblings_follow == true && sibling_nodes.node_count > 0)
+	{
+		sibling_nodes_follow(&local_node_record, &sibling_nodes, &sibling_nodes_stats);
+	}
+
 	initUXSQLExpBuffer(&event_details);
 
 	appendUXSQLExpBufferStr(&event_details, logmsg.data);
@@ -5893,6 +6117,29 @@ do_standby_switchover(void)
 						  detailmsg.data);
 	}
 
+	if (runtime_options.siblings_follow == true && sibling_nodes.node_count > 0)
+	{
+		appendUXSQLExpBuffer(&event_details,
+							 "\n%i of %i sibling nodes now following the new primary",
+							 sibling_nodes_stats.followed_sibling_node_count,
+							 sibling_nodes.node_count);
+
+		if (sibling_nodes_stats.failed_follow_sibling_node_count > 0)
+		{
+			appendUXSQLExpBuffer(&event_details,
+								 " (%i failed, of which %i timed out)",
+								 sibling_nodes_stats.failed_follow_sibling_node_count,
+								 sibling_nodes_stats.timed_out_follow_sibling_node_count);
+		}
+
+		if (sibling_nodes_stats.unreachable_sibling_node_count > 0)
+		{
+			appendUXSQLExpBuffer(&event_details,
+								 "; %i sibling nodes were unreachable",
+								 sibling_nodes_stats.unreachable_sibling_node_count);
+		}
+	}
+
 
 	create_event_notification_extended(local_conn,
 									   &config_file_options,
@@ -5908,15 +6155,6 @@ do_standby_switchover(void)
 	termUXSQLExpBuffer(&command_output);
 
 
-	/*
-	 * If --siblings-follow specified, attempt to make them follow the new
-	 * primary
-	 */
-	if (runtime_options.siblings_follow == true && sibling_nodes.node_count > 0)
-	{
-		sibling_nodes_follow(&local_node_record, &sibling_nodes, &sibling_nodes_stats);
-	}
-
 	clear_node_info_list(&sibling_nodes);
 
 	/*
@@ -7081,10 +7319,11 @@ initialise_direct_clone(t_node_info *local_node_record, t_node_info *upstream_no
 {
 	/*
 	 * Check the destination data directory can be used (in Barman mode, this
-	 * directory will already have been created)
+	 * directory will already have been created; with --incremental, the
+	 * existing directory will be updated in place)
 	 */
 
-	if (!create_ux_dir(local_data_directory, runtime_options.force))
+	if (runtime_options.incremental == false && !create_ux_dir(local_data_directory, runtime_options.force))
 	{
 		log_error(_("unable to use directory \"%s\""),
 				  local_data_directory);
@@ -7397,12 +7636,21 @@ run_basebackup(t_node_info *node_record)
 	if (source_conn != primary_conn)
 		(void)connection_ping_reconnect(source_conn);
 
-	/*
-	 * If replication slots in use, check the created slot is on the correct
-	 * node; the slot will initially get created on the source node, and will
-	 * need to be dropped and recreated on the actual upstream node if these
-	 * differ.
-	 */
+	move_replication_slot_to_upstream(node_record);
+
+	return SUCCESS;
+}
+
+
+/*
+ * If replication slots in use, check the created slot is on the correct
+ * node; the slot will initially get created on the source node, and will
+ * need to be dropped and recreated on the actual upstream node if these
+ * differ.
+ */
+static void
+move_replication_slot_to_upstream(t_node_info *node_record)
+{
 	if (config_file_options.use_replication_slots && upstream_node_id != UNKNOWN_NODE_ID)
 	{
 		t_node_info upstream_node_record = T_NODE_INFO_INITIALIZER;
@@ -7516,61 +7764,1032 @@ run_basebackup(t_node_info *node_record)
 						node_record->slot_name);
 		}
 	}
-
-	return SUCCESS;
 }
 
 
 /*
- * Perform a filesystem backup using rsync.
- *
- * From repmgr 4 this is only used for Barman backups.
+ * Sanity checks for "standby clone --incremental", using the control data
+ * of the existing data directory to establish whether it belongs to the
+ * source node's cluster and where it stands relative to the source node.
  */
-static int
-run_file_backup(t_node_info *local_node_record)
+static void
+check_incremental_clone(void)
 {
-	int			r = SUCCESS,
-				i;
-
-	char		command[MAXLEN] = "";
-	char		filename[MAXLEN] = "";
-	char		buf[MAXLEN] = "";
-	char		basebackups_directory[MAXLEN] = "";
-	char		backup_id[MAXLEN] = "";
-	TablespaceDataList tablespace_list = {NULL, NULL};
-	TablespaceDataListCell *cell_t = NULL;
+	const ControlFileInfo *control_file_info = get_controlfile_snapshot(local_data_directory);
+	uint64		local_system_identifier = control_file_info->system_identifier;
+	uint64		source_system_identifier = system_identifier(source_conn);
+	TimeLineID	local_tli = control_file_info->timeline;
+	TimeLineID	source_tli = get_node_timeline(source_conn, NULL);
+	XLogRecPtr	local_lsn = control_file_info->checkPoint;
+	int			r;
 
-	UXSQLExpBufferData tablespace_map;
-	bool		tablespace_map_rewrite = false;
+	if (control_file_info->minRecoveryPoint > local_lsn)
+		local_lsn = control_file_info->minRecoveryPoint;
 
-	/* For the foreseeable future, no other modes are supported */
-	Assert(mode == barman);
-	if (mode == barman)
+	if (control_file_info->control_file_processed == false)
 	{
-		t_basebackup_options backup_options = T_BASEBACKUP_OPTIONS_INITIALIZER;
+		log_error(_("unable to read the system identifier of the existing data directory \"%s\""),
+				  local_data_directory);
+		log_hint(_("omit --incremental to perform a full clone"));
+		exit(ERR_BAD_CONFIG);
+	}
 
-		/*
-		 * Locate Barman's base backups directory
-		 */
+	if (source_system_identifier != UNKNOWN_SYSTEM_IDENTIFIER
+		&& source_system_identifier != local_system_identifier)
+	{
+		log_error(_("the existing data directory does not belong to the source node's replication cluster"));
+		log_detail(_("local system identifier is %lu, source node's system identifier is %lu"),
+				   local_system_identifier,
+				   source_system_identifier);
+		log_hint(_("omit --incremental to perform a full clone"));
+		exit(ERR_BAD_CONFIG);
+	}
 
-		get_barman_property(basebackups_directory, "basebackups_directory", local_repmgr_tmp_directory);
+	/*
+	 * Report the divergence point; this doesn't affect what is copied (any
+	 * file changed on either side since will be updated), but indicates how
+	 * much of the existing data directory can be reused.
+	 */
+	if (local_tli == UNKNOWN_TIMELINE_ID || source_tli == UNKNOWN_TIMELINE_ID)
+	{
+		log_warning(_("unable to compare the timelines of the existing data directory and the source node"));
+	}
+	else if (local_tli == source_tli)
+	{
+		log_info(_("existing data directory is on the source node's timeline %i, at %X/%X"),
+				 local_tli,
+				 format_lsn(local_lsn));
+	}
+	else if (local_tli > source_tli)
+	{
+		log_notice(_("existing data directory's timeline %i is ahead of the source node's timeline %i"),
+				   local_tli,
+				   source_tli);
+		log_detail(_("changes made on timeline %i will be discarded"), local_tli);
+	}
+	else
+	{
+		UXconn	   *repl_conn = establish_replication_connection_from_conn(source_conn,
+																		   upstream_repluser[0] != '\0' ? upstream_repluser : runtime_options.replication_user);
 
-		/*
-		 * Read the list of backup files into a local file. In the process:
-		 *
-		 * - determine the backup ID
-		 * - check, and remove, the prefix
-		 * - detect tablespaces
-		 * - filter files in one list per tablespace
-		 */
+		if (UXSQLstatus(repl_conn) == CONNECTION_OK)
 		{
-			FILE	   *fi;		/* input stream */
-			FILE	   *fd;		/* output for data.txt */
-			char		prefix[MAXLEN] = "";
-			char		output[MAXLEN] = "";
-			int			n = 0;
-			char	   *p = NULL,
-					   *q = NULL;
+			TimeLineHistoryEntry *history = get_timeline_history(repl_conn, local_system_identifier, local_tli + 1);
+
+			if (history != NULL)
+			{
+				if (local_lsn > history->end)
+				{
+					log_notice(_("existing data directory diverged from the source node at %X/%X on timeline %i"),
+							   format_lsn(history->end),
+							   local_tli);
+					log_detail(_("changes made after %X/%X will be discarded"),
+							   format_lsn(history->end));
+				}
+				else
+				{
+					log_info(_("existing data directory is at %X/%X on timeline %i, behind the source node's timeline %i"),
+							 format_lsn(local_lsn),
+							 local_tli,
+							 source_tli);
+				}
+
+				pfree(history);
+			}
+		}
+		else
+		{
+			log_warning(_("unable to establish a replication connection to determine the divergence point"));
+		}
+
+		UXSQLfinish(repl_conn);
+	}
+
+	/* files are copied with rsync, so SSH access to the source is required */
+	r = test_ssh_connection(runtime_options.host, runtime_options.remote_user);
+
+	if (r != 0)
+	{
+		log_error(_("remote host \"%s\" is not reachable via SSH - unable to perform an incremental clone"),
+				  runtime_options.host);
+		exit(ERR_BAD_CONFIG);
+	}
+}
+
+
+/*
+ * Update an existing (stale or diverged) data directory from the source
+ * node, transferring only what has changed.
+ *
+ * The source is placed in non-exclusive backup mode and its data directory
+ * and tablespaces are synchronised with rsync's delta-transfer algorithm,
+ * using the UXsinoDB block size as the rsync block size: files are compared
+ * by checksum rather than by size and modification time, as a diverged
+ * data directory will often contain files which match in both but differ
+ * in content, and for files which differ only those blocks whose checksums
+ * differ are sent and rewritten in place. The
+ * "backup_label" returned when the backup is stopped makes the standby
+ * replay WAL from the backup's starting point, which makes any blocks
+ * changed during the copy consistent.
+ */
+static int
+run_incremental_clone(t_node_info *node_record)
+{
+	UXconn	   *superuser_conn = NULL;
+	UXconn	   *privileged_conn = NULL;
+	char		source_data_directory[MAXUXPATH] = "";
+	char		host_string[MAXLEN] = "";
+	char		path[MAXUXPATH] = "";
+	KeyValueList tablespaces = {NULL, NULL};
+	KeyValueListCell *cell = NULL;
+	UXSQLExpBufferData rsync_flags;
+	UXSQLExpBufferData script;
+	UXSQLExpBufferData label_file;
+	UXSQLExpBufferData tablespace_map;
+	XLogRecPtr	backup_start_lsn = InvalidXLogRecPtr;
+	const char *wal_directory = source_server_version_num >= 100000 ? "ux_wal" : "ux_xlog";
+	int			r = SUCCESS;
+
+	if (SettingsUser == REPMGR_USER)
+		privileged_conn = source_conn;
+	else
+		get_superuser_connection(&source_conn, &superuser_conn, &privileged_conn);
+
+	if (get_ux_setting(privileged_conn, "data_directory", source_data_directory) == false
+		|| source_data_directory[0] == '\0')
+	{
+		log_error(_("unable to determine the source node's data directory"));
+		log_hint(_("this requires superuser permissions; provide -S/--superuser"));
+		r = ERR_BAD_CONFIG;
+		goto cleanup;
+	}
+
+	if (get_tablespace_locations(privileged_conn, &tablespaces) == false)
+	{
+		r = ERR_DB_QUERY;
+		goto cleanup;
+	}
+
+	if (tablespaces.head != NULL && config_file_options.tablespace_mapping.head != NULL)
+	{
+		log_error(_("\"tablespace_mapping\" is not supported with --incremental"));
+		log_hint(_("omit --incremental to perform a full clone"));
+		r = ERR_BAD_CONFIG;
+		goto cleanup;
+	}
+
+	if (runtime_options.remote_user[0] != '\0')
+		maxlen_snprintf(host_string, "%s@%s", runtime_options.remote_user, runtime_options.host);
+	else
+		maxlen_snprintf(host_string, "%s", runtime_options.host);
+
+	initUXSQLExpBuffer(&rsync_flags);
+	appendUXSQLExpBuffer(&rsync_flags,
+						 "--archive --delete --inplace --no-whole-file --checksum --block-size=%i",
+						 INCREMENTAL_CLONE_BLOCK_SIZE);
+
+	if (config_file_options.rsync_options[0] != '\0')
+		appendUXSQLExpBuffer(&rsync_flags, " %s", config_file_options.rsync_options);
+	else
+		appendUXSQLExpBufferStr(&rsync_flags, " --rsh=ssh");
+
+	append_rsync_data_directory_excludes(&rsync_flags, source_server_version_num);
+
+	/*
+	 * Replication slots and backup/recovery control files from the source
+	 * node must not be copied; any local ones are removed below.
+	 */
+	appendUXSQLExpBufferStr(&rsync_flags,
+							" --exclude=ux_replslot/* --exclude=backup_label --exclude=backup_label.old"
+							" --exclude=" TABLESPACE_MAP " --exclude=" STANDBY_SIGNAL_FILE
+							" --exclude=" RECOVERY_SIGNAL_FILE);
+
+	initUXSQLExpBuffer(&script);
+	appendUXSQLExpBuffer(&script, "rsync %s %s:%s/ %s/",
+						 rsync_flags.data, host_string,
+						 source_data_directory, local_data_directory);
+
+	if (runtime_options.dry_run == true)
+	{
+		log_info(_("would execute:\n  %s"), script.data);
+
+		for (cell = tablespaces.head; cell; cell = cell->next)
+		{
+			log_detail(_("tablespace %s (\"%s\") would also be synchronised"),
+					   cell->key, cell->value);
+		}
+
+		termUXSQLExpBuffer(&script);
+		termUXSQLExpBuffer(&rsync_flags);
+		goto cleanup;
+	}
+
+	backup_start_lsn = start_nonexclusive_backup(privileged_conn,
+												 "repmgr incremental clone",
+												 runtime_options.fast_checkpoint);
+
+	if (backup_start_lsn == InvalidXLogRecPtr)
+	{
+		log_hint(_("starting a backup requires superuser permissions or EXECUTE on the backup functions"));
+		termUXSQLExpBuffer(&script);
+		termUXSQLExpBuffer(&rsync_flags);
+		r = ERR_BAD_BASEBACKUP;
+		goto cleanup;
+	}
+
+	log_notice(_("backup started on the source node at %X/%X"), format_lsn(backup_start_lsn));
+	log_info(_("executing:\n  %s"), script.data);
+
+	r = ux_system(script.data);
+	termUXSQLExpBuffer(&script);
+
+	/* exit code 24 indicates vanished files, which isn't a problem for us */
+	if (r != 0 && !(WIFEXITED(r) && WEXITSTATUS(r) == 24))
+	{
+		log_error(_("unable to synchronise the data directory from the source node"));
+		log_detail(_("rsync returned exit status %i"), WEXITSTATUS(r));
+		termUXSQLExpBuffer(&rsync_flags);
+		r = ERR_BAD_RSYNC;
+		goto stop_backup;
+	}
+
+	r = SUCCESS;
+
+	for (cell = tablespaces.head; cell; cell = cell->next)
+	{
+		initUXSQLExpBuffer(&script);
+		appendUXSQLExpBuffer(&script, "rsync %s %s:%s/ %s/",
+							 rsync_flags.data, host_string,
+							 cell->value, cell->value);
+
+		log_info(_("synchronising tablespace %s:\n  %s"), cell->key, script.data);
+
+		r = ux_system(script.data);
+		termUXSQLExpBuffer(&script);
+
+		if (r != 0 && !(WIFEXITED(r) && WEXITSTATUS(r) == 24))
+		{
+			log_error(_("unable to synchronise tablespace \"%s\" from the source node"), cell->value);
+			log_detail(_("rsync returned exit status %i"), WEXITSTATUS(r));
+			termUXSQLExpBuffer(&rsync_flags);
+			r = ERR_BAD_RSYNC;
+			goto stop_backup;
+		}
+
+		r = SUCCESS;
+	}
+
+	/* ux_control is excluded from the main copy and copied last */
+	initUXSQLExpBuffer(&script);
+	appendUXSQLExpBuffer(&script, "rsync --archive %s:%s/global/ux_control %s/global/ux_control",
+						 host_string, source_data_directory, local_data_directory);
+	log_verbose(LOG_DEBUG, "run_incremental_clone():\n  %s", script.data);
+
+	if (ux_system(script.data) != 0)
+	{
+		log_error(_("unable to copy \"global/ux_control\" from the source node"));
+		r = ERR_BAD_RSYNC;
+	}
+
+	termUXSQLExpBuffer(&script);
+	termUXSQLExpBuffer(&rsync_flags);
+
+	/*
+	 * Remove WAL and replication slots left over from the previous
+	 * incarnation of the local node; WAL from the backup's starting point
+	 * will be streamed from the upstream.
+	 */
+	if (r == SUCCESS)
+	{
+		maxlen_snprintf(path, "%s/%s", local_data_directory, wal_directory);
+		if (clear_directory_contents(path) == false)
+			r = ERR_INTERNAL;
+
+		maxlen_snprintf(path, "%s/%s/archive_status", local_data_directory, wal_directory);
+		if (r == SUCCESS && mkdir(path, S_IRWXU) != 0 && errno != EEXIST)
+		{
+			log_error(_("unable to create directory \"%s\""), path);
+			log_detail("%s", strerror(errno));
+			r = ERR_INTERNAL;
+		}
+
+		maxlen_snprintf(path, "%s/ux_replslot", local_data_directory);
+		if (r == SUCCESS && clear_directory_contents(path) == false)
+			r = ERR_INTERNAL;
+	}
+
+stop_backup:
+	initUXSQLExpBuffer(&label_file);
+	initUXSQLExpBuffer(&tablespace_map);
+
+	if (stop_nonexclusive_backup(privileged_conn, &label_file, &tablespace_map) == false)
+	{
+		if (r == SUCCESS)
+			r = ERR_BAD_BASEBACKUP;
+	}
+	else if (r == SUCCESS)
+	{
+		if (write_backup_label_files(&label_file, &tablespace_map) == false)
+			r = ERR_BAD_BASEBACKUP;
+	}
+
+	termUXSQLExpBuffer(&label_file);
+	termUXSQLExpBuffer(&tablespace_map);
+
+	if (r == SUCCESS)
+	{
+		/* check connections are still available */
+		(void) connection_ping_reconnect(primary_conn);
+
+		if (source_conn != primary_conn)
+			(void) connection_ping_reconnect(source_conn);
+
+		move_replication_slot_to_upstream(node_record);
+	}
+
+cleanup:
+	key_value_list_free(&tablespaces);
+
+	if (superuser_conn != NULL)
+		UXSQLfinish(superuser_conn);
+
+	return r;
+}
+
+
+/*
+ * Remove everything in the specified directory, but not the directory
+ * itself.
+ */
+static bool
+clear_directory_contents(const char *path)
+{
+	DIR		   *dir = NULL;
+	struct dirent *entry = NULL;
+	char		entry_path[MAXUXPATH] = "";
+	struct stat statbuf;
+	bool		success = true;
+
+	dir = opendir(path);
+
+	if (dir == NULL)
+	{
+		if (errno == ENOENT)
+			return true;
+
+		log_error(_("unable to open directory \"%s\""), path);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		snprintf(entry_path, sizeof(entry_path), "%s/%s", path, entry->d_name);
+
+		if (lstat(entry_path, &statbuf) == 0 && S_ISDIR(statbuf.st_mode))
+		{
+			if (rmdir_recursive(entry_path) != 0)
+				success = false;
+		}
+		else if (unlink(entry_path) != 0 && errno != ENOENT)
+		{
+			log_warning(_("unable to remove \"%s\""), entry_path);
+			log_detail("%s", strerror(errno));
+			success = false;
+		}
+	}
+
+	closedir(dir);
+
+	return success;
+}
+
+
+/*
+ * Write the "backup_label" and (if not empty) "tablespace_map" files
+ * returned by stop_nonexclusive_backup() to the local data directory.
+ */
+static bool
+write_backup_label_files(UXSQLExpBufferData *label_file, UXSQLExpBufferData *tablespace_map)
+{
+	char		path[MAXUXPATH] = "";
+	FILE	   *fp = NULL;
+
+	maxlen_snprintf(path, "%s/backup_label", local_data_directory);
+	fp = fopen(path, "w");
+
+	if (fp == NULL || fputs(label_file->data, fp) == EOF || fclose(fp) != 0)
+	{
+		log_error(_("unable to write \"%s\""), path);
+		log_detail("%s", strerror(errno));
+		return false;
+	}
+
+	if (tablespace_map->data[0] != '\0')
+	{
+		maxlen_snprintf(path, "%s/%s", local_data_directory, TABLESPACE_MAP);
+		fp = fopen(path, "w");
+
+		if (fp == NULL || fputs(tablespace_map->data, fp) == EOF || fclose(fp) != 0)
+		{
+			log_error(_("unable to write \"%s\""), path);
+			log_detail("%s", strerror(errno));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Clone the data directory from the source node, but copy the relation
+ * files (which make up the bulk of the data) from all suitable standbys
+ * in the cluster in parallel, so neither the source node's network
+ * bandwidth nor its disks limit the rate at which the clone is built.
+ *
+ * A non-exclusive backup is started on the primary; each donor must have
+ * the same system identifier as the primary and have replayed WAL past the
+ * backup's starting point before anything is copied from it, and as every
+ * donor is behind the primary, nothing copied can be newer than the point
+ * at which the backup is stopped. The files are therefore consistent in the
+ * same way as those copied from a single node, and replaying WAL from the
+ * backup's starting point, streamed from the upstream node, makes the
+ * result consistent.
+ *
+ * All other files (e.g. transaction status and configuration files), and
+ * "global/ux_control", are copied from the source node as usual.
+ */
+static int
+run_multi_source_clone(t_node_info *node_record)
+{
+	UXconn	   *superuser_conn = NULL;
+	UXconn	   *privileged_conn = NULL;
+	char		source_data_directory[MAXUXPATH] = "";
+	char		host_string[MAXLEN] = "";
+	char		path[MAXUXPATH] = "";
+	KeyValueList tablespaces = {NULL, NULL};
+	KeyValueListCell *cell = NULL;
+	t_clone_donor *donors = NULL;
+	int			donor_count = 0;
+	uint64		primary_system_identifier = UNKNOWN_SYSTEM_IDENTIFIER;
+	UXSQLExpBufferData rsync_flags;
+	UXSQLExpBufferData relation_rsync_flags;
+	UXSQLExpBufferData script;
+	UXSQLExpBufferData label_file;
+	UXSQLExpBufferData tablespace_map;
+	XLogRecPtr	backup_start_lsn = InvalidXLogRecPtr;
+	const char *wal_directory = source_server_version_num >= 100000 ? "ux_wal" : "ux_xlog";
+	bool		backup_started = false;
+	int			i;
+	int			r = SUCCESS;
+
+	/* the backup is taken on the primary, which may not be the source node */
+	if (SettingsUser == REPMGR_USER)
+		privileged_conn = primary_conn;
+	else
+		get_superuser_connection(&primary_conn, &superuser_conn, &privileged_conn);
+
+	if (get_ux_setting(source_conn, "data_directory", source_data_directory) == false
+		|| source_data_directory[0] == '\0')
+	{
+		log_error(_("unable to determine the source node's data directory"));
+		log_hint(_("this requires superuser permissions or membership of \"ux_read_all_settings\""));
+		r = ERR_BAD_CONFIG;
+		goto cleanup;
+	}
+
+	if (get_tablespace_locations(privileged_conn, &tablespaces) == false)
+	{
+		r = ERR_DB_QUERY;
+		goto cleanup;
+	}
+
+	if (tablespaces.head != NULL && config_file_options.tablespace_mapping.head != NULL)
+	{
+		log_error(_("\"tablespace_mapping\" is not supported with --multi-source"));
+		log_hint(_("omit --multi-source to clone from a single node"));
+		r = ERR_BAD_CONFIG;
+		goto cleanup;
+	}
+
+	primary_system_identifier = system_identifier(primary_conn);
+
+	if (primary_system_identifier == UNKNOWN_SYSTEM_IDENTIFIER)
+	{
+		log_error(_("unable to determine the primary's system identifier"));
+		r = ERR_DB_QUERY;
+		goto cleanup;
+	}
+
+	if (runtime_options.remote_user[0] != '\0')
+		maxlen_snprintf(host_string, "%s@%s", runtime_options.remote_user, runtime_options.host);
+	else
+		maxlen_snprintf(host_string, "%s", runtime_options.host);
+
+	/* files are copied with rsync, so SSH access to the source is required */
+	if (test_ssh_connection(runtime_options.host, runtime_options.remote_user) != 0)
+	{
+		log_error(_("remote host \"%s\" is not reachable via SSH - unable to perform a multi-source clone"),
+				  runtime_options.host);
+		r = ERR_BAD_CONFIG;
+		goto cleanup;
+	}
+
+	donor_count = get_clone_donors(primary_system_identifier, &donors);
+
+	if (donor_count == 0)
+	{
+		log_warning(_("no standbys available to copy relation files from"));
+		log_detail(_("all files will be copied from the source node"));
+	}
+
+	initUXSQLExpBuffer(&rsync_flags);
+	appendUXSQLExpBufferStr(&rsync_flags, "--archive");
+
+	if (config_file_options.rsync_options[0] != '\0')
+		appendUXSQLExpBuffer(&rsync_flags, " %s", config_file_options.rsync_options);
+	else
+		appendUXSQLExpBufferStr(&rsync_flags, " --rsh=ssh");
+
+	/* files may legitimately be missing on a donor if dropped since the backup started */
+	initUXSQLExpBuffer(&relation_rsync_flags);
+	appendUXSQLExpBuffer(&relation_rsync_flags, "%s --ignore-missing-args", rsync_flags.data);
+
+	append_rsync_data_directory_excludes(&rsync_flags, source_server_version_num);
+
+	/*
+	 * Relation files are copied separately; replication slots and
+	 * backup/recovery control files from the source node must not be
+	 * copied at all.
+	 */
+	appendUXSQLExpBufferStr(&rsync_flags,
+							" --exclude=/base/*/[0-9]* --exclude=/global/[0-9]*"
+							" --exclude=ux_replslot/* --exclude=backup_label --exclude=backup_label.old"
+							" --exclude=" TABLESPACE_MAP " --exclude=" STANDBY_SIGNAL_FILE
+							" --exclude=" RECOVERY_SIGNAL_FILE);
+
+	initUXSQLExpBuffer(&script);
+	appendUXSQLExpBuffer(&script, "rsync %s %s:%s/ %s/",
+						 rsync_flags.data, host_string,
+						 source_data_directory, local_data_directory);
+
+	if (runtime_options.dry_run == true)
+	{
+		log_info(_("would execute:\n  %s"), script.data);
+
+		for (i = 0; i < donor_count; i++)
+		{
+			log_detail(_("relation files would be copied from node \"%s\" (ID: %i), \"%s:%s\""),
+					   donors[i].node_name,
+					   donors[i].source.node_id,
+					   donors[i].source.host,
+					   donors[i].source.path);
+		}
+
+		for (cell = tablespaces.head; cell; cell = cell->next)
+		{
+			log_detail(_("tablespace %s (\"%s\") would also be copied"),
+					   cell->key, cell->value);
+		}
+
+		termUXSQLExpBuffer(&script);
+		goto cleanup_flags;
+	}
+
+	backup_start_lsn = start_nonexclusive_backup(privileged_conn,
+												 "repmgr multi-source clone",
+												 runtime_options.fast_checkpoint);
+
+	if (backup_start_lsn == InvalidXLogRecPtr)
+	{
+		log_hint(_("starting a backup requires superuser permissions or EXECUTE on the backup functions"));
+		termUXSQLExpBuffer(&script);
+		r = ERR_BAD_BASEBACKUP;
+		goto cleanup_flags;
+	}
+
+	backup_started = true;
+	log_notice(_("backup started on the primary at %X/%X"), format_lsn(backup_start_lsn));
+
+	/* if the source node is a standby, its files must be at least as recent as the backup */
+	if (source_conn != primary_conn
+		&& wait_for_clone_donor_replay(source_conn, "source node", backup_start_lsn) == false)
+	{
+		termUXSQLExpBuffer(&script);
+		r = ERR_BAD_BASEBACKUP;
+		goto stop_backup;
+	}
+
+	for (i = 0; i < donor_count;)
+	{
+		if (wait_for_clone_donor_replay(donors[i].conn, donors[i].node_name, backup_start_lsn) == true)
+		{
+			i++;
+			continue;
+		}
+
+		log_warning(_("not copying relation files from node \"%s\" (ID: %i)"),
+					donors[i].node_name, donors[i].source.node_id);
+
+		UXSQLfinish(donors[i].conn);
+		donor_count--;
+		memmove(&donors[i], &donors[i + 1], sizeof(t_clone_donor) * (donor_count - i));
+	}
+
+	log_info(_("executing:\n  %s"), script.data);
+
+	r = ux_system(script.data);
+	termUXSQLExpBuffer(&script);
+
+	/* exit code 24 indicates vanished files, which isn't a problem for us */
+	if (r != 0 && !(WIFEXITED(r) && WEXITSTATUS(r) == 24))
+	{
+		log_error(_("unable to copy the data directory from the source node"));
+		log_detail(_("rsync returned exit status %i"), WEXITSTATUS(r));
+		r = ERR_BAD_RSYNC;
+		goto stop_backup;
+	}
+
+	r = SUCCESS;
+
+	/* the shard lists are kept in the new data directory for the duration of the copy */
+	maxlen_snprintf(local_repmgr_tmp_directory, "%s/repmgr", local_data_directory);
+
+	if (mkdir(local_repmgr_tmp_directory, S_IRWXU) != 0 && errno != EEXIST)
+	{
+		log_error(_("unable to create directory \"%s\""), local_repmgr_tmp_directory);
+		log_detail("%s", strerror(errno));
+		r = ERR_INTERNAL;
+		goto stop_backup;
+	}
+
+	if (copy_relation_files(donors, donor_count, host_string, source_data_directory,
+							local_data_directory, "base global", relation_rsync_flags.data) == false)
+	{
+		r = ERR_BAD_RSYNC;
+	}
+
+	for (cell = tablespaces.head; r == SUCCESS && cell; cell = cell->next)
+	{
+		/*
+		 * Tablespaces are at the same location on all nodes, as
+		 * "tablespace_mapping" isn't supported here. Everything below the
+		 * tablespace's version directory is either a relation file or a
+		 * database directory.
+		 */
+		initUXSQLExpBuffer(&script);
+		appendUXSQLExpBuffer(&script, "rsync %s --exclude=/*/*/[0-9]* %s:%s/ %s/",
+							 rsync_flags.data, host_string,
+							 cell->value, cell->value);
+
+		log_info(_("copying tablespace %s:\n  %s"), cell->key, script.data);
+
+		r = ux_system(script.data);
+		termUXSQLExpBuffer(&script);
+
+		if (r != 0 && !(WIFEXITED(r) && WEXITSTATUS(r) == 24))
+		{
+			log_error(_("unable to copy tablespace \"%s\" from the source node"), cell->value);
+			log_detail(_("rsync returned exit status %i"), WEXITSTATUS(r));
+			r = ERR_BAD_RSYNC;
+			break;
+		}
+
+		r = SUCCESS;
+
+		for (i = 0; i < donor_count; i++)
+			snprintf(donors[i].source.path, sizeof(donors[i].source.path), "%s", cell->value);
+
+		if (copy_relation_files(donors, donor_count, host_string, cell->value,
+								cell->value, ".", relation_rsync_flags.data) == false)
+		{
+			r = ERR_BAD_RSYNC;
+		}
+	}
+
+	(void) rmdir_recursive(local_repmgr_tmp_directory);
+
+	/* ux_control is excluded from the main copy and copied last */
+	if (r == SUCCESS)
+	{
+		initUXSQLExpBuffer(&script);
+		appendUXSQLExpBuffer(&script, "rsync --archive %s:%s/global/ux_control %s/global/ux_control",
+							 host_string, source_data_directory, local_data_directory);
+		log_verbose(LOG_DEBUG, "run_multi_source_clone():\n  %s", script.data);
+
+		if (ux_system(script.data) != 0)
+		{
+			log_error(_("unable to copy \"global/ux_control\" from the source node"));
+			r = ERR_BAD_RSYNC;
+		}
+
+		termUXSQLExpBuffer(&script);
+	}
+
+	if (r == SUCCESS)
+	{
+		maxlen_snprintf(path, "%s/%s/archive_status", local_data_directory, wal_directory);
+		if (mkdir(path, S_IRWXU) != 0 && errno != EEXIST)
+		{
+			log_error(_("unable to create directory \"%s\""), path);
+			log_detail("%s", strerror(errno));
+			r = ERR_INTERNAL;
+		}
+	}
+
+stop_backup:
+	initUXSQLExpBuffer(&label_file);
+	initUXSQLExpBuffer(&tablespace_map);
+
+	if (backup_started == true
+		&& stop_nonexclusive_backup(privileged_conn, &label_file, &tablespace_map) == false)
+	{
+		if (r == SUCCESS)
+			r = ERR_BAD_BASEBACKUP;
+	}
+	else if (r == SUCCESS)
+	{
+		if (write_backup_label_files(&label_file, &tablespace_map) == false)
+			r = ERR_BAD_BASEBACKUP;
+	}
+
+	termUXSQLExpBuffer(&label_file);
+	termUXSQLExpBuffer(&tablespace_map);
+
+	if (r == SUCCESS)
+	{
+		/* check connections are still available */
+		(void) connection_ping_reconnect(primary_conn);
+
+		if (source_conn != primary_conn)
+			(void) connection_ping_reconnect(source_conn);
+
+		move_replication_slot_to_upstream(node_record);
+	}
+
+cleanup_flags:
+	termUXSQLExpBuffer(&rsync_flags);
+	termUXSQLExpBuffer(&relation_rsync_flags);
+
+cleanup:
+	key_value_list_free(&tablespaces);
+
+	for (i = 0; i < donor_count; i++)
+		UXSQLfinish(donors[i].conn);
+
+	if (donors != NULL)
+		pfree(donors);
+
+	if (superuser_conn != NULL)
+		UXSQLfinish(superuser_conn);
+
+	return r;
+}
+
+
+/*
+ * Find the standbys which can provide relation files for
+ * "standby clone --multi-source": active nodes in recovery with the same
+ * system identifier as the primary, reachable via SSH, and whose data
+ * directory we can determine.
+ *
+ * Returns the number of donors found; connections to them are left open
+ * and must be closed by the caller.
+ */
+static int
+get_clone_donors(uint64 primary_system_identifier, t_clone_donor **donors)
+{
+	NodeInfoList all_nodes = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoListCell *cell = NULL;
+	int			donor_count = 0;
+
+	*donors = NULL;
+
+	if (get_all_node_records(primary_conn, &all_nodes) == false)
+	{
+		log_warning(_("unable to retrieve the node records"));
+		return 0;
+	}
+
+	*donors = ux_malloc0(sizeof(t_clone_donor) * (all_nodes.node_count > 0 ? all_nodes.node_count : 1));
+
+	for (cell = all_nodes.head; cell; cell = cell->next)
+	{
+		t_node_info *node_info = cell->node_info;
+		t_clone_donor *donor = &(*donors)[donor_count];
+		char		host[MAXLEN] = "";
+		UXconn	   *conn = NULL;
+
+		if (node_info->type != STANDBY || node_info->active == false)
+			continue;
+
+		if (node_info->node_id == config_file_options.node_id)
+			continue;
+
+		if (get_conninfo_value(node_info->conninfo, "host", host) == false || host[0] == '\0')
+		{
+			log_verbose(LOG_INFO, _("node \"%s\" (ID: %i) has no host in its conninfo, skipping"),
+						node_info->node_name, node_info->node_id);
+			continue;
+		}
+
+		conn = establish_db_connection_quiet(node_info->conninfo);
+
+		if (UXSQLstatus(conn) != CONNECTION_OK)
+		{
+			log_warning(_("unable to connect to node \"%s\" (ID: %i), not using it as a clone source"),
+						node_info->node_name, node_info->node_id);
+			UXSQLfinish(conn);
+			continue;
+		}
+
+		if (get_recovery_type(conn) != RECTYPE_STANDBY
+			|| system_identifier(conn) != primary_system_identifier)
+		{
+			log_warning(_("node \"%s\" (ID: %i) is not a standby of this cluster, not using it as a clone source"),
+						node_info->node_name, node_info->node_id);
+			UXSQLfinish(conn);
+			continue;
+		}
+
+		if (get_ux_setting(conn, "data_directory", donor->source.path) == false
+			|| donor->source.path[0] == '\0')
+		{
+			log_warning(_("unable to determine the data directory of node \"%s\" (ID: %i), not using it as a clone source"),
+						node_info->node_name, node_info->node_id);
+			UXSQLfinish(conn);
+			continue;
+		}
+
+		if (test_ssh_connection(host, runtime_options.remote_user) != 0)
+		{
+			log_warning(_("node \"%s\" (ID: %i) is not reachable via SSH, not using it as a clone source"),
+						node_info->node_name, node_info->node_id);
+			UXSQLfinish(conn);
+			continue;
+		}
+
+		donor->conn = conn;
+		donor->source.node_id = node_info->node_id;
+		snprintf(donor->node_name, sizeof(donor->node_name), "%s", node_info->node_name);
+
+		if (runtime_options.remote_user[0] != '\0')
+			snprintf(donor->source.host, sizeof(donor->source.host), "%s@%s", runtime_options.remote_user, host);
+		else
+			snprintf(donor->source.host, sizeof(donor->source.host), "%s", host);
+
+		log_info(_("relation files will be copied from node \"%s\" (ID: %i)"),
+				 node_info->node_name, node_info->node_id);
+
+		donor_count++;
+	}
+
+	clear_node_info_list(&all_nodes);
+
+	return donor_count;
+}
+
+
+/*
+ * Wait until the node has replayed WAL up to the backup's starting point,
+ * so none of its files predate it.
+ */
+static bool
+wait_for_clone_donor_replay(UXconn *conn, const char *node_name, XLogRecPtr backup_start_lsn)
+{
+	int			i;
+
+	for (i = 0; i < MULTI_SOURCE_CATCHUP_TIMEOUT; i++)
+	{
+		ReplInfo	replication_info;
+
+		init_replication_info(&replication_info);
+
+		if (get_replication_info(conn, STANDBY, &replication_info) == false)
+			return false;
+
+		if (replication_info.last_wal_replay_lsn >= backup_start_lsn)
+		{
+			log_verbose(LOG_DEBUG, "wait_for_clone_donor_replay(): \"%s\" has replayed to %X/%X",
+						node_name, format_lsn(replication_info.last_wal_replay_lsn));
+			return true;
+		}
+
+		if (i == 0)
+		{
+			log_info(_("waiting for \"%s\" to replay WAL up to %X/%X"),
+					 node_name, format_lsn(backup_start_lsn));
+		}
+
+		sleep(1);
+	}
+
+	log_warning(_("\"%s\" did not replay WAL up to %X/%X within %i seconds"),
+				node_name, format_lsn(backup_start_lsn), MULTI_SOURCE_CATCHUP_TIMEOUT);
+
+	return false;
+}
+
+
+/*
+ * Copy the relation files below "subdirs" of "source_path" on the source
+ * node, as listed there, from the donors; if there are none, they're copied
+ * from the source node itself.
+ */
+static bool
+copy_relation_files(t_clone_donor *donors, int donor_count, const char *source_host,
+					const char *source_path, const char *local_path, const char *subdirs,
+					const char *rsync_flags)
+{
+	t_copy_file_list list = T_COPY_FILE_LIST_INITIALIZER;
+	t_copy_source *sources = NULL;
+	bool		success;
+	int			i;
+
+	if (get_remote_file_list(source_host, source_path, subdirs, "[0-9]*", &list) == false)
+		return false;
+
+	if (donor_count > 0)
+	{
+		sources = ux_malloc0(sizeof(t_copy_source) * donor_count);
+
+		for (i = 0; i < donor_count; i++)
+			sources[i] = donors[i].source;
+	}
+	else
+	{
+		sources = ux_malloc0(sizeof(t_copy_source));
+		sources[0].node_id = upstream_node_id;
+		snprintf(sources[0].host, sizeof(sources[0].host), "%s", source_host);
+		snprintf(sources[0].path, sizeof(sources[0].path), "%s", source_path);
+		donor_count = 1;
+	}
+
+	success = multi_source_copy_files(sources, donor_count, local_path, &list,
+									  config_file_options.clone_parallel_workers,
+									  rsync_flags, local_repmgr_tmp_directory);
+
+	copy_file_list_free(&list);
+	pfree(sources);
+
+	return success;
+}
+
+
+/*
+ * Perform a filesystem backup using rsync.
+ *
+ * From repmgr 4 this is only used for Barman backups.
+ */
+static int
+run_file_backup(t_node_info *local_node_record)
+{
+	int			r = SUCCESS,
+				i;
+
+	char		command[MAXLEN] = "";
+	char		filename[MAXLEN] = "";
+	char		buf[MAXLEN] = "";
+	char		basebackups_directory[MAXLEN] = "";
+	char		backup_id[MAXLEN] = "";
+	TablespaceDataList tablespace_list = {NULL, NULL};
+	TablespaceDataListCell *cell_t = NULL;
+
+	UXSQLExpBufferData tablespace_map;
+	bool		tablespace_map_rewrite = false;
+
+	/* For the foreseeable future, no other modes are supported */
+	Assert(mode == barman);
+	if (mode == barman)
+	{
+		t_basebackup_options backup_options = T_BASEBACKUP_OPTIONS_INITIALIZER;
+
+		/*
+		 * Locate Barman's base backups directory
+		 */
+
+		get_barman_property(basebackups_directory, "basebackups_directory", local_repmgr_tmp_directory);
+
+		/*
+		 * Read the list of backup files into a local file. In the process:
+		 *
+		 * - determine the backup ID
+		 * - check, and remove, the prefix
+		 * - detect tablespaces
+		 * - filter files in one list per tablespace
+		 */
+		{
+			FILE	   *fi;		/* input stream */
+			FILE	   *fd;		/* output for data.txt */
+			char		prefix[MAXLEN] = "";
+			char		output[MAXLEN] = "";
+			int			n = 0;
+			char	   *p = NULL,
+					   *q = NULL;
 
 			maxlen_snprintf(command, "%s list-files --target=data %s latest",
 							make_barman_ssh_command(barman_command_buf),
@@ -7742,17 +8961,9 @@ run_file_backup(t_node_info *local_node_record)
 		/*
 		 * Copy all backup files from the Barman server
 		 */
-		maxlen_snprintf(command,
-						"rsync --progress -a --files-from=%s %s:%s/%s/data %s",
-						datadir_list_filename,
-						config_file_options.barman_host,
-						basebackups_directory,
-						backup_id,
-						local_data_directory);
-
-		(void) local_command(
-							 command,
-							 NULL);
+		maxlen_snprintf(buf, "%s/%s/data", basebackups_directory, backup_id);
+
+		copy_barman_files(datadir_list_filename, buf, local_data_directory);
 
 		unlink(datadir_list_filename);
 
@@ -7923,21 +9134,17 @@ run_file_backup(t_node_info *local_node_record)
 				/* close the file to ensure the contents are flushed to disk */
 				fclose(cell_t->fptr);
 
-				maxlen_snprintf(command,
-								"rsync --progress -a --files-from=%s/%s.txt %s:%s/%s/%s %s",
-								local_repmgr_tmp_directory,
-								cell_t->oid,
-								config_file_options.barman_host,
-								basebackups_directory,
-								backup_id,
-								cell_t->oid,
-								tblspc_dir_dest);
-				(void) local_command(command,
-									 NULL);
 				maxlen_snprintf(filename,
 								"%s/%s.txt",
 								local_repmgr_tmp_directory,
 								cell_t->oid);
+				maxlen_snprintf(buf, "%s/%s/%s",
+								basebackups_directory,
+								backup_id,
+								cell_t->oid);
+
+				copy_barman_files(filename, buf, tblspc_dir_dest);
+
 				unlink(filename);
 			}
 		}
@@ -8174,10 +9381,7 @@ run_ux_backupapi(t_node_info *local_node_record)
 {
 	int r = ERR_UXBACKUPAPI_SERVICE;
 	long http_return_code = 0;
-	short seconds_to_sleep = 3;
 	operation_task *task = malloc(sizeof(operation_task));
-	CURL *curl = curl_easy_init();
-	CURLcode ret;
 
 	check_ux_backupapi_standby_clone_options();
 
@@ -8188,8 +9392,8 @@ run_ux_backupapi(t_node_info *local_node_record)
 	task->backup_id = malloc(strlen(config_file_options.ux_backupapi_backup_id)+1);
 	task->destination_directory = malloc(strlen(local_data_directory)+1);
 
-	task->operation_id = malloc(MAX_BUFFER_LENGTH);
-	task->operation_status = malloc(MAX_BUFFER_LENGTH);
+	task->operation_id = NULL;
+	task->operation_status = NULL;
 
 	strcpy(task->host, config_file_options.ux_backupapi_host);
 	strcpy(task->remote_ssh_command, config_file_options.ux_backupapi_remote_ssh_command);
@@ -8197,49 +9401,26 @@ run_ux_backupapi(t_node_info *local_node_record)
 	strcpy(task->operation_type, DEFAULT_STANDBY_UX_BACKUPAPI_OP_TYPE);
 	strcpy(task->backup_id, config_file_options.ux_backupapi_backup_id);
 	strcpy(task->destination_directory, local_data_directory);
-	strcpy(task->operation_id, "\0");
 
-	ret = create_new_task(curl, task);
-
-	if ((ret != CURLE_OK) || (strlen(task->operation_id) == 0)) {
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_return_code);
+	if (create_new_task(task, &http_return_code) == false)
+	{
 		if (499 > http_return_code && http_return_code >= 400) {
 			log_error("Cannot find backup '%s' for node '%s'.", task->backup_id, task->node_name);
 		} else {
-			log_error("whilst reaching out ux_backup service: %s\n", curl_easy_strerror(ret));
-		}
+			log_error("whilst reaching out ux_backup service");
 		}
+	}
 	else
 	{
 		log_info("Success creating the task: operation id '%s'", task->operation_id);
 
-		//We call init again because previous call included POST calls
-		curl_easy_cleanup(curl);
-		curl = curl_easy_init();
-		while (true)
-		{
-			ret = get_status_of_operation(curl, task);
-			if (strlen(task->operation_status) == 0) {
-				log_info("Retrying...");
-			}
-			else
-			{
-				log_info("status %s", task->operation_status);
-			}
-			if (strcmp(task->operation_status, "FAILED") == 0) {
-				break;
-			}
-			if (strcmp(task->operation_status, "DONE") == 0) {
-				r = SUCCESS;
-				break;
-			}
-
-			sleep(seconds_to_sleep);
-		}
+		if (wait_for_operations(&task, 1) == 1)
+			r = SUCCESS;
 	}
 
-	curl_easy_cleanup(curl);
-	free(task);
+	free_operation_task(task);
+	ux_backupapi_client_cleanup();
+
 	return r;
 }
 
@@ -8390,6 +9571,67 @@ get_barman_property(char *dst, char *name, char *local_repmgr_directory)
 }
 
 
+/*
+ * Copy the files listed in "file_list" from "remote_path" on the Barman
+ * server to "local_path".
+ *
+ * With "clone_parallel_workers" > 1 the list is split into size-balanced
+ * shards which are transferred by concurrent rsync processes; otherwise,
+ * or if the file list can't be read, a single rsync is executed as before.
+ */
+static void
+copy_barman_files(const char *file_list, const char *remote_path, const char *local_path)
+{
+	char		command[MAXLEN] = "";
+
+	if (config_file_options.clone_parallel_workers > 1)
+	{
+		t_copy_file_list list = T_COPY_FILE_LIST_INITIALIZER;
+
+		if (copy_file_list_load(&list, file_list) == true)
+		{
+			bool		success;
+
+			if (get_remote_file_sizes(config_file_options.barman_host, remote_path, &list) == false)
+			{
+				log_detail(_("files will be distributed between copy workers by number rather than size"));
+			}
+
+			success = parallel_copy_files(config_file_options.barman_host,
+										  remote_path,
+										  local_path,
+										  &list,
+										  config_file_options.clone_parallel_workers,
+										  "-a",
+										  local_repmgr_tmp_directory);
+			copy_file_list_free(&list);
+
+			if (success == false)
+			{
+				log_error(_("unable to copy files from Barman server \"%s\""),
+						  config_file_options.barman_host);
+				log_hint(_("see preceding messages for details"));
+				exit(ERR_BAD_RSYNC);
+			}
+
+			return;
+		}
+
+		log_warning(_("falling back to a single rsync process"));
+	}
+
+	maxlen_snprintf(command,
+					"rsync --progress -a --files-from=%s %s:%s %s",
+					file_list,
+					config_file_options.barman_host,
+					remote_path,
+					local_path);
+
+	(void) local_command(command,
+						 NULL);
+}
+
+
 static void
 copy_configuration_files(bool delete_after_copy)
 {
@@ -9103,20 +10345,30 @@ check_free_slots(t_node_info *local_node_record, SiblingNodeStats *sibling_nodes
 static void
 sibling_nodes_follow(t_node_info *local_node_record, NodeInfoList *sibling_nodes, SiblingNodeStats *sibling_nodes_stats)
 {
-	int			failed_follow_count = 0;
 	char		host[MAXLEN] = "";
 	NodeInfoListCell *cell = NULL;
 	UXSQLExpBufferData remote_command_str;
 	UXSQLExpBufferData command_output;
+	t_parallel_command *tasks = NULL;
+	t_node_info **task_nodes = NULL;
+	int			task_count = 0;
+	t_node_info **serial_nodes = NULL;
+	char	  **serial_commands = NULL;
+	int			serial_count = 0;
+	int			i;
+	instr_time	follow_start;
 
 	log_notice(_("executing STANDBY FOLLOW on %i of %i siblings"),
 			   sibling_nodes->node_count - sibling_nodes_stats->unreachable_sibling_node_count,
 			   sibling_nodes->node_count);
 
+	tasks = (t_parallel_command *) ux_malloc0(sizeof(t_parallel_command) * sibling_nodes->node_count);
+	task_nodes = (t_node_info **) ux_malloc0(sizeof(t_node_info *) * sibling_nodes->node_count);
+	serial_nodes = (t_node_info **) ux_malloc0(sizeof(t_node_info *) * sibling_nodes->node_count);
+	serial_commands = (char **) ux_malloc0(sizeof(char *) * sibling_nodes->node_count);
+
 	for (cell = sibling_nodes->head; cell; cell = cell->next)
 	{
-		bool		success = false;
-
 		/* skip nodes previously determined as unreachable */
 		if (cell->node_info->reachable == false)
 			continue;
@@ -9154,46 +10406,189 @@ sibling_nodes_follow(t_node_info *local_node_record, NodeInfoList *sibling_nodes
 								 "standby follow 2>/dev/null && echo \"1\" || echo \"0\"");
 		}
 		get_conninfo_value(cell->node_info->conninfo, "host", host);
-		log_debug("executing:\n  %s", remote_command_str.data);
+
+		/*
+		 * Key-based ssh sessions can be run concurrently; queue these and
+		 * execute them below.
+		 */
+		if (cell->node_info->uxdb_passwd[0] == '\0')
+		{
+			UXSQLExpBufferData ssh_command;
+
+			initUXSQLExpBuffer(&ssh_command);
+			make_remote_command(host,
+								runtime_options.remote_user,
+								remote_command_str.data,
+								config_file_options.ssh_options,
+								&ssh_command);
+			termUXSQLExpBuffer(&remote_command_str);
+
+			log_verbose(LOG_DEBUG, "sibling_nodes_follow(): queueing:\n  %s", ssh_command.data);
+
+			tasks[task_count].node_id = cell->node_info->node_id;
+			tasks[task_count].command = ssh_command.data;
+			task_nodes[task_count] = cell->node_info;
+			task_count++;
+
+			continue;
+		}
+
+		/*
+		 * Password-based ssh sessions need an interactive terminal, so must
+		 * be executed one at a time; this is done once the others have been
+		 * redirected, so they aren't held up by these.
+		 */
+		serial_nodes[serial_count] = cell->node_info;
+		serial_commands[serial_count] = remote_command_str.data;
+		serial_count++;
+	}
+
+	/*
+	 * "sibling_follow_timeout" covers all siblings, including any which
+	 * must be redirected one at a time once the concurrent ones are done.
+	 */
+	INSTR_TIME_SET_CURRENT(follow_start);
+
+	/*
+	 * Redirect the siblings with key-based access concurrently, so the last
+	 * of these rejoins at roughly the time of the slowest one rather than
+	 * after the sum of all of them.
+	 */
+	if (task_count > 0)
+	{
+		log_verbose(LOG_INFO, _("executing STANDBY FOLLOW on %i sibling(s) via SSH (maximum %i concurrently)"),
+					task_count, config_file_options.sibling_follow_parallel);
+
+		(void) run_parallel_commands(tasks,
+									 task_count,
+									 config_file_options.sibling_follow_parallel,
+									 0,
+									 config_file_options.sibling_follow_timeout);
+	}
+
+	for (i = 0; i < task_count; i++)
+	{
+		t_node_info *node_info = task_nodes[i];
+
+		pfree(tasks[i].command);
+
+		if (tasks[i].status == PCMD_COMPLETED && tasks[i].output.data[0] == '1')
+		{
+			log_verbose(LOG_DEBUG, "sibling_nodes_follow(): node \"%s\" completed after %i ms",
+						node_info->node_name, tasks[i].elapsed_ms);
+			sibling_nodes_stats->followed_sibling_node_count++;
+			continue;
+		}
+
+		if (tasks[i].status == PCMD_TIMED_OUT)
+		{
+			log_warning(_("node \"%s\" did not follow the new primary within %i seconds (\"sibling_follow_timeout\")"),
+						node_info->node_name,
+						config_file_options.sibling_follow_timeout);
+			sibling_nodes_stats->timed_out_follow_sibling_node_count++;
+		}
+		else if (node_info->type == WITNESS)
+		{
+			log_warning(_("WITNESS REGISTER failed on node \"%s\""),
+						node_info->node_name);
+		}
+		else
+		{
+			log_warning(_("STANDBY FOLLOW failed on node \"%s\""),
+						node_info->node_name);
+		}
+
+		sibling_nodes_stats->failed_follow_sibling_node_count++;
+	}
+
+	clear_parallel_commands(tasks, task_count);
+	pfree(tasks);
+	pfree(task_nodes);
+
+	for (i = 0; i < serial_count; i++)
+	{
+		t_node_info *node_info = serial_nodes[i];
+		bool		success = false;
+		instr_time	follow_elapsed;
+		int			remaining_ms;
+
+		INSTR_TIME_SET_CURRENT(follow_elapsed);
+		INSTR_TIME_SUBTRACT(follow_elapsed, follow_start);
+		remaining_ms = (config_file_options.sibling_follow_timeout * 1000) - (int) INSTR_TIME_GET_MILLISEC(follow_elapsed);
+
+		if (remaining_ms <= 0)
+		{
+			log_warning(_("node \"%s\" did not follow the new primary within %i seconds (\"sibling_follow_timeout\")"),
+						node_info->node_name,
+						config_file_options.sibling_follow_timeout);
+			sibling_nodes_stats->timed_out_follow_sibling_node_count++;
+			sibling_nodes_stats->failed_follow_sibling_node_count++;
+
+			pfree(serial_commands[i]);
+			continue;
+		}
+
+		get_conninfo_value(node_info->conninfo, "host", host);
+
+		log_debug("executing:\n  %s", serial_commands[i]);
 
 		initUXSQLExpBuffer(&command_output);
 
-		success = remote_command(host,
-								 runtime_options.remote_user,
-								 remote_command_str.data,
-								 config_file_options.ssh_options,
-								 &command_output,
-								 cell->node_info->uxdb_passwd);
+		success = remote_command_timeout(host,
+										 runtime_options.remote_user,
+										 serial_commands[i],
+										 config_file_options.ssh_options,
+										 &command_output,
+										 node_info->uxdb_passwd,
+										 remaining_ms);
 
-		termUXSQLExpBuffer(&remote_command_str);
+		pfree(serial_commands[i]);
 
 		if (success == false || command_output.data[0] == '0')
 		{
-			if (cell->node_info->type == WITNESS)
+			INSTR_TIME_SET_CURRENT(follow_elapsed);
+			INSTR_TIME_SUBTRACT(follow_elapsed, follow_start);
+
+			if (success == false &&
+				(int) INSTR_TIME_GET_MILLISEC(follow_elapsed) >= config_file_options.sibling_follow_timeout * 1000)
+			{
+				log_warning(_("node \"%s\" did not follow the new primary within %i seconds (\"sibling_follow_timeout\")"),
+							node_info->node_name,
+							config_file_options.sibling_follow_timeout);
+				sibling_nodes_stats->timed_out_follow_sibling_node_count++;
+			}
+			else if (node_info->type == WITNESS)
 			{
 				log_warning(_("WITNESS REGISTER failed on node \"%s\""),
-							cell->node_info->node_name);
+							node_info->node_name);
 			}
 			else
 			{
 				log_warning(_("STANDBY FOLLOW failed on node \"%s\""),
-							cell->node_info->node_name);
+							node_info->node_name);
 			}
 
-			failed_follow_count++;
+			sibling_nodes_stats->failed_follow_sibling_node_count++;
+		}
+		else
+		{
+			sibling_nodes_stats->followed_sibling_node_count++;
 		}
 
 		termUXSQLExpBuffer(&command_output);
 	}
 
-	if (failed_follow_count == 0)
+	pfree(serial_nodes);
+	pfree(serial_commands);
+
+	if (sibling_nodes_stats->failed_follow_sibling_node_count == 0)
 	{
 		log_info(_("STANDBY FOLLOW successfully executed on all reachable sibling nodes"));
 	}
 	else
 	{
 		log_warning(_("execution of STANDBY FOLLOW failed on %i sibling nodes"),
-					failed_follow_count);
+					sibling_nodes_stats->failed_follow_sibling_node_count);
 	}
 
 	/*
@@ -9563,6 +10958,125 @@ parse_replication_config_owner(const char *node_check_output)
 }
 
 
+/*
+ * Execute "repmgr node check --batch" on the remote node, storing its
+ * output in "batch_output"; the output of each check is preceded by a
+ * NODE_CHECK_BATCH_TAG line, and is extracted by get_batch_check_output().
+ *
+ * If the remote repmgr does not support "--batch", "batch_output" will
+ * contain no tagged output and remote_node_check() will execute each
+ * check individually.
+ */
+static void
+run_remote_node_check_batch(const char *remote_host, t_node_info *remote_node_record, int local_node_id, const char *checks, UXSQLExpBufferData *batch_output)
+{
+	UXSQLExpBufferData remote_command_str;
+	bool		success = false;
+
+	initUXSQLExpBuffer(&remote_command_str);
+	make_remote_repmgr_path(&remote_command_str, remote_node_record);
+	appendUXSQLExpBuffer(&remote_command_str,
+						 "node check --batch=%s --remote-node-id=%i --optformat -LINFO 2>/dev/null",
+						 checks,
+						 local_node_id);
+
+	success = remote_command(remote_host,
+							 runtime_options.remote_user,
+							 remote_command_str.data,
+							 config_file_options.ssh_options,
+							 batch_output,
+							 remote_node_record->uxdb_passwd);
+
+	termUXSQLExpBuffer(&remote_command_str);
+
+	if (success == false)
+	{
+		resetUXSQLExpBuffer(batch_output);
+		return;
+	}
+
+	log_verbose(LOG_DEBUG, "run_remote_node_check_batch(): output is \"%s\"", batch_output->data);
+}
+
+
+/*
+ * Extract the output of "check_name" from the output of "node check --batch",
+ * with lines separated by a space, so it can be passed directly to the
+ * respective parse_*() function.
+ *
+ * Returns false if the batch output does not include the check.
+ */
+static bool
+get_batch_check_output(const char *batch_output, const char *check_name, UXSQLExpBufferData *output)
+{
+	UXSQLExpBufferData tag;
+	const char *start = NULL;
+	const char *p = NULL;
+	size_t		tag_prefix_len = strlen(NODE_CHECK_BATCH_TAG);
+
+	initUXSQLExpBuffer(&tag);
+	appendUXSQLExpBuffer(&tag, "%s%s\n", NODE_CHECK_BATCH_TAG, check_name);
+
+	/* the tag must occupy an entire line */
+	for (p = strstr(batch_output, tag.data); p != NULL; p = strstr(p + 1, tag.data))
+	{
+		if (p == batch_output || *(p - 1) == '\n')
+		{
+			start = p + tag.len;
+			break;
+		}
+	}
+
+	termUXSQLExpBuffer(&tag);
+
+	if (start == NULL)
+		return false;
+
+	/* the check's output runs up to the next tag line */
+	for (p = start; *p != '\0'; p++)
+	{
+		if ((p == start || *(p - 1) == '\n') &&
+			strncmp(p, NODE_CHECK_BATCH_TAG, tag_prefix_len) == 0)
+			break;
+
+		appendUXSQLExpBufferChar(output, *p == '\n' ? ' ' : *p);
+	}
+
+	return true;
+}
+
+
+/*
+ * Obtain the output of "repmgr node check <options>" on the remote node,
+ * from the batch output if it includes "check_name", otherwise by executing
+ * the check remotely.
+ */
+static bool
+remote_node_check(const char *remote_host, t_node_info *remote_node_record, const char *options, const char *batch_output, const char *check_name, UXSQLExpBufferData *command_output)
+{
+	UXSQLExpBufferData remote_command_str;
+	bool		success = false;
+
+	if (batch_output != NULL && get_batch_check_output(batch_output, check_name, command_output) == true)
+		return true;
+
+	initUXSQLExpBuffer(&remote_command_str);
+	make_remote_repmgr_path(&remote_command_str, remote_node_record);
+	appendUXSQLExpBuffer(&remote_command_str, "node check %s", options);
+
+	success = remote_command(remote_host,
+							 runtime_options.remote_user,
+							 remote_command_str.data,
+							 config_file_options.ssh_options,
+							 command_output,
+							 remote_node_record->uxdb_passwd);
+
+	termUXSQLExpBuffer(&remote_command_str);
+
+	return success;
+}
+
+
 static CheckStatus
 parse_db_connection(const char *db_connection)
 {
@@ -9640,6 +11154,8 @@ do_standby_help(void)
 			 "                                        data directory to the same path on the standby (default) or to the\n" \
 			 "                                        UXsinoDB data directory\n"));
 	printf(_("  --dry-run                           perform checks but don't actually clone the standby\n"));
+	printf(_("  --incremental                       update an existing data directory, copying only changed blocks\n"));
+	printf(_("  --multi-source                      copy relation files from all available standbys in parallel\n"));
 	printf(_("  --no-upstream-connection            when using Barman, do not connect to upstream node\n"));
 	printf(_("  -R, --remote-user=USERNAME          database server username for SSH operations (default: \"%s\")\n"), runtime_options.username);
 	printf(_("  --replication-user                  user to make replication connections with (optional, not usually required)\n"));
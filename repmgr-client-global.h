@@ -29,6 +29,9 @@
 /* default value for "cluster event --limit"*/
 #define CLUSTER_EVENT_LIMIT 20
 
+/* line preceding the output of each check executed by "node check --batch" */
+#define NODE_CHECK_BATCH_TAG "--batch-check="
+
 
 
 typedef struct
@@ -91,6 +94,8 @@ typedef struct
 	bool		without_barman;
 	bool		replication_conf_only;
 	bool		verify_backup;
+	bool		incremental;
+	bool		multi_source;
 
 	/* "standby clone"/"standby follow" options */
 	int			upstream_node_id;
@@ -110,6 +115,7 @@ typedef struct
 
 	/* "node status" options */
 	bool		is_shutdown_cleanly;
+	int			wait_shutdown;
 
 	/* "node check" options */
 	bool		archive_ready;
@@ -125,6 +131,7 @@ typedef struct
 	bool		data_directory_config;
 	bool		replication_config_owner;
 	bool		db_connection;
+	char		batch_checks[MAXLEN];
 
 	/* "node rejoin" options */
 	char		config_files[MAXLEN];
@@ -139,6 +146,8 @@ typedef struct
 	bool		all;
 	char		event[MAXLEN];
 	int			limit;
+	char		after[MAXLEN];
+	char		before[MAXLEN];
 
 	/* "cluster cleanup" options */
 	int			keep_history;
@@ -167,7 +176,7 @@ typedef struct
 		UNKNOWN_NODE_ID, "", "", UNKNOWN_NODE_ID, \
 		/* "standby clone" options */ \
 		false, CONFIG_FILE_SAMEPATH, false, false, false, "", "", "", \
-		false, false, false, \
+		false, false, false, false, false, \
 		/* "standby clone"/"standby follow" options */ \
 		NO_UPSTREAM_NODE, \
 		/* "standby register" options */ \
@@ -175,15 +184,15 @@ typedef struct
 		/* "standby switchover" options */ \
 		false, false, "", false, false, false,	\
 		/* "node status" options */ \
-		false, \
+		false, 0, \
 		/* "node check" options */ \
-		false, false, false, false, false, false, false, false,	false, false, false, false, false, \
+		false, false, false, false, false, false, false, false,	false, false, false, false, false, "", \
 		/* "node rejoin" options */ \
 		"", \
 		/* "node service" options */ \
 		"", false, false, false,  \
 		/* "cluster event" options */ \
-		false, "", CLUSTER_EVENT_LIMIT,	\
+		false, "", CLUSTER_EVENT_LIMIT, "", "", \
 		/* "cluster cleanup" options */ \
 		0, \
 		/* following options for internal use */ \
@@ -263,6 +272,7 @@ extern int	test_ssh_connection(char *host, char *remote_user);
 
 extern standy_clone_mode get_standby_clone_mode(void);
 
+extern void append_rsync_data_directory_excludes(UXSQLExpBufferData *rsync_flags, int server_version_num);
 extern int copy_remote_files(char *host, char *remote_user, char *remote_path,
 				  char *local_path, bool is_directory, int server_version_num);
 
@@ -290,8 +300,8 @@ extern bool can_use_ux_rewind(UXconn *conn, const char *data_directory, UXSQLExp
 extern void make_standby_signal_path(const char *data_dir, char *buf);
 extern bool write_standby_signal(const char *data_dir);
 
-extern bool create_replication_slot(UXconn *conn, char *slot_name, t_node_info *upstream_node_record, UXSQLExpBufferData *error_msg);
-extern bool drop_replication_slot_if_exists(UXconn *conn, int node_id, char *slot_name);
+extern bool create_replication_slot(UXconn *conn, const char *slot_name, t_node_info *upstream_node_record, UXSQLExpBufferData *error_msg);
+extern bool drop_replication_slot_if_exists(UXconn *conn, int node_id, const char *slot_name);
 
 extern standy_join_status check_standby_join(UXconn *primary_conn, t_node_info *primary_node_record, t_node_info *standby_node_record);
 extern bool check_replication_slots_available(int node_id, UXconn* conn);
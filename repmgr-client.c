@@ -467,6 +467,16 @@ main(int argc, char **argv)
 				runtime_options.verify_backup = true;
 				break;
 
+				/* --incremental */
+			case OPT_INCREMENTAL:
+				runtime_options.incremental = true;
+				break;
+
+				/* --multi-source */
+			case OPT_MULTI_SOURCE:
+				runtime_options.multi_source = true;
+				break;
+
 				/*---------------------------
 				 * "standby register" options
 				 *---------------------------
@@ -524,6 +534,10 @@ main(int argc, char **argv)
 				runtime_options.is_shutdown_cleanly = true;
 				break;
 
+			case OPT_WAIT_SHUTDOWN:
+				runtime_options.wait_shutdown = repmgr_atoi(optarg, "--wait-shutdown", &cli_errors, 1);
+				break;
+
 				/*---------------------
 				 * "node check" options
 				 *--------------------
@@ -580,6 +594,10 @@ main(int argc, char **argv)
 				runtime_options.db_connection = true;
 				break;
 
+			case OPT_BATCH:
+				strncpy(runtime_options.batch_checks, optarg, MAXLEN);
+				break;
+
 				/*--------------------
 				 * "node rejoin" options
 				 *--------------------
@@ -629,6 +647,14 @@ main(int argc, char **argv)
 				runtime_options.all = true;
 				break;
 
+			case OPT_AFTER:
+				strncpy(runtime_options.after, optarg, MAXLEN);
+				break;
+
+			case OPT_BEFORE:
+				strncpy(runtime_options.before, optarg, MAXLEN);
+				break;
+
 				/*------------------------
 				 * "cluster cleanup" options
 				 *------------------------
@@ -1541,6 +1567,18 @@ check_cli_parameters(const int action)
 										 _("-c/--fast-checkpoint has no effect in Barman mode"));
 					}
 
+					if (runtime_options.incremental)
+					{
+						item_list_append(&cli_errors,
+										 _("--incremental cannot be used in Barman mode"));
+					}
+
+					if (runtime_options.multi_source)
+					{
+						item_list_append(&cli_errors,
+										 _("--multi-source cannot be used in Barman mode"));
+					}
+
 
 				}
 				else
@@ -1857,6 +1895,40 @@ check_cli_parameters(const int action)
 		}
 	}
 
+	if (runtime_options.after[0] != '\0' || runtime_options.before[0] != '\0')
+	{
+		switch (action)
+		{
+			case CLUSTER_EVENT:
+				{
+					char		timestamp[MAXLEN];
+					char		event[MAXLEN];
+					int			node_id;
+
+					if (runtime_options.after[0] != '\0' &&
+						parse_event_boundary(runtime_options.after, timestamp, &node_id, event) == false)
+					{
+						item_list_append_format(&cli_errors,
+												_("invalid value provided for --after: \"%s\""),
+												runtime_options.after);
+					}
+
+					if (runtime_options.before[0] != '\0' &&
+						parse_event_boundary(runtime_options.before, timestamp, &node_id, event) == false)
+					{
+						item_list_append_format(&cli_errors,
+												_("invalid value provided for --before: \"%s\""),
+												runtime_options.before);
+					}
+				}
+				break;
+			default:
+				item_list_append_format(&cli_warnings,
+										_("--after/--before not required when executing %s"),
+										action_name(action));
+		}
+	}
+
 	/* --wait/--no-wait */
 
 	if (runtime_options.wait_provided == true && runtime_options.no_wait == true)
@@ -1924,6 +1996,12 @@ check_cli_parameters(const int action)
 		}
 	}
 
+	if (runtime_options.wait_shutdown > 0 && runtime_options.is_shutdown_cleanly == false)
+	{
+		item_list_append(&cli_warnings,
+						 _("--wait-shutdown will be ignored unless --is-shutdown-cleanly is provided"));
+	}
+
 	if (runtime_options.always_promote == true)
 	{
 		switch (action)
@@ -3044,9 +3122,7 @@ test_ssh_connection(char *host, char *remote_user)
 		/* modify by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
 		if (strlen(config_file_options.uxdb_password))
 		{
-			if (pipe(pfd) < 0)  
-				return -1;   /* errno set by pipe() */ 
-			r = runsshpass(config_file_options.uxdb_password, script, command, pfd);
+			r = sshpass_command(config_file_options.uxdb_password, script, NULL, NULL, NULL, 0) ? 0 : 1;
 		}
 		else
 			r = ux_system(script);
@@ -3159,6 +3235,66 @@ make_ux_path(UXSQLExpBufferData *buf, const char *file)
 }
 
 
+/*
+ * Append the rsync "--exclude" options for files and directories in the
+ * data directory which must not be copied from the source node.
+ *
+ * See function 'sendDir()' in 'src/backend/replication/basebackup.c' -
+ * we're basically simulating what ux_basebackup does, but with rsync
+ * rather than the BASEBACKUP replication protocol command.
+ */
+void
+append_rsync_data_directory_excludes(UXSQLExpBufferData *rsync_flags, int server_version_num)
+{
+	/* Files which we don't want */
+	appendUXSQLExpBufferStr(rsync_flags,
+						 " --exclude=uxmaster.pid --exclude=uxmaster.opts --exclude=global/ux_control");
+
+	appendUXSQLExpBufferStr(rsync_flags,
+						 " --exclude=recovery.conf --exclude=recovery.done");
+
+	/*
+	 * Ideally we'd use UX_AUTOCONF_FILENAME from utils/guc.h, but
+	 * that has too many dependencies for a mere client program.
+	 */
+	appendUXSQLExpBuffer(rsync_flags, " --exclude=%s.tmp",
+					  UX_AUTOCONF_FILENAME);
+
+	/* Temporary files which we don't want, if they exist */
+	appendUXSQLExpBuffer(rsync_flags, " --exclude=%s*",
+					  UX_TEMP_FILE_PREFIX);
+
+	/* Directories which we don't want */
+
+	if (server_version_num >= 100000)
+	{
+		appendUXSQLExpBufferStr(rsync_flags,
+							 " --exclude=ux_wal/* --exclude=log/*");
+	}
+	else
+	{
+		appendUXSQLExpBufferStr(rsync_flags,
+							 " --exclude=ux_xlog/* --exclude=ux_log/*");
+	}
+
+	/*
+	 * From UxsinoDB 15, the core server no longer uses ux_stat_tmp,
+	 * but some extensions (e.g. ux_stat_statements) may still do, so
+	 * keep excluding it.
+	 */
+	appendUXSQLExpBufferStr(rsync_flags,
+						 " --exclude=ux_stat_tmp/*");
+
+	/*
+	* #129060 建议repmgr clone实例时排除数据库日志目录log，避免日志混乱
+	*
+	* pg版本升级 ux_log -> log
+	*/
+	appendUXSQLExpBuffer(rsync_flags, "%s",
+					  " --exclude=log/* --exclude=ux_stat_tmp/*");
+}
+
+
 int
 copy_remote_files(char *host, char *remote_user, char *remote_path,
 				  char *local_path, bool is_directory, int server_version_num)
@@ -3172,8 +3308,16 @@ copy_remote_files(char *host, char *remote_user, char *remote_path,
 
 	if (*config_file_options.rsync_options == '\0')
 	{
-		appendUXSQLExpBufferStr(&rsync_flags,
-							 "--archive --checksum --compress --progress --rsh=ssh");
+		/*
+		 * On a fast link checksumming and compression make rsync CPU-bound;
+		 * "--whole-file" also skips the delta-transfer algorithm.
+		 */
+		if (config_file_options.clone_fast_network == true)
+			appendUXSQLExpBufferStr(&rsync_flags,
+								 "--archive --whole-file --progress --rsh=ssh");
+		else
+			appendUXSQLExpBufferStr(&rsync_flags,
+								 "--archive --checksum --compress --progress --rsh=ssh");
 	}
 	else
 	{
@@ -3200,61 +3344,12 @@ copy_remote_files(char *host, char *remote_user, char *remote_path,
 	 * When copying the main UXDATA directory, certain files and contents of
 	 * certain directories need to be excluded.
 	 *
-	 * See function 'sendDir()' in 'src/backend/replication/basebackup.c' -
-	 * we're basically simulating what ux_basebackup does, but with rsync
-	 * rather than the BASEBACKUP replication protocol command.
-	 *
 	 * *However* currently we'll always copy the contents of the 'ux_replslot'
 	 * directory and delete later if appropriate.
 	 */
 	if (is_directory)
 	{
-		/* Files which we don't want */
-		appendUXSQLExpBufferStr(&rsync_flags,
-							 " --exclude=uxmaster.pid --exclude=uxmaster.opts --exclude=global/ux_control");
-
-		appendUXSQLExpBufferStr(&rsync_flags,
-							 " --exclude=recovery.conf --exclude=recovery.done");
-
-		/*
-		 * Ideally we'd use UX_AUTOCONF_FILENAME from utils/guc.h, but
-		 * that has too many dependencies for a mere client program.
-		 */
-		appendUXSQLExpBuffer(&rsync_flags, " --exclude=%s.tmp",
-						  UX_AUTOCONF_FILENAME);
-
-		/* Temporary files which we don't want, if they exist */
-		appendUXSQLExpBuffer(&rsync_flags, " --exclude=%s*",
-						  UX_TEMP_FILE_PREFIX);
-
-		/* Directories which we don't want */
-
-		if (server_version_num >= 100000)
-		{
-			appendUXSQLExpBufferStr(&rsync_flags,
-								 " --exclude=ux_wal/* --exclude=log/*");
-		}
-		else
-		{
-			appendUXSQLExpBufferStr(&rsync_flags,
-								 " --exclude=ux_xlog/* --exclude=ux_log/*");
-		}
-
-		/*
-		 * From UxsinoDB 15, the core server no longer uses ux_stat_tmp,
-		 * but some extensions (e.g. ux_stat_statements) may still do, so
-		 * keep excluding it.
-		 */
-		appendUXSQLExpBufferStr(&rsync_flags,
-							 " --exclude=ux_stat_tmp/*");
-
-		/*
-		* #129060 建议repmgr clone实例时排除数据库日志目录log，避免日志混乱
-		*
-		* pg版本升级 ux_log -> log
-		*/
-		appendUXSQLExpBuffer(&rsync_flags, "%s",
-						  " --exclude=log/* --exclude=ux_stat_tmp/*");
+		append_rsync_data_directory_excludes(&rsync_flags, server_version_num);
 
 		maxlen_snprintf(script, "rsync %s %s:%s/* %s",
 						rsync_flags.data, host_string, remote_path, local_path);
@@ -3652,21 +3747,21 @@ init_node_record(t_node_info *node_record)
 	node_record->active = true;
 
 	if (config_file_options.location[0] != '\0')
-		strncpy(node_record->location, config_file_options.location, MAXLEN);
+		node_record->location = intern_string(config_file_options.location);
 	else
-		strncpy(node_record->location, "default", MAXLEN);
+		node_record->location = "default";
 
 
 	strncpy(node_record->node_name, config_file_options.node_name, sizeof(node_record->node_name));
-	strncpy(node_record->conninfo, config_file_options.conninfo, MAXLEN);
-	strncpy(node_record->config_file, config_file_path, MAXUXPATH);
+	node_record->conninfo = intern_string(config_file_options.conninfo);
+	node_record->config_file = intern_string(config_file_path);
 
 	/* uxdb: init the virtual ip */
-	strncpy(node_record->virtual_ip, config_file_options.virtual_ip, MAXUXPATH);
-	strncpy(node_record->network_card, config_file_options.network_card, MAXUXPATH);
+	node_record->virtual_ip = intern_string(config_file_options.virtual_ip);
+	node_record->network_card = intern_string(config_file_options.network_card);
 	/* add by songjinzhou for #178952 at 2023/03/16 reveiwer houjiaxing. */
-	strncpy(node_record->uxdb_passwd, config_file_options.uxdb_password, MAXUXPATH);
-	strncpy(node_record->root_passwd, config_file_options.root_password, MAXUXPATH);
+	node_record->uxdb_passwd = intern_string(config_file_options.uxdb_password);
+	node_record->root_passwd = intern_string(config_file_options.root_password);
 
 
 	if (config_file_options.replication_user[0] != '\0')
@@ -3685,7 +3780,7 @@ init_node_record(t_node_info *node_record)
 
 	if (config_file_options.use_replication_slots == true)
 	{
-		create_slot_name(node_record->slot_name, config_file_options.node_id);
+		node_record->slot_name = create_slot_name(config_file_options.node_id);
 	}
 }
 
@@ -3800,7 +3895,7 @@ write_standby_signal(const char *data_dir)
  *    set, will be used as the fallback replication user
  */
 bool
-create_replication_slot(UXconn *conn, char *slot_name, t_node_info *upstream_node_record, UXSQLExpBufferData *error_msg)
+create_replication_slot(UXconn *conn, const char *slot_name, t_node_info *upstream_node_record, UXSQLExpBufferData *error_msg)
 {
 	UXconn *slot_conn = NULL;
 	bool use_replication_protocol = false;
@@ -3891,7 +3986,7 @@ create_replication_slot(UXconn *conn, char *slot_name, t_node_info *upstream_nod
 
 
 bool
-drop_replication_slot_if_exists(UXconn *conn, int node_id, char *slot_name)
+drop_replication_slot_if_exists(UXconn *conn, int node_id, const char *slot_name)
 {
 	t_node_info node_record = T_NODE_INFO_INITIALIZER;
 	t_replication_slot slot_info = T_REPLICATION_SLOT_INITIALIZER;
@@ -4440,6 +4535,7 @@ check_node_can_attach(TimeLineID local_tli, XLogRecPtr local_xlogpos, UXconn *fo
 		 * upstream has higher timeline - check where it forked off from this node's timeline
 		 */
 		TimeLineHistoryEntry *follow_target_history = get_timeline_history(follow_target_repl_conn,
+																		   local_system_identifier,
 																		   local_tli + 1);
 
 		if (follow_target_history == NULL)
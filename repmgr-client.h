@@ -104,12 +104,18 @@
 #define OPT_VERIFY_BACKUP				   1048
 #define OPT_RECOVERY_MIN_APPLY_DELAY       1049
 #define OPT_REPMGRD						   1050
+#define OPT_BATCH						   1051
+#define OPT_INCREMENTAL					   1052
+#define OPT_AFTER						   1053
+#define OPT_BEFORE						   1054
+#define OPT_MULTI_SOURCE				   1055
 
 /* These options are for internal use only */
 #define OPT_CONFIG_ARCHIVE_DIR			   2001
 #define OPT_DISABLE_WAL_RECEIVER		   2002
 #define OPT_ENABLE_WAL_RECEIVER			   2003
 #define OPT_DUMP_CONFIG					   2004
+#define OPT_WAIT_SHUTDOWN				   2005
 
 /* deprecated since 4.0 */
 #define OPT_CHECK_UPSTREAM_CONFIG		    999
@@ -169,6 +175,8 @@ static struct option long_options[] =
 	{"without-barman", no_argument, NULL, OPT_WITHOUT_BARMAN},
 	{"replication-conf-only", no_argument, NULL, OPT_REPLICATION_CONF_ONLY},
 	{"verify-backup", no_argument, NULL, OPT_VERIFY_BACKUP },
+	{"incremental", no_argument, NULL, OPT_INCREMENTAL },
+	{"multi-source", no_argument, NULL, OPT_MULTI_SOURCE },
 	{"recovery-min-apply-delay", required_argument, NULL, OPT_RECOVERY_MIN_APPLY_DELAY },
 	/* deprecate this once Ux11 and earlier are unsupported */
 	{"recovery-conf-only", no_argument, NULL, OPT_REPLICATION_CONF_ONLY},
@@ -188,6 +196,7 @@ static struct option long_options[] =
 
 /* "node status" options */
 	{"is-shutdown-cleanly", no_argument, NULL, OPT_IS_SHUTDOWN_CLEANLY},
+	{"wait-shutdown", required_argument, NULL, OPT_WAIT_SHUTDOWN},
 
 /* "node check" options */
 	{"archive-ready", no_argument, NULL, OPT_ARCHIVE_READY},
@@ -203,6 +212,7 @@ static struct option long_options[] =
 	{"data-directory-config", no_argument, NULL, OPT_DATA_DIRECTORY_CONFIG},
 	{"replication-config-owner", no_argument, NULL, OPT_REPLICATION_CONFIG_OWNER},
 	{"db-connection", no_argument, NULL, OPT_DB_CONNECTION},
+	{"batch", required_argument, NULL, OPT_BATCH},
 
 /* "node rejoin" options */
 	{"config-files", required_argument, NULL, OPT_CONFIG_FILES},
@@ -218,6 +228,8 @@ static struct option long_options[] =
 	{"all", no_argument, NULL, OPT_ALL},
 	{"event", required_argument, NULL, OPT_EVENT},
 	{"limit", required_argument, NULL, OPT_LIMIT},
+	{"after", required_argument, NULL, OPT_AFTER},
+	{"before", required_argument, NULL, OPT_BEFORE},
 
 /* "cluster cleanup" options */
 	{"keep-history", required_argument, NULL, 'k'},
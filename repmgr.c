@@ -27,8 +27,14 @@
 
 #include "uxdb.h"
 #include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
 #include "access/xlog.h"
+#if (UX_VERSION_NUM >= 150000)
+#include "access/xlogrecovery.h"
+#endif
 #include "miscadmin.h"
+#include "port/atomics.h"
 #include "replication/walreceiver.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -56,6 +62,18 @@
 #define REPMGRD_STATE_FILE UXSTAT_STAT_PERMANENT_DIRECTORY "/repmgrd_state.txt"
 #define REPMGRD_STATE_FILE_BUF_SIZE 128
 
+/* number of samples retained by repmgr.lag_history() */
+#define LAG_HISTORY_SIZE 3600
+
+/*
+ * seconds after which a count reported by repmgr.set_archive_ready_files()
+ * is considered stale; repmgrd reports it at least twice this often
+ */
+#define ARCHIVE_READY_FILES_MAX_AGE 120
+
+/* number of nodes whose state a witness repmgrd can record */
+#define CLUSTER_VIEW_SIZE 64
+
 UX_MODULE_MAGIC;
 
 typedef enum
@@ -65,21 +83,92 @@ typedef enum
 	CANDIDATE_NODE
 } NodeState;
 
-typedef struct repmgrdSharedState
+/*
+ * Values which are written together, and must be read together.
+ * Writers hold "lock" and bracket their changes with
+ * begin_write()/end_write(); readers take a copy with read_status(),
+ * which never blocks.
+ */
+typedef struct repmgrdStatus
 {
-	LWLockId	lock;			/* protects search/modification */
-	TimestampTz last_updated;
-	int			local_node_id;
 	int			repmgrd_pid;
-	char		repmgrd_pidfile[MAXUXPATH];
-	bool		repmgrd_paused;
-	/* streaming failover */
 	int			upstream_node_id;
 	TimestampTz upstream_last_seen;
+	char		repmgrd_pidfile[MAXUXPATH];
+	/* number of ".ready" files in "archive_status", as counted by repmgrd */
+	int			archive_ready_files;
+	TimestampTz archive_ready_updated;
+} repmgrdStatus;
+
+/*
+ * A sample recorded by repmgr.record_lag_sample(); "sample_num" counts
+ * samples since startup, so a reader can tell whether a ring slot has
+ * been overwritten.
+ */
+typedef struct repmgrdLagSample
+{
+	uint64		sample_num;
+	TimestampTz sample_time;
+	XLogRecPtr	last_wal_receive_lsn;
+	XLogRecPtr	last_wal_replay_lsn;
+	TimestampTz last_xact_replay_timestamp;
+	int			upstream_last_seen;
+} repmgrdLagSample;
+
+typedef struct repmgrdLagSlot
+{
+	ux_atomic_uint32 changecount;
+	repmgrdLagSample sample;
+} repmgrdLagSlot;
+
+/*
+ * State of another node as last seen by the repmgrd on a witness, recorded
+ * with repmgr.set_cluster_node_state(); "last_seen" is the time the node
+ * was last reachable. Unused slots have "node_id" set to UNKNOWN_NODE_ID.
+ */
+typedef struct repmgrdClusterNodeState
+{
+	int			node_id;
+	bool		reachable;
+	bool		repmgrd_running;
+	bool		in_recovery;
+	XLogRecPtr	last_wal_receive_lsn;
+	int			upstream_node_id;
+	int			upstream_last_seen;
+	TimestampTz last_seen;
+	TimestampTz updated;
+} repmgrdClusterNodeState;
+
+typedef struct repmgrdClusterNodeSlot
+{
+	ux_atomic_uint32 changecount;
+	repmgrdClusterNodeState state;
+} repmgrdClusterNodeSlot;
+
+/*
+ * Values which repmgrd and monitoring tools read frequently are either
+ * atomics or protected by a change counter, so reading them never takes
+ * "lock".
+ */
+typedef struct repmgrdSharedState
+{
+	LWLockId	lock;			/* serialises writers; protects voting state */
+	ux_atomic_uint64 last_updated;
+	ux_atomic_uint32 local_node_id;
+	ux_atomic_uint32 repmgrd_paused;
+	/* even when "status" is consistent, odd while it is being written */
+	ux_atomic_uint32 status_changecount;
+	repmgrdStatus status;
+	/* streaming failover */
 	NodeVotingStatus voting_status;
 	int			current_electoral_term;
 	int			candidate_node_id;
 	bool		follow_new_primary;
+	/* lag history ring; "lag_samples" is the number of samples recorded */
+	ux_atomic_uint64 lag_samples;
+	repmgrdLagSlot lag_history[LAG_HISTORY_SIZE];
+	/* witness only: state of the other nodes in the cluster */
+	repmgrdClusterNodeSlot cluster_view[CLUSTER_VIEW_SIZE];
 } repmgrdSharedState;
 
 static repmgrdSharedState *shared_state = NULL;
@@ -96,6 +185,14 @@ static void repmgr_shmem_request(void);
 #endif
 static void repmgr_shmem_startup(void);
 
+static inline int get_local_node_id(void);
+static void begin_write(ux_atomic_uint32 *changecount);
+static void end_write(ux_atomic_uint32 *changecount);
+static void read_consistent(ux_atomic_uint32 *changecount, void *dest, const void *src, size_t len);
+static void read_status(repmgrdStatus *status);
+static int	upstream_last_seen_secs(TimestampTz last_seen);
+static bool pid_is_running(int pid);
+
 UX_FUNCTION_INFO_V1(repmgr_set_local_node_id);
 UX_FUNCTION_INFO_V1(repmgr_get_local_node_id);
 UX_FUNCTION_INFO_V1(repmgr_standby_set_last_updated);
@@ -114,6 +211,13 @@ UX_FUNCTION_INFO_V1(repmgrd_is_running);
 UX_FUNCTION_INFO_V1(repmgrd_pause);
 UX_FUNCTION_INFO_V1(repmgrd_is_paused);
 UX_FUNCTION_INFO_V1(repmgr_get_wal_receiver_pid);
+UX_FUNCTION_INFO_V1(get_repmgrd_state);
+UX_FUNCTION_INFO_V1(repmgr_record_lag_sample);
+UX_FUNCTION_INFO_V1(repmgr_lag_history);
+UX_FUNCTION_INFO_V1(repmgr_set_archive_ready_files);
+UX_FUNCTION_INFO_V1(repmgr_get_archive_ready_files);
+UX_FUNCTION_INFO_V1(repmgr_set_cluster_node_state);
+UX_FUNCTION_INFO_V1(repmgr_cluster_view);
 
 
 /*
@@ -196,23 +300,138 @@ repmgr_shmem_startup(void)
 		shared_state->lock = LWLockAssign();
 #endif
 
-		shared_state->local_node_id = UNKNOWN_NODE_ID;
-		shared_state->repmgrd_pid = UNKNOWN_PID;
-		memset(shared_state->repmgrd_pidfile, 0, MAXUXPATH);
-		shared_state->repmgrd_paused = false;
-		shared_state->current_electoral_term = 0;
-		shared_state->upstream_node_id = UNKNOWN_NODE_ID;
+		ux_atomic_init_u64(&shared_state->last_updated, 0);
+		ux_atomic_init_u32(&shared_state->local_node_id, (uint32) UNKNOWN_NODE_ID);
+		ux_atomic_init_u32(&shared_state->repmgrd_paused, 0);
+		ux_atomic_init_u32(&shared_state->status_changecount, 0);
+
+		shared_state->status.repmgrd_pid = UNKNOWN_PID;
+		memset(shared_state->status.repmgrd_pidfile, 0, MAXUXPATH);
+		shared_state->status.upstream_node_id = UNKNOWN_NODE_ID;
 		/* arbitrary "magic" date to indicate this field hasn't been updated */
-		shared_state->upstream_last_seen = UXDB_EPOCH_JDATE;
+		shared_state->status.upstream_last_seen = UXDB_EPOCH_JDATE;
+		shared_state->status.archive_ready_files = -1;
+		shared_state->status.archive_ready_updated = UXDB_EPOCH_JDATE;
+
+		shared_state->current_electoral_term = 0;
 		shared_state->voting_status = VS_NO_VOTE;
 		shared_state->candidate_node_id = UNKNOWN_NODE_ID;
 		shared_state->follow_new_primary = false;
+
+		ux_atomic_init_u64(&shared_state->lag_samples, 0);
+		{
+			int			i;
+
+			for (i = 0; i < LAG_HISTORY_SIZE; i++)
+				ux_atomic_init_u32(&shared_state->lag_history[i].changecount, 0);
+
+			for (i = 0; i < CLUSTER_VIEW_SIZE; i++)
+			{
+				ux_atomic_init_u32(&shared_state->cluster_view[i].changecount, 0);
+				shared_state->cluster_view[i].state.node_id = UNKNOWN_NODE_ID;
+			}
+		}
 	}
 
 	LWLockRelease(AddinShmemInitLock);
 }
 
 
+static inline int
+get_local_node_id(void)
+{
+	return (int) ux_atomic_read_u32(&shared_state->local_node_id);
+}
+
+
+/*
+ * Seqlock protocol for "status" and the lag history slots, as used for
+ * backend status entries; the caller must hold "lock" exclusively.
+ */
+static void
+begin_write(ux_atomic_uint32 *changecount)
+{
+	ux_atomic_fetch_add_u32(changecount, 1);
+	ux_write_barrier();
+}
+
+
+static void
+end_write(ux_atomic_uint32 *changecount)
+{
+	ux_write_barrier();
+	ux_atomic_fetch_add_u32(changecount, 1);
+}
+
+
+/*
+ * Take a consistent copy of "src", retrying if a writer was active
+ * while it was being copied.
+ */
+static void
+read_consistent(ux_atomic_uint32 *changecount, void *dest, const void *src, size_t len)
+{
+	for (;;)
+	{
+		uint32		before_changecount = ux_atomic_read_u32(changecount);
+
+		if ((before_changecount & 1) == 0)
+		{
+			ux_read_barrier();
+			memcpy(dest, src, len);
+			ux_read_barrier();
+
+			if (ux_atomic_read_u32(changecount) == before_changecount)
+				break;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+
+static void
+read_status(repmgrdStatus *status)
+{
+	read_consistent(&shared_state->status_changecount, status,
+					&shared_state->status, sizeof(repmgrdStatus));
+}
+
+
+static int
+upstream_last_seen_secs(TimestampTz last_seen)
+{
+	long		secs;
+	int			microsecs;
+
+	/*
+	 * "last_seen" is initialised with the UXsinoDB epoch as a
+	 * "magic" value to indicate the field hasn't ever been updated
+	 * by repmgrd. We return -1 instead, rather than imply that the
+	 * primary was last seen at the turn of the century.
+	 */
+	if (last_seen == UXDB_EPOCH_JDATE)
+		return -1;
+
+	TimestampDifference(last_seen, GetCurrentTimestamp(),
+						&secs, &microsecs);
+
+	/* let's hope repmgrd never runs for more than a century or so without seeing a primary */
+	return (uint32)secs;
+}
+
+
+static bool
+pid_is_running(int pid)
+{
+	/* No PID registered - assume not running */
+	if (pid == UNKNOWN_PID)
+		return false;
+
+	return kill(pid, 0) == 0;
+}
+
+
 /* ==================== */
 /* monitoring functions */
 /* ==================== */
@@ -260,29 +479,28 @@ repmgr_set_local_node_id(UX_FUNCTION_ARGS)
 
 	}
 
-	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
-
 	/* only set local_node_id once, as it should never change */
-	if (shared_state->local_node_id == UNKNOWN_NODE_ID)
 	{
-		shared_state->local_node_id = local_node_id;
+		uint32		expected = (uint32) UNKNOWN_NODE_ID;
+
+		(void) ux_atomic_compare_exchange_u32(&shared_state->local_node_id,
+											  &expected,
+											  (uint32) local_node_id);
 	}
 
 	/* only update if state file valid */
-	if (stored_node_id == shared_state->local_node_id)
+	if (stored_node_id == get_local_node_id())
 	{
 		if (paused == 0)
 		{
-			shared_state->repmgrd_paused = false;
+			ux_atomic_write_u32(&shared_state->repmgrd_paused, 0);
 		}
 		else if (paused == 1)
 		{
-			shared_state->repmgrd_paused = true;
+			ux_atomic_write_u32(&shared_state->repmgrd_paused, 1);
 		}
 	}
 
-	LWLockRelease(shared_state->lock);
-
 	UX_RETURN_VOID();
 }
 
@@ -295,9 +513,7 @@ repmgr_get_local_node_id(UX_FUNCTION_ARGS)
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	local_node_id = shared_state->local_node_id;
-	LWLockRelease(shared_state->lock);
+	local_node_id = get_local_node_id();
 
 	UX_RETURN_INT32(local_node_id);
 }
@@ -312,9 +528,7 @@ repmgr_standby_set_last_updated(UX_FUNCTION_ARGS)
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
-	shared_state->last_updated = last_updated;
-	LWLockRelease(shared_state->lock);
+	ux_atomic_write_u64(&shared_state->last_updated, (uint64) last_updated);
 
 	UX_RETURN_TIMESTAMPTZ(last_updated);
 }
@@ -330,9 +544,7 @@ repmgr_standby_get_last_updated(UX_FUNCTION_ARGS)
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	last_updated = shared_state->last_updated;
-	LWLockRelease(shared_state->lock);
+	last_updated = (TimestampTz) ux_atomic_read_u64(&shared_state->last_updated);
 
 	UX_RETURN_TIMESTAMPTZ(last_updated);
 }
@@ -352,9 +564,12 @@ repmgr_set_upstream_last_seen(UX_FUNCTION_ARGS)
 	upstream_node_id = UX_GETARG_INT32(0);
 
 	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+	begin_write(&shared_state->status_changecount);
+
+	shared_state->status.upstream_last_seen = GetCurrentTimestamp();
+	shared_state->status.upstream_node_id = upstream_node_id;
 
-	shared_state->upstream_last_seen = GetCurrentTimestamp();
-	shared_state->upstream_node_id = upstream_node_id;
+	end_write(&shared_state->status_changecount);
 	LWLockRelease(shared_state->lock);
 
 	UX_RETURN_VOID();
@@ -364,50 +579,28 @@ repmgr_set_upstream_last_seen(UX_FUNCTION_ARGS)
 Datum
 repmgr_get_upstream_last_seen(UX_FUNCTION_ARGS)
 {
-	long		secs;
-	int			microsecs;
-	TimestampTz last_seen;
+	repmgrdStatus status;
 
 	if (!shared_state)
 		UX_RETURN_INT32(-1);
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-
-	last_seen = shared_state->upstream_last_seen;
+	read_status(&status);
 
-	LWLockRelease(shared_state->lock);
-
-	/*
-	 * "last_seen" is initialised with the UXsinoDB epoch as a
-	 * "magic" value to indicate the field hasn't ever been updated
-	 * by repmgrd. We return -1 instead, rather than imply that the
-	 * primary was last seen at the turn of the century.
-	 */
-	if (last_seen == UXDB_EPOCH_JDATE)
-		UX_RETURN_INT32(-1);
-
-
-	TimestampDifference(last_seen, GetCurrentTimestamp(),
-						&secs, &microsecs);
-
-	/* let's hope repmgrd never runs for more than a century or so without seeing a primary */
-	UX_RETURN_INT32((uint32)secs);
+	UX_RETURN_INT32(upstream_last_seen_secs(status.upstream_last_seen));
 }
 
 
 Datum
 repmgr_get_upstream_node_id(UX_FUNCTION_ARGS)
 {
-	int			upstream_node_id = UNKNOWN_NODE_ID;
+	repmgrdStatus status;
 
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	upstream_node_id = shared_state->upstream_node_id;
-	LWLockRelease(shared_state->lock);
+	read_status(&status);
 
-	UX_RETURN_INT32(upstream_node_id);
+	UX_RETURN_INT32(status.upstream_node_id);
 }
 
 Datum
@@ -424,9 +617,7 @@ repmgr_set_upstream_node_id(UX_FUNCTION_ARGS)
 
 	upstream_node_id = UX_GETARG_INT32(0);
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	local_node_id = shared_state->local_node_id;
-	LWLockRelease(shared_state->lock);
+	local_node_id = get_local_node_id();
 
 	if (local_node_id == upstream_node_id)
 		ereport(ERROR,
@@ -434,7 +625,9 @@ repmgr_set_upstream_node_id(UX_FUNCTION_ARGS)
 				 (errmsg("upstream node id cannot be the same as the local node id"))));
 
 	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
-	shared_state->upstream_node_id = upstream_node_id;
+	begin_write(&shared_state->status_changecount);
+	shared_state->status.upstream_node_id = upstream_node_id;
+	end_write(&shared_state->status_changecount);
 	LWLockRelease(shared_state->lock);
 
 	UX_RETURN_VOID();
@@ -450,6 +643,7 @@ Datum
 repmgr_notify_follow_primary(UX_FUNCTION_ARGS)
 {
 	int			primary_node_id = UNKNOWN_NODE_ID;
+	int			local_node_id = UNKNOWN_NODE_ID;
 
 	if (!shared_state)
 		UX_RETURN_VOID();
@@ -459,32 +653,30 @@ repmgr_notify_follow_primary(UX_FUNCTION_ARGS)
 
 	primary_node_id = UX_GETARG_INT32(0);
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
+	local_node_id = get_local_node_id();
 
 	/* only do something if local_node_id is initialised */
-	if (shared_state->local_node_id != UNKNOWN_NODE_ID)
+	if (local_node_id != UNKNOWN_NODE_ID)
 	{
 		if (primary_node_id == ELECTION_RERUN_NOTIFICATION)
 		{
 			elog(INFO, "node %i received notification to rerun promotion candidate election",
-				 shared_state->local_node_id);
+				 local_node_id);
 		}
 		else
 		{
 			elog(INFO, "node %i received notification to follow node %i",
-				 shared_state->local_node_id,
+				 local_node_id,
 				 primary_node_id);
 		}
 
-		LWLockRelease(shared_state->lock);
 		LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
 		/* Explicitly set the primary node id */
 		shared_state->candidate_node_id = primary_node_id;
 		shared_state->follow_new_primary = true;
+		LWLockRelease(shared_state->lock);
 	}
 
-	LWLockRelease(shared_state->lock);
-
 	UX_RETURN_VOID();
 }
 
@@ -517,20 +709,17 @@ repmgr_reset_voting_status(UX_FUNCTION_ARGS)
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-
 	/* only do something if local_node_id is initialised */
-	if (shared_state->local_node_id != UNKNOWN_NODE_ID)
+	if (get_local_node_id() != UNKNOWN_NODE_ID)
 	{
-		LWLockRelease(shared_state->lock);
 		LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
 
 		shared_state->voting_status = VS_NO_VOTE;
 		shared_state->candidate_node_id = UNKNOWN_NODE_ID;
 		shared_state->follow_new_primary = false;
-	}
 
-	LWLockRelease(shared_state->lock);
+		LWLockRelease(shared_state->lock);
+	}
 
 	UX_RETURN_VOID();
 }
@@ -543,16 +732,14 @@ repmgr_reset_voting_status(UX_FUNCTION_ARGS)
 Datum
 get_repmgrd_pid(UX_FUNCTION_ARGS)
 {
-	int repmgrd_pid = UNKNOWN_PID;
+	repmgrdStatus status;
 
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	repmgrd_pid = shared_state->repmgrd_pid;
-	LWLockRelease(shared_state->lock);
+	read_status(&status);
 
-	UX_RETURN_INT32(repmgrd_pid);
+	UX_RETURN_INT32(status.repmgrd_pid);
 }
 
 
@@ -562,21 +749,17 @@ get_repmgrd_pid(UX_FUNCTION_ARGS)
 Datum
 get_repmgrd_pidfile(UX_FUNCTION_ARGS)
 {
-	char repmgrd_pidfile[MAXUXPATH];
+	repmgrdStatus status;
 
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	memset(repmgrd_pidfile, 0, MAXUXPATH);
+	read_status(&status);
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	strncpy(repmgrd_pidfile, shared_state->repmgrd_pidfile, MAXUXPATH);
-	LWLockRelease(shared_state->lock);
-
-	if (repmgrd_pidfile[0] == '\0')
+	if (status.repmgrd_pidfile[0] == '\0')
 		UX_RETURN_NULL();
 
-	UX_RETURN_TEXT_P(cstring_to_text(repmgrd_pidfile));
+	UX_RETURN_TEXT_P(cstring_to_text(status.repmgrd_pidfile));
 }
 
 Datum
@@ -606,15 +789,17 @@ set_repmgrd_pid(UX_FUNCTION_ARGS)
 	}
 
 	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+	begin_write(&shared_state->status_changecount);
 
-	shared_state->repmgrd_pid = repmgrd_pid;
-	memset(shared_state->repmgrd_pidfile, 0, MAXUXPATH);
+	shared_state->status.repmgrd_pid = repmgrd_pid;
+	memset(shared_state->status.repmgrd_pidfile, 0, MAXUXPATH);
 
 	if (repmgrd_pidfile != NULL)
 	{
-		strncpy(shared_state->repmgrd_pidfile, repmgrd_pidfile, MAXUXPATH);
+		strncpy(shared_state->status.repmgrd_pidfile, repmgrd_pidfile, MAXUXPATH - 1);
 	}
 
+	end_write(&shared_state->status_changecount);
 	LWLockRelease(shared_state->lock);
 	UX_RETURN_VOID();
 }
@@ -623,30 +808,14 @@ set_repmgrd_pid(UX_FUNCTION_ARGS)
 Datum
 repmgrd_is_running(UX_FUNCTION_ARGS)
 {
-	int repmgrd_pid = UNKNOWN_PID;
-	int kill_ret;
+	repmgrdStatus status;
 
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	repmgrd_pid = shared_state->repmgrd_pid;
-	LWLockRelease(shared_state->lock);
+	read_status(&status);
 
-	/* No PID registered - assume not running */
-	if (repmgrd_pid == UNKNOWN_PID)
-	{
-		UX_RETURN_BOOL(false);
-	}
-
-	kill_ret = kill(repmgrd_pid, 0);
-
-	if (kill_ret == 0)
-	{
-		UX_RETURN_BOOL(true);
-	}
-
-	UX_RETURN_BOOL(false);
+	UX_RETURN_BOOL(pid_is_running(status.repmgrd_pid));
 }
 
 
@@ -665,9 +834,7 @@ repmgrd_pause(UX_FUNCTION_ARGS)
 
 	pause = UX_GETARG_BOOL(0);
 
-	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
-	shared_state->repmgrd_paused = pause;
-	LWLockRelease(shared_state->lock);
+	ux_atomic_write_u32(&shared_state->repmgrd_paused, pause ? 1 : 0);
 
 	/* write state to file */
 	file = AllocateFile(REPMGRD_STATE_FILE, UX_BINARY_W);
@@ -683,12 +850,9 @@ repmgrd_pause(UX_FUNCTION_ARGS)
 
 	initStringInfo(&buf);
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-
 	appendStringInfo(&buf, "%i:%i",
-					 shared_state->local_node_id,
+					 get_local_node_id(),
 					 pause ? 1 : 0);
-	LWLockRelease(shared_state->lock);
 
 	if (fwrite(buf.data, strlen(buf.data) + 1, 1, file) != 1)
 	{
@@ -711,9 +875,7 @@ repmgrd_is_paused(UX_FUNCTION_ARGS)
 	if (!shared_state)
 		UX_RETURN_NULL();
 
-	LWLockAcquire(shared_state->lock, LW_SHARED);
-	is_paused = shared_state->repmgrd_paused;
-	LWLockRelease(shared_state->lock);
+	is_paused = ux_atomic_read_u32(&shared_state->repmgrd_paused) != 0;
 
 	UX_RETURN_BOOL(is_paused);
 }
@@ -731,3 +893,466 @@ repmgr_get_wal_receiver_pid(UX_FUNCTION_ARGS)
 
 	UX_RETURN_INT32(wal_receiver_pid);
 }
+
+
+/*
+ * Return all repmgrd state in a single row, so callers which need several
+ * values don't have to call the individual functions; one row is returned
+ * if shared memory is available, otherwise none.
+ */
+Datum
+get_repmgrd_state(UX_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		funcctx->max_calls = shared_state ? 1 : 0;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		repmgrdStatus status;
+		Datum		values[8];
+		bool		nulls[8];
+		HeapTuple	tuple;
+		int			local_node_id = get_local_node_id();
+
+		memset(nulls, 0, sizeof(nulls));
+
+		read_status(&status);
+
+		values[0] = Int32GetDatum(local_node_id);
+		values[1] = Int32GetDatum(status.repmgrd_pid);
+
+		if (status.repmgrd_pidfile[0] == '\0')
+			nulls[2] = true;
+		else
+			values[2] = CStringGetTextDatum(status.repmgrd_pidfile);
+
+		values[3] = BoolGetDatum(pid_is_running(status.repmgrd_pid));
+		values[4] = BoolGetDatum(ux_atomic_read_u32(&shared_state->repmgrd_paused) != 0);
+		values[5] = Int32GetDatum(status.upstream_node_id);
+		values[6] = Int32GetDatum(upstream_last_seen_secs(status.upstream_last_seen));
+		values[7] = TimestampTzGetDatum((TimestampTz) ux_atomic_read_u64(&shared_state->last_updated));
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+
+/* ================== */
+/* lag history        */
+/* ================== */
+
+/*
+ * Add a sample of the local standby's WAL receive/replay position to the
+ * lag history ring; called by repmgrd once per monitoring interval.
+ * Nothing is recorded on a primary.
+ */
+Datum
+repmgr_record_lag_sample(UX_FUNCTION_ARGS)
+{
+	repmgrdStatus status;
+	repmgrdLagSlot *slot;
+	uint64		sample_num;
+
+	if (!shared_state)
+		UX_RETURN_VOID();
+
+	if (!RecoveryInProgress())
+		UX_RETURN_VOID();
+
+	read_status(&status);
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+
+	sample_num = ux_atomic_read_u64(&shared_state->lag_samples);
+	slot = &shared_state->lag_history[sample_num % LAG_HISTORY_SIZE];
+
+	begin_write(&slot->changecount);
+
+	slot->sample.sample_num = sample_num;
+	slot->sample.sample_time = GetCurrentTimestamp();
+	slot->sample.last_wal_receive_lsn = GetWalRcvFlushRecPtr(NULL, NULL);
+	slot->sample.last_wal_replay_lsn = GetXLogReplayRecPtr(NULL);
+	slot->sample.last_xact_replay_timestamp = GetLatestXTime();
+	slot->sample.upstream_last_seen = upstream_last_seen_secs(status.upstream_last_seen);
+
+	end_write(&slot->changecount);
+
+	ux_atomic_write_u64(&shared_state->lag_samples, sample_num + 1);
+
+	LWLockRelease(shared_state->lock);
+
+	UX_RETURN_VOID();
+}
+
+
+/*
+ * Return the samples in the lag history ring, oldest first.
+ */
+Datum
+repmgr_lag_history(UX_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	repmgrdLagSample *samples;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+		int			sample_count = 0;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		if (shared_state)
+		{
+			uint64		last_sample = ux_atomic_read_u64(&shared_state->lag_samples);
+			uint64		first_sample = last_sample > LAG_HISTORY_SIZE ? last_sample - LAG_HISTORY_SIZE : 0;
+			uint64		sample_num;
+
+			samples = palloc(sizeof(repmgrdLagSample) * (last_sample - first_sample + 1));
+
+			for (sample_num = first_sample; sample_num < last_sample; sample_num++)
+			{
+				repmgrdLagSlot *slot = &shared_state->lag_history[sample_num % LAG_HISTORY_SIZE];
+
+				read_consistent(&slot->changecount, &samples[sample_count],
+								&slot->sample, sizeof(repmgrdLagSample));
+
+				/* skip slots overwritten since "last_sample" was read */
+				if (samples[sample_count].sample_num == sample_num)
+					sample_count++;
+			}
+
+			funcctx->user_fctx = samples;
+		}
+
+		funcctx->max_calls = sample_count;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	samples = (repmgrdLagSample *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		repmgrdLagSample *sample = &samples[funcctx->call_cntr];
+		Datum		values[6];
+		bool		nulls[6];
+		HeapTuple	tuple;
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = TimestampTzGetDatum(sample->sample_time);
+
+		if (XLogRecPtrIsInvalid(sample->last_wal_receive_lsn))
+			nulls[1] = true;
+		else
+			values[1] = LSNGetDatum(sample->last_wal_receive_lsn);
+
+		values[2] = LSNGetDatum(sample->last_wal_replay_lsn);
+
+		/* as in repmgr.monitoring_history, report 0 while ahead of the receiver */
+		if (sample->last_wal_receive_lsn > sample->last_wal_replay_lsn)
+			values[3] = Int64GetDatum((int64) (sample->last_wal_receive_lsn - sample->last_wal_replay_lsn));
+		else
+			values[3] = Int64GetDatum(0);
+
+		if (sample->last_xact_replay_timestamp == 0)
+			nulls[4] = true;
+		else
+			values[4] = TimestampTzGetDatum(sample->last_xact_replay_timestamp);
+
+		values[5] = Int32GetDatum(sample->upstream_last_seen);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+
+/* ====================== */
+/* archive status backlog */
+/* ====================== */
+
+/*
+ * Record the number of WAL files awaiting archiving, as counted by repmgrd,
+ * so "repmgr node check --archive-ready" need not scan "archive_status"
+ * itself.
+ */
+Datum
+repmgr_set_archive_ready_files(UX_FUNCTION_ARGS)
+{
+	int			archive_ready_files = UX_GETARG_INT32(0);
+
+	if (!shared_state)
+		UX_RETURN_VOID();
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+	begin_write(&shared_state->status_changecount);
+
+	shared_state->status.archive_ready_files = archive_ready_files;
+	shared_state->status.archive_ready_updated = GetCurrentTimestamp();
+
+	end_write(&shared_state->status_changecount);
+	LWLockRelease(shared_state->lock);
+
+	UX_RETURN_VOID();
+}
+
+
+/*
+ * Return the count recorded by repmgr_set_archive_ready_files(), or NULL
+ * if repmgrd isn't running or hasn't reported it recently.
+ */
+Datum
+repmgr_get_archive_ready_files(UX_FUNCTION_ARGS)
+{
+	repmgrdStatus status;
+	long		secs;
+	int			microsecs;
+
+	if (!shared_state)
+		UX_RETURN_NULL();
+
+	read_status(&status);
+
+	if (status.archive_ready_files < 0 || status.archive_ready_updated == UXDB_EPOCH_JDATE)
+		UX_RETURN_NULL();
+
+	if (pid_is_running(status.repmgrd_pid) == false)
+		UX_RETURN_NULL();
+
+	TimestampDifference(status.archive_ready_updated, GetCurrentTimestamp(),
+						&secs, &microsecs);
+
+	if (secs > ARCHIVE_READY_FILES_MAX_AGE)
+		UX_RETURN_NULL();
+
+	UX_RETURN_INT32(status.archive_ready_files);
+}
+
+
+/* ============ */
+/* cluster view */
+/* ============ */
+
+/*
+ * Record the state of a node as seen by the repmgrd on a witness, which
+ * monitors all nodes in the cluster; a node's slot is reused on each
+ * update, and if all slots are in use, the least recently updated one is
+ * replaced.
+ *
+ * Arguments other than the node ID may be NULL if the node could not be
+ * queried.
+ */
+Datum
+repmgr_set_cluster_node_state(UX_FUNCTION_ARGS)
+{
+	int			node_id;
+	int			ix;
+	int			slot_ix = -1;
+	TimestampTz now = GetCurrentTimestamp();
+	repmgrdClusterNodeSlot *slot;
+
+	if (!shared_state)
+		UX_RETURN_VOID();
+
+	if (UX_ARGISNULL(0))
+		UX_RETURN_VOID();
+
+	node_id = UX_GETARG_INT32(0);
+
+	LWLockAcquire(shared_state->lock, LW_EXCLUSIVE);
+
+	for (ix = 0; ix < CLUSTER_VIEW_SIZE; ix++)
+	{
+		if (shared_state->cluster_view[ix].state.node_id == node_id)
+		{
+			slot_ix = ix;
+			break;
+		}
+	}
+
+	/* use the first free slot, otherwise the least recently updated one */
+	if (slot_ix == -1)
+	{
+		slot_ix = 0;
+
+		for (ix = 0; ix < CLUSTER_VIEW_SIZE; ix++)
+		{
+			repmgrdClusterNodeState *state = &shared_state->cluster_view[ix].state;
+
+			if (state->node_id == UNKNOWN_NODE_ID)
+			{
+				slot_ix = ix;
+				break;
+			}
+
+			if (state->updated < shared_state->cluster_view[slot_ix].state.updated)
+				slot_ix = ix;
+		}
+	}
+
+	slot = &shared_state->cluster_view[slot_ix];
+
+	begin_write(&slot->changecount);
+
+	if (slot->state.node_id != node_id)
+	{
+		slot->state.node_id = node_id;
+		slot->state.last_seen = UXDB_EPOCH_JDATE;
+	}
+
+	slot->state.reachable = UX_ARGISNULL(1) ? false : UX_GETARG_BOOL(1);
+	slot->state.repmgrd_running = UX_ARGISNULL(2) ? false : UX_GETARG_BOOL(2);
+	slot->state.in_recovery = UX_ARGISNULL(3) ? false : UX_GETARG_BOOL(3);
+	slot->state.last_wal_receive_lsn = UX_ARGISNULL(4) ? InvalidXLogRecPtr : UX_GETARG_LSN(4);
+	slot->state.upstream_node_id = UX_ARGISNULL(5) ? UNKNOWN_NODE_ID : UX_GETARG_INT32(5);
+	slot->state.upstream_last_seen = UX_ARGISNULL(6) ? -1 : UX_GETARG_INT32(6);
+	slot->state.updated = now;
+
+	if (slot->state.reachable == true)
+		slot->state.last_seen = now;
+
+	end_write(&slot->changecount);
+
+	LWLockRelease(shared_state->lock);
+
+	UX_RETURN_VOID();
+}
+
+
+/*
+ * Return the state of each node recorded by repmgr_set_cluster_node_state();
+ * nothing is returned if repmgrd is not running.
+ */
+Datum
+repmgr_cluster_view(UX_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	repmgrdClusterNodeState *states;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcontext;
+		TupleDesc	tupdesc;
+		int			state_count = 0;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+		if (shared_state)
+		{
+			repmgrdStatus status;
+
+			read_status(&status);
+
+			if (pid_is_running(status.repmgrd_pid) == true)
+			{
+				int			ix;
+
+				states = palloc(sizeof(repmgrdClusterNodeState) * CLUSTER_VIEW_SIZE);
+
+				for (ix = 0; ix < CLUSTER_VIEW_SIZE; ix++)
+				{
+					repmgrdClusterNodeSlot *slot = &shared_state->cluster_view[ix];
+
+					read_consistent(&slot->changecount, &states[state_count],
+									&slot->state, sizeof(repmgrdClusterNodeState));
+
+					if (states[state_count].node_id != UNKNOWN_NODE_ID)
+						state_count++;
+				}
+
+				funcctx->user_fctx = states;
+			}
+		}
+
+		funcctx->max_calls = state_count;
+
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	states = (repmgrdClusterNodeState *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		repmgrdClusterNodeState *state = &states[funcctx->call_cntr];
+		Datum		values[9];
+		bool		nulls[9];
+		HeapTuple	tuple;
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(state->node_id);
+		values[1] = BoolGetDatum(state->reachable);
+		values[2] = BoolGetDatum(state->repmgrd_running);
+		values[3] = BoolGetDatum(state->in_recovery);
+
+		if (XLogRecPtrIsInvalid(state->last_wal_receive_lsn))
+			nulls[4] = true;
+		else
+			values[4] = LSNGetDatum(state->last_wal_receive_lsn);
+
+		if (state->upstream_node_id == UNKNOWN_NODE_ID)
+			nulls[5] = true;
+		else
+			values[5] = Int32GetDatum(state->upstream_node_id);
+
+		if (state->upstream_last_seen < 0)
+			nulls[6] = true;
+		else
+			values[6] = Int32GetDatum(state->upstream_last_seen);
+
+		/* seconds since the witness last reached the node */
+		if (state->last_seen == UXDB_EPOCH_JDATE)
+			nulls[7] = true;
+		else
+			values[7] = Int32GetDatum(upstream_last_seen_secs(state->last_seen));
+
+		values[8] = TimestampTzGetDatum(state->updated);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
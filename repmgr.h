@@ -144,30 +144,57 @@
 #define DEFAULT_LOCATION                     "default"
 #define DEFAULT_PRIORITY                     100
 #define DEFAULT_MONITORING_INTERVAL          2	 /* seconds */
+#define MIN_MONITORING_INTERVAL_MS           100 /* milliseconds */
 #define DEFAULT_RECONNECTION_ATTEMPTS        6	 /* seconds */
 #define DEFAULT_RECONNECTION_INTERVAL        10  /* seconds */
+#define DEFAULT_RECONNECT_BACKOFF            true
+#define DEFAULT_RECONNECT_JITTER             20  /* percent */
+#define MAX_RECONNECT_JITTER                 50  /* percent */
+#define RECONNECT_BACKOFF_INITIAL_MS         250 /* milliseconds */
 #define DEFAULT_MONITORING_HISTORY           false
+#define DEFAULT_MONITORING_HISTORY_BATCH_SIZE 1
+#define DEFAULT_MONITORING_HISTORY_BATCH_INTERVAL 10 /* seconds */
+#define MONITORING_HISTORY_BUFFER_SIZE       1024 /* samples */
+#define MONITORING_HISTORY_PARTITIONS_AHEAD  7    /* days */
+#define MONITORING_HISTORY_PARTITION_CHECK_INTERVAL 3600 /* seconds */
 #define DEFAULT_DEGRADED_MONITORING_TIMEOUT  -1  /* seconds */
 #define DEFAULT_ASYNC_QUERY_TIMEOUT          60  /* seconds */
+#define DEFAULT_LOCAL_COMMAND_TIMEOUT        60  /* seconds */
 #define DEFAULT_PRIMARY_NOTIFICATION_TIMEOUT 60  /* seconds */
+#define DEFAULT_EVENT_NOTIFICATION_QUEUE_SIZE 1000 /* events */
+#define DEFAULT_EVENT_NOTIFICATION_MAX_PARALLEL 1
+#define DEFAULT_EVENT_NOTIFICATION_TIMEOUT   60  /* seconds */
+#define DEFAULT_EVENT_RETENTION_DAYS         0   /* keep indefinitely */
 #define DEFAULT_REPMGRD_STANDBY_STARTUP_TIMEOUT -1 /*seconds */
 #define DEFAULT_REPMGRD_EXIT_ON_INACTIVE_NODE false
 #define DEFAULT_STANDBY_DISCONNECT_ON_FAILOVER false
 #define DEFAULT_SIBLING_NODES_DISCONNECT_TIMEOUT 30 /* seconds */
 #define DEFAULT_CONNECTION_CHECK_TYPE        CHECK_PING
 #define DEFAULT_PRIMARY_VISIBILITY_CONSENSUS false
+#define DEFAULT_ELECTION_RANKING             ELECTION_RANKING_LSN
 #define DEFAULT_ALWAYS_PROMOTE               false
 #define DEFAULT_ELECTION_RERUN_INTERVAL      15  /* seconds */
+#define MIN_ELECTION_RERUN_INTERVAL_MS       100 /* milliseconds */
 #define DEFAULT_CHILD_NODES_CHECK_INTERVAL   5   /* seconds */
 #define DEFAULT_CHILD_NODES_DISCONNECT_MIN_COUNT -1
 #define DEFAULT_CHILD_NODES_CONNECTED_MIN_COUNT -1
 #define DEFAULT_CHILD_NODES_CONNECTED_INCLUDE_WITNESS false
 #define DEFAULT_CHILD_NODES_DISCONNECT_TIMEOUT 30 /* seconds */
+#define DEFAULT_METRICS_PORT                 0   /* disabled */
+#define DEFAULT_METRICS_LISTEN_ADDRESS       "127.0.0.1"
 #define DEFAULT_SSH_OPTIONS                  "-q -o ConnectTimeout=10"
+#define DEFAULT_SSH_MULTIPLEX                true
+#define DEFAULT_CLONE_PARALLEL_WORKERS       1
+#define DEFAULT_CLONE_FAST_NETWORK           false
+#define DEFAULT_CLUSTER_PROBE_PARALLEL       8
+#define DEFAULT_CLUSTER_PROBE_TIMEOUT        60  /* seconds */
+#define DEFAULT_SIBLING_FOLLOW_PARALLEL      8
+#define DEFAULT_SIBLING_FOLLOW_TIMEOUT       120 /* seconds */
 
 #define DEVICE_CHECK_TIMEOUT                 60  /* seconds */  /* uxdb */
 #define DEVICE_CHECK_TIMES                   3   /* times */    /* uxdb */
 #define DEFAULT_STANDBY_WAIT_TIMEOUT         10  /* mins */ /* uxdb */
+#define DEFAULT_SYNCHRONOUS_RECOVERY_DELAY   10  /* seconds */
 
 #ifndef RECOVERY_COMMAND_FILE
 #define RECOVERY_COMMAND_FILE "recovery.conf"
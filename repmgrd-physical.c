@@ -25,6 +25,14 @@
 #include "repmgrd-physical.h"
 
 #include "controldata.h"
+#include "eventqueue.h"
+#include "metrics.h"
+#include "failovertrace.h"
+#include "linkstate.h"
+#include "nodecache.h"
+#include "archivestatus.h"
+#include "syncstandby.h"
+#include "serverlifecycle.h"
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -58,6 +66,13 @@ typedef enum
 	ELECTION_RERUN
 } ElectionResult;
 
+/*
+ * With "election_ranking=catchup": the amount by which one candidate's
+ * estimated catch-up time must be lower than another's for it to be
+ * preferred over a node with higher priority.
+ */
+#define CATCHUP_RANKING_MARGIN_MS		1000
+
 typedef struct election_stats
 {
 	int visible_nodes;
@@ -107,6 +122,10 @@ static UXconn *upstream_conn = NULL;
 static UXconn *primary_conn = NULL;
 static bool touch_timeout_label = false; //uxdb
 static instr_time unreachable_sync_standby_start; //uxdb
+static short unreachable_standby_counts = 0;
+static instr_time sync_standby_recovery_start;
+static t_sync_standby_names sync_standby_names_current = T_SYNC_STANDBY_NAMES_INITIALIZER;
+static t_sync_standby_names sync_standby_names_record = T_SYNC_STANDBY_NAMES_INITIALIZER;
 
 static FailoverState failover_state = FAILOVER_STATE_UNKNOWN;
 
@@ -114,12 +133,77 @@ static int	primary_node_id = UNKNOWN_NODE_ID;
 static t_node_info upstream_node_info = T_NODE_INFO_INITIALIZER;
 
 static instr_time last_monitoring_update;
+
+/*
+ * Monitoring history samples not yet confirmed as written to the primary,
+ * held in a ring buffer starting at "monitoring_buffer_head"; the first
+ * "monitoring_buffer_in_flight" entries have been sent on
+ * "monitoring_history_conn" but their result has not yet been checked.
+ * "monitoring_buffer_dropped" counts samples overwritten since the buffer
+ * last filled up.
+ *
+ * Samples are sent on a connection of their own, opened with the same
+ * parameters as "primary_conn" (noted in "monitoring_history_primary_conn"),
+ * as any other query sent on "primary_conn" while a batch is in flight
+ * would cause its result to be discarded.
+ */
+static t_monitoring_record monitoring_buffer[MONITORING_HISTORY_BUFFER_SIZE];
+static int	monitoring_buffer_head = 0;
+static int	monitoring_buffer_count = 0;
+static int	monitoring_buffer_dropped = 0;
+static int	monitoring_buffer_in_flight = 0;
+static UXconn *monitoring_history_conn = NULL;
+static UXconn *monitoring_history_primary_conn = NULL;
+static instr_time last_monitoring_flush;
 static UXconn *vip_conn = NULL;
 static char vip_conninfo[MAXLEN] = {0};
 static bool network_card_is_down = false;
 static bool child_nodes_disconnect_command_executed = false;
 
+/*
+ * "ux_stat_replication" on the local primary, fetched at most once per
+ * monitoring cycle and shared by the child node and sync mode checks.
+ */
+static t_replication_snapshot replication_snapshot = T_REPLICATION_SNAPSHOT_INITIALIZER;
+static bool replication_snapshot_stale = true;
+
+/*
+ * Local and primary node status, fetched once per standby monitoring cycle
+ * if the installed extension provides "repmgr.standby_status()". The
+ * connections it was fetched from are noted, as it's not valid for any
+ * connection established later in the cycle.
+ */
+static t_standby_status standby_status;
+static UXconn *standby_status_local_conn = NULL;
+static UXconn *standby_status_primary_conn = NULL;
+static bool standby_status_available = false;
+
+/*
+ * Connection on which the checkpoint following a promotion is running; it
+ * is checked, and closed once the checkpoint has completed, in the primary
+ * monitoring loop.
+ */
+static UXconn *checkpoint_conn = NULL;
+
+/*
+ * Witness only: whether the local extension can record the state of the
+ * other nodes, which the witness monitors concurrently on each cycle.
+ */
+static bool cluster_view_available = false;
+
+/*
+ * Primary only: when daily "repmgr.monitoring_history" partitions were
+ * last checked for; not set until the first check in each monitoring
+ * session.
+ */
+static instr_time last_partition_check;
+static bool partition_check_done = false;
+
 static ElectionResult do_election(NodeInfoList *sibling_nodes, int *new_primary_id);
+static t_node_info *rank_candidates_by_catchup(t_node_info *candidate_node,
+											   t_node_replication_info *sibling_states, bool *sibling_eligible,
+											   int sibling_count);
+static double estimate_catchup_ms(t_node_info *node_info, t_catchup_info *catchup_info, XLogRecPtr receive_lsn);
 static const char *_print_election_result(ElectionResult result);
 
 static FailoverState promote_self(void);
@@ -140,7 +224,11 @@ static bool do_primary_failover(void);
 static bool do_upstream_standby_failover(void);
 static bool do_witness_failover(void);
 
+static void refresh_standby_status(void);
+static RecordStatus refresh_local_node_record(void);
 static bool update_monitoring_history(void);
+static void buffer_monitoring_record(t_monitoring_record *record);
+static void flush_monitoring_history(void);
 
 static void handle_sighup(UXconn **conn, t_server_type server_type);
 
@@ -149,6 +237,9 @@ static ElectionResult execute_failover_validation_command(t_node_info *node_info
 static void parse_failover_validation_command(const char *template,  t_node_info *node_info, election_stats *stats, UXSQLExpBufferData *out);
 static bool check_node_can_follow(UXconn *local_conn, XLogRecPtr local_xlogpos, UXconn *follow_target_conn, t_node_info *follow_target_node_info);
 static void check_witness_attached(t_node_info *node_info, bool startup);
+static t_replication_snapshot *get_cycle_replication_snapshot(void);
+static void update_metrics(t_child_node_info_list *child_nodes);
+static void set_attached_from_snapshot(NodeInfoList *child_node_records);
 
 static t_child_node_info *append_child_node_record(t_child_node_info_list *nodes, int node_id, const char *node_name, t_server_type type, NodeAttached attached);
 static void remove_child_node_record(t_child_node_info_list *nodes, int node_id);
@@ -157,6 +248,13 @@ static void parse_child_nodes_disconnect_command(char *parsed_command, char *tem
 static void execute_child_nodes_disconnect_command(NodeInfoList *db_child_node_records, t_child_node_info_list *local_child_nodes);
 
 static int try_primary_reconnect(UXconn **conn, UXconn *local_conn, t_node_info *node_info);
+static UXconn *start_reconnection(t_conninfo_param_list *conninfo_params, UXconn *local_conn, ConnStatusType *status, int *new_primary_node_id);
+static bool wait_for_new_primary(UXconn *local_conn, int timeout_ms, int *new_primary_node_id);
+static void start_post_promotion_checkpoint(void);
+static void update_cluster_view(void);
+static t_cluster_node_state *find_cluster_node_state(t_cluster_node_state *states, int state_count, int node_id);
+static void check_post_promotion_checkpoint(void);
+static void create_upcoming_monitoring_history_partitions(void);
 
 //uxdb
 static void check_disk(NodeInfoList *node_list);
@@ -177,12 +275,7 @@ static void retry_vip_connent(char *conninfo, UXconn **conn);
 static bool is_primary_node_rejoin(char *conninfo, UXconn **conn);
 static bool is_primary_node_update(UXconn *conn, int upstream_node_id);
 static void stop_the_service(void);
-static int get_match_async_node_num(NodeInfoList *my_node_list, char nodename[][MAXLEN]);
-static int parser_nums_synchronous_standby_names(char *sync_names);
-static int parser_info_synchronous_standby_names(char *sync_names);
-static bool parser_nodename_synchronous_standby_names(char *sync_names, char nodename[][MAXLEN]);
-
-#define NODENUMS 10
+static int get_match_async_node_num(NodeInfoList *my_node_list, t_sync_standby_names *sync_names);
 
 void
 handle_sigint_physical(SIGNAL_ARGS)
@@ -214,6 +307,8 @@ handle_sigint_physical(SIGNAL_ARGS)
 
 	termUXSQLExpBuffer(&event_details);
 
+	drain_event_queue(writeable_conn);
+
 	terminate(SUCCESS);
 }
 
@@ -406,7 +501,10 @@ monitor_streaming_primary(void)
 	NodeInfoList mynodes = T_NODE_INFO_LIST_INITIALIZER;	//uxdb
 
 	reset_node_voting_status();
+	node_cache_reset();
+	archive_status_reset();
 	repmgrd_set_upstream_node_id(local_conn, NO_UPSTREAM_NODE);
+	partition_check_done = false;
 
 	{
 		UXSQLExpBufferData event_details;
@@ -464,6 +562,8 @@ monitor_streaming_primary(void)
 		{
 			NodeInfoListCell *cell;
 
+			set_attached_from_snapshot(&db_child_node_records);
+
 			for (cell = db_child_node_records.head; cell; cell = cell->next)
 			{
 				/*
@@ -513,6 +613,8 @@ monitor_streaming_primary(void)
 		 * also return reason for inavailability so we can log it
 		 */
 
+		replication_snapshot_stale = true;
+
 		check_connection(&local_node_info, &local_conn);
 
 		if(UXSQLstatus(local_conn) == CONNECTION_OK)
@@ -529,7 +631,7 @@ monitor_streaming_primary(void)
 		//uxdb check disk is writable
 		if(is_server_available(local_node_info.conninfo) && (local_node_info.node_status == NODE_STATUS_UP))
 		{
-			ux_get_all_node_records(local_conn, &mynodes);
+			node_cache_get_all_node_records(local_conn, &mynodes);
 			check_disk(&mynodes);
 		}
 
@@ -657,7 +759,7 @@ monitor_streaming_primary(void)
 				termUXSQLExpBuffer(&command_str);
 
 				/*Then begin to exec 'node rejoin' -- tiabing*/
-				sleep(config_file_options.primary_notification_timeout);
+				sleep_ms(config_file_options.primary_notification_timeout_ms);
 				log_debug("exec node rejoin");
 				exec_node_rejoin_primary(&mynodes);
 			}
@@ -795,9 +897,18 @@ loop:
 		/* uxdb: refresh the node_list in case any new node registered or unregistered */
 		if(is_server_available(local_node_info.conninfo) && (local_node_info.node_status == NODE_STATUS_UP))
 		{
-			ux_get_all_node_records(local_conn, &mynodes);
+			node_cache_get_all_node_records(local_conn, &mynodes);
 
-			if(config_file_options.check_brain_split)
+			/*
+			 * check_timeline() takes the local timeline from the control
+			 * file, which only shows the new timeline once the checkpoint
+			 * following promotion has completed.
+			 */
+			if (config_file_options.check_brain_split && checkpoint_conn != NULL)
+			{
+				log_verbose(LOG_DEBUG, "checkpoint following promotion in progress, not checking for brain split");
+			}
+			else if(config_file_options.check_brain_split)
 			{
 				BS_ACTION ret;
 				ret=check_BS(&mynodes);
@@ -824,7 +935,7 @@ loop:
 					termUXSQLExpBuffer(&command_str);
 
 					/*Then begin to exec 'node rejoin' -- tiabing*/
-					sleep(config_file_options.primary_notification_timeout);
+					sleep_ms(config_file_options.primary_notification_timeout_ms);
 					log_debug("exec node rejoin");
 					exec_node_rejoin_primary(&mynodes);
 				}
@@ -849,10 +960,30 @@ loop:
 			}
 		}
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
+		process_event_queue(local_conn);
+		update_metrics(&local_child_nodes);
+		check_post_promotion_checkpoint();
+
+		if (monitoring_state == MS_NORMAL)
+		{
+			archive_status_update(local_conn);
+			create_upcoming_monitoring_history_partitions();
+		}
+
+		log_verbose(LOG_DEBUG, "sleeping %i milliseconds (parameter \"monitor_interval_secs\")",
+					config_file_options.monitor_interval_ms);
 
-		sleep(config_file_options.monitor_interval_secs);
+		switch (wait_for_event(config_file_options.monitor_interval_ms, local_conn))
+		{
+			case WAIT_CONNECTION_EVENT:
+				log_info(_("local node connection closed, checking node status"));
+				break;
+			case WAIT_LINK_EVENT:
+				log_info(_("network card went down, checking node status"));
+				break;
+			default:
+				break;
+		}
 	}
 	/* Added by chen_jingwen for #207866 at 2024/10/8 */
 	clear_node_info_list(&mynodes);
@@ -1027,7 +1158,7 @@ check_primary_status(int degraded_monitoring_elapsed)
 	/* check other type exist vip,if standby node has vip,unbind vip */
 	if (local_node_info.type != PRIMARY && check_vip_conf(config_file_options.virtual_ip, config_file_options.network_card))
 	{
-		if (unbind_virtual_ip(config_file_options.virtual_ip, config_file_options.network_card))
+		if (unbind_virtual_ip(config_file_options.virtual_ip, config_file_options.network_card, config_file_options.uxdb_password))
 		{
 			log_notice(_("node %i unbind virtual vip successed"), config_file_options.node_id);
 		}
@@ -1094,6 +1225,92 @@ check_primary_status(int degraded_monitoring_elapsed)
 }
 
 
+/*
+ * Copy state held in this file into the metrics published by the metrics
+ * endpoint; values obtained elsewhere are set where they are obtained.
+ */
+static void
+update_metrics(t_child_node_info_list *child_nodes)
+{
+	repmgrd_metrics.failover_state = format_failover_state(failover_state);
+
+	if (local_node_info.type == PRIMARY)
+		repmgrd_metrics.upstream_node_id = UNKNOWN_NODE_ID;
+	else
+		repmgrd_metrics.upstream_node_id = upstream_node_info.node_id;
+
+	if (child_nodes != NULL)
+	{
+		t_child_node_info *child_node_rec;
+
+		repmgrd_metrics.child_nodes_attached = 0;
+		repmgrd_metrics.child_nodes_detached = 0;
+		repmgrd_metrics.child_nodes_unknown = 0;
+
+		for (child_node_rec = child_nodes->head; child_node_rec; child_node_rec = child_node_rec->next)
+		{
+			if (child_node_rec->attached == NODE_ATTACHED)
+				repmgrd_metrics.child_nodes_attached++;
+			else if (child_node_rec->attached == NODE_DETACHED)
+				repmgrd_metrics.child_nodes_detached++;
+			else
+				repmgrd_metrics.child_nodes_unknown++;
+		}
+	}
+}
+
+
+/*
+ * Return the local node's "ux_stat_replication" snapshot for the current
+ * monitoring cycle, fetching it on first use. If it could not be fetched,
+ * the returned snapshot's "valid" flag is false.
+ */
+static t_replication_snapshot *
+get_cycle_replication_snapshot(void)
+{
+	if (replication_snapshot_stale == true)
+	{
+		replication_snapshot_stale = false;
+
+		if (UXSQLstatus(local_conn) != CONNECTION_OK
+			|| get_replication_snapshot(local_conn, NULL, &replication_snapshot) == false)
+		{
+			clear_replication_snapshot(&replication_snapshot);
+		}
+	}
+
+	return &replication_snapshot;
+}
+
+
+/*
+ * Set each child node's "attached" status according to whether it appears
+ * in this cycle's "ux_stat_replication" snapshot; if the snapshot is not
+ * available, the status returned by get_child_nodes() is retained.
+ *
+ * The witness does not replicate and is checked by check_witness_attached().
+ */
+static void
+set_attached_from_snapshot(NodeInfoList *child_node_records)
+{
+	t_replication_snapshot *snapshot = get_cycle_replication_snapshot();
+	NodeInfoListCell *cell;
+
+	if (snapshot->valid == false)
+		return;
+
+	for (cell = child_node_records->head; cell; cell = cell->next)
+	{
+		if (cell->node_info->type == WITNESS)
+			continue;
+
+		cell->node_info->attached = find_replication_stat(snapshot, cell->node_info->node_name) != NULL
+			? NODE_ATTACHED
+			: NODE_DETACHED;
+	}
+}
+
+
 static void
 check_primary_child_nodes(t_child_node_info_list *local_child_nodes)
 {
@@ -1104,7 +1321,16 @@ check_primary_child_nodes(t_child_node_info_list *local_child_nodes)
 	t_child_node_info_list reconnected_child_nodes = T_CHILD_NODE_INFO_LIST_INITIALIZER;
 	t_child_node_info_list new_child_nodes = T_CHILD_NODE_INFO_LIST_INITIALIZER;
 
-	bool success = get_child_nodes(local_conn, config_file_options.node_id, &db_child_node_records);
+	bool success;
+
+	/*
+	 * The cached records don't show which nodes are attached, so can only
+	 * be used if this cycle's snapshot of "ux_stat_replication" is available.
+	 */
+	if (get_cycle_replication_snapshot()->valid == true)
+		success = node_cache_get_child_nodes(local_conn, config_file_options.node_id, &db_child_node_records);
+	else
+		success = get_child_nodes(local_conn, config_file_options.node_id, &db_child_node_records);
 
 	if (!success)
 	{
@@ -1119,6 +1345,8 @@ check_primary_child_nodes(t_child_node_info_list *local_child_nodes)
 		return;
 	}
 
+	set_attached_from_snapshot(&db_child_node_records);
+
 	/*
 	 * compare DB records with our internal list;
 	 * this will tell us about:
@@ -1570,6 +1798,20 @@ monitor_streaming_standby(void)
 	log_debug("monitor_streaming_standby()");
 
 	reset_node_voting_status();
+	node_cache_reset();
+
+	/* "repmgr.standby_status()" was added in extension version 5.5 */
+	{
+		t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+		standby_status_available = get_repmgr_extension_status(local_conn, &extversions) == REPMGR_INSTALLED
+			&& extversions.installed_version_num >= 50500;
+
+		if (standby_status_available == false)
+			log_verbose(LOG_DEBUG, "\"repmgr.standby_status()\" not available, querying node status individually");
+	}
+
+	init_standby_status(&standby_status);
 
 	INSTR_TIME_SET_ZERO(last_monitoring_update);
 
@@ -1859,24 +2101,20 @@ NO_UPSTREAM_LABEL:
 				if (status == NODE_STATUS_UNCLEAN_SHUTDOWN)
 				{
 					/*start and stop the service*/
-					UXSQLExpBufferData stop_service_command_str;
 					log_notice("unclean shutdown detected, start and stop db to clean");
 
-					initUXSQLExpBuffer(&stop_service_command_str);
-					/* Modified by zhangxin for #180836 on 2023/4/14, reviewer duankun */
-					/* start和stop之间增加2秒延时，避免stop时collector进程未完全启动导致数据库异常退出 */
-					appendUXSQLExpBuffer(&stop_service_command_str,
-							"%s/ux_ctl -D %s start;sleep 2;",
-							config_file_options.ux_bindir, config_file_options.data_directory);
-					appendUXSQLExpBuffer(&stop_service_command_str,
-							"%s/ux_ctl -D %s stop",
-							config_file_options.ux_bindir, config_file_options.data_directory);
 					/* Begin modified by Liuqq 2020/12/11 for #95577 */
 					if (check_network_card_status(local_conn, local_node_info.node_id) != false)
 					{
-						 ux_system(stop_service_command_str.data);
-
-						 termUXSQLExpBuffer(&stop_service_command_str);
+						/*
+						 * Wait until the server is ready before stopping it, so the
+						 * collector process has been started (#180836).
+						 */
+						start_server_and_wait(config_file_options.data_directory,
+											  local_node_info.conninfo,
+											  config_file_options.repmgrd_standby_startup_timeout);
+						stop_server(config_file_options.data_directory,
+									config_file_options.promote_check_timeout);
 					}
 					/* End modified by Liuqq 2020/12/11 for #95577 */
 				}
@@ -1939,8 +2177,9 @@ NO_UPSTREAM_LABEL:
 		if (upstream_check_result == true && UXSQLstatus(local_conn) == CONNECTION_OK)
 		{
 			t_node_info confusion_node_info = T_NODE_INFO_INITIALIZER;
-			refresh_node_record(local_conn, local_node_info.node_id, &local_node_info);
+			refresh_local_node_record();
 			set_upstream_last_seen(local_conn, upstream_node_info.node_id);
+			INSTR_TIME_SET_CURRENT(repmgrd_metrics.upstream_last_seen);
 
 			if (upstream_node_info.type == STANDBY
 				&& local_node_info.upstream_node_id != upstream_node_info.upstream_node_id)
@@ -1980,6 +2219,12 @@ NO_UPSTREAM_LABEL:
 
 				INSTR_TIME_SET_CURRENT(upstream_node_unreachable_start);
 
+				if (upstream_node_info.type == PRIMARY)
+				{
+					failover_trace_begin(upstream_node_info.node_id,
+										 &repmgrd_metrics.upstream_last_seen,
+										 &upstream_node_unreachable_start);
+				}
 
 				upstream_node_info.node_status = NODE_STATUS_UNKNOWN;
 
@@ -2029,7 +2274,9 @@ NO_UPSTREAM_LABEL:
 
 				if (upstream_node_info.type == PRIMARY)
 				{
+					failover_trace_phase_start(FAILOVER_PHASE_RECONNECT);
 					primary_node_id = try_primary_reconnect(&upstream_conn, local_conn, &upstream_node_info);
+					failover_trace_phase_end(FAILOVER_PHASE_RECONNECT);
 
 					/*
 					 * We were notified by the the primary during our own reconnection
@@ -2046,7 +2293,13 @@ NO_UPSTREAM_LABEL:
 					}
 					if (primary_node_id != UNKNOWN_NODE_ID && primary_node_id != ELECTION_RERUN_NOTIFICATION)
 					{
-						follow_new_primary(primary_node_id);
+						FailoverState follow_state;
+
+						failover_trace_phase_start(FAILOVER_PHASE_FOLLOW);
+						follow_state = follow_new_primary(primary_node_id);
+						failover_trace_phase_end(FAILOVER_PHASE_FOLLOW);
+
+						failover_trace_finish(local_conn, primary_node_id, format_failover_state(follow_state));
 						return;
 					}
 				}
@@ -2061,6 +2314,9 @@ NO_UPSTREAM_LABEL:
 					int			upstream_node_unreachable_elapsed = calculate_elapsed(upstream_node_unreachable_start);
 					UXSQLExpBufferData event_details;
 
+					/* no failover took place, so there's nothing to report */
+					failover_trace_discard();
+
 					initUXSQLExpBuffer(&event_details);
 
 					appendUXSQLExpBuffer(&event_details,
@@ -2094,24 +2350,11 @@ NO_UPSTREAM_LABEL:
 
 							if (ping_result != UXRES_TUPLES_OK)
 							{
-								int i;
-
 								close_connection(&local_conn);
 
-								for (i = 0; i < config_file_options.repmgrd_standby_startup_timeout; i++)
-								{
-									local_conn = establish_db_connection(local_node_info.conninfo, false);
-
-									if (UXSQLstatus(local_conn) == CONNECTION_OK)
-										break;
-
-									close_connection(&local_conn);
-
-									log_debug("sleeping 1 second; %i of %i attempts to reconnect to local node",
-											  i + 1,
-											  config_file_options.repmgrd_standby_startup_timeout);
-									sleep(1);
-								}
+								local_conn = wait_for_server_connection(config_file_options.data_directory,
+																		local_node_info.conninfo,
+																		config_file_options.repmgrd_standby_startup_timeout);
 							}
 
 							return;
@@ -2163,6 +2406,8 @@ NO_UPSTREAM_LABEL:
 						log_hint(_("execute \"repmgr service unpause\" to resume normal failover mode"));
 						monitoring_state = MS_DEGRADED;
 						INSTR_TIME_SET_CURRENT(degraded_monitoring_start);
+
+						failover_trace_discard();
 					}
 					else
 					{
@@ -2201,7 +2446,15 @@ NO_UPSTREAM_LABEL:
 			&& check_network_card_status(local_conn, local_node_info.node_id) == true)
 			{
 				bool failover_done = false;
+				instr_time	network_card_up;
+
 				network_card_is_down = false;
+
+				INSTR_TIME_SET_CURRENT(network_card_up);
+				failover_trace_begin(upstream_node_info.node_id,
+									 &repmgrd_metrics.upstream_last_seen,
+									 &network_card_up);
+
 				failover_done = do_primary_failover();
 
 				/*
@@ -2384,6 +2637,7 @@ DEGRADED_LABEL:
 														&sibling_nodes);
 						notify_followers(&sibling_nodes, local_node_info.node_id);
 
+						release_pooled_connections(&sibling_nodes);
 						clear_node_info_list(&sibling_nodes);
 
 						/* this will restart monitoring in primary mode */
@@ -2452,11 +2706,10 @@ DEGRADED_LABEL:
 								continue;
 							}
 
-							cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
+							cell->node_info->conn = get_pooled_connection(cell->node_info);
 
 							if (UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
 							{
-								close_connection(&cell->node_info->conn);
 								log_debug("unable to connect to %i ... ", cell->node_info->node_id);
 								close_connection(&cell->node_info->conn);
 								continue;
@@ -2465,10 +2718,10 @@ DEGRADED_LABEL:
 							if (get_recovery_type(cell->node_info->conn) == RECTYPE_PRIMARY)
 							{
 								follow_node_info = cell->node_info;
-								close_connection(&cell->node_info->conn);
+								release_pooled_connection(cell->node_info);
 								break;
 							}
-							close_connection(&cell->node_info->conn);
+							release_pooled_connection(cell->node_info);
 						}
 
 						if (follow_node_info != NULL)
@@ -2552,6 +2805,15 @@ loop:
 			}
 		}
 
+		refresh_standby_status();
+
+		/*
+		 * Record lag locally regardless of "monitoring_history"; this needs
+		 * neither the primary nor any writes.
+		 */
+		if (UXSQLstatus(local_conn) == CONNECTION_OK)
+			record_lag_sample(local_conn);
+
 		if (UXSQLstatus(primary_conn) == CONNECTION_OK && config_file_options.monitoring_history == true)
 		{
 			bool success = update_monitoring_history();
@@ -2575,9 +2837,9 @@ loop:
 
 			/*
 			 * if monitoring not in use, we'll need to ensure the local connection
-			 * handle isn't stale
+			 * handle isn't stale (unless the status query has just used it)
 			 */
-			if(UXSQLstatus(local_conn) == CONNECTION_OK)
+			if(UXSQLstatus(local_conn) == CONNECTION_OK && standby_status.local_valid == false)
 				(void) connection_ping(local_conn);
 		}
 
@@ -2682,7 +2944,10 @@ loop:
 			 * If the local node was restarted, we'll need to reinitialise values
 			 * stored in shared memory.
 			 */
-			stored_local_node_id = repmgrd_get_local_node_id(local_conn);
+			if (standby_status.local_valid == true && standby_status_local_conn == local_conn)
+				stored_local_node_id = standby_status.local_node_id;
+			else
+				stored_local_node_id = repmgrd_get_local_node_id(local_conn);
 
 			if (stored_local_node_id == UNKNOWN_NODE_ID)
 			{
@@ -2692,7 +2957,14 @@ loop:
 
 			if (UXSQLstatus(primary_conn) == CONNECTION_OK)
 			{
-				if (get_recovery_type(primary_conn) == RECTYPE_STANDBY)
+				bool		primary_in_recovery;
+
+				if (standby_status.primary_valid == true && standby_status_primary_conn == primary_conn)
+					primary_in_recovery = standby_status.primary_in_recovery;
+				else
+					primary_in_recovery = get_recovery_type(primary_conn) == RECTYPE_STANDBY;
+
+				if (primary_in_recovery == true)
 				{
 					log_notice(_("current upstream node \"%s\" (ID: %i) is not primary, restarting monitoring"),
 							   upstream_node_info.node_name, upstream_node_info.node_id);
@@ -2750,7 +3022,7 @@ loop:
 			handle_sighup(&local_conn, STANDBY);
 		}
 
-		refresh_node_record(local_conn, local_node_info.node_id, &local_node_info);
+		refresh_local_node_record();
 
 		if (local_monitoring_state == MS_NORMAL && last_known_upstream_node_id != local_node_info.upstream_node_id)
 		{
@@ -2784,11 +3056,23 @@ loop:
 			}
 		}
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
+		process_event_queue(primary_conn);
+		update_metrics(NULL);
 
+		log_verbose(LOG_DEBUG, "sleeping %i milliseconds (parameter \"monitor_interval_secs\")",
+					config_file_options.monitor_interval_ms);
 
-		sleep(config_file_options.monitor_interval_secs);
+		switch (wait_for_event(config_file_options.monitor_interval_ms, upstream_conn))
+		{
+			case WAIT_CONNECTION_EVENT:
+				log_info(_("upstream connection closed, checking upstream node status"));
+				break;
+			case WAIT_LINK_EVENT:
+				log_info(_("network card went down, checking node status"));
+				break;
+			default:
+				break;
+		}
 	}
 	/* Added by chen_jingwen for #207866 at 2024/10/8 */
 	close_connection(&upstream_conn);
@@ -2809,6 +3093,17 @@ monitor_streaming_witness(void)
 
 	log_debug("monitor_streaming_witness()");
 
+	/* "repmgr.set_cluster_node_state()" was added in extension version 5.5 */
+	{
+		t_extension_versions extversions = T_EXTENSION_VERSIONS_INITIALIZER;
+
+		cluster_view_available = get_repmgr_extension_status(local_conn, &extversions) == REPMGR_INSTALLED
+			&& extversions.installed_version_num >= 50500;
+
+		if (cluster_view_available == false)
+			log_verbose(LOG_DEBUG, "\"repmgr.set_cluster_node_state()\" not available, not monitoring other nodes");
+	}
+
 	/*
 	 * At this point we can't trust the local copy of "repmgr.nodes", as
 	 * it may not have been updated. We'll scan the cluster to find the
@@ -2944,6 +3239,7 @@ monitor_streaming_witness(void)
 		if (check_upstream_connection(&primary_conn, upstream_node_info.conninfo, NULL) == true)
 		{
 			set_upstream_last_seen(local_conn, upstream_node_info.node_id);
+			INSTR_TIME_SET_CURRENT(repmgrd_metrics.upstream_last_seen);
 		}
 		else
 		{
@@ -3123,11 +3419,10 @@ monitor_streaming_witness(void)
 							continue;
 						}
 
-						cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
+						cell->node_info->conn = get_pooled_connection(cell->node_info);
 
 						if (UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
 						{
-							close_connection(&cell->node_info->conn);
 							log_debug("unable to connect to %i ... ", cell->node_info->node_id);
 							close_connection(&cell->node_info->conn);
 							continue;
@@ -3136,10 +3431,10 @@ monitor_streaming_witness(void)
 						if (get_recovery_type(cell->node_info->conn) == RECTYPE_PRIMARY)
 						{
 							follow_node_info = cell->node_info;
-							close_connection(&cell->node_info->conn);
+							release_pooled_connection(cell->node_info);
 							break;
 						}
-						close_connection(&cell->node_info->conn);
+						release_pooled_connection(cell->node_info);
 					}
 
 					if (follow_node_info != NULL)
@@ -3292,6 +3587,8 @@ loop:
 			}
 		}
 
+		update_cluster_view();
+
 		/* emit "still alive" log message at regular intervals, if requested */
 		if (config_file_options.log_status_interval > 0)
 		{
@@ -3329,10 +3626,14 @@ loop:
 			handle_sighup(&local_conn, WITNESS);
 		}
 
-		log_verbose(LOG_DEBUG, "sleeping %i seconds (parameter \"monitor_interval_secs\")",
-					config_file_options.monitor_interval_secs);
+		process_event_queue(primary_conn);
+		update_metrics(NULL);
 
-		sleep(config_file_options.monitor_interval_secs);
+		log_verbose(LOG_DEBUG, "sleeping %i milliseconds (parameter \"monitor_interval_secs\")",
+					config_file_options.monitor_interval_ms);
+
+		if (wait_for_event(config_file_options.monitor_interval_ms, primary_conn) == WAIT_CONNECTION_EVENT)
+			log_info(_("primary connection closed, checking primary node status"));
 	}
 
 	return;
@@ -3347,12 +3648,14 @@ do_primary_failover(void)
 	NodeInfoList sibling_nodes = T_NODE_INFO_LIST_INITIALIZER;
 	int new_primary_id = UNKNOWN_NODE_ID;
 	bool standby_disconnect_on_failover = false;
+	const char *trace_outcome = NULL;
 
 	/* Add by houjiaxing for #194511 at 2023/10/19 , reviewer:wangbocai */
 	if (check_network_card_status(local_conn, local_node_info.node_id) == false)
 	{
 		network_card_is_down = true;
 		log_warning(_("network card error, election cancelled"));
+		failover_trace_finish(local_conn, UNKNOWN_NODE_ID, "NETWORK_CARD_ERROR");
 		return false;
 	}
 
@@ -3456,7 +3759,9 @@ do_primary_failover(void)
 	}
 
 	/* attempt to initiate voting process */
+	failover_trace_phase_start(FAILOVER_PHASE_ELECTION);
 	election_result = do_election(&sibling_nodes, &new_primary_id);
+	failover_trace_phase_end(FAILOVER_PHASE_ELECTION);
 
 	/* TODO add pre-event notification here */
 	failover_state = FAILOVER_STATE_UNKNOWN;
@@ -3476,7 +3781,9 @@ do_primary_failover(void)
 		if (new_primary_id == UNKNOWN_NODE_ID)
 		{
 			log_notice(_("election cancelled"));
+			release_pooled_connections(&sibling_nodes);
 			clear_node_info_list(&sibling_nodes);
+			failover_trace_finish(local_conn, UNKNOWN_NODE_ID, "ELECTION_CANCELLED");
 			return false;
 		}
 
@@ -3503,15 +3810,26 @@ do_primary_failover(void)
 			log_notice("this node is the only available candidate and will now promote itself");
 		}
 
+		failover_trace_phase_start(FAILOVER_PHASE_PROMOTE);
 		failover_state = promote_self();
+		failover_trace_phase_end(FAILOVER_PHASE_PROMOTE);
 
 		/* uxdb: When new primary node has promoted successful, bind virtual ip to the node's network card */
 		if(failover_state==FAILOVER_STATE_PROMOTED)
 		{
+			/*
+			 * The checkpoint updating the control file's timeline (#177313)
+			 * runs in the background, so it doesn't hold up binding the
+			 * virtual IP or notifying the followers.
+			 */
+			start_post_promotion_checkpoint();
+
 			if(check_vip_conf(config_file_options.virtual_ip, config_file_options.network_card))
 			{
+				failover_trace_phase_start(FAILOVER_PHASE_VIP_BIND);
 				if(bind_virtual_ip(config_file_options.virtual_ip, config_file_options.network_card, config_file_options.uxdb_password))
 					log_notice(_("bind the virtual ip when promoting local node to new primary server"));
+				failover_trace_phase_end(FAILOVER_PHASE_VIP_BIND);
 			}
 		}
 	}
@@ -3538,7 +3856,9 @@ do_primary_failover(void)
 	 */
 	if (failover_state == FAILOVER_STATE_FOLLOW_NEW_PRIMARY)
 	{
+		failover_trace_phase_start(FAILOVER_PHASE_FOLLOW);
 		failover_state = follow_new_primary(new_primary_id);
+		failover_trace_phase_end(FAILOVER_PHASE_FOLLOW);
 	}
 
 	/*
@@ -3549,8 +3869,14 @@ do_primary_failover(void)
 	{
 		/* TODO: rerun election if new primary doesn't appear after timeout */
 
+		bool		notification_received;
+
 		/* either follow, self-promote or time out; either way resume monitoring */
-		if (wait_primary_notification(&new_primary_id) == true)
+		failover_trace_phase_start(FAILOVER_PHASE_WAIT_NOTIFICATION);
+		notification_received = wait_primary_notification(&new_primary_id);
+		failover_trace_phase_end(FAILOVER_PHASE_WAIT_NOTIFICATION);
+
+		if (notification_received == true)
 		{
 			/* if primary has reappeared, no action needed */
 			if (new_primary_id == upstream_node_info.node_id)
@@ -3562,8 +3888,11 @@ do_primary_failover(void)
 			{
 				log_notice(_("this node is promotion candidate, promoting"));
 
+				failover_trace_phase_start(FAILOVER_PHASE_PROMOTE);
 				failover_state = promote_self();
+				failover_trace_phase_end(FAILOVER_PHASE_PROMOTE);
 
+				release_pooled_connections(&sibling_nodes);
 				get_active_sibling_node_records(local_conn,
 												local_node_info.node_id,
 												upstream_node_info.node_id,
@@ -3619,7 +3948,9 @@ do_primary_failover(void)
 			}
 			else
 			{
+				failover_trace_phase_start(FAILOVER_PHASE_FOLLOW);
 				failover_state = follow_new_primary(new_primary_id);
+				failover_trace_phase_end(FAILOVER_PHASE_FOLLOW);
 			}
 		}
 		else
@@ -3631,6 +3962,12 @@ do_primary_failover(void)
 	log_verbose(LOG_DEBUG, "failover state is %s",
 				format_failover_state(failover_state));
 
+	/* the switch below resets "failover_state", so note the outcome now */
+	trace_outcome = format_failover_state(failover_state);
+
+	if (failover_state == FAILOVER_STATE_PROMOTED)
+		new_primary_id = local_node_info.node_id;
+
 	switch (failover_state)
 	{
 		case FAILOVER_STATE_PROMOTED:
@@ -3640,11 +3977,6 @@ do_primary_failover(void)
 			/* pass control back down to start_monitoring() */
 			log_info(_("switching to primary monitoring mode"));
 
-			/* 提升为主节点后，执行一次checkpoint，更新control文件的时间线 */
-			/* BEGIN:  Added by huyn for #177313, 2023/2/17  reviewer:wangyh,zhangwj */
-			new_primary_execute_checkpoint(local_conn);
-			/* END:  Added by huyn for #177313, 2023/2/17  reviewer:wangyh,zhangwj */
-
 			failover_state = FAILOVER_STATE_NONE;
 
 			final_result = true;
@@ -3654,11 +3986,12 @@ do_primary_failover(void)
 		case FAILOVER_STATE_ELECTION_RERUN:
 
 			/* we no longer care about our former siblings */
+			release_pooled_connections(&sibling_nodes);
 			clear_node_info_list(&sibling_nodes);
 
-			log_notice(_("rerunning election after %i seconds (\"election_rerun_interval\")"),
-					   config_file_options.election_rerun_interval);
-			sleep(config_file_options.election_rerun_interval);
+			log_notice(_("rerunning election after %i milliseconds (\"election_rerun_interval\")"),
+					   config_file_options.election_rerun_interval_ms);
+			sleep_ms(config_file_options.election_rerun_interval_ms);
 
 			log_info(_("election rerun will now commence"));
 			/*
@@ -3756,16 +4089,69 @@ do_primary_failover(void)
 	}
 
 	/* we no longer care about our former siblings */
+	release_pooled_connections(&sibling_nodes);
 	clear_node_info_list(&sibling_nodes);
 
+	failover_trace_finish(local_conn, new_primary_id, trace_outcome);
+
 	return final_result;
 }
 
 
+/*
+ * Fetch the status of the local node and the primary for the current
+ * standby monitoring cycle; any part which can't be fetched is left
+ * invalid, and the individual queries are used instead.
+ */
+static void
+refresh_standby_status(void)
+{
+	UXconn	   *status_primary_conn = NULL;
+
+	init_standby_status(&standby_status);
+	standby_status_local_conn = NULL;
+	standby_status_primary_conn = NULL;
+
+	if (standby_status_available == false || UXSQLstatus(local_conn) != CONNECTION_OK)
+		return;
+
+	/*
+	 * Don't send anything on the primary connection while it has another
+	 * query in progress; the send would fail, and the individual queries
+	 * used instead would cause the pending result to be discarded.
+	 */
+	if (primary_conn != NULL && UXSQLstatus(primary_conn) == CONNECTION_OK &&
+		UXSQLtransactionStatus(primary_conn) == UXSQLTRANS_IDLE)
+		status_primary_conn = primary_conn;
+
+	(void) get_standby_status(local_conn, status_primary_conn, &standby_status);
+
+	standby_status_local_conn = local_conn;
+	standby_status_primary_conn = status_primary_conn;
+}
+
+
+/*
+ * Refresh the local node's record during standby monitoring. The node
+ * record cache can't be used with the local connection, as notifications
+ * are not available during recovery, but can be kept up to date via the
+ * primary connection.
+ */
+static RecordStatus
+refresh_local_node_record(void)
+{
+	if (node_cache_available(primary_conn) == true)
+		return node_cache_refresh_node_record(primary_conn, local_node_info.node_id, &local_node_info);
+
+	return refresh_node_record(local_conn, local_node_info.node_id, &local_node_info);
+}
+
+
 static bool
 update_monitoring_history(void)
 {
 	ReplInfo	replication_info;
+	t_monitoring_record record;
 	XLogRecPtr	primary_last_wal_location = InvalidXLogRecPtr;
 
 	long long unsigned int apply_lag_bytes = 0;
@@ -3786,7 +4172,11 @@ update_monitoring_history(void)
 
 	init_replication_info(&replication_info);
 
-	if (get_replication_info(local_conn, STANDBY, &replication_info) == false)
+	if (standby_status.local_valid == true && standby_status_local_conn == local_conn)
+	{
+		replication_info = standby_status.replication_info;
+	}
+	else if (get_replication_info(local_conn, STANDBY, &replication_info) == false)
 	{
 		log_warning(_("unable to retrieve replication status information, unable to update monitoring history"));
 		return false;
@@ -3803,7 +4193,10 @@ update_monitoring_history(void)
 					local_node_info.node_id);
 	}
 
-	primary_last_wal_location = get_primary_current_lsn(primary_conn);
+	if (standby_status.primary_valid == true && standby_status_primary_conn == primary_conn)
+		primary_last_wal_location = standby_status.primary_current_lsn;
+	else
+		primary_last_wal_location = get_primary_current_lsn(primary_conn);
 
 	if (primary_last_wal_location == InvalidXLogRecPtr)
 	{
@@ -3841,89 +4234,251 @@ update_monitoring_history(void)
 		replication_lag_bytes = 0;
 	}
 
-	add_monitoring_record(primary_conn,
-						  local_conn,
-						  primary_node_id,
-						  local_node_info.node_id,
-						  replication_info.current_timestamp,
-						  primary_last_wal_location,
-						  replication_info.last_wal_receive_lsn,
-						  replication_info.last_xact_replay_timestamp,
-						  replication_lag_bytes,
-						  apply_lag_bytes);
+	record.primary_node_id = primary_node_id;
+	record.standby_node_id = local_node_info.node_id;
+	snprintf(record.monitor_standby_timestamp, sizeof(record.monitor_standby_timestamp),
+			 "%s", replication_info.current_timestamp);
+	record.primary_last_wal_location = primary_last_wal_location;
+	record.last_wal_receive_lsn = replication_info.last_wal_receive_lsn;
+	snprintf(record.last_xact_replay_timestamp, sizeof(record.last_xact_replay_timestamp),
+			 "%s", replication_info.last_xact_replay_timestamp);
+	record.replication_lag_bytes = replication_lag_bytes;
+	record.apply_lag_bytes = apply_lag_bytes;
+
+	repmgrd_metrics.lag_valid = true;
+	INSTR_TIME_SET_CURRENT(repmgrd_metrics.lag_updated);
+	repmgrd_metrics.last_wal_receive_lsn = replication_info.last_wal_receive_lsn;
+	repmgrd_metrics.last_wal_replay_lsn = replication_info.last_wal_replay_lsn;
+	repmgrd_metrics.replication_lag_bytes = replication_lag_bytes;
+	repmgrd_metrics.apply_lag_bytes = apply_lag_bytes;
+
+	buffer_monitoring_record(&record);
+
+	/* dispatched asynchronously, so doesn't wait for the primary */
+	flush_monitoring_history();
+
+	set_standby_last_updated(local_conn);
 
 	INSTR_TIME_SET_CURRENT(last_monitoring_update);
 
-	log_verbose(LOG_DEBUG, "update_monitoring_history(): monitoring history update sent");
+	log_verbose(LOG_DEBUG, "update_monitoring_history(): monitoring history updated");
 
 	return true;
 }
 
 
 /*
- * do_upstream_standby_failover()
- *
- * Attach cascaded standby to another node, currently the primary.
- *
- * Note that in contrast to a primary failover, where one of the downstream
- * standby nodes will become a primary, a cascaded standby failover (where the
- * upstream standby has gone away) is "just" a case of attaching the standby to
- * another node.
- *
- * Currently we will try to attach the node to the cluster primary.
- *
- * TODO: As of repmgr 4.3, "repmgr standby follow" supports attaching a standby to another
- * standby node. We need to provide a selection of reconnection strategies as different
- * behaviour might be desirable in different situations.
+ * Add a monitoring history sample to the local buffer; if the buffer is
+ * full (e.g. because the primary has been unavailable for an extended
+ * period), the newest sample overwrites the oldest one.
  */
-
-static bool
-do_upstream_standby_failover(void)
+static void
+buffer_monitoring_record(t_monitoring_record *record)
 {
-	t_node_info primary_node_info = T_NODE_INFO_INITIALIZER;
-	RecordStatus record_status = RECORD_NOT_FOUND;
-	RecoveryType primary_type = RECTYPE_UNKNOWN;
-	int			i, standby_follow_result;
-	char		parsed_follow_command[MAXUXPATH] = "";
-
-	close_connection(&upstream_conn);
+	if (monitoring_buffer_count == 0)
+		INSTR_TIME_SET_CURRENT(last_monitoring_flush);
 
-	/*
-	 *
-	 */
-	if (config_file_options.failover == FAILOVER_MANUAL)
+	if (monitoring_buffer_count == MONITORING_HISTORY_BUFFER_SIZE)
 	{
-		log_notice(_("this node is not configured for automatic failover"));
-		log_detail(_("parameter \"failover\" is set to \"manual\""));
-		return false;
-	}
+		if (monitoring_buffer_dropped == 0)
+		{
+			log_warning(_("monitoring history buffer full, discarding oldest samples"));
+		}
 
-	if (get_primary_node_record(local_conn, &primary_node_info) == false)
-	{
-		log_error(_("unable to retrieve primary node record"));
-		return false;
+		/*
+		 * If the oldest sample is part of a batch still in flight, it's no
+		 * longer resent should that batch fail.
+		 */
+		if (monitoring_buffer_in_flight > 0)
+			monitoring_buffer_in_flight--;
+
+		monitoring_buffer_head = (monitoring_buffer_head + 1) % MONITORING_HISTORY_BUFFER_SIZE;
+		monitoring_buffer_count--;
+		monitoring_buffer_dropped++;
+		repmgrd_metrics.monitoring_samples_dropped++;
 	}
 
-	/*
-	 * Verify that we can still talk to the cluster primary, even though the
-	 * node's upstream is not available
-	 */
+	monitoring_buffer[(monitoring_buffer_head + monitoring_buffer_count) % MONITORING_HISTORY_BUFFER_SIZE] = *record;
+	monitoring_buffer_count++;
+}
 
-	check_connection(&primary_node_info, &primary_conn);
 
-	if (UXSQLstatus(primary_conn) != CONNECTION_OK)
+/*
+ * Write buffered monitoring history samples to the primary.
+ *
+ * Samples are sent as a single multi-row INSERT once
+ * "monitoring_history_batch_size" samples have accumulated, or
+ * "monitoring_history_batch_interval" seconds after the previous flush.
+ * The INSERT is executed asynchronously; its result is checked on a
+ * subsequent call and the samples are discarded only once written, so
+ * buffered samples are retained while the primary is unavailable.
+ */
+static void
+flush_monitoring_history(void)
+{
+	int			batch_size = config_file_options.monitoring_history_batch_size;
+
+	if (batch_size > MONITORING_HISTORY_BUFFER_SIZE)
+		batch_size = MONITORING_HISTORY_BUFFER_SIZE;
+
+	/*
+	 * If the primary connection has been replaced, the outcome of any
+	 * INSERT in flight is unknown; the samples will be resent on a new
+	 * connection.
+	 */
+	if (monitoring_history_conn != NULL &&
+		(monitoring_history_primary_conn != primary_conn ||
+		 UXSQLstatus(primary_conn) != CONNECTION_OK ||
+		 UXSQLstatus(monitoring_history_conn) != CONNECTION_OK))
 	{
-		log_error(_("unable to connect to last known primary \"%s\" (ID: %i)"),
-				  primary_node_info.node_name,
-				  primary_node_info.node_id);
+		if (monitoring_buffer_in_flight > 0)
+		{
+			log_verbose(LOG_WARNING, _("%i monitoring history sample(s) retained for resending"),
+						monitoring_buffer_in_flight);
+			monitoring_buffer_in_flight = 0;
+		}
 
-		close_connection(&primary_conn);
-		monitoring_state = MS_DEGRADED;
-		INSTR_TIME_SET_CURRENT(degraded_monitoring_start);
-		return false;
+		close_connection(&monitoring_history_conn);
+		monitoring_history_primary_conn = NULL;
 	}
 
-	primary_type = get_recovery_type(primary_conn);
+	if (monitoring_buffer_in_flight > 0)
+	{
+		int			result = check_async_query_result(monitoring_history_conn);
+
+		/* previous batch still in progress */
+		if (result == -1)
+			return;
+
+		if (result == 1)
+		{
+			monitoring_buffer_head = (monitoring_buffer_head + monitoring_buffer_in_flight) % MONITORING_HISTORY_BUFFER_SIZE;
+			monitoring_buffer_count -= monitoring_buffer_in_flight;
+
+			if (monitoring_buffer_dropped > 0)
+			{
+				log_warning(_("%i monitoring history sample(s) were discarded while the buffer was full"),
+							monitoring_buffer_dropped);
+				monitoring_buffer_dropped = 0;
+			}
+		}
+		else
+		{
+			log_verbose(LOG_WARNING, _("%i monitoring history sample(s) retained for resending"),
+						monitoring_buffer_in_flight);
+		}
+
+		monitoring_buffer_in_flight = 0;
+	}
+
+	if (monitoring_buffer_count == 0)
+		return;
+
+	if (monitoring_buffer_count < batch_size &&
+		calculate_elapsed(last_monitoring_flush) < config_file_options.monitoring_history_batch_interval)
+		return;
+
+	if (UXSQLstatus(primary_conn) != CONNECTION_OK)
+		return;
+
+	if (monitoring_history_conn == NULL)
+	{
+		t_conninfo_param_list history_conninfo = T_CONNINFO_PARAM_LIST_INITIALIZER;
+
+		initialize_conninfo_params(&history_conninfo, false);
+		conn_to_param_list(primary_conn, &history_conninfo);
+
+		monitoring_history_conn = establish_db_connection_by_params(&history_conninfo, false);
+
+		free_conninfo_params(&history_conninfo);
+
+		if (UXSQLstatus(monitoring_history_conn) != CONNECTION_OK)
+		{
+			log_warning(_("unable to connect to the primary to write monitoring history"));
+			close_connection(&monitoring_history_conn);
+			INSTR_TIME_SET_CURRENT(last_monitoring_flush);
+			return;
+		}
+
+		monitoring_history_primary_conn = primary_conn;
+	}
+
+	if (send_monitoring_records(monitoring_history_conn, monitoring_buffer, MONITORING_HISTORY_BUFFER_SIZE,
+								monitoring_buffer_head, monitoring_buffer_count) == true)
+	{
+		log_verbose(LOG_DEBUG, "flush_monitoring_history(): %i sample(s) sent", monitoring_buffer_count);
+
+		monitoring_buffer_in_flight = monitoring_buffer_count;
+	}
+
+	INSTR_TIME_SET_CURRENT(last_monitoring_flush);
+}
+
+
+/*
+ * do_upstream_standby_failover()
+ *
+ * Attach cascaded standby to another node, currently the primary.
+ *
+ * Note that in contrast to a primary failover, where one of the downstream
+ * standby nodes will become a primary, a cascaded standby failover (where the
+ * upstream standby has gone away) is "just" a case of attaching the standby to
+ * another node.
+ *
+ * Currently we will try to attach the node to the cluster primary.
+ *
+ * TODO: As of repmgr 4.3, "repmgr standby follow" supports attaching a standby to another
+ * standby node. We need to provide a selection of reconnection strategies as different
+ * behaviour might be desirable in different situations.
+ */
+
+static bool
+do_upstream_standby_failover(void)
+{
+	t_node_info primary_node_info = T_NODE_INFO_INITIALIZER;
+	RecordStatus record_status = RECORD_NOT_FOUND;
+	RecoveryType primary_type = RECTYPE_UNKNOWN;
+	int			standby_follow_result;
+	char		parsed_follow_command[MAXUXPATH] = "";
+
+	close_connection(&upstream_conn);
+
+	/*
+	 *
+	 */
+	if (config_file_options.failover == FAILOVER_MANUAL)
+	{
+		log_notice(_("this node is not configured for automatic failover"));
+		log_detail(_("parameter \"failover\" is set to \"manual\""));
+		return false;
+	}
+
+	if (get_primary_node_record(local_conn, &primary_node_info) == false)
+	{
+		log_error(_("unable to retrieve primary node record"));
+		return false;
+	}
+
+	/*
+	 * Verify that we can still talk to the cluster primary, even though the
+	 * node's upstream is not available
+	 */
+
+	check_connection(&primary_node_info, &primary_conn);
+
+	if (UXSQLstatus(primary_conn) != CONNECTION_OK)
+	{
+		log_error(_("unable to connect to last known primary \"%s\" (ID: %i)"),
+				  primary_node_info.node_name,
+				  primary_node_info.node_id);
+
+		close_connection(&primary_conn);
+		monitoring_state = MS_DEGRADED;
+		INSTR_TIME_SET_CURRENT(degraded_monitoring_start);
+		return false;
+	}
+
+	primary_type = get_recovery_type(primary_conn);
 
 	if (primary_type != RECTYPE_PRIMARY)
 	{
@@ -3995,20 +4550,9 @@ do_upstream_standby_failover(void)
 	 * the local connection.
 	 */
 
-	for (i = 0; i < config_file_options.repmgrd_standby_startup_timeout; i++)
-	{
-		local_conn = establish_db_connection(local_node_info.conninfo, false);
-
-		if (UXSQLstatus(local_conn) == CONNECTION_OK)
-			break;
-
-		close_connection(&local_conn);
-
-		log_debug("sleeping 1 second; %i of %i (\"repmgrd_standby_startup_timeout\") attempts to reconnect to local node",
-				  i + 1,
-				  config_file_options.repmgrd_standby_startup_timeout);
-		sleep(1);
-	}
+	local_conn = wait_for_server_connection(config_file_options.data_directory,
+											local_node_info.conninfo,
+											config_file_options.repmgrd_standby_startup_timeout);
 
 	if (UXSQLstatus(local_conn) != CONNECTION_OK)
 	{
@@ -4326,6 +4870,170 @@ promote_self(void)
 }
 
 
+/*
+ * After promotion, execute a checkpoint so the control file reflects the
+ * new timeline (#177313), without waiting for it to complete; brain split
+ * checks, which rely on the control file's timeline, are deferred until
+ * it has.
+ */
+static void
+start_post_promotion_checkpoint(void)
+{
+	/* a checkpoint from an earlier promotion will have completed by now */
+	close_connection(&checkpoint_conn);
+
+	/* 提升为主节点后，执行一次checkpoint，更新control文件的时间线 */
+	checkpoint_conn = new_primary_request_checkpoint(local_node_info.conninfo);
+}
+
+
+static void
+check_post_promotion_checkpoint(void)
+{
+	int			result;
+
+	if (checkpoint_conn == NULL)
+		return;
+
+	result = check_async_query_result(checkpoint_conn);
+
+	if (result == -1)
+	{
+		log_verbose(LOG_DEBUG, "check_post_promotion_checkpoint(): checkpoint still in progress");
+		return;
+	}
+
+	if (result == 1)
+	{
+		log_info(_("checkpoint following promotion has completed"));
+	}
+	else
+	{
+		log_warning(_("checkpoint following promotion failed"));
+	}
+
+	close_connection(&checkpoint_conn);
+}
+
+
+/*
+ * Primary only: if standbys are writing monitoring history, make sure
+ * daily partitions exist for the coming days, so samples are not
+ * written to the default partition if "repmgr cluster cleanup" has not
+ * been run recently.
+ */
+static void
+create_upcoming_monitoring_history_partitions(void)
+{
+	int			partitions_created;
+
+	if (config_file_options.monitoring_history == false)
+		return;
+
+	if (partition_check_done == true &&
+		calculate_elapsed(last_partition_check) < MONITORING_HISTORY_PARTITION_CHECK_INTERVAL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(last_partition_check);
+	partition_check_done = true;
+
+	if (is_monitoring_history_partitioned(local_conn) == false)
+		return;
+
+	partitions_created = create_monitoring_history_partitions(local_conn,
+															  MONITORING_HISTORY_PARTITIONS_AHEAD);
+
+	if (partitions_created < 0)
+	{
+		log_warning(_("unable to create monitoring history partitions"));
+	}
+	else if (partitions_created > 0)
+	{
+		log_info(_("%i monitoring history partition(s) created"), partitions_created);
+	}
+}
+
+
+/*
+ * Witness only: query all other registered nodes concurrently over pooled
+ * connections, and record their state in shared memory, from where standbys
+ * holding an election can retrieve it with a single query.
+ *
+ * Unreachable nodes delay this by at most "async_query_timeout" or the
+ * monitoring interval, whichever is shorter.
+ */
+static void
+update_cluster_view(void)
+{
+	NodeInfoList nodes = T_NODE_INFO_LIST_INITIALIZER;
+	NodeInfoListCell *cell = NULL;
+	t_node_replication_info *states = NULL;
+	int			timeout_ms = config_file_options.async_query_timeout * 1000;
+	int			remaining_ms;
+	int			replied;
+	int			ix = 0;
+	instr_time	start_time;
+	instr_time	elapsed;
+
+	if (cluster_view_available == false || UXSQLstatus(local_conn) != CONNECTION_OK)
+		return;
+
+	if (timeout_ms > config_file_options.monitor_interval_ms)
+		timeout_ms = config_file_options.monitor_interval_ms;
+
+	get_other_node_records(local_conn, local_node_info.node_id, &nodes);
+
+	if (nodes.node_count == 0)
+	{
+		clear_node_info_list(&nodes);
+		return;
+	}
+
+	states = palloc0(sizeof(t_node_replication_info) * nodes.node_count);
+
+	for (cell = nodes.head; cell; cell = cell->next)
+		states[ix++].node_info = cell->node_info;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	(void) attach_pooled_connections(&nodes);
+	(void) establish_node_connections_timeout(&nodes, timeout_ms);
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start_time);
+	remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+	replied = get_node_replication_info_parallel(states,
+												 nodes.node_count,
+												 remaining_ms > 0 ? remaining_ms : 1);
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start_time);
+
+	log_debug("update_cluster_view(): %i of %i nodes replied in %.3f seconds",
+			  replied, nodes.node_count, INSTR_TIME_GET_DOUBLE(elapsed));
+
+	(void) repmgrd_set_cluster_view(local_conn, states, nodes.node_count);
+
+	release_pooled_connections(&nodes);
+	clear_node_info_list(&nodes);
+	pfree(states);
+}
+
+
+static t_cluster_node_state *
+find_cluster_node_state(t_cluster_node_state *states, int state_count, int node_id)
+{
+	int			i;
+
+	for (i = 0; i < state_count; i++)
+	{
+		if (states[i].node_id == node_id)
+			return &states[i];
+	}
+
+	return NULL;
+}
 
 
 /*
@@ -4342,6 +5050,8 @@ notify_followers(NodeInfoList *standby_nodes, int follow_node_id)
 	log_info(_("%i followers to notify"),
 			 standby_nodes->node_count);
 
+	failover_trace_phase_start(FAILOVER_PHASE_NOTIFY_FOLLOWERS);
+
 	for (cell = standby_nodes->head; cell; cell = cell->next)
 	{
 		log_verbose(LOG_DEBUG, "intending to notify node %i...", cell->node_info->node_id);
@@ -4354,7 +5064,7 @@ notify_followers(NodeInfoList *standby_nodes, int follow_node_id)
 
 			close_connection(&cell->node_info->conn);
 
-			cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
+			cell->node_info->conn = get_pooled_connection(cell->node_info);
 		}
 
 		if (UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
@@ -4383,31 +5093,44 @@ notify_followers(NodeInfoList *standby_nodes, int follow_node_id)
 		}
 		notify_follow_primary(cell->node_info->conn, follow_node_id);
 	}
+
+	failover_trace_phase_end(FAILOVER_PHASE_NOTIFY_FOLLOWERS);
 }
 
 
 static bool
 wait_primary_notification(int *new_primary_id)
 {
-	int			i;
+	instr_time	start_time;
+	instr_time	elapsed;
+	int			elapsed_ms = 0;
 
-	for (i = 0; i < config_file_options.primary_notification_timeout; i++)
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (elapsed_ms < config_file_options.primary_notification_timeout_ms)
 	{
+		int			remaining_ms;
+
 		if (get_new_primary(local_conn, new_primary_id) == true)
 		{
-			log_debug("new primary is %i; elapsed: %i seconds",
-					  *new_primary_id, i);
+			log_debug("new primary is %i; elapsed: %i milliseconds",
+					  *new_primary_id, elapsed_ms);
 			return true;
 		}
 
-		log_verbose(LOG_DEBUG, "waiting for new primary notification, %i of max %i seconds (\"primary_notification_timeout\")",
-					i, config_file_options.primary_notification_timeout);
+		log_verbose(LOG_DEBUG, "waiting for new primary notification, %i of max %i milliseconds (\"primary_notification_timeout\")",
+					elapsed_ms, config_file_options.primary_notification_timeout_ms);
+
+		remaining_ms = config_file_options.primary_notification_timeout_ms - elapsed_ms;
+		sleep_ms(remaining_ms < 1000 ? remaining_ms : 1000);
 
-		sleep(1);
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		elapsed_ms = (int) INSTR_TIME_GET_MILLISEC(elapsed);
 	}
 
-	log_warning(_("no notification received from new primary after %i seconds"),
-				config_file_options.primary_notification_timeout);
+	log_warning(_("no notification received from new primary after %i milliseconds"),
+				config_file_options.primary_notification_timeout_ms);
 
 	monitoring_state = MS_DEGRADED;
 	INSTR_TIME_SET_CURRENT(degraded_monitoring_start);
@@ -4420,7 +5143,7 @@ static FailoverState
 follow_new_primary(int new_primary_id)
 {
 	char		parsed_follow_command[MAXUXPATH] = "";
-	int			i, r;
+	int			r;
 
 	/* Store details of the failed node here */
 	t_node_info failed_primary = T_NODE_INFO_INITIALIZER;
@@ -4601,20 +5324,9 @@ follow_new_primary(int new_primary_id)
 	 * completes, so poll for a while until we get a connection.
 	 */
 
-	for (i = 0; i < config_file_options.repmgrd_standby_startup_timeout; i++)
-	{
-		local_conn = establish_db_connection(local_node_info.conninfo, false);
-
-		if (UXSQLstatus(local_conn) == CONNECTION_OK)
-			break;
-
-		close_connection(&local_conn);
-
-		log_debug("sleeping 1 second; %i of %i attempts to reconnect to local node",
-				  i + 1,
-				  config_file_options.repmgrd_standby_startup_timeout);
-		sleep(1);
-	}
+	local_conn = wait_for_server_connection(config_file_options.data_directory,
+											local_node_info.conninfo,
+											config_file_options.repmgrd_standby_startup_timeout);
 
 	if (local_conn == NULL || UXSQLstatus(local_conn) != CONNECTION_OK)
 	{
@@ -4809,6 +5521,28 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	ReplInfo	local_replication_info;
 
+	/* state of each sibling node, collected concurrently */
+	t_node_replication_info *sibling_states = NULL;
+	bool	   *sibling_eligible = NULL;
+	int			sibling_ix = 0;
+	int			election_timeout_ms = config_file_options.async_query_timeout * 1000;
+	int			remaining_ms;
+	instr_time	poll_start;
+	instr_time	poll_elapsed;
+
+	/*
+	 * State of all nodes as seen by the witness, if there is one; it may
+	 * not have updated this while itself trying to reconnect to the primary.
+	 */
+	t_cluster_node_state *witness_view = NULL;
+	int			witness_view_count = 0;
+	int			witness_view_max_age_ms = config_file_options.reconnect_attempts * config_file_options.reconnect_interval_ms
+		+ config_file_options.monitor_interval_ms * 2;
+
+	/* unreachable node which the witness recently saw ahead of this one */
+	t_node_info *witness_ahead_node = NULL;
+	XLogRecPtr	witness_ahead_lsn = InvalidXLogRecPtr;
+
 	/* To collate details of nodes with primary visible for logging purposes */
 	UXSQLExpBufferData nodes_with_primary_visible;
 
@@ -4830,7 +5564,9 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 	{
 		log_debug("sleeping %i seconds (\"failover_delay\") before initiating failover",
 				  config_file_options.failover_delay);
+		failover_trace_phase_start(FAILOVER_PHASE_FAILOVER_DELAY);
 		sleep(config_file_options.failover_delay);
+		failover_trace_phase_end(FAILOVER_PHASE_FAILOVER_DELAY);
 	}
 
 	/* we're visible */
@@ -4840,6 +5576,9 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	electoral_term = get_current_term(local_conn);
 
+	if (electoral_term != -1)
+		repmgrd_metrics.electoral_term = electoral_term;
+
 	if (electoral_term == -1)
 	{
 		log_error(_("unable to determine electoral term"));
@@ -4980,23 +5719,136 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	initUXSQLExpBuffer(&nodes_with_primary_visible);
 
+	/*
+	 * Connect to all sibling nodes and retrieve their state concurrently,
+	 * so unreachable nodes don't each delay the election by a full
+	 * connection timeout. "async_query_timeout" is used as the deadline
+	 * for the process as a whole.
+	 */
+	log_info(_("checking state of %i sibling nodes"), sibling_nodes->node_count);
+
+	sibling_states = palloc0(sizeof(t_node_replication_info) * sibling_nodes->node_count);
+	sibling_eligible = palloc0(sizeof(bool) * sibling_nodes->node_count);
+
+	for (cell = sibling_nodes->head; cell; cell = cell->next)
+	{
+		/* assume the worst case */
+		cell->node_info->node_status = NODE_STATUS_UNKNOWN;
+		sibling_states[sibling_ix].node_info = cell->node_info;
+		sibling_states[sibling_ix].request_catchup_info =
+			(config_file_options.election_ranking == ELECTION_RANKING_CATCHUP);
+		sibling_ix++;
+	}
+
+	INSTR_TIME_SET_CURRENT(poll_start);
+
+	/* reuse connections from previous elections where possible */
+	(void) attach_pooled_connections(sibling_nodes);
+	(void) establish_node_connections_timeout(sibling_nodes, election_timeout_ms);
+
+	INSTR_TIME_SET_CURRENT(poll_elapsed);
+	INSTR_TIME_SUBTRACT(poll_elapsed, poll_start);
+	remaining_ms = election_timeout_ms - (int) INSTR_TIME_GET_MILLISEC(poll_elapsed);
+
+	(void) get_node_replication_info_parallel(sibling_states,
+											  sibling_nodes->node_count,
+											  remaining_ms > 0 ? remaining_ms : 1);
+
+	INSTR_TIME_SET_CURRENT(poll_elapsed);
+	INSTR_TIME_SUBTRACT(poll_elapsed, poll_start);
+
+	log_debug("do_election(): sibling node state collected in %.3f seconds",
+			  INSTR_TIME_GET_DOUBLE(poll_elapsed));
+
+	/*
+	 * The witness monitors all nodes, so can tell us about siblings which
+	 * this node can't reach; retrieve its view of the cluster.
+	 */
+	for (sibling_ix = 0; sibling_ix < sibling_nodes->node_count; sibling_ix++)
+	{
+		t_node_info *witness_node_info = sibling_states[sibling_ix].node_info;
+
+		if (witness_node_info->type != WITNESS || sibling_states[sibling_ix].replied == false)
+			continue;
+
+		witness_view_count = repmgrd_get_cluster_view(witness_node_info->conn,
+													  witness_view_max_age_ms,
+													  &witness_view);
+
+		if (witness_view_count >= 0)
+		{
+			log_info(_("witness node \"%s\" (ID: %i) reports the state of %i nodes"),
+					 witness_node_info->node_name,
+					 witness_node_info->node_id,
+					 witness_view_count);
+		}
+		else
+		{
+			witness_view_count = 0;
+		}
+
+		break;
+	}
+
+	sibling_ix = 0;
+
 	for (cell = sibling_nodes->head; cell; cell = cell->next)
 	{
+		t_node_replication_info *sibling_state = &sibling_states[sibling_ix++];
 		ReplInfo	sibling_replication_info;
 
 		log_info(_("checking state of sibling node \"%s\" (ID: %i)"),
 				 cell->node_info->node_name,
 				 cell->node_info->node_id);
 
-		/* assume the worst case */
-		cell->node_info->node_status = NODE_STATUS_UNKNOWN;
+		if (cell->node_info->conn == NULL || UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
+		{
+			t_cluster_node_state *witness_state = NULL;
 
-		cell->node_info->conn = establish_db_connection(cell->node_info->conninfo, false);
+			if (sibling_state->query_sent == false)
+			{
+				log_info(_("unable to connect to sibling node \"%s\" (ID: %i)"),
+						 cell->node_info->node_name,
+						 cell->node_info->node_id);
+			}
 
-		if (UXSQLstatus(cell->node_info->conn) != CONNECTION_OK)
-		{
 			close_connection(&cell->node_info->conn);
 
+			/*
+			 * If the witness reached the node within the last two monitoring
+			 * intervals and it's ahead of this node, this node mustn't
+			 * promote itself. The node can't be verified from here, so it
+			 * doesn't become the candidate, and doesn't count towards the
+			 * visible nodes.
+			 */
+			witness_state = find_cluster_node_state(witness_view, witness_view_count,
+													cell->node_info->node_id);
+
+			if (witness_state != NULL &&
+				cell->node_info->type != WITNESS &&
+				cell->node_info->priority > 0 &&
+				witness_state->reachable == true &&
+				witness_state->repmgrd_running == true &&
+				witness_state->in_recovery == true &&
+				witness_state->upstream_node_id == upstream_node_info.node_id &&
+				witness_state->last_seen >= 0 &&
+				witness_state->last_seen * 1000 <= config_file_options.monitor_interval_ms * 2 &&
+				witness_state->last_wal_receive_lsn > local_node_info.last_wal_receive_lsn &&
+				witness_state->last_wal_receive_lsn > witness_ahead_lsn)
+			{
+				log_notice(_("witness reports sibling node \"%s\" (ID: %i) is reachable and ahead of this node"),
+						   cell->node_info->node_name,
+						   cell->node_info->node_id);
+				log_detail(_("last receive LSN for node \"%s\" (ID: %i) reported by the witness %i second(s) ago is %X/%X"),
+						   cell->node_info->node_name,
+						   cell->node_info->node_id,
+						   witness_state->last_seen,
+						   format_lsn(witness_state->last_wal_receive_lsn));
+
+				witness_ahead_node = cell->node_info;
+				witness_ahead_lsn = witness_state->last_wal_receive_lsn;
+			}
+
 			continue;
 		}
 
@@ -5022,12 +5874,10 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		/*
 		 * check if repmgrd running - skip if not
 		 *
-		 * TODO: include pid query in replication info query?
-		 *
 		 * NOTE: from Ux12 we could execute "ux_promote()" from a running repmgrd;
 		 * here we'll need to find a way of ensuring only one repmgrd does this
 		 */
-		if (repmgrd_get_pid(cell->node_info->conn) == UNKNOWN_PID)
+		if (sibling_state->repmgrd_pid == UNKNOWN_PID)
 		{
 			log_warning(_("repmgrd not running on node \"%s\" (ID: %i), skipping"),
 						cell->node_info->node_name,
@@ -5035,7 +5885,7 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 			continue;
 		}
 
-		if (get_replication_info(cell->node_info->conn, cell->node_info->type, &sibling_replication_info) == false)
+		if (sibling_state->replication_info_valid == false)
 		{
 			log_warning(_("unable to retrieve replication information for node \"%s\" (ID: %i), skipping"),
 						cell->node_info->node_name,
@@ -5043,6 +5893,8 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 			continue;
 		}
 
+		sibling_replication_info = sibling_state->replication_info;
+
 		/*
 		 * Check if node is not in recovery - it may have been promoted
 		 * outside of the failover mechanism, in which case we may be able
@@ -5081,6 +5933,10 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 			{
 				*new_primary_id = cell->node_info->node_id;
 				termUXSQLExpBuffer(&nodes_with_primary_visible);
+				pfree(sibling_states);
+				pfree(sibling_eligible);
+				if (witness_view != NULL)
+					pfree(witness_view);
 				return ELECTION_CANCELLED;
 			}
 
@@ -5119,11 +5975,11 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		/*
 		 * Check if node has seen primary "recently" - if so, we may have "partial primary visibility".
 		 * For now we'll assume the primary is visible if it's been seen less than
-		 * monitor_interval_secs * 2 seconds ago. We may need to adjust this, and/or make the value
+		 * two monitoring intervals ago. We may need to adjust this, and/or make the value
 		 * configurable.
 		 */
 
-		if (sibling_replication_info.upstream_last_seen >= 0 && sibling_replication_info.upstream_last_seen < (config_file_options.monitor_interval_secs * 2))
+		if (sibling_replication_info.upstream_last_seen >= 0 && sibling_replication_info.upstream_last_seen * 1000 < (config_file_options.monitor_interval_ms * 2))
 		{
 			if (sibling_replication_info.upstream_node_id != upstream_node_info.node_id)
 			{
@@ -5184,6 +6040,12 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 				 cell->node_info->node_id,
 				 format_lsn(cell->node_info->last_wal_receive_lsn));
 
+		log_debug("do_election(): node %i replied in %i ms",
+				  cell->node_info->node_id,
+				  sibling_state->response_time_ms);
+
+		sibling_eligible[sibling_ix - 1] = true;
+
 		/* compare LSN */
 		if (cell->node_info->last_wal_receive_lsn > candidate_node->last_wal_receive_lsn)
 		{
@@ -5243,6 +6105,20 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 		}
 	}
 
+	if (config_file_options.election_ranking == ELECTION_RANKING_CATCHUP)
+	{
+		candidate_node = rank_candidates_by_catchup(candidate_node,
+													sibling_states,
+													sibling_eligible,
+													sibling_nodes->node_count);
+	}
+
+	pfree(sibling_states);
+	pfree(sibling_eligible);
+
+	if (witness_view != NULL)
+		pfree(witness_view);
+
 	if (primary_location_seen == false)
 	{
 		log_notice(_("no nodes from the primary location \"%s\" visible - assuming network split"),
@@ -5283,10 +6159,10 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	termUXSQLExpBuffer(&nodes_with_primary_visible);
 
-	log_info(_("visible nodes: %i; total nodes: %i; no nodes have seen the primary within the last %i seconds"),
+	log_info(_("visible nodes: %i; total nodes: %i; no nodes have seen the primary within the last %i milliseconds"),
 			 stats.visible_nodes,
 			 stats.shared_upstream_nodes,
-			 (config_file_options.monitor_interval_secs * 2));
+			 (config_file_options.monitor_interval_ms * 2));
 
 	if (stats.visible_nodes <= (stats.shared_upstream_nodes / 2.0))
 	{
@@ -5308,6 +6184,14 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 
 	if (candidate_node->node_id == local_node_info.node_id)
 	{
+		if (witness_ahead_node != NULL)
+		{
+			log_notice(_("not promoting this node, as the witness reports node \"%s\" (ID: %i) is ahead of it"),
+					   witness_ahead_node->node_name,
+					   witness_ahead_node->node_id);
+			return ELECTION_LOST;
+		}
+
 		/*
 		 * If "failover_validation_command" is set, execute that command
 		 * and decide the result based on the command's output
@@ -5324,6 +6208,215 @@ do_election(NodeInfoList *sibling_nodes, int *new_primary_id)
 	return ELECTION_LOST;
 }
 
+/*
+ * With "election_ranking=catchup", choose between candidates which have
+ * received the same amount of WAL by how long each will take to replay WAL
+ * it has received but not yet applied, as the new primary can't accept
+ * connections until it has done so. The estimate is the amount of WAL
+ * pending replay divided by the rate at which the node was replaying WAL.
+ *
+ * Every node taking part in the election must arrive at the same result,
+ * so neither value is taken from the node's current state, which changes
+ * while the election runs and is queried by each node at a different time;
+ * both are taken from the node's last lag sample from before it lost its
+ * upstream (see get_catchup_info()), which no longer changes once the
+ * primary has gone. For siblings this is retrieved together with their
+ * state in do_election(), so no further queries are made here.
+ *
+ * All candidates within CATCHUP_RANKING_MARGIN_MS of the fastest are then
+ * ranked by priority and node ID as usual. The selection is made over the
+ * whole set of candidates, so doesn't depend on the order in which each
+ * node compares its siblings. If the estimate can't be made for any
+ * candidate, the LSN-based result is kept.
+ *
+ * Connection round-trip times are logged but not used for ranking, as
+ * each node measures a different value (and its own as zero).
+ */
+static t_node_info *
+rank_candidates_by_catchup(t_node_info *candidate_node,
+						   t_node_replication_info *sibling_states, bool *sibling_eligible,
+						   int sibling_count)
+{
+	t_node_info *best_node = NULL;
+	XLogRecPtr	receive_lsn = candidate_node->last_wal_receive_lsn;
+	double		local_catchup_ms = -1;
+	double	   *sibling_catchup_ms = NULL;
+	double		min_catchup_ms = -1;
+	int			tied_count = 0;
+	bool		local_tied = false;
+	bool		candidate_tied = false;
+	bool		estimates_complete = true;
+	int			i;
+
+	/* determine which candidates have received as much WAL as the current one */
+	if (local_node_info.last_wal_receive_lsn == receive_lsn)
+	{
+		local_tied = true;
+		tied_count++;
+
+		if (candidate_node == &local_node_info)
+			candidate_tied = true;
+	}
+
+	for (i = 0; i < sibling_count; i++)
+	{
+		if (sibling_eligible[i] == false)
+			continue;
+
+		if (sibling_states[i].node_info->last_wal_receive_lsn != receive_lsn)
+		{
+			sibling_eligible[i] = false;
+			continue;
+		}
+
+		tied_count++;
+
+		if (sibling_states[i].node_info == candidate_node)
+			candidate_tied = true;
+	}
+
+	/*
+	 * The candidate may be a node reported by the witness, which can't be
+	 * queried from here.
+	 */
+	if (tied_count < 2 || candidate_tied == false)
+		return candidate_node;
+
+	log_info(_("%i nodes have received WAL up to %X/%X, ranking by estimated catch-up time"),
+			 tied_count,
+			 format_lsn(receive_lsn));
+
+	sibling_catchup_ms = palloc0(sizeof(double) * sibling_count);
+
+	if (local_tied == true)
+	{
+		t_catchup_info local_catchup_info;
+
+		(void) get_catchup_info(local_conn, &local_catchup_info);
+
+		local_catchup_ms = estimate_catchup_ms(&local_node_info, &local_catchup_info, receive_lsn);
+
+		if (local_catchup_ms < 0)
+			estimates_complete = false;
+		else
+			min_catchup_ms = local_catchup_ms;
+	}
+
+	for (i = 0; i < sibling_count && estimates_complete == true; i++)
+	{
+		if (sibling_eligible[i] == false)
+			continue;
+
+		log_info(_("node \"%s\" (ID: %i) replied in %i ms"),
+				 sibling_states[i].node_info->node_name,
+				 sibling_states[i].node_info->node_id,
+				 sibling_states[i].response_time_ms);
+
+		sibling_catchup_ms[i] = estimate_catchup_ms(sibling_states[i].node_info,
+													&sibling_states[i].catchup_info,
+													receive_lsn);
+
+		if (sibling_catchup_ms[i] < 0)
+			estimates_complete = false;
+		else if (min_catchup_ms < 0 || sibling_catchup_ms[i] < min_catchup_ms)
+			min_catchup_ms = sibling_catchup_ms[i];
+	}
+
+	if (estimates_complete == false)
+	{
+		log_notice(_("unable to estimate catch-up time for all candidates, keeping candidate \"%s\" (ID: %i)"),
+				   candidate_node->node_name,
+				   candidate_node->node_id);
+		pfree(sibling_catchup_ms);
+		return candidate_node;
+	}
+
+	/* among the fastest candidates, prefer higher priority, then lower node ID */
+	if (local_tied == true && local_catchup_ms <= min_catchup_ms + CATCHUP_RANKING_MARGIN_MS)
+		best_node = &local_node_info;
+
+	for (i = 0; i < sibling_count; i++)
+	{
+		t_node_info *node_info = sibling_states[i].node_info;
+
+		if (sibling_eligible[i] == false)
+			continue;
+
+		if (sibling_catchup_ms[i] > min_catchup_ms + CATCHUP_RANKING_MARGIN_MS)
+			continue;
+
+		if (best_node == NULL
+			|| node_info->priority > best_node->priority
+			|| (node_info->priority == best_node->priority && node_info->node_id < best_node->node_id))
+			best_node = node_info;
+	}
+
+	pfree(sibling_catchup_ms);
+
+	if (best_node != candidate_node)
+	{
+		log_notice(_("node \"%s\" (ID: %i) is expected to catch up faster than candidate \"%s\" (ID: %i)"),
+				   best_node->node_name,
+				   best_node->node_id,
+				   candidate_node->node_name,
+				   candidate_node->node_id);
+	}
+
+	return best_node;
+}
+
+
+/*
+ * Estimate, in milliseconds, how long the node will take to replay the WAL
+ * up to "receive_lsn" from the point recorded in "catchup_info"; returns
+ * -1 if this can't be determined.
+ */
+static double
+estimate_catchup_ms(t_node_info *node_info, t_catchup_info *catchup_info, XLogRecPtr receive_lsn)
+{
+	XLogRecPtr	pending_bytes = 0;
+	double		catchup_ms;
+
+	if (catchup_info->valid == false)
+	{
+		log_info(_("no lag history available for node \"%s\" (ID: %i)"),
+				 node_info->node_name,
+				 node_info->node_id);
+		return -1;
+	}
+
+	if (receive_lsn > catchup_info->replay_lsn)
+		pending_bytes = receive_lsn - catchup_info->replay_lsn;
+
+	if (pending_bytes == 0)
+	{
+		log_info(_("node \"%s\" (ID: %i) had no WAL pending replay"),
+				 node_info->node_name,
+				 node_info->node_id);
+		return 0;
+	}
+
+	if (catchup_info->replay_rate <= 0)
+	{
+		log_info(_("unable to determine WAL replay rate for node \"%s\" (ID: %i)"),
+				 node_info->node_name,
+				 node_info->node_id);
+		return -1;
+	}
+
+	catchup_ms = (double) pending_bytes / catchup_info->replay_rate * 1000;
+
+	log_info(_("node \"%s\" (ID: %i) had %lu bytes of WAL pending replay at %.0f bytes/s; estimated catch-up time %.0f ms"),
+			 node_info->node_name,
+			 node_info->node_id,
+			 (unsigned long) pending_bytes,
+			 catchup_info->replay_rate,
+			 catchup_ms);
+
+	return catchup_ms;
+}
+
+
 /*
  * "failover" for the witness node; the witness has no part in the election
  * other than being reachable, so just needs to await notification from the
@@ -5521,13 +6614,33 @@ format_failover_state(FailoverState failover_state)
 static void
 handle_sighup(UXconn **conn, t_server_type server_type)
 {
+	int			changes = 0;
+
 	log_notice(_("received SIGHUP, reloading configuration"));
 
-	if (reload_config(server_type))
+	/*
+	 * Changed settings take effect in place; connections are only reopened
+	 * if parameters affecting them have changed, so that e.g. changing
+	 * "log_level" doesn't interrupt monitoring.
+	 */
+	if (reload_config(server_type, &changes))
 	{
-		close_connection(conn);
+		set_local_command_timeout(config_file_options.local_command_timeout);
+
+		if (changes & (CONFIG_CHANGE_CONNINFO | CONFIG_CHANGE_CONNECTION))
+		{
+			/* node connection parameters may have changed */
+			clear_connection_pool();
+		}
+
+		if (changes & CONFIG_CHANGE_CONNINFO)
+		{
+			log_info(_("\"conninfo\" changed, reconnecting to local node"));
 
-		*conn = establish_db_connection(config_file_options.conninfo, true);
+			close_connection(conn);
+
+			*conn = establish_db_connection(config_file_options.conninfo, true);
+		}
 	}
 
 	if (*config_file_options.log_file)
@@ -5774,6 +6887,7 @@ check_node_can_follow(UXconn *local_conn, XLogRecPtr local_xlogpos, UXconn *foll
 		 * upstream has higher timeline - check where it forked off from this node's timeline
 		 */
 		follow_target_history = get_timeline_history(follow_target_repl_conn,
+													 local_identification.system_identifier,
 													 local_identification.timeline + 1);
 
 		if (follow_target_history == NULL)
@@ -5998,12 +7112,21 @@ parse_child_nodes_disconnect_command(char *parsed_command, char *template, int r
 }
 
 
+/*
+ * Attempt to reconnect to the primary according to the schedule set up by
+ * reconnect_schedule_init(); see there for details.
+ *
+ * Each connection attempt is made without blocking, so it can be abandoned
+ * as soon as a notification is received that another node has been
+ * promoted, in which case that node's ID is returned.
+ */
 int
 try_primary_reconnect(UXconn **conn, UXconn *local_conn, t_node_info *node_info)
 {
 	t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
-	int			i;
-	int			max_attempts = config_file_options.reconnect_attempts;
+	t_reconnect_schedule schedule;
+	int			attempt;
+	int			new_primary_node_id = UNKNOWN_NODE_ID;
 
 	initialize_conninfo_params(&conninfo_params, false);
 
@@ -6014,134 +7137,254 @@ try_primary_reconnect(UXconn **conn, UXconn *local_conn, t_node_info *node_info)
 	param_set_ine(&conninfo_params, "connect_timeout", "2");
 	param_set_ine(&conninfo_params, "fallback_application_name", "repmgr");
 
-	for (i = 0; i < max_attempts; i++)
+	reconnect_schedule_init(&schedule, node_info->node_id);
+
+	/* the experimental synchronised loop relies on fixed intervals */
+	if (config_file_options.reconnect_loop_sync == true)
+		schedule.backoff = false;
+
+	while ((attempt = reconnect_schedule_begin_attempt(&schedule)) > 0)
 	{
-		time_t started_at = time(NULL);
-		int up_to;
-		bool sleep_now = false;
-		int max_sleep_seconds;
+		UXconn	   *our_conn = NULL;
+		ConnStatusType status = CONNECTION_BAD;
+		int			max_sleep_ms;
 
-		log_info(_("checking state of node \"%s\" (ID: %i), %i of %i attempts"),
-				 node_info->node_name,
-				 node_info->node_id,
-				 i + 1, max_attempts);
+		if (schedule.backoff == true)
+		{
+			log_info(_("checking state of node \"%s\" (ID: %i), attempt %i"),
+					 node_info->node_name,
+					 node_info->node_id,
+					 attempt);
+		}
+		else
+		{
+			log_info(_("checking state of node \"%s\" (ID: %i), %i of %i attempts"),
+					 node_info->node_name,
+					 node_info->node_id,
+					 attempt, schedule.max_attempts);
+		}
+
+		/*
+		 * Note: we could also handle the case where node is reachable but
+		 * connection denied due to connection exhaustion, by falling back to
+		 * degraded monitoring (make configurable)
+		 */
+		our_conn = start_reconnection(&conninfo_params, local_conn, &status, &new_primary_node_id);
+
+		if (new_primary_node_id != UNKNOWN_NODE_ID)
+		{
+			/* the abandoned connection attempt may still be open */
+			close_connection(&our_conn);
+			free_conninfo_params(&conninfo_params);
+			return new_primary_node_id;
+		}
 
-		if (is_server_available_params(&conninfo_params) == true)
+		if (status == CONNECTION_OK)
 		{
-			UXconn	   *our_conn;
+			free_conninfo_params(&conninfo_params);
 
-			log_notice(_("node \"%s\" (ID: %i) has recovered, reconnecting"),
+			log_notice(_("node \"%s\" (ID: %i) has recovered, reconnected"),
 					   node_info->node_name,
 					   node_info->node_id);
 
-			/*
-			 * Note: we could also handle the case where node is pingable but
-			 * connection denied due to connection exhaustion, by falling back to
-			 * degraded monitoring (make configurable)
-			 */
-			our_conn = establish_db_connection_by_params(&conninfo_params, false);
-
-			if (UXSQLstatus(our_conn) == CONNECTION_OK)
+			if (UXSQLstatus(*conn) == CONNECTION_BAD)
 			{
-				free_conninfo_params(&conninfo_params);
+				log_verbose(LOG_INFO, _("original connection handle returned CONNECTION_BAD, using new connection"));
+				close_connection(conn);
+				*conn = our_conn;
+			}
+			else
+			{
+				ExecStatusType ping_result;
 
-				log_info(_("connection to node \"%s\" (ID: %i) succeeded"),
-						 node_info->node_name,
-						 node_info->node_id);
+				ping_result = connection_ping(*conn);
 
-				if (UXSQLstatus(*conn) == CONNECTION_BAD)
+				if (ping_result != UXRES_TUPLES_OK)
 				{
-					log_verbose(LOG_INFO, _("original connection handle returned CONNECTION_BAD, using new connection"));
+					log_info(_("original connection no longer available, using new connection"));
 					close_connection(conn);
 					*conn = our_conn;
 				}
 				else
 				{
-					ExecStatusType ping_result;
+					log_info(_("original connection is still available"));
+
+					UXSQLfinish(our_conn);
+				}
+			}
 
-					ping_result = connection_ping(*conn);
+			node_info->node_status = NODE_STATUS_UP;
 
-					if (ping_result != UXRES_TUPLES_OK)
-					{
-						log_info(_("original connection no longer available, using new connection"));
-						close_connection(conn);
-						*conn = our_conn;
-					}
-					else
-					{
-						log_info(_("original connection is still available"));
+			return UNKNOWN_NODE_ID;
+		}
+
+		close_connection(&our_conn);
+		log_notice(_("unable to reconnect to node \"%s\" (ID: %i)"),
+				   node_info->node_name,
+				   node_info->node_id);
+
+		/*
+		 * Experimental behaviour, see GitHub #662.
+		 */
+		if (config_file_options.reconnect_loop_sync == true)
+		{
+			instr_time	elapsed;
+			int			up_to_ms;
+
+			INSTR_TIME_SET_CURRENT(elapsed);
+			INSTR_TIME_SUBTRACT(elapsed, schedule.attempt_start);
+			up_to_ms = (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+			max_sleep_ms = (up_to_ms == 0 || config_file_options.reconnect_interval_ms == 0)
+				? config_file_options.reconnect_interval_ms
+				: (up_to_ms % config_file_options.reconnect_interval_ms);
+		}
+		else
+		{
+			max_sleep_ms = reconnect_schedule_next_delay(&schedule);
+
+			if (max_sleep_ms < 0)
+				break;
+		}
+
+		log_info(_("sleeping up to %i milliseconds until next reconnection attempt"),
+				 max_sleep_ms);
+
+		if (wait_for_new_primary(local_conn, max_sleep_ms, &new_primary_node_id) == true)
+		{
+			free_conninfo_params(&conninfo_params);
+			return new_primary_node_id;
+		}
+	}
+
+	log_warning(_("unable to reconnect to node \"%s\" (ID: %i) after %i attempts"),
+				node_info->node_name,
+				node_info->node_id,
+				schedule.attempt);
+
+	node_info->node_status = NODE_STATUS_DOWN;
+
+	free_conninfo_params(&conninfo_params);
+
+	return UNKNOWN_NODE_ID;
+}
+
+
+/*
+ * Make a non-blocking connection attempt using "conninfo_params", checking
+ * at least once a second whether a new primary has been notified.
+ *
+ * Returns the connection handle (which may be NULL), with "*status" set to
+ * CONNECTION_OK if the connection was established. If a new primary was
+ * notified, "*new_primary_node_id" is set to its ID and the attempt is
+ * abandoned.
+ */
+static UXconn *
+start_reconnection(t_conninfo_param_list *conninfo_params, UXconn *local_conn, ConnStatusType *status, int *new_primary_node_id)
+{
+	UXconn	   *conn = NULL;
+	UXSQLPollingStatusType poll_status = UXRES_POLLING_WRITING;
+	int			connect_timeout_ms = -1;
+	instr_time	start_time;
+
+	*status = CONNECTION_BAD;
+
+	conn = start_db_connection_by_params(conninfo_params, &connect_timeout_ms);
+
+	if (conn == NULL)
+		return NULL;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (;;)
+	{
+		int			slice_ms = 1000;
 
-						UXSQLfinish(our_conn);
-					}
-				}
+		if (connect_timeout_ms > 0)
+		{
+			instr_time	elapsed;
+			int			remaining_ms;
 
-				node_info->node_status = NODE_STATUS_UP;
+			INSTR_TIME_SET_CURRENT(elapsed);
+			INSTR_TIME_SUBTRACT(elapsed, start_time);
+			remaining_ms = connect_timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
 
-				return UNKNOWN_NODE_ID;
+			if (remaining_ms <= 0)
+			{
+				log_verbose(LOG_DEBUG, "start_reconnection(): connection attempt timed out after %i ms",
+							connect_timeout_ms);
+				return conn;
 			}
 
-			close_connection(&our_conn);
-			log_notice(_("unable to reconnect to node \"%s\" (ID: %i)"),
-					   node_info->node_name,
-					   node_info->node_id);
+			if (remaining_ms < slice_ms)
+				slice_ms = remaining_ms;
 		}
 
-		/*
-		 * Experimental behaviour, see GitHub #662.
-		 */
-		if (config_file_options.reconnect_loop_sync == true)
-		{
-			up_to = (time(NULL) - started_at);
-			max_sleep_seconds = (up_to == 0)
-				? config_file_options.reconnect_interval
-				: (up_to % config_file_options.reconnect_interval);
-			if (i + 1 <= max_attempts)
-				sleep_now = true;
-		}
-		else
+		*status = poll_db_connection(conn, &poll_status, slice_ms);
+
+		if (*status != CONNECTION_STARTED)
+			break;
+
+		if (wait_for_new_primary(local_conn, 0, new_primary_node_id) == true)
 		{
-			max_sleep_seconds = config_file_options.reconnect_interval;
-			if (i + 1 < max_attempts)
-				sleep_now = true;
+			*status = CONNECTION_BAD;
+			break;
 		}
+	}
+
+	if (*status != CONNECTION_OK)
+		*status = CONNECTION_BAD;
+
+	return conn;
+}
+
+
+/*
+ * Wait up to "timeout_ms" milliseconds for notification of a new primary,
+ * checking at least once a second; with a "timeout_ms" of 0, check just
+ * once. Returns true, with "*new_primary_node_id" set, if one was received.
+ */
+static bool
+wait_for_new_primary(UXconn *local_conn, int timeout_ms, int *new_primary_node_id)
+{
+	instr_time	start_time;
+	int			remaining_ms = timeout_ms;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (;;)
+	{
+		instr_time	elapsed;
+		int			primary_node_id = UNKNOWN_NODE_ID;
 
-		if (sleep_now == true)
+		if (get_new_primary(local_conn, &primary_node_id) == true && primary_node_id != UNKNOWN_NODE_ID)
 		{
-			int j;
-			log_info(_("sleeping up to %i seconds until next reconnection attempt"),
-					 max_sleep_seconds);
-			for (j = 0; j < max_sleep_seconds; j++)
+			if (primary_node_id == ELECTION_RERUN_NOTIFICATION)
 			{
-				int new_primary_node_id;
-				if (get_new_primary(local_conn, &new_primary_node_id) == true && new_primary_node_id != UNKNOWN_NODE_ID)
-				{
-					if (new_primary_node_id == ELECTION_RERUN_NOTIFICATION)
-					{
-						log_notice(_("received rerun notification"));
-					}
-					else
-					{
-						log_notice(_("received notification that new primary is node %i"), new_primary_node_id);
-					}
-
-					free_conninfo_params(&conninfo_params);
-					return new_primary_node_id;
-				}
-				sleep(1);
+				log_notice(_("received rerun notification"));
+			}
+			else
+			{
+				log_notice(_("received notification that new primary is node %i"), primary_node_id);
 			}
+
+			*new_primary_node_id = primary_node_id;
+			return true;
 		}
-	}
 
-	log_warning(_("unable to reconnect to node \"%s\" (ID: %i) after %i attempts"),
-				node_info->node_name,
-				node_info->node_id,
-				max_attempts);
+		if (remaining_ms <= 0)
+			return false;
 
-	node_info->node_status = NODE_STATUS_DOWN;
+		/* check for a new primary at least once a second */
+		sleep_ms(remaining_ms < 1000 ? remaining_ms : 1000);
 
-	free_conninfo_params(&conninfo_params);
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
 
-	return UNKNOWN_NODE_ID;
+		if (remaining_ms <= 0)
+			return false;
+	}
 }
 
 
@@ -6286,14 +7529,18 @@ signalAlarm(int signum)
  * check network card status
  * UP return 1, DOWN return 0
  * tianbing
+ *
+ * The state is taken from the netlink link-state table maintained by
+ * linkstate.c; sysfs is only read for cards it is not tracking.
  */
 static bool
 check_network_card_status(UXconn *conn, int node_id)
 {
-	FILE *pf = NULL;
 	char    network_card[MAXLEN] = "";
-	UXSQLExpBufferData str;
-	int value;
+	char   *pNetworkcardsArray[MAX_AMOUNT] = {NULL};
+	int		iNetworkcardCount = 0;
+	bool	card_status = true;
+	int		i;
 
 	if(NULL == conn)
 	{
@@ -6301,53 +7548,62 @@ check_network_card_status(UXconn *conn, int node_id)
 		return true;
 	}
 
-	if (get_network_card(conn, node_id, network_card))
+	if (!get_network_card(conn, node_id, network_card))
 	{
-		initUXSQLExpBuffer(&str);
-		appendUXSQLExpBuffer(&str, "/sys/class/net/%s/carrier", network_card);
-			
-		pf = fopen(str.data, "r");
-				termUXSQLExpBuffer(&str);
+	//	if (config_file_options.log_switch)
+	//		log_debug(_("didn't get network card, return true "));
+
+		return true;
+	}
 
-		if(!pf)
+	iNetworkcardCount = parse_multi_networkcard(network_card, pNetworkcardsArray);
+
+	for (i = 0; i < iNetworkcardCount; i++)
+	{
+		LinkState	link_state = get_link_state(pNetworkcardsArray[i]);
+
+		if (link_state == LINK_STATE_UNKNOWN)
 		{
-			log_warning(_("can not open file:%s"), str.data);
-			return true;
-		}
+			UXSQLExpBufferData str;
+			FILE	   *pf = NULL;
+			int			value;
 
-		value = fgetc(pf) - 48;
-		
-		fclose(pf);
+			initUXSQLExpBuffer(&str);
+			appendUXSQLExpBuffer(&str, "/sys/class/net/%s/carrier", pNetworkcardsArray[i]);
+
+			pf = fopen(str.data, "r");
 
 			if (!pf)
 			{
 				log_warning(_("can not open file:%s"), str.data);
+				termUXSQLExpBuffer(&str);
 				continue;
 			}
 
+			termUXSQLExpBuffer(&str);
+
 			value = fgetc(pf) - 48;
 			fclose(pf);
 
-			if (value != 1)
-			{
-				log_warning(_("end check network card: %s,return false, value:%d, status is DOWN "), pNetworkcardsArray[i], value);
-				card_status = false;
-			}
+			link_state = (value == 1) ? LINK_STATE_UP : LINK_STATE_DOWN;
 		}
-		else
+
+		if (link_state == LINK_STATE_DOWN)
 		{
-			ux_free(pNetworkcardsArray[i]);
-			pNetworkcardsArray[i] = NULL;
+			log_warning(_("end check network card: %s,return false, status is DOWN "), pNetworkcardsArray[i]);
+			card_status = false;
 		}
-		
 	}
-	else
-	{
-	//	if (config_file_options.log_switch)
-	//		log_debug(_("didn't get network card, return true "));
 
-		return true;
+	/* BEGIN Added by chen_jingwen for #207866 at 2025/01/14 */
+	for (i = 0; i < iNetworkcardCount; i++)
+	{
+		ux_free(pNetworkcardsArray[i]);
+		pNetworkcardsArray[i] = NULL;
 	}
+	/* END Added by chen_jingwen for #207866 at 2025/01/14 */
+
+	return card_status;
 }
 
 /*
@@ -6357,55 +7613,9 @@ check_network_card_status(UXconn *conn, int node_id)
 static bool
 check_service_status_command(const char *command, UXSQLExpBufferData *outputbuf)
 {
-	FILE       *fp = NULL;
-	char        output[MAXLEN];
-	int         retval = 0;
-	bool        success;
-
-	log_verbose(LOG_DEBUG, "executing:\n  %s", command);
-
-	if (outputbuf == NULL)
-	{
-		retval = ux_system(command);
-		if(retval == 0)
-			return true;
-		else
-		{
-			log_error(_("ux_system() unable to execute local command:\n%s, ret=%d"), command, retval);
-			return false;
-		}
-	}
-
-	fp = popen(command, "r");
-
-	if (fp == NULL)
-	{
-		log_error(_("popen() unable to execute local command:\n%s"), command);
-		return false;
-	}
-
-	while (fgets(output, MAXLEN, fp) != NULL)
-	{
-		appendUXSQLExpBuffer(outputbuf, "%s", output);
-		if (!feof(fp))
-		{
-			break;
-		}
-	}
-
-	retval = pclose(fp);
-
-	/*  */
-	success = (WEXITSTATUS(retval) == 0 || WEXITSTATUS(retval) == 141) ? true : false;
-
-	log_verbose(LOG_DEBUG, "result of command was %i (%i)", WEXITSTATUS(retval), retval);
-
-	if (outputbuf->data != NULL)
-		log_verbose(LOG_DEBUG, "local_command(): output returned was:\n%s", outputbuf->data);
-	else
-		log_verbose(LOG_DEBUG, "local_command(): no output returned");
-
-	return success;
+	/* only the first line is of interest, and must not include any STDERR output */
+	return run_local_command(command, outputbuf, true, false,
+							 config_file_options.async_query_timeout * 1000, NULL);
 }
 
 
@@ -6514,7 +7724,6 @@ exec_node_rejoin_primary(NodeInfoList *my_node_list)
 		if (status == NODE_STATUS_UNCLEAN_SHUTDOWN)
 		{
 			/*start and stop the service*/
-			UXSQLExpBufferData stop_service_command_str;
 			bool standby_file_flag = false;
 			log_notice("unclean shutdown detected, start and stop db to clean");
 
@@ -6525,21 +7734,16 @@ exec_node_rejoin_primary(NodeInfoList *my_node_list)
 			}
 			/* END:  Added by huyn for #176436, 2023/2/10  reviewer:zhangwj,wangyh */
 
-			initUXSQLExpBuffer(&stop_service_command_str);
-	
-			/* Modified by zhangxin for #180836 on 2023/4/14, reviewer duankun */
-			/* start和stop之间增加2秒延时，避免stop时collector进程未完全启动导致数据库异常退出 */
-			appendUXSQLExpBuffer(&stop_service_command_str,
-					"%s/ux_ctl -D %s start;sleep 2;",
-					config_file_options.ux_bindir, config_file_options.data_directory);
-	
-			appendUXSQLExpBuffer(&stop_service_command_str,
-					"%s/ux_ctl -D %s stop",
-					config_file_options.ux_bindir, config_file_options.data_directory);
-
-			ux_system(stop_service_command_str.data);
+			/*
+			 * Wait until the server is ready before stopping it, so the
+			 * collector process has been started (#180836).
+			 */
+			start_server_and_wait(config_file_options.data_directory,
+								  local_node_info.conninfo,
+								  config_file_options.repmgrd_standby_startup_timeout);
+			stop_server(config_file_options.data_directory,
+						config_file_options.promote_check_timeout);
 
-			termUXSQLExpBuffer(&stop_service_command_str);
 			/* BEGIN:  Added by huyn for #176436, 2023/2/10  reviewer:zhangwj,wangyh */
 			/* 在执行完数据库的启动停止后，删除掉standby.single */
 			delete_standby_single_file(standby_file_flag);
@@ -6610,32 +7814,32 @@ exec_node_rejoin_primary(NodeInfoList *my_node_list)
 static void
 check_sync_async(NodeInfoList *my_node_list)
 {
-	char sync_names[MAXLEN] = { 0 };
-	char sync_names_record[MAXLEN] = { 0 };
+	UXSQLExpBufferData sync_names;
+	UXSQLExpBufferData sync_names_record;
 	int nums = 0;  
 	int nums_record = 0;  /* 同步配置的要求的最少节点数量 */
-	UXresult *res = NULL;
 	int unreachable_standby_elapsed;
-	static short unreachable_standby_counts = 0;
 	int max_attempts = config_file_options.try_synchronous_connection_timeout;
 	bool success = false;
 	int records = -1;
 	int switch_mode = 0; /* 0: do nothing, 1: check sync->async, 2: check async->sync */
 	int sync_potential_nums = 0;
 	int quorum_nums = 0;
-	int confinfo;
-	char node_names[NODENUMS + 1][MAXLEN] = { {0} };  /* 当配置具体节点名称时,目前支持最多10个节点的管理,配置'*'时无限制 */
 	static bool pflag = true;
+	t_replication_snapshot *snapshot = NULL;
 
 	/* 参数获取失败,直接返回 */
-	success = get_ux_setting(local_conn, "synchronous_standby_names", sync_names);
+	initUXSQLExpBuffer(&sync_names);
+	success = get_ux_setting_buffer(local_conn, "synchronous_standby_names", &sync_names);
 	if(!success)
 	{
 		log_error(_("can not obtain 'synchronous_standby_names' value, do not switch repliction mode"));
+		termUXSQLExpBuffer(&sync_names);
 		return;
 	}
 
-	success = get_ux_setting(local_conn, "synchronous_standby_names_record", sync_names_record);
+	initUXSQLExpBuffer(&sync_names_record);
+	success = get_ux_setting_buffer(local_conn, "synchronous_standby_names_record", &sync_names_record);
 	if(!success)
 	{
 		/* 旧版本无此参数,对旧版本做部分兼容:支持同步切异步,不支持异步切同步 */
@@ -6645,7 +7849,15 @@ check_sync_async(NodeInfoList *my_node_list)
 	else
 	{
 		/* synchronous_standby_names_record 代表高可用部署的初始状态,若无值,则没有同步节点配置,无需切换 */
-		nums_record = parser_nums_synchronous_standby_names(sync_names_record);
+		if (parse_sync_standby_names(sync_names_record.data, &sync_standby_names_record) == false)
+		{
+			log_error(_("can not switch async to sync mode"));
+			termUXSQLExpBuffer(&sync_names);
+			termUXSQLExpBuffer(&sync_names_record);
+			return;
+		}
+
+		nums_record = sync_standby_names_record.num_sync;
 		if(0 == nums_record)
 		{
 			/* 每次守护进程启动只打印一次此信息 */
@@ -6654,103 +7866,86 @@ check_sync_async(NodeInfoList *my_node_list)
 				pflag = false;
 				log_info(_("no requirement of switching repliction mode for synchronous configuration"));
 			}
+			termUXSQLExpBuffer(&sync_names);
+			termUXSQLExpBuffer(&sync_names_record);
 			return;
 		}
 	}
 
+	termUXSQLExpBuffer(&sync_names_record);
+
 	/* 根据当前参数值,判断后面需要做哪种切换检查 */
-	nums = parser_nums_synchronous_standby_names(sync_names);
+	success = parse_sync_standby_names(sync_names.data, &sync_standby_names_current);
+	termUXSQLExpBuffer(&sync_names);
+
+	if (success == false)
+		return;
+
+	nums = sync_standby_names_current.num_sync;
 	if(nums != 0)
 		switch_mode = 1;  /* 后续做同步切异步的检查 */
 	else
 		switch_mode = 2;  /* 后续做异步切同步的检查 */
 
+	/* a switch in the other direction restarts the stability period */
+	if (switch_mode == 1)
+		INSTR_TIME_SET_ZERO(sync_standby_recovery_start);
+	else
+		unreachable_standby_counts = 0;
+
 	if(switch_mode ==2 && nums_record == -1)
 	{
 		log_warning(_("incompatible with older versions, unable to switch async to sync mode"));
 		return;
 	}
 
+	snapshot = get_cycle_replication_snapshot();
+
 	switch (switch_mode)
 	{
 		case 1:
-			res = UXSQLexec(local_conn, "SELECT count(*) FROM ux_stat_replication WHERE sync_state = 'sync' or sync_state = 'potential'" 
-										" UNION ALL SELECT count(*) FROM ux_stat_replication WHERE sync_state = 'quorum';");
-			if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+			if (snapshot->valid == false)
 			{
 				log_error(_("unable to execute query at switch_mode: %d"), switch_mode);
-				/* Added by chen_jingwen for #207866 at 2024/10/8 */
-				UXSQLclear(res);
-				res = NULL;
 				return;
 			}
-			sync_potential_nums = atoi(UXSQLgetvalue(res, 0, 0));
-			quorum_nums = atoi(UXSQLgetvalue(res, 1, 0));
+			sync_potential_nums = count_replication_stats(snapshot, "sync")
+				+ count_replication_stats(snapshot, "potential");
+			quorum_nums = count_replication_stats(snapshot, "quorum");
 			/* sync_potential_nums 和 quorum_nums 必有一个 0,而 nums 必大于0*/
 			if (quorum_nums < nums && sync_potential_nums < nums)
 				/* will try to do sync->async */
 				break;
-			else
-			{
-				/* Added by chen_jingwen for #207866 at 2024/10/8 */
-				UXSQLclear(res);
-				res = NULL;
-				return;  /* no need switch*/
-			}
-			break;
+
+			/*
+			 * The synchronous standbys are available (again), so a later
+			 * outage must be timed from its own start.
+			 */
+			if (unreachable_standby_counts > 0)
+				log_notice(_("synchronous standby node is reachable again"));
+			unreachable_standby_counts = 0;
+			return;  /* no need switch*/
 		case 2:
-			confinfo = parser_info_synchronous_standby_names(sync_names_record);
-			if (confinfo == 0)
+			if (sync_standby_names_record.wildcard == true)
 			{
-				strcpy(node_names[0], "*");
 				/* 若有'*'配置,则当前存活节点 >= nums_record 都可以尝试进行切换 */
-				res = UXSQLexec(local_conn, "SELECT count(*) FROM ux_stat_replication;");
-				if (UXSQLresultStatus(res) != UXRES_TUPLES_OK)
+				if (snapshot->valid == false)
 				{
 					log_error(_("unable to execute query at switch_mode: %d"), switch_mode);
-					/* Added by chen_jingwen for #207866 at 2024/10/8 */
-					UXSQLclear(res);
-					res = NULL;
 					return;
 				}
-				records = atoi(UXSQLgetvalue(res, 0, 0));
-				if(records >= nums_record)
-					break;	/* will try to do sync->async */
-				else
+				records = count_replication_stats(snapshot, NULL);
+				if(records < nums_record)
 				{
-					/* Added by chen_jingwen for #207866 at 2024/10/8 */
-					UXSQLclear(res);
-					res = NULL;
+					INSTR_TIME_SET_ZERO(sync_standby_recovery_start);
 					return;  /* no need switch*/
-				}	
-			}
-			else if (confinfo == 1)
-			{
-				/* 若无'*'配置,则需要获取每一个节点名称 */
-				if (parser_nodename_synchronous_standby_names(sync_names_record, node_names))
-				{
-					break;
-				}
-				else
-				{
-					log_error(_("can not switch async to sync mode"));
-					return;
 				}
 			}
-			else
-			{
-				log_notice(_("no need switch async to sync mode"));    /* should not happen */
-				return;
-			}
 			break;
 		default:
 			break;
 	}
 
-	/* Added by chen_jingwen for #207866 at 2024/10/8 */
-	UXSQLclear(res);
-	res = NULL;
-
 	/* sync -> async 模式切换 */
 	if (switch_mode == 1)
 	{
@@ -6789,171 +7984,56 @@ check_sync_async(NodeInfoList *my_node_list)
 	else if(switch_mode == 2)  /* async -> sync 模式切换 */
 	{
 		int match_num = 0;
-		unreachable_standby_counts = 0;
-		
-		match_num = get_match_async_node_num(my_node_list, node_names);
+		int recovery_elapsed = 0;
 
-		/*sync standby is reachable*/
-		if (match_num >= nums_record)
-		{
-			log_warning(_("synchronous standby node's LSN is lag Primary node for 5 MB bound"));
-			/* Modified by houjiaxing for #201574 at 2024/1/29 reviewer:wangbocai */
-			/*async mode recover to sync mode*/
-			success = alter_system_str( local_conn,
-										"synchronous_standby_names",
-										"DEFAULT");
-			if (success)
-				success = ux_reload_conf(local_conn);
+		match_num = get_match_async_node_num(my_node_list, &sync_standby_names_record);
 
-			if (success)
-			{
-				log_notice(_("switched async mode to sync mode successful"));
-			}
-			else
-				log_warning(_("switched async mode to sync mode failed"));
-		}
-		else
+		if (match_num < nums_record)
 		{
+			INSTR_TIME_SET_ZERO(sync_standby_recovery_start);
 			log_notice(_("no nodes with good status, not time to Recovery sync Mode."));
+			return;
 		}
-	}
-	else
-		log_notice(_("switch do noting"));  /* should not happen */
-
-	return;
-}
-
-/* 
- * parse the number of required synchronization nodes
- */
-int 
-parser_nums_synchronous_standby_names(char *sync_names)
-{
-	int i, len;
-	int ret = 0;
-	char *p = NULL;
-	char tmp[MAXLEN] = { 0 };
 
-	len = strlen(sync_names);
-
-	if (len == 0)
-		return ret;
+		/*
+		 * Only switch back once the standbys have stayed caught up for
+		 * "synchronous_recovery_delay" seconds, so a standby which keeps
+		 * reconnecting doesn't cause a configuration change and reload on
+		 * every cycle.
+		 */
+		if (INSTR_TIME_IS_ZERO(sync_standby_recovery_start))
+			INSTR_TIME_SET_CURRENT(sync_standby_recovery_start);
 
-	strcpy(tmp, sync_names);
+		recovery_elapsed = calculate_elapsed(sync_standby_recovery_start);
 
-	if((p = strcasestr(tmp,"any")) != NULL)
-	{
-		for (i = 0; i <= len; i++)
-		{
-			if (tmp[i] == '(')
-			{
-				tmp[i] = '\0';
-				break;
-			}
-		}
-		ret = atoi(p+3);
-	}
-	else if((p = strcasestr(sync_names,"first")) != NULL)
-	{
-		for (i = 0; i <= len; i++)
+		if (recovery_elapsed < config_file_options.synchronous_recovery_delay)
 		{
-			if (tmp[i] == '(')
-			{
-				tmp[i] = '\0';
-				break;
-			}
+			log_notice(_("synchronous standby nodes have been available for %i of %i seconds (\"synchronous_recovery_delay\")"),
+					   recovery_elapsed, config_file_options.synchronous_recovery_delay);
+			return;
 		}
-		ret = atoi(p+5);
-	}
-	else
-		ret = 1;
-
-	return ret;
-}
-
-/* BEGIN: Modify by liuxw for #205414, 2024/04/19 reviewer:hanlx */
-/* 
- * parse info of sync_names, 
- * return 0: 配置中有 *, 包括: '*', 'any/first n (*)'
- *        1: 配置中无 *, 即配置为节点名称的集合
- *       -1: error, 配置为空
- */
-int 
-parser_info_synchronous_standby_names(char *sync_names)
-{
-	int len;
-	int ret = -1;
-
-	len = strlen(sync_names);
-
-	if (len == 0)
-		return ret;
-
-	if (strstr(sync_names, "*") != NULL)
-		ret = 0;
-	else
-		ret = 1;
-
-	return ret;
-}
-/* END: Modify by liuxw for #205414, 2024/04/19 reviewer:hanlx */
 
-/* 
- * parse node names of sync_names
- */
-bool 
-parser_nodename_synchronous_standby_names(char *sync_names, char nodename[][MAXLEN])
-{
-	int   i, j, len;
-	char *p = NULL,*s = NULL;
-	char *token = NULL;
-	char tmp[MAXLEN] = { 0 };
-
-	len = strlen(sync_names);
-
-	if (len == 0)
-		return false;    /* should not happen */
-
-	strcpy(tmp, sync_names);
-
-	/* 摘取()中的内容 */
-	if ((s = strstr(tmp, ")")) != NULL)
-	{
-		*s = '\0';
-		s = strstr(tmp, "(");
-		if (s != NULL) s++;
-	}
-	else
-		s = tmp;
+		/*sync standby is reachable*/
+		log_warning(_("synchronous standby node's LSN is lag Primary node for 5 MB bound"));
+		/* Modified by houjiaxing for #201574 at 2024/1/29 reviewer:wangbocai */
+		/*async mode recover to sync mode*/
+		success = alter_system_str( local_conn,
+									"synchronous_standby_names",
+									"DEFAULT");
+		if (success)
+			success = ux_reload_conf(local_conn);
 
-	/* 剔除空格 */
-	i = j = 0;
-	while (s[j] != '\0')
-	{
-		if (s[j] != ' ')
+		if (success)
 		{
-			s[i++] = s[j];
+			log_notice(_("switched async mode to sync mode successful"));
 		}
-		j++;
-	}
-	s[i] = '\0';
-
-	i = 0;
-	token = strtok_r(s, ",", &p);
-	while (token != NULL && i < NODENUMS)
-	{
-		strcpy(nodename[i], token);
-		token = strtok_r(NULL, ",", &p);
-		i++;
-	}
-
-	if (i >=  NODENUMS)
-	{
-		log_error(_("switch management to manage up to %d nodes"), NODENUMS);
-		return false;
+		else
+			log_warning(_("switched async mode to sync mode failed"));
 	}
+	else
+		log_notice(_("switch do noting"));  /* should not happen */
 
-	return true;
+	return;
 }
 
 /**
@@ -7459,63 +8539,54 @@ stop_the_service(void)
 }
 
 /* 
- * Return the number of nodes whose data very close to the primary
+ * Return the number of nodes listed in "sync_names" whose data very close
+ * to the primary
  */
 static int
-get_match_async_node_num(NodeInfoList *my_node_list, char nodename[][MAXLEN])
+get_match_async_node_num(NodeInfoList *my_node_list, t_sync_standby_names *sync_names)
 {
 	NodeInfoListCell *mycell = NULL;
 	XLogRecPtr      primary_last_wal_location = InvalidXLogRecPtr;
-	XLogRecPtr      last_wal_receive_lsn;
 	long long unsigned int  lag_bytes;
 	int matchnum = 0;
-	int i = 0;
+	t_replication_snapshot *snapshot = get_cycle_replication_snapshot();
+	t_replication_stat *stat = NULL;
+
+	if (snapshot->valid == false)
+		return 0;
 
 	/* 逐一检测是否存在数据差异小的节点 */
 	primary_last_wal_location = get_primary_current_lsn(local_conn);
 
 	for (mycell = my_node_list->head; mycell; mycell = mycell->next)
 	{
-		/* 首节点名称不为'*'再做节点名称检查,否则对所有节点均可以做检查 */
-		if (strcmp("*", nodename[0]) != 0)
-		{
-			for (i = 0; i < NODENUMS; i++)
-			{
-				if (strcmp(mycell->node_info->node_name, nodename[i]) == 0)
-					break;
-				else 
-					continue;
-			}
+		/* this node(mycell) does not belong to the management of 'synchronous_standby_names' */
+		if (sync_standby_names_contains(sync_names, mycell->node_info->node_name) == false)
+			continue;
 
-			/* this node(mycell) does not belong to the management of 'synchronous_standby_names' */
-			if(i >= NODENUMS)
-				continue;
-		}
+		/*
+		 * 跳过主节点和尚未恢复节点; the flush location reported in the
+		 * primary's ux_stat_replication is used, so standbys need not be
+		 * connected to individually.
+		 */
+		if (mycell->node_info->node_id == config_file_options.node_id)
+			continue;
 
-		/* 跳过主节点和尚未恢复节点 */
-		mycell->node_info->conn = establish_db_connection(mycell->node_info->conninfo, false);
-		if (UXSQLstatus(mycell->node_info->conn) != CONNECTION_OK ||
-			get_recovery_type(mycell->node_info->conn) == RECTYPE_PRIMARY)
-		{
-			UXSQLfinish(mycell->node_info->conn);
-			mycell->node_info->conn = NULL;
+		stat = find_replication_stat(snapshot, mycell->node_info->node_name);
+		if (stat == NULL || stat->duplicate == true || stat->flush_lsn == InvalidXLogRecPtr)
 			continue;
-		}
 
 		/* 计算此节点和主节点的lsn差额 */
-		last_wal_receive_lsn = get_last_wal_receive_location(mycell->node_info->conn);
 		if (primary_last_wal_location != InvalidXLogRecPtr
-		&& primary_last_wal_location >= last_wal_receive_lsn)
+		&& primary_last_wal_location >= stat->flush_lsn)
 		{
-			lag_bytes = (long long unsigned int)(primary_last_wal_location - last_wal_receive_lsn);
+			lag_bytes = (long long unsigned int)(primary_last_wal_location - stat->flush_lsn);
 			log_notice(_("synchronous standby node's (%s) LSN is lag Primary for %lld MB  ..."), mycell->node_info->conninfo, lag_bytes / 1048576);
 
 			/* 若满足,增加节点数累计 */
 			if (lag_bytes <= 1024 * 1024 * 5)
 				matchnum++;
 		}
-		UXSQLfinish(mycell->node_info->conn);
-		mycell->node_info->conn = NULL;
 	}
 
 	return matchnum;
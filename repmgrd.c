@@ -23,12 +23,18 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #include "repmgr.h"
 #include "repmgrd.h"
 #include "repmgrd-physical.h"
 #include "configfile.h"
 #include "voting.h"
+#include "eventqueue.h"
+#include "linkstate.h"
+#include "metrics.h"
+#include "nodecache.h"
 
 #define OPT_HELP	1
 
@@ -57,6 +63,35 @@ instr_time	degraded_monitoring_start;
  */
 volatile sig_atomic_t got_SIGHUP = false;
 
+/*
+ * Self-pipe written to by signal handlers, so wait_for_event() wakes up
+ * immediately if a signal arrives just before it starts waiting.
+ */
+static int	wakeup_pipe[2] = {-1, -1};
+
+/*
+ * Cache of idle connections to other nodes, so connections to siblings
+ * and followers can be reused across monitoring cycles and failover
+ * attempts rather than being re-established each time.
+ *
+ * Connections are removed from the pool while in use ("checked out"), so
+ * a connection handle is only ever referenced in one place; a checked-out
+ * connection which is closed rather than returned is simply not reused.
+ */
+#define CONNECTION_POOL_SIZE 16
+#define CONNECTION_POOL_CHECK_TIMEOUT_MS 2000
+
+typedef struct
+{
+	int			node_id;
+	char		conninfo[MAXLEN];
+	UXconn	   *conn;
+	instr_time	last_used;
+} t_pooled_connection;
+
+static t_pooled_connection connection_pool[CONNECTION_POOL_SIZE];
+static int	connection_pool_count = 0;
+
 static void show_help(void);
 static void show_usage(void);
 static void daemonize_process(void);
@@ -64,6 +99,10 @@ static void check_and_create_pid_file(const char *pid_file);
 
 static void start_monitoring(void);
 
+static int	find_pooled_connection(t_node_info *node_info);
+static void remove_pooled_connection(int ix, bool close_conn);
+static int	check_pooled_connections(UXconn **conns, bool *alive, int count);
+
 
 #ifndef WIN32
 static void setup_event_handlers(void);
@@ -259,6 +298,9 @@ main(int argc, char **argv)
 	 */
 	load_config(config_file, verbose, false, argv[0]);
 
+	/* don't let a hung command stall monitoring or failover */
+	set_local_command_timeout(config_file_options.local_command_timeout);
+
 	/* Determine pid file location, unless --no-pid-file supplied */
 
 	if (no_pid_file == false)
@@ -525,6 +567,14 @@ main(int argc, char **argv)
 		daemonize_process();
 	}
 
+	/*
+	 * From here on, log messages are written by a separate thread (unless
+	 * "log_async" is disabled), so a slow log destination can't hold up
+	 * monitoring; this needs to happen after daemonizing, as the thread
+	 * would not survive the fork.
+	 */
+	(void) logger_enable_async(&config_file_options);
+
 	if (pid_file[0] != '\0')
 	{
 		check_and_create_pid_file(pid_file);
@@ -537,6 +587,27 @@ main(int argc, char **argv)
 	setup_event_handlers();
 #endif
 
+	/*
+	 * Track network card state via netlink notifications; if this is not
+	 * available, check_network_card_status() reads sysfs instead.
+	 */
+	(void) link_state_monitor_start();
+
+	/*
+	 * Start the metrics endpoint, if configured; this is also needed to
+	 * initialise the metrics themselves.
+	 */
+	(void) metrics_server_start(config_file_options.metrics_listen_address,
+								config_file_options.metrics_port);
+
+	/*
+	 * From here on, write event records and execute notification commands
+	 * asynchronously, so monitoring and failover don't wait for them.
+	 */
+	event_queue_init(config_file_options.event_notification_queue_size,
+					 config_file_options.event_notification_max_parallel,
+					 config_file_options.event_notification_timeout);
+
 	start_monitoring();
 
 	logger_shutdown();
@@ -745,12 +816,31 @@ check_and_create_pid_file(const char *pid_file)
 static void
 handle_sighup(SIGNAL_ARGS)
 {
+	int			save_errno = errno;
+
 	got_SIGHUP = true;
+
+	if (wakeup_pipe[1] != -1)
+		(void) write(wakeup_pipe[1], "x", 1);
+
+	errno = save_errno;
 }
 
 static void
 setup_event_handlers(void)
 {
+	if (pipe(wakeup_pipe) == 0)
+	{
+		(void) fcntl(wakeup_pipe[0], F_SETFL, fcntl(wakeup_pipe[0], F_GETFL) | O_NONBLOCK);
+		(void) fcntl(wakeup_pipe[1], F_SETFL, fcntl(wakeup_pipe[1], F_GETFL) | O_NONBLOCK);
+	}
+	else
+	{
+		log_warning(_("unable to create signal wakeup pipe"));
+		log_detail("%s", strerror(errno));
+		wakeup_pipe[0] = wakeup_pipe[1] = -1;
+	}
+
 	uxsqlsignal(SIGHUP, handle_sighup);
 
 	/*
@@ -948,15 +1038,145 @@ check_upstream_connection(UXconn **conn, const char *conninfo, UXconn **paired_c
 }
 
 
+/*
+ * Initialise a schedule for attempts to reconnect to "node_id".
+ *
+ * With "reconnect_backoff" disabled, there will be "reconnect_attempts"
+ * attempts, "reconnect_interval" apart. Otherwise attempts start
+ * RECONNECT_BACKOFF_INITIAL_MS apart, with the interval doubling after
+ * each attempt up to "reconnect_interval", and continue until the time
+ * the last of the "reconnect_attempts" fixed-interval attempts would have
+ * been made; a brief outage is therefore noticed sooner without changing
+ * how long it takes to give up on the node.
+ *
+ * Each interval is varied by up to "reconnect_jitter" percent, using a
+ * sequence seeded from our node ID, so that standbys which lost their
+ * upstream at the same time don't all retry in lockstep.
+ */
+void
+reconnect_schedule_init(t_reconnect_schedule *schedule, int node_id)
+{
+	memset(schedule, 0, sizeof(t_reconnect_schedule));
+
+	schedule->max_attempts = config_file_options.reconnect_attempts;
+	schedule->backoff = (config_file_options.reconnect_backoff == true &&
+						 config_file_options.reconnect_interval_ms > RECONNECT_BACKOFF_INITIAL_MS);
+	schedule->interval_ms = schedule->backoff == true
+		? RECONNECT_BACKOFF_INITIAL_MS
+		: config_file_options.reconnect_interval_ms;
+
+	if (schedule->max_attempts > 1)
+		schedule->window_ms = (schedule->max_attempts - 1) * config_file_options.reconnect_interval_ms;
+
+	schedule->jitter_seed = (unsigned int) (config_file_options.node_id * 7919 + node_id) ^ (unsigned int) getpid();
+
+	INSTR_TIME_SET_CURRENT(schedule->start_time);
+}
+
+
+/*
+ * Begin the next reconnection attempt, returning its number (starting
+ * from 1), or -1 if no further attempts are to be made.
+ */
+int
+reconnect_schedule_begin_attempt(t_reconnect_schedule *schedule)
+{
+	/* with backoff, reconnect_schedule_next_delay() determines the last attempt */
+	if (schedule->attempt >= schedule->max_attempts && schedule->backoff == false)
+		return -1;
+
+	if (schedule->max_attempts <= 0)
+		return -1;
+
+	INSTR_TIME_SET_CURRENT(schedule->attempt_start);
+
+	return ++schedule->attempt;
+}
+
+
+/*
+ * Return the number of milliseconds to wait, from now, before beginning
+ * the next attempt, or -1 if the current one was the last. Time spent in
+ * the current attempt counts towards the interval.
+ */
+int
+reconnect_schedule_next_delay(t_reconnect_schedule *schedule)
+{
+	instr_time	elapsed;
+	int			delay_ms = schedule->interval_ms;
+	int			jitter = config_file_options.reconnect_jitter;
+
+	if (schedule->backoff == false && schedule->attempt >= schedule->max_attempts)
+		return -1;
+
+	if (schedule->backoff == true)
+	{
+		if (schedule->last_attempt == true)
+			return -1;
+
+		if (jitter > 0)
+		{
+			int			spread = (delay_ms * jitter) / 100;
+
+			if (spread > 0)
+				delay_ms += (int) (rand_r(&schedule->jitter_seed) % (2 * spread + 1)) - spread;
+		}
+
+		schedule->interval_ms *= 2;
+		if (schedule->interval_ms > config_file_options.reconnect_interval_ms)
+			schedule->interval_ms = config_file_options.reconnect_interval_ms;
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, schedule->attempt_start);
+	delay_ms -= (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+	if (delay_ms < 0)
+		delay_ms = 0;
+
+	if (schedule->backoff == true)
+	{
+		int			remaining_ms = reconnect_schedule_remaining_ms(schedule);
+
+		if (remaining_ms <= 0)
+			return -1;
+
+		if (delay_ms >= remaining_ms)
+		{
+			delay_ms = remaining_ms;
+			schedule->last_attempt = true;
+		}
+	}
+
+	return delay_ms;
+}
+
+
+/*
+ * Milliseconds remaining until the point at which the last attempt is
+ * to be made.
+ */
+int
+reconnect_schedule_remaining_ms(t_reconnect_schedule *schedule)
+{
+	instr_time	elapsed;
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, schedule->start_time);
+
+	return schedule->window_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+}
+
+
 void
 try_reconnect(UXconn **conn, t_node_info *node_info)
 {
 	UXconn	   *our_conn;
 	t_conninfo_param_list conninfo_params = T_CONNINFO_PARAM_LIST_INITIALIZER;
 
-	int			i;
-
-	int			max_attempts = config_file_options.reconnect_attempts;
+	t_reconnect_schedule schedule;
+	int			attempt;
+	int			delay_ms;
 
 	initialize_conninfo_params(&conninfo_params, false);
 
@@ -967,10 +1187,21 @@ try_reconnect(UXconn **conn, t_node_info *node_info)
 	param_set_ine(&conninfo_params, "connect_timeout", "2");
 	param_set_ine(&conninfo_params, "fallback_application_name", "repmgr");
 
-	for (i = 0; i < max_attempts; i++)
+	reconnect_schedule_init(&schedule, node_info->node_id);
+
+	while ((attempt = reconnect_schedule_begin_attempt(&schedule)) > 0)
 	{
-		log_info(_("checking state of node %i, %i of %i attempts"),
-				 node_info->node_id, i + 1, max_attempts);
+		if (schedule.backoff == true)
+		{
+			log_info(_("checking state of node %i, attempt %i"),
+					 node_info->node_id, attempt);
+		}
+		else
+		{
+			log_info(_("checking state of node %i, %i of %i attempts"),
+					 node_info->node_id, attempt, schedule.max_attempts);
+		}
+
 		if (is_server_available_params(&conninfo_params) == true)
 		{
 			log_notice(_("node %i has recovered, reconnecting"), node_info->node_id);
@@ -988,6 +1219,11 @@ try_reconnect(UXconn **conn, t_node_info *node_info)
 
 				log_info(_("connection to node %i succeeded"), node_info->node_id);
 
+				if (node_info->node_id == config_file_options.node_id)
+					repmgrd_metrics.local_reconnects++;
+				else
+					repmgrd_metrics.upstream_reconnects++;
+
 				if (UXSQLstatus(*conn) == CONNECTION_BAD)
 				{
 					log_verbose(LOG_INFO, _("original connection handle returned CONNECTION_BAD, using new connection"));
@@ -1028,7 +1264,7 @@ try_reconnect(UXconn **conn, t_node_info *node_info)
 							check_vip_conf(config_file_options.virtual_ip, config_file_options.network_card))
 
 				{
-					bind_virtual_ip(config_file_options.virtual_ip, config_file_options.network_card);
+					bind_virtual_ip(config_file_options.virtual_ip, config_file_options.network_card, config_file_options.uxdb_password);
 				}
 				/* END:  Added by songjinzhou for #132171, 2022/1/24  reviewer:zdl */
 
@@ -1041,17 +1277,19 @@ try_reconnect(UXconn **conn, t_node_info *node_info)
 					   node_info->node_id);
 		}
 
-		if (i + 1 < max_attempts)
-		{
-			log_info(_("sleeping %i seconds until next reconnection attempt"),
-					 config_file_options.reconnect_interval);
-			sleep(config_file_options.reconnect_interval);
-		}
+		delay_ms = reconnect_schedule_next_delay(&schedule);
+
+		if (delay_ms < 0)
+			break;
+
+		log_info(_("sleeping %i milliseconds until next reconnection attempt"),
+				 delay_ms);
+		sleep_ms(delay_ms);
 	}
 
 	log_warning(_("unable to reconnect to node %i after %i attempts"),
 				node_info->node_id,
-				max_attempts);
+				schedule.attempt);
 
 	node_info->node_status = NODE_STATUS_DOWN;
 
@@ -1075,6 +1313,500 @@ calculate_elapsed(instr_time start_time)
 }
 
 
+/*
+ * Wait for up to "timeout_ms" milliseconds, returning early if a signal
+ * is received, a network card loses its carrier or, if "conn" is provided,
+ * the server closes the connection.
+ *
+ * This replaces a plain sleep() between monitoring iterations, so that
+ * e.g. an upstream server shutting down is acted on immediately rather
+ * than at the start of the next monitoring interval. Note that a host
+ * becoming unreachable without closing the connection can only be
+ * detected via TCP keepalives or the next connection check.
+ */
+WaitResult
+wait_for_event(int timeout_ms, UXconn *conn)
+{
+	instr_time	start_time;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (;;)
+	{
+		struct pollfd pollfds[4];
+		int			nfds = 0;
+		int			link_ix = -1;
+		int			metrics_ix = -1;
+		int			conn_ix = -1;
+		int			remaining_ms;
+		int			ret;
+		instr_time	elapsed;
+
+		if (got_SIGHUP)
+			return WAIT_SIGNAL;
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+		if (remaining_ms <= 0)
+			return WAIT_TIMEOUT;
+
+		if (wakeup_pipe[0] != -1)
+		{
+			pollfds[nfds].fd = wakeup_pipe[0];
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
+		}
+
+		if (link_state_monitor_socket() != -1)
+		{
+			link_ix = nfds;
+			pollfds[nfds].fd = link_state_monitor_socket();
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
+		}
+
+		if (metrics_server_socket() != -1)
+		{
+			metrics_ix = nfds;
+			pollfds[nfds].fd = metrics_server_socket();
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
+		}
+
+		if (conn != NULL && UXSQLstatus(conn) == CONNECTION_OK && UXSQLsocket(conn) >= 0)
+		{
+			conn_ix = nfds;
+			pollfds[nfds].fd = UXSQLsocket(conn);
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
+		}
+
+		ret = poll(pollfds, nfds, remaining_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_warning(_("wait_for_event(): poll() returned with error"));
+			log_detail("%s", strerror(errno));
+
+			/* fall back to waiting out the remaining time */
+			sleep((remaining_ms + 999) / 1000);
+			return WAIT_TIMEOUT;
+		}
+
+		if (ret == 0)
+			return WAIT_TIMEOUT;
+
+		if (wakeup_pipe[0] != -1 && pollfds[0].revents != 0)
+		{
+			char		buf[16];
+
+			while (read(wakeup_pipe[0], buf, sizeof(buf)) > 0)
+				;
+
+			return WAIT_SIGNAL;
+		}
+
+		if (link_ix != -1 && pollfds[link_ix].revents != 0)
+		{
+			if (link_state_monitor_process() == true)
+				return WAIT_LINK_EVENT;
+		}
+
+		if (metrics_ix != -1 && pollfds[metrics_ix].revents != 0)
+			metrics_server_process();
+
+		if (conn_ix != -1 && pollfds[conn_ix].revents != 0)
+		{
+			/*
+			 * The connection is idle, so anything received is either a
+			 * notice, a notification (which may be of interest to the node
+			 * record cache), the result of a previously sent asynchronous
+			 * query, or the server terminating the connection.
+			 */
+			if (UXSQLconsumeInput(conn) == 0 || UXSQLstatus(conn) != CONNECTION_OK)
+			{
+				log_debug("wait_for_event(): connection closed by server");
+				return WAIT_CONNECTION_EVENT;
+			}
+
+			node_cache_process_notifies(conn);
+		}
+	}
+}
+
+
+/*
+ * Sleep for "interval_ms" milliseconds; unlike wait_for_event(), this
+ * is not interrupted by signals, so is suitable for retry loops.
+ */
+void
+sleep_ms(int interval_ms)
+{
+	struct timespec remaining;
+
+	if (interval_ms <= 0)
+		return;
+
+	remaining.tv_sec = interval_ms / 1000;
+	remaining.tv_nsec = (long) (interval_ms % 1000) * 1000000L;
+
+	while (nanosleep(&remaining, &remaining) == -1 && errno == EINTR)
+		;
+}
+
+
+/*
+ * Return a connection to the node described by "node_info", reusing an
+ * idle pooled connection if one is available and still usable, otherwise
+ * establishing a new one.
+ *
+ * The connection should be returned to the pool with
+ * release_pooled_connection() when no longer needed.
+ */
+UXconn *
+get_pooled_connection(t_node_info *node_info)
+{
+	int			ix = find_pooled_connection(node_info);
+
+	if (ix != -1)
+	{
+		UXconn	   *conn = connection_pool[ix].conn;
+		bool		alive = false;
+
+		remove_pooled_connection(ix, false);
+
+		(void) check_pooled_connections(&conn, &alive, 1);
+
+		if (alive == true)
+		{
+			log_verbose(LOG_DEBUG, "get_pooled_connection(): reusing connection to node %i",
+						node_info->node_id);
+			return conn;
+		}
+
+		UXSQLfinish(conn);
+	}
+
+	return establish_db_connection(node_info->conninfo, false);
+}
+
+
+/*
+ * For each node in the list without an open connection, check out an
+ * idle pooled connection, if one exists. Pooled connections are checked
+ * concurrently, so unresponsive nodes delay this by at most
+ * CONNECTION_POOL_CHECK_TIMEOUT_MS in total.
+ *
+ * Nodes with no usable pooled connection are left with "conn" set to NULL.
+ *
+ * Returns the number of connections reused.
+ */
+int
+attach_pooled_connections(NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+	UXconn	  **conns = NULL;
+	bool	   *alive = NULL;
+	int			count = 0;
+	int			reused = 0;
+	int			i;
+
+	if (node_list->node_count <= 0 || connection_pool_count == 0)
+		return 0;
+
+	conns = palloc0(sizeof(UXconn *) * node_list->node_count);
+	alive = palloc0(sizeof(bool) * node_list->node_count);
+
+	for (cell = node_list->head; cell; cell = cell->next)
+	{
+		int			ix;
+
+		if (cell->node_info->conn != NULL)
+			continue;
+
+		ix = find_pooled_connection(cell->node_info);
+
+		if (ix == -1)
+			continue;
+
+		cell->node_info->conn = connection_pool[ix].conn;
+		remove_pooled_connection(ix, false);
+		conns[count++] = cell->node_info->conn;
+	}
+
+	(void) check_pooled_connections(conns, alive, count);
+
+	i = 0;
+	for (cell = node_list->head; cell && i < count; cell = cell->next)
+	{
+		if (cell->node_info->conn != conns[i])
+			continue;
+
+		if (alive[i] == true)
+		{
+			log_verbose(LOG_DEBUG, "attach_pooled_connections(): reusing connection to node %i",
+						cell->node_info->node_id);
+			reused++;
+		}
+		else
+		{
+			close_connection(&cell->node_info->conn);
+		}
+
+		i++;
+	}
+
+	pfree(conns);
+	pfree(alive);
+
+	return reused;
+}
+
+
+/*
+ * Return the node's connection to the pool if it is usable, otherwise
+ * close it; in either case the node's "conn" field is reset.
+ *
+ * If the pool is full, the least recently used connection is closed.
+ */
+void
+release_pooled_connection(t_node_info *node_info)
+{
+	int			ix;
+
+	if (node_info->conn == NULL)
+		return;
+
+	if (UXSQLstatus(node_info->conn) != CONNECTION_OK || UXSQLisBusy(node_info->conn) == 1)
+	{
+		close_connection(&node_info->conn);
+		return;
+	}
+
+	/* replace any existing pooled connection to this node */
+	ix = find_pooled_connection(node_info);
+
+	if (ix != -1)
+		remove_pooled_connection(ix, true);
+
+	if (connection_pool_count == CONNECTION_POOL_SIZE)
+	{
+		int			oldest = 0;
+
+		for (ix = 1; ix < connection_pool_count; ix++)
+		{
+			if (INSTR_TIME_GET_DOUBLE(connection_pool[ix].last_used) < INSTR_TIME_GET_DOUBLE(connection_pool[oldest].last_used))
+				oldest = ix;
+		}
+
+		remove_pooled_connection(oldest, true);
+	}
+
+	ix = connection_pool_count++;
+
+	connection_pool[ix].node_id = node_info->node_id;
+	strncpy(connection_pool[ix].conninfo, node_info->conninfo, MAXLEN);
+	connection_pool[ix].conn = node_info->conn;
+	INSTR_TIME_SET_CURRENT(connection_pool[ix].last_used);
+
+	node_info->conn = NULL;
+}
+
+
+/*
+ * Return all connections in the list to the pool; call this before
+ * clearing or repopulating a list whose connections may be reused.
+ */
+void
+release_pooled_connections(NodeInfoList *node_list)
+{
+	NodeInfoListCell *cell = NULL;
+
+	for (cell = node_list->head; cell; cell = cell->next)
+	{
+		release_pooled_connection(cell->node_info);
+	}
+}
+
+
+/*
+ * Close all pooled connections, e.g. after a configuration reload.
+ */
+void
+clear_connection_pool(void)
+{
+	while (connection_pool_count > 0)
+		remove_pooled_connection(connection_pool_count - 1, true);
+}
+
+
+/*
+ * Find the pooled connection for the node, discarding it if the node's
+ * conninfo has changed since the connection was made.
+ */
+static int
+find_pooled_connection(t_node_info *node_info)
+{
+	int			ix;
+
+	for (ix = 0; ix < connection_pool_count; ix++)
+	{
+		if (connection_pool[ix].node_id != node_info->node_id)
+			continue;
+
+		if (strncmp(connection_pool[ix].conninfo, node_info->conninfo, MAXLEN) != 0)
+		{
+			log_verbose(LOG_DEBUG, "find_pooled_connection(): conninfo for node %i changed, discarding pooled connection",
+						node_info->node_id);
+			remove_pooled_connection(ix, true);
+			return -1;
+		}
+
+		return ix;
+	}
+
+	return -1;
+}
+
+
+static void
+remove_pooled_connection(int ix, bool close_conn)
+{
+	if (close_conn == true)
+		close_connection(&connection_pool[ix].conn);
+
+	connection_pool_count--;
+
+	if (ix < connection_pool_count)
+		connection_pool[ix] = connection_pool[connection_pool_count];
+}
+
+
+/*
+ * Verify idle connections are still usable, by sending a trivial query
+ * (as connection_ping() does) to each connection at once and waiting up to
+ * CONNECTION_POOL_CHECK_TIMEOUT_MS for all replies; unlike connection_ping()
+ * this can't block indefinitely if a node has silently disappeared.
+ *
+ * Sets "alive" for each connection; returns the number of usable connections.
+ */
+static int
+check_pooled_connections(UXconn **conns, bool *alive, int count)
+{
+	struct pollfd *pollfds = NULL;
+	int		   *pollfd_ix = NULL;
+	instr_time	start_time;
+	int			pending = 0;
+	int			alive_count = 0;
+	int			i;
+
+	if (count <= 0)
+		return 0;
+
+	pollfds = palloc0(sizeof(struct pollfd) * count);
+	pollfd_ix = palloc0(sizeof(int) * count);
+
+	for (i = 0; i < count; i++)
+	{
+		alive[i] = false;
+
+		/* discard anything received while idle, and detect closed connections */
+		if (UXSQLconsumeInput(conns[i]) == 0 || UXSQLstatus(conns[i]) != CONNECTION_OK)
+			continue;
+
+		if (UXSQLsendQuery(conns[i], "SELECT TRUE") == 0)
+			continue;
+
+		/* check_async_query_result() will set this to false on error */
+		alive[i] = true;
+		pending++;
+	}
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	while (pending > 0)
+	{
+		instr_time	elapsed;
+		int			remaining_ms;
+		int			nfds = 0;
+		int			ret;
+
+		INSTR_TIME_SET_CURRENT(elapsed);
+		INSTR_TIME_SUBTRACT(elapsed, start_time);
+		remaining_ms = CONNECTION_POOL_CHECK_TIMEOUT_MS - (int) INSTR_TIME_GET_MILLISEC(elapsed);
+
+		if (remaining_ms <= 0)
+			break;
+
+		for (i = 0; i < count; i++)
+		{
+			if (alive[i] == false || UXSQLisBusy(conns[i]) == 0)
+				continue;
+
+			pollfds[nfds].fd = UXSQLsocket(conns[i]);
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			pollfd_ix[nfds] = i;
+			nfds++;
+		}
+
+		/* if no connections are busy, all results just need collecting */
+		ret = poll(pollfds, nfds, nfds == 0 ? 0 : remaining_ms);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_warning(_("unable to poll pooled connections"));
+			log_detail("%s", strerror(errno));
+			break;
+		}
+
+		pending = 0;
+
+		for (i = 0; i < count; i++)
+		{
+			int			result;
+
+			if (alive[i] == false)
+				continue;
+
+			result = check_async_query_result(conns[i]);
+
+			if (result == 0)
+				alive[i] = false;
+			else if (result == -1)
+				pending++;
+		}
+	}
+
+	/* anything still busy did not respond in time */
+	for (i = 0; i < count; i++)
+	{
+		if (alive[i] == true && UXSQLisBusy(conns[i]) == 1)
+			alive[i] = false;
+
+		if (alive[i] == true)
+			alive_count++;
+	}
+
+	pfree(pollfds);
+	pfree(pollfd_ix);
+
+	return alive_count;
+}
+
+
 const char *
 print_monitoring_state(MonitoringState monitoring_state)
 {
@@ -1098,6 +1830,16 @@ terminate(int retval)
 	if (UXSQLstatus(local_conn)  == CONNECTION_OK)
 		repmgrd_set_pid(local_conn, UNKNOWN_PID, NULL);
 
+	metrics_server_stop();
+
+	/*
+	 * Callers which can still reach the primary will already have drained
+	 * the queue; otherwise any records can only be written if the local
+	 * node is the primary. Notification commands are waited for for at most
+	 * "event_notification_timeout" seconds.
+	 */
+	drain_event_queue(local_conn);
+
 	logger_shutdown();
 
 	if (pid_file[0] != '\0')
@@ -14,6 +14,27 @@
 #define OPT_NO_PID_FILE                  1000
 #define OPT_DAEMONIZE                    1001
 
+typedef struct
+{
+	int			attempt;
+	int			max_attempts;
+	bool		backoff;
+	int			interval_ms;
+	int			window_ms;
+	bool		last_attempt;
+	unsigned int jitter_seed;
+	instr_time	start_time;
+	instr_time	attempt_start;
+} t_reconnect_schedule;
+
+typedef enum
+{
+	WAIT_TIMEOUT = 0,
+	WAIT_SIGNAL,
+	WAIT_CONNECTION_EVENT,
+	WAIT_LINK_EVENT
+} WaitResult;
+
 extern volatile sig_atomic_t got_SIGHUP;
 extern MonitoringState monitoring_state;
 extern instr_time degraded_monitoring_start;
@@ -27,7 +48,20 @@ extern char *config_file;   /* add by houjiaxing for #191581, 2023/11/23  review
 bool		check_upstream_connection(UXconn **conn, const char *conninfo, UXconn **paired_conn);
 void		try_reconnect(UXconn **conn, t_node_info *node_info);
 
+void		reconnect_schedule_init(t_reconnect_schedule *schedule, int node_id);
+int			reconnect_schedule_begin_attempt(t_reconnect_schedule *schedule);
+int			reconnect_schedule_next_delay(t_reconnect_schedule *schedule);
+int			reconnect_schedule_remaining_ms(t_reconnect_schedule *schedule);
+
 int			calculate_elapsed(instr_time start_time);
+WaitResult	wait_for_event(int timeout_ms, UXconn *conn);
+void		sleep_ms(int interval_ms);
+
+UXconn	   *get_pooled_connection(t_node_info *node_info);
+int			attach_pooled_connections(NodeInfoList *node_list);
+void		release_pooled_connection(t_node_info *node_info);
+void		release_pooled_connections(NodeInfoList *node_list);
+void		clear_connection_pool(void);
 const char *print_monitoring_state(MonitoringState monitoring_state);
 
 void		update_registration(UXconn *conn);
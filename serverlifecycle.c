@@ -0,0 +1,392 @@
+/*
+ * serverlifecycle.c - start and stop the local server, waiting for readiness
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * After an unclean shutdown, and after a follow or rejoin has restarted
+ * the local server, repmgrd needs to know when the server can be used.
+ * Rather than sleeping for a fixed interval, the state is taken from the
+ * status line the uxmaster writes to "uxmaster.pid", the cluster state in
+ * the control file and a connection ping, checked every
+ * SERVER_READINESS_POLL_INTERVAL_MS or as soon as the control file
+ * changes, whichever is earlier.
+ *
+ * Note that "ready" and "standby" are written only once the uxmaster has
+ * started its auxiliary processes (including the statistics collector),
+ * so a server which has reached that state can be stopped again without
+ * hitting the race which previously required a delay between start and
+ * stop.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "repmgr.h"
+#include "repmgrd.h"
+#include "controldata.h"
+#include "serverlifecycle.h"
+
+#define SERVER_READINESS_POLL_INTERVAL_MS	100
+
+/*
+ * connection attempts are made at this interval if readiness is unknown, or
+ * if an attempt failed although the server reported it was ready
+ */
+#define SERVER_CONNECT_RETRY_INTERVAL_MS	1000
+
+/* line numbers in "uxmaster.pid", counting from 1 */
+#define PID_FILE_LINE_PID			1
+#define PID_FILE_LINE_STATUS		8
+
+static bool _server_accepts_connections(const char *data_directory, const char *conninfo,
+										ServerReadiness readiness, time_t started_at);
+static const char *_format_server_readiness(ServerReadiness readiness);
+static int	_elapsed_ms(instr_time start_time);
+
+
+/*
+ * Determine the state of the uxmaster running in the specified data
+ * directory from its PID file.
+ *
+ * SERVER_READINESS_UNKNOWN is returned if the file can't be read or
+ * doesn't contain a recognised status; callers should then fall back to
+ * making connection attempts.
+ */
+ServerReadiness
+get_server_readiness(const char *data_directory)
+{
+	char		pid_file[MAXUXPATH] = "";
+	char		line[MAXLEN] = "";
+	FILE	   *pidf;
+	long		pid = 0;
+	int			line_no = 0;
+	ServerReadiness readiness = SERVER_READINESS_STARTING;
+
+	snprintf(pid_file, MAXUXPATH, "%s/uxmaster.pid", data_directory);
+
+	pidf = fopen(pid_file, "r");
+
+	if (pidf == NULL)
+	{
+		if (errno == ENOENT)
+			return SERVER_READINESS_NOT_RUNNING;
+
+		log_verbose(LOG_DEBUG, "get_server_readiness(): unable to open \"%s\": %s",
+					pid_file, strerror(errno));
+		return SERVER_READINESS_UNKNOWN;
+	}
+
+	while (fgets(line, sizeof(line), pidf) != NULL)
+	{
+		line_no++;
+
+		if (line_no == PID_FILE_LINE_PID)
+		{
+			pid = atol(line);
+		}
+		else if (line_no == PID_FILE_LINE_STATUS)
+		{
+			/* the status is padded with spaces to a fixed width */
+			if (strncmp(line, "ready", 5) == 0 || strncmp(line, "standby", 7) == 0)
+				readiness = SERVER_READINESS_READY;
+			else if (strncmp(line, "stopping", 8) == 0)
+				readiness = SERVER_READINESS_STOPPING;
+			else if (strncmp(line, "starting", 8) == 0)
+				readiness = SERVER_READINESS_STARTING;
+			else
+				readiness = SERVER_READINESS_UNKNOWN;
+			break;
+		}
+	}
+
+	fclose(pidf);
+
+	/*
+	 * An empty file, or one without a status line yet, is being written by
+	 * a uxmaster which is starting up.
+	 */
+	if (line_no < PID_FILE_LINE_PID)
+		return SERVER_READINESS_STARTING;
+
+	/* a negative PID indicates a single-user backend */
+	if (pid <= 0)
+		return SERVER_READINESS_UNKNOWN;
+
+	if (kill((pid_t) pid, 0) != 0 && errno == ESRCH)
+		return SERVER_READINESS_NOT_RUNNING;
+
+	return readiness;
+}
+
+
+/*
+ * Start the server in the specified data directory and wait until it's
+ * usable, for at most "timeout_secs" seconds.
+ *
+ * Returns as soon as the uxmaster reports it is ready, the control file
+ * shows recovery has progressed beyond crash recovery, and the server
+ * responds to a connection attempt (a rejection also shows it is up).
+ * Returns false if the server could not be started, exited during startup,
+ * or did not become ready in time.
+ */
+bool
+start_server_and_wait(const char *data_directory, const char *conninfo, int timeout_secs)
+{
+	UXSQLExpBufferData command_str;
+	instr_time	start_time;
+	time_t		started_at;
+	int			timeout_ms = timeout_secs * 1000;
+	bool		success;
+
+	initUXSQLExpBuffer(&command_str);
+	appendUXSQLExpBuffer(&command_str,
+						 "%s/ux_ctl -D %s -W start",
+						 config_file_options.ux_bindir, data_directory);
+
+	log_debug("start_server_and_wait(): executing:\n  %s", command_str.data);
+
+	INSTR_TIME_SET_CURRENT(start_time);
+	started_at = time(NULL);
+
+	success = run_local_command(command_str.data, NULL, false, false, timeout_ms, NULL);
+	termUXSQLExpBuffer(&command_str);
+
+	if (success == false)
+	{
+		log_warning(_("unable to start server in \"%s\""), data_directory);
+		return false;
+	}
+
+	for (;;)
+	{
+		ServerReadiness readiness = get_server_readiness(data_directory);
+
+		if (readiness == SERVER_READINESS_NOT_RUNNING)
+		{
+			/* the uxmaster may not have created its PID file yet */
+			if (_elapsed_ms(start_time) >= SERVER_CONNECT_RETRY_INTERVAL_MS)
+			{
+				log_warning(_("server in \"%s\" exited during startup"), data_directory);
+				return false;
+			}
+		}
+		else if (_server_accepts_connections(data_directory, conninfo, readiness, started_at) == true)
+		{
+			log_info(_("server in \"%s\" is ready after %i ms"),
+					 data_directory, _elapsed_ms(start_time));
+			return true;
+		}
+
+		if (_elapsed_ms(start_time) >= timeout_ms)
+			break;
+
+		(void) wait_for_controlfile_change(data_directory, SERVER_READINESS_POLL_INTERVAL_MS);
+	}
+
+	log_warning(_("server in \"%s\" did not become ready within %i seconds"),
+				data_directory, timeout_secs);
+
+	return false;
+}
+
+
+/*
+ * "ux_ctl stop" waits until the server has shut down, so there's nothing
+ * further to wait for here; it is killed if it takes longer than
+ * "timeout_secs" seconds.
+ */
+bool
+stop_server(const char *data_directory, int timeout_secs)
+{
+	UXSQLExpBufferData command_str;
+	bool		success;
+
+	initUXSQLExpBuffer(&command_str);
+	appendUXSQLExpBuffer(&command_str,
+						 "%s/ux_ctl -D %s stop",
+						 config_file_options.ux_bindir, data_directory);
+
+	log_debug("stop_server(): executing:\n  %s", command_str.data);
+
+	success = run_local_command(command_str.data, NULL, false, false, timeout_secs * 1000, NULL);
+	termUXSQLExpBuffer(&command_str);
+
+	if (success == false)
+		log_warning(_("unable to stop server in \"%s\""), data_directory);
+
+	return success;
+}
+
+
+/*
+ * Wait for at most "timeout_secs" seconds for a connection to the local
+ * server, which may still be starting up after e.g. the follow command
+ * restarted it.
+ *
+ * A connection is attempted as soon as the uxmaster reports it is ready;
+ * if that attempt fails (e.g. because of an authentication problem), or
+ * while its state can't be determined, attempts are made once a second.
+ * Returns the connection, or a connection with status CONNECTION_BAD if
+ * none could be established.
+ */
+UXconn *
+wait_for_server_connection(const char *data_directory, const char *conninfo, int timeout_secs)
+{
+	UXconn	   *conn = NULL;
+	instr_time	start_time;
+	int			timeout_ms = timeout_secs * 1000;
+	int			last_attempt_ms = -SERVER_CONNECT_RETRY_INTERVAL_MS;
+	int			attempts = 0;
+	ServerReadiness last_readiness = SERVER_READINESS_UNKNOWN;
+	bool		ready_attempt_failed = false;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (;;)
+	{
+		ServerReadiness readiness = get_server_readiness(data_directory);
+		int			elapsed_ms = _elapsed_ms(start_time);
+
+		if (readiness != last_readiness)
+		{
+			log_debug("wait_for_server_connection(): server is %s after %i ms",
+					  _format_server_readiness(readiness), elapsed_ms);
+			last_readiness = readiness;
+			ready_attempt_failed = false;
+		}
+
+		if ((readiness == SERVER_READINESS_READY && ready_attempt_failed == false) ||
+			elapsed_ms - last_attempt_ms >= SERVER_CONNECT_RETRY_INTERVAL_MS)
+		{
+			conn = establish_db_connection(conninfo, false);
+			attempts++;
+			last_attempt_ms = elapsed_ms;
+
+			if (UXSQLstatus(conn) == CONNECTION_OK)
+			{
+				log_debug("wait_for_server_connection(): connected after %i ms and %i attempt(s)",
+						  _elapsed_ms(start_time), attempts);
+				return conn;
+			}
+
+			if (elapsed_ms >= timeout_ms)
+				break;
+
+			/* don't retry every poll interval while the server stays ready */
+			if (readiness == SERVER_READINESS_READY)
+				ready_attempt_failed = true;
+
+			close_connection(&conn);
+		}
+		else if (elapsed_ms >= timeout_ms)
+		{
+			break;
+		}
+
+		(void) wait_for_controlfile_change(data_directory, SERVER_READINESS_POLL_INTERVAL_MS);
+	}
+
+	log_debug("wait_for_server_connection(): unable to connect within %i seconds (%i attempt(s))",
+			  timeout_secs, attempts);
+
+	if (conn == NULL)
+		conn = establish_db_connection(conninfo, false);
+
+	return conn;
+}
+
+
+/*
+ * Check the control file before pinging the server, as the startup process
+ * may still be in crash recovery.
+ *
+ * A standby with hot standby disabled never reports "standby" and remains
+ * "starting"; it is considered up once archive recovery has begun, which
+ * the startup process records in the control file. As the control file
+ * will show the state from before an unclean shutdown until then, it must
+ * also have been written since the server was started.
+ */
+static bool
+_server_accepts_connections(const char *data_directory, const char *conninfo,
+							ServerReadiness readiness, time_t started_at)
+{
+	DBState		state;
+	UXPing		ping;
+	bool		have_state = get_db_state(data_directory, &state);
+
+	if (readiness == SERVER_READINESS_READY || readiness == SERVER_READINESS_UNKNOWN)
+	{
+		if (have_state == true &&
+			(state == DB_STARTUP || state == DB_IN_CRASH_RECOVERY))
+			return false;
+	}
+	else if (readiness == SERVER_READINESS_STARTING)
+	{
+		char		control_file[MAXUXPATH] = "";
+		struct stat statbuf;
+
+		if (have_state == false || state != DB_IN_ARCHIVE_RECOVERY)
+			return false;
+
+		snprintf(control_file, MAXUXPATH, "%s/global/ux_control", data_directory);
+
+		if (stat(control_file, &statbuf) != 0 || statbuf.st_mtime < started_at)
+			return false;
+	}
+	else
+	{
+		return false;
+	}
+
+	ping = UXSQLping(conninfo);
+
+	return ping == UXSQLPING_OK || ping == UXSQLPING_REJECT;
+}
+
+
+static const char *
+_format_server_readiness(ServerReadiness readiness)
+{
+	switch (readiness)
+	{
+		case SERVER_READINESS_NOT_RUNNING:
+			return "not running";
+		case SERVER_READINESS_STARTING:
+			return "starting";
+		case SERVER_READINESS_STOPPING:
+			return "stopping";
+		case SERVER_READINESS_READY:
+			return "ready";
+		case SERVER_READINESS_UNKNOWN:
+			break;
+	}
+
+	return "in an unknown state";
+}
+
+
+static int
+_elapsed_ms(instr_time start_time)
+{
+	instr_time	current_time;
+
+	INSTR_TIME_SET_CURRENT(current_time);
+	INSTR_TIME_SUBTRACT(current_time, start_time);
+
+	return (int) INSTR_TIME_GET_MILLISEC(current_time);
+}
@@ -0,0 +1,39 @@
+/*
+ * serverlifecycle.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SERVERLIFECYCLE_H_
+#define _SERVERLIFECYCLE_H_
+
+typedef enum
+{
+	SERVER_READINESS_UNKNOWN = -1,
+	SERVER_READINESS_NOT_RUNNING,
+	SERVER_READINESS_STARTING,
+	SERVER_READINESS_STOPPING,
+	SERVER_READINESS_READY
+} ServerReadiness;
+
+extern ServerReadiness get_server_readiness(const char *data_directory);
+
+extern bool start_server_and_wait(const char *data_directory, const char *conninfo, int timeout_secs);
+extern bool stop_server(const char *data_directory, int timeout_secs);
+
+extern UXconn *wait_for_server_connection(const char *data_directory, const char *conninfo, int timeout_secs);
+
+#endif							/* _SERVERLIFECYCLE_H_ */
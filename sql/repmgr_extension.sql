@@ -25,3 +25,12 @@ SELECT repmgr.set_local_node_id(-1);
 SELECT repmgr.set_local_node_id(NULL);
 SELECT repmgr.standby_get_last_updated();
 SELECT repmgr.standby_set_last_updated();
+SELECT repmgr.create_monitoring_history_partitions(0);
+SELECT repmgr.create_monitoring_history_partitions(0);
+SELECT repmgr.drop_monitoring_history_partitions(1);
+SELECT * FROM repmgr.get_repmgrd_state();
+SELECT repmgr.record_lag_sample();
+SELECT * FROM repmgr.lag_history();
+SELECT in_recovery, wal_replay_paused, upstream_last_seen, upstream_node_id FROM repmgr.standby_status();
+SELECT repmgr.get_archive_ready_files();
+SELECT * FROM repmgr.cluster_view();
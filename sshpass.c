@@ -18,6 +18,8 @@
 #include <sys/wait.h>
 #include <sys/ioctl.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <assert.h>
 #include <unistd.h>
@@ -56,6 +58,28 @@ posix_openpt(int flags)
 }
 #endif
 
+/* maximum number of hosts for which an ssh master connection is kept */
+#define SSHPASS_MAX_SESSIONS 16
+
+/* how often to check whether ssh has exited while waiting for output */
+#define SSHPASS_POLL_INTERVAL_MS 100
+
+/*
+ * Password authentication is only needed to establish the master
+ * connection for each distinct ssh command prefix (i.e. host and
+ * options); subsequent commands are run through its control socket,
+ * without a pseudo terminal.
+ */
+typedef struct
+{
+	char		ssh_command[MAXLEN];
+	char		control_path[MAXUXPATH];
+} t_sshpass_session;
+
+static t_sshpass_session sshpass_sessions[SSHPASS_MAX_SESSIONS];
+static int	sshpass_session_count = 0;
+static pid_t sshpass_sessions_owner = UNKNOWN_PID;
+
 void reliable_write( int fd, const void *data, size_t size );
 int handleoutput( int fd , const char *password);
 void window_resize_handler(int signum);
@@ -64,108 +88,356 @@ void term_handler(int signum);
 void term_child(int signum);
 int match( const char *reference, const char *buffer, ssize_t bufsize, int state );
 
+static t_sshpass_session *get_sshpass_session(const char *ssh_command);
+static bool sshpass_session_alive(t_sshpass_session *session);
+static char **build_ssh_argv(const char *ssh_command, const char *extra_options, const char *command, char **args);
+static int	run_ssh(char **argv, const char *password, UXSQLExpBufferData *outputbuf, int *exit_status, int timeout_ms);
+static void read_ssh_output(int *fd, UXSQLExpBufferData *outputbuf);
+
 /* Global variables so that this information be shared with the signal handler */
 static int ourtty; // Our own tty
-static int masterpt;
+static int masterpt = -1;
+
+/* prompt matching state, reset for each login */
+static int prevmatch, state1, state2, state3;
 
 int childpid;
 int termsig;
 
-int runsshpass( const char *password, const char *ssh_options, const char *command, int pfd[2] )
+
+/*
+ * Execute "command" via "ssh_command" (an ssh invocation including the
+ * options and host, but not the remote command), supplying "password"
+ * if ssh prompts for one. "command" may be NULL if "ssh_command" already
+ * contains the remote command.
+ *
+ * Unless ssh connection multiplexing is disabled, the first login with
+ * a particular "ssh_command" leaves a master connection behind which
+ * later calls reuse for as long as it persists, so they neither need a
+ * pseudo terminal nor repeat the password authentication.
+ *
+ * The remote command's output is appended to "outputbuf", if provided.
+ * With a "timeout_ms" greater than zero, ssh is killed once it has been
+ * running for that long.
+ *
+ * Returns true if ssh (and therefore the remote command) exited with
+ * status 0.
+ */
+bool
+sshpass_command(const char *password, const char *ssh_command, const char *command,
+				UXSQLExpBufferData *outputbuf, int *return_value, int timeout_ms)
 {
-	struct winsize  ttysize; // The size of our tty
-	sigset_t        sigmask, sigmask_select;
-	pid_t           wait_id = 0;
-	char            options[MAXLEN] = "";
-	char            command_shell[MAXLEN] = "";
-	const char      *name;
-	char            *strtemp;
-	char            **argv;
-	int             i = 0;
-	int             status = 0;
-	int             terminate = 0;
-	int             slavept;
-
-	/* begin add by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
-	strcpy(options, ssh_options);
-	strcpy(command_shell, command);
-	/*
-	 * get ssh argv
-	 */
-	argv = malloc(sizeof(char *)*(9));
-	memset(argv, 0, sizeof(char *)*(9));
+	t_sshpass_session *session = get_sshpass_session(ssh_command);
+	UXSQLExpBufferData extra_options;
+	char	  **argv = NULL;
+	char	   *args = NULL;
+	int			exit_status = -1;
+	int			ret;
+
+	if (ssh_command[0] == '\0')
+	{
+		log_error(_("no ssh command provided"));
+		return false;
+	}
 
-	/* 获取第一个子字符串 */
-	strtemp = strtok(options, " ");
+	initUXSQLExpBuffer(&extra_options);
 
-	/* 继续获取其他的子字符串 */
-	while( strtemp != NULL && i < 9 )
+	if (session != NULL && sshpass_session_alive(session) == true)
 	{
-		argv[i] = strtemp;
-		strtemp = strtok(NULL, " ");
-		i++;
+		/* first obtained value wins, so these override anything in "ssh_command" */
+		appendUXSQLExpBuffer(&extra_options,
+							 "-o BatchMode=yes -o ControlMaster=no -o ControlPath=%s",
+							 session->control_path);
+
+		argv = build_ssh_argv(ssh_command, extra_options.data, command, &args);
+
+		log_verbose(LOG_DEBUG, "sshpass_command(): reusing ssh master connection \"%s\"",
+					session->control_path);
+
+		ret = run_ssh(argv, NULL, outputbuf, &exit_status, timeout_ms);
 	}
-	argv[i] = command_shell;
-	/* end add by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
+	else
+	{
+		if (session != NULL)
+		{
+			(void) unlink(session->control_path);
+
+			appendUXSQLExpBuffer(&extra_options,
+								 "-o ControlMaster=yes -o ControlPath=%s -o ControlPersist=%i",
+								 session->control_path,
+								 SSH_CONTROL_PERSIST_SECS);
+		}
 
-	// We need to interrupt a select with a SIGCHLD. In order to do so, we need a SIGCHLD handler
-	signal( SIGCHLD, sigchld_handler );
+		argv = build_ssh_argv(ssh_command, extra_options.data, command, &args);
+
+		ret = run_ssh(argv, password, outputbuf, &exit_status, timeout_ms);
+
+		switch (ret)
+		{
+			case RETURN_NOERROR:
+				break;
+			case RETURN_INCORRECT_PASSWORD:
+				log_error(_("ssh password authentication failed"));
+				break;
+			case RETURN_HOST_KEY_UNKNOWN:
+				log_error(_("ssh host key is not known"));
+				log_hint(_("add the remote host's key to \"known_hosts\""));
+				break;
+			case RETURN_HOST_KEY_CHANGED:
+				log_error(_("ssh host key has changed"));
+				break;
+			default:
+				log_error(_("unable to execute ssh command"));
+				break;
+		}
+	}
 
-	// Create a pseudo terminal for our process
-	masterpt = posix_openpt(O_RDWR);
+	log_verbose(LOG_DEBUG, "sshpass_command(): ssh exit status was %i", exit_status);
 
-	if( masterpt == -1 ) {
-		perror("Failed to get a pseudo terminal");
+	termUXSQLExpBuffer(&extra_options);
+	pfree(args);
+	pfree(argv);
 
-		return RETURN_RUNTIME_ERROR;
+	if (return_value != NULL)
+		*return_value = exit_status;
+
+	return (ret == RETURN_NOERROR && exit_status == 0);
+}
+
+
+/*
+ * Find or allocate the session slot for "ssh_command"; returns NULL if
+ * connections are not being multiplexed.
+ */
+static t_sshpass_session *
+get_sshpass_session(const char *ssh_command)
+{
+	const char *control_dir = NULL;
+	const char *binary = NULL;
+	char		first_arg[MAXLEN] = "";
+	int			i;
+
+	/* only if the command is actually an ssh invocation */
+	if (sscanf(ssh_command, "%1023s", first_arg) != 1)
+		return NULL;
+
+	binary = strrchr(first_arg, '/');
+	binary = (binary == NULL) ? first_arg : binary + 1;
+
+	if (strcmp(binary, "ssh") != 0)
+		return NULL;
+
+	control_dir = get_ssh_control_dir(ssh_command);
+
+	if (control_dir == NULL)
+		return NULL;
+
+	/* sessions are not inherited by forked children */
+	if (sshpass_sessions_owner != getpid())
+	{
+		sshpass_session_count = 0;
+		sshpass_sessions_owner = getpid();
 	}
 
-	fcntl(masterpt, F_SETFL, O_NONBLOCK);
+	for (i = 0; i < sshpass_session_count; i++)
+	{
+		if (strcmp(sshpass_sessions[i].ssh_command, ssh_command) == 0)
+			return &sshpass_sessions[i];
+	}
 
-	if( grantpt( masterpt ) != 0 ) {
-		perror("Failed to change pseudo terminal's permission");
+	if (sshpass_session_count == SSHPASS_MAX_SESSIONS || strlen(ssh_command) >= MAXLEN)
+		return NULL;
 
-		return RETURN_RUNTIME_ERROR;
+	strncpy(sshpass_sessions[i].ssh_command, ssh_command, MAXLEN);
+	snprintf(sshpass_sessions[i].control_path, MAXUXPATH,
+			 "%s/sshpass-%i", control_dir, i);
+	sshpass_session_count++;
+
+	return &sshpass_sessions[i];
+}
+
+
+/*
+ * Determine whether the master connection is (still) accepting
+ * connections on its control socket, without starting another ssh.
+ */
+static bool
+sshpass_session_alive(t_sshpass_session *session)
+{
+	struct sockaddr_un addr;
+	int			sock;
+	bool		alive;
+
+	if (strlen(session->control_path) >= sizeof(addr.sun_path))
+		return false;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (sock < 0)
+		return false;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, session->control_path, sizeof(addr.sun_path) - 1);
+
+	alive = (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+	close(sock);
+
+	return alive;
+}
+
+
+/*
+ * Split "ssh_command" on whitespace into an argument vector, inserting
+ * "extra_options" after the ssh binary and appending "command", if set,
+ * as a single argument. The arguments point into "*args"; the caller must
+ * free both it and the returned vector.
+ */
+static char **
+build_ssh_argv(const char *ssh_command, const char *extra_options, const char *command, char **args)
+{
+	size_t		ssh_command_len = strlen(ssh_command) + 1;
+	size_t		extra_options_len = strlen(extra_options) + 1;
+	int			max_args = 3;
+	char	  **argv = NULL;
+	char	   *ptr = NULL;
+	char	   *strtok_state = NULL;
+	int			argc = 0;
+
+	*args = ux_malloc0(ssh_command_len + extra_options_len + (command == NULL ? 0 : strlen(command) + 1));
+
+	memcpy(*args, ssh_command, ssh_command_len);
+	memcpy(*args + ssh_command_len, extra_options, extra_options_len);
+
+	for (ptr = *args; ptr < *args + ssh_command_len + extra_options_len; ptr++)
+	{
+		if (*ptr == ' ' || *ptr == '\t')
+			max_args++;
 	}
-	if( unlockpt( masterpt ) != 0 ) {
-		perror("Failed to unlock pseudo terminal");
 
-		return RETURN_RUNTIME_ERROR;
+	argv = ux_malloc0(sizeof(char *) * max_args);
+
+	ptr = strtok_r(*args, " \t", &strtok_state);
+
+	if (ptr != NULL)
+	{
+		char	   *option_state = NULL;
+		char	   *option = NULL;
+
+		argv[argc++] = ptr;
+
+		for (option = strtok_r(*args + ssh_command_len, " ", &option_state);
+			 option != NULL;
+			 option = strtok_r(NULL, " ", &option_state))
+			argv[argc++] = option;
+
+		while ((ptr = strtok_r(NULL, " \t", &strtok_state)) != NULL)
+			argv[argc++] = ptr;
 	}
 
-	ourtty=open("/dev/tty", 0);
-	if( ourtty != -1 && ioctl( ourtty, TIOCGWINSZ, &ttysize ) == 0 ) {
-		signal(SIGWINCH, window_resize_handler);
+	if (command != NULL)
+	{
+		ptr = *args + ssh_command_len + extra_options_len;
+		strcpy(ptr, command);
+		argv[argc++] = ptr;
+	}
 
-		ioctl( masterpt, TIOCSWINSZ, &ttysize );
+	argv[argc] = NULL;
+
+	return argv;
+}
+
+
+/*
+ * Run ssh with "argv", collecting its standard output. If "password" is
+ * set, ssh is given a pseudo terminal and the password is supplied when
+ * prompted for; otherwise its standard input is /dev/null.
+ *
+ * Rather than blocking on one descriptor at a time, the pseudo terminal
+ * and the output pipe are both monitored, so a command producing more
+ * output than fits in the pipe can't stall the login.
+ *
+ * If "timeout_ms" is greater than zero, ssh is killed once it has been
+ * running for that long.
+ *
+ * Returns one of the program_return_codes; "exit_status" is set to
+ * ssh's exit status, if it exited.
+ */
+static int
+run_ssh(char **argv, const char *password, UXSQLExpBufferData *outputbuf, int *exit_status, int timeout_ms)
+{
+	int			pfd[2];
+	struct winsize ttysize; // The size of our tty
+	sigset_t	sigmask,
+				sigmask_select,
+				old_sigmask;
+	sighandler_t old_sigchld,
+				old_sighup,
+				old_sigterm,
+				old_sigint,
+				old_sigtstp,
+				old_sigwinch = SIG_ERR;
+	pid_t		wait_id = 0;
+	const char *name = NULL;
+	int			status = 0;
+	int			terminate = 0;
+	int			slavept = -1;
+	bool		exited = false;
+	bool		timed_out = false;
+	instr_time	start_time;
+
+	if (pipe(pfd) < 0)
+	{
+		log_error(_("unable to create pipe for ssh"));
+		log_detail("%s", strerror(errno));
+		return RETURN_RUNTIME_ERROR;
 	}
 
-	name=ptsname(masterpt);
-	/*
-	   Comment no. 3.14159
+	prevmatch = state1 = state2 = state3 = 0;
+	masterpt = -1;
+	ourtty = -1;
 
-	   This comment documents the history of code.
+	if (password != NULL)
+	{
+		// Create a pseudo terminal for our process
+		masterpt = posix_openpt(O_RDWR);
+
+		if (masterpt == -1 || grantpt(masterpt) != 0 || unlockpt(masterpt) != 0)
+		{
+			log_error(_("unable to set up a pseudo terminal for ssh"));
+			log_detail("%s", strerror(errno));
+
+			if (masterpt != -1)
+				close(masterpt);
+			close(pfd[0]);
+			close(pfd[1]);
+			return RETURN_RUNTIME_ERROR;
+		}
 
-	   We need to open the slavept inside the child process, after "setsid", so that it becomes the controlling
-	   TTY for the process. We do not, otherwise, need the file descriptor open. The original approach was to
-	   close the fd immediately after, as it is no longer needed.
+		fcntl(masterpt, F_SETFL, O_NONBLOCK);
 
-	   It turns out that (at least) the Linux kernel considers a master ptty fd that has no open slave fds
-	   to be unused, and causes "select" to return with "error on fd". The subsequent read would fail, causing us
-	   to go into an infinite loop. This is a bug in the kernel, as the fact that a master ptty fd has no slaves
-	   is not a permenant problem. As long as processes exist that have the slave end as their controlling TTYs,
-	   new slave fds can be created by opening /dev/tty, which is exactly what ssh is, in fact, doing.
+		name = ptsname(masterpt);
+	}
 
-	   Our attempt at solving this problem, then, was to have the child process not close its end of the slave
-	   ptty fd. We do, essentially, leak this fd, but this was a small price to pay. This worked great up until
-	   openssh version 5.6.
+	// We need to interrupt a select with a SIGCHLD. In order to do so, we need a SIGCHLD handler
+	old_sigchld = signal(SIGCHLD, sigchld_handler);
 
-	   Openssh version 5.6 looks at all of its open file descriptors, and closes any that it does not know what
-	   they are for. While entirely within its prerogative, this breaks our fix, causing sshpass to either
-	   hang, or do the infinite loop again.
+	if (password != NULL)
+	{
+		ourtty = open("/dev/tty", 0);
+		if (ourtty != -1 && ioctl(ourtty, TIOCGWINSZ, &ttysize) == 0)
+		{
+			old_sigwinch = signal(SIGWINCH, window_resize_handler);
 
-	   Our solution is to keep the slave end open in both parent AND child, at least until the handshake is
-	   complete, at which point we no longer need to monitor the TTY anyways.
+			ioctl(masterpt, TIOCSWINSZ, &ttysize);
+		}
+	}
+
+	/*
+	 * See comment no. 3.14159 in the upstream sshpass sources: the slave end
+	 * of the pseudo terminal is kept open in both parent and child, as a
+	 * master with no open slave fds causes "select" to report an error.
 	 */
 
 	// Set the signal mask during the select
@@ -179,118 +451,243 @@ int runsshpass( const char *password, const char *ssh_options, const char *comma
 	sigaddset(&sigmask, SIGINT);
 	sigaddset(&sigmask, SIGTSTP);
 
-	sigprocmask( SIG_SETMASK, &sigmask, NULL );
+	sigprocmask(SIG_SETMASK, &sigmask, &old_sigmask);
 
-	signal(SIGHUP, term_handler);
-	signal(SIGTERM, term_handler);
-	signal(SIGINT, term_handler);
-	signal(SIGTSTP, term_handler);
+	termsig = 0;
+	old_sighup = signal(SIGHUP, term_handler);
+	old_sigterm = signal(SIGTERM, term_handler);
+	old_sigint = signal(SIGINT, term_handler);
+	old_sigtstp = signal(SIGTSTP, term_handler);
+
+	fflush(stdout);
+	fflush(stderr);
 
 	childpid = fork();
-	if( childpid == 0 ) {
+	if (childpid == 0)
+	{
 		// Child
-
-		/* begin add by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
-		close(pfd[0]); 
-		if (pfd[1] != STDOUT_FILENO) {  
-			dup2(pfd[1], STDOUT_FILENO);  
-			close(pfd[1]); 
+		close(pfd[0]);
+		if (pfd[1] != STDOUT_FILENO)
+		{
+			dup2(pfd[1], STDOUT_FILENO);
+			close(pfd[1]);
 		}
-		/* end add by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
 
 		// Re-enable all signals to child
-		sigprocmask( SIG_SETMASK, &sigmask_select, NULL );
-
-		// Detach us from the current TTY
-		setsid();
+		sigprocmask(SIG_SETMASK, &sigmask_select, NULL);
+
+		if (password != NULL)
+		{
+			// Detach us from the current TTY
+			setsid();
+
+			// Attach the process to a controlling TTY.
+			slavept = open(name, O_RDWR | O_NOCTTY);
+			// On some systems, an open(2) is insufficient to set the controlling tty (see the documentation for
+			// TIOCSCTTY in tty(4)).
+			if (ioctl(slavept, TIOCSCTTY, 0) == -1)
+			{
+				perror("sshpass: Failed to set controlling terminal in child (TIOCSCTTY)");
+				exit(RETURN_RUNTIME_ERROR);
+			}
+			close(slavept); // We don't need the controlling TTY actually open
 
-		// Attach the process to a controlling TTY.
-		slavept = open(name, O_RDWR | O_NOCTTY);
-		// On some systems, an open(2) is insufficient to set the controlling tty (see the documentation for
-		// TIOCSCTTY in tty(4)).
-		if (ioctl(slavept, TIOCSCTTY, 0) == -1) {
-			perror("sshpass: Failed to set controlling terminal in child (TIOCSCTTY)");
-			exit(RETURN_RUNTIME_ERROR);
+			close(masterpt);
+		}
+		else
+		{
+			int			devnull = open("/dev/null", O_RDONLY);
+
+			if (devnull >= 0)
+			{
+				dup2(devnull, STDIN_FILENO);
+				close(devnull);
+			}
 		}
-		close( slavept ); // We don't need the controlling TTY actually open
 
-		close( masterpt );
-		/* modify by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
-		execvp( argv[0], argv );
+		execvp(argv[0], argv);
 
 		perror("SSHPASS: Failed to run command");
 
 		exit(RETURN_RUNTIME_ERROR);
-	} else if( childpid < 0 ) {
-		perror("SSHPASS: Failed to create child process");
+	}
+	else if (childpid < 0)
+	{
+		log_error(_("unable to fork() process for ssh"));
+		log_detail("%s", strerror(errno));
 
-		return RETURN_RUNTIME_ERROR;
+		terminate = RETURN_RUNTIME_ERROR;
+		exited = true;
 	}
 
 	// We are the parent
 	close(pfd[1]);
-	slavept=open(name, O_RDWR|O_NOCTTY );
+	fcntl(pfd[0], F_SETFL, O_NONBLOCK);
+
+	if (masterpt != -1)
+		slavept = open(name, O_RDWR | O_NOCTTY);
+
+	INSTR_TIME_SET_CURRENT(start_time);
 
-	do {
-		if( !terminate ) {
-			fd_set readfd;
-			int selret;
-			FD_ZERO(&readfd);
+	while (exited == false)
+	{
+		fd_set		readfd;
+		struct timespec timeout;
+		int			maxfd = -1;
+		int			selret;
+
+		FD_ZERO(&readfd);
+
+		if (masterpt != -1 && terminate == 0)
+		{
 			FD_SET(masterpt, &readfd);
+			maxfd = masterpt;
+		}
+
+		if (pfd[0] != -1)
+		{
+			FD_SET(pfd[0], &readfd);
+			if (pfd[0] > maxfd)
+				maxfd = pfd[0];
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = SSHPASS_POLL_INTERVAL_MS * 1000000L;
+
+		selret = pselect(maxfd + 1, &readfd, NULL, NULL, &timeout, &sigmask_select);
 
-			selret = pselect( masterpt + 1, &readfd, NULL, NULL, NULL, &sigmask_select );
+		if (termsig != 0)
+		{
+			// Copying termsig isn't strictly necessary, as signals are masked at this point.
+			int			signum = termsig;
 
-			if( termsig != 0 ) {
-				// Copying termsig isn't strictly necessary, as signals are masked at this point.
-				int signum = termsig;
-				termsig = 0;
+			termsig = 0;
 
-				term_child(signum);
+			term_child(signum);
+
+			continue;
+		}
 
-				continue;
+		if (timeout_ms > 0 && timed_out == false && childpid > 0)
+		{
+			instr_time	current_time;
+
+			INSTR_TIME_SET_CURRENT(current_time);
+			INSTR_TIME_SUBTRACT(current_time, start_time);
+
+			if ((int) INSTR_TIME_GET_MILLISEC(current_time) >= timeout_ms)
+			{
+				log_warning(_("ssh command did not complete within %i ms, terminating"), timeout_ms);
+				kill(childpid, SIGKILL);
+				timed_out = true;
 			}
+		}
 
-			if( selret > 0 ) {
-				if( FD_ISSET( masterpt, &readfd ) ) {
-					int ret;
-					if( (ret = handleoutput( masterpt , password )) ) {
-						// Authentication failed or any other error
-
-						// handleoutput returns positive error number in case of some error, and a negative value
-						// if all that happened is that the slave end of the pt is closed.
-						if( ret > 0 ) {
-							close( masterpt ); // Signal ssh that it's controlling TTY is now closed
-							close( slavept );
-						}
-
-						terminate = ret;
-
-						if( terminate ) {
-							close( slavept );
-						}
-					}
+		if (selret > 0)
+		{
+			if (masterpt != -1 && terminate == 0 && FD_ISSET(masterpt, &readfd))
+			{
+				int			ret = handleoutput(masterpt, password);
+
+				// handleoutput returns positive error number in case of some error, and a negative value
+				// if all that happened is that the slave end of the pt is closed.
+				if (ret > 0)
+				{
+					close(masterpt); // Signal ssh that it's controlling TTY is now closed
+					masterpt = -1;
 				}
+
+				if (ret != 0)
+					terminate = ret;
 			}
-			wait_id = waitpid( childpid, &status, WNOHANG );
-		} else {
-			wait_id = waitpid( childpid, &status, 0 );
+
+			if (pfd[0] != -1 && FD_ISSET(pfd[0], &readfd))
+				read_ssh_output(&pfd[0], outputbuf);
 		}
-	} while( wait_id == 0 || (!WIFEXITED( status ) && !WIFSIGNALED( status )) );
 
-	if( terminate > 0 )
+		wait_id = waitpid(childpid, &status, WNOHANG);
+
+		if (wait_id == childpid && (WIFEXITED(status) || WIFSIGNALED(status)))
+			exited = true;
+	}
+
+	/*
+	 * Collect whatever output is available; a backgrounded master
+	 * connection may hold the pipe open, so don't wait for EOF.
+	 */
+	if (pfd[0] != -1)
+	{
+		read_ssh_output(&pfd[0], outputbuf);
+
+		if (pfd[0] != -1)
+			close(pfd[0]);
+	}
+
+	if (masterpt != -1)
+		close(masterpt);
+
+	if (slavept != -1)
+		close(slavept);
+
+	if (ourtty != -1)
+		close(ourtty);
+
+	masterpt = -1;
+
+	signal(SIGHUP, old_sighup);
+	signal(SIGTERM, old_sigterm);
+	signal(SIGINT, old_sigint);
+	signal(SIGTSTP, old_sigtstp);
+	signal(SIGCHLD, old_sigchld);
+
+	if (old_sigwinch != SIG_ERR)
+		signal(SIGWINCH, old_sigwinch);
+
+	sigprocmask(SIG_SETMASK, &old_sigmask, NULL);
+
+	if (terminate > 0)
 		return terminate;
-	/* WIFEXITED: 如果子进程通过调用 exit 或者一个返回 (return) 正常终止，就返回真 */
-	else if( WIFEXITED( status ) )
-		return 0;     /* modify by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
+
+	if (WIFEXITED(status))
+		*exit_status = WEXITSTATUS(status);
 	else
-		return 255;
+		*exit_status = 255;
+
+	return RETURN_NOERROR;
+}
+
+
+/*
+ * Append whatever is available from "*fd" to "outputbuf" (if set),
+ * closing the descriptor and setting it to -1 on EOF or error.
+ */
+static void
+read_ssh_output(int *fd, UXSQLExpBufferData *outputbuf)
+{
+	char		buffer[MAXLEN];
+
+	for (;;)
+	{
+		ssize_t		nread = read(*fd, buffer, sizeof(buffer));
+
+		if (nread < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+
+		if (nread <= 0)
+			break;
+
+		if (outputbuf != NULL)
+			appendBinaryUXSQLExpBuffer(outputbuf, buffer, nread);
+	}
+
+	close(*fd);
+	*fd = -1;
 }
 
+
 int handleoutput( int fd , const char *password )
 {
 	// We are looking for the string
-	static int prevmatch = 0; // If the "password" prompt is repeated, we have the wrong password.
-	static int state1, state2, state3;
 	static const char *compare1 = "assword"; // Asking for a password
 	static const char compare2[] = "The authenticity of host "; // Asks to authenticate host
 	static const char compare3[] = "differs from the key for the IP address"; // Key changes
@@ -301,6 +698,14 @@ int handleoutput( int fd , const char *password )
 	int ret = 0;
 
 	int numread = read(fd, buffer, sizeof(buffer)-1 );
+
+	if( numread < 0 && (errno == EAGAIN || errno == EINTR) )
+		return 0;
+
+	// The slave end has been closed, i.e. ssh has finished with the tty
+	if( numread <= 0 )
+		return -1;
+
 	buffer[numread] = '\0';
 
 	state1 = match( compare1, buffer, numread, state1 );
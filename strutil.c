@@ -582,3 +582,100 @@ format_bool(bool value)
 {
 	return value == true ? "true" : "false";
 }
+
+
+/*
+ * Intern pool backing the long string fields of t_node_info.
+ *
+ * Values such as conninfo strings and config file paths repeat across every
+ * node record built from the same cluster metadata, and only change when the
+ * configuration does, so each distinct value is stored once and never freed.
+ * Interned strings are shared, so must be treated as immutable.
+ */
+typedef struct InternPool
+{
+	char	  **slots;
+	int			size;
+	int			entries;
+} InternPool;
+
+static InternPool intern_pool = {NULL, 0, 0};
+
+static uint32
+intern_hash(const char *string)
+{
+	uint32		hash = 2166136261u;
+
+	for (; *string != '\0'; string++)
+	{
+		hash ^= (unsigned char) *string;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void
+intern_pool_grow(void)
+{
+	char	  **old_slots = intern_pool.slots;
+	int			old_size = intern_pool.size;
+	int			i;
+
+	intern_pool.size = old_size == 0 ? 64 : old_size * 2;
+	intern_pool.slots = ux_malloc0(sizeof(char *) * intern_pool.size);
+
+	for (i = 0; i < old_size; i++)
+	{
+		uint32		slot;
+
+		if (old_slots[i] == NULL)
+			continue;
+
+		slot = intern_hash(old_slots[i]) & (intern_pool.size - 1);
+
+		while (intern_pool.slots[slot] != NULL)
+			slot = (slot + 1) & (intern_pool.size - 1);
+
+		intern_pool.slots[slot] = old_slots[i];
+	}
+
+	if (old_slots != NULL)
+		pfree(old_slots);
+}
+
+/*
+ * Return a shared, immutable copy of "string"; NULL is treated as an
+ * empty string.
+ */
+const char *
+intern_string(const char *string)
+{
+	uint32		slot;
+	char	   *copy;
+
+	if (string == NULL || string[0] == '\0')
+		return "";
+
+	/* keep the load factor under 1/2 */
+	if ((intern_pool.entries + 1) * 2 > intern_pool.size)
+		intern_pool_grow();
+
+	slot = intern_hash(string) & (intern_pool.size - 1);
+
+	while (intern_pool.slots[slot] != NULL)
+	{
+		if (strcmp(intern_pool.slots[slot], string) == 0)
+			return intern_pool.slots[slot];
+
+		slot = (slot + 1) & (intern_pool.size - 1);
+	}
+
+	copy = ux_malloc0(strlen(string) + 1);
+	strcpy(copy, string);
+
+	intern_pool.slots[slot] = copy;
+	intern_pool.entries++;
+
+	return copy;
+}
@@ -169,4 +169,6 @@ extern void
 
 extern const char *format_bool(bool value);
 
+extern const char *intern_string(const char *string);
+
 #endif							/* _STRUTIL_H_ */
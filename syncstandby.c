@@ -0,0 +1,438 @@
+/*
+ * syncstandby.c - parsing of "synchronous_standby_names"
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * The accepted syntax is the same as the server's:
+ *
+ *   standby_name [, ...]
+ *   [FIRST] num_sync ( standby_name [, ...] )
+ *   ANY num_sync ( standby_name [, ...] )
+ *
+ * where a standby name is either "*", an unquoted name or a double-quoted
+ * name. As on the server, names are matched case-insensitively.
+ *
+ * repmgrd checks the setting on every monitoring cycle, but it rarely
+ * changes; the previously parsed value is therefore retained, and the
+ * string only parsed again if it differs.
+ */
+
+#include <ctype.h>
+
+#include "repmgr.h"
+#include "syncstandby.h"
+
+typedef enum
+{
+	SSN_TOKEN_END = 0,
+	SSN_TOKEN_NAME,
+	SSN_TOKEN_LPAREN,
+	SSN_TOKEN_RPAREN,
+	SSN_TOKEN_COMMA,
+	SSN_TOKEN_ERROR
+} SyncStandbyNamesToken;
+
+static SyncStandbyNamesToken next_token(const char **pos, char *token, bool *quoted);
+static bool parse_standby_list(const char **pos, t_sync_standby_names *names, SyncStandbyNamesToken terminator);
+static void add_standby_name(t_sync_standby_names *names, const char *standby_name);
+static int	find_standby_name(t_sync_standby_names *names, const char *standby_name);
+static unsigned int standby_name_hash(const char *standby_name);
+static bool is_number(const char *token);
+
+
+/*
+ * Parse "value" into "names", unless it's the value "names" was last
+ * parsed from. Returns false if the value could not be parsed, in which
+ * case "names" is left empty.
+ */
+bool
+parse_sync_standby_names(const char *value, t_sync_standby_names *names)
+{
+	const char *pos = value;
+	char		token[NAMEDATALEN] = "";
+	bool		quoted = false;
+	SyncStandbyNamesToken t;
+
+	if (names->parsed == true && names->source != NULL && strcmp(names->source, value) == 0)
+		return names->valid;
+
+	names->parsed = true;
+	names->valid = false;
+	names->num_sync = 0;
+	names->wildcard = false;
+	names->member_count = 0;
+	if (names->buckets != NULL)
+		memset(names->buckets, 0, sizeof(int) * names->bucket_count);
+
+	if (names->source != NULL)
+		pfree(names->source);
+
+	names->source = ux_malloc0(strlen(value) + 1);
+	strcpy(names->source, value);
+
+	t = next_token(&pos, token, &quoted);
+
+	if (t == SSN_TOKEN_END)
+	{
+		names->valid = true;
+		return true;
+	}
+
+	/* "(...)", which the server treats as a list of names */
+	if (t == SSN_TOKEN_LPAREN)
+	{
+		names->num_sync = 1;
+
+		if (parse_standby_list(&pos, names, SSN_TOKEN_RPAREN) == true
+			&& next_token(&pos, token, &quoted) == SSN_TOKEN_END)
+		{
+			names->valid = true;
+			return true;
+		}
+
+		goto parse_error;
+	}
+
+	if (t == SSN_TOKEN_NAME && quoted == false)
+	{
+		/* "FIRST n (...)" or "ANY n (...)" */
+		if (strcasecmp(token, "FIRST") == 0 || strcasecmp(token, "ANY") == 0)
+		{
+			if (next_token(&pos, token, &quoted) == SSN_TOKEN_NAME && quoted == false && is_number(token))
+			{
+				names->num_sync = atoi(token);
+
+				if (next_token(&pos, token, &quoted) == SSN_TOKEN_LPAREN
+					&& parse_standby_list(&pos, names, SSN_TOKEN_RPAREN) == true
+					&& next_token(&pos, token, &quoted) == SSN_TOKEN_END)
+				{
+					names->valid = true;
+					return true;
+				}
+
+				goto parse_error;
+			}
+
+			/* otherwise it's a standby which happens to be called "first" or "any" */
+		}
+		/* "n (...)" */
+		else if (is_number(token))
+		{
+			names->num_sync = atoi(token);
+
+			if (next_token(&pos, token, &quoted) == SSN_TOKEN_LPAREN
+				&& parse_standby_list(&pos, names, SSN_TOKEN_RPAREN) == true
+				&& next_token(&pos, token, &quoted) == SSN_TOKEN_END)
+			{
+				names->valid = true;
+				return true;
+			}
+
+			goto parse_error;
+		}
+	}
+
+	/* plain list of standby names, the first of which requires sync */
+	pos = value;
+	names->num_sync = 1;
+
+	if (parse_standby_list(&pos, names, SSN_TOKEN_END) == true)
+	{
+		names->valid = true;
+		return true;
+	}
+
+parse_error:
+	log_warning(_("unable to parse \"synchronous_standby_names\" value \"%s\""), value);
+
+	names->num_sync = 0;
+	names->wildcard = false;
+	names->member_count = 0;
+	if (names->buckets != NULL)
+		memset(names->buckets, 0, sizeof(int) * names->bucket_count);
+
+	return false;
+}
+
+
+/*
+ * Determine whether "standby_name" is one of the standbys listed, or
+ * matches a "*" entry.
+ */
+bool
+sync_standby_names_contains(t_sync_standby_names *names, const char *standby_name)
+{
+	if (names->wildcard == true)
+		return true;
+
+	return find_standby_name(names, standby_name) != -1;
+}
+
+
+void
+clear_sync_standby_names(t_sync_standby_names *names)
+{
+	if (names->members != NULL)
+		pfree(names->members);
+
+	if (names->buckets != NULL)
+		pfree(names->buckets);
+
+	if (names->source != NULL)
+		pfree(names->source);
+
+	names->source = NULL;
+	names->parsed = false;
+	names->valid = false;
+	names->num_sync = 0;
+	names->wildcard = false;
+	names->member_count = 0;
+	names->member_capacity = 0;
+	names->members = NULL;
+	names->bucket_count = 0;
+	names->buckets = NULL;
+}
+
+
+/*
+ * Parse a comma-separated list of standby names, followed by "terminator".
+ */
+static bool
+parse_standby_list(const char **pos, t_sync_standby_names *names, SyncStandbyNamesToken terminator)
+{
+	char		token[NAMEDATALEN] = "";
+	bool		quoted = false;
+
+	for (;;)
+	{
+		SyncStandbyNamesToken t = next_token(pos, token, &quoted);
+
+		if (t != SSN_TOKEN_NAME)
+			return false;
+
+		if (quoted == false && strcmp(token, "*") == 0)
+			names->wildcard = true;
+		else
+			add_standby_name(names, token);
+
+		t = next_token(pos, token, &quoted);
+
+		if (t == terminator)
+			return true;
+
+		if (t != SSN_TOKEN_COMMA)
+			return false;
+	}
+}
+
+
+/*
+ * Return the next token from "*pos", advancing it past the token. For
+ * names, the name (truncated to NAMEDATALEN - 1 bytes, as on the server)
+ * is copied to "token" and "quoted" set if it was double-quoted.
+ */
+static SyncStandbyNamesToken
+next_token(const char **pos, char *token, bool *quoted)
+{
+	const char *p = *pos;
+	int			len = 0;
+
+	while (isspace((unsigned char) *p))
+		p++;
+
+	*quoted = false;
+
+	switch (*p)
+	{
+		case '\0':
+			*pos = p;
+			return SSN_TOKEN_END;
+		case '(':
+			*pos = p + 1;
+			return SSN_TOKEN_LPAREN;
+		case ')':
+			*pos = p + 1;
+			return SSN_TOKEN_RPAREN;
+		case ',':
+			*pos = p + 1;
+			return SSN_TOKEN_COMMA;
+		case '"':
+			*quoted = true;
+			p++;
+
+			for (;;)
+			{
+				if (*p == '\0')
+				{
+					*pos = p;
+					return SSN_TOKEN_ERROR;
+				}
+
+				if (*p == '"')
+				{
+					/* a doubled quote is a literal quote */
+					if (*(p + 1) != '"')
+					{
+						p++;
+						break;
+					}
+					p++;
+				}
+
+				if (len < NAMEDATALEN - 1)
+					token[len++] = *p;
+				p++;
+			}
+
+			token[len] = '\0';
+			*pos = p;
+
+			return len > 0 ? SSN_TOKEN_NAME : SSN_TOKEN_ERROR;
+	}
+
+	while (*p != '\0' && !isspace((unsigned char) *p)
+		   && *p != '(' && *p != ')' && *p != ',' && *p != '"')
+	{
+		if (len < NAMEDATALEN - 1)
+			token[len++] = *p;
+		p++;
+	}
+
+	token[len] = '\0';
+	*pos = p;
+
+	return SSN_TOKEN_NAME;
+}
+
+
+static void
+add_standby_name(t_sync_standby_names *names, const char *standby_name)
+{
+	unsigned int bucket;
+
+	if (find_standby_name(names, standby_name) != -1)
+		return;
+
+	if (names->member_count == names->member_capacity)
+	{
+		int			new_capacity = names->member_capacity == 0 ? 8 : names->member_capacity * 2;
+		char		(*members)[NAMEDATALEN] = ux_malloc0(sizeof(*members) * new_capacity);
+
+		if (names->member_count > 0)
+			memcpy(members, names->members, sizeof(*members) * names->member_count);
+
+		if (names->members != NULL)
+			pfree(names->members);
+
+		names->members = members;
+		names->member_capacity = new_capacity;
+	}
+
+	/* keep the table at most half full */
+	if (names->bucket_count < (names->member_count + 1) * 2)
+	{
+		int			i;
+
+		if (names->buckets != NULL)
+			pfree(names->buckets);
+
+		names->bucket_count = names->bucket_count == 0 ? 16 : names->bucket_count * 2;
+		names->buckets = ux_malloc0(sizeof(int) * names->bucket_count);
+
+		for (i = 0; i < names->member_count; i++)
+		{
+			bucket = standby_name_hash(names->members[i]) & (names->bucket_count - 1);
+
+			while (names->buckets[bucket] != 0)
+				bucket = (bucket + 1) & (names->bucket_count - 1);
+
+			names->buckets[bucket] = i + 1;
+		}
+	}
+
+	snprintf(names->members[names->member_count], NAMEDATALEN, "%s", standby_name);
+
+	bucket = standby_name_hash(standby_name) & (names->bucket_count - 1);
+
+	while (names->buckets[bucket] != 0)
+		bucket = (bucket + 1) & (names->bucket_count - 1);
+
+	names->buckets[bucket] = ++names->member_count;
+}
+
+
+/*
+ * Return the index of "standby_name" in the member list, or -1 if it's
+ * not present.
+ */
+static int
+find_standby_name(t_sync_standby_names *names, const char *standby_name)
+{
+	unsigned int bucket;
+
+	if (names->bucket_count == 0)
+		return -1;
+
+	bucket = standby_name_hash(standby_name) & (names->bucket_count - 1);
+
+	while (names->buckets[bucket] != 0)
+	{
+		int			i = names->buckets[bucket] - 1;
+
+		if (strcasecmp(names->members[i], standby_name) == 0)
+			return i;
+
+		bucket = (bucket + 1) & (names->bucket_count - 1);
+	}
+
+	return -1;
+}
+
+
+/* FNV-1a, folding case so it's consistent with the comparison above */
+static unsigned int
+standby_name_hash(const char *standby_name)
+{
+	unsigned int hash = 2166136261u;
+	const unsigned char *c;
+
+	for (c = (const unsigned char *) standby_name; *c != '\0'; c++)
+	{
+		hash ^= (unsigned int) tolower(*c);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+static bool
+is_number(const char *token)
+{
+	const char *c;
+
+	if (*token == '\0')
+		return false;
+
+	for (c = token; *c != '\0'; c++)
+	{
+		if (!isdigit((unsigned char) *c))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,51 @@
+/*
+ * syncstandby.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SYNCSTANDBY_H_
+#define _SYNCSTANDBY_H_
+
+/*
+ * Parsed form of a "synchronous_standby_names" value. "num_sync" is the
+ * number of synchronous standbys required (0 if the value is empty), and
+ * "wildcard" is set if the list contains "*", in which case any standby
+ * matches. The member names are held in a hash table for lookups.
+ * "parsed" indicates "source" has been parsed, and "valid" whether it
+ * could be.
+ */
+typedef struct
+{
+	char	   *source;
+	bool		parsed;
+	bool		valid;
+	int			num_sync;
+	bool		wildcard;
+	int			member_count;
+	int			member_capacity;
+	char		(*members)[NAMEDATALEN];
+	int			bucket_count;
+	int		   *buckets;		/* member index + 1; 0 means empty */
+} t_sync_standby_names;
+
+#define T_SYNC_STANDBY_NAMES_INITIALIZER { NULL, false, false, 0, false, 0, 0, NULL, 0, NULL }
+
+extern bool parse_sync_standby_names(const char *value, t_sync_standby_names *names);
+extern bool sync_standby_names_contains(t_sync_standby_names *names, const char *standby_name);
+extern void clear_sync_standby_names(t_sync_standby_names *names);
+
+#endif							/* _SYNCSTANDBY_H_ */
@@ -19,11 +19,53 @@
  */
 
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <dirent.h>
 
 #include "repmgr.h"
 
+extern char **environ;
+
+/*
+ * Commands containing any of these characters are executed via the
+ * shell; anything else is split on whitespace and executed directly.
+ */
+#define SHELL_METACHARACTERS "|&;<>()$`\\\"'*?[]#~=%!{}\n"
+
+/* how often to check whether a command has exited while its output is open */
+#define LOCAL_COMMAND_POLL_INTERVAL_MS 100
+
+/*
+ * Directory holding the ssh control sockets used to multiplex remote
+ * commands over one connection per host; created on first use and
+ * removed when the process exits.
+ */
+static char ssh_control_dir[MAXUXPATH] = "";
+static pid_t ssh_control_dir_owner = UNKNOWN_PID;
+static bool ssh_multiplex_unavailable = false;
+
+/*
+ * Time after which commands run via local_command() and friends are
+ * killed; zero (the default) means they may run indefinitely.
+ */
+static int	local_command_timeout_ms = 0;
 
 static bool _local_command(const char *command, UXSQLExpBufferData *outputbuf, bool simple, int *return_value);
+static bool _local_command_sshpass(const char *command, const char *command_shell, UXSQLExpBufferData *outputbuf, const char *passwd);
+static bool _spawn_command(const char *command, bool own_process_group, bool stdin_devnull, int *stdout_fd, int *stderr_fd, pid_t *pid);
+static char **_split_command(const char *command);
+static void _read_command_output(int *fd, UXSQLExpBufferData *buf, bool first_line_only);
+static int	_format_wait_status(int wait_status);
+static void _append_ssh_multiplex_options(UXSQLExpBufferData *ssh_command, const char *ssh_options);
+static void _close_ssh_control_connections(void);
+
+static bool _start_parallel_command(t_parallel_command *cmd);
+static bool _reap_parallel_command(t_parallel_command *cmd);
+static void _kill_parallel_command(t_parallel_command *cmd);
+static int	_parallel_command_elapsed_ms(t_parallel_command *cmd);
 
 
 /*
@@ -53,107 +95,215 @@ local_command_simple(const char *command, UXSQLExpBufferData *outputbuf)
 static bool
 _local_command(const char *command, UXSQLExpBufferData *outputbuf, bool simple, int *return_value)
 {
-	FILE	   *fp = NULL;
-	char		output[MAXLEN];
-	int			retval = 0;
-	bool		success;
-	char		tmpfile_path[MAXUXPATH];
-	const char *tmpdir = getenv("TMPDIR");
-	int			fd;
-	UXSQLExpBufferData command_final;
+	return run_local_command(command, outputbuf, !simple, true, local_command_timeout_ms, return_value);
+}
+
+
+/*
+ * Bound the time commands run via local_command() and friends may take;
+ * repmgrd sets this so a hung command can't stall monitoring or failover.
+ */
+void
+set_local_command_timeout(int timeout_secs)
+{
+	local_command_timeout_ms = timeout_secs > 0 ? timeout_secs * 1000 : 0;
+}
+
 
-	if (!tmpdir)
-		tmpdir = "/tmp";
+/*
+ * Execute a command locally, without creating any temporary files.
+ *
+ * If "outputbuf" is NULL, the command's standard output is inherited and
+ * any standard error output is logged if the command fails; otherwise its
+ * standard output (just the first line, if "first_line_only" is set) and,
+ * if "capture_stderr" is set, its standard error output are appended to
+ * "outputbuf". Uncaptured standard error output is inherited.
+ *
+ * With a "timeout_ms" greater than zero, the command (and anything it has
+ * started) is killed once it has been running for that long.
+ *
+ * As with popen(), the command's output is no longer read once the first
+ * line has been received, and a command terminated by SIGPIPE as a result
+ * is considered to have succeeded. We also don't wait for the output to be
+ * closed once the command itself has exited, as it may have started a
+ * daemon which keeps it open.
+ */
+bool
+run_local_command(const char *command, UXSQLExpBufferData *outputbuf, bool first_line_only,
+				  bool capture_stderr, int timeout_ms, int *return_value)
+{
+	int			stdout_fd = -1;
+	int			stderr_fd = -1;
+	pid_t		pid = UNKNOWN_PID;
+	int			wait_status = 0;
+	int			retval = -1;
+	bool		exited = false;
+	bool		timed_out = false;
+	bool		success;
+	UXSQLExpBufferData stderr_buf;
+	instr_time	start_time;
+	sighandler_t old_handler;
 
-	maxpath_snprintf(tmpfile_path, "%s/repmgr_command.XXXXXX",
-					 tmpdir);
+	log_verbose(LOG_DEBUG, "executing:\n  %s", command);
 
-	fd = mkstemp(tmpfile_path);
+	/* as in ux_system(), ensure we can reap the command if SIGCHLD is ignored */
+	old_handler = signal(SIGCHLD, SIG_DFL);
 
-	if (fd < 1)
+	if (_spawn_command(command, timeout_ms > 0, false,
+					   outputbuf == NULL ? NULL : &stdout_fd,
+					   (outputbuf == NULL || capture_stderr == true) ? &stderr_fd : NULL,
+					   &pid) == false)
 	{
-		log_error(_("unable to open temporary file"));
+		signal(SIGCHLD, old_handler);
+		log_error(_("unable to execute local command:\n%s"), command);
 		return false;
 	}
 
-	initUXSQLExpBuffer(&command_final);
-	appendUXSQLExpBufferStr(&command_final, command);
+	initUXSQLExpBuffer(&stderr_buf);
+	INSTR_TIME_SET_CURRENT(start_time);
 
-	appendUXSQLExpBuffer(&command_final, " 2>%s", tmpfile_path);
+	while (exited == false)
+	{
+		struct pollfd pollfds[2];
+		int			nfds = 0;
+		int			poll_timeout = LOCAL_COMMAND_POLL_INTERVAL_MS;
+		pid_t		wait_ret;
 
-	log_verbose(LOG_DEBUG, "executing:\n  %s", command_final.data);
+		if (timeout_ms > 0)
+		{
+			instr_time	current_time;
+			int			remaining_ms;
 
-	if (outputbuf == NULL)
-	{
-		retval = ux_system(command_final.data);
-		termUXSQLExpBuffer(&command_final);
+			INSTR_TIME_SET_CURRENT(current_time);
+			INSTR_TIME_SUBTRACT(current_time, start_time);
+			remaining_ms = timeout_ms - (int) INSTR_TIME_GET_MILLISEC(current_time);
 
-		if (return_value != NULL)
-			*return_value = WEXITSTATUS(retval);
+			if (remaining_ms <= 0)
+			{
+				log_warning(_("local command did not complete within %i ms, terminating"), timeout_ms);
+				log_detail(_("command was:\n  %s"), command);
+				kill(-pid, SIGKILL);
+				timed_out = true;
+				break;
+			}
 
-		close(fd);
+			if (remaining_ms < poll_timeout)
+				poll_timeout = remaining_ms;
+		}
 
-		if(retval == 0)		//uxdb
-			return true;
-		else
+		if (stdout_fd != -1)
 		{
-			log_error(_("ux_system() unable to execute local command:\n%s, ret=%d"), command, retval);
-			return false;
+			pollfds[nfds].fd = stdout_fd;
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
 		}
-	}
 
-	fp = popen(command_final.data, "r");
+		if (stderr_fd != -1)
+		{
+			pollfds[nfds].fd = stderr_fd;
+			pollfds[nfds].events = POLLIN;
+			pollfds[nfds].revents = 0;
+			nfds++;
+		}
 
-	if (fp == NULL)
-	{
-		log_error(_("unable to execute local command:\n%s"), command_final.data);
-		termUXSQLExpBuffer(&command_final);
-		close(fd);
-		return false;
-	}
+		if (nfds > 0 && poll(pollfds, nfds, poll_timeout) < 0 && errno != EINTR)
+		{
+			log_error(_("unable to poll command output"));
+			log_detail("%s", strerror(errno));
+			kill(pid, SIGKILL);
+			break;
+		}
 
-	termUXSQLExpBuffer(&command_final);
+		if (stdout_fd != -1)
+			_read_command_output(&stdout_fd, outputbuf, first_line_only);
 
-	while (fgets(output, MAXLEN, fp) != NULL)
-	{
-		appendUXSQLExpBufferStr(outputbuf, output);
+		if (stderr_fd != -1)
+			_read_command_output(&stderr_fd, &stderr_buf, false);
 
-		if (!feof(fp) && simple == false)
+		if (nfds == 0)
+		{
+			/* nothing left to read - just wait for the command to exit */
+			wait_ret = waitpid(pid, &wait_status, timeout_ms > 0 ? WNOHANG : 0);
+
+			if (wait_ret == 0)
+				usleep(LOCAL_COMMAND_POLL_INTERVAL_MS * 1000);
+		}
+		else
 		{
+			wait_ret = waitpid(pid, &wait_status, WNOHANG);
+		}
+
+		if (wait_ret == pid)
+		{
+			exited = true;
+		}
+		else if (wait_ret < 0 && errno != EINTR)
+		{
+			log_error(_("unable to wait for local command"));
+			log_detail("%s", strerror(errno));
 			break;
 		}
 	}
 
-	retval = pclose(fp);
+	if (exited == false)
+	{
+		while (waitpid(pid, &wait_status, 0) < 0)
+		{
+			if (errno != EINTR)
+				break;
+		}
+	}
+	else
+	{
+		/* collect whatever output is immediately available */
+		if (stdout_fd != -1)
+			_read_command_output(&stdout_fd, outputbuf, first_line_only);
+
+		if (stderr_fd != -1)
+			_read_command_output(&stderr_fd, &stderr_buf, false);
+	}
 
-	/* 141 = SIGPIPE */
-	success = (WEXITSTATUS(retval) == 0 || WEXITSTATUS(retval) == 141) ? true : false;
+	signal(SIGCHLD, old_handler);
 
-	log_verbose(LOG_DEBUG, "result of command was %i (%i)", WEXITSTATUS(retval), retval);
+	if (stdout_fd != -1)
+		close(stdout_fd);
 
-	/*
-	 * Append any captured STDERR output
-	 */
+	if (stderr_fd != -1)
+		close(stderr_fd);
 
-	fp = fopen(tmpfile_path, "r");
+	if (exited == true)
+		retval = _format_wait_status(wait_status);
 
-	/*
-	 * Not critical if we can't open the file
-	 */
-	if (fp != NULL)
+	if (return_value != NULL)
+		*return_value = retval;
+
+	log_verbose(LOG_DEBUG, "result of command was %i (%i)", retval, wait_status);
+
+	if (outputbuf == NULL)
 	{
-		while (fgets(output, MAXLEN, fp) != NULL)
+		success = (retval == 0);
+
+		if (success == false && timed_out == false)
 		{
-			appendUXSQLExpBufferStr(outputbuf, output);
+			log_error(_("unable to execute local command:\n%s, ret=%d"), command, retval);
+
+			if (stderr_buf.data[0] != '\0')
+				log_detail("%s", stderr_buf.data);
 		}
 
-		fclose(fp);
+		termUXSQLExpBuffer(&stderr_buf);
+
+		return success;
 	}
 
-	unlink(tmpfile_path);
+	/* 141 = SIGPIPE */
+	success = (retval == 0 || retval == 141) ? true : false;
+
+	if (capture_stderr == true)
+		appendUXSQLExpBufferStr(outputbuf, stderr_buf.data);
 
-	if (return_value != NULL)
-		*return_value = WEXITSTATUS(retval);
+	termUXSQLExpBuffer(&stderr_buf);
 
 	if (outputbuf->data != NULL && outputbuf->data[0] != '\0')
 		log_verbose(LOG_DEBUG, "local_command(): output returned was:\n%s", outputbuf->data);
@@ -164,32 +314,247 @@ _local_command(const char *command, UXSQLExpBufferData *outputbuf, bool simple,
 }
 
 
-	log_verbose(LOG_DEBUG, "executing:\n  %s", command);
+/*
+ * Start a command with posix_spawn(), via the shell only if it contains any
+ * shell metacharacters. If provided, "stdout_fd" and "stderr_fd" are set to
+ * the (non-blocking) read ends of pipes connected to the command's standard
+ * output and error respectively; otherwise these are inherited.
+ *
+ * With "own_process_group", the command is placed in a new process group,
+ * so it and any processes it starts can be killed together; with
+ * "stdin_devnull", its standard input is redirected from /dev/null.
+ */
+static bool
+_spawn_command(const char *command, bool own_process_group, bool stdin_devnull, int *stdout_fd, int *stderr_fd, pid_t *pid)
+{
+	posix_spawn_file_actions_t file_actions;
+	posix_spawnattr_t attr;
+	int			stdout_pipe[2] = {-1, -1};
+	int			stderr_pipe[2] = {-1, -1};
+	char	   *shell_argv[] = {"sh", "-c", (char *) command, NULL};
+	char	  **split_argv = NULL;
+	int			ret;
+
+	if ((stdout_fd != NULL && pipe(stdout_pipe) < 0)
+		|| (stderr_fd != NULL && pipe(stderr_pipe) < 0))
+	{
+		log_error(_("unable to create pipe for command"));
+		log_detail("%s", strerror(errno));
 
-	if (pipe(pfd) < 0)  
-		return false;   /* errno set by pipe() */  
+		if (stdout_pipe[0] != -1)
+		{
+			close(stdout_pipe[0]);
+			close(stdout_pipe[1]);
+		}
+		return false;
+	}
 
-	success = runsshpass(passwd, command, command_shell, pfd);
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawnattr_init(&attr);
 
-	if ((fp = fdopen(pfd[0], "r")) == NULL)
+	/* the pipe ends are closed in the child by the dup2()/close actions */
+	if (stdout_fd != NULL)
 	{
-		log_error(_("unable to execute local command:\n%s"), command);
+		posix_spawn_file_actions_adddup2(&file_actions, stdout_pipe[1], STDOUT_FILENO);
+		posix_spawn_file_actions_addclose(&file_actions, stdout_pipe[0]);
+		posix_spawn_file_actions_addclose(&file_actions, stdout_pipe[1]);
+	}
+
+	if (stderr_fd != NULL)
+	{
+		posix_spawn_file_actions_adddup2(&file_actions, stderr_pipe[1], STDERR_FILENO);
+		posix_spawn_file_actions_addclose(&file_actions, stderr_pipe[0]);
+		posix_spawn_file_actions_addclose(&file_actions, stderr_pipe[1]);
+	}
+
+	if (stdin_devnull == true)
+		posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+	if (own_process_group == true)
+	{
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+		posix_spawnattr_setpgroup(&attr, 0);
+	}
+
+	if (strpbrk(command, SHELL_METACHARACTERS) == NULL)
+		split_argv = _split_command(command);
+
+	fflush(stdout);
+	fflush(stderr);
+
+	if (split_argv != NULL)
+		ret = posix_spawnp(pid, split_argv[0], &file_actions, &attr, split_argv, environ);
+	else
+		ret = posix_spawn(pid, "/bin/sh", &file_actions, &attr, shell_argv, environ);
+
+	posix_spawn_file_actions_destroy(&file_actions);
+	posix_spawnattr_destroy(&attr);
+
+	if (split_argv != NULL)
+	{
+		pfree(split_argv[0]);
+		pfree(split_argv);
+	}
+
+	if (stdout_fd != NULL)
+		close(stdout_pipe[1]);
+
+	if (stderr_fd != NULL)
+		close(stderr_pipe[1]);
+
+	if (ret != 0)
+	{
+		log_error(_("unable to start command"));
+		log_detail("%s", strerror(ret));
+
+		if (stdout_fd != NULL)
+			close(stdout_pipe[0]);
+
+		if (stderr_fd != NULL)
+			close(stderr_pipe[0]);
+
 		return false;
 	}
 
-	/* TODO: better error handling */
-	while (fgets(output, MAXLEN, fp) != NULL)
+	if (stdout_fd != NULL)
 	{
-		appendUXSQLExpBufferStr(outputbuf, output);
+		(void) fcntl(stdout_pipe[0], F_SETFL, fcntl(stdout_pipe[0], F_GETFL) | O_NONBLOCK);
+		(void) fcntl(stdout_pipe[0], F_SETFD, FD_CLOEXEC);
+		*stdout_fd = stdout_pipe[0];
+	}
 
-		if (!feof(fp))
-		{
+	if (stderr_fd != NULL)
+	{
+		(void) fcntl(stderr_pipe[0], F_SETFL, fcntl(stderr_pipe[0], F_GETFL) | O_NONBLOCK);
+		(void) fcntl(stderr_pipe[0], F_SETFD, FD_CLOEXEC);
+		*stderr_fd = stderr_pipe[0];
+	}
+
+	return true;
+}
+
+
+/*
+ * Split a command containing no shell metacharacters into an argument
+ * vector; the arguments are stored in a single allocation referenced by
+ * the first element. Returns NULL if the command is empty.
+ */
+static char **
+_split_command(const char *command)
+{
+	char	   *args = ux_malloc0(strlen(command) + 1);
+	char	  **argv = NULL;
+	char	   *ptr = NULL;
+	int			argc = 0;
+	int			max_args = 2;
+
+	strcpy(args, command);
+
+	for (ptr = args; *ptr; ptr++)
+	{
+		if (*ptr == ' ' || *ptr == '\t')
+			max_args++;
+	}
+
+	argv = ux_malloc0(sizeof(char *) * max_args);
+
+	for (ptr = strtok(args, " \t"); ptr != NULL; ptr = strtok(NULL, " \t"))
+		argv[argc++] = ptr;
+
+	if (argc == 0)
+	{
+		pfree(args);
+		pfree(argv);
+		return NULL;
+	}
+
+	/* argv[0] may not be at the start of the buffer if the command has leading whitespace */
+	if (argv[0] != args)
+	{
+		memmove(args, argv[0], strlen(argv[0]) + 1);
+		argv[0] = args;
+	}
+
+	return argv;
+}
+
+
+/*
+ * Append whatever is available from "*fd" to "buf", closing the
+ * descriptor (and setting it to -1) on EOF or error, or once the first
+ * line has been read if "first_line_only" is set.
+ */
+static void
+_read_command_output(int *fd, UXSQLExpBufferData *buf, bool first_line_only)
+{
+	char		output[MAXLEN];
+
+	for (;;)
+	{
+		ssize_t		nread = read(*fd, output, sizeof(output) - 1);
+
+		if (nread < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+
+		if (nread <= 0)
 			break;
+
+		if (first_line_only == true)
+		{
+			char	   *newline = memchr(output, '\n', nread);
+
+			if (newline != NULL)
+				nread = newline - output + 1;
+
+			/* like fgets(), return at most MAXLEN - 1 characters */
+			if (buf->len + nread > MAXLEN - 1)
+				nread = MAXLEN - 1 - buf->len;
+
+			if (nread > 0)
+				appendBinaryUXSQLExpBuffer(buf, output, nread);
+
+			if (newline != NULL || buf->len >= MAXLEN - 1)
+				break;
+
+			continue;
 		}
+
+		appendBinaryUXSQLExpBuffer(buf, output, nread);
 	}
 
-	if (fclose(fp) == EOF)
-		return false;
+	close(*fd);
+	*fd = -1;
+}
+
+
+/*
+ * Return the exit status of a command as the shell would report it,
+ * i.e. 128 plus the signal number if it was terminated by a signal.
+ */
+static int
+_format_wait_status(int wait_status)
+{
+	if (WIFEXITED(wait_status))
+		return WEXITSTATUS(wait_status);
+
+	if (WIFSIGNALED(wait_status))
+		return 128 + WTERMSIG(wait_status);
+
+	return -1;
+}
+
+
+static bool
+_local_command_sshpass(const char *command, const char *command_shell, UXSQLExpBufferData *outputbuf, const char *passwd)
+{
+	bool		success;
+
+	log_verbose(LOG_DEBUG, "executing:\n  %s", command);
+
+	success = sshpass_command(passwd, command, command_shell, outputbuf, NULL, 0);
+
+	if (outputbuf == NULL)
+		return success;
 
 	if (outputbuf->data != NULL && outputbuf->data[0] != '\0')
 		log_verbose(LOG_DEBUG, "local_command(): output returned was:\n%s", outputbuf->data);
@@ -211,59 +576,32 @@ local_command_sshpass(const char *command, const char *command_shell, UXSQLExpBu
  * TODO: implement SSH calls using libssh2.
  */
 bool
-remote_command(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf)
+remote_command(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf, const char *uxdb_passwd)
+{
+	return remote_command_timeout(host, user, command, ssh_options, outputbuf, uxdb_passwd, 0);
+}
+
+
+/*
+ * As remote_command(), but if "timeout_ms" is greater than zero, ssh is
+ * killed once it has been running for that long, in which case false is
+ * returned.
+ */
+bool
+remote_command_timeout(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf, const char *uxdb_passwd, int timeout_ms)
 {
 	FILE	   *fp;
 	UXSQLExpBufferData ssh_command;
 
 	char		output[MAXLEN] = "";
 
-
-    initUXSQLExpBuffer(&ssh_command);
-    appendUXSQLExpBuffer(&ssh_command,
-                     "ssh -o Batchmode=yes %s %s %s",
-                     ssh_options,
-                     ssh_host.data,
-                     command);
+	initUXSQLExpBuffer(&ssh_command);
 
 	/* modify by houjiaxing for #178952 at 2023/03/16 reveiwer huyuanni. */
-	if (!strlen(uxdb_passwd))
+	if (uxdb_passwd != NULL && uxdb_passwd[0] != '\0')
 	{
-		make_remote_command(host, user, command, ssh_options, &ssh_command);
-
-		log_debug("remote_command():\n  %s", ssh_command.data);
-
-		fp = popen(ssh_command.data, "r");
-
-	fp = popen(ssh_command.data, "r");
-
-		termUXSQLExpBuffer(&ssh_command);
-
-		if (outputbuf != NULL)
-		{
-			/* TODO: better error handling */
-			while (fgets(output, MAXLEN, fp) != NULL)
-			{
-				appendUXSQLExpBufferStr(outputbuf, output);
-			}
-		}
-		else
-		{
-			while (fgets(output, MAXLEN, fp) != NULL)
-			{
-				if (!feof(fp))
-				{
-					break;
-				}
-			}
-		}
-
-		pclose(fp);
-	}
-	else
-	{
-		int pfd[2];
 		UXSQLExpBufferData ssh_host;
+		bool		success;
 
 		initUXSQLExpBuffer(&ssh_host);
 
@@ -275,36 +613,59 @@ remote_command(const char *host, const char *user, const char *command, const ch
 		appendUXSQLExpBufferStr(&ssh_host, host);
 
 		appendUXSQLExpBuffer(&ssh_command,
-							 "ssh -o StrictHostKeyChecking=no %s uxdb@%s",
+							 "ssh -o StrictHostKeyChecking=no %s %s",
 							 ssh_options,
 							 ssh_host.data);
 		termUXSQLExpBuffer(&ssh_host);
 
-    termUXSQLExpBuffer(&ssh_command);
+		log_debug("remote_command():\n  %s %s", ssh_command.data, command);
+
+		success = sshpass_command(uxdb_passwd, ssh_command.data, command, outputbuf, NULL, timeout_ms);
+
+		termUXSQLExpBuffer(&ssh_command);
 
-	if (outputbuf != NULL)
-	{
 		if (outputbuf != NULL)
 		{
-			/* TODO: better error handling */
-			while (fgets(output, MAXLEN, fp) != NULL)
-			{
-				appendUXSQLExpBufferStr(outputbuf, output);
-			}
+			if (outputbuf->data != NULL && outputbuf->data[0] != '\0')
+				log_verbose(LOG_DEBUG, "remote_command(): output returned was:\n%s", outputbuf->data);
+			else
+				log_verbose(LOG_DEBUG, "remote_command(): no output returned");
 		}
-		else
+
+		return success;
+	}
+
+	make_remote_command(host, user, command, ssh_options, &ssh_command);
+
+	log_debug("remote_command():\n  %s", ssh_command.data);
+
+	if (timeout_ms > 0)
+	{
+		bool		success = run_local_command(ssh_command.data, outputbuf, false, false, timeout_ms, NULL);
+
+		termUXSQLExpBuffer(&ssh_command);
+
+		return success;
+	}
+
+	fp = popen(ssh_command.data, "r");
+
+	if (fp == NULL)
+	{
+		log_error(_("unable to execute remote command:\n  %s"), ssh_command.data);
+		termUXSQLExpBuffer(&ssh_command);
+		return false;
+	}
+
+	termUXSQLExpBuffer(&ssh_command);
+
+	if (outputbuf != NULL)
+	{
+		/* TODO: better error handling */
+		while (fgets(output, MAXLEN, fp) != NULL)
 		{
-			while (fgets(output, MAXLEN, fp) != NULL)
-			{
-				if (!feof(fp))
-				{
-					break;
-				}
-			}
+			appendUXSQLExpBufferStr(outputbuf, output);
 		}
-
-		if (fclose(fp) == EOF)
-			return false;
 	}
 	else
 	{
@@ -347,8 +708,13 @@ make_remote_command(const char *host, const char *user, const char *command, con
 
 
 	appendUXSQLExpBuffer(ssh_command,
-					  "ssh -o Batchmode=yes %s %s %s",
-					  ssh_options,
+					  "ssh -o Batchmode=yes %s ",
+					  ssh_options);
+
+	_append_ssh_multiplex_options(ssh_command, ssh_options);
+
+	appendUXSQLExpBuffer(ssh_command,
+					  "%s %s",
 					  ssh_host.data,
 					  command);
 
@@ -357,6 +723,570 @@ make_remote_command(const char *host, const char *user, const char *command, con
 }
 
 
+/*
+ * Unless disabled with "ssh_multiplex", have ssh share one master
+ * connection per remote host, so successive remote commands (e.g. the
+ * status checks made during a switchover) don't each repeat the
+ * connection setup and key exchange.
+ */
+static void
+_append_ssh_multiplex_options(UXSQLExpBufferData *ssh_command, const char *ssh_options)
+{
+	const char *control_dir = get_ssh_control_dir(ssh_options);
+
+	if (control_dir == NULL)
+		return;
+
+	appendUXSQLExpBuffer(ssh_command,
+						 "-o ControlMaster=auto -o ControlPath=%s/%%C -o ControlPersist=%i ",
+						 control_dir,
+						 SSH_CONTROL_PERSIST_SECS);
+}
+
+
+/*
+ * Return the directory in which this process keeps its ssh control
+ * sockets, creating it on first use, or NULL if ssh connections are not
+ * to be multiplexed.
+ *
+ * If the user has configured ControlMaster/ControlPath themselves via
+ * "ssh_options", those settings take precedence.
+ */
+const char *
+get_ssh_control_dir(const char *ssh_options)
+{
+	char		options_lc[MAXLEN] = "";
+	int			i;
+
+	if (config_file_options.ssh_multiplex == false || ssh_multiplex_unavailable == true)
+		return NULL;
+
+	for (i = 0; ssh_options[i] != '\0' && i < MAXLEN - 1; i++)
+		options_lc[i] = tolower((unsigned char) ssh_options[i]);
+
+	if (strstr(options_lc, "controlmaster") != NULL || strstr(options_lc, "controlpath") != NULL)
+		return NULL;
+
+	if (ssh_control_dir[0] == '\0' || ssh_control_dir_owner != getpid())
+	{
+		snprintf(ssh_control_dir, sizeof(ssh_control_dir), "/tmp/repmgr-ssh-XXXXXX");
+
+		if (mkdtemp(ssh_control_dir) == NULL)
+		{
+			log_warning(_("unable to create directory for ssh control sockets, not multiplexing ssh connections"));
+			log_detail("%s", strerror(errno));
+			ssh_control_dir[0] = '\0';
+			ssh_multiplex_unavailable = true;
+			return NULL;
+		}
+
+		ssh_control_dir_owner = getpid();
+		atexit(_close_ssh_control_connections);
+
+		log_verbose(LOG_DEBUG, "using \"%s\" for ssh control sockets", ssh_control_dir);
+	}
+
+	return ssh_control_dir;
+}
+
+
+/*
+ * Shut down any ssh master connections opened by this process and remove
+ * the control socket directory.
+ */
+static void
+_close_ssh_control_connections(void)
+{
+	DIR		   *dir = NULL;
+	struct dirent *entry = NULL;
+	char		path[MAXUXPATH];
+	char		command[MAXLEN];
+
+	/* not in a forked child which inherited the atexit handler */
+	if (ssh_control_dir[0] == '\0' || ssh_control_dir_owner != getpid())
+		return;
+
+	dir = opendir(ssh_control_dir);
+
+	if (dir != NULL)
+	{
+		while ((entry = readdir(dir)) != NULL)
+		{
+			if (entry->d_name[0] == '.')
+				continue;
+
+			snprintf(path, sizeof(path), "%s/%s", ssh_control_dir, entry->d_name);
+			snprintf(command, sizeof(command),
+					 "ssh -o ControlPath=%s -O exit localhost >/dev/null 2>&1",
+					 path);
+
+			(void) system(command);
+			(void) unlink(path);
+		}
+
+		closedir(dir);
+	}
+
+	(void) rmdir(ssh_control_dir);
+	ssh_control_dir[0] = '\0';
+}
+
+
+/*
+ * Execute a set of shell commands concurrently.
+ *
+ * At most "max_parallel" commands will be running at any one time; any
+ * command which has not completed "timeout" seconds after it was started
+ * is terminated (a "timeout" of 0 means wait indefinitely). If
+ * "total_timeout" is non-zero, all commands still running that many
+ * seconds after this function was called are terminated, and any not yet
+ * started are marked as timed out without being executed. Each command's
+ * stdout is collected in its "output" buffer, which is initialised here and
+ * must be freed by the caller with clear_parallel_commands().
+ *
+ * This is intended for fanning out "ssh" invocations to each node in the
+ * cluster, so the total execution time is roughly that of the slowest
+ * command rather than the sum of all of them.
+ *
+ * Returns the number of commands which completed with exit code 0.
+ */
+int
+run_parallel_commands(t_parallel_command *commands, int command_count, int max_parallel, int timeout, int total_timeout)
+{
+	instr_time	run_start;
+	struct pollfd *pollfds = NULL;
+	int		   *pollfd_ix = NULL;
+	int			next_command = 0;
+	int			running = 0;
+	int			finished = 0;
+	int			successful = 0;
+	int			i;
+
+	if (command_count <= 0)
+		return 0;
+
+	if (max_parallel < 1)
+		max_parallel = 1;
+
+	INSTR_TIME_SET_CURRENT(run_start);
+
+	pollfds = ux_malloc0(sizeof(struct pollfd) * command_count);
+	pollfd_ix = ux_malloc0(sizeof(int) * command_count);
+
+	for (i = 0; i < command_count; i++)
+	{
+		commands[i].status = PCMD_PENDING;
+		commands[i].return_value = -1;
+		commands[i].elapsed_ms = 0;
+		commands[i].pid = UNKNOWN_PID;
+		commands[i].fd = -1;
+		initUXSQLExpBuffer(&commands[i].output);
+	}
+
+	while (finished < command_count)
+	{
+		int			nfds = 0;
+		int			poll_timeout = -1;
+		int			total_remaining_ms = -1;
+		int			ret;
+
+		if (total_timeout > 0)
+		{
+			instr_time	run_elapsed;
+
+			INSTR_TIME_SET_CURRENT(run_elapsed);
+			INSTR_TIME_SUBTRACT(run_elapsed, run_start);
+			total_remaining_ms = (total_timeout * 1000) - (int) INSTR_TIME_GET_MILLISEC(run_elapsed);
+
+			if (total_remaining_ms <= 0)
+			{
+				log_warning(_("commands did not complete within %i seconds, terminating"),
+							total_timeout);
+
+				for (i = 0; i < command_count; i++)
+				{
+					if (commands[i].status == PCMD_RUNNING)
+					{
+						log_detail("%s", commands[i].command);
+						_kill_parallel_command(&commands[i]);
+					}
+					else if (commands[i].status == PCMD_PENDING)
+					{
+						commands[i].status = PCMD_TIMED_OUT;
+					}
+				}
+
+				break;
+			}
+
+			poll_timeout = total_remaining_ms;
+		}
+
+		/* start as many pending commands as the concurrency limit allows */
+		while (running < max_parallel && next_command < command_count)
+		{
+			t_parallel_command *cmd = &commands[next_command++];
+
+			if (_start_parallel_command(cmd) == true)
+			{
+				running++;
+			}
+			else
+			{
+				cmd->status = PCMD_START_FAILED;
+				finished++;
+			}
+		}
+
+		if (running == 0)
+			continue;
+
+		/* collect the descriptors of the running commands, and find the nearest deadline */
+		for (i = 0; i < command_count; i++)
+		{
+			if (commands[i].status != PCMD_RUNNING)
+				continue;
+
+			if (commands[i].fd == -1)
+			{
+				/* output closed but command not yet exited - check again shortly */
+				if (poll_timeout == -1 || poll_timeout > LOCAL_COMMAND_POLL_INTERVAL_MS)
+					poll_timeout = LOCAL_COMMAND_POLL_INTERVAL_MS;
+			}
+			else
+			{
+				pollfds[nfds].fd = commands[i].fd;
+				pollfds[nfds].events = POLLIN;
+				pollfds[nfds].revents = 0;
+				pollfd_ix[nfds] = i;
+				nfds++;
+			}
+
+			if (timeout > 0)
+			{
+				int			remaining_ms = (timeout * 1000) - _parallel_command_elapsed_ms(&commands[i]);
+
+				if (remaining_ms < 0)
+					remaining_ms = 0;
+
+				if (poll_timeout == -1 || remaining_ms < poll_timeout)
+					poll_timeout = remaining_ms;
+			}
+		}
+
+		ret = poll(pollfds, nfds, poll_timeout);
+
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			log_error(_("unable to poll command output"));
+			log_detail("%s", strerror(errno));
+
+			/* terminate anything still running and give up */
+			for (i = 0; i < command_count; i++)
+			{
+				if (commands[i].status == PCMD_RUNNING)
+					_kill_parallel_command(&commands[i]);
+			}
+
+			finished = command_count;
+			break;
+		}
+
+		for (i = 0; i < nfds; i++)
+		{
+			t_parallel_command *cmd = &commands[pollfd_ix[i]];
+
+			if (pollfds[i].revents & (POLLIN | POLLHUP | POLLERR))
+			{
+				char		buf[MAXLEN];
+				ssize_t		nread;
+
+				nread = read(cmd->fd, buf, sizeof(buf));
+
+				if (nread > 0)
+				{
+					appendBinaryUXSQLExpBuffer(&cmd->output, buf, nread);
+				}
+				else if (nread == 0 || (errno != EAGAIN && errno != EINTR))
+				{
+					/*
+					 * EOF - the command may have redirected its output or left
+					 * work running in the background, so this doesn't mean it
+					 * has exited.
+					 */
+					close(cmd->fd);
+					cmd->fd = -1;
+				}
+			}
+		}
+
+		for (i = 0; i < command_count; i++)
+		{
+			t_parallel_command *cmd = &commands[i];
+
+			if (cmd->status != PCMD_RUNNING)
+				continue;
+
+			if (cmd->fd == -1 && _reap_parallel_command(cmd) == true)
+			{
+				if (cmd->return_value == 0)
+					successful++;
+
+				running--;
+				finished++;
+				continue;
+			}
+
+			if (timeout > 0 && _parallel_command_elapsed_ms(cmd) >= timeout * 1000)
+			{
+				log_warning(_("command for node %i did not complete within %i seconds, terminating"),
+							cmd->node_id, timeout);
+				log_detail("%s", cmd->command);
+
+				_kill_parallel_command(cmd);
+
+				running--;
+				finished++;
+			}
+		}
+	}
+
+	pfree(pollfds);
+	pfree(pollfd_ix);
+
+	return successful;
+}
+
+
+void
+clear_parallel_commands(t_parallel_command *commands, int command_count)
+{
+	int			i;
+
+	for (i = 0; i < command_count; i++)
+	{
+		termUXSQLExpBuffer(&commands[i].output);
+	}
+}
+
+
+const char *
+format_parallel_command_status(ParallelCommandStatus status)
+{
+	switch (status)
+	{
+		case PCMD_PENDING:
+			return "pending";
+		case PCMD_RUNNING:
+			return "running";
+		case PCMD_COMPLETED:
+			return "completed";
+		case PCMD_START_FAILED:
+			return "start failed";
+		case PCMD_TIMED_OUT:
+			return "timed out";
+	}
+
+	return "UNKNOWN";
+}
+
+
+/*
+ * Non-blocking counterparts to run_parallel_commands(), for callers which
+ * need to interleave command execution with other work.
+ *
+ * start_parallel_command() launches a single command and initialises its
+ * "output" buffer, which must be freed by the caller with
+ * clear_parallel_commands().
+ *
+ * poll_parallel_command() collects any available output without waiting,
+ * and returns true once the command has exited or has been terminated for
+ * running longer than "timeout" seconds (0 means no limit). A command which
+ * has closed its output is still considered running until it has exited.
+ *
+ * terminate_parallel_command() kills the command if still running.
+ */
+bool
+start_parallel_command(t_parallel_command *cmd)
+{
+	cmd->status = PCMD_PENDING;
+	cmd->return_value = -1;
+	cmd->elapsed_ms = 0;
+	cmd->pid = UNKNOWN_PID;
+	cmd->fd = -1;
+	initUXSQLExpBuffer(&cmd->output);
+
+	if (_start_parallel_command(cmd) == false)
+	{
+		cmd->status = PCMD_START_FAILED;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool
+poll_parallel_command(t_parallel_command *cmd, int timeout)
+{
+	if (cmd->status != PCMD_RUNNING)
+		return true;
+
+	while (cmd->fd != -1)
+	{
+		char		buf[MAXLEN];
+		ssize_t		nread = read(cmd->fd, buf, sizeof(buf));
+
+		if (nread > 0)
+		{
+			appendBinaryUXSQLExpBuffer(&cmd->output, buf, nread);
+			continue;
+		}
+
+		if (nread == 0 || (errno != EAGAIN && errno != EINTR))
+		{
+			/* EOF - see run_parallel_commands() */
+			close(cmd->fd);
+			cmd->fd = -1;
+		}
+
+		break;
+	}
+
+	if (cmd->fd == -1 && _reap_parallel_command(cmd) == true)
+		return true;
+
+	if (timeout > 0 && _parallel_command_elapsed_ms(cmd) >= timeout * 1000)
+	{
+		log_warning(_("command did not complete within %i seconds, terminating"),
+					timeout);
+		log_detail("%s", cmd->command);
+
+		_kill_parallel_command(cmd);
+		return true;
+	}
+
+	return false;
+}
+
+
+void
+terminate_parallel_command(t_parallel_command *cmd)
+{
+	if (cmd->status == PCMD_RUNNING)
+		_kill_parallel_command(cmd);
+}
+
+
+static bool
+_start_parallel_command(t_parallel_command *cmd)
+{
+	int			fd = -1;
+	pid_t		pid = UNKNOWN_PID;
+
+	log_verbose(LOG_DEBUG, "run_parallel_commands(): starting command for node %i:\n  %s",
+				cmd->node_id, cmd->command);
+
+	/*
+	 * Place the command in its own process group so the whole pipeline can
+	 * be terminated on timeout; also ensure it doesn't compete with its
+	 * siblings for our stdin.
+	 */
+	if (_spawn_command(cmd->command, true, true, &fd, NULL, &pid) == false)
+		return false;
+
+	cmd->pid = pid;
+	cmd->fd = fd;
+	cmd->status = PCMD_RUNNING;
+	INSTR_TIME_SET_CURRENT(cmd->start_time);
+
+	return true;
+}
+
+
+/*
+ * Check, without waiting, whether a command whose output has been closed
+ * has exited; returns true if so.
+ */
+static bool
+_reap_parallel_command(t_parallel_command *cmd)
+{
+	int			wait_status = 0;
+	pid_t		wait_ret;
+
+	do
+	{
+		wait_ret = waitpid(cmd->pid, &wait_status, WNOHANG);
+	} while (wait_ret < 0 && errno == EINTR);
+
+	if (wait_ret == 0)
+		return false;
+
+	cmd->status = PCMD_COMPLETED;
+
+	if (wait_ret == cmd->pid)
+		cmd->return_value = WEXITSTATUS(wait_status);
+
+	cmd->elapsed_ms = _parallel_command_elapsed_ms(cmd);
+
+	log_verbose(LOG_DEBUG, "run_parallel_commands(): command for node %i %s after %i ms (exit code %i)",
+				cmd->node_id,
+				format_parallel_command_status(cmd->status),
+				cmd->elapsed_ms,
+				cmd->return_value);
+
+	return true;
+}
+
+
+/*
+ * Kill a command which has run for too long, together with anything else
+ * in its process group.
+ */
+static void
+_kill_parallel_command(t_parallel_command *cmd)
+{
+	int			wait_status = 0;
+
+	kill(-cmd->pid, SIGKILL);
+	cmd->status = PCMD_TIMED_OUT;
+
+	if (cmd->fd != -1)
+	{
+		close(cmd->fd);
+		cmd->fd = -1;
+	}
+
+	while (waitpid(cmd->pid, &wait_status, 0) < 0)
+	{
+		if (errno != EINTR)
+			break;
+	}
+
+	cmd->elapsed_ms = _parallel_command_elapsed_ms(cmd);
+
+	log_verbose(LOG_DEBUG, "run_parallel_commands(): command for node %i %s after %i ms",
+				cmd->node_id,
+				format_parallel_command_status(cmd->status),
+				cmd->elapsed_ms);
+}
+
+
+static int
+_parallel_command_elapsed_ms(t_parallel_command *cmd)
+{
+	instr_time	current_time;
+
+	INSTR_TIME_SET_CURRENT(current_time);
+	INSTR_TIME_SUBTRACT(current_time, cmd->start_time);
+
+	return (int) INSTR_TIME_GET_MILLISEC(current_time);
+}
+
+
 pid_t
 disable_wal_receiver(UXconn *conn)
 {
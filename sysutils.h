@@ -20,12 +20,59 @@
 #ifndef _SYSUTILS_H_
 #define _SYSUTILS_H_
 
+typedef enum
+{
+	PCMD_PENDING = 0,
+	PCMD_RUNNING,
+	PCMD_COMPLETED,
+	PCMD_START_FAILED,
+	PCMD_TIMED_OUT
+} ParallelCommandStatus;
+
+/*
+ * Struct to store a command to be executed by run_parallel_commands(),
+ * together with its results.
+ */
+typedef struct s_parallel_command
+{
+	/* provided by the caller */
+	int			node_id;
+	char	   *command;
+	/* populated by run_parallel_commands() */
+	ParallelCommandStatus status;
+	int			return_value;
+	int			elapsed_ms;
+	UXSQLExpBufferData output;
+	/* internal use only */
+	pid_t		pid;
+	int			fd;
+	instr_time	start_time;
+} t_parallel_command;
+
 extern bool local_command(const char *command, UXSQLExpBufferData *outputbuf);
 extern bool local_command_return_value(const char *command, UXSQLExpBufferData *outputbuf, int *return_value);
 extern bool local_command_simple(const char *command, UXSQLExpBufferData *outputbuf);
+extern bool run_local_command(const char *command, UXSQLExpBufferData *outputbuf, bool first_line_only,
+							  bool capture_stderr, int timeout_ms, int *return_value);
+extern void set_local_command_timeout(int timeout_secs);
 
-extern bool remote_command(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf);
+/* seconds an idle multiplexed ssh master connection is kept open */
+#define SSH_CONTROL_PERSIST_SECS	60
+
+extern bool remote_command(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf, const char *uxdb_passwd);
+extern bool remote_command_timeout(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *outputbuf, const char *uxdb_passwd, int timeout_ms);
 extern void make_remote_command(const char *host, const char *user, const char *command, const char *ssh_options, UXSQLExpBufferData *ssh_command);
+extern const char *get_ssh_control_dir(const char *ssh_options);
+
+extern bool sshpass_command(const char *password, const char *ssh_command, const char *command,
+							UXSQLExpBufferData *outputbuf, int *return_value, int timeout_ms);
+
+extern int	run_parallel_commands(t_parallel_command *commands, int command_count, int max_parallel, int timeout, int total_timeout);
+extern void clear_parallel_commands(t_parallel_command *commands, int command_count);
+extern const char *format_parallel_command_status(ParallelCommandStatus status);
+extern bool start_parallel_command(t_parallel_command *cmd);
+extern bool poll_parallel_command(t_parallel_command *cmd, int timeout);
+extern void terminate_parallel_command(t_parallel_command *cmd);
 
 extern pid_t disable_wal_receiver(UXconn *conn);
 extern pid_t enable_wal_receiver(UXconn *conn, bool wait_startup);
@@ -16,6 +16,13 @@
  *
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All requests go through a single curl multi handle, which owns the
+ * connection cache; connections to the ux-backup-api server are therefore
+ * kept open between requests, and where the server supports HTTP/2 the
+ * status requests for several operations are multiplexed over one
+ * connection. Response bodies are fed to a json-c tokener as they arrive,
+ * so there is no limit on their size.
  */
 
 #include <string.h>
@@ -26,127 +33,352 @@
 #include "repmgr.h"
 #include "uxbackupapi.h"
 
+//Per-request state
+typedef struct api_request {
+	CURL *easy;
+	struct curl_slist *headers;
+	UXSQLExpBufferData url;
+	UXSQLExpBufferData payload;
+	json_tokener *tokener;
+	json_object *response;
+	bool parse_error;
+	CURLcode result;
+	long http_code;
+} api_request;
 
-size_t receive_operations_cb(void *content, size_t size, size_t nmemb, char *buffer) {
-	short int max_chars_to_copy = MAX_BUFFER_LENGTH -2;
-	short int i = 0;
-	int operation_length = 0;
-	json_object *value;
-	json_object *operations = NULL;
+static CURLM *multi_handle = NULL;
 
-	json_object *root = json_tokener_parse(content);
-	(void) json_object_object_get_ex(root, "operations", &operations);
+static CURLM *get_multi_handle(void);
+static void init_request(api_request *request, operation_task *task, const char *operation_id);
+static void free_request(api_request *request);
+static void perform_requests(api_request *requests, int request_count);
+static size_t receive_json_cb(void *content, size_t size, size_t nmemb, void *userdata);
+static char *get_response_string(api_request *request, const char *key);
 
-	operation_length = strlen(json_object_get_string(operations));
-	if (operation_length < max_chars_to_copy) {
-		max_chars_to_copy = operation_length;
+
+static CURLM *get_multi_handle(void) {
+	if (multi_handle == NULL) {
+		curl_global_init(CURL_GLOBAL_DEFAULT);
+		multi_handle = curl_multi_init();
+#ifdef CURLPIPE_MULTIPLEX
+		curl_multi_setopt(multi_handle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 	}
 
-	strncpy(buffer, json_object_get_string(operations), max_chars_to_copy);
+	return multi_handle;
+}
+
 
-	fprintf(stdout, "Success! The following operations were found\n");
-	for (i=0; i<json_object_array_length(operations); i++) {
-		value = json_object_array_get_idx(operations, i);
-		printf("%s\n", json_object_get_string(value));
+void ux_backupapi_client_cleanup(void) {
+	if (multi_handle != NULL) {
+		curl_multi_cleanup(multi_handle);
+		multi_handle = NULL;
+		curl_global_cleanup();
 	}
-	return size * nmemb;
 }
 
-char * define_base_url(operation_task *task) {
-	char *format = "http://%s:7480/servers/%s/operations";
-	char *url = malloc(MAX_BUFFER_LENGTH);
 
-	snprintf(url, MAX_BUFFER_LENGTH-1, format, task->host, task->node_name);
+//Prepare a request for the task's operations endpoint, or for one operation if `operation_id` is set
+static void init_request(api_request *request, operation_task *task, const char *operation_id) {
+	memset(request, 0, sizeof(api_request));
+
+	initUXSQLExpBuffer(&request->url);
+	appendUXSQLExpBuffer(&request->url, "http://%s:7480/servers/%s/operations",
+						 task->host, task->node_name);
+	if (operation_id != NULL) {
+		appendUXSQLExpBuffer(&request->url, "/%s", operation_id);
+	}
+
+	initUXSQLExpBuffer(&request->payload);
+
+	request->tokener = json_tokener_new();
+	request->easy = curl_easy_init();
 
-	//`url` is freed on the function that called this
-	return url;
+	curl_easy_setopt(request->easy, CURLOPT_URL, request->url.data);
+	curl_easy_setopt(request->easy, CURLOPT_WRITEFUNCTION, receive_json_cb);
+	curl_easy_setopt(request->easy, CURLOPT_WRITEDATA, request);
+	curl_easy_setopt(request->easy, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(request->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+#ifdef CURL_HTTP_VERSION_2TLS
+	curl_easy_setopt(request->easy, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+#endif
+#ifdef CURLOPT_PIPEWAIT
+	//Prefer waiting for an existing connection which can multiplex over opening a new one
+	curl_easy_setopt(request->easy, CURLOPT_PIPEWAIT, 1L);
+#endif
 }
 
-CURLcode get_operations_on_server(CURL *curl, operation_task *task) {
-	char buffer[MAX_BUFFER_LENGTH];
-	char *url = define_base_url(task);
-	CURLcode ret;
 
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, receive_operations_cb);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-	curl_easy_setopt(curl, CURLOPT_URL, url);
+static void free_request(api_request *request) {
+	if (request->easy != NULL) {
+		curl_easy_cleanup(request->easy);
+	}
+	if (request->headers != NULL) {
+		curl_slist_free_all(request->headers);
+	}
+	if (request->response != NULL) {
+		json_object_put(request->response);
+	}
+	if (request->tokener != NULL) {
+		json_tokener_free(request->tokener);
+	}
+	termUXSQLExpBuffer(&request->url);
+	termUXSQLExpBuffer(&request->payload);
+}
+
+
+//Execute the requests concurrently and wait until all have completed
+static void perform_requests(api_request *requests, int request_count) {
+	CURLM *multi = get_multi_handle();
+	int running = 0;
+	int i;
+
+	for (i = 0; i < request_count; i++) {
+		requests[i].result = CURLE_FAILED_INIT;
+		curl_multi_add_handle(multi, requests[i].easy);
+	}
+
+	do {
+		CURLMsg *msg = NULL;
+		int msgs_left = 0;
+
+		if (curl_multi_perform(multi, &running) != CURLM_OK) {
+			break;
+		}
+
+		while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
 
-	ret = curl_easy_perform(curl);
-	free(url);
+			for (i = 0; i < request_count; i++) {
+				if (requests[i].easy == msg->easy_handle) {
+					requests[i].result = msg->data.result;
+					curl_easy_getinfo(requests[i].easy, CURLINFO_RESPONSE_CODE, &requests[i].http_code);
+					break;
+				}
+			}
+		}
 
-	return ret;
+		if (running > 0) {
+			curl_multi_wait(multi, NULL, 0, 1000, NULL);
+		}
+	} while (running > 0);
+
+	for (i = 0; i < request_count; i++) {
+		curl_multi_remove_handle(multi, requests[i].easy);
+	}
 }
 
-size_t receive_operation_id(void *content, size_t size, size_t nmemb, char *buffer) {
-	json_object *operation = NULL;
-	json_object *root = json_tokener_parse(content);
-	(void) json_object_object_get_ex(root, "operation_id", &operation);
 
-	if (operation != NULL) {
-		strncpy(buffer, json_object_get_string(operation), MAX_BUFFER_LENGTH-2);
+//Feed each chunk of the response body to the request's JSON tokener as it arrives
+static size_t receive_json_cb(void *content, size_t size, size_t nmemb, void *userdata) {
+	api_request *request = (api_request *) userdata;
+	size_t length = size * nmemb;
+	json_object *object = NULL;
+	enum json_tokener_error error;
+
+	if (request->response != NULL || request->parse_error == true) {
+		//Anything after a complete JSON value is ignored
+		return length;
+	}
+
+	object = json_tokener_parse_ex(request->tokener, (const char *) content, (int) length);
+	error = json_tokener_get_error(request->tokener);
+
+	if (object != NULL) {
+		request->response = object;
+	}
+	else if (error != json_tokener_continue) {
+		log_warning(_("unable to parse reply from ux-backup-api: %s"), json_tokener_error_desc(error));
+		request->parse_error = true;
 	}
 
-	return size * nmemb;
+	return length;
 }
 
 
-CURLcode create_new_task(CURL *curl, operation_task *task) {
-	UXSQLExpBufferData payload;
-	char *url = define_base_url(task);
-	CURLcode ret;
+//Return a copy of the string value of `key` in the response, or NULL if not present
+static char *get_response_string(api_request *request, const char *key) {
+	json_object *value = NULL;
+	const char *str = NULL;
+	char *copy = NULL;
+
+	if (request->response == NULL) {
+		return NULL;
+	}
+
+	if (json_object_object_get_ex(request->response, key, &value) == false || value == NULL) {
+		return NULL;
+	}
+
+	str = json_object_get_string(value);
+	copy = malloc(strlen(str) + 1);
+	strcpy(copy, str);
+
+	return copy;
+}
+
+
+bool get_operations_on_server(operation_task *task) {
+	api_request request;
+	json_object *operations = NULL;
+	bool success = false;
+	size_t i;
+
+	init_request(&request, task, NULL);
+	perform_requests(&request, 1);
+
+	if (request.result == CURLE_OK && request.response != NULL
+		&& json_object_object_get_ex(request.response, "operations", &operations)) {
+		fprintf(stdout, "Success! The following operations were found\n");
+		for (i = 0; i < json_object_array_length(operations); i++) {
+			printf("%s\n", json_object_get_string(json_object_array_get_idx(operations, i)));
+		}
+		success = true;
+	}
+
+	free_request(&request);
+
+	return success;
+}
+
+
+bool create_new_task(operation_task *task, long *http_code) {
+	api_request request;
 	json_object *root = json_object_new_object();
-	struct curl_slist *chunk = NULL;
 
 	json_object_object_add(root, "operation_type", json_object_new_string(task->operation_type));
 	json_object_object_add(root, "backup_id", json_object_new_string(task->backup_id));
 	json_object_object_add(root, "remote_ssh_command", json_object_new_string(task->remote_ssh_command));
 	json_object_object_add(root, "destination_directory", json_object_new_string(task->destination_directory));
 
-	initUXSQLExpBuffer(&payload);
-	appendUXSQLExpBufferStr(&payload, json_object_to_json_string(root));
-
-	chunk = curl_slist_append(chunk, "Content-type: application/json");
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload.data);
-	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-	//curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, receive_operation_id);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, task->operation_id);
-	ret = curl_easy_perform(curl);
-	free(url);
-	termUXSQLExpBuffer(&payload);
-
-	return ret;
-}
+	init_request(&request, task, NULL);
+
+	appendUXSQLExpBufferStr(&request.payload, json_object_to_json_string(root));
+	json_object_put(root);
+
+	request.headers = curl_slist_append(request.headers, "Content-type: application/json");
+	curl_easy_setopt(request.easy, CURLOPT_HTTPHEADER, request.headers);
+	curl_easy_setopt(request.easy, CURLOPT_POSTFIELDS, request.payload.data);
 
+	perform_requests(&request, 1);
 
-size_t receive_operation_status(void *content, size_t size, size_t nmemb, char *buffer) {
-	json_object *status = NULL;
-	json_object *root = json_tokener_parse(content);
-	(void) json_object_object_get_ex(root, "status", &status);
-	if (status != NULL) {
-		strncpy(buffer, json_object_get_string(status), MAX_BUFFER_LENGTH-2);
+	*http_code = request.http_code;
+
+	if (request.result != CURLE_OK) {
+		log_detail("%s", curl_easy_strerror(request.result));
 	}
 	else {
-		fprintf(stderr, "Incorrect reply received for that operation ID.\n");
-		strcpy(buffer, "\0");
+		free(task->operation_id);
+		task->operation_id = get_response_string(&request, "operation_id");
 	}
-	return size * nmemb;
+
+	free_request(&request);
+
+	return task->operation_id != NULL && task->operation_id[0] != '\0';
 }
 
-CURLcode get_status_of_operation(CURL *curl, operation_task *task) {
-	CURLcode ret;
-	char *url = define_base_url(task);
 
-	strcat(url, "/");
-	strcat(url, task->operation_id);
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, receive_operation_status);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, task->operation_status);
+/*
+ * Wait for the given operations to finish, requesting the status of all
+ * unfinished operations concurrently on each round. The interval between
+ * rounds starts at UX_BACKUPAPI_POLL_MIN_INTERVAL and doubles up to
+ * UX_BACKUPAPI_POLL_MAX_INTERVAL while nothing changes, resetting whenever
+ * any operation's status changes.
+ *
+ * Returns the number of operations which finished with status "DONE".
+ */
+int wait_for_operations(operation_task **tasks, int task_count) {
+	api_request *requests = ux_malloc0(sizeof(api_request) * task_count);
+	operation_task **pending = ux_malloc0(sizeof(operation_task *) * task_count);
+	int interval = UX_BACKUPAPI_POLL_MIN_INTERVAL;
+	int done = 0;
+	int finished = 0;
+	int i;
+
+	while (finished < task_count) {
+		int pending_count = 0;
+		bool status_changed = false;
+
+		for (i = 0; i < task_count; i++) {
+			if (tasks[i]->operation_status != NULL
+				&& (strcmp(tasks[i]->operation_status, "DONE") == 0 || strcmp(tasks[i]->operation_status, "FAILED") == 0)) {
+				continue;
+			}
+
+			init_request(&requests[pending_count], tasks[i], tasks[i]->operation_id);
+			pending[pending_count++] = tasks[i];
+		}
+
+		perform_requests(requests, pending_count);
+
+		for (i = 0; i < pending_count; i++) {
+			operation_task *task = pending[i];
+			char *status = NULL;
+
+			if (requests[i].result != CURLE_OK) {
+				log_info("Retrying operation '%s': %s", task->operation_id, curl_easy_strerror(requests[i].result));
+			}
+			else if ((status = get_response_string(&requests[i], "status")) == NULL) {
+				log_warning("Incorrect reply received for operation ID '%s'", task->operation_id);
+			}
+			else {
+				if (task->operation_status == NULL || strcmp(task->operation_status, status) != 0) {
+					log_info("operation '%s' status %s", task->operation_id, status);
+					status_changed = true;
+				}
+
+				free(task->operation_status);
+				task->operation_status = status;
+
+				if (strcmp(status, "DONE") == 0) {
+					done++;
+					finished++;
+				}
+				else if (strcmp(status, "FAILED") == 0) {
+					finished++;
+				}
+			}
+
+			free_request(&requests[i]);
+		}
+
+		if (finished == task_count) {
+			break;
+		}
 
-	ret = curl_easy_perform(curl);
-	free(url);
+		if (status_changed == true) {
+			interval = UX_BACKUPAPI_POLL_MIN_INTERVAL;
+		}
+
+		sleep(interval);
+
+		interval *= 2;
+		if (interval > UX_BACKUPAPI_POLL_MAX_INTERVAL) {
+			interval = UX_BACKUPAPI_POLL_MAX_INTERVAL;
+		}
+	}
+
+	pfree(pending);
+	pfree(requests);
+
+	return done;
+}
+
+
+void free_operation_task(operation_task *task) {
+	if (task == NULL) {
+		return;
+	}
 
-	return ret;
+	free(task->backup_id);
+	free(task->destination_directory);
+	free(task->operation_type);
+	free(task->operation_id);
+	free(task->operation_status);
+	free(task->remote_ssh_command);
+	free(task->host);
+	free(task->node_name);
+	free(task);
 }
@@ -23,25 +23,23 @@ typedef struct operation_task {
 	char *backup_id;
 	char *destination_directory;
 	char *operation_type;
-	char *operation_id;
-	char *operation_status;
+	char *operation_id;			/* set by create_new_task(); NULL until then */
+	char *operation_status;		/* set by wait_for_operations(); NULL until then */
 	char *remote_ssh_command;
 	char *host;
 	char *node_name;
 } operation_task;
 
-//Default simplebuffer size in most of operations
-#define MAX_BUFFER_LENGTH 72
-
-//Callbacks to send/receive data from ux-backup-api endpoints
-size_t receive_operations_cb(void *content, size_t size, size_t nmemb, char *buffer);
-size_t receive_operation_id(void *content, size_t size, size_t nmemb, char *buffer);
-size_t receive_operation_status(void *content, size_t size, size_t nmemb, char *buffer);
+//Bounds for the interval between operation status requests (seconds)
+#define UX_BACKUPAPI_POLL_MIN_INTERVAL	1
+#define UX_BACKUPAPI_POLL_MAX_INTERVAL	30
 
 //Functions that implement the logic and know what to do and how to comunnicate wuth the API
-CURLcode get_operations_on_server(CURL *curl, operation_task *task);
-CURLcode create_new_task(CURL *curl, operation_task *task);
-CURLcode get_status_of_operation(CURL *curl, operation_task *task);
+bool get_operations_on_server(operation_task *task);
+bool create_new_task(operation_task *task, long *http_code);
+int wait_for_operations(operation_task **tasks, int task_count);
+
+//Releases the process-wide connection to the ux-backup-api server
+void ux_backupapi_client_cleanup(void);
 
-//Helper to make simpler to read the handler where we set the URL
-char * define_base_url(operation_task *task);
\ No newline at end of file
+void free_operation_task(operation_task *task);
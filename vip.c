@@ -0,0 +1,614 @@
+/*
+ * vip.c - virtual IP management via rtnetlink
+ *
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Adding, removing and querying the virtual IP is done directly over an
+ * NETLINK_ROUTE socket, and the gratuitous ARP announcement is sent from an
+ * AF_PACKET socket, so none of these operations need to fork a shell on the
+ * promotion path.
+ *
+ * Modifying addresses requires CAP_NET_ADMIN and sending ARP requires
+ * CAP_NET_RAW. When running as a non-root user without these capabilities
+ * (e.g. repmgrd has not been granted them via "setcap"), the functions here
+ * return VIP_NO_PERMISSION and the caller is expected to fall back to
+ * the sudo-based "ip addr" / "arping_command" helpers.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <netinet/if_ether.h>
+#include <netpacket/packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+#include "repmgr.h"
+#include "vip.h"
+
+#ifdef __linux__
+
+typedef struct
+{
+	int			family;
+	int			addrlen;
+	unsigned char addr[16];
+	int			prefixlen;
+	bool		has_prefix;
+	unsigned int ifindex;
+	char		ifname[IFNAMSIZ];
+	char		label[IFNAMSIZ];
+} t_vip_address;
+
+typedef struct
+{
+	struct nlmsghdr nlh;
+	struct ifaddrmsg ifa;
+	char		attrbuf[256];
+} t_vip_nl_request;
+
+static unsigned int nl_seq = 0;
+
+static VipStatus _parse_vip_address(const char *vip, const char *network_card, t_vip_address *address);
+static VipStatus _errno_to_vip_status(int err);
+static bool _nl_add_attr(struct nlmsghdr *nlh, size_t maxlen, int type, const void *data, int len);
+static int	_nl_open(void);
+static int	_nl_request_ack(int fd, struct nlmsghdr *nlh);
+static VipStatus _vip_address_modify(int msg_type, const char *vip, const char *network_card);
+
+
+/*
+ * Parse a virtual IP in the form accepted by "ip addr add", i.e.
+ * "address[/prefix]", IPv4 or IPv6, and resolve the network card.
+ *
+ * A network card with an alias suffix ("eth0:1") is resolved to the
+ * underlying device and the full name is used as the address label.
+ */
+static VipStatus
+_parse_vip_address(const char *vip, const char *network_card, t_vip_address *address)
+{
+	char		addr_buf[MAXLEN] = "";
+	char	   *slash = NULL;
+	char	   *colon = NULL;
+
+	memset(address, 0, sizeof(t_vip_address));
+
+	strncpy(addr_buf, vip, sizeof(addr_buf) - 1);
+	trim(addr_buf);
+
+	slash = strchr(addr_buf, '/');
+	if (slash != NULL)
+	{
+		char	   *endptr = NULL;
+
+		*slash = '\0';
+		address->prefixlen = (int) strtol(slash + 1, &endptr, 10);
+
+		if (endptr == slash + 1 || *endptr != '\0')
+			return VIP_ERROR;
+
+		address->has_prefix = true;
+	}
+
+	if (inet_pton(AF_INET, addr_buf, address->addr) == 1)
+	{
+		address->family = AF_INET;
+		address->addrlen = 4;
+	}
+	else if (inet_pton(AF_INET6, addr_buf, address->addr) == 1)
+	{
+		address->family = AF_INET6;
+		address->addrlen = 16;
+	}
+	else
+	{
+		return VIP_ERROR;
+	}
+
+	if (address->has_prefix == false)
+		address->prefixlen = address->addrlen * 8;
+	else if (address->prefixlen < 0 || address->prefixlen > address->addrlen * 8)
+		return VIP_ERROR;
+
+	strncpy(address->ifname, network_card, sizeof(address->ifname) - 1);
+	trim(address->ifname);
+
+	colon = strchr(address->ifname, ':');
+	if (colon != NULL)
+	{
+		strncpy(address->label, address->ifname, sizeof(address->label) - 1);
+		*colon = '\0';
+	}
+
+	address->ifindex = if_nametoindex(address->ifname);
+
+	if (address->ifindex == 0)
+		return VIP_ERROR;
+
+	return VIP_OK;
+}
+
+
+static VipStatus
+_errno_to_vip_status(int err)
+{
+	switch (err)
+	{
+		case 0:
+			return VIP_OK;
+		case EEXIST:
+			return VIP_EXISTS;
+		case EADDRNOTAVAIL:
+		case ESRCH:
+			return VIP_NOT_FOUND;
+		case EPERM:
+		case EACCES:
+			return VIP_NO_PERMISSION;
+		case EAFNOSUPPORT:
+		case EPROTONOSUPPORT:
+		case EOPNOTSUPP:
+			return VIP_UNSUPPORTED;
+	}
+
+	return VIP_ERROR;
+}
+
+
+static bool
+_nl_add_attr(struct nlmsghdr *nlh, size_t maxlen, int type, const void *data, int len)
+{
+	int			attr_len = RTA_LENGTH(len);
+	struct rtattr *rta = NULL;
+
+	if (NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(attr_len) > maxlen)
+		return false;
+
+	rta = (struct rtattr *) (((char *) nlh) + NLMSG_ALIGN(nlh->nlmsg_len));
+	rta->rta_type = type;
+	rta->rta_len = attr_len;
+	memcpy(RTA_DATA(rta), data, len);
+	nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(attr_len);
+
+	return true;
+}
+
+
+/*
+ * Open a NETLINK_ROUTE socket with a bounded receive timeout, so a
+ * misbehaving kernel reply can never stall the failover path.
+ */
+static int
+_nl_open(void)
+{
+	int			fd;
+	struct sockaddr_nl local;
+	struct timeval tv;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+
+	if (fd < 0)
+		return -1;
+
+	tv.tv_sec = VIP_NETLINK_TIMEOUT_MS / 1000;
+	tv.tv_usec = (VIP_NETLINK_TIMEOUT_MS % 1000) * 1000;
+	(void) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	memset(&local, 0, sizeof(local));
+	local.nl_family = AF_NETLINK;
+
+	if (bind(fd, (struct sockaddr *) &local, sizeof(local)) < 0)
+	{
+		int			saved_errno = errno;
+
+		close(fd);
+		errno = saved_errno;
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/*
+ * Send a netlink request and wait for its acknowledgement.
+ *
+ * Returns 0 on success, otherwise the (positive) errno reported by the
+ * kernel or by the socket layer.
+ */
+static int
+_nl_request_ack(int fd, struct nlmsghdr *nlh)
+{
+	struct sockaddr_nl kernel;
+	char		buf[8192];
+
+	memset(&kernel, 0, sizeof(kernel));
+	kernel.nl_family = AF_NETLINK;
+
+	nlh->nlmsg_seq = ++nl_seq;
+	nlh->nlmsg_flags |= NLM_F_ACK;
+
+	if (sendto(fd, nlh, nlh->nlmsg_len, 0, (struct sockaddr *) &kernel, sizeof(kernel)) < 0)
+		return errno;
+
+	for (;;)
+	{
+		int			len = recv(fd, buf, sizeof(buf), 0);
+		struct nlmsghdr *h = NULL;
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return errno;
+		}
+
+		for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			if (h->nlmsg_seq != nl_seq)
+				continue;
+
+			if (h->nlmsg_type == NLMSG_ERROR)
+			{
+				struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(h);
+
+				return -err->error;
+			}
+		}
+	}
+}
+
+
+static VipStatus
+_vip_address_modify(int msg_type, const char *vip, const char *network_card)
+{
+	t_vip_address address;
+	t_vip_nl_request req;
+	VipStatus	status;
+	int			fd;
+	int			err;
+
+	status = _parse_vip_address(vip, network_card, &address);
+
+	if (status != VIP_OK)
+	{
+		log_warning(_("unable to parse virtual ip \"%s\" on network card \"%s\""),
+					vip, network_card);
+		return status;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+	req.nlh.nlmsg_type = msg_type;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST;
+
+	if (msg_type == RTM_NEWADDR)
+		req.nlh.nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+
+	req.ifa.ifa_family = address.family;
+	req.ifa.ifa_prefixlen = address.prefixlen;
+	req.ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+	req.ifa.ifa_index = address.ifindex;
+
+	_nl_add_attr(&req.nlh, sizeof(req), IFA_LOCAL, address.addr, address.addrlen);
+
+	/*
+	 * As with "ip addr del" without a prefix, delete whichever prefix the
+	 * address was bound with.
+	 */
+	if (msg_type == RTM_NEWADDR || address.has_prefix == true)
+		_nl_add_attr(&req.nlh, sizeof(req), IFA_ADDRESS, address.addr, address.addrlen);
+
+	if (address.family == AF_INET && address.label[0] != '\0')
+		_nl_add_attr(&req.nlh, sizeof(req), IFA_LABEL, address.label, strlen(address.label) + 1);
+
+	fd = _nl_open();
+
+	if (fd < 0)
+	{
+		err = errno;
+	}
+	else
+	{
+		err = _nl_request_ack(fd, &req.nlh);
+		close(fd);
+	}
+
+	status = _errno_to_vip_status(err);
+
+	if (status == VIP_ERROR)
+	{
+		log_warning(_("netlink request for virtual ip \"%s\" on network card \"%s\" failed"),
+					vip, network_card);
+		log_detail("%s", strerror(err));
+	}
+
+	return status;
+}
+
+
+VipStatus
+vip_address_add(const char *vip, const char *network_card)
+{
+	return _vip_address_modify(RTM_NEWADDR, vip, network_card);
+}
+
+
+VipStatus
+vip_address_del(const char *vip, const char *network_card)
+{
+	return _vip_address_modify(RTM_DELADDR, vip, network_card);
+}
+
+
+/*
+ * Check whether the virtual IP is bound to the network card.
+ *
+ * Returns VIP_OK if present, VIP_NOT_FOUND if not, or an error status.
+ */
+VipStatus
+vip_address_exists(const char *vip, const char *network_card)
+{
+	t_vip_address address;
+	t_vip_nl_request req;
+	struct sockaddr_nl kernel;
+	char		buf[8192];
+	VipStatus	status;
+	int			fd;
+
+	status = _parse_vip_address(vip, network_card, &address);
+
+	if (status != VIP_OK)
+		return status;
+
+	fd = _nl_open();
+
+	if (fd < 0)
+		return _errno_to_vip_status(errno);
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+	req.nlh.nlmsg_type = RTM_GETADDR;
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nlh.nlmsg_seq = ++nl_seq;
+	req.ifa.ifa_family = address.family;
+
+	memset(&kernel, 0, sizeof(kernel));
+	kernel.nl_family = AF_NETLINK;
+
+	if (sendto(fd, &req, req.nlh.nlmsg_len, 0, (struct sockaddr *) &kernel, sizeof(kernel)) < 0)
+	{
+		status = _errno_to_vip_status(errno);
+		close(fd);
+		return status;
+	}
+
+	status = VIP_NOT_FOUND;
+
+	for (;;)
+	{
+		int			len = recv(fd, buf, sizeof(buf), 0);
+		struct nlmsghdr *h = NULL;
+		bool		done = false;
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			status = _errno_to_vip_status(errno);
+			break;
+		}
+
+		for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			struct ifaddrmsg *ifa = NULL;
+			struct rtattr *rta = NULL;
+			int			rta_len;
+
+			if (h->nlmsg_seq != nl_seq)
+				continue;
+
+			if (h->nlmsg_type == NLMSG_DONE)
+			{
+				done = true;
+				break;
+			}
+
+			if (h->nlmsg_type == NLMSG_ERROR)
+			{
+				struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(h);
+
+				status = _errno_to_vip_status(-err->error);
+				done = true;
+				break;
+			}
+
+			if (h->nlmsg_type != RTM_NEWADDR)
+				continue;
+
+			ifa = (struct ifaddrmsg *) NLMSG_DATA(h);
+
+			if (ifa->ifa_index != address.ifindex)
+				continue;
+
+			rta_len = IFA_PAYLOAD(h);
+
+			for (rta = IFA_RTA(ifa); RTA_OK(rta, rta_len); rta = RTA_NEXT(rta, rta_len))
+			{
+				/* IPv4 reports the local address as IFA_LOCAL, IPv6 only as IFA_ADDRESS */
+				if (rta->rta_type != (address.family == AF_INET ? IFA_LOCAL : IFA_ADDRESS))
+					continue;
+
+				if (RTA_PAYLOAD(rta) == address.addrlen &&
+					memcmp(RTA_DATA(rta), address.addr, address.addrlen) == 0)
+				{
+					status = VIP_OK;
+				}
+			}
+		}
+
+		/* keep draining the dump even after a match */
+		if (done == true)
+			break;
+	}
+
+	close(fd);
+
+	return status;
+}
+
+
+/*
+ * Announce the virtual IP with gratuitous ARP requests (sender and target
+ * protocol address both set to the VIP, sent to the broadcast address),
+ * equivalent to "arping -U". Packets are sent back-to-back so the
+ * announcement does not delay promotion.
+ *
+ * Only applies to IPv4 on Ethernet-type devices.
+ */
+VipStatus
+vip_send_gratuitous_arp(const char *vip, const char *network_card, int count)
+{
+	t_vip_address address;
+	struct ifreq ifr;
+	struct ether_arp arp;
+	struct sockaddr_ll dest;
+	VipStatus	status;
+	int			fd;
+	int			i;
+
+	status = _parse_vip_address(vip, network_card, &address);
+
+	if (status != VIP_OK)
+		return status;
+
+	if (address.family != AF_INET)
+		return VIP_UNSUPPORTED;
+
+	fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ARP));
+
+	if (fd < 0)
+		return _errno_to_vip_status(errno);
+
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, address.ifname, sizeof(ifr.ifr_name) - 1);
+
+	if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0)
+	{
+		status = _errno_to_vip_status(errno);
+		close(fd);
+		return status;
+	}
+
+	if (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER)
+	{
+		close(fd);
+		return VIP_UNSUPPORTED;
+	}
+
+	memset(&arp, 0, sizeof(arp));
+	arp.arp_hrd = htons(ARPHRD_ETHER);
+	arp.arp_pro = htons(ETH_P_IP);
+	arp.arp_hln = ETH_ALEN;
+	arp.arp_pln = 4;
+	arp.arp_op = htons(ARPOP_REQUEST);
+	memcpy(arp.arp_sha, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+	memcpy(arp.arp_spa, address.addr, 4);
+	memset(arp.arp_tha, 0xff, ETH_ALEN);
+	memcpy(arp.arp_tpa, address.addr, 4);
+
+	memset(&dest, 0, sizeof(dest));
+	dest.sll_family = AF_PACKET;
+	dest.sll_protocol = htons(ETH_P_ARP);
+	dest.sll_ifindex = address.ifindex;
+	dest.sll_halen = ETH_ALEN;
+	memset(dest.sll_addr, 0xff, ETH_ALEN);
+
+	for (i = 0; i < count; i++)
+	{
+		if (sendto(fd, &arp, sizeof(arp), 0, (struct sockaddr *) &dest, sizeof(dest)) < 0)
+		{
+			status = _errno_to_vip_status(errno);
+			break;
+		}
+	}
+
+	close(fd);
+
+	return status;
+}
+
+#else							/* !__linux__ */
+
+VipStatus
+vip_address_add(const char *vip, const char *network_card)
+{
+	return VIP_UNSUPPORTED;
+}
+
+
+VipStatus
+vip_address_del(const char *vip, const char *network_card)
+{
+	return VIP_UNSUPPORTED;
+}
+
+
+VipStatus
+vip_address_exists(const char *vip, const char *network_card)
+{
+	return VIP_UNSUPPORTED;
+}
+
+
+VipStatus
+vip_send_gratuitous_arp(const char *vip, const char *network_card, int count)
+{
+	return VIP_UNSUPPORTED;
+}
+
+#endif							/* __linux__ */
+
+
+const char *
+vip_status_str(VipStatus status)
+{
+	switch (status)
+	{
+		case VIP_OK:
+			return "OK";
+		case VIP_EXISTS:
+			return "EXISTS";
+		case VIP_NOT_FOUND:
+			return "NOT_FOUND";
+		case VIP_NO_PERMISSION:
+			return "NO_PERMISSION";
+		case VIP_UNSUPPORTED:
+			return "UNSUPPORTED";
+		case VIP_ERROR:
+			return "ERROR";
+	}
+
+	return "UNKNOWN";
+}
@@ -0,0 +1,45 @@
+/*
+ * vip.h
+ * Portions Copyright (c) 2016-2022, Beijing Uxsino Software Limited, Co.
+ * Copyright (c) 2009-2020, UXDB Software Co.,Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _VIP_H_
+#define _VIP_H_
+
+/* number of gratuitous ARP packets sent after binding a virtual IP */
+#define VIP_GARP_COUNT			3
+
+/* upper bound for waiting on a netlink reply */
+#define VIP_NETLINK_TIMEOUT_MS	1000
+
+typedef enum
+{
+	VIP_OK = 0,
+	VIP_EXISTS,
+	VIP_NOT_FOUND,
+	VIP_NO_PERMISSION,
+	VIP_UNSUPPORTED,
+	VIP_ERROR
+} VipStatus;
+
+extern VipStatus vip_address_add(const char *vip, const char *network_card);
+extern VipStatus vip_address_del(const char *vip, const char *network_card);
+extern VipStatus vip_address_exists(const char *vip, const char *network_card);
+extern VipStatus vip_send_gratuitous_arp(const char *vip, const char *network_card, int count);
+extern const char *vip_status_str(VipStatus status);
+
+#endif							/* _VIP_H_ */